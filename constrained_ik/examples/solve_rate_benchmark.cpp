@@ -0,0 +1,245 @@
+/**
+ * @file solve_rate_benchmark.cpp
+ * @brief Measures the solve rate, the latency and the iterations of the solver for several constraint configurations
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @license Software License Agreement (Apache License)\n
+ * \n
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at\n
+ * \n
+ * http://www.apache.org/licenses/LICENSE-2.0\n
+ * \n
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "constrained_ik/constrained_ik.h"
+#include "example_utils.h"
+#include <moveit/robot_model_loader/robot_model_loader.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <random_numbers/random_numbers.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+using namespace constrained_ik;
+using namespace constrained_ik::basic_kin;
+using namespace Eigen;
+
+namespace
+{
+
+/** @brief A reachable goal pose and the seed the solve starts from */
+struct Sample
+{
+  Eigen::Affine3d goal;
+  Eigen::VectorXd seed;
+};
+
+/** @brief The outcome of a single solve */
+struct SolveResult
+{
+  bool success;
+  double latency;
+  int iterations;
+};
+
+/** @brief Exposes the number of iterations taken by a solve */
+class BenchmarkIK : public Constrained_IK
+{
+public:
+  BenchmarkIK(const ros::NodeHandle &nh) : Constrained_IK(nh) {}
+
+  /**
+   * @brief Same as calcInvKin() but also returns the number of iterations
+   * @param goal cartesian pose to solve the inverse kinematics about
+   * @param joint_seed joint values that is used as the initial guess
+   * @param scene_context the planning scene objects, a null pointer ignores collisions
+   * @param joint_angles The joint solution
+   * @param iterations The number of iterations the solver ran
+   * @return True if valid IK solution is found, otherwise false
+   */
+  bool calcInvKinIterations(const Eigen::Affine3d &goal, const Eigen::VectorXd &joint_seed,
+                            const constrained_ik::SceneContextPtr &scene_context, Eigen::VectorXd &joint_angles,
+                            int &iterations) const
+  {
+    constrained_ik::SolverState state = getState(goal, joint_seed);
+    initSolverState(state, scene_context);
+    bool success = solveState(state, joint_angles);
+    iterations = state.iter;
+    return success;
+  }
+};
+
+/**
+ * @brief Returns the sample at the nearest rank of a percentile
+ * @param sorted The sorted samples, not empty
+ * @param p The percentile in [0, 1]
+ * @return The sample
+ */
+double percentile(const std::vector<double> &sorted, double p)
+{
+  std::size_t rank = static_cast<std::size_t>(std::ceil(p * sorted.size()));
+  return sorted[std::max<std::size_t>(rank, 1) - 1];
+}
+
+/**
+ * @brief Solves the samples with a configuration on several threads, each thread has its own solver
+ * @param nh The node handle the constraint parameter is relative to
+ * @param parameter The name of the constraints parameter of the configuration
+ * @param kin The kinematic model
+ * @param planning_scene The planning scene used by the constraints that check for collisions
+ * @param samples The samples
+ * @param num_threads The number of threads
+ * @param results The result of each sample
+ * @return The wall time taken to solve all the samples in seconds
+ */
+double solveSamples(const ros::NodeHandle &nh, const std::string &parameter, const BasicKin &kin,
+                    const planning_scene::PlanningScenePtr &planning_scene, const std::vector<Sample> &samples,
+                    int num_threads, std::vector<SolveResult> &results)
+{
+  std::vector<std::shared_ptr<BenchmarkIK> > solvers(num_threads);
+  for (auto &ik : solvers)
+  {
+    ik.reset(new BenchmarkIK(nh));
+    ik->addConstraintsFromParamServer(parameter);
+    ik->init(kin);
+  }
+
+  results.resize(samples.size());
+  std::atomic<std::size_t> next(0);
+  auto worker = [&](int t)
+  {
+    const BenchmarkIK &ik = *solvers[t];
+    SceneContextPtr scene_context = ik.createSceneContext(planning_scene);
+    Eigen::VectorXd joints;
+    for (std::size_t i = next++; i < samples.size(); i = next++)
+    {
+      auto start = std::chrono::steady_clock::now();
+      results[i].success = ik.calcInvKinIterations(samples[i].goal, samples[i].seed, scene_context, joints,
+                                                   results[i].iterations);
+      results[i].latency = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+  };
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; ++t)
+    threads.push_back(std::thread(worker, t));
+  for (auto &thread : threads)
+    thread.join();
+
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief Prints the throughput, the failure rate, the latency distribution and the iteration histogram of a configuration
+ * @param name The name of the configuration
+ * @param results The result of each sample
+ * @param wall_time The time taken to solve all the samples in seconds
+ * @param max_iterations The maximum number of iterations of the solver
+ * @param num_bins The number of bins of the iteration histogram
+ */
+void report(const std::string &name, const std::vector<SolveResult> &results, double wall_time, int max_iterations,
+            int num_bins)
+{
+  std::vector<double> latencies;
+  std::vector<int> histogram(num_bins, 0);
+  int failures = 0;
+  int bin_width = std::max(1, (max_iterations + num_bins - 1) / num_bins);
+  for (const SolveResult &r : results)
+  {
+    latencies.push_back(r.latency * 1000.0);
+    failures += r.success ? 0 : 1;
+    histogram[std::min(r.iterations / bin_width, num_bins - 1)]++;
+  }
+  std::sort(latencies.begin(), latencies.end());
+
+  ROS_INFO("Configuration '%s': %lu solves, %.1f solves/s, %.2f%% failures", name.c_str(), results.size(),
+           results.size() / wall_time, 100.0 * failures / results.size());
+  ROS_INFO("  latency [ms]: min %.3f, p50 %.3f, p90 %.3f, p99 %.3f, max %.3f", latencies.front(),
+           percentile(latencies, 0.5), percentile(latencies, 0.9), percentile(latencies, 0.99), latencies.back());
+
+  std::stringstream ss;
+  for (int b = 0; b < num_bins; ++b)
+    ss << " [" << b * bin_width << ", " << (b == num_bins - 1 ? std::string("...") : std::to_string((b + 1) * bin_width))
+       << "): " << histogram[b];
+  ROS_INFO("  iterations:%s", ss.str().c_str());
+}
+
+}
+
+/**
+ * @brief Samples random reachable poses and solves them with every constraint configuration of the
+ * ~configurations parameter, see solve_rate_benchmark.yaml.
+ */
+int main(int argc, char *argv[])
+{
+  ros::init(argc, argv, "solve_rate_benchmark");
+  ros::NodeHandle pnh("~");
+  BasicKin kin;
+  robot_model_loader::RobotModelLoaderPtr loader;
+  planning_scene::PlanningScenePtr planning_scene;
+
+  int num_samples, num_threads, seed, num_bins;
+  double seed_offset;
+  pnh.param("num_samples", num_samples, 1000);
+  pnh.param("num_threads", num_threads, static_cast<int>(std::max(1u, std::thread::hardware_concurrency())));
+  pnh.param("seed", seed, 0);
+  pnh.param("seed_offset", seed_offset, 0.5);
+  pnh.param("histogram_bins", num_bins, 10);
+
+  XmlRpc::XmlRpcValue configurations;
+  if (!pnh.getParam("configurations", configurations) || configurations.getType() != XmlRpc::XmlRpcValue::TypeStruct)
+  {
+    ROS_ERROR("The ~configurations parameter must map configuration names to constraint lists");
+    return 1;
+  }
+
+  // Load example robot model
+  planning_scene = getExampleRobotData(loader);
+  const moveit::core::JointModelGroup *group = loader->getModel()->getJointModelGroup("manipulator");
+  kin.init(group);
+
+  // the goals are the poses of random joint positions, the seeds are offset from those positions
+  std::vector<Sample> samples(num_samples);
+  random_numbers::RandomNumberGenerator rng(seed);
+  robot_state::RobotState state(loader->getModel());
+  Eigen::VectorXd joints;
+  for (Sample &sample : samples)
+  {
+    state.setToRandomPositions(group, rng);
+    state.copyJointGroupPositions(group, joints);
+    kin.calcFwdKin(joints, sample.goal);
+    sample.seed = joints;
+    for (int j = 0; j < sample.seed.size(); ++j)
+      sample.seed(j) += rng.uniformReal(-seed_offset, seed_offset);
+  }
+
+  ROS_INFO("Solving %i samples on %i threads", num_samples, num_threads);
+  for (XmlRpc::XmlRpcValue::iterator it = configurations.begin(); it != configurations.end(); ++it)
+  {
+    std::vector<SolveResult> results;
+    double wall_time = solveSamples(pnh, "configurations/" + it->first + "/constraints", kin, planning_scene, samples,
+                                    num_threads, results);
+
+    BenchmarkIK ik(pnh);
+    report(it->first, results, wall_time, ik.getSolverConfiguration().solver_max_iterations, num_bins);
+  }
+
+  return 0;
+}
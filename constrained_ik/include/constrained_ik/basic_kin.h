@@ -31,6 +31,9 @@
 #include <vector>
 #include <string>
 #include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <map>
 #include <Eigen/Core>
 #include <Eigen/Geometry>
 #include <kdl/tree.hpp>
@@ -41,14 +44,16 @@
 
 namespace constrained_ik
 {
+class BatchIK;
+
 namespace basic_kin
 {
 
 /**
  * @brief Basic low-level kinematics functions.
  *
- * Typically, just wrappers around the equivalent KDL calls.
- *
+ * The forward kinematics and jacobian of the robot chain are computed from segments cached at initialization, KDL is
+ * used to build the chain from the URDF and for sub chains.
  */
 class BasicKin
 {
@@ -57,6 +62,7 @@ public:
 
   BasicKin() :
     initialized_(false),
+    use_chain_segments_(false),
     group_(NULL)
   {
 
@@ -73,7 +79,7 @@ public:
   //TODO test
   /**
    * @brief Creates chain and calculates tool pose relative to root
-   * New chain is not stored permanently, but subchain_fk_solver_ is updated
+   * The chain is built the first time a pair of links is requested and reused by later calls, this method is thread safe.
    * @param joint_angles Vector of joint angles (size must match number of joints in chain)
    * @param base Name of base link for new chain
    * @param tip Name of tip link for new chain
@@ -93,6 +99,25 @@ public:
    */
   bool calcJacobian(const Eigen::VectorXd &joint_angles, Eigen::MatrixXd &jacobian) const;
 
+  /**
+   * @brief Calculates the jacobian of robot and its partial derivatives with respect to every joint in one pass
+   * @param joint_angles Input vector of joint angles
+   * @param jacobian Output jacobian
+   * @param derivatives Output partial derivatives of the jacobian, derivatives[j] = dJ/dq_j
+   * @return True if calculation successful, False if anything is wrong (including uninitialized BasicKin)
+   */
+  bool calcJacobianDerivatives(const Eigen::VectorXd &joint_angles, Eigen::MatrixXd &jacobian,
+                               std::vector<Eigen::MatrixXd> &derivatives) const;
+
+  /**
+   * @brief Calculates the partial derivatives of a jacobian with respect to every joint.  The columns of a joint are
+   * the linear and angular velocities of the tip in the base frame, the derivatives follow from the cross products of
+   * the columns: for j < i, dJ_i/dq_j = [w_j x v_i; w_j x w_i], otherwise dJ_i/dq_j = [w_i x v_j; 0].
+   * @param jacobian Input jacobian computed by calcJacobian()
+   * @param derivatives Output partial derivatives of the jacobian, derivatives[j] = dJ/dq_j
+   */
+  static void calcJacobianDerivatives(const Eigen::MatrixXd &jacobian, std::vector<Eigen::MatrixXd> &derivatives);
+
   /**
    * @brief Checks if BasicKin is initialized (init() has been run: urdf model loaded, etc.)
    * @return True if init() has completed successfully
@@ -231,7 +256,84 @@ static void KDLToEigen(const KDL::Jacobian &jacobian, Eigen::MatrixXd &matrix);
 static void EigenToKDL(const Eigen::VectorXd &vec, KDL::JntArray &joints) {joints.data = vec;}
 
 private:
+  friend class constrained_ik::BatchIK; // solves many problems of the chain from the cached segments
+
+  /**
+   * @brief A segment of the kinematic chain, cached at initialization so that the forward kinematics and the jacobian
+   * are computed in a single pass without converting to KDL
+   */
+  struct ChainSegment
+  {
+    /** @brief The motion of the segment joint */
+    enum JointType
+    {
+      Fixed,     /**< The segment does not move */
+      Revolute,  /**< The segment rotates about the axis */
+      Prismatic, /**< The segment translates along the axis */
+    };
+
+    JointType joint_type;            /**< The motion of the segment joint */
+    Eigen::Vector3d axis;            /**< The joint axis in the parent frame */
+    Eigen::Vector3d origin;          /**< A point on the joint axis in the parent frame */
+    Eigen::Matrix3d tip_rotation;    /**< The rotation of the segment tip relative to the parent at zero joint value */
+    Eigen::Vector3d tip_translation; /**< The translation of the segment tip relative to the parent at zero joint value */
+
+    /**
+     * @brief Computes the transform of the segment tip relative to its parent
+     * @param q The joint value, ignored for fixed segments
+     * @param rotation Output rotation of the tip
+     * @param translation Output translation of the tip
+     */
+    void pose(double q, Eigen::Matrix3d &rotation, Eigen::Vector3d &translation) const;
+  };
+
+  /**
+   * @brief Walks the cached chain once to compute the tip pose and optionally the jacobian, no memory is allocated
+   * when the jacobian already has the right size.
+   * @param segments Input cached segments of the chain
+   * @param joint_angles Input vector of joint angles
+   * @param pose Output transform of the tip relative to the root
+   * @param jacobian Output jacobian at the tip expressed in the root frame, not computed if null
+   */
+  static void calcChainKinematics(const std::vector<ChainSegment> &segments, const Eigen::VectorXd &joint_angles,
+                                  Eigen::Affine3d &pose, Eigen::MatrixXd *jacobian);
+
+  /**
+   * @brief Caches the segments of a KDL chain
+   * @param chain Input KDL chain
+   * @param segments Output cached segments
+   */
+  static void buildChainSegments(const KDL::Chain &chain, std::vector<ChainSegment> &segments);
+
+  /** @brief A chain between two links of the tree, built once and shared by every call */
+  struct SubChain
+  {
+    KDL::Chain chain;                   /**< The KDL chain between the links */
+    std::vector<ChainSegment> segments; /**< The cached segments of the chain */
+    bool use_segments;                  /**< True if the cached segments match KDL */
+  };
+
+  /**
+   * @brief Returns the chain between two links, it is built the first time the pair of links is requested.  This
+   * method is thread safe.
+   * @param base Name of base link of the chain
+   * @param tip Name of tip link of the chain
+   * @return The chain or a null pointer if the chain could not be created
+   */
+  boost::shared_ptr<const SubChain> getCachedSubChain(const std::string &base, const std::string &tip) const;
+
+  /**
+   * @brief Builds the cached chain from robot_chain_ and checks it against the KDL solvers
+   * @return True if the cached chain matches KDL, otherwise the KDL solvers are used
+   */
+  bool initChainSegments();
+
   bool initialized_;                                             /**< Identifies if the object has been initialized */
+  std::vector<ChainSegment> chain_segments_;                     /**< The cached segments of robot_chain_ */
+  bool use_chain_segments_;                                      /**< True if the cached segments are used instead of the KDL solvers */
+  mutable std::map<std::pair<std::string, std::string>, boost::shared_ptr<const SubChain> > sub_chains_; /**< The sub chains built so far, keyed by base and tip link */
+  mutable boost::mutex sub_chains_mutex_;                        /**< Protects sub_chains_ */
+  mutable boost::mutex kdl_solvers_mutex_;                       /**< Serializes the calls to fk_solver_ and jac_solver_ from concurrent solves */
   const moveit::core::JointModelGroup* group_;                   /**< Move group */
   KDL::Chain  robot_chain_;                                      /**< KDL Chain object */
   KDL::Tree   kdl_tree_;                                         /**< KDL tree object */
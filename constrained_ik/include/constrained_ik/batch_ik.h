@@ -0,0 +1,136 @@
+/**
+ * @file batch_ik.h
+ * @brief Lockstep solver of many independent pose goals of the same kinematic chain
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef BATCH_IK_H
+#define BATCH_IK_H
+
+#include <constrained_ik/basic_kin.h>
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+#include <Eigen/StdVector>
+#include <vector>
+
+namespace constrained_ik
+{
+
+/**
+ * @brief Solves many independent tool pose goals of the same chain, such as the cells of a reachability map or the
+ * candidates of a grasp, by advancing blocks of problems in lockstep.  The quantities of the problems of a block are
+ * stored as arrays with one entry per problem, the forward kinematics, the Jacobians, the damped least squares steps and
+ * the convergence tests are therefore vectorized across the problems instead of within the small matrices of one.  The
+ * goals are the position and the orientation of the tip link, as with the GoalPosition and GoalOrientation constraints,
+ * and the joints are kept within their limits.  The problems that converge stop moving while the others of their block
+ * continue.  The solver is const after init(), concurrent solves from several threads are safe.
+ */
+class BatchIK
+{
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  static const int LANES = 8; /**< The number of problems advanced together */
+
+  /** @brief The solver parameters */
+  struct Parameters
+  {
+    Parameters(): max_iterations(100), position_tolerance(1e-4), orientation_tolerance(1e-3), damping(0.01),
+                  max_joint_step(0.2) {}
+
+    int max_iterations;           /**< The maximum number of iterations of a block */
+    double position_tolerance;    /**< The tip position error at which a problem converged (m) */
+    double orientation_tolerance; /**< The tip rotation error at which a problem converged (rad) */
+    double damping;               /**< The damping factor of the least squares steps */
+    double max_joint_step;        /**< The largest joint motion of an iteration (rad or m) */
+  };
+
+  typedef std::vector<Eigen::Affine3d, Eigen::aligned_allocator<Eigen::Affine3d> > PoseVector;
+
+  BatchIK(): initialized_(false), num_joints_(0) {}
+
+  /**
+   * @brief Initializes the solver with the chain of a kinematic model
+   * @param kin The kinematic model, its chain must be supported by the cached segments of BasicKin
+   * @return True if the solver was initialized, otherwise false.
+   */
+  bool init(const basic_kin::BasicKin &kin);
+
+  /** @brief Sets the solver parameters */
+  void setParameters(const Parameters &params) { params_ = params; }
+
+  /** @brief The solver parameters */
+  const Parameters& getParameters() const { return params_; }
+
+  /** @brief Whether init() succeeded */
+  bool checkInitialized() const { return initialized_; }
+
+  /**
+   * @brief Solves the problems
+   * @param goals         The tool poses in the base frame of the chain
+   * @param seeds         The seed joint values [num_joints][num_goals], or a single column shared by every problem
+   * @param joint_angles  Returns the solutions [num_joints][num_goals], the last iterate of the problems that did not
+   *                      converge
+   * @param converged     Returns whether each problem converged
+   * @return The number of problems that converged
+   */
+  std::size_t solve(const PoseVector &goals, const Eigen::MatrixXd &seeds, Eigen::MatrixXd &joint_angles,
+                    std::vector<bool> &converged) const;
+
+private:
+  typedef Eigen::Array<double, LANES, 1> Lanes;  /**< One value per problem of a block */
+  typedef Eigen::Array<bool, LANES, 1> Mask;     /**< One flag per problem of a block */
+  typedef std::vector<Lanes, Eigen::aligned_allocator<Lanes> > LanesVector;
+
+  typedef basic_kin::BasicKin::ChainSegment ChainSegment;
+
+  /**
+   * @brief Computes the tip pose and the Jacobian of the problems of a block
+   * @param q           The joint values [num_joints]
+   * @param rotation    Returns the tip rotation, row major [9]
+   * @param translation Returns the tip translation [3]
+   * @param jacobian    Returns the Jacobian at the tip, row major [6 * num_joints]
+   */
+  void calcKinematics(const LanesVector &q, Lanes *rotation, Lanes *translation, LanesVector &jacobian) const;
+
+  /**
+   * @brief Solves the problems of a block
+   * @param first         The index of the first problem of the block
+   * @param count         The number of problems of the block, at most LANES
+   * @param goals         The tool poses
+   * @param seeds         The seed joint values
+   * @param joint_angles  The solutions, the columns of the block are written
+   * @param converged     The convergence flags, the entries of the block are written
+   */
+  void solveBlock(std::size_t first, std::size_t count, const PoseVector &goals, const Eigen::MatrixXd &seeds,
+                  Eigen::MatrixXd &joint_angles, std::vector<bool> &converged) const;
+
+  bool initialized_;                           /**< True if init() succeeded */
+  int num_joints_;                             /**< The number of joints of the chain */
+  std::vector<ChainSegment> segments_;         /**< The segments of the chain */
+  Eigen::Matrix<double, Eigen::Dynamic, 2> joint_limits_; /**< The lower and upper limit of each joint */
+  Parameters params_;                          /**< The solver parameters */
+};
+
+} // namespace constrained_ik
+
+#endif // BATCH_IK_H
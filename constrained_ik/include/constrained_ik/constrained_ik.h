@@ -29,10 +29,14 @@
 #include "constrained_ik/basic_kin.h"
 #include "constraint_group.h"
 #include "solver_state.h"
+#include "solver_telemetry.h"
+#include "solver_trace.h"
 #include "constrained_ik/constrained_ik_utils.h"
 #include <string>
+#include <vector>
 #include <Eigen/Core>
 #include <Eigen/Geometry>
+#include <Eigen/StdVector>
 #include <urdf/model.h>
 #include <constrained_ik/enum_types.h>
 #include <moveit/planning_scene/planning_scene.h>
@@ -52,6 +56,11 @@ enum SolverStatus
 
 /**
  * @brief Damped Least-Squares Inverse Kinematic Solution
+ *
+ * Once initialized and configured the solver is reentrant, calcInvKin() and calcInvKinBatch() may be called
+ * concurrently from any number of threads on the same instance.  Everything a solve modifies lives in its SolverState
+ * and in the ConstraintData the constraints create per evaluation, a SceneContext must not be shared by concurrent
+ * solves.  The configuration and the constraint lists must not be changed while solves are running.
  * @todo Remove calcNullspaceProjection function and rename calcNullspaceProjectionTheRightWay to calcNullspaceProjection
  */
 class Constrained_IK
@@ -95,12 +104,16 @@ public:
   /**
    * @brief Add constraints from the ROS Parameter Server
    * This allows for the constraints to be defined in a yaml file and loaded
-   * at runtime using the plugin interface.
+   * at runtime using the plugin interface.  The plugin loader and the constraints read for a parameter name are kept
+   * in a process wide registry, later calls with the same parameter name do not query the parameter server again.
    * @param parameter_name the complete parameter name on the ROS parameter server
    * Example: parameter_name="/namespace/namespace2/array_parameter"
    */
   virtual void addConstraintsFromParamServer(const std::string &parameter_name);
 
+  /** @brief Forget the constraints read by addConstraintsFromParamServer so that they are read again on the next call */
+  static void clearConstraintRegistry();
+
   /**
    * @brief computes the inverse kinematics for the given pose of the tip link
    * @param goal cartesian pose to solve the inverse kinematics about
@@ -127,6 +140,46 @@ public:
                           const planning_scene::PlanningSceneConstPtr planning_scene,
                           Eigen::VectorXd &joint_angles) const;
 
+  /**
+   * @brief computes the inverse kinematics for the given pose of the tip link
+   * @param goal cartesian pose to solve the inverse kinematics about
+   * @param joint_seed joint values that is used as the initial guess
+   * @param scene_context the planning scene objects created by createSceneContext(), reused across calls to avoid
+   *            copying the robot state on every solve; if a null pointer is passed then collisions are ignored.
+   * @param joint_angles The joint pose that places the tip link to the desired pose.
+   * @return True if valid IK solution is found, otherwise false
+   */
+  virtual bool calcInvKin(const Eigen::Affine3d &goal,
+                          const Eigen::VectorXd &joint_seed,
+                          const constrained_ik::SceneContextPtr &scene_context,
+                          Eigen::VectorXd &joint_angles) const;
+
+  /**
+   * @brief Checks that the planning scene uses a supported collision detector and creates the objects the solver
+   * derives from it.  The context remains valid until the scene is modified.
+   * @param planning_scene pointer to a planning scene
+   * @return The scene context, a null pointer if the planning scene is a null pointer
+   * @throw std::runtime_error if the active collision detector of the scene is not supported
+   */
+  virtual constrained_ik::SceneContextPtr createSceneContext(const planning_scene::PlanningSceneConstPtr planning_scene) const;
+
+  /**
+   * @brief computes the inverse kinematics for a sequence of poses of the tip link, for instance the waypoints of a
+   * cartesian path.  The inputs are validated and the solver state (planning scene, robot state and distance cache)
+   * is set up once for the whole sequence, each pose is seeded with the solution of the previous one.
+   * @param goals cartesian poses to solve the inverse kinematics about, in order
+   * @param joint_seed joint values that is used as the initial guess of the first pose
+   * @param planning_scene pointer to a planning scene that holds all the object in the environment.  Use by the solver to check for collision; if
+   *            a null pointer is passed then collisions are ignored.
+   * @param joint_angles The joint poses that place the tip link to the desired poses, it holds the solutions of the
+   *            poses solved before the first failure.
+   * @return True if a valid IK solution is found for every pose, otherwise false
+   */
+  virtual bool calcInvKinBatch(const std::vector<Eigen::Affine3d, Eigen::aligned_allocator<Eigen::Affine3d> > &goals,
+                               const Eigen::VectorXd &joint_seed,
+                               const planning_scene::PlanningSceneConstPtr planning_scene,
+                               std::vector<Eigen::VectorXd> &joint_angles) const;
+
   /**
    * @brief Checks to see if object is initialized (ie: init() has been called)
    * @return InitializationState
@@ -189,6 +242,31 @@ public:
    */
   virtual void setSolverConfiguration(const ConstrainedIKConfiguration &config);
 
+  /**
+   * @brief Setter for the trace recording the iterations of the solves, the records are only made when the package is
+   * built with the CONSTRAINED_IK_TRACE option
+   * @param trace the trace shared by the solves, a null pointer disables the recording
+   */
+  virtual void setTrace(const constrained_ik::SolverTracePtr &trace) { trace_ = trace; }
+
+  /**
+   * @brief Getter for the trace recording the iterations of the solves
+   * @return The trace, a null pointer if none was set
+   */
+  virtual constrained_ik::SolverTracePtr getTrace() const { return trace_; }
+
+  /**
+   * @brief Setter for the telemetry aggregating the timings, iterations and termination reasons of the solves
+   * @param telemetry the telemetry shared by the solves, a null pointer disables the recording
+   */
+  virtual void setTelemetry(const constrained_ik::SolverTelemetryPtr &telemetry) { telemetry_ = telemetry; }
+
+  /**
+   * @brief Getter for the telemetry aggregating the timings, iterations and termination reasons of the solves
+   * @return The telemetry, a null pointer if none was set
+   */
+  virtual constrained_ik::SolverTelemetryPtr getTelemetry() const { return telemetry_; }
+
   /** @brief This will load the default solver configuration parameters. */
   virtual void loadDefaultSolverConfiguration();
 
@@ -233,6 +311,18 @@ public:
    */
   virtual Eigen::MatrixXd calcDampedPseudoinverse(const Eigen::MatrixXd &J) const;
 
+  /**
+   * @brief Calculate the damped pseudo inverse of the primary jacobian and the projection onto its null space from a
+   * single decomposition of the jacobian, using the decomposition selected in the solver configuration.  The 6x6 and
+   * 6x7 jacobians of 6 and 7 dof arms are decomposed with fixed size matrices that do not allocate memory.
+   * @param J primary jacobian to compute the inverse and null space projection of
+   * @param J_pinv damped pseudo inverse of J
+   * @param N null space projection matrix of J, only computed if compute_nullspace is true
+   * @param compute_nullspace whether to compute N
+   * @return True if the decomposition succeeded, otherwise false
+   */
+  virtual bool calcPrimaryPseudoinverse(const Eigen::MatrixXd &J, Eigen::MatrixXd &J_pinv, Eigen::MatrixXd &N, bool compute_nullspace) const;
+
   /**
    * @brief Check if solver has been initialized
    * @return True if initialized, otherwise false
@@ -243,6 +333,8 @@ public:
   // solver configuration parameters
   ros::NodeHandle nh_;                /**< ROS node handle */
   ConstrainedIKConfiguration config_; /**< Solver configuration parameters */
+  constrained_ik::SolverTracePtr trace_; /**< Trace of the solver iterations */
+  constrained_ik::SolverTelemetryPtr telemetry_; /**< Statistics of the solves */
 
   // constraints
   ConstraintGroup primary_constraints_;   /**< Array of primary constraints */
@@ -260,6 +352,18 @@ public:
    */
   virtual constrained_ik::ConstraintResults evalConstraint(constraint_types::ConstraintTypes constraint_type, const constrained_ik::SolverState &state) const;
 
+  /**
+   * @brief Calculating error, jacobian & status for all constraints specified into existing results, their storage is
+   * reused when the number of rows does not change.
+   * @param constraint_type Contraint type (primary or auxiliary)
+   * @param state The state of the current solver
+   * @param output The stacked results of the constraints
+   * @param results The results of each constraint, kept across the iterations of a solve
+   */
+  virtual void evalConstraint(constraint_types::ConstraintTypes constraint_type, const constrained_ik::SolverState &state,
+                              constrained_ik::ConstraintResults &output,
+                              std::vector<constrained_ik::ConstraintResults> &results) const;
+
   /**
    * @brief This function clips the joints within the joint limits.
    * @param joints a Eigen::VectorXd passed by reference
@@ -284,6 +388,39 @@ public:
    */
   virtual constrained_ik::SolverState getState(const Eigen::Affine3d &goal, const Eigen::VectorXd &joint_seed) const;
 
+  /**
+   * @brief Computes the Levenberg-Marquardt step of the primary constraints, the damped least squares solution of
+   * J*step = error.  The normal equations of the smaller dimension of J are factorized.
+   * @param J primary jacobian
+   * @param error primary error
+   * @param damping damping added to the diagonal of the normal equations
+   * @param step the joint step
+   */
+  virtual void calcDampedLeastSquaresStep(const Eigen::MatrixXd &J, const Eigen::VectorXd &error, double damping, Eigen::VectorXd &step) const;
+
+  /**
+   * @brief Sets up the initialization condition, planning scene, robot state, collision pointers and distance cache
+   * of a SolverState created by getState().
+   * @param state solver state to set up
+   * @param scene_context the planning scene objects, if a null pointer is passed then collisions are ignored.
+   */
+  virtual void initSolverState(constrained_ik::SolverState &state, const constrained_ik::SceneContextPtr &scene_context) const;
+
+  /**
+   * @brief Iterates from the seed of a set up SolverState until the solver converges or fails.
+   * @param state solver state, set up by initSolverState()
+   * @param joint_angles The joint pose that places the tip link to the goal of the state, the seed on failure.
+   * @return True if valid IK solution is found, otherwise false
+   */
+  virtual bool solveState(constrained_ik::SolverState &state, Eigen::VectorXd &joint_angles) const;
+
+  /**
+   * @brief The parts of the solver state read by the active constraints
+   * @param condition initialization state of the solve, the auxiliary constraints are active for PrimaryAndAuxiliary
+   * @return A combination of StateRequirements flags
+   */
+  virtual unsigned int getStateRequirements(initialization_state::InitializationState condition) const;
+
   /**
    * @brief Method update an existing SolverState provided
    * new joint positions.
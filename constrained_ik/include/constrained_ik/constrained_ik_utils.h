@@ -29,6 +29,7 @@
 #include <XmlRpc.h>
 #include <eigen3/Eigen/Core>
 #include <constrained_ik/CLIKDynamicConfig.h>
+#include <constrained_ik/enum_types.h>
 
 namespace constrained_ik
 {
@@ -52,6 +53,10 @@ namespace constrained_ik
     double primary_gain;               /**< Solver's primary motion update gain. */
     double auxiliary_gain;             /**< Solver's auxiliary motion update gain. */
     double joint_convergence_tol;      /**< Solver's joint convergence tolerance. */
+    SolverDecomposition primary_decomposition; /**< Decomposition used to invert the primary jacobian and compute its null space. */
+    bool parallel_constraint_evaluation; /**< Evaluate the constraints of each group concurrently. */
+    bool primary_adaptive_damping;     /**< Compute the primary step with adaptive damping and a backtracking line search. */
+    double auxiliary_min_improvement;  /**< Converge once the primary converged and the auxiliary error improves less than this ratio per iteration, disabled if zero. */
   };
 
   /**
@@ -87,6 +92,15 @@ namespace constrained_ik
    */
   bool getParam(XmlRpc::XmlRpcValue& config, const std::string& key, double& value);
 
+  /**
+   * @brief Get parameter from XmlRPCValue as int
+   * @param config available parameters
+   * @param key name of parameter to find
+   * @param value populate results found in config
+   * @return True if parameter was found in config, otherwise false
+   */
+  bool getParam(XmlRpc::XmlRpcValue& config, const std::string& key, int& value);
+
   /**
    * @brief Get parameter from XmlRPCValue as a vector of double's
    * @param config available parameters
@@ -71,12 +71,20 @@ public:
   Constraint() : initialized_(false), debug_(false) {}
 
   /**
-   * @brief Pure definition for calculating constraint error, jacobian & status
+   * @brief Pure definition for calculating constraint error, jacobian & status.  It is called concurrently by the
+   * solves sharing a solver, the values it computes belong in a ConstraintData local to the call.
    * @param state solvers current state
    * @return ConstraintResults
    */
   virtual constrained_ik::ConstraintResults evalConstraint(const SolverState &state) const = 0;
 
+  /**
+   * @brief The parts of the solver state the constraint reads, the solver only updates the robot state of the
+   * planning scene when an active constraint requires it.  Constraints that read state.robot_state must override it.
+   * @return A combination of StateRequirements flags
+   */
+  virtual unsigned int getStateRequirements() const { return state_requirements::PoseEstimate; }
+
   /**
    * @brief Initialize constraint and should be called by any inheriting classes
    * @param ik Pointer to Constrained_IK
@@ -89,6 +97,19 @@ public:
    */
   virtual void loadParameters(const XmlRpc::XmlRpcValue &constraint_xml) {}
 
+  /**
+   * @brief Whether the jacobian of the constraint does not depend on the solver state.  It is then computed once by
+   * init(), and every iteration only computes the error.
+   * @return True if the constraint stores a constant jacobian, otherwise false
+   */
+  virtual bool hasConstantJacobian() const { return constant_jacobian_.rows() != 0; }
+
+  /**
+   * @brief The state independent jacobian stored by init(), see hasConstantJacobian()
+   * @return The jacobian, empty if it depends on the state
+   */
+  const Eigen::MatrixXd& getConstantJacobian() const { return constant_jacobian_; }
+
   /**
    * @brief set debug mode
    * @param debug Value to set debug_ to (defaults to true)
@@ -99,6 +120,8 @@ protected:
   bool initialized_;         /**< True if solver is intialized, otherwise false */
   bool debug_;               /**< Provide control over if certain print statements are output */
   const Constrained_IK* ik_; /**< Pointer to parent solver */
+  Eigen::MatrixXd constant_jacobian_;           /**< The state independent jacobian, empty if it depends on the state */
+  std::vector<int> constant_selected_joints_;   /**< The joint selected by each row of constant_jacobian_, empty if they are not selector rows */
 
   /**
    * @brief Returns the number of joints
@@ -106,6 +129,28 @@ protected:
    */
   virtual int numJoints() const;
 
+  /**
+   * @brief The jacobian of the tip link at the joints of the state.  It is the jacobian computed once per iteration by
+   * the solver when the constraint requires state_requirements::Jacobian, otherwise it is computed.
+   * @param state solvers current state
+   * @return The jacobian
+   * @throw std::runtime_error if the jacobian could not be calculated
+   */
+  Eigen::MatrixXd calcToolJacobian(const SolverState &state) const;
+
+  /**
+   * @brief Stores the weighted identity as the constant jacobian, of the constraints acting on every joint directly.
+   * It must be called by init() and again whenever the weight changes after it.
+   * @param weight The weight of every row
+   */
+  void setConstantJointJacobian(double weight);
+
+  /**
+   * @brief Writes the constant jacobian and its selected joints into the results
+   * @param output The results of the constraint
+   */
+  void assignConstantJacobian(ConstraintResults &output) const;
+
 }; // class Constraint
 
 
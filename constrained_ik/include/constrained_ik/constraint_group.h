@@ -31,6 +31,7 @@
 #include <constrained_ik/constraint.h>
 #include <constrained_ik/constraint_results.h>
 #include <boost/ptr_container/ptr_vector.hpp>
+#include <vector>
 
 namespace constrained_ik
 {
@@ -46,6 +47,21 @@ public:
   /** @brief See base clase for documentation */
   ConstraintResults evalConstraint(const SolverState &state) const override;
 
+  /**
+   * @brief Calculate the stacked error, jacobian & status of all constraints in the group.  The constraints are evaluated
+   * into 'results' first and the output is then resized once to the total number of rows, reusing its storage if the
+   * size is unchanged.
+   * @param state solvers current state
+   * @param output stacked results of the constraints
+   * @param results the results of each constraint, kept by the caller so that they are not reallocated by every
+   * iteration of a solve
+   */
+  virtual void evalConstraint(const SolverState &state, ConstraintResults &output,
+                              std::vector<ConstraintResults> &results) const;
+
+  /** @brief The combination of the state requirements of the constraints in the group */
+  unsigned int getStateRequirements() const override;
+
   /** @brief See base clase for documentation */
   void init(const Constrained_IK* ik) override;
 
@@ -58,6 +74,21 @@ public:
   /** @brief Remove all constraints from the group */
   virtual void clear() { constraints_.clear(); }
 
+  /**
+   * @brief Evaluate the constraints of the group concurrently on the threads of the collision_detection::QueryThreadPool,
+   * the results are stacked in the order the constraints were added.  The constraints only read the solver state, except
+   * for the distance cache used by the constraints that require the collision scene, those are evaluated one after the
+   * other by the calling thread.  The group is evaluated on the calling thread alone while the pool is busy.
+   * @param parallel True to evaluate the constraints concurrently, otherwise false
+   */
+  virtual void setParallelEvaluation(bool parallel) { parallel_ = parallel; }
+
+  /**
+   * @brief Check if the constraints of the group are evaluated concurrently.
+   * @return True if the constraints are evaluated concurrently, otherwise false
+   */
+  virtual bool isParallelEvaluation() const { return parallel_; }
+
   /**
    * @brief Check if the constraint group is empty.
    * @return True if empty, otherwise false
@@ -66,6 +97,7 @@ public:
 
 protected:
   boost::ptr_vector<Constraint> constraints_; /**< Vector of constaints in the group */
+  bool parallel_;                             /**< Evaluate the constraints concurrently */
 
 }; // class ConstraintGroup
 
@@ -28,6 +28,7 @@
 
 #include <ros/ros.h>
 #include <Eigen/Core>
+#include <vector>
 
 namespace constrained_ik
 {
@@ -45,17 +46,76 @@ namespace constrained_ik
 
     bool status;              /**< Current status of the constraint, True Converged, False Not Converged */
 
+    /**
+     * @brief The joint selected by each row of the jacobian when every row is a weighted selector row, that is
+     * jacobian.row(k) is zero except for jacobian(k, selected_joints[k]).  The solver then uses the structure instead of
+     * dense products.  It is left empty by the constraints that produce other rows.
+     */
+    std::vector<int> selected_joints;
+
+    /**
+     * @brief Check if every row of the jacobian selects a single joint, see selected_joints
+     * @return True if the result is not empty and all its rows are selector rows, otherwise false
+     */
+    bool isJointSelector() const
+    {
+      return error.rows() != 0 && jacobian.rows() != 0 && static_cast<int>(selected_joints.size()) == jacobian.rows();
+    }
+
     /**
      * @brief Append the provided result this result
      * @param cdata ConstraintResults to append
      */
     virtual void append(const ConstraintResults &cdata)
     {
+      if (cdata.error.rows() != 0 && cdata.jacobian.rows() != 0)
+      {
+        if ((isEmpty() || isJointSelector()) && cdata.isJointSelector())
+          selected_joints.insert(selected_joints.end(), cdata.selected_joints.begin(), cdata.selected_joints.end());
+        else
+          selected_joints.clear();
+      }
       appendError(cdata.error);
       appendJacobian(cdata.jacobian);
       status &= cdata.status;
     }
 
+    /**
+     * @brief Resize the error and jacobian to hold the stacked results of several constraints and reset the status.
+     * The storage is reused when the size does not change, the results are then written with assign().
+     * @param rows total number of rows of the constraints to stack
+     * @param cols number of columns of the jacobians
+     */
+    virtual void resize(int rows, int cols)
+    {
+      error.resize(rows);
+      jacobian.resize(rows, cols);
+      selected_joints.clear();
+      status = true;
+    }
+
+    /**
+     * @brief Write the provided result into the rows starting at row, the rows must have been allocated with resize()
+     * @param row first row of this result that receives the provided result
+     * @param cdata ConstraintResults to write
+     */
+    virtual void assign(int row, const ConstraintResults &cdata)
+    {
+      if (cdata.error.rows() != 0 && cdata.jacobian.rows() != 0)
+      {
+        ROS_ASSERT(jacobian.cols() == cdata.jacobian.cols());
+        error.segment(row, cdata.error.rows()) = cdata.error;
+        jacobian.middleRows(row, cdata.jacobian.rows()) = cdata.jacobian;
+
+        // the rows stay a selector as long as all the rows written so far are
+        if (static_cast<int>(selected_joints.size()) == row && cdata.isJointSelector())
+          selected_joints.insert(selected_joints.end(), cdata.selected_joints.begin(), cdata.selected_joints.end());
+        else
+          selected_joints.clear();
+      }
+      status &= cdata.status;
+    }
+
     /**
      * @brief Check if empty
      * @return True if empty, otherwise false
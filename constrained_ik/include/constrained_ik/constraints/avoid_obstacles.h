@@ -30,10 +30,11 @@
 #include "constrained_ik/constraint.h"
 #include "constrained_ik/constrained_ik.h"
 #include <industrial_collision_detection/collision_detection/collision_common.h>
+#include <industrial_collision_detection/collision_detection/robot_sphere_model.h>
 #include <vector>
 #include <algorithm>
+#include <mutex>
 #include <kdl/chain.hpp>
-#include <kdl/chainjnttojacsolver.hpp>
 
 namespace constrained_ik
 {
@@ -62,8 +63,6 @@ protected:
 
     LinkAvoidance();
 
-    virtual ~LinkAvoidance() {delete jac_solver_;}
-
     double weight_; /**< importance weight applied to this avoidance constraint */
     double min_distance_; /**< minimum obstacle distance allowed for convergence */
     double avoidance_distance_; /**< distance at which to start avoiding the obstacle */
@@ -71,17 +70,31 @@ protected:
     int num_robot_joints_; /**< number of joints in the whole robot*/
     int num_obstacle_joints_; /**< number of joints inboard to the obstacle link */
     std::string link_name_; /**< the name of the link that is to avoid obstacles */
+    int link_index_; /**< the index of the link in the robot model, -1 if it is not part of the group */
     KDL::Chain avoid_chain_; /**< the kinematic chain from base to the obstacle avoidance link */
     int num_inboard_joints_; /**< number of joints in the inboard chain */
     KDL::Vector link_point_; /**< vector to point on link closest to an obstacle */
-    KDL::ChainJntToJacSolver * jac_solver_; /**< a KDL object for computing jacobians */
     KDL::Vector obstacle_point_; /**< vector to point on link closest to an obstacle */
   };
 
   std::map<std::string, LinkAvoidance> links_; /**< @brief map from link name to its avoidance data */
   std::vector<std::string> link_names_; /**< @brief list of links that should avoid obstacles */
   std::set<const robot_model::LinkModel *> link_models_; /**< @brief a set of LinkModel for each link in link_names_ */
+  std::vector<bool> link_mask_; /**< @brief the links of link_models_ as bits indexed by link index, see DistanceRequest::active_links */
+  collision_detection::DistanceRequest distance_request_; /**< @brief the distance request of the links prepared by init(), each evaluation sets the fields of its scene */
   double distance_threshold_; /**< @brief a distance threshold used to speed up distance queries */
+  double lod_margin_; /**< @brief the distance beyond which the coarse link meshes are used, see DistanceRequest::lod_margin */
+  bool sphere_fast_path_; /**< @brief whether the links far from the world are skipped using their spheres, see DistanceRequest::sphere_model */
+  int distance_threads_; /**< @brief the number of threads sharing the links of a world query, see DistanceRequest::num_threads */
+  mutable collision_detection::RobotSphereModelConstPtr sphere_model_; /**< @brief the spheres of the robot links, created on first use */
+  mutable std::mutex sphere_model_mutex_; /**< @brief guards the creation of sphere_model_ */
+
+  /**
+   * @brief Get the sphere model of the robot, it is loaded from the default cache directory or generated on first use
+   * @param model The robot model
+   * @return The sphere model, NULL if the fast path is disabled
+   */
+  const collision_detection::RobotSphereModel* getSphereModel(const robot_model::RobotModelConstPtr &model) const;
 
   /**
    * @brief Get a links avoidance data
@@ -131,14 +144,28 @@ public:
     EIGEN_MAKE_ALIGNED_OPERATOR_NEW
     const constraints::AvoidObstacles* parent_; /**< pointer to parent class AvoidObstacles */
     collision_detection::DistanceResult distance_res_; /**< stores the minimum distance results */
-    collision_detection::DistanceMap distance_map_; /**< map of link names to its distance results */
-    collision_detection::DistanceInfoMap distance_info_map_; /**< map of link names to distance information */
+    collision_detection::DistanceInfoVector distance_info_; /**< distance information indexed by link index */
+    Eigen::MatrixXd root_jacobian_; /**< jacobian of the chain referenced to the base origin, set when a link is within the distance threshold */
 
     /** @brief See base class for documentation */
     AvoidObstaclesData(const constrained_ik::SolverState &state, const constraints::AvoidObstacles* parent);
+
+    /**
+     * @brief Get the distance information of a link
+     * @param link The link to look up
+     * @return The distance information or NULL if the link is not within the distance threshold
+     */
+    const collision_detection::DistanceInfo* getDistanceInfo(const LinkAvoidance &link) const
+    {
+      if (link.link_index_ < 0 || link.link_index_ >= static_cast<int>(distance_info_.size()) ||
+          distance_info_[link.link_index_].distance == std::numeric_limits<double>::max())
+        return NULL;
+
+      return &distance_info_[link.link_index_];
+    }
   };
 
-  AvoidObstacles() {}
+  AvoidObstacles(): lod_margin_(std::numeric_limits<double>::max()), sphere_fast_path_(false), distance_threads_(1) {}
 
   /**
    * @brief Initialize constraint (overrides Constraint::init)
@@ -153,6 +180,12 @@ public:
   /** @brief see base class for documentation*/
   void loadParameters(const XmlRpc::XmlRpcValue &constraint_xml) override;
 
+  /** @brief The distance queries need the link and collision body transforms of the robot state */
+  unsigned int getStateRequirements() const override
+  {
+    return state_requirements::LinkTransforms | state_requirements::CollisionScene;
+  }
+
   /**
    * @brief Creates Jacobian for avoiding a collision with link closest to a collision
    * @param cdata The constraint specific data.
@@ -89,7 +89,7 @@ public:
   /**@brief setter for weight_
    * @param weight Value to set weight_ to
    */
-  virtual void setWeight(double weight) {weight_ = weight;}
+  virtual void setWeight(double weight);
 
 protected:
   double weight_; /**< @brief weights used to scale the jocabian and error */
@@ -59,6 +59,9 @@ public:
   /** @brief see base class for documentation*/
   constrained_ik::ConstraintResults evalConstraint(const SolverState &state) const override;
 
+  /** @brief The constraint reads the jacobian of the tip link */
+  unsigned int getStateRequirements() const override { return state_requirements::Jacobian; }
+
   /** @brief see base class for documentation*/
   void loadParameters(const XmlRpc::XmlRpcValue &constraint_xml) override;
 
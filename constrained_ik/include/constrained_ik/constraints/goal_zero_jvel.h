@@ -46,6 +46,14 @@ public:
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
   GoalZeroJVel();
 
+  /**
+   * @brief Initialize constraint (overrides Constraint::init)
+   * Stores the constant jacobian.
+   * Should be called before using class.
+   * @param ik Pointer to Constrained_IK used for base-class init
+   */
+  void init(const Constrained_IK *ik) override;
+
   /** @brief see base class for documentation*/
   constrained_ik::ConstraintResults evalConstraint(const SolverState &state) const override;
 
@@ -83,7 +91,7 @@ public:
    * @brief setter for weight_
    * @param weight Value to set weight_ to
    */
-  virtual void setWeight(double weight) {weight_ = weight;}
+  virtual void setWeight(double weight);
 
 protected:
   double weight_; /**< @brief weights used to scale the jocabian and error */
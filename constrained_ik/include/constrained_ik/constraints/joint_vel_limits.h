@@ -71,6 +71,13 @@ public:
   /** @brief See base class for documentation */
   constrained_ik::ConstraintResults evalConstraint(const SolverState &state) const override;
 
+  /**
+   * @brief The rows of the jacobian are those of the limited joints, selected per state from the constant weighted
+   * identity stored by init()
+   * @return False
+   */
+  bool hasConstantJacobian() const override { return false; }
+
   /** @brief See base class for documentation */
   void loadParameters(const XmlRpc::XmlRpcValue &constraint_xml) override;
 
@@ -109,7 +116,7 @@ public:
    * @brief setter for weight_
    * @param weight Value to set weight_ to
    */
-  virtual void setWeight(const double &weight) {weight_ = weight;}
+  virtual void setWeight(const double &weight);
 
   /**
    * @brief getter for timestep_
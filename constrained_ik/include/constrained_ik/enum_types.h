@@ -114,7 +114,32 @@ namespace constrained_ik
     };
   }// namespace initialization_state
 
+  namespace solver_decompositions
+  {
+    /** @brief Enum that identifies the decomposition used to invert the primary jacobian. */
+    enum SolverDecomposition
+    {
+      JacobiSvd,      /**< Two-sided Jacobi SVD, the most accurate and the slowest */
+      BdcSvd,         /**< Divide and conquer SVD, faster than Jacobi SVD for larger jacobians */
+      DampedCholesky, /**< Cholesky factorization of the damped normal equations, fastest for small well conditioned jacobians */
+    };
+  }// namespace solver_decompositions
+
+  namespace state_requirements
+  {
+    /** @brief Flags that identify the parts of the solver state a constraint reads besides the joints and pose estimate. */
+    enum StateRequirements
+    {
+      PoseEstimate = 0,        /**< Only the joints and the forward kinematics of the tip link */
+      LinkTransforms = 1 << 0, /**< The link transforms of the robot state */
+      CollisionScene = 1 << 1, /**< The collision body transforms of the robot state used by collision and distance queries */
+      Jacobian = 1 << 2,       /**< The jacobian of the tip link at the joints, computed once per iteration and shared */
+    };
+  }// namespace state_requirements
+
   typedef constraint_types::ConstraintTypes ConstraintTypes;             /**< Typedef for ConstraintTypes in constrained_ik namespace */
   typedef initialization_state::InitializationState InitializationState; /**< Typedef for InitializationState in constrained_ik namespace */
+  typedef solver_decompositions::SolverDecomposition SolverDecomposition; /**< Typedef for SolverDecomposition in constrained_ik namespace */
+  typedef state_requirements::StateRequirements StateRequirements;       /**< Typedef for StateRequirements in constrained_ik namespace */
 }// namespace constrained_ik
 #endif // ENUM_TYPES_H
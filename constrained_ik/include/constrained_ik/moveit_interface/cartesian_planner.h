@@ -35,12 +35,18 @@
 #include <moveit/planning_interface/planning_interface.h>
 #include <moveit/planning_scene/planning_scene.h>
 #include <boost/atomic.hpp>
+#include <functional>
 #include <constrained_ik/constrained_ik.h>
+#include <industrial_trajectory_utils/shared_trajectory.h>
+#include <industrial_trajectory_utils/trajectory_decimation.h>
 
 namespace constrained_ik
 {
   const double DEFAULT_TRANSLATIONAL_DISCRETIZATION_STEP = 0.01;
   const double DEFAULT_ORIENTATIONAL_DISCRETIZATION_STEP = 0.01;
+  const double DEFAULT_MAX_JOINT_STEP = 0.05;
+  const unsigned ADAPTIVE_COARSE_STEP_FACTOR = 8; /**< Ratio between the regular and the initial adaptive discretization */
+  const unsigned DEFAULT_STREAMING_CHUNK_SIZE = 50; /**< Number of solved waypoints handed out at once in streaming mode */
 
   /**
   * @brief Cartesian path planner for moveit.
@@ -50,12 +56,32 @@ namespace constrained_ik
   * planner does not have the inherent ability to avoid collision. It does
   * check if the path created is collision free before it returns a trajectory.
   * If a collision is found it returns an empty trajectory and moveit error.
+  *
+  * In adaptive mode the path is first sampled with steps ADAPTIVE_COARSE_STEP_FACTOR times larger
+  * than the discretization, a segment is then subdivided down to the discretization as long as
+  * its IK solve fails or a joint moves more than the max joint step over it.
+  *
+  * The output waypoints that the joint interpolation of their neighbors reproduces within the decimation tolerances
+  * are removed, see trajectory::decimateTrajectory().  The tip link deviation and the validity of the
+  * interpolated states are checked where the removed waypoints were.
+  *
+  * In streaming mode the validated waypoints are handed out in chunks while the rest of the path is solved, so that the
+  * execution of the start of a long path can begin early, see setStreamingCallback().
    */
   class CartesianPlanner : public planning_interface::PlanningContext
   {
   public:
     EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
+    /**
+     * @brief Receives the chunks of the trajectory in order during a solve.  Every chunk starts with the last waypoint
+     * of the previous one, the first chunk with the start state.  The chunks are decimated on their own.
+     * @param chunk the validated waypoints solved since the previous chunk
+     * @param last true for the chunk that ends at the goal, it is only handed out if the solve succeeds
+     * @return False to stop the solve, it then fails as if it was terminated
+     */
+    typedef std::function<bool (const robot_trajectory::RobotTrajectory &chunk, bool last)> TrajectoryChunkCallback;
+
     /**
      * @brief CartesianPlanner Constructor
      * @param name of planner
@@ -70,7 +96,8 @@ namespace constrained_ik
     CartesianPlanner(const CartesianPlanner &other) : planning_interface::PlanningContext(other),
       terminate_(false),
       robot_description_(robot_description_),
-      solver_(solver_) {}
+      solver_(solver_),
+      telemetry_publisher_(other.telemetry_publisher_) {}
 
     /** @brief Clear planner data */
     void clear() override { terminate_ = false; }
@@ -99,6 +126,24 @@ namespace constrained_ik
      */
     bool solve(planning_interface::MotionPlanDetailedResponse &res) override;
 
+    /**
+     * @brief Solves a cartesian path through several waypoints in the planning scene of the planner.  The waypoints
+     * are first solved one after the other, each seeded with the solution of the previous one.  The segments in between
+     * consecutive waypoints are then interpolated with the planner discretization and solved concurrently, each seeded
+     * with the solution of its first waypoint.  The segments are stitched together and every waypoint must be valid
+     * and move the joints no more than the max joint step from the previous one.
+     * @param start_state state the path starts from
+     * @param waypoints poses of the tip link in the planning frame, in order
+     * @param joint_path the joint values of the group along the path, starting with the ones of the start state
+     * @param error_code SUCCESS, TIMED_OUT if the allowed planning time of the request (if set) was exceeded, otherwise
+     *            INVALID_MOTION_PLAN
+     * @return True if successful, otherwise false
+     */
+    bool solvePath(const robot_state::RobotState &start_state,
+                   const std::vector<Eigen::Affine3d, Eigen::aligned_allocator<Eigen::Affine3d> > &waypoints,
+                   std::vector<Eigen::VectorXd> &joint_path,
+                   moveit_msgs::MoveItErrorCodes &error_code);
+
     /**
      * @brief This will initialize the solver if it has not all ready
      * @return True if successful, otherwise false
@@ -110,8 +155,24 @@ namespace constrained_ik
      * @param translational_discretization_step Max translational discretization step
      * @param orientational_discretization_step Max orientational discretization step
      * @param debug_mode Set debug state
+     * @param adaptive_discretization Start from a coarse discretization and subdivide where needed
+     * @param max_joint_step Max joint motion in between waypoints before a segment is subdivided in adaptive mode
+     * @param decimation_joint_tolerance Max joint deviation of the output waypoints removed by the decimation, 0 keeps them
+     * @param decimation_cartesian_tolerance Max tip link deviation of the output waypoints removed by the decimation, 0 does
+     *            not check it
+     */
+    void setPlannerConfiguration(double translational_discretization_step, double orientational_discretization_step, bool debug_mode = false,
+                                 bool adaptive_discretization = false, double max_joint_step = DEFAULT_MAX_JOINT_STEP,
+                                 double decimation_joint_tolerance = 0.0, double decimation_cartesian_tolerance = 0.0);
+
+    /**
+     * @brief Enable the streaming mode, the solve hands out the trajectory in chunks as it is solved.  The trajectory of
+     * the response is then the concatenation of the chunks.  A chunk without a following last one must not be executed
+     * to the end once the solve has failed.
+     * @param callback receives the chunks, an empty function disables the streaming mode
+     * @param chunk_size number of solved waypoints per chunk
      */
-    void setPlannerConfiguration(double translational_discretization_step, double orientational_discretization_step, bool debug_mode = false);
+    void setStreamingCallback(const TrajectoryChunkCallback &callback, unsigned chunk_size = DEFAULT_STREAMING_CHUNK_SIZE);
 
     /** @brief Reset the planners configuration to it default settings */
     void resetPlannerConfiguration();
@@ -125,6 +186,19 @@ namespace constrained_ik
     /** @brief Reset the planners IK solver configuration to it default settings */
     void resetSolverConfiguration();
 
+    /**
+     * @brief Getter for the statistics of the IK solves, recorded when the telemetry_period parameter is positive
+     * @return The telemetry, a null pointer if it is disabled
+     */
+    SolverTelemetryPtr getTelemetry() const { return solver_->getTelemetry(); }
+
+    /**
+     * @brief Getter for the trajectory of the last successful solve as matrices, the consumers of the same process read
+     * it without converting the response.  It is never modified, the next solve replaces it.
+     * @return The trajectory, a null pointer if the last solve failed
+     */
+    trajectory::SharedTrajectoryConstPtr getSharedTrajectory() const { return shared_trajectory_; }
+
   private:
     /**
      * @brief Preform position and orientation interpolation between start and stop.
@@ -137,13 +211,50 @@ namespace constrained_ik
     std::vector<Eigen::Affine3d,Eigen::aligned_allocator<Eigen::Affine3d> >
     interpolateCartesian(const Eigen::Affine3d& start, const Eigen::Affine3d& stop, double ds, double dt) const;
 
+    /**
+     * @brief Number of interpolation steps in between start and stop
+     * @param start begining pose of trajectory
+     * @param stop end pose of trajectory
+     * @param ds max cartesian translation interpolation step
+     * @param dt max cartesian orientation interpolation step
+     * @return The number of steps, at least one
+     */
+    unsigned getCartesianSteps(const Eigen::Affine3d& start, const Eigen::Affine3d& stop, double ds, double dt) const;
+
+    /**
+     * @brief Linear position and slerp orientation interpolation between start and stop.
+     * @param start begining pose of trajectory
+     * @param stop end pose of trajectory
+     * @param ratio path ratio in [0, 1]
+     * @return The interpolated pose
+     */
+    Eigen::Affine3d interpolatePose(const Eigen::Affine3d& start, const Eigen::Affine3d& stop, double ratio) const;
+
+    /**
+     * @brief Whether a state is free of collisions and feasible in the planning scene.  With the IndustrialFCL collision
+     * detector the collision check only answers yes or no, it stops at the first colliding pair without computing
+     * contacts, otherwise it falls back to planning_scene::PlanningScene::isStateValid().
+     * @param state the state to check
+     * @param group the group whose links are checked
+     * @param context the scene context of the planning scene, its collision world and robot are used when set
+     * @return True if the state is valid, otherwise false
+     */
+    bool isStateValid(const robot_state::RobotState &state, const std::string &group, const constrained_ik::SceneContextPtr &context) const;
+
     double translational_discretization_step_;    /**< Max translational discretization step */
     double orientational_discretization_step_;    /**< Max orientational discretization step */
+    double max_joint_step_;                       /**< Max joint motion in between waypoints in adaptive mode */
     bool debug_mode_;                             /**< Debug state */
+    bool adaptive_discretization_;                /**< Adaptive discretization state */
+    trajectory::TrajectoryDecimationParameters decimation_; /**< Tolerances of the output waypoint decimation */
+    TrajectoryChunkCallback chunk_callback_;      /**< Receives the trajectory chunks in streaming mode, empty otherwise */
+    unsigned chunk_size_;                         /**< Number of solved waypoints per chunk */
     boost::atomic<bool> terminate_;               /**< Termination flag */
     std::string robot_description_;               /**< robot description value from ros param server */
     robot_model::RobotModelConstPtr robot_model_; /**< Robot model object */
     boost::shared_ptr<Constrained_IK> solver_;    /**< Constrained IK Solver */
+    SolverTelemetryPublisherPtr telemetry_publisher_; /**< Publishes the statistics of the IK solves, null if disabled */
+    trajectory::SharedTrajectoryConstPtr shared_trajectory_; /**< The trajectory of the last solve, null if it failed */
     boost::mutex mutex_;                          /**< Mutex */
   };
 } //namespace constrained_ik
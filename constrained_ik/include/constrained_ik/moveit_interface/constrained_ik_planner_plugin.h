@@ -83,6 +83,14 @@ namespace constrained_ik
     virtual void cartesianDynamicReconfigureCallback(CLIKDynamicConfig &config, uint32_t level, std::string group_name);
 
   protected:
+    /**
+     * @brief Plans a short synthetic joint motion with every planner in an empty planning scene, so that the collision
+     * geometry, the solvers and the allocations are initialized before the first real request.
+     * @param model The robot model
+     * @param allowed_planning_time The time allowed to each synthetic request
+     */
+    void warmUp(const robot_model::RobotModelConstPtr &model, double allowed_planning_time);
+
     typedef dynamic_reconfigure::Server<CLIKPlannerDynamicConfig> ManagerDynReconfigServer;          /**< Type definition for the planning manager dynamic reconfigure server */
     typedef dynamic_reconfigure::Server<CLIKDynamicConfig> CartesianDynReconfigServer;               /**< Type definition for the cartesian planner dynamic reconfigure server */
     typedef boost::shared_ptr<ManagerDynReconfigServer> ManagerDynReconfigServerPtr;                 /**< Type definition for the planning manager dynamic reconfigure server shared pointer*/
@@ -28,12 +28,14 @@
 
 #include "constrained_ik/basic_kin.h"
 #include "constrained_ik/constrained_ik.h"
+#include "constrained_ik/solution_cache.h"
 
 #include <ros/ros.h>
 #include <moveit/robot_model_loader/robot_model_loader.h>
 #include <moveit/kinematics_base/kinematics_base.h>
 #include <moveit/planning_scene/planning_scene.h>
 #include <moveit_msgs/MoveItErrorCodes.h>
+#include <boost/thread/mutex.hpp>
 
 namespace constrained_ik
 {
@@ -84,7 +86,11 @@ namespace constrained_ik
                           moveit_msgs::MoveItErrorCodes &error_code,
                           const kinematics::KinematicsQueryOptions &options = kinematics::KinematicsQueryOptions()) const override;
 
-    /** @brief See base class for documentation */
+    /**
+     * @brief See base class for documentation.  The IK is first solved from the seed, when it fails it is restarted
+     * from random seeds within the consistency limits on a few threads until a solution passes the callback or the
+     * timeout expires.
+     */
     bool searchPositionIK(const geometry_msgs::Pose &ik_pose,
                           const std::vector<double> &ik_seed_state,
                           double timeout,
@@ -99,6 +105,31 @@ namespace constrained_ik
                        const std::vector<double> &joint_angles,
                        std::vector<geometry_msgs::Pose> &poses) const override;
 
+    /**
+     * @brief Solves the IK of many poses concurrently on a few threads, each pose is solved independently from the
+     * seed like getPositionIK() would.
+     * @param ik_poses the poses of the tip link
+     * @param ik_seed_state the seed of every pose
+     * @param solutions the solution of each pose, empty for the poses without a solution
+     * @param error_codes SUCCESS for each pose with a solution, otherwise NO_IK_SOLUTION
+     * @return True if a solution was found for every pose, otherwise false
+     */
+    bool getPositionIKBatch(const std::vector<geometry_msgs::Pose> &ik_poses,
+                            const std::vector<double> &ik_seed_state,
+                            std::vector<std::vector<double> > &solutions,
+                            std::vector<moveit_msgs::MoveItErrorCodes> &error_codes) const;
+
+    /**
+     * @brief Computes the FK of many joint positions concurrently on a few threads
+     * @param link_names the links to compute the poses of, all the links if empty
+     * @param joint_angles the joint positions
+     * @param poses the poses of the links for each joint position
+     * @return True if the FK was computed for every joint position, otherwise false
+     */
+    bool getPositionFKBatch(const std::vector<std::string> &link_names,
+                            const std::vector<std::vector<double> > &joint_angles,
+                            std::vector<std::vector<geometry_msgs::Pose> > &poses) const;
+
     /** @brief See base class for documentation */
     bool initialize(const std::string& robot_description,
                     const std::string& group_name,
@@ -112,8 +143,34 @@ namespace constrained_ik
     /** @brief Return all the link names in the order they are represented internally */
     const std::vector<std::string>& getLinkNames() const override;
 
+    /**
+     * @brief Getter for the statistics of the solves, recorded when the telemetry_period parameter is positive
+     * @return The telemetry, a null pointer if it is disabled
+     */
+    constrained_ik::SolverTelemetryPtr getTelemetry() const { return solver_ ? solver_->getTelemetry() : constrained_ik::SolverTelemetryPtr(); }
+
   protected:
 
+    /**
+     * @brief Solves the IK about the plugin planning scene.  The scene contexts are kept in a pool and reused by the
+     * following calls, concurrent calls each take their own.
+     * @param goal cartesian pose to solve the inverse kinematics about
+     * @param seed joint values that is used as the initial guess
+     * @param joint_angles The joint pose that places the tip link to the desired pose.
+     * @return True if valid IK solution is found, otherwise false
+     */
+    bool calcInvKin(const Eigen::Affine3d &goal, const Eigen::VectorXd &seed, Eigen::VectorXd &joint_angles) const;
+
+    /**
+     * @brief Picks the seed of a solve, the cached solution of the nearest prior pose when that pose is closer to the
+     * goal than the pose of the provided seed and it is within the consistency limits of the provided seed.
+     * @param goal cartesian pose to solve the inverse kinematics about
+     * @param seed joint values provided as the initial guess
+     * @param consistency_limits the maximum distance of each joint from the provided seed, ignored if empty
+     * @return The seed to solve from
+     */
+    Eigen::VectorXd selectSeed(const Eigen::Affine3d &goal, const Eigen::VectorXd &seed, const std::vector<double> &consistency_limits) const;
+
     bool active_;                                     /**< Indicates status of the kinematic solver */
     basic_kin::BasicKin kin_;                         /**< Constrained IK kinematics object */
     int dimension_;                                   /**< Number of joints */
@@ -123,6 +180,10 @@ namespace constrained_ik
     moveit::core::RobotStatePtr robot_state_;         /**< Robot State Ptr */
     robot_model::RobotModelPtr robot_model_ptr_;      /**< Robot Model Ptr */
     boost::shared_ptr<Constrained_IK> solver_;        /**< Constrained IK Solver */
+    mutable std::vector<constrained_ik::SceneContextPtr> scene_contexts_; /**< Scene contexts of planning_scene_ not in use */
+    mutable boost::mutex scene_contexts_mutex_;       /**< Protects scene_contexts_ */
+    mutable SolutionCache solution_cache_;            /**< Recent solutions used as seeds, sized by the solution_cache_size parameter */
+    constrained_ik::SolverTelemetryPublisherPtr telemetry_publisher_; /**< Publishes the statistics of the solves, null if disabled */
   };
 
 }   //namespace constrained_ik
@@ -106,6 +106,26 @@ namespace constrained_ik
     void resetPlannerConfiguration();
 
   private:
+    /**
+     * @brief Checks if the group joint vectors can be interpolated linearly, which is the case when every active
+     * joint of the group is a prismatic or a bounded revolute joint.
+     * @param group_model the joint model group
+     * @return True if the joint vectors interpolate linearly, otherwise false
+     */
+    bool isLinearlyInterpolable(const robot_model::JointModelGroup *group_model) const;
+
+    /**
+     * @brief Generate a joint interpolated trajectory by interpolating the group joint vectors directly.  The path is
+     * validated before any waypoint is added to the trajectory.
+     * @param start_state the start state of the request
+     * @param goal_state the goal state of the request
+     * @param start_time the time the solve started at
+     * @param res planner response
+     * @return True if successful, otherwise false
+     */
+    bool solveJointSpace(const robot_state::RobotState &start_state, const robot_state::RobotState &goal_state,
+                         const ros::WallTime &start_time, planning_interface::MotionPlanResponse &res);
+
     double joint_discretization_step_; /**< Joint discretization step */
     bool debug_mode_;                  /**< Debug state */
     boost::atomic<bool> terminate_;    /**< Termination flag */
@@ -0,0 +1,100 @@
+/**
+ * @file solution_cache.h
+ * @brief Bounded cache of the recent inverse kinematics solutions
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef SOLUTION_CACHE_H
+#define SOLUTION_CACHE_H
+
+#include <vector>
+#include <boost/thread/mutex.hpp>
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+#include <Eigen/StdVector>
+
+namespace constrained_ik
+{
+
+/**
+ * @brief Keeps the last solutions found for tool poses in a ring buffer, so that the solution of the nearest prior pose
+ * can seed the solve of a new one, for instance when many nearby poses are queried during grasp sampling.  The cache is
+ * meant to hold up to a few hundred solutions, which are searched linearly.  This class is thread safe.
+ */
+class SolutionCache
+{
+public:
+  /**
+   * @brief Constructor
+   * @param capacity The number of solutions kept, the oldest ones are overwritten.  Zero disables the cache.
+   * @param rotation_weight The distance in meters equivalent to a rotation of one radian
+   */
+  explicit SolutionCache(std::size_t capacity = 0, double rotation_weight = 0.1);
+
+  /**
+   * @brief Changes the capacity, the solutions are forgotten
+   * @param capacity The number of solutions kept
+   */
+  void setCapacity(std::size_t capacity);
+
+  /** @brief The number of solutions kept */
+  std::size_t getCapacity() const;
+
+  /**
+   * @brief Adds a solution, overwriting the oldest one when the cache is full
+   * @param pose The tool pose
+   * @param joints The joint positions that place the tool at the pose
+   */
+  void insert(const Eigen::Affine3d &pose, const Eigen::VectorXd &joints);
+
+  /**
+   * @brief Finds the solution of the pose nearest to the given one
+   * @param pose The tool pose
+   * @param joints The joint positions of the nearest pose
+   * @param distance The distance to the nearest pose, see distance()
+   * @return False if the cache is empty, otherwise true
+   */
+  bool findNearest(const Eigen::Affine3d &pose, Eigen::VectorXd &joints, double &distance) const;
+
+  /**
+   * @brief The distance between two poses, the translation distance plus the rotation angle times the rotation weight
+   * @param p1 The first pose
+   * @param p2 The second pose
+   * @return The distance
+   */
+  double distance(const Eigen::Affine3d &p1, const Eigen::Affine3d &p2) const;
+
+  /** @brief Forgets all the solutions */
+  void clear();
+
+protected:
+  mutable boost::mutex mutex_;                                                 /**< Protects the solutions */
+  std::vector<Eigen::Affine3d, Eigen::aligned_allocator<Eigen::Affine3d> > poses_;  /**< The ring buffer of poses */
+  std::vector<Eigen::VectorXd> joints_;                                        /**< The ring buffer of solutions */
+  std::size_t capacity_;                                                       /**< The number of solutions kept */
+  std::size_t next_;                                                           /**< The index of the next solution to write */
+  double rotation_weight_;                                                     /**< The distance of a rotation of one radian */
+};
+
+} // namespace constrained_ik
+
+#endif // SOLUTION_CACHE_H
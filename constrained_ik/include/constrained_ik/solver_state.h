@@ -27,16 +27,34 @@
 #define SOLVER_STATE_H
 
 #include <vector>
+#include <boost/shared_ptr.hpp>
 #include <Eigen/Core>
 #include <Eigen/Geometry>
 #include <constrained_ik/enum_types.h>
 #include <moveit/planning_scene/planning_scene.h>
 #include <industrial_collision_detection/collision_detection/collision_robot_industrial.h>
 #include <industrial_collision_detection/collision_detection/collision_world_industrial.h>
+#include <industrial_collision_detection/collision_detection/temporal_distance_cache.h>
 
 namespace constrained_ik
 {
 
+/**
+ * @brief The objects derived from a planning scene that the solver needs, created once by
+ * Constrained_IK::createSceneContext() and reused across IK calls as long as the scene does not change.  The robot
+ * state and the distance cache are modified by the solves, so a context must not be used by concurrent solves.
+ */
+struct SceneContext
+{
+  planning_scene::PlanningSceneConstPtr planning_scene;                  /**< Pointer to the planning scene */
+  collision_detection::CollisionRobotIndustrialConstPtr collision_robot; /**< Pointer to the collision robot of the scene */
+  collision_detection::CollisionWorldIndustrialConstPtr collision_world; /**< Pointer to the collision world of the scene */
+  collision_detection::TemporalDistanceCachePtr distance_cache;          /**< Distance cache, valid as long as the world does not change */
+  collision_detection::AllowedCollisionBitMatrixConstPtr acm_bits;       /**< The bits of the allowed collision matrix of the scene */
+  moveit::core::RobotStatePtr robot_state;                               /**< Copy of the current state of the scene updated by the solves */
+};
+typedef boost::shared_ptr<SceneContext> SceneContextPtr; /**< Type definition for the scene context shared pointer */
+
 /** @brief Internal state of Constrained_IK solver */
 struct SolverState
 {
@@ -48,14 +66,19 @@ struct SolverState
   Eigen::VectorXd joints;                                                /**< Updated joint positions */
   Eigen::VectorXd joints_delta;                                          /**< The joint delta between this state and the previous state */
   Eigen::Affine3d pose_estimate;                                         /**< The pose for the updated joint position from the solver */
+  Eigen::MatrixXd jacobian;                                              /**< The jacobian for the updated joint position, only computed when a constraint requires it */
+  unsigned int requirements;                                             /**< The StateRequirements of the active constraints, set when the solve starts */
   std::vector<Eigen::VectorXd> iteration_path;                           /**< Store the joint position for each iteration of the solver */
   double primary_sum;                                                    /**< The absolute sum of the cumulative primary motion */
   double auxiliary_sum;                                                  /**< The absolute sum of the cumulative auxiliary motion */
+  double auxiliary_error;                                                /**< The auxiliary error norm of the previous iteration, max if it was not evaluated */
   bool auxiliary_at_limit;                                               /**< This is set if auxiliary reached motion or iteration limit. */
   initialization_state::InitializationState condition;                   /**< State of the IK Solver */
   planning_scene::PlanningSceneConstPtr planning_scene;                  /**< Pointer to the planning scene, some constraints require it */
   collision_detection::CollisionRobotIndustrialConstPtr collision_robot; /**< Pointer to the collision robot, some constraints require it */
   collision_detection::CollisionWorldIndustrialConstPtr collision_world; /**< Pointer to the collision world, some constraints require it */
+  collision_detection::TemporalDistanceCachePtr distance_cache;          /**< Skips the distance queries of the links far from obstacles across iterations */
+  collision_detection::AllowedCollisionBitMatrixConstPtr acm_bits;       /**< The bits of the allowed collision matrix of the planning scene, some constraints use it */
   moveit::core::RobotStatePtr robot_state;                               /**< Pointer to the current robot state */
   std::string group_name;                                                /**< Move group name */
 
@@ -0,0 +1,217 @@
+/**
+ * @file solver_telemetry.h
+ * @brief Timing and convergence statistics of the Constrained_IK solves
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef SOLVER_TELEMETRY_H
+#define SOLVER_TELEMETRY_H
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <diagnostic_msgs/DiagnosticStatus.h>
+#include <ros/ros.h>
+
+namespace constrained_ik
+{
+
+class Constraint;
+
+namespace solver_termination
+{
+  /** @brief Enum that identifies why a solve ended */
+  enum SolverTermination
+  {
+    Converged,         /**< Every constraint was satisfied */
+    AuxiliaryLimit,    /**< The primary constraints were satisfied, the auxiliary ones were given up at a limit */
+    JointConvergence,  /**< The joints stopped moving before the primary constraints were satisfied */
+    IterationLimit,    /**< Failed, the iteration limit was reached */
+    MotionLimit,       /**< Failed, the primary motion limit was reached */
+    Error,             /**< Failed, the primary pseudo inverse could not be computed */
+    NumTerminations,   /**< The number of termination reasons */
+  };
+} // namespace solver_termination
+
+/** @brief Histogram of non negative values in bins bounded by powers of two */
+struct TelemetryHistogram
+{
+  static const int NUM_BINS = 32; /**< The number of bins */
+
+  std::array<uint64_t, NUM_BINS> bins; /**< bins[0] counts the values below 1, bins[i] the ones in [2^(i-1), 2^i), the last bin also the larger values */
+  uint64_t count;                      /**< The number of values */
+  double sum;                          /**< The sum of the values */
+  double max;                          /**< The largest value */
+
+  TelemetryHistogram();
+
+  /**
+   * @brief Adds a value
+   * @param value the value
+   */
+  void add(double value);
+
+  /**
+   * @brief Adds the values of another histogram
+   * @param other the other histogram
+   */
+  void merge(const TelemetryHistogram &other);
+
+  /**
+   * @brief The mean of the values
+   * @return The mean, zero if there are none
+   */
+  double mean() const;
+
+  /**
+   * @brief An upper bound of a quantile of the values
+   * @param q the quantile in [0, 1]
+   * @return The upper bound of the bin holding the quantile, at most the largest value
+   */
+  double quantile(double q) const;
+};
+
+/** @brief The statistics of the evaluations of one constraint */
+struct ConstraintTelemetry
+{
+  std::string name;              /**< The class of the constraint */
+  TelemetryHistogram eval_time;  /**< The evaluation times in microseconds */
+};
+
+/** @brief The statistics of the solves recorded by a SolverTelemetry */
+struct SolverTelemetrySnapshot
+{
+  TelemetryHistogram solve_time;                    /**< The solve times in microseconds */
+  TelemetryHistogram iterations;                    /**< The number of iterations of the solves */
+  TelemetryHistogram decomposition_time;            /**< The times of the primary and auxiliary pseudo inverses in microseconds */
+  std::array<uint64_t, solver_termination::NumTerminations> terminations; /**< The number of solves per termination reason */
+  std::vector<ConstraintTelemetry> constraints;     /**< The statistics of every constraint evaluated, sorted by name */
+
+  SolverTelemetrySnapshot();
+};
+
+/**
+ * @brief Aggregates the solve times, the iteration counts, the termination reasons and the pseudo inverse and
+ * constraint evaluation times of the solves of a Constrained_IK.  Every thread records into its own histograms, which
+ * are only merged by getSnapshot(), so that concurrent solves do not contend.  This class is thread safe.
+ */
+class SolverTelemetry
+{
+public:
+  SolverTelemetry();
+  ~SolverTelemetry();
+
+  SolverTelemetry(const SolverTelemetry&) = delete;
+  SolverTelemetry& operator=(const SolverTelemetry&) = delete;
+
+  /**
+   * @brief Records a solve
+   * @param seconds the duration of the solve
+   * @param iterations the number of iterations
+   * @param termination why the solve ended
+   */
+  void recordSolve(double seconds, int iterations, solver_termination::SolverTermination termination);
+
+  /**
+   * @brief Records the computation of a pseudo inverse or of a damped least squares step
+   * @param seconds the duration of the computation
+   */
+  void recordDecomposition(double seconds);
+
+  /**
+   * @brief Records the evaluation of a constraint, the constraints are told apart by their address
+   * @param constraint the constraint
+   * @param seconds the duration of the evaluation
+   */
+  void recordConstraint(const Constraint *constraint, double seconds);
+
+  /**
+   * @brief Merges the statistics of every thread
+   * @return The statistics recorded since the construction or the last clear()
+   */
+  SolverTelemetrySnapshot getSnapshot() const;
+
+  /** @brief Forgets the statistics */
+  void clear();
+
+protected:
+  struct Shard;
+
+  /**
+   * @brief The statistics of the calling thread, created on its first record
+   * @return The shard of the calling thread
+   */
+  Shard& getShard();
+
+  const uint64_t id_;                                  /**< Unique among the telemetries of the process, identifies the shards cached by the threads */
+  mutable boost::mutex mutex_;                         /**< Protects the shard list */
+  std::map<std::thread::id, std::unique_ptr<Shard> > shards_; /**< The statistics of every thread that recorded */
+};
+
+typedef boost::shared_ptr<SolverTelemetry> SolverTelemetryPtr; /**< Type definition for the solver telemetry shared pointer */
+
+/**
+ * @brief Summarizes solver statistics for the ROS diagnostics
+ * @param snapshot the statistics
+ * @param name the name of the status
+ * @return The status, its values hold the solve times, the iterations, the termination reasons and the mean and 99th
+ * percentile of the evaluation time of every constraint
+ */
+diagnostic_msgs::DiagnosticStatus toDiagnosticStatus(const SolverTelemetrySnapshot &snapshot, const std::string &name);
+
+/** @brief Periodically publishes the statistics of a SolverTelemetry on the /diagnostics topic */
+class SolverTelemetryPublisher
+{
+public:
+  /**
+   * @brief Constructor, the statistics are published by the callbacks of the node handle
+   * @param nh node handle
+   * @param telemetry the statistics to publish
+   * @param name the name of the diagnostic status
+   * @param period the publishing period in seconds
+   */
+  SolverTelemetryPublisher(ros::NodeHandle nh, const SolverTelemetryPtr &telemetry, const std::string &name, double period);
+
+  SolverTelemetryPublisher(const SolverTelemetryPublisher&) = delete;
+  SolverTelemetryPublisher& operator=(const SolverTelemetryPublisher&) = delete;
+
+protected:
+  /** @brief Publishes the statistics */
+  void publish(const ros::TimerEvent&);
+
+  SolverTelemetryPtr telemetry_; /**< The statistics to publish */
+  std::string name_;             /**< The name of the diagnostic status */
+  ros::Publisher publisher_;     /**< Publishes on /diagnostics */
+  ros::Timer timer_;             /**< Calls publish() */
+};
+
+typedef boost::shared_ptr<SolverTelemetryPublisher> SolverTelemetryPublisherPtr; /**< Type definition for the solver telemetry publisher shared pointer */
+
+} // namespace constrained_ik
+
+#endif // SOLVER_TELEMETRY_H
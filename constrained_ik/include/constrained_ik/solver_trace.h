@@ -0,0 +1,125 @@
+/**
+ * @file solver_trace.h
+ * @brief Bounded trace of the Constrained_IK solver iterations
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef SOLVER_TRACE_H
+#define SOLVER_TRACE_H
+
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <Eigen/Core>
+
+namespace constrained_ik
+{
+
+/** @brief The record of one solver iteration */
+struct SolverTraceRecord
+{
+  int solve;              /**< The number of the solve the iteration belongs to, in the order the solves started */
+  int iter;               /**< The iteration number */
+  Eigen::VectorXd joints; /**< The joint positions the constraints were evaluated at */
+  double primary_error;   /**< The norm of the primary error */
+  double auxiliary_error; /**< The norm of the auxiliary error, zero if the auxiliary constraints were not evaluated */
+  double primary_step;    /**< The norm of the primary joint step */
+  double auxiliary_step;  /**< The norm of the auxiliary joint step */
+};
+
+/**
+ * @brief Keeps the records of the last iterations of the solves in a ring buffer allocated once, so that the
+ * convergence of a solver in production can be analyzed offline.  The records are only made when the package is built
+ * with the CONSTRAINED_IK_TRACE option, otherwise the trace macros compile to nothing.  This class is thread safe.
+ */
+class SolverTrace
+{
+public:
+  /**
+   * @brief Constructor
+   * @param capacity The number of iterations kept, the oldest ones are overwritten
+   * @param num_joints The number of joints of the solver, used to preallocate the records
+   */
+  SolverTrace(std::size_t capacity, int num_joints);
+
+  /**
+   * @brief Starts a new solve
+   * @return The number of the solve to pass to record()
+   */
+  int beginSolve();
+
+  /**
+   * @brief Records an iteration, no memory is allocated as long as the number of joints matches the constructor's
+   * @param solve The number returned by beginSolve()
+   * @param iter The iteration number
+   * @param joints The joint positions
+   * @param primary_error The norm of the primary error
+   * @param auxiliary_error The norm of the auxiliary error
+   * @param primary_step The norm of the primary joint step
+   * @param auxiliary_step The norm of the auxiliary joint step
+   */
+  void record(int solve, int iter, const Eigen::VectorXd &joints, double primary_error, double auxiliary_error,
+              double primary_step, double auxiliary_step);
+
+  /**
+   * @brief Copies the records, the oldest first
+   * @return The records
+   */
+  std::vector<SolverTraceRecord> getRecords() const;
+
+  /** @brief Forgets all the records */
+  void clear();
+
+  /**
+   * @brief Writes the records, the oldest first, to a binary file.  The file starts with the characters "CIKT", then
+   * the format version, the number of joints and the number of records as uint32.  Each record follows as the solve and
+   * iteration numbers as int32, the joints as doubles and the error and step norms as doubles, in host byte order.
+   * @param file_name The file to write
+   * @return True if the file was written, otherwise false
+   */
+  bool write(const std::string &file_name) const;
+
+protected:
+  mutable boost::mutex mutex_;             /**< Protects the records */
+  std::vector<SolverTraceRecord> records_; /**< The ring buffer */
+  std::size_t next_;                       /**< The index of the next record to write */
+  std::size_t size_;                       /**< The number of records written, at most the capacity */
+  int num_joints_;                         /**< The number of joints of the records */
+  int num_solves_;                         /**< The number of solves started */
+};
+
+typedef boost::shared_ptr<SolverTrace> SolverTracePtr; /**< Type definition for the solver trace shared pointer */
+
+} // namespace constrained_ik
+
+#ifdef CONSTRAINED_IK_TRACE
+/** @brief Starts a solve on the trace if it is not null and stores its number in solve */
+#define CONSTRAINED_IK_TRACE_BEGIN(trace, solve) ((solve) = (trace) ? (trace)->beginSolve() : 0)
+/** @brief Records an iteration on the trace if it is not null, see SolverTrace::record() */
+#define CONSTRAINED_IK_TRACE_RECORD(trace, ...) do { if (trace) (trace)->record(__VA_ARGS__); } while (0)
+#else
+#define CONSTRAINED_IK_TRACE_BEGIN(trace, solve) ((void)(solve))
+#define CONSTRAINED_IK_TRACE_RECORD(trace, ...) do {} while (0)
+#endif
+
+#endif // SOLVER_TRACE_H
@@ -31,6 +31,7 @@
 #include <kdl_parser/kdl_parser.hpp>
 #include <moveit/robot_model/robot_model.h>
 #include <urdf/model.h>
+#include <algorithm>
 
 
 namespace constrained_ik
@@ -41,6 +42,8 @@ namespace basic_kin
 using Eigen::MatrixXd;
 using Eigen::VectorXd;
 
+const double CHAIN_SEGMENTS_TOLERANCE = 1e-9; /**< The maximum difference between the cached chain and KDL at initialization */
+
 bool BasicKin::calcFwdKin(const Eigen::VectorXd &joint_angles, Eigen::Affine3d &pose) const
 {
 //  int n = joint_angles.size();
@@ -49,11 +52,22 @@ bool BasicKin::calcFwdKin(const Eigen::VectorXd &joint_angles, Eigen::Affine3d &
   if (!checkInitialized()) return false;
   if (!checkJoints(joint_angles)) return false;
 
+  if (use_chain_segments_)
+  {
+    calcChainKinematics(chain_segments_, joint_angles, pose, NULL);
+    return true;
+  }
+
   EigenToKDL(joint_angles, kdl_joints);
 
-  // run FK solver
+  // run FK solver, the KDL solvers record their error in a member
   KDL::Frame kdl_pose;
-  if (fk_solver_->JntToCart(kdl_joints, kdl_pose) < 0)
+  int fk_status;
+  {
+    boost::mutex::scoped_lock lock(kdl_solvers_mutex_);
+    fk_status = fk_solver_->JntToCart(kdl_joints, kdl_pose);
+  }
+  if (fk_status < 0)
   {
     ROS_ERROR("Failed to calculate FK");
     return false;
@@ -68,29 +82,78 @@ bool BasicKin::calcFwdKin(const Eigen::VectorXd &joint_angles,
                           const std::string &tip,
                           KDL::Frame &pose) const
 {
-  // note, because the base and tip are different, fk_solver gets updated
-    KDL::Chain chain;
-    if (!kdl_tree_.getChain(base, tip, chain))
+  boost::shared_ptr<const SubChain> sub_chain = getCachedSubChain(base, tip);
+  if (!sub_chain)
+    return false;
+
+  if (joint_angles.size() != sub_chain->chain.getNrOfJoints())
+  {
+    ROS_ERROR_STREAM("Number of joint angles [" << joint_angles.size() <<
+                     "] must match number of joints [" << sub_chain->chain.getNrOfJoints() << "].");
+    return false;
+  }
+
+  if (sub_chain->use_segments)
+  {
+    Eigen::Affine3d transform;
+    calcChainKinematics(sub_chain->segments, joint_angles, transform, NULL);
+    tf::transformEigenToKDL(transform, pose);
+    return true;
+  }
+
+  // the KDL segments cache their last pose, each call works on its own copy of the chain
+  KDL::Chain chain = sub_chain->chain;
+  KDL::ChainFkSolverPos_recursive subchain_fk_solver(chain);
+
+  KDL::JntArray joints;
+  joints.data = joint_angles;
+  if (subchain_fk_solver.JntToCart(joints, pose) < 0)
+    return false;
+  return true;
+}
+
+boost::shared_ptr<const BasicKin::SubChain> BasicKin::getCachedSubChain(const std::string &base, const std::string &tip) const
+{
+  boost::mutex::scoped_lock lock(sub_chains_mutex_);
+  std::map<std::pair<std::string, std::string>, boost::shared_ptr<const SubChain> >::const_iterator it =
+      sub_chains_.find(std::make_pair(base, tip));
+  if (it != sub_chains_.end())
+    return it->second;
+
+  boost::shared_ptr<SubChain> sub_chain(new SubChain());
+  if (!kdl_tree_.getChain(base, tip, sub_chain->chain))
+  {
+    ROS_ERROR_STREAM("Failed to initialize KDL between URDF links: '" <<
+                     base << "' and '" << tip <<"'");
+    return boost::shared_ptr<const SubChain>();
+  }
+
+  // use the cached segments if they match KDL at a few joint values
+  buildChainSegments(sub_chain->chain, sub_chain->segments);
+  KDL::ChainFkSolverPos_recursive fk_solver(sub_chain->chain);
+  KDL::JntArray kdl_joints(sub_chain->chain.getNrOfJoints());
+  KDL::Frame kdl_pose;
+  Eigen::Affine3d kdl_transform, transform;
+  sub_chain->use_segments = true;
+  for (double value : {0.0, 0.3, -0.7})
+  {
+    kdl_joints.data.setConstant(value);
+    if (fk_solver.JntToCart(kdl_joints, kdl_pose) < 0)
     {
-      ROS_ERROR_STREAM("Failed to initialize KDL between URDF links: '" <<
-                       base << "' and '" << tip <<"'");
-      return false;
+      sub_chain->use_segments = false;
+      break;
     }
-
-    if (joint_angles.size() != chain.getNrOfJoints())
+    KDLToEigen(kdl_pose, kdl_transform);
+    calcChainKinematics(sub_chain->segments, kdl_joints.data, transform, NULL);
+    if (!transform.matrix().isApprox(kdl_transform.matrix(), CHAIN_SEGMENTS_TOLERANCE))
     {
-        ROS_ERROR_STREAM("Number of joint angles [" << joint_angles.size() <<
-                            "] must match number of joints [" << chain.getNrOfJoints() << "].");
-        return false;
+      sub_chain->use_segments = false;
+      break;
     }
+  }
 
-    KDL::ChainFkSolverPos_recursive subchain_fk_solver(chain);
-
-    KDL::JntArray joints;
-    joints.data = joint_angles;
-    if (subchain_fk_solver.JntToCart(joints, pose) < 0)
-        return false;
-    return true;
+  sub_chains_[std::make_pair(base, tip)] = sub_chain;
+  return sub_chain;
 }
 
 bool BasicKin::calcJacobian(const VectorXd &joint_angles, MatrixXd &jacobian) const
@@ -100,16 +163,211 @@ bool BasicKin::calcJacobian(const VectorXd &joint_angles, MatrixXd &jacobian) co
   if (!checkInitialized()) return false;
   if (!checkJoints(joint_angles)) return false;
 
+  if (use_chain_segments_)
+  {
+    Eigen::Affine3d pose;
+    calcChainKinematics(chain_segments_, joint_angles, pose, &jacobian);
+    return true;
+  }
+
   EigenToKDL(joint_angles, kdl_joints);
 
-  // compute jacobian
+  // compute jacobian, the KDL solver keeps its intermediate results in members
   KDL::Jacobian kdl_jacobian(joint_angles.size());
-  jac_solver_->JntToJac(kdl_joints, kdl_jacobian);
+  {
+    boost::mutex::scoped_lock lock(kdl_solvers_mutex_);
+    jac_solver_->JntToJac(kdl_joints, kdl_jacobian);
+  }
 
   KDLToEigen(kdl_jacobian, jacobian);
   return true;
 }
 
+bool BasicKin::calcJacobianDerivatives(const VectorXd &joint_angles, MatrixXd &jacobian, std::vector<MatrixXd> &derivatives) const
+{
+  if (!calcJacobian(joint_angles, jacobian))
+    return false;
+
+  calcJacobianDerivatives(jacobian, derivatives);
+  return true;
+}
+
+void BasicKin::calcJacobianDerivatives(const MatrixXd &jacobian, std::vector<MatrixXd> &derivatives)
+{
+  int n = jacobian.cols();
+  derivatives.resize(n);
+  for (int j = 0; j < n; ++j)
+  {
+    Eigen::Vector3d v_j = jacobian.block<3, 1>(0, j);
+    Eigen::Vector3d w_j = jacobian.block<3, 1>(3, j);
+    derivatives[j].setZero(6, n);
+    for (int i = 0; i < n; ++i)
+    {
+      Eigen::Vector3d v_i = jacobian.block<3, 1>(0, i);
+      Eigen::Vector3d w_i = jacobian.block<3, 1>(3, i);
+      if (j < i)
+      {
+        derivatives[j].block<3, 1>(0, i) = w_j.cross(v_i);
+        derivatives[j].block<3, 1>(3, i) = w_j.cross(w_i);
+      }
+      else
+      {
+        derivatives[j].block<3, 1>(0, i) = w_i.cross(v_j);
+      }
+    }
+  }
+}
+
+void BasicKin::ChainSegment::pose(double q, Eigen::Matrix3d &rotation, Eigen::Vector3d &translation) const
+{
+  switch(joint_type)
+  {
+    case Revolute:
+    {
+      // rotation about the axis through origin followed by the tip frame
+      Eigen::Matrix3d joint_rotation = Eigen::AngleAxisd(q, axis).toRotationMatrix();
+      rotation.noalias() = joint_rotation * tip_rotation;
+      translation = origin - joint_rotation * origin + joint_rotation * tip_translation;
+      break;
+    }
+    case Prismatic:
+      rotation = tip_rotation;
+      translation = tip_translation + q * axis;
+      break;
+    case Fixed:
+      rotation = tip_rotation;
+      translation = tip_translation;
+      break;
+  }
+}
+
+void BasicKin::calcChainKinematics(const std::vector<ChainSegment> &segments, const VectorXd &joint_angles,
+                                   Eigen::Affine3d &pose, MatrixXd *jacobian)
+{
+  Eigen::Matrix3d rotation = Eigen::Matrix3d::Identity();
+  Eigen::Vector3d translation = Eigen::Vector3d::Zero();
+  Eigen::Matrix3d segment_rotation;
+  Eigen::Vector3d segment_translation;
+
+  if (jacobian)
+    jacobian->resize(6, joint_angles.size());
+
+  int j = 0;
+  for (size_t i=0; i<segments.size(); ++i)
+  {
+    const ChainSegment &segment = segments[i];
+    if (segment.joint_type == ChainSegment::Fixed)
+    {
+      segment.pose(0.0, segment_rotation, segment_translation);
+    }
+    else
+    {
+      if (jacobian)
+      {
+        // the columns hold the joint twists referenced to the root origin, moved to the tip once it is known
+        Eigen::Vector3d axis = rotation * segment.axis;
+        if (segment.joint_type == ChainSegment::Revolute)
+        {
+          Eigen::Vector3d origin = translation + rotation * segment.origin;
+          jacobian->block<3,1>(0, j) = origin.cross(axis);
+          jacobian->block<3,1>(3, j) = axis;
+        }
+        else
+        {
+          jacobian->block<3,1>(0, j) = axis;
+          jacobian->block<3,1>(3, j).setZero();
+        }
+      }
+      segment.pose(joint_angles(j), segment_rotation, segment_translation);
+      ++j;
+    }
+
+    translation += rotation * segment_translation;
+    rotation = rotation * segment_rotation;
+  }
+
+  pose.setIdentity();
+  pose.linear() = rotation;
+  pose.translation() = translation;
+
+  if (jacobian)
+  {
+    for (int c=0; c<jacobian->cols(); ++c)
+    {
+      Eigen::Vector3d angular = jacobian->block<3,1>(3, c);
+      jacobian->block<3,1>(0, c) += angular.cross(translation);
+    }
+  }
+}
+
+void BasicKin::buildChainSegments(const KDL::Chain &chain, std::vector<ChainSegment> &segments)
+{
+  segments.resize(chain.getNrOfSegments());
+  for (size_t i=0; i<segments.size(); ++i)
+  {
+    const KDL::Segment &seg = chain.getSegment(i);
+    const KDL::Joint &jnt = seg.getJoint();
+    ChainSegment &segment = segments[i];
+
+    switch(jnt.getType())
+    {
+      case KDL::Joint::RotAxis:
+      case KDL::Joint::RotX:
+      case KDL::Joint::RotY:
+      case KDL::Joint::RotZ:
+        segment.joint_type = ChainSegment::Revolute;
+        break;
+      case KDL::Joint::TransAxis:
+      case KDL::Joint::TransX:
+      case KDL::Joint::TransY:
+      case KDL::Joint::TransZ:
+        segment.joint_type = ChainSegment::Prismatic;
+        break;
+      default:
+        segment.joint_type = ChainSegment::Fixed;
+        break;
+    }
+
+    KDL::Vector axis = jnt.JointAxis();
+    KDL::Vector origin = jnt.JointOrigin();
+    segment.axis = Eigen::Vector3d(axis.x(), axis.y(), axis.z()).normalized();
+    segment.origin = Eigen::Vector3d(origin.x(), origin.y(), origin.z());
+
+    Eigen::Affine3d tip;
+    KDLToEigen(seg.pose(0.0), tip);
+    segment.tip_rotation = tip.linear();
+    segment.tip_translation = tip.translation();
+  }
+}
+
+bool BasicKin::initChainSegments()
+{
+  buildChainSegments(robot_chain_, chain_segments_);
+
+  // compare with the KDL solvers at a few joint values within the limits
+  KDL::JntArray kdl_joints;
+  KDL::Frame kdl_pose;
+  KDL::Jacobian kdl_jacobian(robot_chain_.getNrOfJoints());
+  MatrixXd kdl_jacobian_eigen, jacobian;
+  Eigen::Affine3d kdl_transform, pose;
+  for (double fraction : {0.0, 0.25, 0.5, 0.9})
+  {
+    VectorXd joints = joint_limits_.col(0) + fraction * (joint_limits_.col(1) - joint_limits_.col(0));
+    EigenToKDL(joints, kdl_joints);
+    if (fk_solver_->JntToCart(kdl_joints, kdl_pose) < 0 || jac_solver_->JntToJac(kdl_joints, kdl_jacobian) < 0)
+      return false;
+
+    KDLToEigen(kdl_pose, kdl_transform);
+    KDLToEigen(kdl_jacobian, kdl_jacobian_eigen);
+    calcChainKinematics(chain_segments_, joints, pose, &jacobian);
+    if (!pose.matrix().isApprox(kdl_transform.matrix(), CHAIN_SEGMENTS_TOLERANCE) ||
+        (jacobian - kdl_jacobian_eigen).cwiseAbs().maxCoeff() > CHAIN_SEGMENTS_TOLERANCE)
+      return false;
+  }
+
+  return true;
+}
+
 bool BasicKin::checkJoints(const VectorXd &vec) const
 {
   if (vec.size() != robot_chain_.getNrOfJoints())
@@ -228,6 +486,15 @@ bool BasicKin::init(const moveit::core::JointModelGroup* group)
   fk_solver_.reset(new KDL::ChainFkSolverPos_recursive(robot_chain_));
   jac_solver_.reset(new KDL::ChainJntToJacSolver(robot_chain_));
 
+  {
+    boost::mutex::scoped_lock lock(sub_chains_mutex_);
+    sub_chains_.clear();
+  }
+
+  use_chain_segments_ = initChainSegments();
+  if (!use_chain_segments_)
+    ROS_WARN("The cached kinematic chain of group %s does not match KDL, using the KDL solvers", group->getName().c_str());
+
   initialized_ = true;
   group_ = group;
 
@@ -258,16 +525,12 @@ void BasicKin::KDLToEigen(const KDL::Jacobian &jacobian, Eigen::MatrixXd &matrix
 
 bool BasicKin::getSubChain(const std::string link_name, KDL::Chain &chain) const
 {
-  if (!kdl_tree_.getChain(base_name_, link_name, chain))
-  {
-    ROS_ERROR_STREAM("Failed to initialize KDL between URDF links: '" <<
-                     base_name_ << "' and '" << link_name <<"'");
+  boost::shared_ptr<const SubChain> sub_chain = getCachedSubChain(base_name_, link_name);
+  if (!sub_chain)
     return false;
-  }
-  else
-  {
-    return true;
-  }
+
+  chain = sub_chain->chain;
+  return true;
 }
 
 bool BasicKin::linkTransforms(const VectorXd &joint_angles,
@@ -293,12 +556,53 @@ bool BasicKin::linkTransforms(const VectorXd &joint_angles,
         n = links.size();
     }
 
+    poses.resize(n);
+    if (use_chain_segments_)
+    {
+      // walk the cached chain once up to the farthest requested link
+      std::vector<size_t> segment_nrs(n);
+      size_t max_segment_nr = 0;
+      for (size_t ii=0; ii<n; ++ii)
+      {
+        int link_num = getLinkNum(links[ii]);
+        segment_nrs[ii] = link_num<0 ? chain_segments_.size() : link_num+1; /*root=0, link1=1, therefore add +1 to link num*/
+        if (segment_nrs[ii] > chain_segments_.size())
+        {
+          ROS_ERROR_STREAM("Failed to calculate FK for joint " << n);
+          return false;
+        }
+        max_segment_nr = std::max(max_segment_nr, segment_nrs[ii]);
+      }
+
+      std::vector<KDL::Frame> frames(max_segment_nr + 1);
+      Eigen::Matrix3d rotation = Eigen::Matrix3d::Identity();
+      Eigen::Vector3d translation = Eigen::Vector3d::Zero();
+      Eigen::Matrix3d segment_rotation;
+      Eigen::Vector3d segment_translation;
+      for (size_t i=0, j=0; i<max_segment_nr; ++i)
+      {
+        const ChainSegment &segment = chain_segments_[i];
+        segment.pose(segment.joint_type == ChainSegment::Fixed ? 0.0 : joint_angles(j++), segment_rotation, segment_translation);
+        translation += rotation * segment_translation;
+        rotation = rotation * segment_rotation;
+
+        frames[i+1].p = KDL::Vector(translation.x(), translation.y(), translation.z());
+        frames[i+1].M = KDL::Rotation(rotation(0,0), rotation(0,1), rotation(0,2),
+                                      rotation(1,0), rotation(1,1), rotation(1,2),
+                                      rotation(2,0), rotation(2,1), rotation(2,2));
+      }
+
+      for (size_t ii=0; ii<n; ++ii)
+        poses[ii] = frames[segment_nrs[ii]];
+      return true;
+    }
+
     KDL::JntArray kdl_joints;
     EigenToKDL(joint_angles, kdl_joints);
 
     // run FK solver
-    poses.resize(n);
     int link_num;
+    boost::mutex::scoped_lock lock(kdl_solvers_mutex_);
     for (size_t ii=0; ii<n; ++ii)
     {
         link_num = getLinkNum(links[ii]);
@@ -321,6 +625,12 @@ BasicKin& BasicKin::operator=(const BasicKin& rhs)
   link_list_ = rhs.link_list_;
   fk_solver_.reset(new KDL::ChainFkSolverPos_recursive(robot_chain_));
   jac_solver_.reset(new KDL::ChainJntToJacSolver(robot_chain_));
+  chain_segments_ = rhs.chain_segments_;
+  use_chain_segments_ = rhs.use_chain_segments_;
+  {
+    boost::mutex::scoped_lock lock(rhs.sub_chains_mutex_);
+    sub_chains_ = rhs.sub_chains_;
+  }
   group_ = rhs.group_;
   base_name_ = rhs.base_name_;
   tip_name_ = rhs.tip_name_;
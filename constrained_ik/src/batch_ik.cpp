@@ -0,0 +1,308 @@
+/**
+ * @file batch_ik.cpp
+ * @brief Lockstep solver of many independent pose goals of the same kinematic chain
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "constrained_ik/batch_ik.h"
+#include <ros/ros.h>
+#include <algorithm>
+
+namespace constrained_ik
+{
+
+bool BatchIK::init(const basic_kin::BasicKin &kin)
+{
+  initialized_ = false;
+  if (!kin.checkInitialized())
+  {
+    ROS_ERROR("BatchIK requires an initialized kinematic model");
+    return false;
+  }
+
+  if (!kin.use_chain_segments_)
+  {
+    ROS_ERROR("BatchIK does not support the chain of this kinematic model");
+    return false;
+  }
+
+  segments_ = kin.chain_segments_;
+  num_joints_ = kin.numJoints();
+  joint_limits_ = kin.getLimits();
+  initialized_ = true;
+  return true;
+}
+
+std::size_t BatchIK::solve(const PoseVector &goals, const Eigen::MatrixXd &seeds, Eigen::MatrixXd &joint_angles,
+                           std::vector<bool> &converged) const
+{
+  if (!initialized_)
+  {
+    ROS_ERROR("BatchIK must be initialized before solving");
+    return 0;
+  }
+
+  if (seeds.rows() != num_joints_ || (seeds.cols() != 1 && seeds.cols() != static_cast<int>(goals.size())))
+  {
+    ROS_ERROR("BatchIK seeds must be [%d][1] or [%d][%d], got [%d][%d]", num_joints_, num_joints_,
+              static_cast<int>(goals.size()), static_cast<int>(seeds.rows()), static_cast<int>(seeds.cols()));
+    return 0;
+  }
+
+  joint_angles.resize(num_joints_, goals.size());
+  converged.assign(goals.size(), false);
+  for (std::size_t first = 0; first < goals.size(); first += LANES)
+    solveBlock(first, std::min<std::size_t>(LANES, goals.size() - first), goals, seeds, joint_angles, converged);
+
+  return std::count(converged.begin(), converged.end(), true);
+}
+
+void BatchIK::calcKinematics(const LanesVector &q, Lanes *rotation, Lanes *translation, LanesVector &jacobian) const
+{
+  // the same walk as BasicKin::calcChainKinematics, every scalar holds the values of the problems of the block
+  const int n = num_joints_;
+  for (int r=0; r<3; ++r)
+  {
+    for (int c=0; c<3; ++c)
+      rotation[3*r + c].setConstant(r == c ? 1.0 : 0.0);
+    translation[r].setZero();
+  }
+
+  Lanes segment_rotation[9];
+  Lanes segment_translation[3];
+  Lanes next_rotation[9];
+  int j = 0;
+  for (size_t i=0; i<segments_.size(); ++i)
+  {
+    const ChainSegment &segment = segments_[i];
+    if (segment.joint_type == ChainSegment::Revolute)
+    {
+      const Eigen::Vector3d &a = segment.axis;
+      // Rodrigues formula of the joint rotation R = c*I + s*[a]x + (1 - c)*a*a^T
+      Lanes c = q[j].cos();
+      Lanes s = q[j].sin();
+      Lanes v = 1.0 - c;
+      Lanes joint_rotation[9] = {c + v*a(0)*a(0),    v*a(0)*a(1) - s*a(2), v*a(0)*a(2) + s*a(1),
+                                 v*a(1)*a(0) + s*a(2), c + v*a(1)*a(1),    v*a(1)*a(2) - s*a(0),
+                                 v*a(2)*a(0) - s*a(1), v*a(2)*a(1) + s*a(0), c + v*a(2)*a(2)};
+      Eigen::Vector3d arm = segment.tip_translation - segment.origin;
+      for (int r=0; r<3; ++r)
+      {
+        for (int k=0; k<3; ++k)
+          segment_rotation[3*r + k] = joint_rotation[3*r]*segment.tip_rotation(0, k) +
+                                       joint_rotation[3*r + 1]*segment.tip_rotation(1, k) +
+                                       joint_rotation[3*r + 2]*segment.tip_rotation(2, k);
+        segment_translation[r] = segment.origin(r) + joint_rotation[3*r]*arm(0) + joint_rotation[3*r + 1]*arm(1) +
+                                 joint_rotation[3*r + 2]*arm(2);
+      }
+    }
+    else
+    {
+      for (int r=0; r<3; ++r)
+      {
+        for (int k=0; k<3; ++k)
+          segment_rotation[3*r + k].setConstant(segment.tip_rotation(r, k));
+        segment_translation[r].setConstant(segment.tip_translation(r));
+        if (segment.joint_type == ChainSegment::Prismatic)
+          segment_translation[r] += q[j]*segment.axis(r);
+      }
+    }
+
+    if (segment.joint_type != ChainSegment::Fixed)
+    {
+      // the columns hold the joint twists referenced to the root origin, moved to the tip once it is known
+      Lanes axis[3];
+      for (int r=0; r<3; ++r)
+        axis[r] = rotation[3*r]*segment.axis(0) + rotation[3*r + 1]*segment.axis(1) + rotation[3*r + 2]*segment.axis(2);
+
+      if (segment.joint_type == ChainSegment::Revolute)
+      {
+        Lanes origin[3];
+        for (int r=0; r<3; ++r)
+          origin[r] = translation[r] + rotation[3*r]*segment.origin(0) + rotation[3*r + 1]*segment.origin(1) +
+                      rotation[3*r + 2]*segment.origin(2);
+        jacobian[0*n + j] = origin[1]*axis[2] - origin[2]*axis[1];
+        jacobian[1*n + j] = origin[2]*axis[0] - origin[0]*axis[2];
+        jacobian[2*n + j] = origin[0]*axis[1] - origin[1]*axis[0];
+        for (int r=0; r<3; ++r)
+          jacobian[(3 + r)*n + j] = axis[r];
+      }
+      else
+      {
+        for (int r=0; r<3; ++r)
+        {
+          jacobian[r*n + j] = axis[r];
+          jacobian[(3 + r)*n + j].setZero();
+        }
+      }
+      ++j;
+    }
+
+    for (int r=0; r<3; ++r)
+    {
+      translation[r] += rotation[3*r]*segment_translation[0] + rotation[3*r + 1]*segment_translation[1] +
+                        rotation[3*r + 2]*segment_translation[2];
+      for (int k=0; k<3; ++k)
+        next_rotation[3*r + k] = rotation[3*r]*segment_rotation[k] + rotation[3*r + 1]*segment_rotation[3 + k] +
+                                 rotation[3*r + 2]*segment_rotation[6 + k];
+    }
+    std::copy(next_rotation, next_rotation + 9, rotation);
+  }
+
+  for (int c=0; c<n; ++c)
+  {
+    Lanes wx = jacobian[3*n + c], wy = jacobian[4*n + c], wz = jacobian[5*n + c];
+    jacobian[0*n + c] += wy*translation[2] - wz*translation[1];
+    jacobian[1*n + c] += wz*translation[0] - wx*translation[2];
+    jacobian[2*n + c] += wx*translation[1] - wy*translation[0];
+  }
+}
+
+void BatchIK::solveBlock(std::size_t first, std::size_t count, const PoseVector &goals, const Eigen::MatrixXd &seeds,
+                         Eigen::MatrixXd &joint_angles, std::vector<bool> &converged) const
+{
+  const int n = num_joints_;
+
+  // the unused lanes of the last block repeat its first problem and are inactive from the start
+  LanesVector q(n);
+  Lanes goal_rotation[9];
+  Lanes goal_translation[3];
+  Mask active;
+  for (int l=0; l<LANES; ++l)
+  {
+    std::size_t p = first + (static_cast<std::size_t>(l) < count ? l : 0);
+    const Eigen::Affine3d &goal = goals[p];
+    for (int j=0; j<n; ++j)
+      q[j](l) = seeds(j, seeds.cols() == 1 ? 0 : p);
+    for (int r=0; r<3; ++r)
+    {
+      for (int c=0; c<3; ++c)
+        goal_rotation[3*r + c](l) = goal.linear()(r, c);
+      goal_translation[r](l) = goal.translation()(r);
+    }
+    active(l) = static_cast<std::size_t>(l) < count;
+  }
+
+  Mask done = Mask::Constant(false);
+  LanesVector jacobian(6*n);
+  LanesVector dq(n);
+  Lanes rotation[9];
+  Lanes translation[3];
+  Lanes error[6];
+  Lanes A[21]; // the lower triangle of J*J^T + damping^2*I, row major
+  const double damping2 = params_.damping * params_.damping;
+  for (int iteration=0; iteration<=params_.max_iterations; ++iteration)
+  {
+    calcKinematics(q, rotation, translation, jacobian);
+
+    // position error and the orientation error 0.5 * sum(r_i x g_i) of the columns of the rotations
+    Lanes trace = Lanes::Zero();
+    for (int r=0; r<3; ++r)
+    {
+      error[r] = goal_translation[r] - translation[r];
+      for (int c=0; c<3; ++c)
+        trace += rotation[3*r + c]*goal_rotation[3*r + c];
+    }
+    error[3] = 0.5*(rotation[3]*goal_rotation[6] - rotation[6]*goal_rotation[3] +
+                    rotation[4]*goal_rotation[7] - rotation[7]*goal_rotation[4] +
+                    rotation[5]*goal_rotation[8] - rotation[8]*goal_rotation[5]);
+    error[4] = 0.5*(rotation[6]*goal_rotation[0] - rotation[0]*goal_rotation[6] +
+                    rotation[7]*goal_rotation[1] - rotation[1]*goal_rotation[7] +
+                    rotation[8]*goal_rotation[2] - rotation[2]*goal_rotation[8]);
+    error[5] = 0.5*(rotation[0]*goal_rotation[3] - rotation[3]*goal_rotation[0] +
+                    rotation[1]*goal_rotation[4] - rotation[4]*goal_rotation[1] +
+                    rotation[2]*goal_rotation[5] - rotation[5]*goal_rotation[2]);
+
+    Lanes position_error = (error[0].square() + error[1].square() + error[2].square()).sqrt();
+    Lanes angle_error = (0.5*(trace - 1.0)).max(-1.0).min(1.0).acos();
+    done = done || (active && position_error < params_.position_tolerance &&
+                    angle_error < params_.orientation_tolerance);
+    active = active && !done;
+    if (!active.any() || iteration == params_.max_iterations)
+      break;
+
+    // damped least squares step dq = J^T * (J*J^T + damping^2*I)^-1 * error, with a Cholesky factorization per lane
+    for (int r=0, k=0; r<6; ++r)
+    {
+      for (int c=0; c<=r; ++c, ++k)
+      {
+        A[k].setConstant(r == c ? damping2 : 0.0);
+        for (int j=0; j<n; ++j)
+          A[k] += jacobian[r*n + j]*jacobian[c*n + j];
+      }
+    }
+
+    for (int r=0; r<6; ++r)
+    {
+      const int row = r*(r + 1)/2;
+      for (int c=0; c<r; ++c)
+      {
+        const int col = c*(c + 1)/2;
+        for (int k=0; k<c; ++k)
+          A[row + c] -= A[row + k]*A[col + k];
+        A[row + c] /= A[col + c];
+      }
+      for (int k=0; k<r; ++k)
+        A[row + r] -= A[row + k].square();
+      A[row + r] = A[row + r].sqrt();
+    }
+
+    for (int r=0; r<6; ++r)
+    {
+      const int row = r*(r + 1)/2;
+      for (int k=0; k<r; ++k)
+        error[r] -= A[row + k]*error[k];
+      error[r] /= A[row + r];
+    }
+    for (int r=5; r>=0; --r)
+    {
+      for (int k=r + 1; k<6; ++k)
+        error[r] -= A[k*(k + 1)/2 + r]*error[k];
+      error[r] /= A[r*(r + 1)/2 + r];
+    }
+
+    Lanes largest = Lanes::Zero();
+    for (int j=0; j<n; ++j)
+    {
+      dq[j] = jacobian[j]*error[0];
+      for (int r=1; r<6; ++r)
+        dq[j] += jacobian[r*n + j]*error[r];
+      largest = largest.max(dq[j].abs());
+    }
+
+    Lanes scale = (params_.max_joint_step / largest.max(params_.max_joint_step)).min(1.0);
+    for (int j=0; j<n; ++j)
+    {
+      Lanes next = (q[j] + scale*dq[j]).max(joint_limits_(j, 0)).min(joint_limits_(j, 1));
+      q[j] = active.select(next, q[j]);
+    }
+  }
+
+  for (std::size_t l=0; l<count; ++l)
+  {
+    for (int j=0; j<n; ++j)
+      joint_angles(j, first + l) = q[j](l);
+    converged[first + l] = done(l);
+  }
+}
+
+} // namespace constrained_ik
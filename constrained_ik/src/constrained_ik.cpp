@@ -26,10 +26,168 @@
 #include <constrained_ik/constrained_ik.h>
 #include "constrained_ik/constraint_group.h"
 #include <boost/make_shared.hpp>
+#include <Eigen/Dense>
 #include <constrained_ik/constraint_results.h>
 #include <ros/ros.h>
+#include <boost/thread/mutex.hpp>
+#include <chrono>
+#include <limits>
+#include <map>
 
 const std::vector<std::string> SUPPORTED_COLLISION_DETECTORS = {"IndustrialFCL", "CollisionDetectionOpenVDB"}; /**< Supported collision detector */
+const double PINV_SINGULAR_VALUE_THRESHOLD = 0.011; /**< Singular values below this are damped, same as the BasicKin::dampedPInv default */
+const double PINV_DAMPING = 0.01;                   /**< Damping factor, same as the BasicKin::dampedPInv default */
+const double LM_INITIAL_DAMPING = 1e-3;             /**< Initial damping of the adaptive primary step */
+const double LM_MIN_DAMPING = 1e-9;                 /**< Lower bound of the damping of the adaptive primary step */
+const double LM_MAX_DAMPING = 1e3;                  /**< Upper bound of the damping of the adaptive primary step */
+const double LM_DAMPING_FACTOR = 10.0;              /**< Factor the damping is decreased by after a successful step and increased by otherwise */
+const int LM_MAX_BACKTRACKS = 4;                    /**< Number of times the step is halved by the line search */
+
+namespace
+{
+
+/** @brief A constraint read from the parameter server */
+struct ConstraintDefinition
+{
+  std::string class_name;     /**< The plugin class of the constraint */
+  bool is_primary;            /**< Whether the constraint is primary or auxiliary */
+  XmlRpc::XmlRpcValue xml;    /**< The parameters passed to Constraint::loadParameters */
+};
+
+/**
+ * @brief Process wide registry of the constraint plugin loader and of the constraints read from the parameter server,
+ * so that creating the constraints of a solver does not scan the plugin manifests nor query the parameter server again.
+ */
+struct ConstraintRegistry
+{
+  boost::mutex mutex;                                                                    /**< Guards the registry */
+  boost::shared_ptr<pluginlib::ClassLoader<constrained_ik::Constraint> > loader;         /**< Shared by every solver, it outlives the constraints it created */
+  std::map<std::string, std::vector<ConstraintDefinition> > definitions;                 /**< The constraints of each parameter name */
+};
+
+/** @brief The process wide constraint registry */
+ConstraintRegistry& getConstraintRegistry()
+{
+  static ConstraintRegistry registry;
+  return registry;
+}
+
+/**
+ * @brief Computes the damped pseudo inverse and optionally the null space projection from a SVD computed with thin U
+ * and full V.  The pseudo inverse is damped the same way as BasicKin::dampedPInv and the null space is spanned by the
+ * right singular vectors beyond the rank, as in Constrained_IK::calcNullspaceProjectionTheRightWay.
+ */
+template<typename SVD, typename PinvType, typename NullspaceType>
+void pseudoinverseFromSVD(const SVD &svd, PinvType &J_pinv, NullspaceType &N, bool compute_nullspace)
+{
+  const typename SVD::SingularValuesType &Sv = svd.singularValues();
+  const typename SVD::MatrixVType &V = svd.matrixV();
+  int nSv = Sv.size();
+
+  typename SVD::SingularValuesType inv_Sv = Sv;
+  for(int i=0; i<nSv; ++i)
+  {
+    if (fabs(Sv(i)) > PINV_SINGULAR_VALUE_THRESHOLD)
+      inv_Sv(i) = 1/Sv(i);
+    else
+      inv_Sv(i) = Sv(i) / (Sv(i)*Sv(i) + PINV_DAMPING*PINV_DAMPING);
+  }
+  J_pinv.noalias() = V.leftCols(nSv) * inv_Sv.asDiagonal() * svd.matrixU().leftCols(nSv).transpose();
+
+  if (compute_nullspace)
+  {
+    int rnk = 0;
+    if (nSv > 0)
+    {
+      double threshold = nSv*Eigen::NumTraits<double>::epsilon()*Sv(0);
+      rnk = svd.nonzeroSingularValues();
+      while(rnk>0 && Sv(rnk-1) < threshold) --rnk;
+    }
+    int null_dim = V.cols() - rnk;
+    N.noalias() = V.rightCols(null_dim) * V.rightCols(null_dim).transpose();
+  }
+}
+
+/**
+ * @brief Computes the damped pseudo inverse and optionally the null space projection of J using the requested
+ * decomposition.  When MatrixType is fixed size every intermediate result lives on the stack.
+ */
+template<typename MatrixType>
+bool primaryPseudoinverse(constrained_ik::SolverDecomposition decomposition, const MatrixType &J,
+                          Eigen::MatrixXd &J_pinv, Eigen::MatrixXd &N, bool compute_nullspace)
+{
+  using namespace constrained_ik::solver_decompositions;
+  typedef Eigen::Matrix<double, MatrixType::ColsAtCompileTime, MatrixType::RowsAtCompileTime,
+                        Eigen::ColMajor, MatrixType::MaxColsAtCompileTime, MatrixType::MaxRowsAtCompileTime> PinvType;
+  typedef Eigen::Matrix<double, MatrixType::RowsAtCompileTime, MatrixType::RowsAtCompileTime,
+                        Eigen::ColMajor, MatrixType::MaxRowsAtCompileTime, MatrixType::MaxRowsAtCompileTime> RowsSquareType;
+  typedef Eigen::Matrix<double, MatrixType::ColsAtCompileTime, MatrixType::ColsAtCompileTime,
+                        Eigen::ColMajor, MatrixType::MaxColsAtCompileTime, MatrixType::MaxColsAtCompileTime> ColsSquareType;
+
+  // thin unitaries are only available for dynamic sizes, fixed sizes compute the full ones on the stack
+  const bool dynamic = MatrixType::ColsAtCompileTime == Eigen::Dynamic;
+  const unsigned int svd_options = dynamic ?
+        (Eigen::ComputeThinU | (compute_nullspace ? Eigen::ComputeFullV : Eigen::ComputeThinV)) :
+        (Eigen::ComputeFullU | Eigen::ComputeFullV);
+
+  PinvType pinv(J.cols(), J.rows());
+  ColsSquareType null_projection(J.cols(), J.cols());
+  switch(decomposition)
+  {
+    case JacobiSvd:
+    case BdcSvd:
+    {
+      // BDCSVD runs a Jacobi SVD on small matrices anyway but allocates its workspace on the heap
+      if (dynamic && decomposition == BdcSvd)
+      {
+        Eigen::BDCSVD<MatrixType> svd(J, svd_options);
+        pseudoinverseFromSVD(svd, pinv, null_projection, compute_nullspace);
+      }
+      else
+      {
+        Eigen::JacobiSVD<MatrixType> svd(J, svd_options);
+        pseudoinverseFromSVD(svd, pinv, null_projection, compute_nullspace);
+      }
+      break;
+    }
+    case DampedCholesky:
+    {
+      // J+ = J^T (J J^T + lambda^2 I)^-1, factorizing the smaller of the two normal equations
+      double lambda2 = PINV_DAMPING*PINV_DAMPING;
+      if (J.rows() <= J.cols())
+      {
+        Eigen::LLT<RowsSquareType> llt(J*J.transpose() + lambda2*RowsSquareType::Identity(J.rows(), J.rows()));
+        if (llt.info() != Eigen::Success)
+          return false;
+        pinv = llt.solve(J).transpose();
+      }
+      else
+      {
+        Eigen::LLT<ColsSquareType> llt(J.transpose()*J + lambda2*ColsSquareType::Identity(J.cols(), J.cols()));
+        if (llt.info() != Eigen::Success)
+          return false;
+        pinv = llt.solve(J.transpose());
+      }
+
+      if (compute_nullspace)
+      {
+        null_projection.setIdentity();
+        null_projection.noalias() -= pinv * J;
+      }
+      break;
+    }
+    default:
+      ROS_ERROR("Unknown primary decomposition %i", static_cast<int>(decomposition));
+      return false;
+  }
+
+  J_pinv = pinv;
+  if (compute_nullspace)
+    N = null_projection;
+  return true;
+}
+
+}
 
 namespace constrained_ik
 {
@@ -46,62 +204,85 @@ Constrained_IK::Constrained_IK(const ros::NodeHandle &nh) : nh_(nh)
 
 void Constrained_IK::addConstraintsFromParamServer(const std::string &parameter_name)
 {
-  XmlRpc::XmlRpcValue constraints_xml;
-  boost::shared_ptr<pluginlib::ClassLoader<constrained_ik::Constraint> > constraint_loader;
-
-  constraint_loader.reset(new pluginlib::ClassLoader<constrained_ik::Constraint>("constrained_ik", "constrained_ik::Constraint"));
+  ConstraintRegistry &registry = getConstraintRegistry();
+  boost::mutex::scoped_lock lock(registry.mutex);
 
-  if (!nh_.getParam(parameter_name, constraints_xml))
+  std::map<std::string, std::vector<ConstraintDefinition> >::const_iterator it = registry.definitions.find(parameter_name);
+  if (it == registry.definitions.end())
   {
-    ROS_ERROR("Unable to find ros parameter: %s", parameter_name.c_str());
-    ROS_BREAK();
-    return;
-  }
-
-  if(constraints_xml.getType() != XmlRpc::XmlRpcValue::TypeArray)
-  {
-    ROS_ERROR("ROS parameter %s must be an array", parameter_name.c_str());
-    ROS_BREAK();
-    return;
-  }
+    XmlRpc::XmlRpcValue constraints_xml;
+    if (!nh_.getParam(parameter_name, constraints_xml))
+    {
+      ROS_ERROR("Unable to find ros parameter: %s", parameter_name.c_str());
+      ROS_BREAK();
+      return;
+    }
 
-  for (int i=0; i<constraints_xml.size(); ++i)
-  {
-    XmlRpc::XmlRpcValue constraint_xml = constraints_xml[i];
+    if(constraints_xml.getType() != XmlRpc::XmlRpcValue::TypeArray)
+    {
+      ROS_ERROR("ROS parameter %s must be an array", parameter_name.c_str());
+      ROS_BREAK();
+      return;
+    }
 
-    if (constraint_xml.hasMember("class") &&
-              constraint_xml["class"].getType() == XmlRpc::XmlRpcValue::TypeString &&
-              constraint_xml.hasMember("primary") &&
-              constraint_xml["primary"].getType() == XmlRpc::XmlRpcValue::TypeBoolean)
+    std::vector<ConstraintDefinition> definitions;
+    for (int i=0; i<constraints_xml.size(); ++i)
     {
-      std::string class_name = constraint_xml["class"];
-      bool is_primary = constraint_xml["primary"];
+      XmlRpc::XmlRpcValue constraint_xml = constraints_xml[i];
 
-      Constraint *constraint;
-      try
+      if (constraint_xml.hasMember("class") &&
+                constraint_xml["class"].getType() == XmlRpc::XmlRpcValue::TypeString &&
+                constraint_xml.hasMember("primary") &&
+                constraint_xml["primary"].getType() == XmlRpc::XmlRpcValue::TypeBoolean)
       {
-        constraint = constraint_loader->createUnmanagedInstance(class_name);
-
-        constraint->loadParameters(constraint_xml);
-        if (is_primary)
-          addConstraint(constraint, constraint_types::Primary);
-        else
-          addConstraint(constraint, constraint_types::Auxiliary);
-
+        ConstraintDefinition definition;
+        definition.class_name = static_cast<std::string>(constraint_xml["class"]);
+        definition.is_primary = constraint_xml["primary"];
+        definition.xml = constraint_xml;
+        definitions.push_back(definition);
       }
-      catch (pluginlib::PluginlibException& ex)
+      else
       {
-        ROS_ERROR("Couldn't load constraint named %s.\n Error: %s", class_name.c_str(), ex.what());
-        ROS_BREAK();
+        ROS_ERROR("Constraint must have class(string) and primary(boolean) members");
       }
     }
-    else
+    it = registry.definitions.insert(std::make_pair(parameter_name, definitions)).first;
+  }
+
+  if (!registry.loader)
+    registry.loader.reset(new pluginlib::ClassLoader<constrained_ik::Constraint>("constrained_ik", "constrained_ik::Constraint"));
+
+  for (std::size_t i=0; i<it->second.size(); ++i)
+  {
+    const ConstraintDefinition &definition = it->second[i];
+
+    Constraint *constraint;
+    try
     {
-      ROS_ERROR("Constraint must have class(string) and primary(boolean) members");
+      constraint = registry.loader->createUnmanagedInstance(definition.class_name);
+
+      constraint->loadParameters(definition.xml);
+      if (definition.is_primary)
+        addConstraint(constraint, constraint_types::Primary);
+      else
+        addConstraint(constraint, constraint_types::Auxiliary);
+
+    }
+    catch (pluginlib::PluginlibException& ex)
+    {
+      ROS_ERROR("Couldn't load constraint named %s.\n Error: %s", definition.class_name.c_str(), ex.what());
+      ROS_BREAK();
     }
   }
 }
 
+void Constrained_IK::clearConstraintRegistry()
+{
+  ConstraintRegistry &registry = getConstraintRegistry();
+  boost::mutex::scoped_lock lock(registry.mutex);
+  registry.definitions.clear();
+}
+
 void Constrained_IK::loadDefaultSolverConfiguration()
 {
   ConstrainedIKConfiguration config;
@@ -122,6 +303,10 @@ void Constrained_IK::loadDefaultSolverConfiguration()
   config.primary_gain = 1.0;
   config.auxiliary_gain = 1.0;
   config.joint_convergence_tol = 0.0001;
+  config.primary_decomposition = solver_decompositions::JacobiSvd;
+  config.parallel_constraint_evaluation = false;
+  config.primary_adaptive_damping = false;
+  config.auxiliary_min_improvement = 0.0;
 
   setSolverConfiguration(config);
 }
@@ -130,6 +315,8 @@ void Constrained_IK::setSolverConfiguration(const ConstrainedIKConfiguration &co
 {
   config_ = config;
   validateConstrainedIKConfiguration<ConstrainedIKConfiguration>(config_);
+  primary_constraints_.setParallelEvaluation(config_.parallel_constraint_evaluation);
+  auxiliary_constraints_.setParallelEvaluation(config_.parallel_constraint_evaluation);
 }
 
 constrained_ik::ConstraintResults Constrained_IK::evalConstraint(constraint_types::ConstraintTypes constraint_type, const constrained_ik::SolverState &state) const
@@ -143,6 +330,21 @@ constrained_ik::ConstraintResults Constrained_IK::evalConstraint(constraint_type
   }
 }
 
+void Constrained_IK::evalConstraint(constraint_types::ConstraintTypes constraint_type, const constrained_ik::SolverState &state,
+                                    constrained_ik::ConstraintResults &output,
+                                    std::vector<constrained_ik::ConstraintResults> &results) const
+{
+  switch(constraint_type)
+  {
+    case constraint_types::Primary:
+      primary_constraints_.evalConstraint(state, output, results);
+      break;
+    case constraint_types::Auxiliary:
+      auxiliary_constraints_.evalConstraint(state, output, results);
+      break;
+  }
+}
+
 Eigen::MatrixXd Constrained_IK::calcNullspaceProjection(const Eigen::MatrixXd &J) const
 {
   MatrixXd J_pinv = calcDampedPseudoinverse(J);
@@ -198,6 +400,41 @@ Eigen::MatrixXd Constrained_IK::calcDampedPseudoinverse(const Eigen::MatrixXd &J
   }
 }
 
+bool Constrained_IK::calcPrimaryPseudoinverse(const Eigen::MatrixXd &J, Eigen::MatrixXd &J_pinv, Eigen::MatrixXd &N, bool compute_nullspace) const
+{
+  if ( (J.rows() == 0) || (J.cols() == 0) )
+  {
+    ROS_ERROR("Empty matrices not supported in calcPrimaryPseudoinverse()");
+    return false;
+  }
+
+  // a single pose constraint on a 6 or 7 dof arm is by far the most common primary jacobian, decompose it on the stack
+  if (J.rows() == 6 && J.cols() == 6)
+    return primaryPseudoinverse(config_.primary_decomposition, Eigen::Matrix<double, 6, 6>(J), J_pinv, N, compute_nullspace);
+
+  if (J.rows() == 6 && J.cols() == 7)
+    return primaryPseudoinverse(config_.primary_decomposition, Eigen::Matrix<double, 6, 7>(J), J_pinv, N, compute_nullspace);
+
+  return primaryPseudoinverse(config_.primary_decomposition, J, J_pinv, N, compute_nullspace);
+}
+
+void Constrained_IK::calcDampedLeastSquaresStep(const Eigen::MatrixXd &J, const Eigen::VectorXd &error, double damping, Eigen::VectorXd &step) const
+{
+  // factorize the smaller of the two normal equations, both give the same step
+  if (J.rows() <= J.cols())
+  {
+    MatrixXd JJt = J*J.transpose();
+    JJt.diagonal().array() += damping;
+    step.noalias() = J.transpose()*JJt.ldlt().solve(error);
+  }
+  else
+  {
+    MatrixXd JtJ = J.transpose()*J;
+    JtJ.diagonal().array() += damping;
+    step = JtJ.ldlt().solve(J.transpose()*error);
+  }
+}
+
 bool Constrained_IK::calcInvKin(const Eigen::Affine3d &goal,
                                 const Eigen::VectorXd &joint_seed,
                                 Eigen::VectorXd &joint_angles) const
@@ -210,46 +447,145 @@ bool Constrained_IK::calcInvKin(const Eigen::Affine3d &goal,
                                 const planning_scene::PlanningSceneConstPtr planning_scene,
                                 Eigen::VectorXd &joint_angles) const
 {
-  double dJoint_norm;
-  SolverStatus status;
+  return calcInvKin(goal, joint_seed, createSceneContext(planning_scene), joint_angles);
+}
 
-    // initialize state
-  joint_angles = joint_seed;  // initialize result to seed value
+bool Constrained_IK::calcInvKin(const Eigen::Affine3d &goal,
+                                const Eigen::VectorXd &joint_seed,
+                                const constrained_ik::SceneContextPtr &scene_context,
+                                Eigen::VectorXd &joint_angles) const
+{
   constrained_ik::SolverState state = getState(goal, joint_seed); // create state vars for this IK solve
-  state.condition = checkInitialized();
-  state.planning_scene = planning_scene;
-  state.group_name = kin_.getJointModelGroup()->getName();
+  initSolverState(state, scene_context);
+
+  return solveState(state, joint_angles);
+}
 
-  //TODO: Does this still belong here?
-  if(planning_scene)
+bool Constrained_IK::calcInvKinBatch(const std::vector<Eigen::Affine3d, Eigen::aligned_allocator<Eigen::Affine3d> > &goals,
+                                     const Eigen::VectorXd &joint_seed,
+                                     const planning_scene::PlanningSceneConstPtr planning_scene,
+                                     std::vector<Eigen::VectorXd> &joint_angles) const
+{
+  joint_angles.clear();
+  if (goals.empty())
+    return true;
+
+  // validate the seed and every goal up front so that a bad pose does not abort the batch halfway through
+  constrained_ik::SolverState state = getState(goals.front(), joint_seed);
+  for (const auto &goal : goals)
+    if (!goal.matrix().block(0,0,3,3).isUnitary(1e-6))
+      throw std::invalid_argument("Goal pose not proper affine");
+
+  initSolverState(state, createSceneContext(planning_scene));
+  initialization_state::InitializationState condition = state.condition;
+
+  joint_angles.reserve(goals.size());
+  Eigen::VectorXd solution;
+  for (std::size_t i = 0; i < goals.size(); ++i)
   {
-    state.robot_state = robot_state::RobotStatePtr(new moveit::core::RobotState(planning_scene->getCurrentState()));
+    // the state keeps the scene, robot state and distance cache, each pose is seeded from the previous solution
+    if (i > 0)
+    {
+      state.reset(goals[i], joint_angles.back());
+      state.condition = condition;
+      state.requirements = getStateRequirements(condition);
+      state.iteration_path.clear();
+    }
 
-    //Check and make sure the correct collision detector is loaded.
-    auto pos = std::find(SUPPORTED_COLLISION_DETECTORS.begin(),SUPPORTED_COLLISION_DETECTORS.end(),
-                         planning_scene->getActiveCollisionDetectorName());
-    if (pos == SUPPORTED_COLLISION_DETECTORS.end())
+    if (!solveState(state, solution))
+      return false;
+
+    joint_angles.push_back(solution);
+  }
+
+  return true;
+}
+
+constrained_ik::SceneContextPtr Constrained_IK::createSceneContext(const planning_scene::PlanningSceneConstPtr planning_scene) const
+{
+  if (!planning_scene)
+    return constrained_ik::SceneContextPtr();
+
+  //Check and make sure the correct collision detector is loaded.
+  auto pos = std::find(SUPPORTED_COLLISION_DETECTORS.begin(),SUPPORTED_COLLISION_DETECTORS.end(),
+                       planning_scene->getActiveCollisionDetectorName());
+  if (pos == SUPPORTED_COLLISION_DETECTORS.end())
+  {
+    std::stringstream error_message;
+    error_message<<" Constrained IK requires the use of collision detectors: ";
+    for(auto& d : SUPPORTED_COLLISION_DETECTORS)
     {
-      std::stringstream error_message;
-      error_message<<" Constrained IK requires the use of collision detectors: ";
-      for(auto& d : SUPPORTED_COLLISION_DETECTORS)
-      {
-        error_message<<"'"<< d<<"' ";
-      }
-      error_message<<".\nSet or add the 'collision_detector' parameter to an allowed collision detector in the move_group.launch file"<<std::endl;
-      throw std::runtime_error(error_message.str());
+      error_message<<"'"<< d<<"' ";
     }
+    error_message<<".\nSet or add the 'collision_detector' parameter to an allowed collision detector in the move_group.launch file"<<std::endl;
+    throw std::runtime_error(error_message.str());
+  }
 
-    state.collision_robot = std::static_pointer_cast<const collision_detection::CollisionRobotIndustrial>(planning_scene->getCollisionRobot());
-    state.collision_world = std::static_pointer_cast<const collision_detection::CollisionWorldIndustrial>(planning_scene->getCollisionWorld());
+  constrained_ik::SceneContextPtr scene_context(new constrained_ik::SceneContext());
+  scene_context->planning_scene = planning_scene;
+  scene_context->robot_state = robot_state::RobotStatePtr(new moveit::core::RobotState(planning_scene->getCurrentState()));
+  scene_context->collision_robot = std::static_pointer_cast<const collision_detection::CollisionRobotIndustrial>(planning_scene->getCollisionRobot());
+  scene_context->collision_world = std::static_pointer_cast<const collision_detection::CollisionWorldIndustrial>(planning_scene->getCollisionWorld());
+  scene_context->distance_cache.reset(new collision_detection::TemporalDistanceCache());
+  scene_context->acm_bits.reset(new collision_detection::AllowedCollisionBitMatrix(planning_scene->getAllowedCollisionMatrix()));
+  return scene_context;
+}
+
+void Constrained_IK::initSolverState(constrained_ik::SolverState &state, const constrained_ik::SceneContextPtr &scene_context) const
+{
+  state.condition = checkInitialized();
+  state.requirements = getStateRequirements(state.condition);
+  state.group_name = kin_.getJointModelGroup()->getName();
+
+  if(scene_context)
+  {
+    state.planning_scene = scene_context->planning_scene;
+    state.robot_state = scene_context->robot_state;
+    state.collision_robot = scene_context->collision_robot;
+    state.collision_world = scene_context->collision_world;
+    state.distance_cache = scene_context->distance_cache;
+    state.acm_bits = scene_context->acm_bits;
   }
 
   if (state.condition == initialization_state::NothingInitialized || state.condition == initialization_state::AuxiliaryOnly)
     throw std::runtime_error("Must call init() before using Constrained_IK and have a primary constraint.");
+}
+
+bool Constrained_IK::solveState(constrained_ik::SolverState &state, Eigen::VectorXd &joint_angles) const
+{
+  double dJoint_norm;
+  SolverStatus status;
+  const Eigen::VectorXd &joint_seed = state.joint_seed;
+
+  joint_angles = joint_seed;  // initialize result to seed value
 
   //Cache the joint angles to return if max iteration is reached.
   Eigen::VectorXd cached_joint_angles = joint_seed;
 
+  int trace_solve = 0;
+  CONSTRAINED_IK_TRACE_BEGIN(trace_, trace_solve);
+
+  // the telemetry times the solve and the decompositions, nothing is measured without it
+  typedef std::chrono::steady_clock Clock;
+  const Clock::time_point solve_start = telemetry_ ? Clock::now() : Clock::time_point();
+  auto record_solve = [&](solver_termination::SolverTermination termination)
+  {
+    if (telemetry_)
+      telemetry_->recordSolve(std::chrono::duration<double>(Clock::now() - solve_start).count(), state.iter, termination);
+  };
+
+  // the constraint results, primary pseudo inverse and null space keep their storage across iterations, the results of
+  // the individual primary constraints are only needed until they are stacked and are shared with the line search
+  constrained_ik::ConstraintResults primary, auxiliary;
+  std::vector<constrained_ik::ConstraintResults> primary_results, auxiliary_results;
+  MatrixXd Ji_p, N_p;
+
+  // the adaptive primary step evaluates the primary constraints at the trial joints of its line search
+  double damping = LM_INITIAL_DAMPING;
+  constrained_ik::SolverState trial_state;
+  constrained_ik::ConstraintResults trial_primary;
+  Eigen::VectorXd trial_joints;
+
   // iterate until solution converges (or aborted)
   while (true)
   {
@@ -259,16 +595,42 @@ bool Constrained_IK::calcInvKin(const Eigen::Affine3d &goal,
     // calculate a Jacobian (relating joint-space updates/deltas to cartesian-space errors/deltas)
     // and the associated cartesian-space error/delta vector
     // Primary Constraints
-    constrained_ik::ConstraintResults primary = evalConstraint(constraint_types::Primary, state);
-    // TODO since we already have J_p = USV, use that to get null-projection too.
-    // otherwise, we are repeating the expensive calculation of the SVD
+    evalConstraint(constraint_types::Primary, state, primary, primary_results);
+
+    // the auxiliary step projects onto the null space of the primary jacobian, which is computed from the same
+    // decomposition as the primary pseudo inverse
+    bool eval_auxiliary = state.condition == initialization_state::PrimaryAndAuxiliary &&
+        !((config_.limit_auxiliary_motion && state.auxiliary_sum >= config_.auxiliary_max_motion) ||
+          (config_.limit_auxiliary_interations && state.iter > config_.auxiliary_max_iterations));
 
     VectorXd dJoint_p;
     dJoint_p.setZero(joint_seed.size());
     if (!primary.isEmpty()) // This is required because not all constraints always return data.
     {
-      MatrixXd Ji_p = calcDampedPseudoinverse(primary.jacobian);
-      dJoint_p = config_.primary_gain*(Ji_p*primary.error);
+      const Clock::time_point decomposition_start = telemetry_ ? Clock::now() : Clock::time_point();
+
+      // the adaptive step only needs the decomposition for the null space of the auxiliary step
+      if ((!config_.primary_adaptive_damping || eval_auxiliary) &&
+          !calcPrimaryPseudoinverse(primary.jacobian, Ji_p, N_p, eval_auxiliary))
+      {
+        ROS_ERROR_STREAM("Not able to calculate damped pseudoinverse!");
+        record_solve(solver_termination::Error);
+        throw std::runtime_error("Not able to calculate damped pseudoinverse!  IK solution may be invalid.");
+      }
+
+      if (config_.primary_adaptive_damping)
+      {
+        calcDampedLeastSquaresStep(primary.jacobian, primary.error, damping, dJoint_p);
+        dJoint_p *= config_.primary_gain;
+      }
+      else
+      {
+        dJoint_p = config_.primary_gain*(Ji_p*primary.error);
+      }
+
+      if (telemetry_)
+        telemetry_->recordDecomposition(std::chrono::duration<double>(Clock::now() - decomposition_start).count());
+
       dJoint_norm = dJoint_p.norm();
       if(config_.allow_primary_normalization && dJoint_norm > config_.primary_norm)// limit maximum update radian/meter
       {
@@ -280,19 +642,44 @@ bool Constrained_IK::calcInvKin(const Eigen::Affine3d &goal,
 
     // Auxiliary Constraints
     VectorXd dJoint_a;
-    constrained_ik::ConstraintResults auxiliary;
     dJoint_a.setZero(dJoint_p.size());
+    if (!eval_auxiliary)
+      auxiliary.resize(0, 0);
+
     if (state.condition == initialization_state::PrimaryAndAuxiliary)
     {
-      if (!((config_.limit_auxiliary_motion && state.auxiliary_sum >= config_.auxiliary_max_motion) ||
-          (config_.limit_auxiliary_interations && state.iter > config_.auxiliary_max_iterations)))
+      if (eval_auxiliary)
       {
-        auxiliary = evalConstraint(constraint_types::Auxiliary, state);
+        evalConstraint(constraint_types::Auxiliary, state, auxiliary, auxiliary_results);
         if (!auxiliary.isEmpty()) // This is required because not all constraints always return data.
         {
-          MatrixXd N_p = calcNullspaceProjectionTheRightWay(primary.jacobian);
-          MatrixXd Jnull_a = calcDampedPseudoinverse(auxiliary.jacobian*N_p);
-          dJoint_a = config_.auxiliary_gain*Jnull_a*(auxiliary.error-auxiliary.jacobian*dJoint_p);
+          if (primary.isEmpty())
+            N_p = MatrixXd::Identity(dJoint_p.size(), dJoint_p.size());
+          // selector rows pick weighted rows of the null space projection and of the primary step
+          MatrixXd JN_a;
+          VectorXd residual_a;
+          if (auxiliary.isJointSelector())
+          {
+            JN_a.resize(auxiliary.jacobian.rows(), N_p.cols());
+            residual_a.resize(auxiliary.error.rows());
+            for (int k = 0; k < JN_a.rows(); ++k)
+            {
+              int joint = auxiliary.selected_joints[k];
+              double weight = auxiliary.jacobian(k, joint);
+              JN_a.row(k) = weight*N_p.row(joint);
+              residual_a(k) = auxiliary.error(k) - weight*dJoint_p(joint);
+            }
+          }
+          else
+          {
+            JN_a = auxiliary.jacobian*N_p;
+            residual_a = auxiliary.error-auxiliary.jacobian*dJoint_p;
+          }
+          const Clock::time_point decomposition_start = telemetry_ ? Clock::now() : Clock::time_point();
+          MatrixXd Jnull_a = calcDampedPseudoinverse(JN_a);
+          if (telemetry_)
+            telemetry_->recordDecomposition(std::chrono::duration<double>(Clock::now() - decomposition_start).count());
+          dJoint_a = config_.auxiliary_gain*Jnull_a*residual_a;
           dJoint_norm = dJoint_a.norm();
           if(config_.allow_auxiliary_nomalization && dJoint_norm > config_.auxiliary_norm)// limit maximum update radian/meter
           {
@@ -308,22 +695,54 @@ bool Constrained_IK::calcInvKin(const Eigen::Affine3d &goal,
       }
     }
 
+    CONSTRAINED_IK_TRACE_RECORD(trace_, trace_solve, state.iter, joint_angles, primary.error.norm(),
+                                auxiliary.error.norm(), dJoint_p.norm(), dJoint_a.norm());
+
     status = checkStatus(state, primary, auxiliary);
-    
-    
+    state.auxiliary_error = auxiliary.isEmpty() ? std::numeric_limits<double>::max() : auxiliary.error.norm();
+
     if (status == Converged)
     {
       ROS_DEBUG_STREAM("Found IK solution in " << state.iter << " iterations: " << joint_angles.transpose());
+      if (!primary.status)
+        record_solve(solver_termination::JointConvergence);
+      else if (state.condition == initialization_state::PrimaryAndAuxiliary && (!auxiliary.status || state.auxiliary_at_limit))
+        record_solve(solver_termination::AuxiliaryLimit);
+      else
+        record_solve(solver_termination::Converged);
       return true;
     }
     else if (status == NotConverged)
     {
-      // update joint solution by the calculated update (or a partial fraction)
-      joint_angles += (dJoint_p + dJoint_a);
-      clipToJointLimits(joint_angles);
+      if (config_.primary_adaptive_damping && !primary.isEmpty())
+      {
+        // backtrack until the primary error decreases, the damping is relaxed after a decrease and raised otherwise.
+        // the smallest step is taken when the error never decreases so that the solver keeps moving.
+        double error_norm = primary.error.norm();
+        double alpha = 1.0;
+        bool decreased = false;
+        for (int k = 0; k <= LM_MAX_BACKTRACKS && !decreased; ++k, alpha *= 0.5)
+        {
+          trial_joints = joint_angles + alpha*(dJoint_p + dJoint_a);
+          clipToJointLimits(trial_joints);
+          trial_state = state;
+          updateState(trial_state, trial_joints);
+          evalConstraint(constraint_types::Primary, trial_state, trial_primary, primary_results);
+          decreased = trial_primary.isEmpty() || trial_primary.error.norm() < error_norm;
+        }
+        damping = decreased ? std::max(damping/LM_DAMPING_FACTOR, LM_MIN_DAMPING) : std::min(damping*LM_DAMPING_FACTOR, LM_MAX_DAMPING);
+        joint_angles = trial_joints;
+      }
+      else
+      {
+        // update joint solution by the calculated update (or a partial fraction)
+        joint_angles += (dJoint_p + dJoint_a);
+        clipToJointLimits(joint_angles);
+      }
     }
     else if (status == Failed)
     {
+      record_solve(state.iter > config_.solver_max_iterations ? solver_termination::IterationLimit : solver_termination::MotionLimit);
       joint_angles = cached_joint_angles;
       return false;
     }
@@ -344,6 +763,13 @@ SolverStatus Constrained_IK::checkStatus(const constrained_ik::SolverState &stat
         ROS_DEBUG("Auxiliary motion or iteration limit reached!");
         return Converged;
       }
+      else if (!status && primary.status && config_.auxiliary_min_improvement > 0 && !auxiliary.isEmpty() &&
+               state.auxiliary_error != std::numeric_limits<double>::max() &&
+               state.auxiliary_error - auxiliary.error.norm() < config_.auxiliary_min_improvement * state.auxiliary_error)
+      {
+        ROS_DEBUG("Auxiliary improvement below threshold!");
+        return Converged;
+      }
       else if(status)
       {
         return Converged;
@@ -450,6 +876,15 @@ constrained_ik::SolverState Constrained_IK::getState(const Eigen::Affine3d &goal
   return constrained_ik::SolverState(goal, joint_seed);
 }
 
+unsigned int Constrained_IK::getStateRequirements(initialization_state::InitializationState condition) const
+{
+  unsigned int requirements = primary_constraints_.getStateRequirements();
+  if (condition == initialization_state::PrimaryAndAuxiliary)
+    requirements |= auxiliary_constraints_.getStateRequirements();
+
+  return requirements;
+}
+
 void Constrained_IK::updateState(constrained_ik::SolverState &state, const Eigen::VectorXd &joints) const
 {
   // update maximum iterations
@@ -460,10 +895,24 @@ void Constrained_IK::updateState(constrained_ik::SolverState &state, const Eigen
   state.joints = joints;
   kin_.calcFwdKin(joints, state.pose_estimate);
 
+  // the jacobian is shared by every constraint that reads it
+  if (state.requirements & state_requirements::Jacobian)
+  {
+    if (!kin_.calcJacobian(joints, state.jacobian))
+      throw std::runtime_error("Failed to calculate Jacobian");
+  }
+
+  // only the links below the group are dirtied, and the collision bodies are only updated when a constraint queries them
   if(state.planning_scene && state.robot_state)
   {
-    state.robot_state->setJointGroupPositions(kin_.getJointModelGroup()->getName(), joints);
-    state.robot_state->update();
+    if (state.requirements & (state_requirements::LinkTransforms | state_requirements::CollisionScene))
+    {
+      state.robot_state->setJointGroupPositions(kin_.getJointModelGroup()->getName(), joints);
+      if (state.requirements & state_requirements::CollisionScene)
+        state.robot_state->update();
+      else
+        state.robot_state->updateLinkTransforms();
+    }
   }
 
   if (config_.debug_mode)
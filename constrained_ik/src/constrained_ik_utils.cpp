@@ -48,6 +48,10 @@ namespace constrained_ik
     c.primary_gain = config.primary_gain;
     c.auxiliary_gain = config.auxiliary_gain;
     c.joint_convergence_tol = config.joint_convergence_tol;
+    c.primary_decomposition = static_cast<SolverDecomposition>(config.primary_decomposition);
+    c.parallel_constraint_evaluation = config.parallel_constraint_evaluation;
+    c.primary_adaptive_damping = config.primary_adaptive_damping;
+    c.auxiliary_min_improvement = config.auxiliary_min_improvement;
     return c;
   }
 
@@ -68,6 +72,22 @@ namespace constrained_ik
     return true;
   }
 
+  bool getParam(XmlRpc::XmlRpcValue& config, const std::string& key, int& value)
+  {
+    if (!config.hasMember(key))
+    {
+      ROS_ERROR("XmlRpcValue does not contain key %s.", key.c_str());
+      return false;
+    }
+    XmlRpc::XmlRpcValue param = config[key];
+    if (param.getType() != XmlRpc::XmlRpcValue::TypeInt)
+    {
+      return false;
+    }
+    value = param;
+    return true;
+  }
+
   bool getParam(XmlRpc::XmlRpcValue& config, const std::string& key, std::vector<double>& double_array)
   {
     if (!config.hasMember(key))
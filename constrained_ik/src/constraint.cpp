@@ -39,4 +39,31 @@ int Constraint::numJoints() const
   return ik_->getKin().numJoints();
 }
 
+Eigen::MatrixXd Constraint::calcToolJacobian(const SolverState &state) const
+{
+  if (state.jacobian.rows() == 6 && state.jacobian.cols() == state.joints.size())
+    return state.jacobian;
+
+  MatrixXd jacobian;
+  if (!ik_->getKin().calcJacobian(state.joints, jacobian))
+    throw std::runtime_error("Failed to calculate Jacobian");
+
+  return jacobian;
+}
+
+void Constraint::setConstantJointJacobian(double weight)
+{
+  int n = numJoints();
+  constant_jacobian_ = MatrixXd::Identity(n, n) * weight;
+  constant_selected_joints_.resize(n);
+  for (int ii=0; ii<n; ++ii)
+    constant_selected_joints_[ii] = ii;
+}
+
+void Constraint::assignConstantJacobian(ConstraintResults &output) const
+{
+  output.jacobian = constant_jacobian_;
+  output.selected_joints = constant_selected_joints_;
+}
+
 } // namespace constrained_ik
@@ -27,7 +27,13 @@
  */
 #include "constrained_ik/constraint_group.h"
 #include "constrained_ik/constrained_ik.h"
+#include <industrial_collision_detection/collision_detection/query_thread_pool.h>
 #include <ros/ros.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
 
 namespace constrained_ik
 {
@@ -35,7 +41,7 @@ namespace constrained_ik
 using namespace Eigen;
 
 // initialize limits/tolerances to default values
-ConstraintGroup::ConstraintGroup() : Constraint()
+ConstraintGroup::ConstraintGroup() : Constraint(), parallel_(false)
 {
 }
 
@@ -50,10 +56,96 @@ void ConstraintGroup::add(Constraint* constraint)
 constrained_ik::ConstraintResults ConstraintGroup::evalConstraint(const SolverState &state) const
 {
   constrained_ik::ConstraintResults output;
+  std::vector<constrained_ik::ConstraintResults> results;
+  evalConstraint(state, output, results);
+  return output;
+}
+
+void ConstraintGroup::evalConstraint(const SolverState &state, ConstraintResults &output,
+                                     std::vector<ConstraintResults> &results) const
+{
+  results.resize(constraints_.size());
+
+  // the evaluation of every constraint is timed when the solver records telemetry
+  SolverTelemetryPtr telemetry = ik_ ? ik_->getTelemetry() : SolverTelemetryPtr();
+  auto evaluate = [this, &state, &results, &telemetry](size_t i)
+  {
+    if (!telemetry)
+    {
+      results[i] = constraints_[i].evalConstraint(state);
+      return;
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    results[i] = constraints_[i].evalConstraint(state);
+    telemetry->recordConstraint(&constraints_[i], std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+  };
+
+  // first pass evaluates every constraint
+  if (parallel_ && constraints_.size() > 1)
+  {
+    // every constraint writes its own result, the persistent query threads claim the constraints one at a time and the
+    // ones sharing the distance cache stay on this thread, worker 0
+    auto shares_cache = [this](size_t i)
+    {
+      return (constraints_[i].getStateRequirements() & state_requirements::CollisionScene) != 0;
+    };
+
+    size_t num_concurrent = 0;
+    for (size_t i=0; i<constraints_.size(); ++i)
+      num_concurrent += shares_cache(i) ? 0 : 1;
+
+    size_t num_workers = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), num_concurrent + 1);
+    std::atomic<size_t> next(0);
+    collision_detection::QueryThreadPool::instance().run(num_workers, [&](size_t worker)
+    {
+      if (worker == 0)
+        for (size_t i=0; i<constraints_.size(); ++i)
+          if (shares_cache(i))
+            evaluate(i);
+
+      for (size_t i = next++; i < constraints_.size(); i = next++)
+        if (!shares_cache(i))
+          evaluate(i);
+    });
+  }
+  else
+  {
+    for (size_t i=0; i<constraints_.size(); ++i)
+      evaluate(i);
+  }
+
+  // then finds the size of the stacked results
+  int rows = 0;
+  int cols = 0;
+  for (size_t i=0; i<results.size(); ++i)
+  {
+    const constrained_ik::ConstraintResults &result = results[i];
+    if (result.error.rows() != 0 && result.jacobian.rows() != 0)
+    {
+      rows += result.error.rows();
+      cols = result.jacobian.cols();
+    }
+  }
+
+  // second pass writes them into the output
+  output.resize(rows, cols);
+  int row = 0;
+  for (size_t i=0; i<results.size(); ++i)
+  {
+    output.assign(row, results[i]);
+    if (results[i].error.rows() != 0 && results[i].jacobian.rows() != 0)
+      row += results[i].error.rows();
+  }
+}
+
+unsigned int ConstraintGroup::getStateRequirements() const
+{
+  unsigned int requirements = state_requirements::PoseEstimate;
   for (size_t i=0; i<constraints_.size(); ++i)
-    output.append(constraints_[i].evalConstraint(state));
+    requirements |= constraints_[i].getStateRequirements();
 
-  return output;
+  return requirements;
 }
 
 void ConstraintGroup::init(const Constrained_IK* ik)
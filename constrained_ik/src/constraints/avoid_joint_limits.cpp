@@ -53,6 +53,7 @@ constrained_ik::ConstraintResults AvoidJointLimits::evalConstraint(const SolverS
 
   output.error = calcError(cdata);
   output.jacobian = calcJacobian(cdata);
+  output.selected_joints = cdata.limited_joints_;
   output.status = checkStatus(cdata);
 
   return output;
@@ -95,17 +96,10 @@ Eigen::VectorXd AvoidJointLimits::calcError(const AvoidJointLimits::AvoidJointLi
 Eigen::MatrixXd AvoidJointLimits::calcJacobian(const AvoidJointLimits::AvoidJointLimitsData &cdata) const
 {
   size_t nRows = cdata.limited_joints_.size();
-  MatrixXd jacobian(nRows, numJoints());
+  MatrixXd jacobian = MatrixXd::Zero(nRows, numJoints());
 
   for (int ii=0; ii<nRows; ++ii)
-  {
-    size_t jntIdx = cdata.limited_joints_[ii];
-
-    VectorXd tmpRow = VectorXd::Zero(numJoints());
-    tmpRow(jntIdx) = 1.0;
-
-    jacobian.row(ii) = tmpRow * weight_;
-  }
+    jacobian(ii, cdata.limited_joints_[ii]) = weight_;
 
   return jacobian;
 }
@@ -53,7 +53,7 @@ using Eigen::MatrixXd;
 using std::string;
 using std::vector;
 
-AvoidObstacles::LinkAvoidance::LinkAvoidance(): weight_(DEFAULT_WEIGHT), min_distance_(DEFAULT_MIN_DISTANCE), avoidance_distance_(DEFAULT_AVOIDANCE_DISTANCE), amplitude_(DEFAULT_AMPLITUDE), jac_solver_(NULL) {}
+AvoidObstacles::LinkAvoidance::LinkAvoidance(): weight_(DEFAULT_WEIGHT), min_distance_(DEFAULT_MIN_DISTANCE), avoidance_distance_(DEFAULT_AVOIDANCE_DISTANCE), amplitude_(DEFAULT_AMPLITUDE), link_index_(-1) {}
 AvoidObstacles::LinkAvoidance::LinkAvoidance(std::string link_name): LinkAvoidance() {link_name_ = link_name;}
 
 void AvoidObstacles::init(const Constrained_IK * ik)
@@ -78,7 +78,6 @@ void AvoidObstacles::init(const Constrained_IK * ik)
       return;
     }
     it->second.num_inboard_joints_ = it->second.avoid_chain_.getNrOfJoints();
-    it->second.jac_solver_ = new  KDL::ChainJntToJacSolver(it->second.avoid_chain_);
   }
 
   std::vector<const robot_model::LinkModel*> tmp = ik_->getKin().getJointModelGroup()->getLinkModels();
@@ -86,8 +85,25 @@ void AvoidObstacles::init(const Constrained_IK * ik)
   {
     std::vector<std::string>::iterator name_it = std::find(link_names_.begin(), link_names_.end(), (*it)->getName());
     if (name_it != link_names_.end())
+    {
       link_models_.insert(*it);
+      std::map<std::string, LinkAvoidance>::iterator link_it = links_.find((*it)->getName());
+      if (link_it != links_.end())
+        link_it->second.link_index_ = (*it)->getLinkIndex();
+    }
   }
+
+  // the request only depends on the links and the parameters, the callbacks test the links in the mask
+  const robot_model::JointModelGroup *group = ik_->getKin().getJointModelGroup();
+  computeActiveLinkMask(link_models_, group->getParentModel().getLinkModelCount(), link_mask_);
+  distance_request_ = DistanceRequest();
+  distance_request_.detailed = true;
+  distance_request_.global = false;
+  distance_request_.group_name = group->getName();
+  distance_request_.setActiveComponents(&link_models_, &link_mask_);
+  distance_request_.distance_threshold = distance_threshold_;
+  distance_request_.lod_margin = lod_margin_;
+  distance_request_.num_threads = distance_threads_;
 }
 
 void AvoidObstacles::loadParameters(const XmlRpc::XmlRpcValue &constraint_xml)
@@ -175,24 +191,77 @@ void AvoidObstacles::loadParameters(const XmlRpc::XmlRpcValue &constraint_xml)
   {
     ROS_WARN("Abstacle Avoidance: Unable to retrieve link_names member, default parameter will be used.");
   }
+
+  // optional, the exact meshes are used by default
+  if (local_xml.hasMember("lod_margin"))
+    getParam(local_xml, "lod_margin", lod_margin_);
+
+  // optional, disabled by default
+  if (local_xml.hasMember("sphere_fast_path"))
+    getParam(local_xml, "sphere_fast_path", sphere_fast_path_);
+
+  // optional, the links are queried by the calling thread by default
+  if (local_xml.hasMember("distance_threads"))
+    getParam(local_xml, "distance_threads", distance_threads_);
+}
+
+const collision_detection::RobotSphereModel* AvoidObstacles::getSphereModel(const robot_model::RobotModelConstPtr &model) const
+{
+  if (!sphere_fast_path_)
+    return NULL;
+
+  std::lock_guard<std::mutex> lock(sphere_model_mutex_);
+  if (!sphere_model_)
+    sphere_model_ = collision_detection::RobotSphereModel::create(model, collision_detection::RobotSphereModel::Parameters(),
+                                                                  collision_detection::RobotSphereModel::getDefaultCacheDirectory());
+
+  return sphere_model_.get();
 }
 
 ConstraintResults AvoidObstacles::evalConstraint(const SolverState &state) const
 {
   ConstraintResults output;
   AvoidObstaclesData cdata(state, this);
+
+  // first pass counts the links close to an obstacle, each of them contributes one row
+  int rows = 0;
+  int cols = 0;
+  for (std::map<std::string, LinkAvoidance>::const_iterator it = links_.begin(); it != links_.end(); ++it)
+  {
+    const DistanceInfo *dist_info = cdata.getDistanceInfo(it->second);
+    if (dist_info && dist_info->distance > 0)
+    {
+      rows++;
+      cols = it->second.num_robot_joints_;
+    }
+  }
+
+  if (rows == 0)
+    return output;
+
+  // one jacobian of the chain serves every link, the links are inboard segments of the same chain
+  cdata.root_jacobian_ = calcToolJacobian(state);
+  Eigen::Vector3d tip = state.pose_estimate.translation();
+  for (int c=0; c<cdata.root_jacobian_.cols(); ++c)
+  {
+    Eigen::Vector3d angular = cdata.root_jacobian_.block<3,1>(3, c);
+    cdata.root_jacobian_.block<3,1>(0, c) -= angular.cross(tip);
+  }
+
+  // second pass writes the rows into the preallocated results
+  output.resize(rows, cols);
+  int row = 0;
   double dynamic_weight;
   for (std::map<std::string, LinkAvoidance>::const_iterator it = links_.begin(); it != links_.end(); ++it)
   {
-    DistanceInfoMap::const_iterator dit = cdata.distance_info_map_.find(it->second.link_name_);
-    if (dit != cdata.distance_info_map_.end() && dit->second.distance > 0)
+    const DistanceInfo *dist_info = cdata.getDistanceInfo(it->second);
+    if (dist_info && dist_info->distance > 0)
     {
-      dynamic_weight = std::exp(DYNAMIC_WEIGHT_FUNCTION_CONSTANT * (std::abs(dit->second.distance-cdata.distance_res_.minimum_distance.min_distance)/distance_threshold_));
-      constrained_ik::ConstraintResults tmp;
-      tmp.error = calcError(cdata, it->second) * it->second.weight_ * dynamic_weight;
-      tmp.jacobian = calcJacobian(cdata, it->second)  * it->second.weight_ * dynamic_weight;
-      tmp.status = checkStatus(cdata, it->second);
-      output.append(tmp);
+      dynamic_weight = std::exp(DYNAMIC_WEIGHT_FUNCTION_CONSTANT * (std::abs(dist_info->distance-cdata.distance_res_.minimum_distance.min_distance)/distance_threshold_));
+      output.error(row) = calcError(cdata, it->second)(0) * it->second.weight_ * dynamic_weight;
+      output.jacobian.row(row) = calcJacobian(cdata, it->second)  * it->second.weight_ * dynamic_weight;
+      output.status &= checkStatus(cdata, it->second);
+      row++;
     }
   }
 
@@ -202,13 +271,13 @@ ConstraintResults AvoidObstacles::evalConstraint(const SolverState &state) const
 VectorXd AvoidObstacles::calcError(const AvoidObstacles::AvoidObstaclesData &cdata, const LinkAvoidance &link) const
 {
   Eigen::VectorXd dist_err;
-  DistanceInfoMap::const_iterator it;
+  const DistanceInfo *dist_info;
 
   dist_err.resize(1,1);
-  it = cdata.distance_info_map_.find(link.link_name_);
-  if (it != cdata.distance_info_map_.end() && it->second.distance > 0)
+  dist_info = cdata.getDistanceInfo(link);
+  if (dist_info && dist_info->distance > 0)
   {
-    double dist = it->second.distance;
+    double dist = dist_info->distance;
     double scale_x = link.avoidance_distance_/(DEFAULT_ZERO_POINT + DEFAULT_SHIFT);
     double scale_y = link.amplitude_;
     dist_err(0, 0) = scale_y/(1.0 + std::exp((dist/scale_x) - DEFAULT_SHIFT));
@@ -222,30 +291,22 @@ VectorXd AvoidObstacles::calcError(const AvoidObstacles::AvoidObstaclesData &cda
 
 MatrixXd AvoidObstacles::calcJacobian(const AvoidObstacles::AvoidObstaclesData &cdata, const LinkAvoidance &link) const
 {
-  KDL::Jacobian link_jacobian(link.num_inboard_joints_); // 6xn Jacobian to link, then dist_info.link_point
   MatrixXd jacobian;
 
   // use distance info to find reference point on link which is closest to a collision,
-  // change the reference point of the link jacobian to that point
-  DistanceInfoMap::const_iterator it;
+  // the columns of the joints inboard to the link are those of the chain moved to that point
+  const DistanceInfo *dist_info;
   jacobian.setZero(1, link.num_robot_joints_);
-  it = cdata.distance_info_map_.find(link.link_name_);
-  if (it != cdata.distance_info_map_.end() && it->second.distance > 0)
+  dist_info = cdata.getDistanceInfo(link);
+  if (dist_info && dist_info->distance > 0)
   {
-    KDL::JntArray joint_array(link.num_inboard_joints_);
-    for(int i=0; i<link.num_inboard_joints_; i++)   joint_array(i) = cdata.state_.joints(i);
-    link.jac_solver_->JntToJac(joint_array, link_jacobian);// this computes a 6xn jacobian, we only need 3xn
-
-    // change the referece point to the point on the link closest to a collision
-    KDL::Vector link_point(it->second.link_point.x(), it->second.link_point.y(), it->second.link_point.z());
-    link_jacobian.changeRefPoint(link_point);
-    
-    MatrixXd j_tmp;
-    basic_kin::BasicKin::KDLToEigen(link_jacobian,j_tmp);
-    
     // The jacobian to improve distance only requires 1 redundant degree of freedom
-    // so we project the jacobian onto the avoidance vector.
-    jacobian.block(0, 0, 1, j_tmp.cols()) = it->second.avoidance_vector.transpose() * j_tmp.topRows(3);
+    // so we project the jacobian onto the avoidance vector, v + w x p projects to u.v + (p x u).w
+    const Eigen::Vector3d &direction = dist_info->avoidance_vector;
+    Eigen::Vector3d moment = dist_info->link_point.cross(direction);
+    jacobian.block(0, 0, 1, link.num_inboard_joints_) =
+        direction.transpose() * cdata.root_jacobian_.block(0, 0, 3, link.num_inboard_joints_) +
+        moment.transpose() * cdata.root_jacobian_.block(3, 0, 3, link.num_inboard_joints_);
   }
   else
   {
@@ -257,12 +318,12 @@ MatrixXd AvoidObstacles::calcJacobian(const AvoidObstacles::AvoidObstaclesData &
 
 bool AvoidObstacles::checkStatus(const AvoidObstacles::AvoidObstaclesData &cdata, const LinkAvoidance &link) const
 {                               // returns true if its ok to stop with current ik conditions
-  DistanceInfoMap::const_iterator it;
+  const DistanceInfo *dist_info;
 
-  it = cdata.distance_info_map_.find(link.link_name_);
-  if (it != cdata.distance_info_map_.end())
+  dist_info = cdata.getDistanceInfo(link);
+  if (dist_info)
   {
-    if(it->second.distance<link.min_distance_) return false;
+    if(dist_info->distance<link.min_distance_) return false;
   }
   else
   {
@@ -274,15 +335,24 @@ bool AvoidObstacles::checkStatus(const AvoidObstacles::AvoidObstaclesData &cdata
 
 AvoidObstacles::AvoidObstaclesData::AvoidObstaclesData(const SolverState &state, const AvoidObstacles *parent): ConstraintData(state), parent_(parent)
 {
-  DistanceRequest distance_req(true, false, parent_->link_models_, state_.planning_scene->getAllowedCollisionMatrix(), parent_->distance_threshold_);
-  distance_req.group_name = state.group_name;
+  DistanceRequest distance_req = parent_->distance_request_;
+  distance_req.acm = &state_.planning_scene->getAllowedCollisionMatrix();
+  distance_req.acm_bits = state_.acm_bits.get();
+  distance_req.sphere_model = parent_->getSphereModel(state_.robot_state->getRobotModel());
   distance_res_.clear();
   
   collision_detection::CollisionRequest collision_req;
   collision_detection::CollisionResult collision_res;
 
-  state.collision_robot->distanceSelf(distance_req, distance_res_, *state_.robot_state);
-  state.collision_world->distanceRobot(distance_req, distance_res_, *state_.collision_robot, *state_.robot_state);
+  if (state.distance_cache)
+  {
+    state.distance_cache->distance(distance_req, distance_res_, *state.collision_robot, *state.collision_world, *state_.robot_state);
+  }
+  else
+  {
+    state.collision_robot->distanceSelf(distance_req, distance_res_, *state_.robot_state);
+    state.collision_world->distanceRobot(distance_req, distance_res_, *state_.collision_robot, *state_.robot_state);
+  }
   if (distance_res_.collision)
   {
     collision_req.distance = false;
@@ -292,7 +362,7 @@ AvoidObstacles::AvoidObstaclesData::AvoidObstaclesData(const SolverState &state,
     state.collision_world->checkRobotCollision(collision_req, collision_res, *state.collision_robot, *state_.robot_state, state_.planning_scene->getAllowedCollisionMatrix());
   }
   Eigen::Affine3d tf = state_.robot_state->getGlobalLinkTransform(parent_->ik_->getKin().getRobotBaseLinkName()).inverse();
-  getDistanceInfo(distance_res_.distance, distance_info_map_, tf);
+  getDistanceInfo(distance_res_.distance, distance_info_, tf);
 }
 
 } // end namespace constraints
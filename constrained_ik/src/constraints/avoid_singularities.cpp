@@ -69,9 +69,12 @@ Eigen::VectorXd AvoidSingularities::calcError(const AvoidSingularities::AvoidSin
     VectorXd err(n);
     if (cdata.avoidance_enabled_)
     {
+        // the analytic partial derivatives of the jacobian are computed in one pass from the jacobian itself
+        std::vector<MatrixXd> derivatives;
+        basic_kin::BasicKin::calcJacobianDerivatives(cdata.jacobian_orig_, derivatives);
         for (size_t jntIdx=0; jntIdx<n; ++jntIdx)
         {
-            err(jntIdx) = (cdata.Ui_.transpose() * jacobianPartialDerivative(cdata, jntIdx) * cdata.Vi_)(0);
+            err(jntIdx) = cdata.Ui_.dot(derivatives[jntIdx] * cdata.Vi_);
         }
         err *= (weight_*cdata.smallest_sv_);
         err = err.cwiseMax(VectorXd::Constant(n,.25));
@@ -132,7 +135,7 @@ AvoidSingularities::AvoidSingularitiesData::AvoidSingularitiesData(const SolverS
   if (!parent->initialized_) return;
   parent_ = parent;
 
-  parent_->ik_->getKin().calcJacobian(state_.joints, jacobian_orig_);
+  jacobian_orig_ = parent_->calcToolJacobian(state_);
   Eigen::JacobiSVD<MatrixXd> svd(jacobian_orig_, Eigen::ComputeThinU | Eigen::ComputeThinV);
   Ui_ = svd.matrixU().rightCols(1);
   Vi_ = svd.matrixV().rightCols(1);
@@ -48,7 +48,7 @@ constrained_ik::ConstraintResults GoalMidJoint::evalConstraint(const SolverState
   GoalMidJoint::ConstraintData cdata(state);
 
   output.error = calcError(cdata);
-  output.jacobian = calcJacobian(cdata);
+  assignConstantJacobian(output);
   output.status = checkStatus(cdata);
 
   return output;
@@ -71,6 +71,7 @@ Eigen::MatrixXd GoalMidJoint::calcJacobian(const GoalMidJoint::ConstraintData &c
 void GoalMidJoint::init(const Constrained_IK *ik)
 {
   Constraint::init(ik);
+  setConstantJointJacobian(weight_);
 
   // initialize joint/thresholding limits
   MatrixXd joint_limits = ik->getKin().getLimits();
@@ -78,6 +79,13 @@ void GoalMidJoint::init(const Constrained_IK *ik)
   mid_range_ += joint_limits.col(0);
 }
 
+void GoalMidJoint::setWeight(double weight)
+{
+  weight_ = weight;
+  if (initialized_)
+    setConstantJointJacobian(weight_);
+}
+
 void GoalMidJoint::loadParameters(const XmlRpc::XmlRpcValue &constraint_xml)
 {
   XmlRpc::XmlRpcValue local_xml = constraint_xml;
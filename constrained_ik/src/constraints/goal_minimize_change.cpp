@@ -48,7 +48,7 @@ constrained_ik::ConstraintResults GoalMinimizeChange::evalConstraint(const Solve
   GoalMinimizeChange::ConstraintData cdata(state);
 
   output.error = calcError(cdata);
-  output.jacobian = calcJacobian(cdata);
+  assignConstantJacobian(output);
   output.status = checkStatus(cdata);
 
   return output;
@@ -68,6 +68,21 @@ Eigen::MatrixXd GoalMinimizeChange::calcJacobian(const GoalMinimizeChange::Const
     return J;
 }
 
+void GoalMinimizeChange::init(const Constrained_IK *ik)
+{
+  Constraint::init(ik);
+
+  // the jacobian does not depend on the joints
+  setConstantJointJacobian(weight_);
+}
+
+void GoalMinimizeChange::setWeight(double weight)
+{
+  weight_ = weight;
+  if (initialized_)
+    setConstantJointJacobian(weight_);
+}
+
 void GoalMinimizeChange::loadParameters(const XmlRpc::XmlRpcValue &constraint_xml)
 {
   XmlRpc::XmlRpcValue local_xml = constraint_xml;
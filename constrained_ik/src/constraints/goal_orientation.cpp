@@ -79,9 +79,7 @@ Eigen::VectorXd GoalOrientation::calcError(const GoalOrientation::GoalOrientatio
 // translate cartesian errors into joint-space errors
 Eigen::MatrixXd GoalOrientation::calcJacobian(const GoalOrientation::GoalOrientationData &cdata) const
 {
-  MatrixXd tmpJ;
-  if (!ik_->getKin().calcJacobian(cdata.state_.joints, tmpJ))
-    throw std::runtime_error("Failed to calculate Jacobian");
+  MatrixXd tmpJ = calcToolJacobian(cdata.state_);
   MatrixXd J = tmpJ.bottomRows(3);
 
   // weight each row of J
@@ -68,9 +68,7 @@ Eigen::VectorXd GoalPosition::calcError(const GoalPosition::GoalPositionData &cd
 // translate cartesian errors into joint-space errors
 Eigen::MatrixXd GoalPosition::calcJacobian(const GoalPosition::GoalPositionData &cdata) const
 {
-  MatrixXd tmpJ;
-  if (!ik_->getKin().calcJacobian(cdata.state_.joints, tmpJ))
-    throw std::runtime_error("Failed to calculate Jacobian");
+  MatrixXd tmpJ = calcToolJacobian(cdata.state_);
   MatrixXd  J = tmpJ.topRows(3);
 
   // weight each row of J
@@ -66,9 +66,7 @@ Eigen::VectorXd GoalToolOrientation::calcError(const GoalOrientation::GoalOrient
 // translate cartesian errors into joint-space errors
 Eigen::MatrixXd GoalToolOrientation::calcJacobian(const GoalOrientation::GoalOrientationData &cdata) const
 {
-  MatrixXd tmpJ;
-  if (!ik_->getKin().calcJacobian(cdata.state_.joints, tmpJ))
-    throw std::runtime_error("Failed to calculate Jacobian");
+  MatrixXd tmpJ = calcToolJacobian(cdata.state_);
 
   //rotate jacobian into tool frame by premultiplying by otR.transpose()
   MatrixXd J = cdata.state_.pose_estimate.rotation().transpose() * tmpJ.bottomRows(3);
@@ -71,10 +71,8 @@ Eigen::VectorXd GoalToolPointing::calcError(const GoalToolPointing::GoalToolPoin
 
 Eigen::MatrixXd GoalToolPointing::calcJacobian(const GoalToolPointing::GoalToolPointingData &cdata) const
 {
-  MatrixXd tmpJ, J, Jt, R;
-  
-  if (!ik_->getKin().calcJacobian(cdata.state_.joints, tmpJ))
-    throw std::runtime_error("Failed to calculate Jacobian");
+  MatrixXd tmpJ = calcToolJacobian(cdata.state_);
+  MatrixXd J, Jt, R;
 
   //rotate jacobian into tool frame by premultiplying by otR.transpose()
   R = cdata.state_.pose_estimate.rotation().transpose();
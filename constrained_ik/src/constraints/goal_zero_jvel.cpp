@@ -46,7 +46,7 @@ constrained_ik::ConstraintResults GoalZeroJVel::evalConstraint(const SolverState
   GoalZeroJVel::ConstraintData cdata(state);
 
   output.error = calcError(cdata);
-  output.jacobian = calcJacobian(cdata);
+  assignConstantJacobian(output);
   output.status = checkStatus(cdata);
 
   return output;
@@ -64,6 +64,21 @@ Eigen::MatrixXd GoalZeroJVel::calcJacobian(const GoalZeroJVel::ConstraintData &c
     return J;
 }
 
+void GoalZeroJVel::init(const Constrained_IK *ik)
+{
+  Constraint::init(ik);
+
+  // the jacobian does not depend on the joints
+  setConstantJointJacobian(weight_);
+}
+
+void GoalZeroJVel::setWeight(double weight)
+{
+  weight_ = weight;
+  if (initialized_)
+    setConstantJointJacobian(weight_);
+}
+
 void GoalZeroJVel::loadParameters(const XmlRpc::XmlRpcValue &constraint_xml)
 {
   XmlRpc::XmlRpcValue local_xml = constraint_xml;
@@ -51,6 +51,7 @@ constrained_ik::ConstraintResults JointVelLimits::evalConstraint(const SolverSta
 
   output.error = calcError(cdata);
   output.jacobian = calcJacobian(cdata);
+  output.selected_joints = cdata.limited_joints_;
   output.status = checkStatus(cdata);
 
   return output;
@@ -85,14 +86,7 @@ Eigen::MatrixXd JointVelLimits::calcJacobian(const JointVelLimits::JointVelLimit
   MatrixXd jacobian(nRows, numJoints());
 
   for (int ii=0; ii<nRows; ++ii)
-  {
-    size_t jntIdx = cdata.limited_joints_[ii];
-
-    VectorXd tmpRow = VectorXd::Zero(numJoints());
-    tmpRow(jntIdx) = 1.0;
-
-    jacobian.row(ii) = tmpRow * weight_;
-  }
+    jacobian.row(ii) = constant_jacobian_.row(cdata.limited_joints_[ii]);
 
   return jacobian;
 }
@@ -100,6 +94,7 @@ Eigen::MatrixXd JointVelLimits::calcJacobian(const JointVelLimits::JointVelLimit
 void JointVelLimits::init(const Constrained_IK *ik)
 {
   Constraint::init(ik);
+  setConstantJointJacobian(weight_);
 
   // initialize velocity limits
   vel_limits_.resize(numJoints());
@@ -107,6 +102,13 @@ void JointVelLimits::init(const Constrained_IK *ik)
       vel_limits_(ii) = 2*M_PI;  //TODO this should come from somewhere
 }
 
+void JointVelLimits::setWeight(const double &weight)
+{
+  weight_ = weight;
+  if (initialized_)
+    setConstantJointJacobian(weight_);
+}
+
 void JointVelLimits::loadParameters(const XmlRpc::XmlRpcValue &constraint_xml)
 {
   XmlRpc::XmlRpcValue local_xml = constraint_xml;
@@ -65,9 +65,7 @@ Eigen::VectorXd ToolPosition::calcError(const GoalPosition::GoalPositionData &cd
 // translate cartesian errors into joint-space errors
 Eigen::MatrixXd ToolPosition::calcJacobian(const GoalPosition::GoalPositionData &cdata) const
 {
-  MatrixXd tmpJ;
-  if (!ik_->getKin().calcJacobian(cdata.state_.joints, tmpJ))
-    throw std::runtime_error("Failed to calculate Jacobian");
+  MatrixXd tmpJ = calcToolJacobian(cdata.state_);
 
   //rotate jacobian into tool frame by premultiplying by otR.transpose()
   MatrixXd J = cdata.state_.pose_estimate.rotation().transpose() * tmpJ.topRows(3);
@@ -35,11 +35,15 @@
 #include <eigen_conversions/eigen_msg.h>
 #include <moveit/robot_state/conversions.h>
 #include <constrained_ik/basic_kin.h>
+#include <atomic>
+#include <future>
+#include <thread>
 
 namespace constrained_ik
 {
   CartesianPlanner::CartesianPlanner(const std::string &name, const std::string &group, const ros::NodeHandle &nh) :
     planning_interface::PlanningContext(name, group),
+    chunk_size_(DEFAULT_STREAMING_CHUNK_SIZE),
     terminate_(false),
     robot_description_("robot_description")
   {
@@ -47,6 +51,15 @@ namespace constrained_ik
     solver_.reset(new Constrained_IK(nh));
     std::string constraint_param = "constrained_ik_solver/" + getGroupName() + "/constraints";
     solver_->addConstraintsFromParamServer(constraint_param);
+
+    // the statistics of the IK solves are published on the diagnostics topic, disabled by default
+    double telemetry_period;
+    nh.param("constrained_ik_solver/" + getGroupName() + "/telemetry_period", telemetry_period, 0.0);
+    if (telemetry_period > 0)
+    {
+      solver_->setTelemetry(SolverTelemetryPtr(new SolverTelemetry()));
+      telemetry_publisher_.reset(new SolverTelemetryPublisher(nh, solver_->getTelemetry(), "Constrained IK " + name + ": " + getGroupName(), telemetry_period));
+    }
   }
 
   bool CartesianPlanner::initializeSolver()
@@ -62,7 +75,9 @@ namespace constrained_ik
     return true;
   }
 
-  void CartesianPlanner::setPlannerConfiguration(double translational_discretization_step, double orientational_discretization_step, bool debug_mode)
+  void CartesianPlanner::setPlannerConfiguration(double translational_discretization_step, double orientational_discretization_step, bool debug_mode,
+                                                 bool adaptive_discretization, double max_joint_step,
+                                                 double decimation_joint_tolerance, double decimation_cartesian_tolerance)
   {
     if (translational_discretization_step > 0)
       translational_discretization_step_ = translational_discretization_step;
@@ -74,14 +89,31 @@ namespace constrained_ik
     else
       ROS_WARN("Cartesian Planner orientational discretization step must be greater than zero.");
 
+    if (max_joint_step > 0)
+      max_joint_step_ = max_joint_step;
+    else
+      ROS_WARN("Cartesian Planner max joint step must be greater than zero.");
+
     debug_mode_ = debug_mode;
+    adaptive_discretization_ = adaptive_discretization;
+    decimation_.joint_tolerance = decimation_joint_tolerance;
+    decimation_.cartesian_tolerance = decimation_cartesian_tolerance;
+  }
+
+  void CartesianPlanner::setStreamingCallback(const TrajectoryChunkCallback &callback, unsigned chunk_size)
+  {
+    chunk_callback_ = callback;
+    chunk_size_ = std::max(1u, chunk_size);
   }
 
   void CartesianPlanner::resetPlannerConfiguration()
   {
     translational_discretization_step_ = DEFAULT_TRANSLATIONAL_DISCRETIZATION_STEP;
     orientational_discretization_step_ = DEFAULT_ORIENTATIONAL_DISCRETIZATION_STEP;
+    max_joint_step_ = DEFAULT_MAX_JOINT_STEP;
     debug_mode_ = false;
+    adaptive_discretization_ = false;
+    decimation_ = trajectory::TrajectoryDecimationParameters();
   }
 
   void CartesianPlanner::setSolverConfiguration(const ConstrainedIKConfiguration &config)
@@ -112,6 +144,7 @@ namespace constrained_ik
   {
     ros::WallTime start_time = ros::WallTime::now();
     robot_state::RobotStatePtr mid_state;
+    shared_trajectory_.reset();
     std::vector<std::string> joint_names, link_names;
     Eigen::Affine3d start_pose, goal_pose;
 
@@ -179,56 +212,129 @@ namespace constrained_ik
     ROS_DEBUG_NAMED("clik", "Setting Position pitch from %f to %f", start_pose.rotation().eulerAngles(3,2,1)(1),goal_pose.rotation().eulerAngles(3,2,1)(1));
     ROS_DEBUG_NAMED("clik", "Setting Position roll  from %f to %f", start_pose.rotation().eulerAngles(3,2,1)(2),goal_pose.rotation().eulerAngles(3,2,1)(2));
 
-    // Generate Interpolated Cartesian Poses
+    // Generate the path ratios of the interpolated cartesian poses, in adaptive mode the path is first sampled coarsely
+    // and the segments are subdivided during the solve down to the regular discretization.
     Eigen::Affine3d world_to_base = start_state.getGlobalLinkTransform(solver_->getKin().getRobotBaseLinkName()).inverse();
-    std::vector<Eigen::Affine3d, Eigen::aligned_allocator<Eigen::Affine3d> > poses = interpolateCartesian(
-        world_to_base*start_pose, world_to_base*goal_pose, translational_discretization_step_, orientational_discretization_step_);
+    Eigen::Affine3d base_start_pose = world_to_base*start_pose;
+    Eigen::Affine3d base_goal_pose = world_to_base*goal_pose;
+    unsigned steps = getCartesianSteps(base_start_pose, base_goal_pose, translational_discretization_step_, orientational_discretization_step_);
+    unsigned coarse_steps = steps;
+    if (adaptive_discretization_)
+      coarse_steps = std::max(1u, steps / ADAPTIVE_COARSE_STEP_FACTOR);
+
+    std::vector<double> pending; // path ratios left to solve, the next one is at the back
+    pending.reserve(coarse_steps);
+    for (unsigned i = coarse_steps; i > 0; --i)
+      pending.push_back(static_cast<double>(i) / coarse_steps);
 
     // Generate Cartesian Trajectory
-    int steps = poses.size();
+    double min_ratio = 1.0 / steps;
+    double ratio = 0.0;
     Eigen::VectorXd start_joints, joint_angles;
     bool found_ik;
+    constrained_ik::SceneContextPtr scene_context;
+    try
+    {
+      scene_context = solver_->createSceneContext(planning_scene_); // shared by the IK solves of every waypoint
+    }
+    catch (std::exception &e)
+    {
+      ROS_ERROR_STREAM("Caught exception from IK: " << e.what());
+      res.error_code_.val = moveit_msgs::MoveItErrorCodes::INVALID_MOTION_PLAN;
+      return false;
+    }
     mid_state = robot_model::RobotStatePtr(new robot_model::RobotState(start_state));
-    for (int j=0; j<steps; j++)
+    mid_state->copyJointGroupPositions(request_.group_name, start_joints);
+
+    // Every waypoint is validated when it is added so the trajectory does not need to be checked again afterwards
+    if (!isStateValid(*mid_state, request_.group_name, scene_context))
     {
-      if (j!=0)
+      ROS_INFO("Cartesian planner start state is not valid. :(");
+      res.error_code_.val = moveit_msgs::MoveItErrorCodes::INVALID_MOTION_PLAN;
+      return false;
+    }
+    traj->addSuffixWayPoint(*mid_state, 0.0);
+
+    // the cartesian tolerance bounds the deviation of the tip link from the straight line
+    trajectory::TrajectoryDecimationParameters decimation = decimation_;
+    decimation.tip_link = link_names.back();
+
+    // In streaming mode the waypoints after the last one handed out are decimated and handed out as a chunk
+    robot_trajectory::RobotTrajectoryPtr streamed_traj;
+    std::size_t streamed = 0;
+    auto stream_chunk = [&](bool last)
+    {
+      robot_trajectory::RobotTrajectory chunk(robot_model_, request_.group_name);
+      for (std::size_t i = streamed; i < traj->getWayPointCount(); ++i)
+        chunk.addSuffixWayPoint(traj->getWayPoint(i), 0.0);
+      streamed = traj->getWayPointCount() - 1;
+
+      if (decimation.isEnabled())
+        trajectory::decimateTrajectory(chunk, decimation, planning_scene_.get());
+
+      for (std::size_t i = streamed_traj->empty() ? 0 : 1; i < chunk.getWayPointCount(); ++i)
+        streamed_traj->addSuffixWayPoint(chunk.getWayPoint(i), 0.0);
+
+      return chunk_callback_(chunk, last);
+    };
+    if (chunk_callback_)
+      streamed_traj.reset(new robot_trajectory::RobotTrajectory(robot_model_, request_.group_name));
+
+    while (!pending.empty() && !terminate_)
+    {
+      double next_ratio = pending.back();
+      bool can_subdivide = adaptive_discretization_ && (next_ratio - ratio) > min_ratio * (1.0 + 1e-9);
+
+      //Do IK and report results
+      try
+      {
+        found_ik = solver_->calcInvKin(interpolatePose(base_start_pose, base_goal_pose, next_ratio), start_joints, scene_context, joint_angles);
+      }
+      catch (std::exception &e)
       {
-        mid_state->copyJointGroupPositions(request_.group_name, start_joints);
+        found_ik = false;
+        ROS_ERROR_STREAM("Caught exception from IK: " << e.what());
+      }
 
-        //Do IK and report results
-        try
-        {
-          found_ik = solver_->calcInvKin(poses[j], start_joints, planning_scene_, joint_angles);
-          mid_state->setJointGroupPositions(request_.group_name, joint_angles);
-          mid_state->update();
-        }
-        catch (std::exception &e)
+      // Subdivide the segment if the solve failed or the joints moved more than allowed over it
+      if (can_subdivide && (!found_ik || (joint_angles - start_joints).cwiseAbs().maxCoeff() > max_joint_step_))
+      {
+        pending.push_back(0.5 * (ratio + next_ratio));
+        continue;
+      }
+
+      if (found_ik)
+      {
+        mid_state->setJointGroupPositions(request_.group_name, joint_angles);
+        mid_state->update();
+      }
+
+      if (!found_ik || !isStateValid(*mid_state, request_.group_name, scene_context))
+      {
+        if (!debug_mode_)
         {
-          found_ik = false;
-          ROS_ERROR_STREAM("Caught exception from IK: " << e.what());
+          ROS_INFO("Cartesian planner was unable to find a valid solution. :(");
+          res.error_code_.val = moveit_msgs::MoveItErrorCodes::INVALID_MOTION_PLAN;
+          return false;
         }
-
-        if (!found_ik || planning_scene_->isStateColliding(*mid_state, request_.group_name))
+        else
         {
-          if (!debug_mode_)
-          {
-            ROS_INFO("Cartesian planner was unable to find a valid solution. :(");
-            res.error_code_.val = moveit_msgs::MoveItErrorCodes::INVALID_MOTION_PLAN;
-            return false;
-          }
-          else
-          {
-            break;
-          }
+          break;
         }
-        
-        
       }
+
       traj->addSuffixWayPoint(*mid_state, 0.0);
+      start_joints = joint_angles;
+      ratio = next_ratio;
+      pending.pop_back();
+
+      // the chunk that ends at the goal is handed out once the solve succeeded
+      if (streamed_traj && !pending.empty() && traj->getWayPointCount() - 1 - streamed >= chunk_size_ && !stream_chunk(false))
+      {
+        ROS_INFO("Cartesian planner streaming was stopped by the chunk receiver.");
+        terminate_ = true;
+      }
 
-      if (terminate_)
-        break;
-      
       res.planning_time_ = (ros::WallTime::now() - start_time).toSec();
       if (res.planning_time_ > request_.allowed_planning_time)
       {
@@ -246,60 +352,239 @@ namespace constrained_ik
       return false;
     }
 
-    // Check if traj is a collision free path
-    if (planning_scene_->isPathValid(*traj, request_.group_name))
+    ROS_INFO("Cartesian Trajectory is collision free! :)");
+    if (streamed_traj)
     {
-      ROS_INFO("Cartesian Trajectory is collision free! :)");
-      res.trajectory_=traj;
-      res.error_code_.val = moveit_msgs::MoveItErrorCodes::SUCCESS;
-      return true;
+      stream_chunk(true);
+      traj = streamed_traj;
     }
-    else
+    else if (decimation.isEnabled())
     {
-      ROS_INFO("Cartesian Trajectory is not collision free. :(");
-      res.error_code_.val = moveit_msgs::MoveItErrorCodes::INVALID_MOTION_PLAN;
+      std::size_t removed = trajectory::decimateTrajectory(*traj, decimation, planning_scene_.get());
+      ROS_DEBUG_NAMED("clik", "Decimation removed %lu of %lu waypoints", removed, removed + traj->getWayPointCount());
+    }
+    res.trajectory_=traj;
+    shared_trajectory_ = trajectory::makeSharedTrajectory(*traj);
+    res.error_code_.val = moveit_msgs::MoveItErrorCodes::SUCCESS;
+    return true;
+  }
+
+  bool CartesianPlanner::solvePath(const robot_state::RobotState &start_state,
+                                   const std::vector<Eigen::Affine3d, Eigen::aligned_allocator<Eigen::Affine3d> > &waypoints,
+                                   std::vector<Eigen::VectorXd> &joint_path,
+                                   moveit_msgs::MoveItErrorCodes &error_code)
+  {
+    ros::WallTime start_time = ros::WallTime::now();
+    error_code.val = moveit_msgs::MoveItErrorCodes::INVALID_MOTION_PLAN;
+    joint_path.clear();
+
+    if (!planning_scene_)
+    {
+      ROS_ERROR("Cartesian planner requires a planning scene to solve a path");
+      return false;
+    }
+
+    robot_model_ = planning_scene_->getRobotModel();
+    if(!solver_->isInitialized())
+      if (!initializeSolver())
+        return false;
+
+    const std::string &group = getGroupName();
+    Eigen::Affine3d world_to_base = start_state.getGlobalLinkTransform(solver_->getKin().getRobotBaseLinkName()).inverse();
+    Eigen::VectorXd start_joints;
+    start_state.copyJointGroupPositions(group, start_joints);
+    if (!planning_scene_->isStateValid(start_state, group))
+    {
+      ROS_INFO("Cartesian planner start state is not valid. :(");
+      return false;
+    }
+
+    constrained_ik::SceneContextPtr scene_context;
+    std::vector<Eigen::Affine3d, Eigen::aligned_allocator<Eigen::Affine3d> > base_waypoints;
+    std::vector<Eigen::VectorXd> coarse;
+    try
+    {
+      scene_context = solver_->createSceneContext(planning_scene_);
+
+      // Solve the waypoints one after the other, they seed the segments
+      const std::string &tip_link = robot_model_->getJointModelGroup(group)->getLinkModelNames().back();
+      base_waypoints.push_back(world_to_base*start_state.getGlobalLinkTransform(tip_link));
+      for (std::size_t i = 0; i < waypoints.size(); ++i)
+        base_waypoints.push_back(world_to_base*waypoints[i]);
+
+      coarse.push_back(start_joints);
+      for (std::size_t i = 1; i < base_waypoints.size(); ++i)
+      {
+        Eigen::VectorXd joint_angles;
+        if (!solver_->calcInvKin(base_waypoints[i], coarse.back(), scene_context, joint_angles))
+        {
+          ROS_INFO("Cartesian planner was unable to find a solution for waypoint %zu. :(", i - 1);
+          return false;
+        }
+        coarse.push_back(joint_angles);
+      }
+    }
+    catch (std::exception &e)
+    {
+      ROS_ERROR_STREAM("Caught exception from IK: " << e.what());
       return false;
     }
+
+    // Solve the segments concurrently, a segment holds the solutions after its first waypoint up to its last one
+    std::size_t num_segments = base_waypoints.size() - 1;
+    std::vector<std::vector<Eigen::VectorXd> > segments(num_segments);
+    std::atomic<std::size_t> next_segment(0);
+    std::atomic<bool> failed(false);
+    std::atomic<bool> timed_out(false);
+    auto worker = [&]()
+    {
+      robot_state::RobotState state(start_state);
+      constrained_ik::SceneContextPtr context = solver_->createSceneContext(planning_scene_);
+      for (std::size_t k = next_segment++; k < num_segments && !failed && !terminate_; k = next_segment++)
+      {
+        std::vector<Eigen::Affine3d, Eigen::aligned_allocator<Eigen::Affine3d> > poses = interpolateCartesian(
+            base_waypoints[k], base_waypoints[k + 1], translational_discretization_step_, orientational_discretization_step_);
+        std::vector<Eigen::VectorXd> &segment = segments[k];
+        segment.reserve(poses.size() - 1);
+        Eigen::VectorXd previous = coarse[k];
+        for (std::size_t j = 1; j < poses.size(); ++j)
+        {
+          Eigen::VectorXd joint_angles;
+          if (j + 1 == poses.size())
+            joint_angles = coarse[k + 1];
+          else if (!solver_->calcInvKin(poses[j], previous, context, joint_angles))
+          {
+            failed = true;
+            return;
+          }
+
+          state.setJointGroupPositions(group, joint_angles);
+          state.update();
+          if ((joint_angles - previous).cwiseAbs().maxCoeff() > max_joint_step_ || !isStateValid(state, group, context))
+          {
+            failed = true;
+            return;
+          }
+
+          segment.push_back(joint_angles);
+          previous = joint_angles;
+        }
+
+        if (request_.allowed_planning_time > 0 && (ros::WallTime::now() - start_time).toSec() > request_.allowed_planning_time)
+        {
+          timed_out = true;
+          failed = true;
+          return;
+        }
+      }
+    };
+
+    unsigned int num_threads = std::max(1u, std::min<unsigned int>(std::thread::hardware_concurrency(), num_segments));
+    std::vector<std::future<void> > workers;
+    try
+    {
+      for (unsigned int t = 0; t < num_threads; ++t)
+        workers.push_back(std::async(std::launch::async, worker));
+
+      for (auto &w : workers)
+        w.get();
+    }
+    catch (std::exception &e)
+    {
+      failed = true;
+      for (auto &w : workers)
+        if (w.valid())
+          w.wait();
+
+      ROS_ERROR_STREAM("Caught exception from IK: " << e.what());
+      return false;
+    }
+
+    if (terminate_)
+    {
+      ROS_INFO("Cartesian Trajectory was terminated!");
+      return false;
+    }
+
+    if (timed_out)
+    {
+      ROS_INFO("Cartesian planner was unable to find solution in allowed time. :(");
+      error_code.val = moveit_msgs::MoveItErrorCodes::TIMED_OUT;
+      return false;
+    }
+
+    if (failed)
+    {
+      ROS_INFO("Cartesian planner was unable to find a valid continuous solution. :(");
+      return false;
+    }
+
+    // Stitch the segments
+    std::size_t num_points = 1;
+    for (std::size_t k = 0; k < num_segments; ++k)
+      num_points += segments[k].size();
+
+    joint_path.reserve(num_points);
+    joint_path.push_back(start_joints);
+    for (std::size_t k = 0; k < num_segments; ++k)
+      joint_path.insert(joint_path.end(), segments[k].begin(), segments[k].end());
+
+    error_code.val = moveit_msgs::MoveItErrorCodes::SUCCESS;
+    return true;
   }
 
-  std::vector<Eigen::Affine3d, Eigen::aligned_allocator<Eigen::Affine3d> >
-  CartesianPlanner::interpolateCartesian(const Eigen::Affine3d& start,
-                                            const Eigen::Affine3d& stop,
-                                            double ds, double dt) const
+  unsigned CartesianPlanner::getCartesianSteps(const Eigen::Affine3d& start,
+                                               const Eigen::Affine3d& stop,
+                                               double ds, double dt) const
   {
-    // Required position change
     Eigen::Vector3d delta_translation = (stop.translation() - start.translation());
-    Eigen::Vector3d start_pos = start.translation();
-    Eigen::Affine3d stop_prime = start.inverse()*stop; //This the stop pose represented in the start pose coordinate system
-    Eigen::AngleAxisd delta_rotation(stop_prime.rotation());
-    //delta_rotation.fromRotationMatrix(stop_prime.rotation())
-
+    Eigen::AngleAxisd delta_rotation((start.inverse()*stop).rotation());
 
-    // Calculate number of steps
     unsigned steps_translation = static_cast<unsigned>(delta_translation.norm() / ds) + 1;
     unsigned steps_rotation = static_cast<unsigned>(delta_rotation.angle() / dt) + 1;
-    unsigned steps = std::max(steps_translation, steps_rotation);
+    return std::max(steps_translation, steps_rotation);
+  }
+
+  Eigen::Affine3d CartesianPlanner::interpolatePose(const Eigen::Affine3d& start, const Eigen::Affine3d& stop, double ratio) const
+  {
+    Eigen::Vector3d trans = start.translation() + ratio * (stop.translation() - start.translation());
+    Eigen::Quaterniond q = Eigen::Quaterniond(start.rotation()).slerp(ratio, Eigen::Quaterniond(stop.rotation()));
+    return Eigen::Affine3d(Eigen::Translation3d(trans) * q);
+  }
+
+  bool CartesianPlanner::isStateValid(const robot_state::RobotState &state, const std::string &group, const constrained_ik::SceneContextPtr &context) const
+  {
+    // the scene context casts the collision world and robot of every supported detector, only these are industrial
+    if (!context || !context->collision_world || !context->collision_robot ||
+        planning_scene_->getActiveCollisionDetectorName() != "IndustrialFCL")
+      return planning_scene_->isStateValid(state, group);
+
+    if (state.dirtyCollisionBodyTransforms())
+    {
+      robot_state::RobotState updated(state);
+      updated.updateCollisionBodyTransforms();
+      return isStateValid(updated, group, context);
+    }
+
+    if (context->collision_world->isRobotColliding(*context->collision_robot, state, group, &planning_scene_->getAllowedCollisionMatrix(),
+                                                   context->acm_bits.get()))
+      return false;
 
-    // Step size
-    Eigen::Vector3d step = delta_translation / steps;
+    return planning_scene_->isStateFeasible(state);
+  }
 
-    // Orientation interpolation
-    Eigen::Quaterniond start_q (start.rotation());
-    Eigen::Quaterniond stop_q (stop.rotation());
-    double slerp_ratio = 1.0 / steps;
+  std::vector<Eigen::Affine3d, Eigen::aligned_allocator<Eigen::Affine3d> >
+  CartesianPlanner::interpolateCartesian(const Eigen::Affine3d& start,
+                                            const Eigen::Affine3d& stop,
+                                            double ds, double dt) const
+  {
+    unsigned steps = getCartesianSteps(start, stop, ds, dt);
 
     std::vector<Eigen::Affine3d, Eigen::aligned_allocator<Eigen::Affine3d> > result;
-    Eigen::Vector3d trans;
-    Eigen::Quaterniond q;
-    Eigen::Affine3d pose;
     result.reserve(steps+1);
     for (unsigned i = 0; i <= steps; ++i)
-    {
-      trans = start_pos + step * i;
-      q = start_q.slerp(slerp_ratio * i, stop_q);
-      pose = (Eigen::Translation3d(trans) * q);
-      result.push_back(pose);
-    }
+      result.push_back(interpolatePose(start, stop, static_cast<double>(i) / steps));
+
     return result;
   }
 } //namespace constrained_ik
@@ -25,6 +25,8 @@
  */
 #include <constrained_ik/moveit_interface/constrained_ik_planner_plugin.h>
 #include <class_loader/class_loader.h>
+#include <moveit/kinematic_constraints/utils.h>
+#include <moveit/robot_state/conversions.h>
 
 const std::string JOINT_INTERP_PLANNER = "JointInterpolation"; /**< Joint interpolation planner name */
 const std::string CARTESIAN_PLANNER = "Cartesian"; /**< Cartesian plannner name */
@@ -58,9 +60,63 @@ namespace constrained_ik
     dynamic_reconfigure_server_.reset(new ManagerDynReconfigServer(mutex_, ros::NodeHandle(nh_, clik_mannager_param)));
     dynamic_reconfigure_server_->setCallback(boost::bind(&CLIKPlannerManager::managerDynamicReconfigureCallback, this, _1, _2));
 
+    // optionally plan once with every planner so that the first real request does not pay the cold start
+    bool warmup;
+    double warmup_time;
+    nh_.param("clik_startup/warmup", warmup, false);
+    nh_.param("clik_startup/warmup_time", warmup_time, 5.0);
+    if (warmup)
+      warmUp(model, warmup_time);
+
     return true;
   }
 
+  void CLIKPlannerManager::warmUp(const robot_model::RobotModelConstPtr &model, double allowed_planning_time)
+  {
+    planning_scene::PlanningScenePtr planning_scene(new planning_scene::PlanningScene(model));
+    for (auto &entry : planners_)
+    {
+      // the start is the default state, every joint moves a quarter of the way towards its upper bound
+      const std::string &group_name = entry.first.second;
+      const robot_model::JointModelGroup *group = model->getJointModelGroup(group_name);
+      robot_state::RobotState start_state(model);
+      start_state.setToDefaultValues();
+      start_state.update();
+      robot_state::RobotState goal_state(start_state);
+      for (const robot_model::JointModel *joint_model : group->getActiveJointModels())
+      {
+        if (joint_model->getVariableCount() != 1)
+          continue;
+
+        const robot_model::VariableBounds &bounds = joint_model->getVariableBounds()[0];
+        double position = start_state.getVariablePosition(joint_model->getFirstVariableIndex());
+        double target = bounds.position_bounded_ ? position + 0.25 * (bounds.max_position_ - position) : position + 0.5;
+        goal_state.setVariablePosition(joint_model->getFirstVariableIndex(), target);
+      }
+      goal_state.update();
+
+      moveit_msgs::MotionPlanRequest req;
+      req.group_name = group_name;
+      req.planner_id = entry.first.first;
+      req.allowed_planning_time = allowed_planning_time;
+      robot_state::robotStateToRobotStateMsg(start_state, req.start_state);
+      req.goal_constraints.push_back(kinematic_constraints::constructGoalConstraints(goal_state, group));
+
+      ros::WallTime start_time = ros::WallTime::now();
+      planning_interface::PlanningContextPtr planner = entry.second;
+      planner->clear();
+      planner->setPlanningScene(planning_scene);
+      planner->setMotionPlanRequest(req);
+      planning_interface::MotionPlanResponse res;
+      if (!planner->solve(res))
+        ROS_WARN("CLIK %s warm-up plan of group %s failed", entry.first.first.c_str(), group_name.c_str());
+
+      planner->clear();
+      ROS_INFO("CLIK %s warmed up group %s in %f seconds", entry.first.first.c_str(), group_name.c_str(),
+               (ros::WallTime::now() - start_time).toSec());
+    }
+  }
+
   void CLIKPlannerManager::getPlanningAlgorithms(std::vector<std::string> &algs) const
   {
     algs.clear();
@@ -132,7 +188,9 @@ namespace constrained_ik
       if (it->second->getName() == CARTESIAN_PLANNER)
       {
         std::shared_ptr<CartesianPlanner> planner = std::static_pointer_cast<CartesianPlanner>(it->second);
-        planner->setPlannerConfiguration(config_.translational_discretization_step, config_.orientational_discretization_step, config_.debug_mode);
+        planner->setPlannerConfiguration(config_.translational_discretization_step, config_.orientational_discretization_step, config_.debug_mode,
+                                         config_.adaptive_discretization, config_.max_joint_step,
+                                         config_.decimation_joint_tolerance, config_.decimation_cartesian_tolerance);
       }
 
     }
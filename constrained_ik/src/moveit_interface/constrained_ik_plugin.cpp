@@ -30,6 +30,11 @@
 #include <tf_conversions/tf_kdl.h>
 #include <eigen_conversions/eigen_kdl.h>
 #include <pluginlib/class_list_macros.h>
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <random>
+#include <thread>
 PLUGINLIB_EXPORT_CLASS(constrained_ik::ConstrainedIKPlugin, kinematics::KinematicsBase)
 
 using namespace KDL;
@@ -40,6 +45,39 @@ using namespace ros;
 namespace constrained_ik
 {
 
+const unsigned int SEARCH_MAX_THREADS = 4; /**< Maximum number of threads restarting searchPositionIK from random seeds */
+
+namespace
+{
+
+/**
+ * @brief Calls task(i) for every i in [0, count) on as many threads as there are cores, the first exception thrown by a
+ * task is rethrown once every thread finished.
+ * @param count the number of tasks
+ * @param task the task, it must be safe to call concurrently
+ */
+template<typename Task>
+void parallelFor(std::size_t count, const Task &task)
+{
+  std::atomic<std::size_t> next(0);
+  unsigned int num_threads = std::max(1u, std::min<unsigned int>(std::thread::hardware_concurrency(), count));
+  std::vector<std::future<void> > workers;
+  for (unsigned int t = 0; t < num_threads; ++t)
+    workers.push_back(std::async(std::launch::async, [&]()
+    {
+      for (std::size_t i = next++; i < count; i = next++)
+        task(i);
+    }));
+
+  for (auto &worker : workers)
+    worker.wait();
+
+  for (auto &worker : workers)
+    worker.get();
+}
+
+}
+
 ConstrainedIKPlugin::ConstrainedIKPlugin():active_(false), dimension_(0)
 {
 }
@@ -94,6 +132,13 @@ bool ConstrainedIKPlugin::initialize(const std::string& robot_description,
 
   // initializing planning scene
   planning_scene_.reset(new planning_scene::PlanningScene(robot_model_ptr_));
+  scene_contexts_.clear();
+
+  // the solutions of the recent poses seed the following solves, disabled by default
+  int solution_cache_size;
+  ros::NodeHandle nh;
+  nh.param("constrained_ik_solver/" + group_name + "/solution_cache_size", solution_cache_size, 0);
+  solution_cache_.setCapacity(std::max(solution_cache_size, 0));
 
   //initialize kinematic solver with robot info
   if (!kin_.init(joint_model_group))
@@ -122,9 +167,69 @@ bool ConstrainedIKPlugin::initialize(const std::string& robot_description,
     return false;
   }
 
+  // the statistics of the solves are published on the diagnostics topic, disabled by default
+  double telemetry_period;
+  nh.param("constrained_ik_solver/" + group_name + "/telemetry_period", telemetry_period, 0.0);
+  telemetry_publisher_.reset();
+  if (telemetry_period > 0)
+  {
+    solver_->setTelemetry(SolverTelemetryPtr(new SolverTelemetry()));
+    telemetry_publisher_.reset(new SolverTelemetryPublisher(nh, solver_->getTelemetry(), "Constrained IK kinematics: " + group_name, telemetry_period));
+  }
+
   return active_;
 }
 
+bool ConstrainedIKPlugin::calcInvKin(const Eigen::Affine3d &goal, const Eigen::VectorXd &seed, Eigen::VectorXd &joint_angles) const
+{
+  // take a scene context from the pool, or create one if they are all in use by concurrent solves
+  constrained_ik::SceneContextPtr scene_context;
+  {
+    boost::mutex::scoped_lock lock(scene_contexts_mutex_);
+    if (!scene_contexts_.empty())
+    {
+      scene_context = scene_contexts_.back();
+      scene_contexts_.pop_back();
+    }
+  }
+  if (!scene_context)
+    scene_context = solver_->createSceneContext(planning_scene_);
+
+  bool success = false;
+  try
+  {
+    success = solver_->calcInvKin(goal, seed, scene_context, joint_angles);
+  }
+  catch (exception &e)
+  {
+    boost::mutex::scoped_lock lock(scene_contexts_mutex_);
+    scene_contexts_.push_back(scene_context);
+    throw;
+  }
+
+  boost::mutex::scoped_lock lock(scene_contexts_mutex_);
+  scene_contexts_.push_back(scene_context);
+  return success;
+}
+
+Eigen::VectorXd ConstrainedIKPlugin::selectSeed(const Eigen::Affine3d &goal, const Eigen::VectorXd &seed, const std::vector<double> &consistency_limits) const
+{
+  Eigen::VectorXd cached;
+  double cached_distance;
+  if (!solution_cache_.findNearest(goal, cached, cached_distance))
+    return seed;
+
+  for(size_t ii=0; !consistency_limits.empty() && ii < dimension_; ++ii)
+    if (std::abs(cached(ii) - seed(ii)) > consistency_limits[ii])
+      return seed;
+
+  Eigen::Affine3d seed_pose;
+  if (kin_.calcFwdKin(seed, seed_pose) && solution_cache_.distance(goal, seed_pose) <= cached_distance)
+    return seed;
+
+  return cached;
+}
+
 bool ConstrainedIKPlugin::getPositionIK(const geometry_msgs::Pose &ik_pose,
                                         const std::vector<double> &ik_seed_state,
                                         std::vector<double> &solution,
@@ -160,7 +265,7 @@ bool ConstrainedIKPlugin::getPositionIK(const geometry_msgs::Pose &ik_pose,
   //Do IK and report results
   try
   {
-    if(!solver_->calcInvKin(goal, seed, planning_scene_, joint_angles))
+    if(!calcInvKin(goal, selectSeed(goal, seed, std::vector<double>()), joint_angles))
     {
       ROS_ERROR_STREAM("Unable to find IK solution.");
       error_code.val = error_code.NO_IK_SOLUTION;
@@ -173,6 +278,7 @@ bool ConstrainedIKPlugin::getPositionIK(const geometry_msgs::Pose &ik_pose,
     error_code.val = error_code.NO_IK_SOLUTION;
     return false;
   }
+  solution_cache_.insert(goal, joint_angles);
   solution.resize(dimension_);
   for(size_t ii=0; ii < dimension_; ++ii)
   {
@@ -245,49 +351,116 @@ bool ConstrainedIKPlugin::searchPositionIK( const geometry_msgs::Pose &ik_pose,
     ROS_ERROR("dimension_ and ik_seed_state are of different sizes");
     return(false);
   }
-  Eigen::VectorXd seed(dimension_), joint_angles;
+  if(!consistency_limits.empty() && consistency_limits.size() != dimension_)
+  {
+    ROS_ERROR("consistency_limits and ik_seed_state are of different sizes");
+    error_code.val = error_code.NO_IK_SOLUTION;
+    return false;
+  }
+  Eigen::VectorXd seed(dimension_);
   for(size_t ii=0; ii < dimension_; ii++)
   {
     seed(ii) = ik_seed_state[ii];
   }
-
-  //Do the IK
-  bool success(true);
-  try
+  ros::WallTime deadline = ros::WallTime::now() + ros::WallDuration(std::max(timeout, 0.0));
+
+  // the first solution within the consistency limits that passes the callback wins, the callback is not assumed to
+  // be thread safe
+  boost::mutex result_mutex;
+  std::atomic<bool> found(false);
+  std::vector<double> found_solution;
+  auto attempt = [&](const Eigen::VectorXd &attempt_seed) -> bool
   {
-    if(!solver_->calcInvKin(goal, seed, planning_scene_, joint_angles))
+    Eigen::VectorXd joint_angles;
+    if (found || !calcInvKin(goal, attempt_seed, joint_angles))
+      return false;
+
+    for(size_t ii=0; !consistency_limits.empty() && ii < dimension_; ++ii)
+      if (std::abs(joint_angles(ii) - seed(ii)) > consistency_limits[ii])
+        return false;
+
+    std::vector<double> candidate(joint_angles.data(), joint_angles.data() + joint_angles.size());
+    boost::mutex::scoped_lock lock(result_mutex);
+    if (found)
+      return false;
+
+    if (solution_callback)
     {
-      ROS_ERROR_STREAM("Unable to find IK solution.");
-      error_code.val = error_code.NO_IK_SOLUTION;
-      success &= false;
+      moveit_msgs::MoveItErrorCodes callback_error_code;
+      solution_callback(ik_pose, candidate, callback_error_code);
+      if(callback_error_code.val != callback_error_code.SUCCESS)
+        return false;
     }
+
+    found_solution.swap(candidate);
+    found = true;
+    return true;
+  };
+
+  //Do the IK from the seed, then restart from random seeds on a few threads until the timeout
+  try
+  {
+    attempt(selectSeed(goal, seed, consistency_limits));
   }
   catch (exception &e)
   {
     ROS_ERROR_STREAM("Caught exception from IK: " << e.what());
     error_code.val = error_code.NO_IK_SOLUTION;
-    success &= false;
+    solution = ik_seed_state;
+    return false;
   }
 
-  solution.resize(dimension_);
-  for(size_t ii=0; ii < dimension_; ++ii)
+  if (!found && ros::WallTime::now() < deadline)
   {
-    solution[ii] = joint_angles(ii);
+    Eigen::MatrixXd limits = kin_.getLimits();
+    unsigned int num_threads = std::max(1u, std::min(SEARCH_MAX_THREADS, std::thread::hardware_concurrency()));
+    std::vector<std::future<void> > workers;
+    for (unsigned int t = 0; t < num_threads; ++t)
+    {
+      workers.push_back(std::async(std::launch::async, [&, t]()
+      {
+        // the restarts are sampled within the joint limits, and within the consistency limits of the seed if given
+        std::mt19937 generator(t);
+        Eigen::VectorXd restart_seed(dimension_);
+        try
+        {
+          while (!found && ros::WallTime::now() < deadline)
+          {
+            for(size_t ii=0; ii < dimension_; ++ii)
+            {
+              double lower = limits(ii, 0), upper = limits(ii, 1);
+              if (!consistency_limits.empty())
+              {
+                lower = std::max(lower, seed(ii) - consistency_limits[ii]);
+                upper = std::min(upper, seed(ii) + consistency_limits[ii]);
+              }
+              restart_seed(ii) = std::uniform_real_distribution<double>(lower, std::max(lower, upper))(generator);
+            }
+            attempt(restart_seed);
+          }
+        }
+        catch (exception &e)
+        {
+          ROS_ERROR_STREAM("Caught exception from IK: " << e.what());
+        }
+      }));
+    }
+    for (auto &worker : workers)
+      worker.get();
   }
 
-  // If there is a solution callback registered, check before returning
-  if (solution_callback)
+  if (!found)
   {
-    solution_callback(ik_pose, solution, error_code);
-    if(error_code.val != error_code.SUCCESS)
-      success &= false;
+    ROS_ERROR_STREAM("Unable to find IK solution.");
+    error_code.val = error_code.NO_IK_SOLUTION;
+    solution = ik_seed_state;
+    return false;
   }
-  // Default: return successfully
-  if (success)
-    error_code.val = error_code.SUCCESS;
-
-  return success;
 
+  solution_cache_.insert(goal, Eigen::Map<const Eigen::VectorXd>(found_solution.data(), found_solution.size()));
+  solution = found_solution;
+  error_code.val = error_code.SUCCESS;
+  return true;
 }
 
 bool ConstrainedIKPlugin::getPositionFK(const std::vector<std::string> &link_names,
@@ -327,6 +500,98 @@ bool ConstrainedIKPlugin::getPositionFK(const std::vector<std::string> &link_nam
   return valid;
 }
 
+bool ConstrainedIKPlugin::getPositionIKBatch(const std::vector<geometry_msgs::Pose> &ik_poses,
+                                             const std::vector<double> &ik_seed_state,
+                                             std::vector<std::vector<double> > &solutions,
+                                             std::vector<moveit_msgs::MoveItErrorCodes> &error_codes) const
+{
+  solutions.assign(ik_poses.size(), std::vector<double>());
+  error_codes.assign(ik_poses.size(), moveit_msgs::MoveItErrorCodes());
+  for (auto &error_code : error_codes)
+    error_code.val = error_code.NO_IK_SOLUTION;
+
+  if(!active_)
+  {
+    ROS_ERROR("kinematics not active");
+    return false;
+  }
+  if(ik_seed_state.size() != dimension_)
+  {
+    ROS_ERROR("ik_seed_state does not have same dimension as solver");
+    return false;
+  }
+
+  Eigen::VectorXd seed(dimension_);
+  for(size_t ii=0; ii < dimension_; ++ii)
+  {
+    seed(ii) = ik_seed_state[ii];
+  }
+
+  // every pose writes its own solution and error code, the scene contexts come from the pool
+  std::atomic<std::size_t> num_solved(0);
+  parallelFor(ik_poses.size(), [&](std::size_t i)
+  {
+    KDL::Frame pose_desired;
+    tf::poseMsgToKDL(ik_poses[i], pose_desired);
+    Eigen::Affine3d goal;
+    tf::transformKDLToEigen(pose_desired, goal);
+
+    Eigen::VectorXd joint_angles;
+    try
+    {
+      if(!calcInvKin(goal, selectSeed(goal, seed, std::vector<double>()), joint_angles))
+        return;
+    }
+    catch (exception &e)
+    {
+      ROS_DEBUG_STREAM("Caught exception from IK: " << e.what());
+      return;
+    }
+
+    solution_cache_.insert(goal, joint_angles);
+    solutions[i].assign(joint_angles.data(), joint_angles.data() + joint_angles.size());
+    error_codes[i].val = error_codes[i].SUCCESS;
+    ++num_solved;
+  });
+
+  return num_solved == ik_poses.size();
+}
+
+bool ConstrainedIKPlugin::getPositionFKBatch(const std::vector<std::string> &link_names,
+                                             const std::vector<std::vector<double> > &joint_angles,
+                                             std::vector<std::vector<geometry_msgs::Pose> > &poses) const
+{
+  poses.assign(joint_angles.size(), std::vector<geometry_msgs::Pose>());
+  if(!active_)
+  {
+    ROS_ERROR("kinematics not active");
+    return false;
+  }
+
+  std::atomic<bool> valid(true);
+  parallelFor(joint_angles.size(), [&](std::size_t i)
+  {
+    if (joint_angles[i].size() != dimension_)
+    {
+      valid = false;
+      return;
+    }
+
+    Eigen::VectorXd jnt_pos_in = Eigen::Map<const Eigen::VectorXd>(joint_angles[i].data(), dimension_);
+    std::vector<KDL::Frame> kdl_poses;
+    if (!kin_.linkTransforms(jnt_pos_in, kdl_poses, link_names))
+      valid = false;
+
+    poses[i].resize(kdl_poses.size());
+    for(size_t ii=0; ii < kdl_poses.size(); ++ii)
+    {
+      tf::poseKDLToMsg(kdl_poses[ii], poses[i][ii]);
+    }
+  });
+
+  return valid;
+}
+
 const std::vector<std::string>& ConstrainedIKPlugin::getJointNames() const
 {
   isActive();
@@ -34,6 +34,7 @@
 #include <eigen3/Eigen/Core>
 #include <eigen_conversions/eigen_msg.h>
 #include <moveit/robot_state/conversions.h>
+#include <moveit/robot_model/revolute_joint_model.h>
 
 
 namespace constrained_ik
@@ -116,6 +117,10 @@ namespace constrained_ik
       }
     }
 
+    // Interpolate the group joint vectors directly when they interpolate linearly
+    if (isLinearlyInterpolable(group_model))
+      return solveJointSpace(start_state, goal_state, start_time, res);
+
     // Calculate delta for for moveit interpolation function
     double dt;
     Eigen::VectorXd jv_step;
@@ -178,6 +183,83 @@ namespace constrained_ik
     }
   }
 
+  bool JointInterpolationPlanner::isLinearlyInterpolable(const robot_model::JointModelGroup *group_model) const
+  {
+    const std::vector<const robot_model::JointModel*> &joint_models = group_model->getActiveJointModels();
+    for (std::size_t i = 0; i < joint_models.size(); ++i)
+    {
+      const robot_model::JointModel *joint_model = joint_models[i];
+      if (joint_model->getType() == robot_model::JointModel::PRISMATIC)
+        continue;
+
+      if (joint_model->getType() == robot_model::JointModel::REVOLUTE &&
+          !static_cast<const robot_model::RevoluteJointModel*>(joint_model)->isContinuous())
+        continue;
+
+      return false;
+    }
+    return true;
+  }
+
+  bool JointInterpolationPlanner::solveJointSpace(const robot_state::RobotState &start_state, const robot_state::RobotState &goal_state,
+                                                  const ros::WallTime &start_time, planning_interface::MotionPlanResponse &res)
+  {
+    Eigen::VectorXd jv_start, jv_goal;
+    start_state.copyJointGroupPositions(request_.group_name, jv_start);
+    goal_state.copyJointGroupPositions(request_.group_name, jv_goal);
+    Eigen::VectorXd delta = jv_goal - jv_start;
+
+    // Generate Path, the buffer holds one waypoint per column
+    int steps = (delta.cwiseAbs().maxCoeff() / joint_discretization_step_) + 1;
+    Eigen::MatrixXd path(jv_start.size(), steps + 1);
+    for (int j=0; j<steps; j++)
+      path.col(j) = jv_start + delta * (static_cast<double>(j) / steps);
+    path.col(steps) = jv_goal;
+
+    // Check the whole path with a single state before creating the trajectory
+    robot_state::RobotState mid_state(start_state);
+    for (int j=0; j<=steps; j++)
+    {
+      mid_state.setJointGroupPositions(request_.group_name, path.col(j).eval());
+      mid_state.update();
+      if (!planning_scene_->isStateValid(mid_state, request_.group_name))
+      {
+        ROS_INFO("Joint interpolated trajectory is not collision free. :(");
+        res.error_code_.val = moveit_msgs::MoveItErrorCodes::INVALID_MOTION_PLAN;
+        return false;
+      }
+
+      if (terminate_)
+      {
+        ROS_INFO("Joint Interpolated Planner was terminated!");
+        res.error_code_.val = moveit_msgs::MoveItErrorCodes::INVALID_MOTION_PLAN;
+        return false;
+      }
+
+      res.planning_time_ = (ros::WallTime::now() - start_time).toSec();
+      if (res.planning_time_ > request_.allowed_planning_time)
+      {
+        ROS_ERROR("Joint Interpolated Planner timed out. :(");
+        res.error_code_.val = moveit_msgs::MoveItErrorCodes::TIMED_OUT;
+        return false;
+      }
+    }
+
+    robot_trajectory::RobotTrajectoryPtr traj(new robot_trajectory::RobotTrajectory(planning_scene_->getRobotModel(), request_.group_name));
+    for (int j=0; j<=steps; j++)
+    {
+      robot_state::RobotStatePtr waypoint(new robot_state::RobotState(start_state));
+      waypoint->setJointGroupPositions(request_.group_name, path.col(j).eval());
+      waypoint->update();
+      traj->addSuffixWayPoint(waypoint, 0.0);
+    }
+
+    ROS_INFO("Joint Interpolated Planner generated a collision-free trajectory with %i points! :)",steps);
+    res.trajectory_=traj;
+    res.error_code_.val = moveit_msgs::MoveItErrorCodes::SUCCESS;
+    return true;
+  }
+
   void JointInterpolationPlanner::setPlannerConfiguration(double joint_discretization_step, bool debug_mode)
   {
     if (joint_discretization_step > 0)
@@ -0,0 +1,106 @@
+/**
+ * @file solution_cache.cpp
+ * @brief Bounded cache of the recent inverse kinematics solutions
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "constrained_ik/solution_cache.h"
+#include <limits>
+
+namespace constrained_ik
+{
+
+SolutionCache::SolutionCache(std::size_t capacity, double rotation_weight) : capacity_(capacity), next_(0), rotation_weight_(rotation_weight)
+{
+}
+
+void SolutionCache::setCapacity(std::size_t capacity)
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  capacity_ = capacity;
+  poses_.clear();
+  joints_.clear();
+  next_ = 0;
+}
+
+std::size_t SolutionCache::getCapacity() const
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  return capacity_;
+}
+
+void SolutionCache::insert(const Eigen::Affine3d &pose, const Eigen::VectorXd &joints)
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  if (capacity_ == 0)
+    return;
+
+  if (poses_.size() < capacity_)
+  {
+    poses_.push_back(pose);
+    joints_.push_back(joints);
+  }
+  else
+  {
+    poses_[next_] = pose;
+    joints_[next_] = joints;
+  }
+  next_ = (next_ + 1) % capacity_;
+}
+
+bool SolutionCache::findNearest(const Eigen::Affine3d &pose, Eigen::VectorXd &joints, double &distance) const
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  std::size_t nearest = poses_.size();
+  distance = std::numeric_limits<double>::max();
+  for (std::size_t i = 0; i < poses_.size(); ++i)
+  {
+    double d = this->distance(pose, poses_[i]);
+    if (d < distance)
+    {
+      distance = d;
+      nearest = i;
+    }
+  }
+
+  if (nearest == poses_.size())
+    return false;
+
+  joints = joints_[nearest];
+  return true;
+}
+
+double SolutionCache::distance(const Eigen::Affine3d &p1, const Eigen::Affine3d &p2) const
+{
+  Eigen::AngleAxisd rotation(p1.rotation().transpose() * p2.rotation());
+  return (p2.translation() - p1.translation()).norm() + rotation_weight_ * rotation.angle();
+}
+
+void SolutionCache::clear()
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  poses_.clear();
+  joints_.clear();
+  next_ = 0;
+}
+
+} // namespace constrained_ik
@@ -46,8 +46,11 @@ void SolverState::reset(const Eigen::Affine3d &goal, const Eigen::VectorXd &join
   this->joints_delta = VectorXd::Zero(joint_seed.size());
   this->primary_sum = 0.0;
   this->auxiliary_sum = 0.0;
+  this->auxiliary_error = std::numeric_limits<double>::max();
   this->auxiliary_at_limit = false;
   this->pose_estimate = Affine3d::Identity();
+  this->jacobian.resize(0, 0);
+  this->requirements = state_requirements::PoseEstimate;
   this->condition = initialization_state::NothingInitialized;
 }
 
@@ -0,0 +1,290 @@
+/**
+ * @file solver_telemetry.cpp
+ * @brief Timing and convergence statistics of the Constrained_IK solves
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "constrained_ik/solver_telemetry.h"
+#include "constrained_ik/constraint.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <typeinfo>
+#include <boost/core/demangle.hpp>
+#include <diagnostic_msgs/DiagnosticArray.h>
+
+namespace constrained_ik
+{
+
+namespace
+{
+
+/** @brief The shard last used by a thread, it is looked up again when the thread records into another telemetry */
+struct ShardCache
+{
+  uint64_t id;  /**< The id of the telemetry of the shard, zero if none */
+  void *shard;  /**< The shard */
+};
+
+thread_local ShardCache shard_cache = {0, nullptr};
+
+std::atomic<uint64_t> next_telemetry_id(1);
+
+/** @brief The names of the termination reasons in the diagnostics */
+const char* const TERMINATION_NAMES[solver_termination::NumTerminations] = {
+  "Converged", "Converged at auxiliary limit", "Joint convergence", "Iteration limit", "Motion limit", "Error"};
+
+/**
+ * @brief Creates a diagnostic key value
+ * @param key the key
+ * @param value the value
+ * @return The key value
+ */
+diagnostic_msgs::KeyValue makeKeyValue(const std::string &key, double value)
+{
+  char buffer[32];
+  std::snprintf(buffer, sizeof(buffer), "%.1f", value);
+  diagnostic_msgs::KeyValue key_value;
+  key_value.key = key;
+  key_value.value = buffer;
+  return key_value;
+}
+
+/**
+ * @brief Creates a diagnostic key value
+ * @param key the key
+ * @param value the value
+ * @return The key value
+ */
+diagnostic_msgs::KeyValue makeKeyValue(const std::string &key, uint64_t value)
+{
+  diagnostic_msgs::KeyValue key_value;
+  key_value.key = key;
+  key_value.value = std::to_string(value);
+  return key_value;
+}
+
+} // namespace
+
+TelemetryHistogram::TelemetryHistogram() : count(0), sum(0.0), max(0.0)
+{
+  bins.fill(0);
+}
+
+void TelemetryHistogram::add(double value)
+{
+  int bin = value < 1.0 ? 0 : std::min(std::ilogb(value) + 1, NUM_BINS - 1);
+  ++bins[bin];
+  ++count;
+  sum += value;
+  max = std::max(max, value);
+}
+
+void TelemetryHistogram::merge(const TelemetryHistogram &other)
+{
+  for (int i = 0; i < NUM_BINS; ++i)
+    bins[i] += other.bins[i];
+
+  count += other.count;
+  sum += other.sum;
+  max = std::max(max, other.max);
+}
+
+double TelemetryHistogram::mean() const
+{
+  return count == 0 ? 0.0 : sum/count;
+}
+
+double TelemetryHistogram::quantile(double q) const
+{
+  uint64_t rank = std::max<uint64_t>(1, std::ceil(std::min(std::max(q, 0.0), 1.0)*count));
+  uint64_t seen = 0;
+  for (int i = 0; i < NUM_BINS - 1; ++i)
+  {
+    seen += bins[i];
+    if (seen >= rank)
+      return std::min(max, std::ldexp(1.0, i));
+  }
+  return max;
+}
+
+SolverTelemetrySnapshot::SolverTelemetrySnapshot()
+{
+  terminations.fill(0);
+}
+
+/** @brief The statistics recorded by one thread */
+struct SolverTelemetry::Shard
+{
+  boost::mutex mutex;                                             /**< Taken by the recording thread and by getSnapshot() and clear() */
+  SolverTelemetrySnapshot statistics;                             /**< The statistics except the constraints */
+  std::map<const Constraint*, ConstraintTelemetry> constraints;   /**< The statistics of the constraints by address */
+};
+
+SolverTelemetry::SolverTelemetry() : id_(next_telemetry_id++)
+{
+}
+
+SolverTelemetry::~SolverTelemetry()
+{
+}
+
+void SolverTelemetry::recordSolve(double seconds, int iterations, solver_termination::SolverTermination termination)
+{
+  Shard &shard = getShard();
+  boost::mutex::scoped_lock lock(shard.mutex);
+  shard.statistics.solve_time.add(seconds*1e6);
+  shard.statistics.iterations.add(iterations);
+  ++shard.statistics.terminations[termination];
+}
+
+void SolverTelemetry::recordDecomposition(double seconds)
+{
+  Shard &shard = getShard();
+  boost::mutex::scoped_lock lock(shard.mutex);
+  shard.statistics.decomposition_time.add(seconds*1e6);
+}
+
+void SolverTelemetry::recordConstraint(const Constraint *constraint, double seconds)
+{
+  Shard &shard = getShard();
+  boost::mutex::scoped_lock lock(shard.mutex);
+  auto it = shard.constraints.find(constraint);
+  if (it == shard.constraints.end())
+  {
+    it = shard.constraints.insert(std::make_pair(constraint, ConstraintTelemetry())).first;
+    it->second.name = boost::core::demangle(typeid(*constraint).name());
+  }
+  it->second.eval_time.add(seconds*1e6);
+}
+
+SolverTelemetrySnapshot SolverTelemetry::getSnapshot() const
+{
+  SolverTelemetrySnapshot snapshot;
+  std::map<const Constraint*, ConstraintTelemetry> constraints;
+  boost::mutex::scoped_lock lock(mutex_);
+  for (const auto &entry : shards_)
+  {
+    Shard &shard = *entry.second;
+    boost::mutex::scoped_lock shard_lock(shard.mutex);
+    snapshot.solve_time.merge(shard.statistics.solve_time);
+    snapshot.iterations.merge(shard.statistics.iterations);
+    snapshot.decomposition_time.merge(shard.statistics.decomposition_time);
+    for (int i = 0; i < solver_termination::NumTerminations; ++i)
+      snapshot.terminations[i] += shard.statistics.terminations[i];
+
+    for (const auto &constraint : shard.constraints)
+    {
+      ConstraintTelemetry &merged = constraints[constraint.first];
+      merged.name = constraint.second.name;
+      merged.eval_time.merge(constraint.second.eval_time);
+    }
+  }
+
+  for (const auto &constraint : constraints)
+    snapshot.constraints.push_back(constraint.second);
+
+  std::stable_sort(snapshot.constraints.begin(), snapshot.constraints.end(),
+                   [](const ConstraintTelemetry &a, const ConstraintTelemetry &b) { return a.name < b.name; });
+  return snapshot;
+}
+
+void SolverTelemetry::clear()
+{
+  // the shards are kept, the threads cache their address
+  boost::mutex::scoped_lock lock(mutex_);
+  for (const auto &entry : shards_)
+  {
+    boost::mutex::scoped_lock shard_lock(entry.second->mutex);
+    entry.second->statistics = SolverTelemetrySnapshot();
+    entry.second->constraints.clear();
+  }
+}
+
+SolverTelemetry::Shard& SolverTelemetry::getShard()
+{
+  if (shard_cache.id == id_)
+    return *static_cast<Shard*>(shard_cache.shard);
+
+  boost::mutex::scoped_lock lock(mutex_);
+  std::unique_ptr<Shard> &shard = shards_[std::this_thread::get_id()];
+  if (!shard)
+    shard.reset(new Shard());
+
+  shard_cache.id = id_;
+  shard_cache.shard = shard.get();
+  return *shard;
+}
+
+diagnostic_msgs::DiagnosticStatus toDiagnosticStatus(const SolverTelemetrySnapshot &snapshot, const std::string &name)
+{
+  using namespace solver_termination;
+  diagnostic_msgs::DiagnosticStatus status;
+  status.level = diagnostic_msgs::DiagnosticStatus::OK;
+  status.name = name;
+
+  uint64_t failed = snapshot.terminations[IterationLimit] + snapshot.terminations[MotionLimit] + snapshot.terminations[Error];
+  char message[64];
+  std::snprintf(message, sizeof(message), "%lu solves, %lu failed", static_cast<unsigned long>(snapshot.solve_time.count),
+                static_cast<unsigned long>(failed));
+  status.message = message;
+
+  status.values.push_back(makeKeyValue("Solves", snapshot.solve_time.count));
+  status.values.push_back(makeKeyValue("Solve time mean [us]", snapshot.solve_time.mean()));
+  status.values.push_back(makeKeyValue("Solve time p99 [us]", snapshot.solve_time.quantile(0.99)));
+  status.values.push_back(makeKeyValue("Solve time max [us]", snapshot.solve_time.max));
+  status.values.push_back(makeKeyValue("Iterations mean", snapshot.iterations.mean()));
+  status.values.push_back(makeKeyValue("Iterations p99", snapshot.iterations.quantile(0.99)));
+  status.values.push_back(makeKeyValue("Iterations max", snapshot.iterations.max));
+  status.values.push_back(makeKeyValue("Decompositions", snapshot.decomposition_time.count));
+  status.values.push_back(makeKeyValue("Decomposition time mean [us]", snapshot.decomposition_time.mean()));
+  for (int i = 0; i < NumTerminations; ++i)
+    status.values.push_back(makeKeyValue(TERMINATION_NAMES[i], snapshot.terminations[i]));
+
+  for (const auto &constraint : snapshot.constraints)
+  {
+    status.values.push_back(makeKeyValue(constraint.name + " evaluations", constraint.eval_time.count));
+    status.values.push_back(makeKeyValue(constraint.name + " mean [us]", constraint.eval_time.mean()));
+    status.values.push_back(makeKeyValue(constraint.name + " p99 [us]", constraint.eval_time.quantile(0.99)));
+  }
+  return status;
+}
+
+SolverTelemetryPublisher::SolverTelemetryPublisher(ros::NodeHandle nh, const SolverTelemetryPtr &telemetry,
+                                                   const std::string &name, double period) :
+  telemetry_(telemetry),
+  name_(name)
+{
+  publisher_ = nh.advertise<diagnostic_msgs::DiagnosticArray>("/diagnostics", 1);
+  timer_ = nh.createTimer(ros::Duration(period), &SolverTelemetryPublisher::publish, this);
+}
+
+void SolverTelemetryPublisher::publish(const ros::TimerEvent&)
+{
+  diagnostic_msgs::DiagnosticArray msg;
+  msg.header.stamp = ros::Time::now();
+  msg.status.push_back(toDiagnosticStatus(telemetry_->getSnapshot(), name_));
+  publisher_.publish(msg);
+}
+
+} // namespace constrained_ik
@@ -0,0 +1,120 @@
+/**
+ * @file solver_trace.cpp
+ * @brief Bounded trace of the Constrained_IK solver iterations
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "constrained_ik/solver_trace.h"
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <ros/ros.h>
+
+namespace constrained_ik
+{
+
+SolverTrace::SolverTrace(std::size_t capacity, int num_joints) : next_(0), size_(0), num_joints_(num_joints), num_solves_(0)
+{
+  records_.resize(capacity);
+  for (auto &record : records_)
+    record.joints.setZero(num_joints);
+}
+
+int SolverTrace::beginSolve()
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  return num_solves_++;
+}
+
+void SolverTrace::record(int solve, int iter, const Eigen::VectorXd &joints, double primary_error, double auxiliary_error,
+                         double primary_step, double auxiliary_step)
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  if (records_.empty())
+    return;
+
+  SolverTraceRecord &record = records_[next_];
+  record.solve = solve;
+  record.iter = iter;
+  record.joints = joints;
+  record.primary_error = primary_error;
+  record.auxiliary_error = auxiliary_error;
+  record.primary_step = primary_step;
+  record.auxiliary_step = auxiliary_step;
+
+  next_ = (next_ + 1) % records_.size();
+  if (size_ < records_.size())
+    ++size_;
+}
+
+std::vector<SolverTraceRecord> SolverTrace::getRecords() const
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  std::vector<SolverTraceRecord> records;
+  records.reserve(size_);
+  std::size_t first = (next_ + records_.size() - size_) % std::max<std::size_t>(records_.size(), 1);
+  for (std::size_t i = 0; i < size_; ++i)
+    records.push_back(records_[(first + i) % records_.size()]);
+
+  return records;
+}
+
+void SolverTrace::clear()
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  next_ = 0;
+  size_ = 0;
+}
+
+bool SolverTrace::write(const std::string &file_name) const
+{
+  std::vector<SolverTraceRecord> records = getRecords();
+  std::ofstream file(file_name.c_str(), std::ios::out | std::ios::binary);
+  if (!file)
+  {
+    ROS_ERROR("Unable to open the solver trace file %s.", file_name.c_str());
+    return false;
+  }
+
+  const uint32_t header[] = {1, static_cast<uint32_t>(num_joints_), static_cast<uint32_t>(records.size())};
+  file.write("CIKT", 4);
+  file.write(reinterpret_cast<const char*>(header), sizeof(header));
+  for (const auto &record : records)
+  {
+    const int32_t numbers[] = {record.solve, record.iter};
+    const double norms[] = {record.primary_error, record.auxiliary_error, record.primary_step, record.auxiliary_step};
+    Eigen::VectorXd joints = Eigen::VectorXd::Zero(num_joints_);
+    joints.head(std::min<int>(num_joints_, record.joints.size())) = record.joints.head(std::min<int>(num_joints_, record.joints.size()));
+    file.write(reinterpret_cast<const char*>(numbers), sizeof(numbers));
+    file.write(reinterpret_cast<const char*>(joints.data()), sizeof(double)*num_joints_);
+    file.write(reinterpret_cast<const char*>(norms), sizeof(norms));
+  }
+
+  if (!file)
+  {
+    ROS_ERROR("Unable to write the solver trace file %s.", file_name.c_str());
+    return false;
+  }
+  return true;
+}
+
+} // namespace constrained_ik
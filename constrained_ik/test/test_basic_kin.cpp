@@ -28,6 +28,7 @@
 #include <gtest/gtest.h>
 #include <ros/ros.h>
 #include <constrained_ik/basic_kin.h>
+#include <constrained_ik/batch_ik.h>
 #include <boost/assign/list_of.hpp>
 #include <eigen_conversions/eigen_kdl.h>
 #include <moveit/robot_model_loader/robot_model_loader.h>
@@ -286,6 +287,24 @@ TEST_F(RobotTest, calcFwdKinKnownPoses)
 
 }
 
+/** @brief This tests that the tip pose of linkTransforms matches calcFwdKin */
+TEST_F(RobotTest, linkTransformsMatchFwdKin)
+{
+  std::vector<std::string> link_names(1, kin.getRobotTipLinkName());
+  std::vector<KDL::Frame> frames;
+  Eigen::Affine3d pose, link_pose;
+
+  for(int j=0; j<10; j++)
+  {
+    VectorXd joints = VectorXd::Random(6) * M_PI;
+    EXPECT_TRUE(kin.calcFwdKin(joints, pose));
+    EXPECT_TRUE(kin.linkTransforms(joints, frames, link_names));
+    ASSERT_EQ(frames.size(), 1u);
+    BasicKin::KDLToEigen(frames[0], link_pose);
+    EXPECT_TRUE(link_pose.matrix().isApprox(pose.matrix(), 1e-10));
+  }
+}
+
 /** @brief This performs input validation for the BasicKin calcJacobian function */
 TEST_F(RobotTest, calcJacobianInputValidation)
 {
@@ -345,6 +364,65 @@ TEST_F(RobotTest, calcJacobianKnownPoses)
   }
 }
 
+/** @brief This tests the BasicKin calcJacobianDerivatives function against numerical derivatives of the jacobian */
+TEST_F(RobotTest, calcJacobianDerivatives)
+{
+  VectorXd joints(6), updated_joints;
+  MatrixXd jacobian, updated_jacobian, other_jacobian;
+  std::vector<MatrixXd> derivatives;
+  double delta = 1e-6;
+
+  EXPECT_FALSE(BasicKin().calcJacobianDerivatives(VectorXd::Zero(6), jacobian, derivatives)); // un-init BasicKin
+  for(int j=0; j<10; j++)
+  {
+    joints = VectorXd::Random(6) * M_PI;
+    EXPECT_TRUE(kin.calcJacobianDerivatives(joints, jacobian, derivatives));
+    EXPECT_TRUE(kin.calcJacobian(joints, other_jacobian));
+    EXPECT_TRUE(jacobian.isApprox(other_jacobian));
+    ASSERT_EQ(derivatives.size(), 6u);
+    for(int i=0; i<(int) joints.size(); i++)
+    {
+      updated_joints = joints;
+      updated_joints[i] += delta;
+      EXPECT_TRUE(kin.calcJacobian(updated_joints, updated_jacobian));
+      EXPECT_LT(((updated_jacobian - jacobian)/delta - derivatives[i]).cwiseAbs().maxCoeff(), 1e-4);
+    }
+  }
+}
+
+/** @brief This tests the BatchIK solver on the poses of random joint values, seeded near them */
+TEST_F(RobotTest, batchIKSolve)
+{
+  constrained_ik::BatchIK batch;
+  constrained_ik::BatchIK::PoseVector goals;
+  Eigen::MatrixXd seeds(6, 21), solutions;
+  std::vector<bool> converged;
+
+  EXPECT_FALSE(batch.init(BasicKin())); // un-init BasicKin
+  ASSERT_TRUE(batch.init(kin));
+  EXPECT_EQ(batch.solve(goals, Eigen::MatrixXd::Zero(5, 1), solutions, converged), 0u); // seed size mismatch
+
+  for(int i=0; i<(int) seeds.cols(); i++)
+  {
+    VectorXd joints = VectorXd::Random(6) * M_PI_2;
+    Eigen::Affine3d pose;
+    EXPECT_TRUE(kin.calcFwdKin(joints, pose));
+    goals.push_back(pose);
+    seeds.col(i) = joints + VectorXd::Random(6) * 0.1;
+  }
+
+  EXPECT_EQ(batch.solve(goals, seeds, solutions, converged), goals.size());
+  ASSERT_EQ(solutions.cols(), seeds.cols());
+  for(int i=0; i<(int) seeds.cols(); i++)
+  {
+    Eigen::Affine3d pose;
+    EXPECT_TRUE(converged[i]);
+    EXPECT_TRUE(kin.calcFwdKin(solutions.col(i), pose));
+    EXPECT_LT((pose.translation() - goals[i].translation()).norm(), 1e-3);
+    EXPECT_TRUE(pose.linear().isApprox(goals[i].linear(), 1e-2));
+  }
+}
+
 /** @brief This performs input validation for the BasicKin solvePInv function */
 TEST_F(PInvTest, solvePInvInputValidation)
 {
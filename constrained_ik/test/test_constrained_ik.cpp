@@ -32,11 +32,15 @@
 #include "constrained_ik/constraints/goal_position.h"
 #include "constrained_ik/constraints/goal_orientation.h"
 #include "constrained_ik/constraints/avoid_obstacles.h"
+#include "constrained_ik/constraints/goal_mid_joint.h"
+#include "constrained_ik/constraints/joint_vel_limits.h"
 #include "constrained_ik/constrained_ik_utils.h"
+#include "constrained_ik/solution_cache.h"
 #include <moveit/robot_model_loader/robot_model_loader.h>
 #include <moveit/robot_model/joint_model_group.h>
 #include <moveit/collision_plugin_loader/collision_plugin_loader.h>
 #include <boost/random/uniform_int_distribution.hpp>
+#include <thread>
 
 using constrained_ik::Constrained_IK;
 using constrained_ik::basic_kin::BasicKin;
@@ -92,6 +96,53 @@ TEST(constrained_ik, nullspaceprojection)
   EXPECT_LT(norm2, .00000001);
 }
 
+/** @brief This test that the single decomposition of the primary jacobian matches the separate calculations */
+TEST(constrained_ik, primarypseudoinverse)
+{
+  // 6x7 is decomposed with fixed size matrices and 6x8 with dynamic ones
+  for (int cols : {7, 8})
+  {
+    int rows = 6;
+    MatrixXd A = MatrixXd::Random(rows, cols);
+
+    // make A rank deficient
+    JacobiSVD<MatrixXd> svd(A,Eigen::ComputeFullV | Eigen::ComputeFullU);
+    VectorXd s = svd.singularValues();
+    s.tail(3).setZero();
+    MatrixXd A2 = svd.matrixU() * s.asDiagonal() * svd.matrixV().leftCols(rows).transpose();
+
+    Constrained_IK CIK;
+    MatrixXd J_pinv = CIK.calcDampedPseudoinverse(A2);
+    MatrixXd N = CIK.calcNullspaceProjectionTheRightWay(A2);
+    VectorXd testv1 = VectorXd::Random(cols);
+
+    constrained_ik::ConstrainedIKConfiguration config = CIK.getSolverConfiguration();
+    for (auto decomposition : {constrained_ik::solver_decompositions::JacobiSvd,
+                               constrained_ik::solver_decompositions::BdcSvd,
+                               constrained_ik::solver_decompositions::DampedCholesky})
+    {
+      config.primary_decomposition = decomposition;
+      CIK.setSolverConfiguration(config);
+
+      MatrixXd J_pinv1, N1;
+      ASSERT_TRUE(CIK.calcPrimaryPseudoinverse(A2, J_pinv1, N1, true));
+      EXPECT_EQ(J_pinv1.rows(), cols);
+      EXPECT_EQ(J_pinv1.cols(), rows);
+      EXPECT_EQ(N1.rows(), cols);
+      EXPECT_EQ(N1.cols(), cols);
+
+      // the cholesky factorization damps every direction so it only approximates the SVD results
+      double tol = decomposition == constrained_ik::solver_decompositions::DampedCholesky ? 1e-3 : 1e-8;
+      EXPECT_LT((A2*(N1*testv1)).norm(), tol);
+      if (decomposition != constrained_ik::solver_decompositions::DampedCholesky)
+      {
+        EXPECT_TRUE(J_pinv1.isApprox(J_pinv, 1e-8));
+        EXPECT_TRUE(N1.isApprox(N, 1e-8));
+      }
+    }
+  }
+}
+
 /**
  * @brief Constrained_IK Test Fixtures
  * Consolidate variable-definitions and init functions for use by multiple tests.
@@ -265,6 +316,181 @@ TEST_F(BasicIKTest, knownPoses)
   EXPECT_TRUE(rslt_pose.translation().isApprox(pose.translation(), 1e-3));
 }
 
+/** @brief This tests the Constrained_IK calcInvKinBatch function along a sequence of nearby poses */
+TEST_F(BasicIKTest, calcInvKinBatch)
+{
+  Affine3d rslt_pose;
+  VectorXd seed(6), joints;
+  ik.loadDefaultSolverConfiguration();
+
+  ik.clearConstraintList();
+  constrained_ik::Constraint *goal_pose_ptr = new  constrained_ik::constraints::GoalPose();
+  ik.addConstraint(goal_pose_ptr, constrained_ik::constraint_types::Primary);
+
+  // poses along a small joint motion, each one close to the previous solution
+  seed << M_PI_2, -M_PI_2, -M_PI_2, -M_PI_2, M_PI_2, -M_PI_2;
+  std::vector<Affine3d, Eigen::aligned_allocator<Affine3d> > poses(5);
+  for (std::size_t i = 0; i < poses.size(); ++i)
+    EXPECT_TRUE(kin.calcFwdKin(seed + 0.02 * i * VectorXd::Ones(seed.size()), poses[i]));
+
+  std::vector<VectorXd> solutions;
+  EXPECT_TRUE(ik.calcInvKinBatch(poses, seed, planning_scene::PlanningSceneConstPtr(), solutions));
+  ASSERT_EQ(solutions.size(), poses.size());
+  for (std::size_t i = 0; i < poses.size(); ++i)
+  {
+    EXPECT_TRUE(kin.calcFwdKin(solutions[i], rslt_pose));
+    EXPECT_TRUE(rslt_pose.rotation().isApprox(poses[i].rotation(), 9e-3));
+    EXPECT_TRUE(rslt_pose.translation().isApprox(poses[i].translation(), 1e-3));
+
+    // the batch seeds each pose from the previous solution like a sequence of calls would
+    EXPECT_TRUE(ik.calcInvKin(poses[i], i == 0 ? seed : solutions[i - 1], joints));
+    EXPECT_TRUE(joints.isApprox(solutions[i], 1e-10));
+  }
+
+  // an invalid pose is rejected before any pose is solved
+  poses[2] = Affine3d(Eigen::Matrix4d::Zero());
+  EXPECT_ANY_THROW(ik.calcInvKinBatch(poses, seed, planning_scene::PlanningSceneConstPtr(), solutions));
+
+  // an empty batch trivially succeeds
+  EXPECT_TRUE(ik.calcInvKinBatch(std::vector<Affine3d, Eigen::aligned_allocator<Affine3d> >(), seed,
+                                 planning_scene::PlanningSceneConstPtr(), solutions));
+  EXPECT_TRUE(solutions.empty());
+}
+
+/** @brief This tests that concurrent solves sharing one solver give the same solutions as sequential solves */
+TEST_F(BasicIKTest, concurrentSolves)
+{
+  ik.loadDefaultSolverConfiguration();
+  ik.clearConstraintList();
+
+  std::vector<std::string> link_names;
+  ik.getLinkNames(link_names);
+  constrained_ik::constraints::AvoidObstacles *avoid_obstacles_ptr = new constrained_ik::constraints::AvoidObstacles();
+  avoid_obstacles_ptr->setAvoidanceLinks(std::vector<std::string>(1, link_names[link_names.size()/2]));
+  ik.addConstraint(new constrained_ik::constraints::GoalPose(), constrained_ik::constraint_types::Primary);
+  ik.addConstraint(avoid_obstacles_ptr, constrained_ik::constraint_types::Auxiliary);
+
+  VectorXd seed(6);
+  seed << M_PI_2, -M_PI_2, -M_PI_2, -M_PI_2, M_PI_2, -M_PI_2;
+  std::vector<Affine3d, Eigen::aligned_allocator<Affine3d> > poses(8);
+  std::vector<VectorXd> expected(poses.size());
+  for (std::size_t i = 0; i < poses.size(); ++i)
+  {
+    EXPECT_TRUE(kin.calcFwdKin(seed + 0.05 * i * VectorXd::Ones(seed.size()), poses[i]));
+    EXPECT_TRUE(ik.calcInvKin(poses[i], seed, planning_scene_, expected[i]));
+  }
+
+  // every thread solves every pose with its own state, the constraints and kinematics are shared
+  const int num_threads = 4;
+  std::vector<std::vector<VectorXd> > solutions(num_threads, std::vector<VectorXd>(poses.size()));
+  std::vector<int> failures(num_threads, 0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; ++t)
+  {
+    threads.emplace_back([&, t]()
+    {
+      for (int repeat = 0; repeat < 5; ++repeat)
+        for (std::size_t i = 0; i < poses.size(); ++i)
+          if (!ik.calcInvKin(poses[i], seed, planning_scene_, solutions[t][i]))
+            failures[t]++;
+    });
+  }
+
+  for (std::thread &thread : threads)
+    thread.join();
+
+  for (int t = 0; t < num_threads; ++t)
+  {
+    EXPECT_EQ(failures[t], 0);
+    for (std::size_t i = 0; i < poses.size(); ++i)
+      EXPECT_TRUE(solutions[t][i].isApprox(expected[i], 1e-10));
+  }
+}
+
+/** @brief This tests the Constrained_IK calcInvKin function with the adaptive damping of the primary step */
+TEST_F(BasicIKTest, adaptiveDamping)
+{
+  Affine3d pose, rslt_pose;
+  VectorXd seed, expected(6), joints;
+  ik.loadDefaultSolverConfiguration();
+  config = ik.getSolverConfiguration();
+  config.primary_adaptive_damping = true;
+  ik.setSolverConfiguration(config);
+
+  ik.clearConstraintList();
+  constrained_ik::Constraint *goal_pose_ptr = new  constrained_ik::constraints::GoalPose();
+  ik.addConstraint(goal_pose_ptr, constrained_ik::constraint_types::Primary);
+
+  expected << M_PI_2, -M_PI_2, -M_PI_2, -M_PI_2, M_PI_2, -M_PI_2;
+  EXPECT_TRUE(kin.calcFwdKin(expected, pose));
+  for (double scale : {0.01, 0.1, 0.3})
+  {
+    seed = expected + scale * VectorXd::Random(expected.size());
+    EXPECT_TRUE(ik.calcInvKin(pose, seed, joints));
+    EXPECT_TRUE(kin.calcFwdKin(joints, rslt_pose));
+    EXPECT_TRUE(rslt_pose.rotation().isApprox(pose.rotation(), 9e-3));
+    EXPECT_TRUE(rslt_pose.translation().isApprox(pose.translation(), 1e-3));
+  }
+}
+
+/** @brief This tests the Constrained_IK calcInvKin function when it stops once the auxiliary error stops improving */
+TEST_F(BasicIKTest, auxiliaryMinImprovement)
+{
+  Affine3d pose, rslt_pose;
+  VectorXd seed, expected(6), joints;
+  ik.loadDefaultSolverConfiguration();
+  config = ik.getSolverConfiguration();
+  config.limit_auxiliary_interations = false;
+  config.limit_auxiliary_motion = false;
+  config.auxiliary_min_improvement = 0.1;
+  ik.setSolverConfiguration(config);
+
+  ik.clearConstraintList();
+  constrained_ik::Constraint *goal_position_ptr = new  constrained_ik::constraints::GoalPosition();
+  ik.addConstraint(goal_position_ptr, constrained_ik::constraint_types::Primary);
+  constrained_ik::Constraint *goal_orientation_ptr = new  constrained_ik::constraints::GoalOrientation();
+  ik.addConstraint(goal_orientation_ptr, constrained_ik::constraint_types::Auxiliary);
+
+  // the primary constraint holds whenever the solver stops early
+  expected << M_PI_2, -M_PI_2, -M_PI_2, -M_PI_2, M_PI_2, -M_PI_2;
+  EXPECT_TRUE(kin.calcFwdKin(expected, pose));
+  seed = expected + 0.05 * VectorXd::Random(expected.size());
+  EXPECT_TRUE(ik.calcInvKin(pose, seed, joints));
+  EXPECT_TRUE(kin.calcFwdKin(joints, rslt_pose));
+  EXPECT_TRUE(rslt_pose.translation().isApprox(pose.translation(), 1e-3));
+}
+
+/** @brief This tests the constant jacobian of the joint space constraints */
+TEST_F(BasicIKTest, constantJointJacobian)
+{
+  ik.clearConstraintList();
+  constrained_ik::constraints::GoalMidJoint *mid_joint_ptr = new constrained_ik::constraints::GoalMidJoint();
+  ik.addConstraint(mid_joint_ptr, constrained_ik::constraint_types::Auxiliary);
+  constrained_ik::constraints::JointVelLimits *vel_limits_ptr = new constrained_ik::constraints::JointVelLimits();
+  ik.addConstraint(vel_limits_ptr, constrained_ik::constraint_types::Auxiliary);
+
+  // the jacobian is stored once while the error follows the joints
+  constrained_ik::SolverState state;
+  state.joints = VectorXd::Random(6);
+  state.joint_seed = state.joints;
+  EXPECT_TRUE(mid_joint_ptr->hasConstantJacobian());
+  constrained_ik::ConstraintResults results = mid_joint_ptr->evalConstraint(state);
+  EXPECT_TRUE(results.jacobian.isApprox(MatrixXd::Identity(6, 6)));
+  EXPECT_TRUE(results.isJointSelector());
+
+  mid_joint_ptr->setWeight(2.0);
+  results = mid_joint_ptr->evalConstraint(state);
+  EXPECT_TRUE(results.jacobian.isApprox(2.0 * MatrixXd::Identity(6, 6)));
+
+  // the velocity limits select the rows of the limited joints only
+  EXPECT_FALSE(vel_limits_ptr->hasConstantJacobian());
+  state.joints(2) += 1.0;
+  results = vel_limits_ptr->evalConstraint(state);
+  ASSERT_EQ(results.jacobian.rows(), 1);
+  EXPECT_DOUBLE_EQ(results.jacobian(0, 2), 1.0);
+  EXPECT_DOUBLE_EQ(results.jacobian.row(0).cwiseAbs().sum(), 1.0);
+}
+
 /** @brief This tests the Constrained_IK calcInvKin function null space motion */
 TEST_F(BasicIKTest, NullMotion)
 {
@@ -537,6 +763,16 @@ TEST_F(BasicIKTest, obstacleAvoidanceAuxiliaryConstraint)
   EXPECT_TRUE(kin.calcFwdKin(joints,rslt_pose));
   EXPECT_TRUE(rslt_pose.translation().isApprox(pose.translation(), 1e-3));
   EXPECT_NE(expected, joints);
+
+  // a scene context reused across solves gives the same solutions as the planning scene
+  constrained_ik::SceneContextPtr scene_context = ik.createSceneContext(planning_scene_);
+  ASSERT_TRUE(static_cast<bool>(scene_context));
+  for (int i = 0; i < 2; ++i)
+  {
+    Eigen::VectorXd context_joints;
+    EXPECT_TRUE(ik.calcInvKin(pose, seed, scene_context, context_joints));
+    EXPECT_TRUE(context_joints.isApprox(joints, 1e-6));
+  }
 }
 
 /**
@@ -571,6 +807,105 @@ TEST_F(BasicIKTest, consistancy)
         EXPECT_TRUE(rslt.isApprox(expected, 1e-5) or rslt.isApprox(-expected, 1e-5));
     }
 }
+/** @brief This tests that the telemetry aggregates the solves and the constraint evaluations of every thread */
+TEST_F(BasicIKTest, telemetry)
+{
+  ik.loadDefaultSolverConfiguration();
+  ik.clearConstraintList();
+  ik.addConstraint(new constrained_ik::constraints::GoalPose(), constrained_ik::constraint_types::Primary);
+  constrained_ik::SolverTelemetryPtr telemetry(new constrained_ik::SolverTelemetry());
+  ik.setTelemetry(telemetry);
+
+  VectorXd seed(6), joints;
+  seed << M_PI_2, -M_PI_2, -M_PI_2, -M_PI_2, M_PI_2, -M_PI_2;
+  Affine3d pose;
+  EXPECT_TRUE(kin.calcFwdKin(seed + 0.1 * VectorXd::Ones(seed.size()), pose));
+
+  const int num_threads = 2;
+  const int num_solves = 3;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; ++t)
+    threads.emplace_back([&, t]()
+    {
+      VectorXd solution;
+      for (int i = 0; i < num_solves; ++i)
+        EXPECT_TRUE(ik.calcInvKin(pose, seed, solution));
+    });
+
+  for (std::thread &thread : threads)
+    thread.join();
+
+  constrained_ik::SolverTelemetrySnapshot snapshot = telemetry->getSnapshot();
+  EXPECT_EQ(snapshot.solve_time.count, uint64_t(num_threads * num_solves));
+  EXPECT_EQ(snapshot.iterations.count, uint64_t(num_threads * num_solves));
+  EXPECT_EQ(snapshot.terminations[constrained_ik::solver_termination::Converged], uint64_t(num_threads * num_solves));
+  EXPECT_GT(snapshot.iterations.mean(), 0.0);
+  EXPECT_GE(snapshot.decomposition_time.count, snapshot.solve_time.count);
+  // the goal pose group and the position and orientation constraints it holds, sorted by name
+  ASSERT_EQ(snapshot.constraints.size(), 3u);
+  EXPECT_EQ(snapshot.constraints[0].name, "constrained_ik::constraints::GoalOrientation");
+  EXPECT_EQ(snapshot.constraints[1].name, "constrained_ik::constraints::GoalPose");
+  EXPECT_EQ(snapshot.constraints[2].name, "constrained_ik::constraints::GoalPosition");
+  for (const constrained_ik::ConstraintTelemetry &constraint : snapshot.constraints)
+    EXPECT_GE(constraint.eval_time.count, snapshot.solve_time.count);
+
+  telemetry->clear();
+  EXPECT_EQ(telemetry->getSnapshot().solve_time.count, 0u);
+  ik.setTelemetry(constrained_ik::SolverTelemetryPtr());
+}
+
+/** @brief This tests that the solver trace keeps the last iterations, the oldest first */
+TEST(SolverTrace, ringBuffer)
+{
+  constrained_ik::SolverTrace trace(3, 2);
+  int solve = trace.beginSolve();
+  for (int i = 0; i < 5; ++i)
+    trace.record(solve, i, VectorXd::Constant(2, i), i, 0.0, 0.5*i, 0.0);
+
+  std::vector<constrained_ik::SolverTraceRecord> records = trace.getRecords();
+  ASSERT_EQ(records.size(), 3u);
+  for (int i = 0; i < 3; ++i)
+  {
+    EXPECT_EQ(records[i].solve, solve);
+    EXPECT_EQ(records[i].iter, i + 2);
+    EXPECT_EQ(records[i].joints(1), i + 2);
+  }
+
+  trace.clear();
+  EXPECT_TRUE(trace.getRecords().empty());
+  EXPECT_EQ(trace.beginSolve(), solve + 1);
+}
+
+/** @brief This tests that the solution cache returns the solution of the nearest pose and evicts the oldest ones */
+TEST(SolutionCache, nearest)
+{
+  constrained_ik::SolutionCache cache(2, 0.1);
+  VectorXd joints;
+  double distance;
+  EXPECT_FALSE(cache.findNearest(Affine3d::Identity(), joints, distance));
+
+  for (int i = 0; i < 3; ++i)
+    cache.insert(Affine3d(Eigen::Translation3d(i, 0, 0)), VectorXd::Constant(2, i));
+
+  // the first pose was evicted, the second one is the nearest remaining
+  EXPECT_TRUE(cache.findNearest(Affine3d(Eigen::Translation3d(0.2, 0, 0)), joints, distance));
+  EXPECT_EQ(joints(0), 1);
+  EXPECT_NEAR(distance, 0.8, 1e-12);
+
+  // the rotation adds its angle times the rotation weight
+  Affine3d rotated = Eigen::Translation3d(2, 0, 0) * Eigen::AngleAxisd(0.5, Eigen::Vector3d::UnitZ());
+  EXPECT_TRUE(cache.findNearest(rotated, joints, distance));
+  EXPECT_EQ(joints(0), 2);
+  EXPECT_NEAR(distance, 0.05, 1e-12);
+
+  cache.clear();
+  EXPECT_FALSE(cache.findNearest(rotated, joints, distance));
+
+  constrained_ik::SolutionCache disabled;
+  disabled.insert(Affine3d::Identity(), joints);
+  EXPECT_FALSE(disabled.findNearest(Affine3d::Identity(), joints, distance));
+}
+
 /** @brief This executes all tests for the Constraine_IK Class and its constraints */
 int main(int argc, char **argv)
 {
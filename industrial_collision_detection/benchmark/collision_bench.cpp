@@ -0,0 +1,371 @@
+/**
+ * @file collision_bench.cpp
+ * @brief This measures the latency and the heap allocations of the collision and distance queries
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @license Software License Agreement (Apache License)\n
+ * \n
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at\n
+ * \n
+ * http://www.apache.org/licenses/LICENSE-2.0\n
+ * \n
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <benchmark/benchmark.h>
+#include <industrial_collision_detection/collision_detection/collision_robot_industrial.h>
+#include <industrial_collision_detection/collision_detection/collision_world_industrial.h>
+#include <industrial_collision_detection/collision_detection/primitive_distance.h>
+#include <moveit/collision_detection_fcl/collision_robot_fcl.h>
+#include <moveit/collision_detection_fcl/collision_world_fcl.h>
+#include <geometric_shapes/mesh_operations.h>
+#include <urdf_parser/urdf_parser.h>
+#include <octomap/octomap.h>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+
+static std::atomic<bool> COUNT_ALLOCATIONS(false);     /**< Whether heap allocations are being counted */
+static std::atomic<std::size_t> NUM_ALLOCATIONS(0);    /**< The number of heap allocations counted, always 0 without glibc */
+
+#ifdef __GLIBC__
+
+extern "C"
+{
+void* __libc_malloc(std::size_t size);
+void* __libc_calloc(std::size_t num, std::size_t size);
+void* __libc_realloc(void* ptr, std::size_t size);
+
+/** @brief Counts every heap allocation made by the process, fcl and operator new end up here on glibc */
+void* malloc(std::size_t size)
+{
+  if (COUNT_ALLOCATIONS)
+    NUM_ALLOCATIONS++;
+  return __libc_malloc(size);
+}
+
+/** @brief Counts every zero initialized heap allocation */
+void* calloc(std::size_t num, std::size_t size)
+{
+  if (COUNT_ALLOCATIONS)
+    NUM_ALLOCATIONS++;
+  return __libc_calloc(num, size);
+}
+
+/** @brief Counts every heap reallocation */
+void* realloc(void* ptr, std::size_t size)
+{
+  if (COUNT_ALLOCATIONS)
+    NUM_ALLOCATIONS++;
+  return __libc_realloc(ptr, size);
+}
+}
+
+#endif
+
+namespace
+{
+
+using namespace collision_detection;
+
+const double LINK_LENGTH = 0.3;                          /**< The length of the cylinder of every link */
+const double LINK_RADIUS = 0.04;                         /**< The radius of the cylinder of every link */
+const std::size_t NUM_STATES = 64;                       /**< The number of random states cycled through */
+const std::size_t OCTREE_POINTS_PER_OBJECT = 50;         /**< The occupied voxels of the octree per world object */
+const std::vector<int64_t> LINKS = {6, 12, 24};          /**< The numbers of robot links swept */
+const std::vector<int64_t> OBJECTS = {1, 10, 100};       /**< The numbers of world objects swept */
+
+/** @brief The kind of the world objects */
+enum SceneKind
+{
+  PRIMITIVES = 0,   /**< Boxes, spheres and cylinders */
+  MESHES,           /**< Triangulated spheres */
+  OCTOMAP           /**< A single octree with OCTREE_POINTS_PER_OBJECT voxels per object */
+};
+
+/**
+ * @brief Creates the urdf of a serial chain of cylinders whose revolute joints alternate between the z and the y axis
+ * @param num_links The number of moving links
+ * @return The urdf
+ */
+std::string createChainUrdf(int num_links)
+{
+  std::stringstream urdf;
+  urdf << "<robot name=\"chain\"><link name=\"link_0\"/>";
+  for (int i = 1; i <= num_links; ++i)
+  {
+    urdf << "<link name=\"link_" << i << "\"><collision><origin xyz=\"0 0 " << LINK_LENGTH / 2 << "\"/><geometry>"
+         << "<cylinder radius=\"" << LINK_RADIUS << "\" length=\"" << LINK_LENGTH << "\"/></geometry></collision></link>"
+         << "<joint name=\"joint_" << i << "\" type=\"revolute\"><parent link=\"link_" << i - 1 << "\"/>"
+         << "<child link=\"link_" << i << "\"/><origin xyz=\"0 0 " << (i == 1 ? 0.0 : LINK_LENGTH) << "\"/>"
+         << "<axis xyz=\"0 " << (i % 2) << " " << (1 - i % 2) << "\"/>"
+         << "<limit lower=\"-2.5\" upper=\"2.5\" effort=\"1\" velocity=\"1\"/></joint>";
+  }
+  urdf << "</robot>";
+  return urdf.str();
+}
+
+/**
+ * @brief A robot and a world shared by the industrial and the stock fcl collision checkers, together with the random
+ * states that are queried.
+ */
+struct Scene
+{
+  Scene(int num_links, int num_objects, SceneKind kind)
+  {
+    urdf::ModelInterfaceSharedPtr urdf_model = urdf::parseURDF(createChainUrdf(num_links));
+    srdf::ModelSharedPtr srdf_model(new srdf::Model());
+    srdf_model->initString(*urdf_model, "<robot name=\"chain\"></robot>");
+    model.reset(new robot_model::RobotModel(urdf_model, srdf_model));
+
+    // adjacent links always touch
+    for (const robot_model::JointModel* joint : model->getJointModels())
+    {
+      if (joint->getParentLinkModel())
+        acm.setEntry(joint->getParentLinkModel()->getName(), joint->getChildLinkModel()->getName(), true);
+    }
+
+    // the objects are spread around the reach of the chain
+    std::mt19937 rng(num_links * 1000 + num_objects);
+    std::uniform_real_distribution<double> direction(-1.0, 1.0);
+    std::uniform_real_distribution<double> range(0.5, 1.5);
+    auto randomPosition = [&]()
+    {
+      Eigen::Vector3d p(direction(rng), direction(rng), direction(rng));
+      return Eigen::Vector3d(p.normalized() * range(rng) * num_links * LINK_LENGTH / 2);
+    };
+
+    world.reset(new World());
+    if (kind == OCTOMAP)
+    {
+      boost::shared_ptr<octomap::OcTree> tree(new octomap::OcTree(0.05));
+      for (std::size_t i = 0; i < num_objects * OCTREE_POINTS_PER_OBJECT; ++i)
+      {
+        Eigen::Vector3d p = randomPosition();
+        tree->updateNode(octomap::point3d(p.x(), p.y(), p.z()), true);
+      }
+      world->addToObject("octomap", shapes::ShapeConstPtr(new shapes::OcTree(tree)), Eigen::Affine3d::Identity());
+    }
+    else
+    {
+      for (int i = 0; i < num_objects; ++i)
+      {
+        shapes::ShapeConstPtr shape;
+        if (kind == MESHES)
+          shape.reset(shapes::createMeshFromShape(shapes::Sphere(0.1)));
+        else if (i % 3 == 0)
+          shape.reset(new shapes::Box(0.2, 0.2, 0.2));
+        else if (i % 3 == 1)
+          shape.reset(new shapes::Sphere(0.1));
+        else
+          shape.reset(new shapes::Cylinder(0.1, 0.2));
+
+        world->addToObject("object_" + std::to_string(i), shape, Eigen::Affine3d(Eigen::Translation3d(randomPosition())));
+      }
+    }
+
+    industrial_robot.reset(new CollisionRobotIndustrial(model));
+    industrial_world.reset(new CollisionWorldIndustrial(world));
+    fcl_robot.reset(new CollisionRobotFCL(model));
+    fcl_world.reset(new CollisionWorldFCL(world));
+
+    std::uniform_real_distribution<double> position(-2.5, 2.5);
+    std::vector<double> positions(model->getVariableCount());
+    states.resize(NUM_STATES, robot_state::RobotState(model));
+    for (robot_state::RobotState& state : states)
+    {
+      for (double& p : positions)
+        p = position(rng);
+      state.setVariablePositions(positions);
+      state.update();
+    }
+  }
+
+  /**
+   * @brief Returns the scene of the benchmark arguments, the scenes are built once and reused.
+   * @param state The benchmark state, its ranges are the links, the objects and the scene kind
+   */
+  static const Scene& get(const benchmark::State& state)
+  {
+    static std::map<std::vector<int64_t>, std::shared_ptr<Scene> > scenes;
+    std::vector<int64_t> key = {state.range(0), state.range(1), state.range(2)};
+    std::shared_ptr<Scene>& scene = scenes[key];
+    if (!scene)
+      scene.reset(new Scene(key[0], key[1], static_cast<SceneKind>(key[2])));
+    return *scene;
+  }
+
+  robot_model::RobotModelPtr model;
+  AllowedCollisionMatrix acm;
+  WorldPtr world;
+  std::shared_ptr<CollisionRobotIndustrial> industrial_robot;
+  std::shared_ptr<CollisionWorldIndustrial> industrial_world;
+  std::shared_ptr<CollisionRobotFCL> fcl_robot;
+  std::shared_ptr<CollisionWorldFCL> fcl_world;
+  std::vector<robot_state::RobotState> states;
+};
+
+/**
+ * @brief Runs a query over the states of the scene and reports the heap allocations per query.  The first pass over
+ * the states is not timed so that the per thread caches of the checkers are warmed up.
+ * @param state The benchmark state
+ * @param scene The scene
+ * @param query The query, called with a robot state
+ */
+template <typename Query>
+void runQuery(benchmark::State& state, const Scene& scene, Query query)
+{
+  for (const robot_state::RobotState& s : scene.states)
+    query(s);
+
+  std::size_t i = 0;
+  NUM_ALLOCATIONS = 0;
+  for (auto _ : state)
+  {
+    COUNT_ALLOCATIONS = true;
+    query(scene.states[i++ % NUM_STATES]);
+    COUNT_ALLOCATIONS = false;
+  }
+
+  state.counters["allocations"] = benchmark::Counter(NUM_ALLOCATIONS, benchmark::Counter::kAvgIterations);
+  state.counters["links"] = state.range(0);
+  state.counters["objects"] = state.range(1);
+}
+
+void BM_IndustrialDistanceSelf(benchmark::State& state)
+{
+  const Scene& scene = Scene::get(state);
+  runQuery(state, scene, [&](const robot_state::RobotState& s)
+  {
+    benchmark::DoNotOptimize(scene.industrial_robot->distanceSelf(s, scene.acm));
+  });
+}
+
+void BM_FCLDistanceSelf(benchmark::State& state)
+{
+  const Scene& scene = Scene::get(state);
+  runQuery(state, scene, [&](const robot_state::RobotState& s)
+  {
+    benchmark::DoNotOptimize(scene.fcl_robot->distanceSelf(s, scene.acm));
+  });
+}
+
+void BM_IndustrialDistanceRobot(benchmark::State& state)
+{
+  const Scene& scene = Scene::get(state);
+  runQuery(state, scene, [&](const robot_state::RobotState& s)
+  {
+    benchmark::DoNotOptimize(scene.industrial_world->distanceRobot(*scene.industrial_robot, s, scene.acm));
+  });
+}
+
+void BM_FCLDistanceRobot(benchmark::State& state)
+{
+  const Scene& scene = Scene::get(state);
+  runQuery(state, scene, [&](const robot_state::RobotState& s)
+  {
+    benchmark::DoNotOptimize(scene.fcl_world->distanceRobot(*scene.fcl_robot, s, scene.acm));
+  });
+}
+
+void BM_IndustrialCheckRobotCollision(benchmark::State& state)
+{
+  const Scene& scene = Scene::get(state);
+  CollisionRequest req;
+  CollisionResult res;
+  runQuery(state, scene, [&](const robot_state::RobotState& s)
+  {
+    res.clear();
+    scene.industrial_world->checkRobotCollision(req, res, *scene.industrial_robot, s, scene.acm);
+    benchmark::DoNotOptimize(res.collision);
+  });
+}
+
+void BM_FCLCheckRobotCollision(benchmark::State& state)
+{
+  const Scene& scene = Scene::get(state);
+  CollisionRequest req;
+  CollisionResult res;
+  runQuery(state, scene, [&](const robot_state::RobotState& s)
+  {
+    res.clear();
+    scene.fcl_world->checkRobotCollision(req, res, *scene.fcl_robot, s, scene.acm);
+    benchmark::DoNotOptimize(res.collision);
+  });
+}
+
+/** @brief The detailed distance query followed by getDistanceInfo(), the stock checker has no equivalent */
+void BM_IndustrialGetDistanceInfo(benchmark::State& state)
+{
+  const Scene& scene = Scene::get(state);
+  DistanceRequest req(true, false, NULL, &scene.acm);
+  DistanceResult res;
+  DistanceInfoVector info;
+  runQuery(state, scene, [&](const robot_state::RobotState& s)
+  {
+    res.clear();
+    scene.industrial_world->distanceRobot(req, res, *scene.industrial_robot, s);
+    benchmark::DoNotOptimize(getDistanceInfo(res.distance, info));
+  });
+}
+
+/** @brief The batched distance kernel between spheres and an oriented box, the argument is the number of spheres */
+void BM_SphereBoxDistances(benchmark::State& state)
+{
+  std::mt19937 rng(state.range(0));
+  std::uniform_real_distribution<double> coordinate(-1.0, 1.0);
+  SphereBatch spheres;
+  for (int i = 0; i < state.range(0); ++i)
+    spheres.add(Eigen::Vector3d(coordinate(rng), coordinate(rng), coordinate(rng)), 0.05);
+
+  CollisionPrimitive box;
+  box.type = CollisionPrimitive::BOX;
+  box.pose = Eigen::Translation3d(0.2, 0.1, 0.0) * Eigen::AngleAxisd(0.5, Eigen::Vector3d::UnitZ());
+  box.half_extents = Eigen::Vector3d(0.3, 0.2, 0.1);
+  std::vector<double> distances;
+  for (auto _ : state)
+  {
+    computeSphereDistances(spheres, box, distances);
+    benchmark::DoNotOptimize(distances.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.SetLabel(isPrimitiveDistanceVectorized() ? "vectorized" : "scalar");
+}
+
+/** @brief The links and objects are swept for every scene kind */
+void worldArguments(benchmark::internal::Benchmark* b)
+{
+  b->ArgsProduct({LINKS, OBJECTS, {PRIMITIVES, MESHES, OCTOMAP}});
+}
+
+/** @brief The self queries do not depend on the world, only the links are swept */
+void selfArguments(benchmark::internal::Benchmark* b)
+{
+  b->ArgsProduct({LINKS, {0}, {PRIMITIVES}});
+}
+
+}
+
+BENCHMARK(BM_IndustrialDistanceSelf)->Apply(selfArguments);
+BENCHMARK(BM_FCLDistanceSelf)->Apply(selfArguments);
+BENCHMARK(BM_IndustrialDistanceRobot)->Apply(worldArguments);
+BENCHMARK(BM_FCLDistanceRobot)->Apply(worldArguments);
+BENCHMARK(BM_IndustrialCheckRobotCollision)->Apply(worldArguments);
+BENCHMARK(BM_FCLCheckRobotCollision)->Apply(worldArguments);
+BENCHMARK(BM_IndustrialGetDistanceInfo)->Apply(worldArguments);
+BENCHMARK(BM_SphereBoxDistances)->Range(8, 1024);
+
+BENCHMARK_MAIN();
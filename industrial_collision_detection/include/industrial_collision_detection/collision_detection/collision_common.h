@@ -35,11 +35,175 @@
 #include <fcl/broadphase/broadphase.h>
 #include <fcl/collision.h>
 #include <fcl/distance.h>
+#include <geometric_shapes/shapes.h>
+#include <cstdint>
+#include <functional>
+#include <memory>
 #include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace collision_detection
 {
 
+  /**
+   * @brief A process wide integer identifier of a collision object name (link, attached body or world object).  The
+   * same name always maps to the same entry and the entries remain valid for the lifetime of the process.
+   */
+  struct InternedObjectName
+  {
+    int id;             /**< The identifier, the entries are numbered consecutively from zero */
+    std::string name;   /**< The name of the object */
+  };
+
+  /** @brief The identifier of an unknown object */
+  const int INVALID_OBJECT_ID = -1;
+
+  /**
+   * @brief Interns a collision object name, the name is only hashed the first time it is seen.  This function is
+   * thread safe.
+   * @param name The name of the object
+   * @return The entry of the name, never null
+   */
+  const InternedObjectName* internObjectName(const std::string &name);
+
+  /**
+   * @brief Returns the name of an interned identifier.  This function is thread safe.
+   * @param id The identifier returned by internObjectName() or getObjectId()
+   * @return The name or an empty string if the identifier is unknown
+   */
+  const std::string& getObjectName(int id);
+
+  /**
+   * @brief Stores the interned name of a collision object in its user data so that the distance queries can get its
+   * identifier without looking up the name.
+   * @param obj  The fcl collision object
+   * @param name The name of the link, attached body or world object of the collision object
+   */
+  void setObjectName(fcl::CollisionObject &obj, const std::string &name);
+
+  /**
+   * @brief Returns the identifier of a collision object, the objects not tagged by setObjectName() get their name
+   * interned from the geometry data.
+   * @param obj The fcl collision object
+   * @return The identifier of the object
+   */
+  int getObjectId(const fcl::CollisionObject &obj);
+
+  /**
+   * @brief Returns the number of interned names.  This function is thread safe.
+   * @return The number of names, the identifiers are below it
+   */
+  int getObjectNameCount();
+
+  /**
+   * @brief The allowed collision matrix as a dense bit matrix indexed by the identifiers of the interned object names,
+   * so that the callbacks filter a pair with a bit test instead of looking up its names.  It holds the entries of the
+   * names interned when it was built, the pairs involving a name interned later and the conditional entries are left
+   * undecided and must be looked up in the allowed collision matrix.  It has to be built again, e.g. for each planning
+   * scene, when the matrix changes.
+   */
+  class AllowedCollisionBitMatrix
+  {
+  public:
+
+    /**
+     * @brief Builds the bit matrix of an allowed collision matrix
+     * @param acm The allowed collision matrix
+     */
+    explicit AllowedCollisionBitMatrix(const AllowedCollisionMatrix &acm);
+
+    /**
+     * @brief Whether the collisions between two objects are always allowed
+     * @param id1     The identifier of the first object, see getObjectId()
+     * @param id2     The identifier of the second object
+     * @param allowed Returns true if their collisions are always allowed, otherwise false
+     * @return False if the pair is undecided and must be looked up in the allowed collision matrix
+     */
+    bool getAllowedCollision(int id1, int id2, bool &allowed) const
+    {
+      if (id1 < 0 || id2 < 0 || id1 >= size_ || id2 >= size_)
+        return false;
+
+      const std::size_t bit = static_cast<std::size_t>(id1) * size_ + id2;
+      const std::uint64_t mask = std::uint64_t(1) << (bit & 63);
+      if (!(decided_[bit >> 6] & mask))
+        return false;
+
+      allowed = (allowed_[bit >> 6] & mask) != 0;
+      return true;
+    }
+
+    /** @brief The number of interned names when the bit matrix was built */
+    int size() const { return size_; }
+
+  protected:
+
+    /** @brief Sets the bits of a pair in both orders */
+    void set(int id1, int id2, bool decided, bool allowed);
+
+    int size_;                            /**< The number of rows and columns */
+    std::vector<std::uint64_t> decided_;  /**< The pairs whose entry is known, [size][size] bits */
+    std::vector<std::uint64_t> allowed_;  /**< The pairs whose collisions are always allowed, [size][size] bits */
+  };
+
+  typedef std::shared_ptr<const AllowedCollisionBitMatrix> AllowedCollisionBitMatrixConstPtr;
+
+  struct CollisionData;
+
+  /** @brief The data of collisionBitMatrixCallback() */
+  struct CollisionBitMatrixData
+  {
+    CollisionBitMatrixData(CollisionData *cdata, const AllowedCollisionBitMatrix *acm_bits): cdata(cdata), acm_bits(acm_bits) {}
+
+    CollisionData *cdata;                       /**< The data passed on to the collision callback of fcl */
+    const AllowedCollisionBitMatrix *acm_bits;  /**< The bits of the allowed collision matrix of cdata, NULL if none */
+  };
+
+  /**
+   * @brief Filters a broadphase pair with the bit matrix before it reaches collision_detection::collisionCallback(), the
+   * pairs that are always allowed are dropped and the others are checked without looking up their names.
+   */
+  bool collisionBitMatrixCallback(fcl::CollisionObject* o1, fcl::CollisionObject* o2, void *data);
+
+  /**
+   * @brief The callback of the boolean collision queries, its data is a CollisionBitMatrixData whose request asks for
+   * no contacts.  The pairs of robot links and world objects that the bit matrix decides, or all of them without an
+   * allowed collision matrix, are collided by fcl without contact generation and the query stops at the first overlap.
+   * The pairs involving attached bodies, whose touch links are not in the matrix, are passed on to
+   * collisionBitMatrixCallback().
+   */
+  bool collisionBooleanCallback(fcl::CollisionObject* o1, fcl::CollisionObject* o2, void *data);
+
+  /**
+   * @brief Computes a hash of the type and geometry of a shape.  Octrees and planes are only distinguished by their type.
+   * @param shape The shape
+   * @return The hash
+   */
+  std::uint64_t computeShapeSignature(const shapes::Shape &shape);
+
+  /**
+   * @brief Sets the bit of each link of a set in a mask indexed by robot_model::LinkModel::getLinkIndex()
+   * @param links     The links
+   * @param num_links The number of links of the robot model, the size of the mask
+   * @param mask      Returns the mask
+   */
+  void computeActiveLinkMask(const std::set<const robot_model::LinkModel*> &links, std::size_t num_links,
+                             std::vector<bool> &mask);
+
+  /**
+   * @brief Returns the mask of the updated links with geometry of a group, see computeActiveLinkMask().  It is computed
+   * the first time it is requested for the group and kept as long as its robot model exists.  This function is thread
+   * safe.
+   * @param kmodel  The robot model
+   * @param group   A group of the robot model
+   * @return The mask
+   */
+  const std::vector<bool>* getGroupActiveLinkMask(const robot_model::RobotModelConstPtr &kmodel,
+                                                  const robot_model::JointModelGroup *group);
+
+  class RobotSphereModel;
 
   struct DistanceRequest
   {
@@ -49,7 +213,12 @@ namespace collision_detection
                        acm(NULL),
                        distance_threshold(std::numeric_limits<double>::max()),
                        verbose(false),
-                       gradient(false) {}
+                       gradient(false),
+                       lod_margin(std::numeric_limits<double>::max()),
+                       sphere_model(NULL),
+                       num_threads(1),
+                       acm_bits(NULL),
+                       active_links(NULL) {}
 
     DistanceRequest(bool detailed,
                     bool global,
@@ -61,7 +230,12 @@ namespace collision_detection
                                                                                      acm(acm),
                                                                                      distance_threshold(distance_threshold),
                                                                                      verbose(false),
-                                                                                     gradient(false) {}
+                                                                                     gradient(false),
+                                                                                     lod_margin(std::numeric_limits<double>::max()),
+                                                                                     sphere_model(NULL),
+                                                                                     num_threads(1),
+                                                                                     acm_bits(NULL),
+                                                                                     active_links(NULL) {}
     DistanceRequest(bool detailed,
                     bool global,
                     const std::set<const robot_model::LinkModel*> &active_components_only,
@@ -72,7 +246,12 @@ namespace collision_detection
                                                                                      acm(&acm),
                                                                                      distance_threshold(distance_threshold),
                                                                                      verbose(false),
-                                                                                     gradient(false) {}
+                                                                                     gradient(false),
+                                                                                     lod_margin(std::numeric_limits<double>::max()),
+                                                                                     sphere_model(NULL),
+                                                                                     num_threads(1),
+                                                                                     acm_bits(NULL),
+                                                                                     active_links(NULL) {}
     DistanceRequest(bool detailed,
                     bool global,
                     const std::string group_name,
@@ -84,7 +263,12 @@ namespace collision_detection
                                                                                      acm(acm),
                                                                                      distance_threshold(distance_threshold),
                                                                                      verbose(false),
-                                                                                     gradient(false) {}
+                                                                                     gradient(false),
+                                                                                     lod_margin(std::numeric_limits<double>::max()),
+                                                                                     sphere_model(NULL),
+                                                                                     num_threads(1),
+                                                                                     acm_bits(NULL),
+                                                                                     active_links(NULL) {}
     DistanceRequest(bool detailed,
                     bool global,
                     const std::string group_name,
@@ -96,13 +280,48 @@ namespace collision_detection
                                                                                      acm(&acm),
                                                                                      distance_threshold(distance_threshold),
                                                                                      verbose(false),
-                                                                                     gradient(false) {}
+                                                                                     gradient(false),
+                                                                                     lod_margin(std::numeric_limits<double>::max()),
+                                                                                     sphere_model(NULL),
+                                                                                     num_threads(1),
+                                                                                     acm_bits(NULL),
+                                                                                     active_links(NULL) {}
 
     virtual ~DistanceRequest() {}
 
     /// Compute \e active_components_only_ based on \e req_
     void enableGroup(const robot_model::RobotModelConstPtr &kmodel);
 
+    /**
+     * @brief Sets the active components and their mask
+     * @param links The active links, NULL if all links are active
+     * @param mask  The same links as bits indexed by link, see computeActiveLinkMask(), NULL searches the set instead
+     */
+    void setActiveComponents(const std::set<const robot_model::LinkModel*> *links, const std::vector<bool> *mask)
+    {
+      active_components_only = links;
+      active_links = links ? mask : NULL;
+    }
+
+    /**
+     * @brief Whether a link is one of the active components
+     * @param link The link, NULL for world objects
+     * @return True if the link is active, otherwise false.
+     */
+    bool isActive(const robot_model::LinkModel *link) const
+    {
+      if (!link)
+        return false;
+
+      if (active_links)
+      {
+        const std::size_t index = link->getLinkIndex();
+        return index < active_links->size() && (*active_links)[index];
+      }
+
+      return active_components_only->find(link) != active_components_only->end();
+    }
+
     bool detailed;
 
     bool global;
@@ -117,8 +336,42 @@ namespace collision_detection
 
     bool verbose;
 
+    /** @brief Computes the unit gradient of each distance with respect to the position of the first object of the pair */
     bool gradient;
 
+    /**
+     * @brief The pairs involving a mesh with a coarse level of detail are measured with it first, its distance is used
+     * when it exceeds this margin plus the simplification error, otherwise the exact meshes are measured.  The default
+     * max() always measures the exact meshes.
+     */
+    double lod_margin;
+
+    /**
+     * @brief When set with a finite distance threshold, the world queries skip the links whose covering spheres are
+     * beyond the threshold from every world object, the objects other than spheres, boxes, cylinders and capsules are
+     * bounded by their axis aligned bounding box for this test.
+     */
+    const RobotSphereModel *sphere_model;
+
+    /**
+     * @brief The number of threads the links of the robot are split across by the world queries, including the calling
+     * thread.  The threads are shared by the process and a query that finds them busy runs on its calling thread.  The
+     * default 1 runs the query on the calling thread, more only pays off when the world makes a single query slow.
+     */
+    int num_threads;
+
+    /**
+     * @brief The bits of 'acm' that filter the pairs without looking up their names, NULL looks up every pair in
+     * 'acm'.  It must have been built from 'acm'.
+     */
+    const AllowedCollisionBitMatrix *acm_bits;
+
+    /**
+     * @brief The links of 'active_components_only' as bits indexed by link so that the callbacks test a bit instead of
+     * searching the set, NULL searches the set.  See setActiveComponents().
+     */
+    const std::vector<bool> *active_links;
+
   };
 
   struct DistanceResultsData
@@ -134,10 +387,10 @@ namespace collision_detection
     /// @brief nearest points
     Eigen::Vector3d nearest_points[2];
 
-    /// @brief object link names
-    std::string link_name[2];
+    /// @brief object identifiers, see getObjectName()
+    int link_id[2];
 
-    /// @brief gradient
+    /// @brief unit gradient of the distance with respect to the position of the first object, when requested
     Eigen::Vector3d gradient;
 
     bool hasGradient;
@@ -149,8 +402,8 @@ namespace collision_detection
       min_distance = std::numeric_limits<double>::max();
       nearest_points[0].setZero();
       nearest_points[1].setZero();
-      link_name[0] = "";
-      link_name[1] = "";
+      link_id[0] = INVALID_OBJECT_ID;
+      link_id[1] = INVALID_OBJECT_ID;
       gradient.setZero();
       hasGradient = false;
       hasNearestPoints = false;
@@ -161,15 +414,21 @@ namespace collision_detection
       min_distance = results.min_distance;
       nearest_points[0] = results.nearest_points[0];
       nearest_points[1] = results.nearest_points[1];
-      link_name[0] = results.link_name[0];
-      link_name[1] = results.link_name[1];
+      link_id[0] = results.link_id[0];
+      link_id[1] = results.link_id[1];
       gradient = results.gradient;
       hasGradient = results.hasGradient;
       hasNearestPoints = results.hasNearestPoints;
     }
   };
 
-  typedef std::map<std::string, DistanceResultsData> DistanceMap;
+  /**
+   * @brief The detailed distance results indexed by robot_model::LinkModel::getLinkIndex().  The distance of an attached
+   * body is stored in the entry of the link it is attached to.  In every entry link_id[0] and nearest_points[0] refer
+   * to the link (or its attached body) of the entry and the entries of the links that are not within the distance
+   * threshold have min_distance == max().
+   */
+  typedef std::vector<DistanceResultsData> DistanceVector;
 
   struct DistanceResult
   {
@@ -180,19 +439,35 @@ namespace collision_detection
 
     DistanceResultsData minimum_distance;
 
-    DistanceMap distance;
+    DistanceVector distance;
 
+    /** @brief Clears the results, the per link entries are kept allocated so that the result can be reused */
     void clear()
     {
       collision = false;
       minimum_distance.clear();
-      distance.clear();
+      for (std::size_t i = 0; i < distance.size(); ++i)
+        distance[i].clear();
+    }
+
+    /**
+     * @brief Makes room for a detailed result for every link of a robot model, the distance queries call it.
+     * @param num_links The number of links of the robot model, robot_model::RobotModel::getLinkModelCount()
+     */
+    void resize(std::size_t num_links)
+    {
+      distance.resize(num_links);
     }
   };
 
+  struct MeshLOD;
+
+  /** @brief The coarse version of the mesh geometries that have one by original geometry, see mesh_lod.h */
+  typedef std::unordered_map<const fcl::CollisionGeometry*, MeshLOD> MeshLODMap;
+
   struct DistanceData
   {
-    DistanceData(const DistanceRequest *req, DistanceResult *res): req(req), res(res), done(false) {}
+    DistanceData(const DistanceRequest *req, DistanceResult *res): req(req), res(res), done(false), lods(NULL) {}
     virtual ~DistanceData() {}
 
     const DistanceRequest *req;
@@ -201,6 +476,9 @@ namespace collision_detection
 
     bool done;
 
+    /** @brief The coarse versions of the mesh geometries, see DistanceRequest::lod_margin */
+    const MeshLODMap *lods;
+
   };
 
   bool distanceDetailedCallback(fcl::CollisionObject* o1, fcl::CollisionObject* o2, void *data, double& min_dist);
@@ -209,30 +487,70 @@ namespace collision_detection
   struct DistanceInfo
   {
     EIGEN_MAKE_ALIGNED_OPERATOR_NEW
-    std::string nearest_obsticle;     /**< The link name for nearest obsticle/link to request link. */
+    DistanceInfo(): nearest_obsticle(INVALID_OBJECT_ID), distance(std::numeric_limits<double>::max()) {}
+
+    int nearest_obsticle;             /**< The identifier of the nearest obsticle/link to request link, see getObjectName() */
     Eigen::Vector3d link_point;       /**< Point on request link */
     Eigen::Vector3d obsticle_point;   /**< Point on nearest link to requested link */
     Eigen::Vector3d avoidance_vector; /**< Normilized Vector created by nearest points */
     double distance;                  /**< Distance between nearest points */
   };
-  typedef std::map<std::string, DistanceInfo> DistanceInfoMap;
+  /** @brief The distance information indexed by robot_model::LinkModel::getLinkIndex(), see DistanceVector */
+  typedef std::vector<DistanceInfo> DistanceInfoVector;
 
   /**
    * @brief getDistanceInfo
-   * @param distance_detailed Detailed Distance Map
-   * @param distance_info_map Stores the distance information for each link in DistanceDetailedMap
+   * @param distance_detailed Detailed distance results indexed by link
+   * @param distance_info Stores the distance information for each link in distance_detailed, the links without a
+   * distance result have distance == max()
    * @param tf This allows for a transformation to be applied the distance data since it is always returned in the world frame from fcl.
-   * @return bool, true if succesfully converted DistanceDetailedMap to DistanceInfoMap
+   * @return bool, true if at least one link has a distance result
    */
-  bool getDistanceInfo(const DistanceMap &distance_detailed, DistanceInfoMap &distance_info_map, const Eigen::Affine3d &tf);
+  bool getDistanceInfo(const DistanceVector &distance_detailed, DistanceInfoVector &distance_info, const Eigen::Affine3d &tf);
 
   /**
    * @brief getDistanceInfo
-   * @param distance_detailed Detailed Distance Map
-   * @param distance_info_map Stores the distance information for each link in DistanceDetailedMap
-   * @return bool, true if succesfully converted DistanceDetailedMap to DistanceInfoMap
+   * @param distance_detailed Detailed distance results indexed by link
+   * @param distance_info Stores the distance information for each link in distance_detailed, the links without a
+   * distance result have distance == max()
+   * @return bool, true if at least one link has a distance result
+   */
+  bool getDistanceInfo(const DistanceVector &distance_detailed, DistanceInfoVector &distance_info);
+
+  /** @brief The collision flag and the minimum distance at every timestep of a joint trajectory */
+  struct TrajectoryCollisionResult
+  {
+    Eigen::Array<bool, Eigen::Dynamic, 1> collisions; /**< Whether the state at each timestep is in collision */
+    Eigen::VectorXd distances;                        /**< The minimum distance at each timestep, max() when not requested */
+
+    /** @brief Resizes the results to the number of timesteps and marks every timestep as collision free */
+    void clear(int num_timesteps)
+    {
+      collisions.setConstant(num_timesteps, false);
+      distances.setConstant(num_timesteps, std::numeric_limits<double>::max());
+    }
+  };
+
+  /**
+   * @brief The check applied to the state at a timestep of a trajectory
+   * @param state     The robot state placed at the timestep, its collision body transforms are up to date
+   * @param timestep  The timestep index
+   */
+  typedef std::function<void (const robot_state::RobotState &state, int timestep)> TrajectoryStateCheck;
+
+  /**
+   * @brief Places the robot at every timestep of the trajectory and invokes the check on the resulting state.  The
+   * timesteps are shared by the workers of the QueryThreadPool, each worker claims the next unchecked timestep and moves its
+   * own copy of the reference state so that the forward kinematics are computed once per timestep.
+   * @param reference_state The state providing the values of the joints that are not in the group
+   * @param group_name      The group whose joint values are stored in the trajectory
+   * @param trajectory      The joint values of the group at every timestep [dimensions][timesteps]
+   * @param num_threads     The number of threads to use, values less than 2 check every timestep on the calling thread
+   * @param check           Invoked once for each timestep, concurrently when using multiple threads
+   * @return False if the group does not exist or its number of variables differs from the trajectory rows
    */
-  bool getDistanceInfo(const DistanceMap &distance_detailed, DistanceInfoMap &distance_info_map);
+  bool forEachTrajectoryState(const robot_state::RobotState &reference_state, const std::string &group_name,
+                              const Eigen::MatrixXd &trajectory, int num_threads, const TrajectoryStateCheck &check);
 }
 
 #endif
@@ -37,16 +37,23 @@
 #ifndef COLLISION_DETECTION_COLLISION_ROBOT_INDUSTRIAL_H_
 #define COLLISION_DETECTION_COLLISION_ROBOT_INDUSTRIAL_H_
 
+#include <cstdint>
 #include <moveit/collision_detection/collision_robot.h>
 #include <moveit/collision_detection_fcl/collision_common.h>
 
 #include <industrial_collision_detection/collision_detection/collision_common.h>
+#include <industrial_collision_detection/collision_detection/mesh_lod.h>
 
 namespace collision_detection
 {
   typedef std::shared_ptr<fcl::CollisionObject> FCLCollisionObjectPtr;
   typedef std::shared_ptr<const fcl::CollisionObject> FCLCollisionObjectConstPtr;
 
+  /**
+   * @brief A collision robot using FCL.  The const queries build and update the collision objects of the robot in a
+   * broadphase owned by the calling thread, therefore concurrent queries from several threads are safe without locking.
+   * Changing the padding or the scaling must not happen concurrently with queries.
+   */
   class CollisionRobotIndustrial : public CollisionRobot
   {
     friend class CollisionWorldIndustrial;
@@ -62,6 +69,18 @@ namespace collision_detection
     virtual void checkSelfCollision(const CollisionRequest &req, CollisionResult &res, const robot_state::RobotState &state1, const robot_state::RobotState &state2) const;
     virtual void checkSelfCollision(const CollisionRequest &req, CollisionResult &res, const robot_state::RobotState &state1, const robot_state::RobotState &state2, const AllowedCollisionMatrix &acm) const;
 
+    /**
+     * @brief Whether the robot collides with itself.  The query stops at the first colliding pair and never computes
+     * contacts, penetration depths or distances, see collisionBooleanCallback().
+     * @param state       The state of the robot
+     * @param group_name  Only the pairs involving a link of this group are checked, all of them if empty
+     * @param acm         The allowed collision matrix, NULL if all collisions are checked
+     * @param acm_bits    The bits of the allowed collision matrix, NULL looks up every pair in 'acm'
+     * @return True if two links that are not allowed to collide overlap, otherwise false
+     */
+    bool isSelfColliding(const robot_state::RobotState &state, const std::string &group_name = "",
+                         const AllowedCollisionMatrix *acm = NULL, const AllowedCollisionBitMatrix *acm_bits = NULL) const;
+
     virtual void checkOtherCollision(const CollisionRequest &req, CollisionResult &res, const robot_state::RobotState &state,
                                      const CollisionRobot &other_robot, const robot_state::RobotState &other_state) const;
     virtual void checkOtherCollision(const CollisionRequest &req, CollisionResult &res, const robot_state::RobotState &state,
@@ -73,6 +92,22 @@ namespace collision_detection
                                      const CollisionRobot &other_robot, const robot_state::RobotState &other_state1, const robot_state::RobotState &other_state2,
                                      const AllowedCollisionMatrix &acm) const;
 
+    /**
+     * @brief Checks the robot for self collisions at every timestep of a joint trajectory.  The forward kinematics are
+     * computed once per timestep and the self collision broadphase is reused from one timestep to the next.
+     * @param req             The request applied at each timestep, its group_name selects the joints stored in the
+     *                        trajectory and the minimum distances are computed when its distance flag is set.
+     * @param res             The collision flag and minimum distance at each timestep
+     * @param reference_state The state providing the values of the joints that are not in the group
+     * @param trajectory      The joint values of the group at every timestep [dimensions][timesteps]
+     * @param acm             The allowed collision matrix, NULL if all collisions are checked
+     * @param num_threads     The number of threads the timesteps are split across
+     * @return False if the trajectory does not match the group
+     */
+    bool checkSelfTrajectoryCollision(const CollisionRequest &req, TrajectoryCollisionResult &res,
+                                      const robot_state::RobotState &reference_state, const Eigen::MatrixXd &trajectory,
+                                      const AllowedCollisionMatrix *acm = NULL, int num_threads = 1) const;
+
     virtual double distanceSelf(const robot_state::RobotState &state) const;
     virtual double distanceSelf(const robot_state::RobotState &state, const AllowedCollisionMatrix &acm) const;
     virtual void distanceSelf(const DistanceRequest &req, DistanceResult &res, const robot_state::RobotState &state) const;
@@ -87,6 +122,17 @@ namespace collision_detection
     virtual void updatedPaddingOrScaling(const std::vector<std::string> &links);
     void constructFCLObject(const robot_state::RobotState &state, FCLObject &fcl_obj) const;
     void allocSelfCollisionBroadPhase(const robot_state::RobotState &state, FCLManager &manager) const;
+
+    /**
+     * @brief Returns the self collision broadphase of the calling thread with its objects placed at the given state.
+     * The broadphase persists between queries, only the transforms of its objects and the tree bounds are updated.  It is
+     * rebuilt when the attached bodies or the link geometries change.
+     * @param state       The state of the robot
+     * @param update_tree When false only the objects are moved and the tree bounds are left stale, which is enough to
+     *                    query the objects against another manager.
+     * @return The broadphase, valid until the next query made by the calling thread
+     */
+    FCLManager& getSelfCollisionBroadPhase(const robot_state::RobotState &state, bool update_tree = true) const;
     void getAttachedBodyObjects(const robot_state::AttachedBody *ab, std::vector<FCLGeometryConstPtr> &geoms) const;
 
     void checkSelfCollisionHelper(const CollisionRequest &req, CollisionResult &res, const robot_state::RobotState &state,
@@ -101,6 +147,8 @@ namespace collision_detection
 
     std::vector<FCLGeometryConstPtr> geoms_;
     std::vector<FCLCollisionObjectConstPtr> fcl_objs_;
+    std::uint64_t broadphase_id_;   /**< Identifies the geometries in the thread local broadphases, shared by the copies */
+    MeshLODMapConstPtr mesh_lods_;  /**< The coarse versions of the link meshes, shared with the copies of this instance */
   };
 
   typedef std::shared_ptr<CollisionRobotIndustrial> CollisionRobotIndustrialPtr;
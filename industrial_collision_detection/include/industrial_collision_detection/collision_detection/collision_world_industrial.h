@@ -38,16 +38,45 @@
 #define COLLISION_DETECTION_COLLISION_WORLD_INDUSTRIAL_H_
 
 #include <industrial_collision_detection/collision_detection/collision_robot_industrial.h>
+#include <industrial_collision_detection/collision_detection/world_distance_field.h>
 #include <fcl/broadphase/broadphase.h>
 #include <boost/scoped_ptr.hpp>
+#include <atomic>
+#include <deque>
+#include <mutex>
 
 namespace collision_detection
 {
 
+  class CollisionWorldIndustrial;
+  typedef std::shared_ptr<const CollisionWorldIndustrial> CollisionWorldIndustrialConstPtr;
+
+  /**
+   * @brief A collision world using FCL.
+   *
+   * The const collision and distance queries only traverse the broadphase and the fcl objects of the world, the objects
+   * of the robot are kept per thread by CollisionRobotIndustrial.  Any number of threads may therefore query the same
+   * world concurrently without locking, as long as the world is not modified at the same time.
+   *
+   * To keep querying while the world is being edited, for instance by sensor updates, the readers query a snapshot
+   * created with createSnapshot() and the writer publishes a new snapshot after its edits (read-copy-update).  The
+   * world never modifies an fcl object it shares with a snapshot, the objects that change are replaced instead.
+   */
   class CollisionWorldIndustrial : public CollisionWorld
   {
   public:
 
+    /** @brief How the octree shapes of the world, usually built from sensor data, are represented */
+    struct OctreeParameters
+    {
+      OctreeParameters(): resolution(0.0), occupancy_threshold(0.5), use_distance_field(false) {}
+
+      double resolution;            /**< The octrees are coarsened to this voxel size, 0 keeps the resolution of each octree */
+      double occupancy_threshold;   /**< The occupancy above which a voxel is an obstacle, the others are free space */
+      bool use_distance_field;      /**< When true the octrees are only added to the distance field returned by
+                                         getDistanceField() and the collision and distance queries of this class ignore them */
+    };
+
     CollisionWorldIndustrial();
     explicit CollisionWorldIndustrial(const WorldPtr& world);
     CollisionWorldIndustrial(const CollisionWorldIndustrial &other, const WorldPtr& world);
@@ -58,6 +87,35 @@ namespace collision_detection
     virtual void checkRobotCollision(const CollisionRequest &req, CollisionResult &res, const CollisionRobot &robot, const robot_state::RobotState &state, const AllowedCollisionMatrix &acm) const;
     virtual void checkRobotCollision(const CollisionRequest &req, CollisionResult &res, const CollisionRobot &robot, const robot_state::RobotState &state1, const robot_state::RobotState &state2) const;
     virtual void checkRobotCollision(const CollisionRequest &req, CollisionResult &res, const CollisionRobot &robot, const robot_state::RobotState &state1, const robot_state::RobotState &state2, const AllowedCollisionMatrix &acm) const;
+
+    /**
+     * @brief Checks the robot against the world and against itself in a single query.  The link objects are placed once
+     * in the self collision broadphase of the calling thread and that broadphase is collided against the world and then
+     * against itself.  The self check is skipped once the world check has found enough contacts for the request.
+     * @param req   The request, its contacts and max_contacts apply to both checks combined
+     * @param res   The combined result, its distance is the smallest of the world and self distances when requested
+     * @param robot The robot, must be a CollisionRobotIndustrial
+     * @param state The state of the robot
+     * @param acm   The allowed collision matrix, NULL if all collisions are checked
+     * @param acm_bits  The bits of the allowed collision matrix, NULL looks up every pair in 'acm'
+     */
+    void checkRobotAndSelfCollision(const CollisionRequest &req, CollisionResult &res, const CollisionRobot &robot,
+                                    const robot_state::RobotState &state, const AllowedCollisionMatrix *acm = NULL,
+                                    const AllowedCollisionBitMatrix *acm_bits = NULL) const;
+
+    /**
+     * @brief Whether the robot collides with the world or with itself.  The query stops at the first colliding pair and
+     * never computes contacts, penetration depths or distances, see collisionBooleanCallback().
+     * @param robot       The robot, must be a CollisionRobotIndustrial
+     * @param state       The state of the robot
+     * @param group_name  Only the pairs involving a link of this group are checked, all of them if empty
+     * @param acm         The allowed collision matrix, NULL if all collisions are checked
+     * @param acm_bits    The bits of the allowed collision matrix, NULL looks up every pair in 'acm'
+     * @return True if two objects that are not allowed to collide overlap, otherwise false
+     */
+    bool isRobotColliding(const CollisionRobot &robot, const robot_state::RobotState &state, const std::string &group_name = "",
+                          const AllowedCollisionMatrix *acm = NULL, const AllowedCollisionBitMatrix *acm_bits = NULL) const;
+
     virtual void checkWorldCollision(const CollisionRequest &req, CollisionResult &res, const CollisionWorld &other_world) const;
     virtual void checkWorldCollision(const CollisionRequest &req, CollisionResult &res, const CollisionWorld &other_world, const AllowedCollisionMatrix &acm) const;
 
@@ -66,25 +124,148 @@ namespace collision_detection
     		const robot_state::RobotState &state,bool verbose = false) const;
     virtual double distanceRobot(const CollisionRobot &robot, const robot_state::RobotState &state, const AllowedCollisionMatrix &acm,
     		bool verbose = false) const;
+
+    /**
+     * @brief Computes the minimum distance between the robot and the world at each of the states.  The collision objects
+     * of the robot are allocated once per thread and only moved from one state to the next.
+     * @param robot     The robot, must be a CollisionRobotIndustrial
+     * @param states    The states of the robot
+     * @param distances The minimum distance at each state, resized to the number of states
+     * @param acm       The allowed collision matrix, NULL if all collisions are checked
+     */
+    void distanceRobotStates(const CollisionRobot &robot, const std::vector<robot_state::RobotState> &states,
+                             std::vector<double> &distances, const AllowedCollisionMatrix *acm = NULL) const;
+
+    /**
+     * @brief Checks the robot against the world at every timestep of a joint trajectory.  The forward kinematics are
+     * computed once per timestep and the collision objects of the robot are reused from one timestep to the next.
+     * @param req             The request applied at each timestep, its group_name selects the joints stored in the
+     *                        trajectory and the minimum distances are computed when its distance flag is set.
+     * @param res             The collision flag and minimum distance at each timestep
+     * @param robot           The robot, must be a CollisionRobotIndustrial
+     * @param reference_state The state providing the values of the joints that are not in the group
+     * @param trajectory      The joint values of the group at every timestep [dimensions][timesteps]
+     * @param acm             The allowed collision matrix, NULL if all collisions are checked
+     * @param num_threads     The number of threads the timesteps are split across
+     * @return False if the trajectory does not match the group
+     */
+    bool checkTrajectoryCollision(const CollisionRequest &req, TrajectoryCollisionResult &res, const CollisionRobot &robot,
+                                  const robot_state::RobotState &reference_state, const Eigen::MatrixXd &trajectory,
+                                  const AllowedCollisionMatrix *acm = NULL, int num_threads = 1) const;
+
     virtual double distanceWorld(const CollisionWorld &world,bool verbose = false) const;
     virtual double distanceWorld(const CollisionWorld &world, const AllowedCollisionMatrix &acm,bool verbose = false) const;
 
     virtual void setWorld(const WorldPtr& world);
 
+    /**
+     * @brief Creates a read only copy of the current state of the world.  The copy shares the fcl objects and the
+     * world objects with this world and is not affected by later edits of this world, it may be queried concurrently
+     * while this world is modified.  Its distance field is built separately when requested.
+     * @return The snapshot
+     */
+    CollisionWorldIndustrialConstPtr createSnapshot() const;
+
+    /**
+     * @brief Returns the signed distance field of the world objects.  It is built the first time it is requested with a
+     * given set of parameters and then kept up to date incrementally as objects are added, moved or removed.
+     * @param params  The grid parameters, the field is rebuilt when they differ from those of the current field
+     * @return The distance field, it must not be used while the world is being modified, see createSnapshot()
+     */
+    WorldDistanceFieldConstPtr getDistanceField(const WorldDistanceField::Parameters &params) const;
+
+    /**
+     * @brief Sets how the octrees are represented, the fcl objects of the octrees already in the world are rebuilt
+     * @param params The octree parameters
+     */
+    void setOctreeParameters(const OctreeParameters &params);
+
+    /** @brief The octree parameters */
+    const OctreeParameters& getOctreeParameters() const { return octree_params_; }
+
   protected:
 
     void checkWorldCollisionHelper(const CollisionRequest &req, CollisionResult &res, const CollisionWorld &other_world, const AllowedCollisionMatrix *acm) const;
     void checkRobotCollisionHelper(const CollisionRequest &req, CollisionResult &res, const CollisionRobot &robot, const robot_state::RobotState &state, const AllowedCollisionMatrix *acm) const;
+
+    /**
+     * @brief Checks the motion of the robot between two states against the world using conservative advancement over
+     * the swept volume of each link, the links are interpolated linearly in cartesian space.  Only the world objects
+     * the broadphase finds overlapping the box bounding a link at both states are checked, and the conditional entries
+     * of the allowed collision matrix decide on the contacts at the time of contact.  Only the collision flag of the
+     * result is set, contacts are not reported.
+     */
+    void checkRobotCollisionHelper(const CollisionRequest &req, CollisionResult &res, const CollisionRobot &robot, const robot_state::RobotState &state1,
+                                   const robot_state::RobotState &state2, const AllowedCollisionMatrix *acm) const;
     double distanceRobotHelper(const CollisionRobot &robot, const robot_state::RobotState &state, const AllowedCollisionMatrix *acm) const;
     void distanceRobotHelper(const DistanceRequest &req, DistanceResult &res, const collision_detection::CollisionRobot &robot, const robot_state::RobotState &state) const;
     double distanceWorldHelper(const CollisionWorld &world, const AllowedCollisionMatrix *acm) const;
 
-    void constructFCLObject(const World::Object *obj, FCLObject &fcl_obj) const;
+    void constructFCLObject(const World::Object *obj, FCLObject &fcl_obj);
     void updateFCLObject(const std::string &id);
 
+    /** @brief Adds the fcl objects of a world object to the broadphase, unless it is still to be built */
+    void registerFCLObject(FCLObject &fcl_obj);
+
+    /** @brief Removes the fcl objects of a world object from the broadphase, unless it is still to be built */
+    void unregisterFCLObject(FCLObject &fcl_obj);
+
+    /**
+     * @brief Returns the broadphase of the world objects.  A copied world builds it on its first query from the objects
+     * it shares with the original world, concurrent queries are safe.
+     * @return The broadphase
+     */
+    fcl::BroadPhaseCollisionManager* getManager() const;
+
+    /**
+     * @brief Moves the fcl objects of a world object to the current poses of its shapes, their geometry is kept.  The
+     * objects shared with a copied world are replaced by copies first.
+     * @param obj The world object whose shapes were moved
+     */
+    void moveFCLObject(const World::Object *obj);
+
+    /**
+     * @brief Keeps the mesh geometries of an object that is being removed so that an identical mesh added later does
+     * not have to build its bounding volume hierarchy again.
+     * @param obj     The world object, its shapes must still be those of fcl_obj
+     * @param fcl_obj The fcl objects of the world object
+     */
+    void retireGeometries(const World::Object *obj, const FCLObject &fcl_obj);
+
+    /**
+     * @brief Looks for a retired mesh geometry identical to a shape of an object and hands it over to the object
+     * @param obj         The world object
+     * @param shape_index The index of the shape in the object
+     * @return The geometry or null if none matches the shape
+     */
+    FCLGeometryConstPtr reuseRetiredGeometry(const World::Object *obj, std::size_t shape_index);
+
+    /**
+     * @brief Creates the geometry of an octree shape, the occupied voxels are merged at the octree resolution of the
+     * parameters and the free and unknown space is pruned from the hierarchy.
+     * @param obj         The world object
+     * @param shape_index The index of the octree shape in the object
+     * @return The geometry
+     */
+    FCLGeometryConstPtr createOcTreeGeometry(const World::Object *obj, std::size_t shape_index) const;
+
+    /** @brief The geometry of a removed mesh */
+    struct RetiredGeometry
+    {
+      unsigned int vertex_count;                                /**< The number of vertices of the mesh */
+      unsigned int triangle_count;                              /**< The number of triangles of the mesh */
+      std::uint64_t signature;                                  /**< The hash of the mesh, see computeShapeSignature() */
+      boost::shared_ptr<fcl::CollisionGeometry> geometry;      /**< The fcl geometry and its bounding volume hierarchy */
+    };
 
     boost::scoped_ptr<fcl::BroadPhaseCollisionManager> manager_;
     std::map<std::string, FCLObject >                  fcl_objs_;
+    mutable std::atomic<bool>                          manager_ready_;        /**< Whether manager_ holds the objects of fcl_objs_ */
+    mutable std::mutex                                 manager_mutex_;        /**< Guards the deferred build of manager_ */
+    std::deque<RetiredGeometry>                        retired_geometries_;   /**< The most recently retired last */
+    OctreeParameters                                   octree_params_;        /**< The representation of the octrees */
+    mutable WorldDistanceFieldPtr                      distance_field_;       /**< Built on request, null before */
+    mutable std::mutex                                 distance_field_mutex_; /**< Guards the creation of the distance field */
 
   private:
     void initialize();
@@ -93,7 +274,6 @@ namespace collision_detection
   };
 
   typedef std::shared_ptr<CollisionWorldIndustrial> CollisionWorldIndustrialPtr;
-  typedef std::shared_ptr<const CollisionWorldIndustrial> CollisionWorldIndustrialConstPtr;
 }
 
 #endif
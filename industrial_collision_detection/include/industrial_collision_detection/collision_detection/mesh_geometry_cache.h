@@ -0,0 +1,53 @@
+/**
+ * @file mesh_geometry_cache.h
+ * @brief This contains a process wide cache of the bounding volume hierarchies of the world meshes
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @license Software License Agreement (Apache License)\n
+ * \n
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at\n
+ * \n
+ * http://www.apache.org/licenses/LICENSE-2.0\n
+ * \n
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef COLLISION_DETECTION_MESH_GEOMETRY_CACHE_H_
+#define COLLISION_DETECTION_MESH_GEOMETRY_CACHE_H_
+
+#include <moveit/collision_detection/world.h>
+#include <moveit/collision_detection_fcl/collision_common.h>
+
+namespace collision_detection
+{
+
+  /**
+   * @brief Creates the geometry of a shape of a world object.  The bounding volume hierarchies of the meshes are kept
+   * by content in a cache shared by every world of the process, so that a mesh published again as a new shape, or
+   * added to another planning scene, copies the hierarchy instead of building it again.  The other shapes are created
+   * as usual.  This function is thread safe.
+   * @param shape       The shape
+   * @param obj         The world object owning the shape
+   * @param shape_index The index of the shape in the object
+   * @return The geometry or null if it could not be created
+   */
+  FCLGeometryConstPtr createCachedCollisionGeometry(const shapes::ShapeConstPtr &shape, const World::Object *obj,
+                                                    int shape_index);
+
+  /** @brief Drops the bounding volume hierarchies kept by createCachedCollisionGeometry() */
+  void clearMeshGeometryCache();
+
+}
+
+#endif // COLLISION_DETECTION_MESH_GEOMETRY_CACHE_H_
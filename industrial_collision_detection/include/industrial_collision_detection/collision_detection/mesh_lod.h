@@ -0,0 +1,88 @@
+/**
+ * @file mesh_lod.h
+ * @brief This contains the coarse levels of detail of the robot meshes used by the distance queries
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @license Software License Agreement (Apache License)\n
+ * \n
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at\n
+ * \n
+ * http://www.apache.org/licenses/LICENSE-2.0\n
+ * \n
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef COLLISION_DETECTION_MESH_LOD_H_
+#define COLLISION_DETECTION_MESH_LOD_H_
+
+#include <industrial_collision_detection/collision_detection/collision_common.h>
+#include <memory>
+
+namespace collision_detection
+{
+
+  /** @brief A coarse version of a mesh geometry */
+  struct MeshLOD
+  {
+    boost::shared_ptr<fcl::CollisionGeometry> geometry; /**< The simplified mesh, in the frame of the original one */
+    double error;                                       /**< Every point of either surface is within this distance of the other one */
+  };
+
+  typedef std::shared_ptr<const MeshLODMap> MeshLODMapConstPtr;
+
+  /**
+   * @brief Simplifies a mesh by clustering its vertices on a grid, every vertex moves to the mean of the vertices of its
+   * grid cell and the triangles that collapse are dropped.  The error is the largest displacement of a vertex, which
+   * bounds the distance between the two surfaces in both directions.
+   * @param mesh      The mesh
+   * @param cell_size The size of a grid cell
+   * @param lod       Returns the simplified mesh
+   * @return False if the simplified mesh would not be much smaller than the original one, otherwise true.
+   */
+  bool createMeshLOD(const shapes::Mesh &mesh, double cell_size, MeshLOD &lod);
+
+  /**
+   * @brief Retrieves the coarse version of the geometry of a shape, meshes of at least a few thousand triangles are
+   * simplified with a grid cell proportional to their size.  The level of detail of a geometry is kept in a process wide
+   * cache as long as the geometry exists, so that the robots of several planning scenes build it once.  This function
+   * is thread safe.
+   * @param shape     The shape
+   * @param scale     The scale applied to the shape by the geometry
+   * @param padding   The padding applied to the shape by the geometry
+   * @param geometry  The geometry created from the shape
+   * @param lod       Returns the coarse geometry
+   * @return True if the shape has a coarse version, otherwise false.
+   */
+  bool getMeshLOD(const shapes::ShapeConstPtr &shape, double scale, double padding,
+                  const boost::shared_ptr<fcl::CollisionGeometry> &geometry, MeshLOD &lod);
+
+  /**
+   * @brief Measures the distance between two objects using the coarse version of their geometries.  The coarse
+   * distance is within the sum of their errors of the exact one, the query is settled when it proves the pair is not
+   * closer than the threshold or when the pair is further apart than the margin of the request.
+   * @param o1        The first object
+   * @param o2        The second object
+   * @param lods      The coarse geometries
+   * @param req       The distance request, DistanceRequest::lod_margin
+   * @param threshold Only a distance below it is of interest
+   * @param result    Returns the coarse result when the query is settled by a distance below the threshold
+   * @param d         Returns the coarse distance, or the threshold when the pair is not closer than it
+   * @return True if the coarse geometries settled the query, false if the exact geometries must be measured.
+   */
+  bool distanceCoarse(const fcl::CollisionObject &o1, const fcl::CollisionObject &o2, const MeshLODMap &lods,
+                      const DistanceRequest &req, double threshold, fcl::DistanceResult &result, double &d);
+
+}
+
+#endif // COLLISION_DETECTION_MESH_LOD_H_
@@ -0,0 +1,141 @@
+/**
+ * @file primitive_distance.h
+ * @brief This contains batched distance kernels between spheres and primitive shapes
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @license Software License Agreement (Apache License)\n
+ * \n
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at\n
+ * \n
+ * http://www.apache.org/licenses/LICENSE-2.0\n
+ * \n
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef COLLISION_DETECTION_PRIMITIVE_DISTANCE_H_
+#define COLLISION_DETECTION_PRIMITIVE_DISTANCE_H_
+
+#include <Eigen/Geometry>
+#include <cstddef>
+#include <vector>
+
+namespace collision_detection
+{
+
+  /**
+   * @brief A set of spheres stored as a structure of arrays so that the distance kernels process several spheres per
+   * instruction
+   */
+  struct SphereBatch
+  {
+    std::vector<double> x;      /**< The x coordinate of each center */
+    std::vector<double> y;      /**< The y coordinate of each center */
+    std::vector<double> z;      /**< The z coordinate of each center */
+    std::vector<double> radius; /**< The radius of each sphere */
+
+    /** @brief The number of spheres */
+    std::size_t size() const { return x.size(); }
+
+    /** @brief Removes the spheres, the storage is kept */
+    void clear()
+    {
+      x.clear();
+      y.clear();
+      z.clear();
+      radius.clear();
+    }
+
+    /**
+     * @brief Adds a sphere
+     * @param center  The center
+     * @param r       The radius
+     */
+    void add(const Eigen::Vector3d &center, double r)
+    {
+      x.push_back(center.x());
+      y.push_back(center.y());
+      z.push_back(center.z());
+      radius.push_back(r);
+    }
+
+    /** @brief The center of a sphere */
+    Eigen::Vector3d center(std::size_t i) const { return Eigen::Vector3d(x[i], y[i], z[i]); }
+  };
+
+  /** @brief A sphere, a box, a cylinder or a capsule, the cylinders and the capsules are aligned with the z axis */
+  struct CollisionPrimitive
+  {
+    enum Type
+    {
+      SPHERE,
+      BOX,
+      CYLINDER,
+      CAPSULE
+    };
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    CollisionPrimitive(): type(SPHERE), pose(Eigen::Affine3d::Identity()), half_extents(Eigen::Vector3d::Zero()),
+                          radius(0.0), half_length(0.0) {}
+
+    Type type;                    /**< The kind of primitive */
+    Eigen::Affine3d pose;         /**< The pose of the primitive frame, rigid */
+    Eigen::Vector3d half_extents; /**< The half sizes of a box */
+    double radius;                /**< The radius of a sphere, a cylinder or a capsule */
+    double half_length;           /**< The half length of a cylinder or of the segment of a capsule */
+  };
+
+  /** @brief The nearest sphere of a batch to a primitive */
+  struct PrimitiveDistance
+  {
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    PrimitiveDistance(): distance(0.0), sphere(0) {}
+
+    double distance;                  /**< The signed distance, negative when they overlap */
+    std::size_t sphere;               /**< The index of the nearest sphere */
+    Eigen::Vector3d nearest_points[2]; /**< The nearest point of the sphere and of the primitive */
+  };
+
+  /** @brief Whether the kernels were compiled for AVX2 or NEON instructions, otherwise they are scalar code */
+  bool isPrimitiveDistanceVectorized();
+
+  /**
+   * @brief Computes the signed distance between every sphere of a batch and a primitive
+   * @param spheres   The spheres
+   * @param primitive The primitive
+   * @param distances Returns the distance of each sphere, negative when it overlaps the primitive
+   */
+  void computeSphereDistances(const SphereBatch &spheres, const CollisionPrimitive &primitive,
+                              std::vector<double> &distances);
+
+  /**
+   * @brief Finds the sphere of a batch nearest to a primitive and the witness points of their distance
+   * @param spheres   The spheres, not empty
+   * @param primitive The primitive
+   * @param distances Storage for the distances of the spheres, reused between calls
+   * @return The distance of the nearest sphere
+   */
+  PrimitiveDistance computeMinimumDistance(const SphereBatch &spheres, const CollisionPrimitive &primitive,
+                                           std::vector<double> &distances);
+
+  /**
+   * @brief Computes the point of the surface of a primitive nearest to a point
+   * @param primitive The primitive
+   * @param point     The point
+   * @return The nearest point of the surface
+   */
+  Eigen::Vector3d computeClosestSurfacePoint(const CollisionPrimitive &primitive, const Eigen::Vector3d &point);
+
+}
+
+#endif // COLLISION_DETECTION_PRIMITIVE_DISTANCE_H_
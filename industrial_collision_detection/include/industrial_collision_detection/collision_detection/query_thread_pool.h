@@ -0,0 +1,88 @@
+/**
+ * @file query_thread_pool.h
+ * @brief This contains the threads shared by the queries that split their work over several workers
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @license Software License Agreement (Apache License)\n
+ * \n
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at\n
+ * \n
+ * http://www.apache.org/licenses/LICENSE-2.0\n
+ * \n
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef COLLISION_DETECTION_QUERY_THREAD_POOL_H_
+#define COLLISION_DETECTION_QUERY_THREAD_POOL_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace collision_detection
+{
+
+  /**
+   * @brief The threads sharing the work of a single query, for instance the per link queries of a distance request or
+   * the states of a trajectory.  The threads are started on first use and kept until the process exits so that their
+   * thread_local caches survive from one query to the next, the calling thread takes part as worker 0.  A query that
+   * finds the pool busy with another query, or that is started by a job of the pool, runs on its calling thread alone.
+   */
+  class QueryThreadPool
+  {
+  public:
+
+    /** @brief A job claims its work items itself, therefore any number of workers down to one completes it */
+    typedef std::function<void (std::size_t worker)> Job;
+
+    /** @brief The pool shared by the queries of the process */
+    static QueryThreadPool& instance();
+
+    ~QueryThreadPool();
+
+    /**
+     * @brief Runs a job on a number of workers and blocks until all of them have returned
+     * @param num_workers The number of workers, including the calling thread
+     * @param job         The job, invoked once per worker
+     */
+    void run(std::size_t num_workers, const Job &job);
+
+  protected:
+
+    QueryThreadPool();
+
+    /**
+     * @brief The loop of a pool thread
+     * @param worker The worker index of the thread
+     */
+    void work(std::size_t worker);
+
+    std::vector<std::thread> threads_;    /**< The pool threads, worker i + 1 is threads_[i] */
+    std::mutex run_mutex_;                /**< Held by the query using the pool */
+    std::mutex mutex_;                    /**< Guards the state below */
+    std::condition_variable start_;       /**< Signals a new job or the shutdown */
+    std::condition_variable done_;        /**< Signals the completion of a job */
+    const Job *job_;                      /**< The current job */
+    std::size_t num_workers_;             /**< The number of workers of the current job */
+    std::size_t pending_;                 /**< The number of pool threads still executing the current job */
+    std::size_t generation_;              /**< Incremented for every job */
+    bool stop_;                           /**< Whether the threads exit */
+  };
+
+}
+
+#endif /* COLLISION_DETECTION_QUERY_THREAD_POOL_H_ */
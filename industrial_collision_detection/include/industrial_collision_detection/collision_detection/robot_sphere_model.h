@@ -0,0 +1,152 @@
+/**
+ * @file robot_sphere_model.h
+ * @brief This contains an approximation of the robot collision shapes by sets of spheres
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @license Software License Agreement (Apache License)\n
+ * \n
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at\n
+ * \n
+ * http://www.apache.org/licenses/LICENSE-2.0\n
+ * \n
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef COLLISION_DETECTION_ROBOT_SPHERE_MODEL_H_
+#define COLLISION_DETECTION_ROBOT_SPHERE_MODEL_H_
+
+#include <moveit/robot_model/robot_model.h>
+#include <geometric_shapes/shapes.h>
+#include <cstdint>
+#include <memory>
+
+namespace collision_detection
+{
+
+  /** @brief A sphere expressed in the frame of the collision shape it bounds */
+  struct CollisionSphere
+  {
+    Eigen::Vector3d center;   /**< The center in the shape frame */
+    double radius;            /**< The radius */
+  };
+  typedef std::vector<CollisionSphere> CollisionSpheres;
+
+  class RobotSphereModel;
+  typedef std::shared_ptr<RobotSphereModel> RobotSphereModelPtr;
+  typedef std::shared_ptr<const RobotSphereModel> RobotSphereModelConstPtr;
+
+  /**
+   * @brief Approximates every collision shape of the robot links by a set of spheres that covers its surface.  The
+   * spheres are computed by recursively splitting the points sampled on the shape surface and can be cached on disk
+   * since generating them for detailed meshes is expensive.
+   */
+  class RobotSphereModel
+  {
+  public:
+
+    /** @brief Controls the number and the size of the spheres */
+    struct Parameters
+    {
+      Parameters(): max_radius(0.05), sample_spacing(0.01), max_spheres_per_shape(32) {}
+
+      bool operator==(const Parameters &other) const
+      {
+        return max_radius == other.max_radius && sample_spacing == other.sample_spacing &&
+            max_spheres_per_shape == other.max_spheres_per_shape;
+      }
+
+      double max_radius;          /**< The shapes are split until their spheres are smaller than this radius */
+      double sample_spacing;      /**< The distance between the points sampled on the shape surfaces */
+      int max_spheres_per_shape;  /**< The maximum number of spheres used for each shape */
+    };
+
+    /**
+     * @brief Generates the spheres of all the link collision shapes
+     * @param model   The robot model
+     * @param params  The decomposition parameters
+     */
+    RobotSphereModel(const robot_model::RobotModelConstPtr &model, const Parameters &params);
+
+    /**
+     * @brief Loads the sphere model from the cache directory, it is generated and saved when it is not found there or
+     * when it was generated from different shapes or parameters.
+     * @param model           The robot model
+     * @param params          The decomposition parameters
+     * @param cache_directory The directory of the sphere files, nothing is cached when empty
+     * @return The sphere model
+     */
+    static RobotSphereModelPtr create(const robot_model::RobotModelConstPtr &model, const Parameters &params,
+                                      const std::string &cache_directory);
+
+    /** @brief The default cache directory, $ROS_HOME/sphere_models or ~/.ros/sphere_models */
+    static std::string getDefaultCacheDirectory();
+
+    /**
+     * @brief Computes the spheres that cover the surface of a shape
+     * @param shape   The shape, planes and octrees produce no spheres
+     * @param params  The decomposition parameters
+     * @param spheres The spheres in the shape frame, they are appended
+     */
+    static void decomposeShape(const shapes::Shape &shape, const Parameters &params, CollisionSpheres &spheres);
+
+    /**
+     * @brief The spheres of a link collision shape
+     * @param link        The link
+     * @param shape_index The index of the shape in the link
+     * @return The spheres in the shape frame
+     */
+    const CollisionSpheres& getSpheres(const robot_model::LinkModel *link, std::size_t shape_index) const
+    {
+      return body_spheres_[link->getFirstCollisionBodyTransformIndex() + shape_index];
+    }
+
+    /** @brief The decomposition parameters */
+    const Parameters& getParameters() const { return params_; }
+
+    /**
+     * @brief Writes the spheres to a file
+     * @param path The file path
+     * @return False if the file could not be written
+     */
+    bool save(const std::string &path) const;
+
+    /**
+     * @brief Reads the spheres from a file written by save()
+     * @param path The file path
+     * @return False if the file could not be read or it was generated from other shapes or parameters, the model is
+     * left unchanged in that case.
+     */
+    bool load(const std::string &path);
+
+  protected:
+
+    /**
+     * @brief Computes the shape signatures, the spheres are only generated when requested
+     * @param model             The robot model
+     * @param params            The decomposition parameters
+     * @param generate_spheres  Whether to generate the spheres, otherwise they are expected to be read by load()
+     */
+    RobotSphereModel(const robot_model::RobotModelConstPtr &model, const Parameters &params, bool generate_spheres);
+
+    /** @brief Generates the spheres of all the link collision shapes */
+    void generate();
+
+    robot_model::RobotModelConstPtr model_;         /**< The robot model */
+    Parameters params_;                             /**< The decomposition parameters */
+    std::vector<CollisionSpheres> body_spheres_;    /**< The spheres of each collision body, indexed as the link geometries */
+    std::vector<std::uint64_t> body_signatures_;    /**< A hash of each collision shape, used to validate the cached files */
+  };
+}
+
+#endif
@@ -0,0 +1,123 @@
+/**
+ * @file temporal_distance_cache.h
+ * @brief This contains a cache that skips the distance queries of links that can not have come close to an obstacle
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @license Software License Agreement (Apache License)\n
+ * \n
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at\n
+ * \n
+ * http://www.apache.org/licenses/LICENSE-2.0\n
+ * \n
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef COLLISION_DETECTION_TEMPORAL_DISTANCE_CACHE_H_
+#define COLLISION_DETECTION_TEMPORAL_DISTANCE_CACHE_H_
+
+#include <industrial_collision_detection/collision_detection/collision_world_industrial.h>
+#include <Eigen/StdVector>
+#include <memory>
+#include <set>
+#include <vector>
+
+namespace collision_detection
+{
+
+  /**
+   * @brief Exploits the temporal coherence of successive distance queries, for instance the iterations of an inverse
+   * kinematics solver.  The links are evaluated with the request threshold plus a margin and remember a lower bound of
+   * their distance.  A link is skipped by the following queries as long as its motion since it was evaluated, bounded by
+   * the displacement of its frame plus its rotation times the radius of its geometry, and the motion of the other links
+   * can not have brought it within the threshold.  The results of the evaluated links are exact and the skipped links
+   * have no entry, exactly like the links farther than the threshold.
+   *
+   * The cache assumes the world does not change while it is used, it must be cleared otherwise.  It is not thread safe,
+   * each solver uses its own.
+   */
+  class TemporalDistanceCache
+  {
+  public:
+
+    /**
+     * @brief Constructor
+     * @param margin The distance beyond the threshold up to which the links are evaluated, a larger margin lets far
+     *               links be skipped for longer at the expense of evaluating more pairs when they are evaluated.
+     */
+    explicit TemporalDistanceCache(double margin = 0.05);
+
+    /** @brief Forgets all the links, the next query evaluates all of them */
+    void clear();
+
+    /**
+     * @brief Computes the self and world distances of the active links, the same results as
+     * CollisionRobotIndustrial::distanceSelf() followed by CollisionWorldIndustrial::distanceRobot().  Requests that
+     * are global or have no active components are forwarded without caching.
+     * @param req   The request, the cache is cleared when its threshold or active components change
+     * @param res   The result, it must be cleared by the caller
+     * @param robot The collision robot
+     * @param world The collision world, it must not change without clearing the cache
+     * @param state The robot state, its link transforms must be up to date
+     */
+    void distance(const DistanceRequest &req, DistanceResult &res, const CollisionRobotIndustrial &robot,
+                  const CollisionWorldIndustrial &world, const robot_state::RobotState &state);
+
+    /** @brief The number of active links evaluated by the last query, the others were skipped */
+    std::size_t getNumEvaluatedLinks() const { return num_evaluated_links_; }
+
+  protected:
+
+    /** @brief What is known about a link */
+    struct LinkBound
+    {
+      EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+      LinkBound(): evaluated(false), lower_bound(0.0), motion_at_evaluation(0.0), radius(-1.0) {}
+
+      bool evaluated;                   /**< Whether the link was evaluated since the cache was cleared */
+      Eigen::Affine3d transform;        /**< The link transform at the last evaluation */
+      double lower_bound;               /**< A lower bound of the distance of the link at the last evaluation */
+      double motion_at_evaluation;      /**< The value of total_motion_ at the last evaluation */
+      Eigen::Affine3d last_transform;   /**< The link transform at the previous query */
+      double radius;                    /**< The radius of the link geometry about its frame, negative if not computed */
+    };
+
+    /**
+     * @brief Bounds the displacement of any point of a link between two transforms
+     * @param from    The first transform
+     * @param to      The second transform
+     * @param radius  The radius of the link geometry about its frame
+     * @return The bound
+     */
+    static double motionBound(const Eigen::Affine3d &from, const Eigen::Affine3d &to, double radius);
+
+    /** @brief Computes the radius of the padded and scaled link geometry and its attached bodies about the link frame */
+    static double linkRadius(const CollisionRobotIndustrial &robot, const robot_state::RobotState &state,
+                             const robot_model::LinkModel *link);
+
+    double margin_;                                                   /**< The evaluation margin */
+    double threshold_;                                                /**< The threshold of the cached request */
+    const std::set<const robot_model::LinkModel*> *active_links_;     /**< The active links of the cached request */
+    const robot_model::RobotModel *robot_model_;                      /**< The model the links belong to */
+    std::vector<LinkBound, Eigen::aligned_allocator<LinkBound> > links_; /**< The links indexed by link index */
+    bool has_last_transforms_;                                        /**< Whether last_transform holds the previous query */
+    double total_motion_;                                             /**< The sum over the queries of the largest link motion */
+    std::set<const robot_model::LinkModel*> evaluated_links_;         /**< The links evaluated by the current query */
+    std::vector<bool> evaluated_mask_;                                /**< The links evaluated by the current query by link index */
+    std::size_t num_evaluated_links_;                                 /**< The number of links evaluated by the last query */
+  };
+
+  typedef std::shared_ptr<TemporalDistanceCache> TemporalDistanceCachePtr;
+}
+
+#endif
@@ -0,0 +1,115 @@
+/**
+ * @file world_distance_field.h
+ * @brief This contains a signed distance field of the static objects in a collision world
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @license Software License Agreement (Apache License)\n
+ * \n
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at\n
+ * \n
+ * http://www.apache.org/licenses/LICENSE-2.0\n
+ * \n
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef COLLISION_DETECTION_WORLD_DISTANCE_FIELD_H_
+#define COLLISION_DETECTION_WORLD_DISTANCE_FIELD_H_
+
+#include <moveit/collision_detection/world.h>
+#include <moveit/distance_field/propagation_distance_field.h>
+#include <map>
+#include <memory>
+
+namespace collision_detection
+{
+
+  /**
+   * @brief A signed distance field over the objects of a collision world.  The objects are added and removed
+   * incrementally so that only the voxels affected by a change are propagated again.  The distance and its gradient are
+   * interpolated trilinearly in between the voxel centers.
+   */
+  class WorldDistanceField
+  {
+  public:
+
+    /** @brief The extent and resolution of the voxel grid */
+    struct Parameters
+    {
+      Parameters(): size_x(3.0), size_y(3.0), size_z(3.0),
+                    origin_x(-1.5), origin_y(-1.5), origin_z(-1.5),
+                    resolution(0.02), max_distance(0.4) {}
+
+      bool operator==(const Parameters &other) const
+      {
+        return size_x == other.size_x && size_y == other.size_y && size_z == other.size_z &&
+            origin_x == other.origin_x && origin_y == other.origin_y && origin_z == other.origin_z &&
+            resolution == other.resolution && max_distance == other.max_distance;
+      }
+
+      double size_x;        /**< The size of the grid along x in meters */
+      double size_y;        /**< The size of the grid along y in meters */
+      double size_z;        /**< The size of the grid along z in meters */
+      double origin_x;      /**< The x coordinate of the grid corner with the lowest coordinates in the world frame */
+      double origin_y;      /**< The y coordinate of the grid corner with the lowest coordinates in the world frame */
+      double origin_z;      /**< The z coordinate of the grid corner with the lowest coordinates in the world frame */
+      double resolution;    /**< The size of the voxels in meters */
+      double max_distance;  /**< The distance up to which the field is propagated, farther voxels hold this value */
+    };
+
+    explicit WorldDistanceField(const Parameters &params);
+
+    /** @brief The parameters the field was created with */
+    const Parameters& getParameters() const { return params_; }
+
+    /**
+     * @brief Adds the shapes of the object to the field, the shapes previously added for an object with the same id are
+     * removed first.
+     * @param obj The object, it is not modified by the world once added since the field keeps a reference to it.
+     */
+    void updateObject(const World::ObjectConstPtr &obj);
+
+    /**
+     * @brief Removes the shapes of the object from the field
+     * @param id The id of the object
+     */
+    void removeObject(const std::string &id);
+
+    /** @brief Removes all the objects from the field */
+    void clear();
+
+    /**
+     * @brief Computes the signed distance to the nearest object and its gradient at a point.  This method is thread
+     * safe as long as the field is not modified concurrently.
+     * @param point     The point in the world frame
+     * @param distance  The distance, negative inside the objects and max_distance when farther or outside of the grid
+     * @param gradient  The gradient of the distance, it points away from the nearest object
+     * @return False if the point is outside of the grid, in which case the gradient is zero
+     */
+    bool getDistanceGradient(const Eigen::Vector3d &point, double &distance, Eigen::Vector3d &gradient) const;
+
+    /** @brief The underlying voxel grid */
+    const distance_field::PropagationDistanceField& getField() const { return field_; }
+
+  protected:
+
+    Parameters params_;                                       /**< The grid parameters */
+    distance_field::PropagationDistanceField field_;          /**< The voxel grid */
+    std::map<std::string, World::ObjectConstPtr> objects_;    /**< The objects whose shapes are in the field */
+  };
+
+  typedef std::shared_ptr<WorldDistanceField> WorldDistanceFieldPtr;
+  typedef std::shared_ptr<const WorldDistanceField> WorldDistanceFieldConstPtr;
+}
+
+#endif
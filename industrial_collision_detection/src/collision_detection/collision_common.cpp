@@ -24,61 +24,328 @@
  * limitations under the License.
  */
 #include <industrial_collision_detection/collision_detection/collision_common.h>
+#include <industrial_collision_detection/collision_detection/mesh_lod.h>
+#include <industrial_collision_detection/collision_detection/query_thread_pool.h>
 #include <moveit/collision_detection_fcl/collision_common.h>
 #include <ros/ros.h>
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+
+namespace
+{
+
+/** @brief The interned collision object names of the process */
+struct ObjectNameTable
+{
+  std::mutex mutex;                                                   /**< Protects the table */
+  std::deque<collision_detection::InternedObjectName> names;          /**< The entries indexed by id, never moved */
+  std::unordered_map<std::string, const collision_detection::InternedObjectName*> ids; /**< The entries by name */
+};
+
+ObjectNameTable& getObjectNameTable()
+{
+  static ObjectNameTable table;
+  return table;
+}
+
+/** @brief The active link mask of a group, see collision_detection::getGroupActiveLinkMask() */
+struct GroupLinkMask
+{
+  std::weak_ptr<const robot_model::RobotModel> model;   /**< The robot model of the group */
+  std::vector<bool> mask;                                /**< The updated links with geometry of the group */
+};
+
+/** @brief The active link masks of the groups of the process */
+struct GroupLinkMaskTable
+{
+  std::mutex mutex;                                                       /**< Protects the table */
+  std::map<const robot_model::JointModelGroup*, GroupLinkMask> masks;    /**< The masks by group, never moved */
+};
+
+GroupLinkMaskTable& getGroupLinkMaskTable()
+{
+  static GroupLinkMaskTable table;
+  return table;
+}
+
+/** @brief Accumulates the bytes of a value into a FNV-1a hash */
+template<typename T>
+void hashValue(const T &value, std::uint64_t &hash)
+{
+  const unsigned char *bytes = reinterpret_cast<const unsigned char*>(&value);
+  for (std::size_t i = 0; i < sizeof(T); ++i)
+  {
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
+  }
+}
+
+}
 
 namespace collision_detection
 {
-  bool getDistanceInfo(const DistanceMap &distance_detailed, DistanceInfoMap &distance_info_map)
+  const InternedObjectName* internObjectName(const std::string &name)
   {
-    Eigen::Affine3d tf;
-    tf.setIdentity();
-    return getDistanceInfo(distance_detailed, distance_info_map, tf);
+    ObjectNameTable &table = getObjectNameTable();
+    std::lock_guard<std::mutex> lock(table.mutex);
+    std::unordered_map<std::string, const InternedObjectName*>::const_iterator it = table.ids.find(name);
+    if (it != table.ids.end())
+      return it->second;
+
+    InternedObjectName entry;
+    entry.id = static_cast<int>(table.names.size());
+    entry.name = name;
+    table.names.push_back(entry);
+    table.ids[name] = &table.names.back();
+    return &table.names.back();
+  }
+
+  const std::string& getObjectName(int id)
+  {
+    static const std::string UNKNOWN_NAME;
+    ObjectNameTable &table = getObjectNameTable();
+    std::lock_guard<std::mutex> lock(table.mutex);
+    if (id < 0 || id >= static_cast<int>(table.names.size()))
+      return UNKNOWN_NAME;
+
+    return table.names[id].name;
+  }
+
+  void setObjectName(fcl::CollisionObject &obj, const std::string &name)
+  {
+    obj.setUserData(const_cast<InternedObjectName*>(internObjectName(name)));
+  }
+
+  int getObjectId(const fcl::CollisionObject &obj)
+  {
+    const InternedObjectName *entry = static_cast<const InternedObjectName*>(obj.getUserData());
+    if (!entry)
+      entry = internObjectName(static_cast<const CollisionGeometryData*>(obj.collisionGeometry()->getUserData())->getID());
+
+    return entry->id;
   }
 
-  bool getDistanceInfo(const DistanceMap &distance_detailed, DistanceInfoMap &distance_info_map, const Eigen::Affine3d &tf)
+  int getObjectNameCount()
   {
-    bool status = true;
-    for (DistanceMap::const_iterator it = distance_detailed.begin(); it != distance_detailed.end(); ++it)
+    ObjectNameTable &table = getObjectNameTable();
+    std::lock_guard<std::mutex> lock(table.mutex);
+    return static_cast<int>(table.names.size());
+  }
+
+  AllowedCollisionBitMatrix::AllowedCollisionBitMatrix(const AllowedCollisionMatrix &acm): size_(getObjectNameCount())
+  {
+    const std::size_t num_words = (static_cast<std::size_t>(size_) * size_ + 63) / 64;
+    allowed_.assign(num_words, 0);
+
+    // the pairs of two names without any entry are never allowed, only those involving a name of the matrix are
+    // looked up
+    decided_.assign(num_words, ~std::uint64_t(0));
+    std::vector<std::string> entry_names;
+    acm.getAllEntryNames(entry_names);
+    std::set<std::string> names(entry_names.begin(), entry_names.end());
+
+    std::vector<int> entry_ids;
+    for (int id = 0; id < size_; ++id)
     {
-      DistanceInfo dist_info;
-      DistanceResultsData dist = static_cast<const DistanceResultsData>(it->second);
-      if (dist.link_name[0] == it->first)
+      AllowedCollision::Type type;
+      const std::string &name = getObjectName(id);
+      if (names.count(name) > 0 || acm.getDefaultEntry(name, type))
+        entry_ids.push_back(id);
+    }
+
+    for (int id1 : entry_ids)
+      for (int id2 = 0; id2 < size_; ++id2)
       {
-        dist_info.nearest_obsticle = dist.link_name[1];
-        dist_info.link_point = tf * dist.nearest_points[0];
-        dist_info.obsticle_point = tf * dist.nearest_points[1];
-        dist_info.avoidance_vector = dist_info.link_point - dist_info.obsticle_point;
-        dist_info.avoidance_vector.normalize();
-        dist_info.distance = dist.min_distance;
+        AllowedCollision::Type type;
+        if (acm.getAllowedCollision(getObjectName(id1), getObjectName(id2), type))
+          set(id1, id2, type != AllowedCollision::CONDITIONAL, type == AllowedCollision::ALWAYS);
       }
-      else if (dist.link_name[1] == it->first)
+  }
+
+  void AllowedCollisionBitMatrix::set(int id1, int id2, bool decided, bool allowed)
+  {
+    const std::size_t bits[2] = {static_cast<std::size_t>(id1) * size_ + id2, static_cast<std::size_t>(id2) * size_ + id1};
+    for (std::size_t bit : bits)
+    {
+      const std::uint64_t mask = std::uint64_t(1) << (bit & 63);
+      decided_[bit >> 6] = decided ? (decided_[bit >> 6] | mask) : (decided_[bit >> 6] & ~mask);
+      allowed_[bit >> 6] = allowed ? (allowed_[bit >> 6] | mask) : (allowed_[bit >> 6] & ~mask);
+    }
+  }
+
+  bool collisionBitMatrixCallback(fcl::CollisionObject* o1, fcl::CollisionObject* o2, void *data)
+  {
+    CollisionBitMatrixData *bdata = reinterpret_cast<CollisionBitMatrixData*>(data);
+    CollisionData *cdata = bdata->cdata;
+    bool allowed;
+    if (!cdata->acm_ || !bdata->acm_bits || !bdata->acm_bits->getAllowedCollision(getObjectId(*o1), getObjectId(*o2), allowed))
+      return collisionCallback(o1, o2, cdata);
+
+    if (allowed)
+      return cdata->done_;
+
+    // the matrix has no entry that applies to the pair, the callback checks it as if there was no matrix
+    const AllowedCollisionMatrix *acm = cdata->acm_;
+    cdata->acm_ = NULL;
+    bool done = collisionCallback(o1, o2, cdata);
+    cdata->acm_ = acm;
+    return done;
+  }
+
+  bool collisionBooleanCallback(fcl::CollisionObject* o1, fcl::CollisionObject* o2, void *data)
+  {
+    CollisionBitMatrixData *bdata = reinterpret_cast<CollisionBitMatrixData*>(data);
+    CollisionData *cdata = bdata->cdata;
+    if (cdata->done_)
+      return true;
+
+    const CollisionGeometryData *cd1 = static_cast<const CollisionGeometryData*>(o1->collisionGeometry()->getUserData());
+    const CollisionGeometryData *cd2 = static_cast<const CollisionGeometryData*>(o2->collisionGeometry()->getUserData());
+    if (cd1->type == BodyTypes::ROBOT_ATTACHED || cd2->type == BodyTypes::ROBOT_ATTACHED)
+      return collisionBitMatrixCallback(o1, o2, data);
+
+    bool allowed = false;
+    if (cdata->acm_ && (!bdata->acm_bits || !bdata->acm_bits->getAllowedCollision(getObjectId(*o1), getObjectId(*o2), allowed)))
+      return collisionBitMatrixCallback(o1, o2, data);
+
+    if (allowed || cd1->sameObject(*cd2))
+      return false;
+
+    // only the pairs involving a link of the group are checked, as in collisionCallback()
+    if (cdata->active_components_only_)
+    {
+      const robot_model::LinkModel *l1 = cd1->type == BodyTypes::ROBOT_LINK ? cd1->ptr.link : NULL;
+      const robot_model::LinkModel *l2 = cd2->type == BodyTypes::ROBOT_LINK ? cd2->ptr.link : NULL;
+      if ((!l1 || cdata->active_components_only_->find(l1) == cdata->active_components_only_->end()) &&
+          (!l2 || cdata->active_components_only_->find(l2) == cdata->active_components_only_->end()))
+        return false;
+    }
+
+    // the default request stops at the first contact and computes neither its point nor the penetration depth
+    fcl::CollisionRequest col_req;
+    fcl::CollisionResult col_res;
+    if (fcl::collide(o1, o2, col_req, col_res) > 0)
+    {
+      cdata->res_->collision = true;
+      cdata->done_ = true;
+    }
+    return cdata->done_;
+  }
+
+  std::uint64_t computeShapeSignature(const shapes::Shape &shape)
+  {
+    std::uint64_t hash = 14695981039346656037ull;
+    hashValue(static_cast<int>(shape.type), hash);
+    switch (shape.type)
+    {
+      case shapes::SPHERE:
+        hashValue(static_cast<const shapes::Sphere&>(shape).radius, hash);
+        break;
+      case shapes::BOX:
+        for (int k = 0; k < 3; ++k)
+          hashValue(static_cast<const shapes::Box&>(shape).size[k], hash);
+        break;
+      case shapes::CYLINDER:
+        hashValue(static_cast<const shapes::Cylinder&>(shape).radius, hash);
+        hashValue(static_cast<const shapes::Cylinder&>(shape).length, hash);
+        break;
+      case shapes::CONE:
+        hashValue(static_cast<const shapes::Cone&>(shape).radius, hash);
+        hashValue(static_cast<const shapes::Cone&>(shape).length, hash);
+        break;
+      case shapes::MESH:
       {
-        dist_info.nearest_obsticle = dist.link_name[0];
-        dist_info.link_point = tf * dist.nearest_points[1];
-        dist_info.obsticle_point = tf * dist.nearest_points[0];
-        dist_info.avoidance_vector = dist_info.link_point - dist_info.obsticle_point;
-        dist_info.avoidance_vector.normalize();
-        dist_info.distance = dist.min_distance;
+        const shapes::Mesh &mesh = static_cast<const shapes::Mesh&>(shape);
+        hashValue(mesh.vertex_count, hash);
+        hashValue(mesh.triangle_count, hash);
+        for (unsigned int i = 0; i < 3 * mesh.vertex_count; ++i)
+          hashValue(mesh.vertices[i], hash);
+        for (unsigned int i = 0; i < 3 * mesh.triangle_count; ++i)
+          hashValue(mesh.triangles[i], hash);
+        break;
       }
-      else
+      default:
+        break;
+    }
+    return hash;
+  }
+  bool getDistanceInfo(const DistanceVector &distance_detailed, DistanceInfoVector &distance_info)
+  {
+    Eigen::Affine3d tf;
+    tf.setIdentity();
+    return getDistanceInfo(distance_detailed, distance_info, tf);
+  }
+
+  bool getDistanceInfo(const DistanceVector &distance_detailed, DistanceInfoVector &distance_info, const Eigen::Affine3d &tf)
+  {
+    bool found = false;
+    distance_info.resize(distance_detailed.size());
+    for (std::size_t i = 0; i < distance_detailed.size(); ++i)
+    {
+      const DistanceResultsData &dist = distance_detailed[i];
+      DistanceInfo &dist_info = distance_info[i];
+      if (dist.min_distance == std::numeric_limits<double>::max())
       {
-        ROS_ERROR("getDistanceInfo was unable to find link after match!");
-        status &= false;
+        dist_info = DistanceInfo();
+        continue;
       }
 
-      distance_info_map.insert(std::make_pair(it->first, dist_info));
+      // the first entry of the pair always refers to the link the result is stored for
+      dist_info.nearest_obsticle = dist.link_id[1];
+      dist_info.link_point = tf * dist.nearest_points[0];
+      dist_info.obsticle_point = tf * dist.nearest_points[1];
+      dist_info.avoidance_vector = dist_info.link_point - dist_info.obsticle_point;
+      dist_info.avoidance_vector.normalize();
+      dist_info.distance = dist.min_distance;
+      found = true;
     }
 
-    return status;
+    return found;
+  }
+
+  void computeActiveLinkMask(const std::set<const robot_model::LinkModel*> &links, std::size_t num_links,
+                             std::vector<bool> &mask)
+  {
+    mask.assign(num_links, false);
+    for (std::set<const robot_model::LinkModel*>::const_iterator it = links.begin(); it != links.end(); ++it)
+      if (static_cast<std::size_t>((*it)->getLinkIndex()) < num_links)
+        mask[(*it)->getLinkIndex()] = true;
+  }
+
+  const std::vector<bool>* getGroupActiveLinkMask(const robot_model::RobotModelConstPtr &kmodel,
+                                                  const robot_model::JointModelGroup *group)
+  {
+    GroupLinkMaskTable &table = getGroupLinkMaskTable();
+    std::lock_guard<std::mutex> lock(table.mutex);
+
+    // a group of a destroyed model may share the address of this one, its mask is replaced
+    GroupLinkMask &entry = table.masks[group];
+    if (entry.model.lock() != kmodel)
+    {
+      entry.model = kmodel;
+      computeActiveLinkMask(group->getUpdatedLinkModelsWithGeometrySet(), kmodel->getLinkModelCount(), entry.mask);
+    }
+
+    return &entry.mask;
   }
 
   void DistanceRequest::enableGroup(const robot_model::RobotModelConstPtr &kmodel)
   {
     if (kmodel->hasJointModelGroup(group_name))
-      active_components_only = &kmodel->getJointModelGroup(group_name)->getUpdatedLinkModelsWithGeometrySet();
+    {
+      const robot_model::JointModelGroup *group = kmodel->getJointModelGroup(group_name);
+      setActiveComponents(&group->getUpdatedLinkModelsWithGeometrySet(), getGroupActiveLinkMask(kmodel, group));
+    }
     else
-      active_components_only = NULL;
+    {
+      setActiveComponents(NULL, NULL);
+    }
   }
 
   bool distanceDetailedCallback(fcl::CollisionObject* o1, fcl::CollisionObject* o2, void* data, double& min_dist)
@@ -93,31 +360,29 @@ namespace collision_detection
     if (cd1->sameObject(*cd2))
       return false;
 
+    const robot_model::LinkModel *l1 = cd1->type == BodyTypes::ROBOT_LINK ? cd1->ptr.link : (cd1->type == BodyTypes::ROBOT_ATTACHED ? cd1->ptr.ab->getAttachedLink() : NULL);
+    const robot_model::LinkModel *l2 = cd2->type == BodyTypes::ROBOT_LINK ? cd2->ptr.link : (cd2->type == BodyTypes::ROBOT_ATTACHED ? cd2->ptr.ab->getAttachedLink() : NULL);
+
     // If active components are specified
     if (cdata->req->active_components_only)
     {
-      const robot_model::LinkModel *l1 = cd1->type == BodyTypes::ROBOT_LINK ? cd1->ptr.link : (cd1->type == BodyTypes::ROBOT_ATTACHED ? cd1->ptr.ab->getAttachedLink() : NULL);
-      const robot_model::LinkModel *l2 = cd2->type == BodyTypes::ROBOT_LINK ? cd2->ptr.link : (cd2->type == BodyTypes::ROBOT_ATTACHED ? cd2->ptr.ab->getAttachedLink() : NULL);
+      active1 = cdata->req->isActive(l1);
+      active2 = cdata->req->isActive(l2);
 
       // If neither of the involved components is active
-      if ((!l1 || cdata->req->active_components_only->find(l1) == cdata->req->active_components_only->end()) &&
-          (!l2 || cdata->req->active_components_only->find(l2) == cdata->req->active_components_only->end()))
-      {
+      if (!active1 && !active2)
         return false;
-      }
-      else
-      {
-        if (!l1 || cdata->req->active_components_only->find(l1) == cdata->req->active_components_only->end())
-          active1 = false;
-
-        if (!l2 || cdata->req->active_components_only->find(l2) == cdata->req->active_components_only->end())
-          active2 = false;
-      }
     }
 
     // use the collision matrix (if any) to avoid certain distance checks
     bool always_allow_collision = false;
-    if (cdata->req->acm)
+    bool allowed;
+    if (cdata->req->acm && cdata->req->acm_bits &&
+        cdata->req->acm_bits->getAllowedCollision(getObjectId(*o1), getObjectId(*o2), allowed))
+    {
+      always_allow_collision = allowed;
+    }
+    else if (cdata->req->acm)
     {
       AllowedCollision::Type type;
 
@@ -174,57 +439,74 @@ namespace collision_detection
     fcl::DistanceResult fcl_result;
     DistanceResultsData dist_result;
     double dist_threshold = cdata->req->distance_threshold;
-    std::map<std::string, DistanceResultsData>::iterator it1, it2;
+    DistanceResultsData *entry1 = NULL, *entry2 = NULL;
 
     if (!cdata->req->global)
     {
-      it1 = cdata->res->distance.find(cd1->ptr.obj->id_);
-      it2 = cdata->res->distance.find(cd2->ptr.obj->id_);
+      // the results of the active links are stored by link index, world objects have no entry
+      DistanceVector &distance = cdata->res->distance;
+      if (active1 && l1 && static_cast<std::size_t>(l1->getLinkIndex()) < distance.size())
+        entry1 = &distance[l1->getLinkIndex()];
 
-      if (cdata->req->active_components_only)
-      {
-        if (active1 && active2)
-        {
-          if (it1 != cdata->res->distance.end() && it2 != cdata->res->distance.end())
-            dist_threshold = std::max(it1->second.min_distance, it2->second.min_distance);
-        }
-        else if (active1 && !active2)
-        {
-          if (it1 != cdata->res->distance.end())
-            dist_threshold = it1->second.min_distance;
-        }
-        else if (!active1 && active2)
-        {
-          if (it2 != cdata->res->distance.end())
-            dist_threshold = it2->second.min_distance;
-        }
-      }
-      else
-      {
-        if (it1 != cdata->res->distance.end() && it2 != cdata->res->distance.end())
-          dist_threshold = std::max(it1->second.min_distance, it2->second.min_distance);
-      }
+      if (active2 && l2 && static_cast<std::size_t>(l2->getLinkIndex()) < distance.size())
+        entry2 = &distance[l2->getLinkIndex()];
+
+      // only a distance closer than the current results of the links is of interest, the entries without a result
+      // hold max()
+      if (entry1 && entry2)
+        dist_threshold = std::min(dist_threshold, std::max(entry1->min_distance, entry2->min_distance));
+      else if (entry1)
+        dist_threshold = std::min(dist_threshold, entry1->min_distance);
+      else if (entry2)
+        dist_threshold = std::min(dist_threshold, entry2->min_distance);
     }
     else
     {
         dist_threshold = cdata->res->minimum_distance.min_distance;
     }
 
-    fcl_result.min_distance = dist_threshold;
-    double d = fcl::distance(o1, o2, fcl::DistanceRequest(cdata->req->detailed), fcl_result);
+    // the distance between the bounding boxes is a lower bound of the distance between the objects, therefore the
+    // narrowphase is skipped when it can not produce a distance below the threshold
+    if (o1->getAABB().distance(o2->getAABB()) >= dist_threshold)
+      return false;
 
-    // Check if either object is already in the map. If not add it or if present
-    // check to see if the new distance is closer. If closer remove the existing
-    // one and add the new distance information.
+    // far from contact the coarse meshes settle the query, see DistanceRequest::lod_margin
+    double d;
+    if (!cdata->lods || cdata->req->lod_margin == std::numeric_limits<double>::max() ||
+        !distanceCoarse(*o1, *o2, *cdata->lods, *cdata->req, dist_threshold, fcl_result, d))
+    {
+      fcl_result = fcl::DistanceResult();
+      fcl_result.min_distance = dist_threshold;
+      d = fcl::distance(o1, o2, fcl::DistanceRequest(cdata->req->detailed), fcl_result);
+    }
+
+    // Update the results of the links involved if the new distance is closer.
     if (d < dist_threshold)
     {
       dist_result.min_distance = fcl_result.min_distance;
       dist_result.nearest_points[0] = Eigen::Vector3d(fcl_result.nearest_points[0].data.vs);
       dist_result.nearest_points[1] = Eigen::Vector3d(fcl_result.nearest_points[1].data.vs);
-      dist_result.link_name[0] = cd1->ptr.obj->id_;
-      dist_result.link_name[1] = cd2->ptr.obj->id_;
+      dist_result.link_id[0] = getObjectId(*o1);
+      dist_result.link_id[1] = getObjectId(*o2);
+      dist_result.hasNearestPoints = cdata->req->detailed;
+
+      // the gradient of the distance with respect to the position of the first object, once in contact the nearest
+      // points coincide and the direction between the bounding box centers is used to escape instead
+      if (cdata->req->gradient)
+      {
+        if (d > 0 && cdata->req->detailed)
+          dist_result.gradient = dist_result.nearest_points[0] - dist_result.nearest_points[1];
+        else
+          dist_result.gradient = Eigen::Vector3d((o1->getAABB().center() - o2->getAABB().center()).data.vs);
 
-      cdata->res->minimum_distance.update(dist_result);
+        double norm = dist_result.gradient.norm();
+        dist_result.hasGradient = norm > 0.0;
+        if (dist_result.hasGradient)
+          dist_result.gradient /= norm;
+      }
+
+      if (dist_result.min_distance < cdata->res->minimum_distance.min_distance)
+        cdata->res->minimum_distance.update(dist_result);
 
       if (!cdata->req->global)
       {
@@ -233,28 +515,17 @@ namespace collision_detection
           cdata->res->collision = true;
         }
 
-        if (active1)
+        if (entry1 && dist_result.min_distance < entry1->min_distance)
         {
-          if (it1 == cdata->res->distance.end())
-          {
-            cdata->res->distance.insert(std::make_pair(cd1->ptr.obj->id_, dist_result));
-          }
-          else
-          {
-            it1->second.update(dist_result);
-          }
+          entry1->update(dist_result);
         }
 
-        if (active2)
+        if (entry2 && dist_result.min_distance < entry2->min_distance)
         {
-          if (it2 == cdata->res->distance.end())
-          {
-            cdata->res->distance.insert(std::make_pair(cd2->ptr.obj->id_, dist_result));
-          }
-          else
-          {
-            it2->second.update(dist_result);
-          }
+          entry2->update(dist_result);
+          std::swap(entry2->nearest_points[0], entry2->nearest_points[1]);
+          std::swap(entry2->link_id[0], entry2->link_id[1]);
+          entry2->gradient = -entry2->gradient;
         }
       }
       else
@@ -269,4 +540,43 @@ namespace collision_detection
 
     return cdata->done;
   }
+
+  bool forEachTrajectoryState(const robot_state::RobotState &reference_state, const std::string &group_name,
+                              const Eigen::MatrixXd &trajectory, int num_threads, const TrajectoryStateCheck &check)
+  {
+    const robot_model::JointModelGroup *group = reference_state.getRobotModel()->getJointModelGroup(group_name);
+    if (!group)
+    {
+      ROS_ERROR("forEachTrajectoryState could not find the group '%s'", group_name.c_str());
+      return false;
+    }
+
+    if (trajectory.rows() != group->getVariableCount())
+    {
+      ROS_ERROR("forEachTrajectoryState received a trajectory with %i rows for group '%s' which has %i variables",
+                static_cast<int>(trajectory.rows()), group_name.c_str(), static_cast<int>(group->getVariableCount()));
+      return false;
+    }
+
+    const int num_timesteps = trajectory.cols();
+    num_threads = std::max(1, std::min(num_threads, num_timesteps));
+
+    // the workers of the shared pool keep their thread_local broadphase caches from one trajectory to the next, each
+    // one claims the next unchecked state until none is left
+    std::atomic<int> next_timestep(0);
+    QueryThreadPool::instance().run(num_threads, [&](std::size_t worker)
+    {
+      robot_state::RobotState state(reference_state);
+      Eigen::VectorXd joint_values;
+      for (int t = next_timestep++; t < num_timesteps; t = next_timestep++)
+      {
+        joint_values = trajectory.col(t);
+        state.setJointGroupPositions(group, joint_values);
+        state.updateCollisionBodyTransforms();
+        check(state, t);
+      }
+    });
+
+    return true;
+  }
 }
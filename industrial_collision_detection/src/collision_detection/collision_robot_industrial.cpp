@@ -35,6 +35,53 @@
 /* Author: Ioan Sucan */
 
 #include <industrial_collision_detection/collision_detection/collision_robot_industrial.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace
+{
+
+/** @brief The source of unique broadphase identifiers, a new one is taken whenever the link geometries change */
+std::atomic<std::uint64_t> NEXT_BROADPHASE_ID(1);
+
+/** @brief The number of robots whose self collision broadphase is kept by each thread */
+const std::size_t MAX_THREAD_BROADPHASES = 4;
+
+/** @brief A self collision broadphase kept by a thread between queries */
+struct ThreadBroadPhase
+{
+  std::uint64_t id = 0;                                     /**< The broadphase_id_ of the robot it was built for */
+  collision_detection::FCLManager manager;                  /**< The broadphase and its collision objects */
+  std::vector<std::size_t> link_geometries;                 /**< The geometry index of each of the first link objects */
+  std::vector<const robot_state::AttachedBody*> attached_bodies;  /**< The attached bodies it was built with */
+  std::vector<shapes::ShapeConstPtr> attached_shapes;       /**< Keeps the attached shapes alive so that they identify the bodies */
+};
+
+/** @brief The broadphases of the calling thread, the most recently used first */
+thread_local std::vector<std::unique_ptr<ThreadBroadPhase> > THREAD_BROADPHASES;
+
+/**
+ * @brief Whether the attached bodies match those the broadphase was built with
+ * @param bp      The broadphase
+ * @param bodies  The attached bodies of the state
+ * @return True if they are the same bodies with the same shapes
+ */
+bool sameAttachedBodies(const ThreadBroadPhase &bp, const std::vector<const robot_state::AttachedBody*> &bodies)
+{
+  if (bp.attached_bodies != bodies)
+    return false;
+
+  std::size_t s = 0;
+  for (std::size_t j = 0 ; j < bodies.size() ; ++j)
+    for (const shapes::ShapeConstPtr &shape : bodies[j]->getShapes())
+      if (s >= bp.attached_shapes.size() || bp.attached_shapes[s++] != shape)
+        return false;
+
+  return s == bp.attached_shapes.size();
+}
+
+}
 
 collision_detection::CollisionRobotIndustrial::CollisionRobotIndustrial(const robot_model::RobotModelConstPtr &model, double padding, double scale)
   : CollisionRobot(model, padding, scale)
@@ -43,6 +90,7 @@ collision_detection::CollisionRobotIndustrial::CollisionRobotIndustrial(const ro
   std::size_t index;
   geoms_.resize(robot_model_->getLinkGeometryCount());
   fcl_objs_.resize(robot_model_->getLinkGeometryCount());
+  std::shared_ptr<MeshLODMap> lods(new MeshLODMap());
   // we keep the same order of objects as what RobotState *::getLinkState() returns
   for (std::size_t i = 0 ; i < links.size() ; ++i)
     for (std::size_t j = 0 ; j < links[i]->getShapes().size() ; ++j)
@@ -57,17 +105,31 @@ collision_detection::CollisionRobotIndustrial::CollisionRobotIndustrial(const ro
         // Every time this object is created, g->computeLocalAABB() is called  which is
         // very expensive and should only be calculated once. To update the AABB, use the
         // collObj->setTsetTransform and then call collObj->computeAABB() to tranform the AABB.
-        fcl_objs_[index] = FCLCollisionObjectConstPtr(new fcl::CollisionObject(g->collision_geometry_));
+        fcl::CollisionObject *collObj = new fcl::CollisionObject(g->collision_geometry_);
+        setObjectName(*collObj, links[i]->getName());
+        fcl_objs_[index] = FCLCollisionObjectConstPtr(collObj);
+
+        MeshLOD lod;
+        if (getMeshLOD(links[i]->getShapes()[j], getLinkScale(links[i]->getName()), getLinkPadding(links[i]->getName()), g->collision_geometry_, lod))
+          (*lods)[g->collision_geometry_.get()] = lod;
       }
       else
         logError("Unable to construct collision geometry for link '%s'", links[i]->getName().c_str());
     }
+
+  mesh_lods_ = lods;
+  broadphase_id_ = NEXT_BROADPHASE_ID++;
 }
 
 collision_detection::CollisionRobotIndustrial::CollisionRobotIndustrial(const CollisionRobotIndustrial &other) : CollisionRobot(other)
 {
   geoms_ = other.geoms_;
   fcl_objs_ = other.fcl_objs_;
+  mesh_lods_ = other.mesh_lods_;
+
+  // the copy shares the geometries, the thread local broadphases built for the other robot are reused until the
+  // padding or scaling of either robot changes
+  broadphase_id_ = other.broadphase_id_;
 }
 
 void collision_detection::CollisionRobotIndustrial::getAttachedBodyObjects(const robot_state::AttachedBody *ab, std::vector<FCLGeometryConstPtr> &geoms) const
@@ -108,7 +170,9 @@ void collision_detection::CollisionRobotIndustrial::constructFCLObject(const rob
       if (objs[k]->collision_geometry_)
       {
         transform2fcl(ab_t[k], tf);
-        fcl_obj.collision_objects_.push_back(FCLCollisionObjectPtr(new fcl::CollisionObject(objs[k]->collision_geometry_, tf)));
+        fcl::CollisionObject *collObj = new fcl::CollisionObject(objs[k]->collision_geometry_, tf);
+        setObjectName(*collObj, ab[j]->getName());
+        fcl_obj.collision_objects_.push_back(FCLCollisionObjectPtr(collObj));
         // we copy the shared ptr to the CollisionGeometryData, as this is not stored by the class itself,
         // and would be destroyed when objs goes out of scope.
         fcl_obj.collision_geometry_.push_back(objs[k]);
@@ -126,6 +190,71 @@ void collision_detection::CollisionRobotIndustrial::allocSelfCollisionBroadPhase
   // manager.manager_->update();
 }
 
+collision_detection::FCLManager& collision_detection::CollisionRobotIndustrial::getSelfCollisionBroadPhase(const robot_state::RobotState &state, bool update_tree) const
+{
+  // looking up the broadphase of this robot among those kept by the calling thread
+  std::vector<std::unique_ptr<ThreadBroadPhase> > &broadphases = THREAD_BROADPHASES;
+  auto it = std::find_if(broadphases.begin(), broadphases.end(),
+                         [this](const std::unique_ptr<ThreadBroadPhase> &bp) { return bp->id == broadphase_id_; });
+  if (it == broadphases.end())
+  {
+    if (broadphases.size() < MAX_THREAD_BROADPHASES)
+      broadphases.emplace_back(new ThreadBroadPhase());
+    it = broadphases.end() - 1; // the least recently used one is replaced
+    (*it)->id = 0;
+  }
+  std::rotate(broadphases.begin(), it, it + 1);
+  ThreadBroadPhase &bp = *broadphases.front();
+
+  std::vector<const robot_state::AttachedBody*> ab;
+  state.getAttachedBodies(ab);
+  if (bp.id != broadphase_id_ || !bp.manager.manager_ || !sameAttachedBodies(bp, ab))
+  {
+    // the previous manager refers to the objects, it is released first
+    bp.manager.manager_.reset();
+    bp.manager.object_.clear();
+    allocSelfCollisionBroadPhase(state, bp.manager);
+    bp.id = broadphase_id_;
+
+    bp.link_geometries.clear();
+    for (std::size_t i = 0 ; i < geoms_.size() ; ++i)
+      if (geoms_[i] && geoms_[i]->collision_geometry_)
+        bp.link_geometries.push_back(i);
+
+    bp.attached_bodies = ab;
+    bp.attached_shapes.clear();
+    for (std::size_t j = 0 ; j < ab.size() ; ++j)
+      bp.attached_shapes.insert(bp.attached_shapes.end(), ab[j]->getShapes().begin(), ab[j]->getShapes().end());
+
+    return bp.manager;
+  }
+
+  // moving the existing objects to the new state
+  std::vector<FCLCollisionObjectPtr> &objects = bp.manager.object_.collision_objects_;
+  fcl::Transform3f tf;
+  std::size_t k = 0;
+  for (; k < bp.link_geometries.size() ; ++k)
+  {
+    const CollisionGeometryData &data = *geoms_[bp.link_geometries[k]]->collision_geometry_data_;
+    transform2fcl(state.getCollisionBodyTransform(data.ptr.link, data.shape_index), tf);
+    objects[k]->setTransform(tf);
+    objects[k]->computeAABB();
+  }
+
+  const std::vector<FCLGeometryConstPtr> &attached_geoms = bp.manager.object_.collision_geometry_;
+  for (std::size_t a = 0 ; a < attached_geoms.size() && k < objects.size() ; ++a, ++k)
+  {
+    const CollisionGeometryData &data = *attached_geoms[a]->collision_geometry_data_;
+    transform2fcl(data.ptr.ab->getGlobalCollisionBodyTransforms()[data.shape_index], tf);
+    objects[k]->setTransform(tf);
+    objects[k]->computeAABB();
+  }
+
+  if (update_tree)
+    bp.manager.manager_->update();
+  return bp.manager;
+}
+
 void collision_detection::CollisionRobotIndustrial::checkSelfCollision(const CollisionRequest &req, CollisionResult &res, const robot_state::RobotState &state) const
 {
   checkSelfCollisionHelper(req, res, state, NULL);
@@ -150,8 +279,7 @@ void collision_detection::CollisionRobotIndustrial::checkSelfCollision(const Col
 void collision_detection::CollisionRobotIndustrial::checkSelfCollisionHelper(const CollisionRequest &req, CollisionResult &res, const robot_state::RobotState &state,
                                                                              const AllowedCollisionMatrix *acm) const
 {
-  FCLManager manager;
-  allocSelfCollisionBroadPhase(state, manager);
+  FCLManager &manager = getSelfCollisionBroadPhase(state);
   CollisionData cd(&req, &res, acm);
   cd.enableGroup(getRobotModel());
   manager.manager_->collide(&cd, &collisionCallback);
@@ -166,6 +294,23 @@ void collision_detection::CollisionRobotIndustrial::checkSelfCollisionHelper(con
   }
 }
 
+bool collision_detection::CollisionRobotIndustrial::isSelfColliding(const robot_state::RobotState &state, const std::string &group_name,
+                                                                    const AllowedCollisionMatrix *acm,
+                                                                    const AllowedCollisionBitMatrix *acm_bits) const
+{
+  CollisionRequest req;
+  req.group_name = group_name;
+  req.contacts = false;
+  CollisionResult res;
+
+  FCLManager &manager = getSelfCollisionBroadPhase(state);
+  CollisionData cd(&req, &res, acm);
+  cd.enableGroup(getRobotModel());
+  CollisionBitMatrixData bd(&cd, acm_bits);
+  manager.manager_->collide(&bd, &collisionBooleanCallback);
+  return res.collision;
+}
+
 void collision_detection::CollisionRobotIndustrial::checkOtherCollision(const CollisionRequest &req, CollisionResult &res, const robot_state::RobotState &state,
                                                                  const CollisionRobot &other_robot, const robot_state::RobotState &other_state) const
 {
@@ -196,8 +341,7 @@ void collision_detection::CollisionRobotIndustrial::checkOtherCollisionHelper(co
                                                                        const CollisionRobot &other_robot, const robot_state::RobotState &other_state,
                                                                        const AllowedCollisionMatrix *acm) const
 {
-  FCLManager manager;
-  allocSelfCollisionBroadPhase(state, manager);
+  FCLManager &manager = getSelfCollisionBroadPhase(state);
 
   const CollisionRobotIndustrial &fcl_rob = dynamic_cast<const CollisionRobotIndustrial&>(other_robot);
   FCLObject other_fcl_obj;
@@ -214,6 +358,7 @@ void collision_detection::CollisionRobotIndustrial::checkOtherCollisionHelper(co
 void collision_detection::CollisionRobotIndustrial::updatedPaddingOrScaling(const std::vector<std::string> &links)
 {
   std::size_t index;
+  std::shared_ptr<MeshLODMap> lods(new MeshLODMap(*mesh_lods_));
   for (std::size_t i = 0 ; i < links.size() ; ++i)
   {
     const robot_model::LinkModel *lmodel = robot_model_->getLinkModel(links[i]);
@@ -225,14 +370,49 @@ void collision_detection::CollisionRobotIndustrial::updatedPaddingOrScaling(cons
         if (g)
         {
           index = lmodel->getFirstCollisionBodyTransformIndex() + j;
+          if (geoms_[index])
+            lods->erase(geoms_[index]->collision_geometry_.get());
+
           geoms_[index] = g;
-          fcl_objs_[index] = FCLCollisionObjectConstPtr(new fcl::CollisionObject(g->collision_geometry_));
+          fcl::CollisionObject *collObj = new fcl::CollisionObject(g->collision_geometry_);
+          setObjectName(*collObj, lmodel->getName());
+          fcl_objs_[index] = FCLCollisionObjectConstPtr(collObj);
+
+          MeshLOD lod;
+          if (getMeshLOD(lmodel->getShapes()[j], getLinkScale(lmodel->getName()), getLinkPadding(lmodel->getName()), g->collision_geometry_, lod))
+            (*lods)[g->collision_geometry_.get()] = lod;
         }
       }
     }
     else
       logError("Updating padding or scaling for unknown link: '%s'", links[i].c_str());
   }
+
+  // the copies sharing the previous levels of detail keep them
+  mesh_lods_ = lods;
+
+  // the broadphases built with the previous geometries are no longer used
+  broadphase_id_ = NEXT_BROADPHASE_ID++;
+}
+
+bool collision_detection::CollisionRobotIndustrial::checkSelfTrajectoryCollision(const CollisionRequest &req, TrajectoryCollisionResult &res,
+                                                                               const robot_state::RobotState &reference_state, const Eigen::MatrixXd &trajectory,
+                                                                               const AllowedCollisionMatrix *acm, int num_threads) const
+{
+  // the distance is computed separately, the detailed distance query of the collision helper is not needed
+  CollisionRequest collision_req = req;
+  collision_req.distance = false;
+
+  res.clear(trajectory.cols());
+  return forEachTrajectoryState(reference_state, req.group_name, trajectory, num_threads,
+                                [&](const robot_state::RobotState &state, int t)
+  {
+    CollisionResult collision_res;
+    checkSelfCollisionHelper(collision_req, collision_res, state, acm);
+    res.collisions(t) = collision_res.collision;
+    if (req.distance)
+      res.distances(t) = distanceSelfHelper(state, acm);
+  });
 }
 
 double collision_detection::CollisionRobotIndustrial::distanceSelf(const robot_state::RobotState &state) const
@@ -249,8 +429,7 @@ double collision_detection::CollisionRobotIndustrial::distanceSelf(const robot_s
 double collision_detection::CollisionRobotIndustrial::distanceSelfHelper(const robot_state::RobotState &state,
                                                                   const AllowedCollisionMatrix *acm) const
 {
-  FCLManager manager;
-  allocSelfCollisionBroadPhase(state, manager);
+  FCLManager &manager = getSelfCollisionBroadPhase(state);
 
   CollisionRequest req;
   CollisionResult res;
@@ -282,8 +461,7 @@ double collision_detection::CollisionRobotIndustrial::distanceOtherHelper(const
                                                                    const robot_state::RobotState &other_state,
                                                                    const AllowedCollisionMatrix *acm) const
 {
-  FCLManager manager;
-  allocSelfCollisionBroadPhase(state, manager);
+  FCLManager &manager = getSelfCollisionBroadPhase(state);
 
   const CollisionRobotIndustrial& fcl_rob = dynamic_cast<const CollisionRobotIndustrial&>(other_robot);
   FCLObject other_fcl_obj;
@@ -307,9 +485,10 @@ void collision_detection::CollisionRobotIndustrial::distanceSelf(const DistanceR
 
 void collision_detection::CollisionRobotIndustrial::distanceSelfHelper(const DistanceRequest &req, DistanceResult &res, const robot_state::RobotState &state) const
 {
-  FCLManager manager;
-  allocSelfCollisionBroadPhase(state, manager);
+  FCLManager &manager = getSelfCollisionBroadPhase(state);
+  res.resize(state.getRobotModel()->getLinkModelCount());
   DistanceData drd(&req, &res);
+  drd.lods = mesh_lods_.get();
 
   manager.manager_->distance(&drd, &distanceDetailedCallback);
 }
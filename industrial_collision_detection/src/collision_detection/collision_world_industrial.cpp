@@ -35,14 +35,292 @@
 /* Author: Ioan Sucan */
 
 #include <industrial_collision_detection/collision_detection/collision_world_industrial.h>
+#include <industrial_collision_detection/collision_detection/mesh_geometry_cache.h>
+#include <industrial_collision_detection/collision_detection/primitive_distance.h>
+#include <industrial_collision_detection/collision_detection/query_thread_pool.h>
+#include <industrial_collision_detection/collision_detection/robot_sphere_model.h>
 #include <boost/bind.hpp>
 #include <fcl/shape/geometric_shape_to_BVH_model.h>
 #include <fcl/traversal/traversal_node_bvhs.h>
 #include <fcl/traversal/traversal_node_setup.h>
 #include <fcl/collision_node.h>
+#include <fcl/continuous_collision.h>
+#include <fcl/octree.h>
+#include <fcl/shape/geometric_shapes.h>
+#include <octomap/octomap.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iterator>
+#include <limits>
+#include <mutex>
+
+namespace
+{
+
+const std::size_t CCD_MAX_ITERATIONS = 10;    /**< The maximum number of conservative advancement iterations */
+const double CCD_TIME_OF_CONTACT_ERROR = 1e-4; /**< The tolerance of the time of contact */
+const std::size_t CCD_MAX_CONTACTS = 16;      /**< The contacts handed to the decision function of a conditional entry */
+const std::size_t MAX_RETIRED_GEOMETRIES = 32; /**< The number of removed mesh geometries kept for reuse */
+
+/**
+ * @brief Merges the voxels of an octree into a coarser octree.  A coarse voxel is occupied when any voxel it covers is,
+ * the nodes of the tree at the coarse depth already hold the maximum occupancy of their children.
+ * @param tree                The octree
+ * @param resolution          The requested voxel size, it is rounded down to a power of two multiple of the octree resolution
+ * @param occupancy_threshold The occupancy above which a voxel is occupied
+ * @return The coarse octree holding only the occupied voxels, pruned, or the octree itself if it is not coarser
+ */
+boost::shared_ptr<const octomap::OcTree> coarsenOcTree(const boost::shared_ptr<const octomap::OcTree> &tree, double resolution,
+                                                       double occupancy_threshold)
+{
+  unsigned int levels = 0;
+  while (levels + 1 < tree->getTreeDepth() && tree->getResolution() * (1u << (levels + 1)) <= resolution * (1.0 + 1e-6))
+    ++levels;
+
+  if (levels == 0)
+    return tree;
+
+  const double coarse_resolution = tree->getResolution() * (1u << levels);
+  boost::shared_ptr<octomap::OcTree> coarse(new octomap::OcTree(coarse_resolution));
+  const float occupied = coarse->getClampingThresMaxLog();
+  for (octomap::OcTree::leaf_iterator it = tree->begin_leafs(tree->getTreeDepth() - levels), end = tree->end_leafs(); it != end; ++it)
+  {
+    if (it->getOccupancy() <= occupancy_threshold)
+      continue;
+
+    // a leaf pruned above the coarse depth covers several coarse voxels
+    const double size = it.getSize();
+    const int n = std::max(1, static_cast<int>(std::floor(size / coarse_resolution + 0.5)));
+    const octomap::point3d corner = it.getCoordinate() - octomap::point3d(size / 2, size / 2, size / 2);
+    for (int i = 0; i < n; ++i)
+      for (int j = 0; j < n; ++j)
+        for (int k = 0; k < n; ++k)
+          coarse->setNodeValue(corner + octomap::point3d((i + 0.5) * coarse_resolution, (j + 0.5) * coarse_resolution,
+                                                         (k + 0.5) * coarse_resolution), occupied, true);
+  }
+  coarse->updateInnerOccupancy();
+  coarse->prune();
+
+  return coarse;
+}
+
+/**
+ * @brief Whether the robot object belongs to the links enabled in the collision data
+ * @param cd    The collision data
+ * @param data  The geometry data of the robot object
+ * @return True if the object is checked
+ */
+bool isActiveRobotObject(const collision_detection::CollisionData &cd, const collision_detection::CollisionGeometryData &data)
+{
+  if (!cd.active_components_only_)
+    return true;
+
+  if (data.type == collision_detection::BodyTypes::ROBOT_LINK)
+    return cd.active_components_only_->count(data.ptr.link) > 0;
+
+  if (data.type == collision_detection::BodyTypes::ROBOT_ATTACHED)
+    return cd.active_components_only_->count(data.ptr.ab->getAttachedLink()) > 0;
+
+  return true;
+}
+
+/** @brief The world objects whose bounding box overlaps the query object, see collectOverlapsCallback() */
+struct OverlapData
+{
+  const fcl::CollisionObject *query;
+  std::vector<const fcl::CollisionObject*> objects;
+};
+
+/**
+ * @brief Broadphase callback which only collects the objects of the manager overlapping the query, the narrowphase is
+ * left to the caller
+ * @return False so that every overlap is reported
+ */
+bool collectOverlapsCallback(fcl::CollisionObject *o1, fcl::CollisionObject *o2, void *data)
+{
+  OverlapData *overlaps = static_cast<OverlapData*>(data);
+  overlaps->objects.push_back(o1 == overlaps->query ? o2 : o1);
+  return false;
+}
+
+/**
+ * @brief Asks the decision function of a conditional entry of the allowed collision matrix about the contacts of a
+ * robot object and a world object at the time of contact found by the continuous check.  The objects are only within
+ * the time of contact tolerance of each other at that time, when the discrete check reports no contact the nearest
+ * points stand in for it.
+ * @param robot_obj   The robot object
+ * @param robot_tf    The pose of the robot object at the time of contact
+ * @param world_obj   The world object
+ * @param world_tf    The pose of the world object at the time of contact
+ * @param dcf         The decision function of the entry
+ * @return True if every contact is allowed
+ */
+bool isContactAllowed(const fcl::CollisionObject &robot_obj, const fcl::Transform3f &robot_tf,
+                      const fcl::CollisionObject &world_obj, const fcl::Transform3f &world_tf,
+                      const collision_detection::DecideContactFn &dcf)
+{
+  const collision_detection::CollisionGeometryData *robot_data = static_cast<const collision_detection::CollisionGeometryData*>(robot_obj.collisionGeometry()->getUserData());
+  const collision_detection::CollisionGeometryData *world_data = static_cast<const collision_detection::CollisionGeometryData*>(world_obj.collisionGeometry()->getUserData());
+
+  collision_detection::Contact c;
+  c.body_name_1 = robot_data->getID();
+  c.body_type_1 = robot_data->type;
+  c.body_name_2 = world_data->getID();
+  c.body_type_2 = world_data->type;
+
+  fcl::CollisionResult fcl_res;
+  fcl::collide(robot_obj.collisionGeometry().get(), robot_tf, world_obj.collisionGeometry().get(), world_tf,
+               fcl::CollisionRequest(CCD_MAX_CONTACTS, true), fcl_res);
+  for (std::size_t k = 0 ; k < fcl_res.numContacts() ; ++k)
+  {
+    const fcl::Contact &fcl_contact = fcl_res.getContact(k);
+    c.pos = Eigen::Vector3d(fcl_contact.pos.data.vs);
+    c.normal = Eigen::Vector3d(fcl_contact.normal.data.vs);
+    c.depth = fcl_contact.penetration_depth;
+    if (!dcf(c))
+      return false;
+  }
+
+  if (fcl_res.numContacts() > 0)
+    return true;
+
+  fcl::DistanceResult dist_res;
+  fcl::distance(robot_obj.collisionGeometry().get(), robot_tf, world_obj.collisionGeometry().get(), world_tf,
+                fcl::DistanceRequest(true), dist_res);
+  const Eigen::Vector3d p1(dist_res.nearest_points[0].data.vs), p2(dist_res.nearest_points[1].data.vs);
+  c.pos = 0.5 * (p1 + p2);
+  c.normal = p2 - p1;
+  if (c.normal.norm() > 0.0)
+    c.normal.normalize();
+  c.depth = 0.0;
+  return dcf(c);
+}
+
+typedef std::vector<collision_detection::CollisionPrimitive, Eigen::aligned_allocator<collision_detection::CollisionPrimitive> > CollisionPrimitives;
+
+/**
+ * @brief Describes the world objects as primitives, the spheres, boxes, cylinders and capsules as themselves and the
+ * other geometries by their axis aligned bounding box
+ * @param objects     The fcl objects of the world
+ * @param primitives  Returns the primitives
+ * @return False if an object is unbounded, such as a plane, otherwise true.
+ */
+bool getWorldPrimitives(const std::map<std::string, collision_detection::FCLObject> &objects, CollisionPrimitives &primitives)
+{
+  primitives.clear();
+  for (std::map<std::string, collision_detection::FCLObject>::const_iterator it = objects.begin() ; it != objects.end() ; ++it)
+    for (std::size_t i = 0 ; i < it->second.collision_objects_.size() ; ++i)
+    {
+      const fcl::CollisionObject &co = *it->second.collision_objects_[i];
+      const fcl::Matrix3f &r = co.getTransform().getRotation();
+      const fcl::Vec3f &t = co.getTransform().getTranslation();
+      collision_detection::CollisionPrimitive primitive;
+      primitive.pose.linear() << r(0, 0), r(0, 1), r(0, 2),
+                                 r(1, 0), r(1, 1), r(1, 2),
+                                 r(2, 0), r(2, 1), r(2, 2);
+      primitive.pose.translation() << t[0], t[1], t[2];
+
+      switch (co.getNodeType())
+      {
+        case fcl::GEOM_SPHERE:
+          primitive.type = collision_detection::CollisionPrimitive::SPHERE;
+          primitive.radius = static_cast<const fcl::Sphere&>(*co.collisionGeometry()).radius;
+          break;
+        case fcl::GEOM_BOX:
+        {
+          const fcl::Vec3f &side = static_cast<const fcl::Box&>(*co.collisionGeometry()).side;
+          primitive.type = collision_detection::CollisionPrimitive::BOX;
+          primitive.half_extents << 0.5 * side[0], 0.5 * side[1], 0.5 * side[2];
+          break;
+        }
+        case fcl::GEOM_CYLINDER:
+        {
+          const fcl::Cylinder &cylinder = static_cast<const fcl::Cylinder&>(*co.collisionGeometry());
+          primitive.type = collision_detection::CollisionPrimitive::CYLINDER;
+          primitive.radius = cylinder.radius;
+          primitive.half_length = 0.5 * cylinder.lz;
+          break;
+        }
+        case fcl::GEOM_CAPSULE:
+        {
+          const fcl::Capsule &capsule = static_cast<const fcl::Capsule&>(*co.collisionGeometry());
+          primitive.type = collision_detection::CollisionPrimitive::CAPSULE;
+          primitive.radius = capsule.radius;
+          primitive.half_length = 0.5 * capsule.lz;
+          break;
+        }
+        default:
+        {
+          const fcl::AABB &aabb = co.getAABB();
+          for (int k = 0 ; k < 3 ; ++k)
+            if (!std::isfinite(aabb.min_[k]) || !std::isfinite(aabb.max_[k]))
+              return false;
+
+          fcl::Vec3f center = aabb.center();
+          primitive.type = collision_detection::CollisionPrimitive::BOX;
+          primitive.pose.setIdentity();
+          primitive.pose.translation() << center[0], center[1], center[2];
+          primitive.half_extents << 0.5 * aabb.width(), 0.5 * aabb.height(), 0.5 * aabb.depth();
+        }
+      }
+      primitives.push_back(primitive);
+    }
+
+  return true;
+}
+
+/**
+ * @brief Computes a lower bound of the distance between a link object and the world primitives from the spheres
+ * covering the link shape
+ * @param co          The robot object, at its current pose
+ * @param robot       The robot the object belongs to
+ * @param model       The sphere model of the robot
+ * @param primitives  The world primitives
+ * @param bound       Returns the lower bound
+ * @return False if the object is not a link covered by spheres, otherwise true.
+ */
+bool computeSphereLowerBound(const fcl::CollisionObject &co, const collision_detection::CollisionRobot &robot,
+                             const collision_detection::RobotSphereModel &model, const CollisionPrimitives &primitives,
+                             double &bound)
+{
+  const collision_detection::CollisionGeometryData *data = static_cast<const collision_detection::CollisionGeometryData*>(co.collisionGeometry()->getUserData());
+  if (!data || data->type != collision_detection::BodyTypes::ROBOT_LINK)
+    return false;
+
+  // the spheres cover the unscaled shape, the padding is added to their radius
+  const robot_model::LinkModel *link = data->ptr.link;
+  if (robot.getLinkScale(link->getName()) != 1.0)
+    return false;
+
+  const collision_detection::CollisionSpheres &spheres = model.getSpheres(link, data->shape_index);
+  if (spheres.empty())
+    return false;
+
+  static thread_local collision_detection::SphereBatch batch;
+  static thread_local std::vector<double> distances;
+  const double padding = robot.getLinkPadding(link->getName());
+  batch.clear();
+  for (std::size_t i = 0 ; i < spheres.size() ; ++i)
+  {
+    fcl::Vec3f c = co.getTransform().transform(fcl::Vec3f(spheres[i].center.x(), spheres[i].center.y(), spheres[i].center.z()));
+    batch.add(Eigen::Vector3d(c[0], c[1], c[2]), spheres[i].radius + padding);
+  }
+
+  bound = std::numeric_limits<double>::max();
+  for (std::size_t p = 0 ; p < primitives.size() ; ++p)
+  {
+    collision_detection::computeSphereDistances(batch, primitives[p], distances);
+    bound = std::min(bound, *std::min_element(distances.begin(), distances.end()));
+  }
+
+  return true;
+}
+
+}
 
 collision_detection::CollisionWorldIndustrial::CollisionWorldIndustrial() :
-  CollisionWorld()
+  CollisionWorld(), manager_ready_(true)
 {
   fcl::DynamicAABBTreeCollisionManager* m = new fcl::DynamicAABBTreeCollisionManager();
   // m->tree_init_level = 2;
@@ -53,7 +331,7 @@ collision_detection::CollisionWorldIndustrial::CollisionWorldIndustrial() :
 }
 
 collision_detection::CollisionWorldIndustrial::CollisionWorldIndustrial(const WorldPtr& world) :
-  CollisionWorld(world)
+  CollisionWorld(world), manager_ready_(true)
 {
   fcl::DynamicAABBTreeCollisionManager* m = new fcl::DynamicAABBTreeCollisionManager();
   // m->tree_init_level = 2;
@@ -65,16 +343,15 @@ collision_detection::CollisionWorldIndustrial::CollisionWorldIndustrial(const Wo
 }
 
 collision_detection::CollisionWorldIndustrial::CollisionWorldIndustrial(const CollisionWorldIndustrial &other, const WorldPtr& world) :
-  CollisionWorld(other, world)
+  CollisionWorld(other, world), octree_params_(other.octree_params_), manager_ready_(false)
 {
   fcl::DynamicAABBTreeCollisionManager* m = new fcl::DynamicAABBTreeCollisionManager();
   // m->tree_init_level = 2;
   manager_.reset(m);
 
+  // the objects and their geometries are shared with the other world until one of them changes them, the broadphase
+  // is built by the first query so that a copy which is never queried does not pay for it
   fcl_objs_ = other.fcl_objs_;
-  for (std::map<std::string, FCLObject>::iterator it = fcl_objs_.begin() ; it != fcl_objs_.end() ; ++it)
-    it->second.registerTo(manager_.get());
-  // manager_->update();
 
   // request notifications about changes to new world
   observer_handle_ = getWorld()->addObserver(boost::bind(&CollisionWorldIndustrial::notifyObjectChange, this, _1, _2));
@@ -97,12 +374,81 @@ void collision_detection::CollisionWorldIndustrial::checkRobotCollision(const Co
 
 void collision_detection::CollisionWorldIndustrial::checkRobotCollision(const CollisionRequest &req, CollisionResult &res, const CollisionRobot &robot, const robot_state::RobotState &state1, const robot_state::RobotState &state2) const
 {
-  logError("FCL continuous collision checking not yet implemented");
+  checkRobotCollisionHelper(req, res, robot, state1, state2, NULL);
 }
 
 void collision_detection::CollisionWorldIndustrial::checkRobotCollision(const CollisionRequest &req, CollisionResult &res, const CollisionRobot &robot, const robot_state::RobotState &state1, const robot_state::RobotState &state2, const AllowedCollisionMatrix &acm) const
 {
-  logError("FCL continuous collision checking not yet implemented");
+  checkRobotCollisionHelper(req, res, robot, state1, state2, &acm);
+}
+
+void collision_detection::CollisionWorldIndustrial::checkRobotCollisionHelper(const CollisionRequest &req, CollisionResult &res, const CollisionRobot &robot, const robot_state::RobotState &state1,
+                                                                             const robot_state::RobotState &state2, const AllowedCollisionMatrix *acm) const
+{
+  // Don't do anything if the world is empty
+  if (fcl_objs_.size() == 0)
+    return;
+
+  const CollisionRobotIndustrial &robot_fcl = dynamic_cast<const CollisionRobotIndustrial&>(robot);
+  FCLObject start_obj, end_obj;
+  robot_fcl.constructFCLObject(state1, start_obj);
+  robot_fcl.constructFCLObject(state2, end_obj);
+  if (start_obj.collision_objects_.size() != end_obj.collision_objects_.size())
+  {
+    logError("Continuous collision checking requires the same attached bodies at both states");
+    return;
+  }
+
+  CollisionData cd(&req, &res, acm);
+  cd.enableGroup(robot.getRobotModel());
+
+  fcl::ContinuousCollisionRequest ccd_req(CCD_MAX_ITERATIONS, CCD_TIME_OF_CONTACT_ERROR, fcl::CCDM_LINEAR, fcl::GST_LIBCCD,
+                                          fcl::CCDC_CONSERVATIVE_ADVANCEMENT);
+  OverlapData overlaps;
+  for (std::size_t i = 0 ; i < start_obj.collision_objects_.size() ; ++i)
+  {
+    const fcl::CollisionObject *robot_obj = start_obj.collision_objects_[i].get();
+    const CollisionGeometryData *robot_data = static_cast<const CollisionGeometryData*>(robot_obj->collisionGeometry()->getUserData());
+    if (!isActiveRobotObject(cd, *robot_data))
+      continue;
+
+    // the box bounding the object at both states bounds the linear motion in between, only the world objects the
+    // broadphase finds overlapping it can be hit
+    const fcl::Transform3f &robot_end_tf = end_obj.collision_objects_[i]->getTransform();
+    fcl::AABB swept = robot_obj->getAABB();
+    swept += end_obj.collision_objects_[i]->getAABB();
+    fcl::CollisionObject swept_obj(boost::shared_ptr<fcl::CollisionGeometry>(new fcl::Box(swept.width(), swept.height(), swept.depth())),
+                                   fcl::Transform3f(swept.center()));
+
+    overlaps.query = &swept_obj;
+    overlaps.objects.clear();
+    getManager()->collide(&swept_obj, &overlaps, &collectOverlapsCallback);
+
+    for (std::size_t j = 0 ; j < overlaps.objects.size() ; ++j)
+    {
+      const fcl::CollisionObject *world_obj = overlaps.objects[j];
+      const CollisionGeometryData *world_data = static_cast<const CollisionGeometryData*>(world_obj->collisionGeometry()->getUserData());
+
+      AllowedCollision::Type type = AllowedCollision::NEVER;
+      if (acm && acm->getEntry(robot_data->getID(), world_data->getID(), type) && type == AllowedCollision::ALWAYS)
+        continue;
+
+      // the world is static, its objects end where they start
+      fcl::ContinuousCollisionResult ccd_res;
+      fcl::continuousCollide(robot_obj, robot_end_tf, world_obj, world_obj->getTransform(), ccd_req, ccd_res);
+      if (!ccd_res.is_collide)
+        continue;
+
+      // as in the discrete check the contacts of a conditional entry are up to its decision function
+      DecideContactFn dcf;
+      if (type == AllowedCollision::CONDITIONAL && acm->getEntry(robot_data->getID(), world_data->getID(), dcf) && dcf &&
+          isContactAllowed(*robot_obj, ccd_res.contact_tf1, *world_obj, ccd_res.contact_tf2, dcf))
+        continue;
+
+      res.collision = true;
+      return;
+    }
+  }
 }
 
 void collision_detection::CollisionWorldIndustrial::checkRobotCollisionHelper(const CollisionRequest &req, CollisionResult &res, const CollisionRobot &robot, const robot_state::RobotState &state, const AllowedCollisionMatrix *acm) const
@@ -112,13 +458,12 @@ void collision_detection::CollisionWorldIndustrial::checkRobotCollisionHelper(co
     return;
 
   const CollisionRobotIndustrial &robot_fcl = dynamic_cast<const CollisionRobotIndustrial&>(robot);
-  FCLObject fcl_obj;
-  robot_fcl.constructFCLObject(state, fcl_obj);
+  const FCLObject &fcl_obj = robot_fcl.getSelfCollisionBroadPhase(state, false).object_;
 
   CollisionData cd(&req, &res, acm);
   cd.enableGroup(robot.getRobotModel());
   for (std::size_t i = 0 ; !cd.done_ && i < fcl_obj.collision_objects_.size() ; ++i)
-    manager_->collide(fcl_obj.collision_objects_[i].get(), &cd, &collisionCallback);
+    getManager()->collide(fcl_obj.collision_objects_[i].get(), &cd, &collisionCallback);
 
   if (req.distance)
   {
@@ -131,6 +476,66 @@ void collision_detection::CollisionWorldIndustrial::checkRobotCollisionHelper(co
   }
 }
 
+void collision_detection::CollisionWorldIndustrial::checkRobotAndSelfCollision(const CollisionRequest &req, CollisionResult &res, const CollisionRobot &robot,
+                                                                            const robot_state::RobotState &state, const AllowedCollisionMatrix *acm,
+                                                                            const AllowedCollisionBitMatrix *acm_bits) const
+{
+  const CollisionRobotIndustrial &robot_fcl = dynamic_cast<const CollisionRobotIndustrial&>(robot);
+  FCLManager &manager = robot_fcl.getSelfCollisionBroadPhase(state);
+  const FCLObject &fcl_obj = manager.object_;
+
+  // robot vs world, the objects of the broadphase are already at the state
+  CollisionData cd(&req, &res, acm);
+  cd.enableGroup(robot.getRobotModel());
+  CollisionBitMatrixData bd(&cd, acm_bits);
+  if (fcl_objs_.size() > 0)
+    for (std::size_t i = 0 ; !cd.done_ && i < fcl_obj.collision_objects_.size() ; ++i)
+      getManager()->collide(fcl_obj.collision_objects_[i].get(), &bd, &collisionBitMatrixCallback);
+
+  // self collision with the same objects, the contacts found so far count towards the request limits
+  if (!cd.done_)
+    manager.manager_->collide(&bd, &collisionBitMatrixCallback);
+
+  if (req.distance)
+  {
+    DistanceRequest dreq(false, true, req.group_name, acm);
+    dreq.acm_bits = acm_bits;
+    DistanceResult dres;
+
+    dreq.enableGroup(robot.getRobotModel());
+    robot_fcl.distanceSelfHelper(dreq, dres, state);
+    if (fcl_objs_.size() > 0)
+      distanceRobotHelper(dreq, dres, robot, state);
+    res.distance = dres.minimum_distance.min_distance;
+  }
+}
+
+bool collision_detection::CollisionWorldIndustrial::isRobotColliding(const CollisionRobot &robot, const robot_state::RobotState &state,
+                                                                     const std::string &group_name, const AllowedCollisionMatrix *acm,
+                                                                     const AllowedCollisionBitMatrix *acm_bits) const
+{
+  CollisionRequest req;
+  req.group_name = group_name;
+  req.contacts = false;
+  CollisionResult res;
+
+  const CollisionRobotIndustrial &robot_fcl = dynamic_cast<const CollisionRobotIndustrial&>(robot);
+  FCLManager &manager = robot_fcl.getSelfCollisionBroadPhase(state);
+  const FCLObject &fcl_obj = manager.object_;
+
+  CollisionData cd(&req, &res, acm);
+  cd.enableGroup(robot.getRobotModel());
+  CollisionBitMatrixData bd(&cd, acm_bits);
+  if (fcl_objs_.size() > 0)
+    for (std::size_t i = 0 ; !cd.done_ && i < fcl_obj.collision_objects_.size() ; ++i)
+      getManager()->collide(fcl_obj.collision_objects_[i].get(), &bd, &collisionBooleanCallback);
+
+  if (!cd.done_)
+    manager.manager_->collide(&bd, &collisionBooleanCallback);
+
+  return res.collision;
+}
+
 void collision_detection::CollisionWorldIndustrial::checkWorldCollision(const CollisionRequest &req, CollisionResult &res, const CollisionWorld &other_world) const
 {
   checkWorldCollisionHelper(req, res, other_world, NULL);
@@ -145,20 +550,34 @@ void collision_detection::CollisionWorldIndustrial::checkWorldCollisionHelper(co
 {
   const CollisionWorldIndustrial &other_fcl_world = dynamic_cast<const CollisionWorldIndustrial&>(other_world);
   CollisionData cd(&req, &res, acm);
-  manager_->collide(other_fcl_world.manager_.get(), &cd, &collisionCallback);
+  getManager()->collide(other_fcl_world.getManager(), &cd, &collisionCallback);
 
   if (req.distance)
     res.distance = distanceWorldHelper(other_world, acm);
 }
 
-void collision_detection::CollisionWorldIndustrial::constructFCLObject(const World::Object *obj, FCLObject &fcl_obj) const
+void collision_detection::CollisionWorldIndustrial::constructFCLObject(const World::Object *obj, FCLObject &fcl_obj)
 {
   for (std::size_t i = 0 ; i < obj->shapes_.size() ; ++i)
   {
-    FCLGeometryConstPtr g = createCollisionGeometry(obj->shapes_[i], obj);
+    FCLGeometryConstPtr g;
+    if (obj->shapes_[i]->type == shapes::OCTREE)
+    {
+      if (octree_params_.use_distance_field)
+        continue;
+
+      g = createOcTreeGeometry(obj, i);
+    }
+    else
+    {
+      g = reuseRetiredGeometry(obj, i);
+      if (!g)
+        g = createCachedCollisionGeometry(obj->shapes_[i], obj, i);
+    }
     if (g)
     {
       fcl::CollisionObject *co = new fcl::CollisionObject(g->collision_geometry_,  transform2fcl(obj->shape_poses_[i]));
+      setObjectName(*co, obj->id_);
       fcl_obj.collision_objects_.push_back(std::shared_ptr<fcl::CollisionObject>(co));
       fcl_obj.collision_geometry_.push_back(g);
     }
@@ -171,7 +590,7 @@ void collision_detection::CollisionWorldIndustrial::updateFCLObject(const std::s
   std::map<std::string, FCLObject>::iterator jt = fcl_objs_.find(id);
   if (jt != fcl_objs_.end())
   {
-    jt->second.unregisterFrom(manager_.get());
+    unregisterFCLObject(jt->second);
     jt->second.clear();
   }
 
@@ -183,12 +602,12 @@ void collision_detection::CollisionWorldIndustrial::updateFCLObject(const std::s
     if (jt != fcl_objs_.end())
     {
       constructFCLObject(it->second.get(), jt->second);
-      jt->second.registerTo(manager_.get());
+      registerFCLObject(jt->second);
     }
     else
     {
       constructFCLObject(it->second.get(), fcl_objs_[id]);
-      fcl_objs_[id].registerTo(manager_.get());
+      registerFCLObject(fcl_objs_[id]);
     }
   }
   else
@@ -200,6 +619,163 @@ void collision_detection::CollisionWorldIndustrial::updateFCLObject(const std::s
   // manager_->update();
 }
 
+void collision_detection::CollisionWorldIndustrial::registerFCLObject(FCLObject &fcl_obj)
+{
+  if (manager_ready_)
+    fcl_obj.registerTo(manager_.get());
+}
+
+void collision_detection::CollisionWorldIndustrial::unregisterFCLObject(FCLObject &fcl_obj)
+{
+  if (manager_ready_)
+    fcl_obj.unregisterFrom(manager_.get());
+}
+
+fcl::BroadPhaseCollisionManager* collision_detection::CollisionWorldIndustrial::getManager() const
+{
+  if (!manager_ready_.load(std::memory_order_acquire))
+  {
+    std::lock_guard<std::mutex> lock(manager_mutex_);
+    if (!manager_ready_.load(std::memory_order_relaxed))
+    {
+      // registering every object at once builds a balanced tree instead of inserting the objects one by one
+      std::vector<fcl::CollisionObject*> objects;
+      for (std::map<std::string, FCLObject>::const_iterator it = fcl_objs_.begin() ; it != fcl_objs_.end() ; ++it)
+        for (std::size_t i = 0 ; i < it->second.collision_objects_.size() ; ++i)
+          objects.push_back(it->second.collision_objects_[i].get());
+
+      manager_->registerObjects(objects);
+      manager_->setup();
+      manager_ready_.store(true, std::memory_order_release);
+    }
+  }
+
+  return manager_.get();
+}
+
+void collision_detection::CollisionWorldIndustrial::moveFCLObject(const World::Object *obj)
+{
+  std::map<std::string, FCLObject>::iterator it = fcl_objs_.find(obj->id_);
+  if (it == fcl_objs_.end())
+  {
+    updateFCLObject(obj->id_);
+    return;
+  }
+
+  // the objects of a copied world are shared until one of the worlds changes them
+  FCLObject &fcl_obj = it->second;
+  bool shared = false;
+  for (std::size_t i = 0 ; !shared && i < fcl_obj.collision_objects_.size() ; ++i)
+    shared = fcl_obj.collision_objects_[i].use_count() > 1;
+
+  if (shared)
+  {
+    unregisterFCLObject(fcl_obj);
+    for (std::size_t i = 0 ; i < fcl_obj.collision_objects_.size() ; ++i)
+      fcl_obj.collision_objects_[i] = FCLCollisionObjectPtr(new fcl::CollisionObject(*fcl_obj.collision_objects_[i]));
+  }
+
+  for (std::size_t i = 0 ; i < fcl_obj.collision_objects_.size() ; ++i)
+  {
+    fcl::CollisionObject *co = fcl_obj.collision_objects_[i].get();
+    const CollisionGeometryData *cd = static_cast<const CollisionGeometryData*>(co->collisionGeometry()->getUserData());
+    co->setTransform(transform2fcl(obj->shape_poses_[cd->shape_index]));
+    co->computeAABB();
+    if (!shared && manager_ready_)
+      manager_->update(co);
+  }
+
+  if (shared)
+    registerFCLObject(fcl_obj);
+}
+
+void collision_detection::CollisionWorldIndustrial::retireGeometries(const World::Object *obj, const FCLObject &fcl_obj)
+{
+  for (std::size_t i = 0 ; i < fcl_obj.collision_geometry_.size() ; ++i)
+  {
+    const FCLGeometryConstPtr &g = fcl_obj.collision_geometry_[i];
+    const int shape_index = g->collision_geometry_data_->shape_index;
+    if (shape_index < 0 || shape_index >= static_cast<int>(obj->shapes_.size()) || obj->shapes_[shape_index]->type != shapes::MESH)
+      continue;
+
+    const shapes::Mesh &mesh = static_cast<const shapes::Mesh&>(*obj->shapes_[shape_index]);
+    RetiredGeometry retired;
+    retired.vertex_count = mesh.vertex_count;
+    retired.triangle_count = mesh.triangle_count;
+    retired.signature = computeShapeSignature(mesh);
+    retired.geometry = g->collision_geometry_;
+    retired_geometries_.push_back(retired);
+    if (retired_geometries_.size() > MAX_RETIRED_GEOMETRIES)
+      retired_geometries_.pop_front();
+  }
+}
+
+collision_detection::FCLGeometryConstPtr collision_detection::CollisionWorldIndustrial::reuseRetiredGeometry(const World::Object *obj, std::size_t shape_index)
+{
+  if (retired_geometries_.empty() || obj->shapes_[shape_index]->type != shapes::MESH)
+    return FCLGeometryConstPtr();
+
+  const shapes::Mesh &mesh = static_cast<const shapes::Mesh&>(*obj->shapes_[shape_index]);
+  bool signature_computed = false;
+  std::uint64_t signature = 0;
+  for (std::deque<RetiredGeometry>::reverse_iterator it = retired_geometries_.rbegin() ; it != retired_geometries_.rend() ; ++it)
+  {
+    if (it->vertex_count != mesh.vertex_count || it->triangle_count != mesh.triangle_count)
+      continue;
+
+    if (!signature_computed)
+    {
+      signature = computeShapeSignature(mesh);
+      signature_computed = true;
+    }
+
+    if (it->signature != signature)
+      continue;
+
+    // the geometry carries the data of its owner, it can only be handed over once the shape cache no longer holds the
+    // removed shape
+    if (it->geometry.use_count() > 1)
+      cleanCollisionGeometryCache();
+
+    if (it->geometry.use_count() > 1)
+      continue;
+
+    FCLGeometryPtr g(new FCLGeometry());
+    g->collision_geometry_ = it->geometry;
+    g->updateCollisionGeometryData(obj, shape_index, true);
+    retired_geometries_.erase(std::next(it).base());
+    return g;
+  }
+
+  return FCLGeometryConstPtr();
+}
+
+collision_detection::FCLGeometryConstPtr collision_detection::CollisionWorldIndustrial::createOcTreeGeometry(const World::Object *obj, std::size_t shape_index) const
+{
+  const shapes::OcTree &shape = static_cast<const shapes::OcTree&>(*obj->shapes_[shape_index]);
+  boost::shared_ptr<const octomap::OcTree> tree = coarsenOcTree(shape.octree, octree_params_.resolution, octree_params_.occupancy_threshold);
+
+  // without an uncertain band the traversal only descends into the occupied nodes
+  fcl::OcTree *fcl_tree = new fcl::OcTree(tree);
+  fcl_tree->setOccupancyThres(octree_params_.occupancy_threshold);
+  fcl_tree->setFreeThres(octree_params_.occupancy_threshold);
+  fcl_tree->computeLocalAABB();
+
+  return FCLGeometryConstPtr(new FCLGeometry(fcl_tree, obj, shape_index));
+}
+
+void collision_detection::CollisionWorldIndustrial::setOctreeParameters(const OctreeParameters &params)
+{
+  octree_params_ = params;
+  for (World::const_iterator it = getWorld()->begin(); it != getWorld()->end(); ++it)
+    for (std::size_t i = 0 ; i < it->second->shapes_.size() ; ++i)
+      if (it->second->shapes_[i]->type == shapes::OCTREE)
+      {
+        updateFCLObject(it->first);
+        break;
+      }
+}
+
 void collision_detection::CollisionWorldIndustrial::setWorld(const WorldPtr& world)
 {
   if (world == getWorld())
@@ -208,10 +784,22 @@ void collision_detection::CollisionWorldIndustrial::setWorld(const WorldPtr& wor
   // turn off notifications about old world
   getWorld()->removeObserver(observer_handle_);
 
-  // clear out objects from old world
+  // clear out objects from old world, the meshes are kept for the new world
+  for (std::map<std::string, FCLObject>::const_iterator it = fcl_objs_.begin() ; it != fcl_objs_.end() ; ++it)
+  {
+    World::const_iterator obj = getWorld()->find(it->first);
+    if (obj != getWorld()->end())
+      retireGeometries(obj->second.get(), it->second);
+  }
   manager_->clear();
+  manager_ready_ = true;
   fcl_objs_.clear();
   cleanCollisionGeometryCache();
+  {
+    std::lock_guard<std::mutex> lock(distance_field_mutex_);
+    if (distance_field_)
+      distance_field_->clear();
+  }
 
   CollisionWorld::setWorld(world);
 
@@ -222,24 +810,59 @@ void collision_detection::CollisionWorldIndustrial::setWorld(const WorldPtr& wor
   getWorld()->notifyObserverAllObjects(observer_handle_, World::CREATE);
 }
 
+collision_detection::CollisionWorldIndustrialConstPtr collision_detection::CollisionWorldIndustrial::createSnapshot() const
+{
+  // the world copy shares the objects until this world modifies them, the observer of the copy is never notified
+  WorldPtr world(new World(*getWorld()));
+  return CollisionWorldIndustrialConstPtr(new CollisionWorldIndustrial(*this, world));
+}
+
+collision_detection::WorldDistanceFieldConstPtr collision_detection::CollisionWorldIndustrial::getDistanceField(const WorldDistanceField::Parameters &params) const
+{
+  std::lock_guard<std::mutex> lock(distance_field_mutex_);
+  if (distance_field_ && distance_field_->getParameters() == params)
+    return distance_field_;
+
+  distance_field_.reset(new WorldDistanceField(params));
+  for (World::const_iterator it = getWorld()->begin(); it != getWorld()->end(); ++it)
+    distance_field_->updateObject(it->second);
+
+  return distance_field_;
+}
+
 void collision_detection::CollisionWorldIndustrial::notifyObjectChange(const ObjectConstPtr& obj, World::Action action)
 {
+  {
+    std::lock_guard<std::mutex> lock(distance_field_mutex_);
+    if (distance_field_)
+    {
+      if (action == World::DESTROY)
+        distance_field_->removeObject(obj->id_);
+      else
+        distance_field_->updateObject(obj);
+    }
+  }
+
+  // the shape cache is not purged here, the geometries of removed meshes are retired instead so that the objects that
+  // are removed and added again do not rebuild their bounding volume hierarchies
   if (action == World::DESTROY)
   {
     std::map<std::string, FCLObject>::iterator it = fcl_objs_.find(obj->id_);
     if (it != fcl_objs_.end())
     {
-      it->second.unregisterFrom(manager_.get());
+      unregisterFCLObject(it->second);
+      retireGeometries(obj.get(), it->second);
       it->second.clear();
       fcl_objs_.erase(it);
     }
-    cleanCollisionGeometryCache();
+  }
+  else if (action == World::MOVE_SHAPE)
+  {
+    moveFCLObject(obj.get());
   }
   else
   {
     updateFCLObject(obj->id_);
-    if (action & (World::DESTROY|World::REMOVE_SHAPE))
-      cleanCollisionGeometryCache();
   }
 }
 
@@ -250,8 +873,7 @@ double collision_detection::CollisionWorldIndustrial::distanceRobotHelper(const
     return std::numeric_limits<double>::max();
 
   const CollisionRobotIndustrial& robot_fcl = dynamic_cast<const CollisionRobotIndustrial&>(robot);
-  FCLObject fcl_obj;
-  robot_fcl.constructFCLObject(state, fcl_obj);
+  const FCLObject &fcl_obj = robot_fcl.getSelfCollisionBroadPhase(state, false).object_;
 
   CollisionRequest req;
   CollisionResult res;
@@ -259,7 +881,7 @@ double collision_detection::CollisionWorldIndustrial::distanceRobotHelper(const
   cd.enableGroup(robot.getRobotModel());
 
   for(std::size_t i = 0; !cd.done_ && i < fcl_obj.collision_objects_.size(); ++i)
-    manager_->distance(fcl_obj.collision_objects_[i].get(), &cd, &distanceCallback);
+    getManager()->distance(fcl_obj.collision_objects_[i].get(), &cd, &distanceCallback);
 
 
   return res.distance;
@@ -268,13 +890,97 @@ double collision_detection::CollisionWorldIndustrial::distanceRobotHelper(const
 void collision_detection::CollisionWorldIndustrial::distanceRobotHelper(const DistanceRequest &req, DistanceResult &res, const collision_detection::CollisionRobot &robot, const robot_state::RobotState &state) const
 {
   const CollisionRobotIndustrial& robot_fcl = dynamic_cast<const CollisionRobotIndustrial&>(robot);
-  FCLObject fcl_obj;
-  robot_fcl.constructFCLObject(state, fcl_obj);
+  const FCLObject &fcl_obj = robot_fcl.getSelfCollisionBroadPhase(state, false).object_;
 
+  res.resize(state.getRobotModel()->getLinkModelCount());
   DistanceData drd(&req, &res);
-  for(std::size_t i = 0; !drd.done && i < fcl_obj.collision_objects_.size(); ++i)
-    manager_->distance(fcl_obj.collision_objects_[i].get(), &drd, &distanceDetailedCallback);
+  drd.lods = robot_fcl.mesh_lods_.get();
+
+  // the links whose spheres are beyond the threshold from every world primitive can not produce a result, their
+  // broadphase queries are skipped.  The primitives are described once by the caller, the workers read them
+  CollisionPrimitives primitives;
+  bool prune = req.sphere_model && req.distance_threshold < std::numeric_limits<double>::max() &&
+      getWorldPrimitives(fcl_objs_, primitives);
+
+  auto distance_link = [&](std::size_t i, DistanceData &data)
+  {
+    double threshold = req.global ? std::min(req.distance_threshold, data.res->minimum_distance.min_distance) : req.distance_threshold;
+    double bound;
+    if (prune && computeSphereLowerBound(*fcl_obj.collision_objects_[i], robot, *req.sphere_model, primitives, bound) &&
+        bound >= threshold)
+      return;
+
+    getManager()->distance(fcl_obj.collision_objects_[i].get(), &data, &distanceDetailedCallback);
+  };
 
+  const std::size_t num_objects = fcl_obj.collision_objects_.size();
+  const std::size_t num_threads = std::min<std::size_t>(std::max(req.num_threads, 1), num_objects);
+  if (num_threads < 2)
+  {
+    for(std::size_t i = 0; !drd.done && i < num_objects; ++i)
+      distance_link(i, drd);
+    return;
+  }
+
+  // each worker claims the links one at a time and keeps its own results, starting from those already in res, which
+  // are then merged.  The results of a link and of its attached bodies may come from different workers
+  std::vector<DistanceResult> worker_results(num_threads, res);
+
+  // the world broadphase is built before the workers share it
+  getManager();
+  std::atomic<std::size_t> next_object(0);
+  std::atomic<bool> done(false);
+  QueryThreadPool::instance().run(num_threads, [&](std::size_t worker)
+  {
+    DistanceData data(&req, &worker_results[worker]);
+    data.lods = drd.lods;
+    for (std::size_t i = next_object++; !done && i < num_objects; i = next_object++)
+    {
+      distance_link(i, data);
+      if (data.done)
+        done = true;
+    }
+  });
+
+  for (std::size_t w = 0; w < num_threads; ++w)
+  {
+    const DistanceResult &worker_res = worker_results[w];
+    res.collision |= worker_res.collision;
+    if (worker_res.minimum_distance.min_distance < res.minimum_distance.min_distance)
+      res.minimum_distance.update(worker_res.minimum_distance);
+
+    for (std::size_t l = 0; l < res.distance.size(); ++l)
+      if (worker_res.distance[l].min_distance < res.distance[l].min_distance)
+        res.distance[l].update(worker_res.distance[l]);
+  }
+}
+
+void collision_detection::CollisionWorldIndustrial::distanceRobotStates(const CollisionRobot &robot, const std::vector<robot_state::RobotState> &states,
+                                                                      std::vector<double> &distances, const AllowedCollisionMatrix *acm) const
+{
+  distances.resize(states.size());
+  for (std::size_t s = 0; s < states.size(); ++s)
+    distances[s] = distanceRobotHelper(robot, states[s], acm);
+}
+
+bool collision_detection::CollisionWorldIndustrial::checkTrajectoryCollision(const CollisionRequest &req, TrajectoryCollisionResult &res, const CollisionRobot &robot,
+                                                                           const robot_state::RobotState &reference_state, const Eigen::MatrixXd &trajectory,
+                                                                           const AllowedCollisionMatrix *acm, int num_threads) const
+{
+  // the distance is computed separately, the detailed distance query of the collision helper is not needed
+  CollisionRequest collision_req = req;
+  collision_req.distance = false;
+
+  res.clear(trajectory.cols());
+  return forEachTrajectoryState(reference_state, req.group_name, trajectory, num_threads,
+                                [&](const robot_state::RobotState &state, int t)
+  {
+    CollisionResult collision_res;
+    checkRobotCollisionHelper(collision_req, collision_res, robot, state, acm);
+    res.collisions(t) = collision_res.collision;
+    if (req.distance)
+      res.distances(t) = distanceRobotHelper(robot, state, acm);
+  });
 }
 
 double collision_detection::CollisionWorldIndustrial::distanceRobot(const CollisionRobot &robot, const robot_state::RobotState &state,
@@ -312,7 +1018,7 @@ double collision_detection::CollisionWorldIndustrial::distanceWorldHelper(const
   CollisionRequest req;
   CollisionResult res;
   CollisionData cd(&req, &res, acm);
-  manager_->distance(other_fcl_world.manager_.get(), &cd, &distanceCallback);
+  getManager()->distance(other_fcl_world.getManager(), &cd, &distanceCallback);
 
   return res.distance;
 }
@@ -0,0 +1,112 @@
+/**
+ * @file mesh_geometry_cache.cpp
+ * @brief This contains a process wide cache of the bounding volume hierarchies of the world meshes
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @license Software License Agreement (Apache License)\n
+ * \n
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at\n
+ * \n
+ * http://www.apache.org/licenses/LICENSE-2.0\n
+ * \n
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <industrial_collision_detection/collision_detection/mesh_geometry_cache.h>
+#include <industrial_collision_detection/collision_detection/collision_common.h>
+#include <fcl/BVH/BVH_model.h>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+namespace
+{
+
+typedef fcl::BVHModel<fcl::OBBRSS> MeshModel;
+
+const std::size_t MAX_CACHED_MESH_GEOMETRIES = 64; /**< The number of mesh hierarchies kept, the oldest is dropped first */
+
+/** @brief The mesh hierarchies by the signature of their mesh */
+struct MeshGeometryCache
+{
+  std::mutex mutex;                                                           /**< Protects the cache */
+  std::unordered_map<std::uint64_t, boost::shared_ptr<const MeshModel> > models; /**< The hierarchies, without owner data */
+  std::deque<std::uint64_t> order;                                            /**< The signatures, the oldest first */
+};
+
+MeshGeometryCache& getMeshGeometryCache()
+{
+  static MeshGeometryCache cache;
+  return cache;
+}
+
+}
+
+namespace collision_detection
+{
+  FCLGeometryConstPtr createCachedCollisionGeometry(const shapes::ShapeConstPtr &shape, const World::Object *obj,
+                                                    int shape_index)
+  {
+    if (shape->type != shapes::MESH)
+      return createCollisionGeometry(shape, obj);
+
+    // hashing the mesh is linear in its size, building its hierarchy is not
+    MeshGeometryCache &cache = getMeshGeometryCache();
+    std::uint64_t signature = computeShapeSignature(*shape);
+    boost::shared_ptr<const MeshModel> model;
+    {
+      std::lock_guard<std::mutex> lock(cache.mutex);
+      std::unordered_map<std::uint64_t, boost::shared_ptr<const MeshModel> >::const_iterator it = cache.models.find(signature);
+      if (it != cache.models.end())
+        model = it->second;
+    }
+
+    if (model)
+    {
+      FCLGeometryPtr g(new FCLGeometry());
+      g->collision_geometry_.reset(new MeshModel(*model));
+      g->updateCollisionGeometryData(obj, shape_index, true);
+      return g;
+    }
+
+    FCLGeometryConstPtr g = createCollisionGeometry(shape, obj);
+    const MeshModel *built = g ? dynamic_cast<const MeshModel*>(g->collision_geometry_.get()) : NULL;
+    if (!built)
+      return g;
+
+    // the cache keeps its own copy, the geometry carries the data of its owner
+    boost::shared_ptr<MeshModel> copy(new MeshModel(*built));
+    copy->setUserData(NULL);
+
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    if (cache.models.insert(std::make_pair(signature, copy)).second)
+    {
+      cache.order.push_back(signature);
+      if (cache.order.size() > MAX_CACHED_MESH_GEOMETRIES)
+      {
+        cache.models.erase(cache.order.front());
+        cache.order.pop_front();
+      }
+    }
+    return g;
+  }
+
+  void clearMeshGeometryCache()
+  {
+    MeshGeometryCache &cache = getMeshGeometryCache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    cache.models.clear();
+    cache.order.clear();
+  }
+}
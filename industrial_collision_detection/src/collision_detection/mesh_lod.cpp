@@ -0,0 +1,252 @@
+/**
+ * @file mesh_lod.cpp
+ * @brief This contains the coarse levels of detail of the robot meshes used by the distance queries
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @license Software License Agreement (Apache License)\n
+ * \n
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at\n
+ * \n
+ * http://www.apache.org/licenses/LICENSE-2.0\n
+ * \n
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <industrial_collision_detection/collision_detection/mesh_lod.h>
+#include <fcl/BVH/BVH_model.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+
+namespace
+{
+
+typedef fcl::BVHModel<fcl::OBBRSS> MeshModel;
+typedef std::array<unsigned int, 3> Triangle;
+
+const unsigned int MIN_LOD_TRIANGLES = 2000;  /**< Smaller meshes are measured exactly */
+const double LOD_CELL_FRACTION = 1.0 / 32.0;  /**< The grid cell size relative to the largest extent of a mesh */
+const double MIN_LOD_REDUCTION = 0.5;         /**< The largest fraction of the triangles a coarse mesh can keep */
+
+/** @brief The coarse geometries by original geometry, an entry is valid as long as its geometry exists */
+struct MeshLODCache
+{
+  std::mutex mutex;
+  std::map<const fcl::CollisionGeometry*, std::pair<boost::weak_ptr<fcl::CollisionGeometry>, collision_detection::MeshLOD> > lods;
+};
+
+MeshLODCache& getMeshLODCache()
+{
+  static MeshLODCache cache;
+  return cache;
+}
+
+/** @brief The triangle with its vertices sorted, the orientation does not matter to a distance query */
+Triangle makeTriangle(unsigned int a, unsigned int b, unsigned int c)
+{
+  Triangle t = {{a, b, c}};
+  std::sort(t.begin(), t.end());
+  return t;
+}
+
+}
+
+namespace collision_detection
+{
+  bool createMeshLOD(const shapes::Mesh &mesh, double cell_size, MeshLOD &lod)
+  {
+    if (mesh.triangle_count == 0 || mesh.vertex_count == 0 || !(cell_size > 0.0))
+      return false;
+
+    // cluster the vertices by grid cell, each cluster becomes the mean of its vertices
+    std::map<std::array<long, 3>, unsigned int> cells;
+    std::vector<unsigned int> cluster(mesh.vertex_count);
+    std::vector<Eigen::Vector3d> sums;
+    std::vector<unsigned int> counts;
+    for (unsigned int i = 0; i < mesh.vertex_count; ++i)
+    {
+      const double *v = mesh.vertices + 3 * i;
+      std::array<long, 3> cell = {{std::lround(std::floor(v[0] / cell_size)),
+                                   std::lround(std::floor(v[1] / cell_size)),
+                                   std::lround(std::floor(v[2] / cell_size))}};
+      std::map<std::array<long, 3>, unsigned int>::iterator it = cells.insert(std::make_pair(cell, static_cast<unsigned int>(sums.size()))).first;
+      if (it->second == sums.size())
+      {
+        sums.push_back(Eigen::Vector3d::Zero());
+        counts.push_back(0);
+      }
+      cluster[i] = it->second;
+      sums[it->second] += Eigen::Vector3d(v[0], v[1], v[2]);
+      counts[it->second]++;
+    }
+
+    std::vector<fcl::Vec3f> points(sums.size());
+    for (std::size_t c = 0; c < sums.size(); ++c)
+    {
+      Eigen::Vector3d p = sums[c] / counts[c];
+      points[c].setValue(p.x(), p.y(), p.z());
+    }
+
+    double error = 0.0;
+    for (unsigned int i = 0; i < mesh.vertex_count; ++i)
+    {
+      const double *v = mesh.vertices + 3 * i;
+      const fcl::Vec3f &p = points[cluster[i]];
+      error = std::max(error, (fcl::Vec3f(v[0], v[1], v[2]) - p).length());
+    }
+
+    // the collapsed triangles are only kept where no other triangle covers them, every point of the original surface
+    // then moves onto the coarse one and the error bounds the distance between the surfaces in both directions
+    std::set<Triangle> faces, segments, corners;
+    for (unsigned int i = 0; i < mesh.triangle_count; ++i)
+    {
+      Triangle t = makeTriangle(cluster[mesh.triangles[3 * i]], cluster[mesh.triangles[3 * i + 1]], cluster[mesh.triangles[3 * i + 2]]);
+      if (t[0] != t[1] && t[1] != t[2])
+        faces.insert(t);
+      else if (t[0] != t[2])
+        segments.insert(makeTriangle(t[0], t[2], t[2]));
+      else
+        corners.insert(t);
+    }
+
+    std::set<std::pair<unsigned int, unsigned int> > edges;
+    std::vector<bool> used(points.size(), false);
+    for (std::set<Triangle>::const_iterator it = faces.begin(); it != faces.end(); ++it)
+    {
+      edges.insert(std::make_pair((*it)[0], (*it)[1]));
+      edges.insert(std::make_pair((*it)[1], (*it)[2]));
+      edges.insert(std::make_pair((*it)[0], (*it)[2]));
+      used[(*it)[0]] = used[(*it)[1]] = used[(*it)[2]] = true;
+    }
+
+    std::vector<fcl::Triangle> triangles;
+    triangles.reserve(faces.size());
+    for (std::set<Triangle>::const_iterator it = faces.begin(); it != faces.end(); ++it)
+      triangles.push_back(fcl::Triangle((*it)[0], (*it)[1], (*it)[2]));
+
+    for (std::set<Triangle>::const_iterator it = segments.begin(); it != segments.end(); ++it)
+      if (!edges.count(std::make_pair((*it)[0], (*it)[1])))
+      {
+        triangles.push_back(fcl::Triangle((*it)[0], (*it)[1], (*it)[2]));
+        used[(*it)[0]] = used[(*it)[1]] = true;
+      }
+
+    for (std::set<Triangle>::const_iterator it = corners.begin(); it != corners.end(); ++it)
+      if (!used[(*it)[0]])
+        triangles.push_back(fcl::Triangle((*it)[0], (*it)[0], (*it)[0]));
+
+    if (triangles.size() > MIN_LOD_REDUCTION * mesh.triangle_count)
+      return false;
+
+    MeshModel *model = new MeshModel();
+    model->beginModel();
+    model->addSubModel(points, triangles);
+    model->endModel();
+    model->computeLocalAABB();
+
+    lod.geometry.reset(model);
+    lod.error = error;
+    return true;
+  }
+
+  bool getMeshLOD(const shapes::ShapeConstPtr &shape, double scale, double padding,
+                  const boost::shared_ptr<fcl::CollisionGeometry> &geometry, MeshLOD &lod)
+  {
+    if (!shape || !geometry || shape->type != shapes::MESH)
+      return false;
+
+    const shapes::Mesh &original = static_cast<const shapes::Mesh&>(*shape);
+    if (original.triangle_count < MIN_LOD_TRIANGLES)
+      return false;
+
+    MeshLODCache &cache = getMeshLODCache();
+    {
+      std::lock_guard<std::mutex> lock(cache.mutex);
+      std::map<const fcl::CollisionGeometry*, std::pair<boost::weak_ptr<fcl::CollisionGeometry>, MeshLOD> >::const_iterator it = cache.lods.find(geometry.get());
+      if (it != cache.lods.end() && it->second.first.lock() == geometry)
+      {
+        lod = it->second.second;
+        return true;
+      }
+    }
+
+    // simplify the mesh as the geometry was created from it
+    std::unique_ptr<shapes::Mesh> mesh(static_cast<shapes::Mesh*>(original.clone()));
+    mesh->scaleAndPadd(scale, padding);
+
+    Eigen::Map<const Eigen::Matrix<double, 3, Eigen::Dynamic> > vertices(mesh->vertices, 3, mesh->vertex_count);
+    double extent = (vertices.rowwise().maxCoeff() - vertices.rowwise().minCoeff()).maxCoeff();
+    if (!createMeshLOD(*mesh, extent * LOD_CELL_FRACTION, lod))
+      return false;
+
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    for (std::map<const fcl::CollisionGeometry*, std::pair<boost::weak_ptr<fcl::CollisionGeometry>, MeshLOD> >::iterator it = cache.lods.begin(); it != cache.lods.end();)
+    {
+      if (it->second.first.expired())
+        cache.lods.erase(it++);
+      else
+        ++it;
+    }
+    cache.lods[geometry.get()] = std::make_pair(boost::weak_ptr<fcl::CollisionGeometry>(geometry), lod);
+    return true;
+  }
+
+  bool distanceCoarse(const fcl::CollisionObject &o1, const fcl::CollisionObject &o2, const MeshLODMap &lods,
+                      const DistanceRequest &req, double threshold, fcl::DistanceResult &result, double &d)
+  {
+    MeshLODMap::const_iterator lod1 = lods.find(o1.collisionGeometry().get());
+    MeshLODMap::const_iterator lod2 = lods.find(o2.collisionGeometry().get());
+    if (lod1 == lods.end() && lod2 == lods.end())
+      return false;
+
+    double error = 0.0;
+    boost::shared_ptr<fcl::CollisionGeometry> g1 = o1.collisionGeometry(), g2 = o2.collisionGeometry();
+    if (lod1 != lods.end())
+    {
+      g1 = lod1->second.geometry;
+      error += lod1->second.error;
+    }
+
+    if (lod2 != lods.end())
+    {
+      g2 = lod2->second.geometry;
+      error += lod2->second.error;
+    }
+
+    fcl::CollisionObject c1(g1, o1.getTransform()), c2(g2, o2.getTransform());
+    result.min_distance = threshold + error;
+    double coarse = fcl::distance(&c1, &c2, fcl::DistanceRequest(req.detailed), result);
+
+    // the exact distance is not below the threshold
+    if (coarse - error >= threshold)
+    {
+      d = threshold;
+      return true;
+    }
+
+    // far enough from contact for the coarse distance to do
+    if (coarse > req.lod_margin + error)
+    {
+      d = coarse;
+      return true;
+    }
+
+    return false;
+  }
+
+}
@@ -0,0 +1,300 @@
+/**
+ * @file primitive_distance.cpp
+ * @brief This contains batched distance kernels between spheres and primitive shapes
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @license Software License Agreement (Apache License)\n
+ * \n
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at\n
+ * \n
+ * http://www.apache.org/licenses/LICENSE-2.0\n
+ * \n
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <industrial_collision_detection/collision_detection/primitive_distance.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+
+using collision_detection::CollisionPrimitive;
+using collision_detection::SphereBatch;
+
+/** @brief One double, the kernels process the spheres left over by the vector packs with it */
+struct ScalarPack
+{
+  static const std::size_t WIDTH = 1;
+  double v;
+
+  static ScalarPack load(const double *p) { ScalarPack r; r.v = *p; return r; }
+  static ScalarPack set(double a) { ScalarPack r; r.v = a; return r; }
+  void store(double *p) const { *p = v; }
+
+  friend ScalarPack operator+(ScalarPack a, ScalarPack b) { return set(a.v + b.v); }
+  friend ScalarPack operator-(ScalarPack a, ScalarPack b) { return set(a.v - b.v); }
+  friend ScalarPack operator*(ScalarPack a, ScalarPack b) { return set(a.v * b.v); }
+  friend ScalarPack max(ScalarPack a, ScalarPack b) { return set(std::max(a.v, b.v)); }
+  friend ScalarPack min(ScalarPack a, ScalarPack b) { return set(std::min(a.v, b.v)); }
+  friend ScalarPack sqrt(ScalarPack a) { return set(std::sqrt(a.v)); }
+  friend ScalarPack abs(ScalarPack a) { return set(std::abs(a.v)); }
+};
+
+#if defined(__AVX2__)
+
+/** @brief Four doubles in an AVX register */
+struct VectorPack
+{
+  static const std::size_t WIDTH = 4;
+  __m256d v;
+
+  static VectorPack make(__m256d a) { VectorPack r; r.v = a; return r; }
+  static VectorPack load(const double *p) { return make(_mm256_loadu_pd(p)); }
+  static VectorPack set(double a) { return make(_mm256_set1_pd(a)); }
+  void store(double *p) const { _mm256_storeu_pd(p, v); }
+
+  friend VectorPack operator+(VectorPack a, VectorPack b) { return make(_mm256_add_pd(a.v, b.v)); }
+  friend VectorPack operator-(VectorPack a, VectorPack b) { return make(_mm256_sub_pd(a.v, b.v)); }
+  friend VectorPack operator*(VectorPack a, VectorPack b) { return make(_mm256_mul_pd(a.v, b.v)); }
+  friend VectorPack max(VectorPack a, VectorPack b) { return make(_mm256_max_pd(a.v, b.v)); }
+  friend VectorPack min(VectorPack a, VectorPack b) { return make(_mm256_min_pd(a.v, b.v)); }
+  friend VectorPack sqrt(VectorPack a) { return make(_mm256_sqrt_pd(a.v)); }
+  friend VectorPack abs(VectorPack a) { return make(_mm256_andnot_pd(_mm256_set1_pd(-0.0), a.v)); }
+};
+
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+
+/** @brief Two doubles in a NEON register */
+struct VectorPack
+{
+  static const std::size_t WIDTH = 2;
+  float64x2_t v;
+
+  static VectorPack make(float64x2_t a) { VectorPack r; r.v = a; return r; }
+  static VectorPack load(const double *p) { return make(vld1q_f64(p)); }
+  static VectorPack set(double a) { return make(vdupq_n_f64(a)); }
+  void store(double *p) const { vst1q_f64(p, v); }
+
+  friend VectorPack operator+(VectorPack a, VectorPack b) { return make(vaddq_f64(a.v, b.v)); }
+  friend VectorPack operator-(VectorPack a, VectorPack b) { return make(vsubq_f64(a.v, b.v)); }
+  friend VectorPack operator*(VectorPack a, VectorPack b) { return make(vmulq_f64(a.v, b.v)); }
+  friend VectorPack max(VectorPack a, VectorPack b) { return make(vmaxq_f64(a.v, b.v)); }
+  friend VectorPack min(VectorPack a, VectorPack b) { return make(vminq_f64(a.v, b.v)); }
+  friend VectorPack sqrt(VectorPack a) { return make(vsqrtq_f64(a.v)); }
+  friend VectorPack abs(VectorPack a) { return make(vabsq_f64(a.v)); }
+};
+
+#else
+
+typedef ScalarPack VectorPack;
+
+#endif
+
+/** @brief The sphere centers of a pack expressed in the frame of a primitive */
+template <typename P>
+struct LocalCenters
+{
+  P x, y, z, radius;
+};
+
+/**
+ * @brief Loads the spheres starting at an index and moves their centers into the frame of a primitive
+ * @param spheres The spheres
+ * @param i       The index of the first sphere of the pack
+ * @param primitive The primitive
+ */
+template <typename P>
+LocalCenters<P> loadLocalCenters(const SphereBatch &spheres, std::size_t i, const CollisionPrimitive &primitive)
+{
+  const Eigen::Matrix3d r = primitive.pose.linear();
+  const Eigen::Vector3d t = primitive.pose.translation();
+  P dx = P::load(&spheres.x[i]) - P::set(t.x());
+  P dy = P::load(&spheres.y[i]) - P::set(t.y());
+  P dz = P::load(&spheres.z[i]) - P::set(t.z());
+
+  // the inverse of the rigid rotation is its transpose
+  LocalCenters<P> c;
+  c.x = P::set(r(0, 0)) * dx + P::set(r(1, 0)) * dy + P::set(r(2, 0)) * dz;
+  c.y = P::set(r(0, 1)) * dx + P::set(r(1, 1)) * dy + P::set(r(2, 1)) * dz;
+  c.z = P::set(r(0, 2)) * dx + P::set(r(1, 2)) * dy + P::set(r(2, 2)) * dz;
+  c.radius = P::load(&spheres.radius[i]);
+  return c;
+}
+
+/** @brief The signed distance of a pack of spheres to a primitive */
+template <typename P>
+P packDistance(const SphereBatch &spheres, std::size_t i, const CollisionPrimitive &primitive)
+{
+  const LocalCenters<P> c = loadLocalCenters<P>(spheres, i, primitive);
+  const P zero = P::set(0.0);
+  switch (primitive.type)
+  {
+    case CollisionPrimitive::SPHERE:
+      return sqrt(c.x * c.x + c.y * c.y + c.z * c.z) - P::set(primitive.radius) - c.radius;
+
+    case CollisionPrimitive::BOX:
+    {
+      P qx = abs(c.x) - P::set(primitive.half_extents.x());
+      P qy = abs(c.y) - P::set(primitive.half_extents.y());
+      P qz = abs(c.z) - P::set(primitive.half_extents.z());
+      P ox = max(qx, zero), oy = max(qy, zero), oz = max(qz, zero);
+      P inside = min(max(qx, max(qy, qz)), zero);
+      return sqrt(ox * ox + oy * oy + oz * oz) + inside - c.radius;
+    }
+
+    case CollisionPrimitive::CYLINDER:
+    {
+      P a = sqrt(c.x * c.x + c.y * c.y) - P::set(primitive.radius);
+      P b = abs(c.z) - P::set(primitive.half_length);
+      P oa = max(a, zero), ob = max(b, zero);
+      P inside = min(max(a, b), zero);
+      return sqrt(oa * oa + ob * ob) + inside - c.radius;
+    }
+
+    case CollisionPrimitive::CAPSULE:
+    {
+      P h = P::set(primitive.half_length);
+      P dz = c.z - min(max(c.z, zero - h), h);
+      return sqrt(c.x * c.x + c.y * c.y + dz * dz) - P::set(primitive.radius) - c.radius;
+    }
+  }
+
+  return zero;
+}
+
+}
+
+namespace collision_detection
+{
+  bool isPrimitiveDistanceVectorized()
+  {
+    return VectorPack::WIDTH > 1;
+  }
+
+  void computeSphereDistances(const SphereBatch &spheres, const CollisionPrimitive &primitive,
+                              std::vector<double> &distances)
+  {
+    const std::size_t n = spheres.size();
+    distances.resize(n);
+
+    std::size_t i = 0;
+    for (; i + VectorPack::WIDTH <= n; i += VectorPack::WIDTH)
+      packDistance<VectorPack>(spheres, i, primitive).store(&distances[i]);
+
+    for (; i < n; ++i)
+      packDistance<ScalarPack>(spheres, i, primitive).store(&distances[i]);
+  }
+
+  PrimitiveDistance computeMinimumDistance(const SphereBatch &spheres, const CollisionPrimitive &primitive,
+                                           std::vector<double> &distances)
+  {
+    PrimitiveDistance result;
+    computeSphereDistances(spheres, primitive, distances);
+    if (distances.empty())
+    {
+      result.distance = std::numeric_limits<double>::max();
+      return result;
+    }
+
+    result.sphere = std::min_element(distances.begin(), distances.end()) - distances.begin();
+    result.distance = distances[result.sphere];
+
+    // the witness points are only computed for the nearest sphere
+    const Eigen::Vector3d center = spheres.center(result.sphere);
+    const Eigen::Vector3d surface = computeClosestSurfacePoint(primitive, center);
+    Eigen::Vector3d direction = surface - center;
+    double norm = direction.norm();
+    if (norm > 0.0)
+    {
+      // a center inside the primitive reaches its surface away from the primitive
+      direction /= norm;
+      if (result.distance + spheres.radius[result.sphere] < 0.0)
+        direction = -direction;
+    }
+
+    result.nearest_points[0] = center + spheres.radius[result.sphere] * direction;
+    result.nearest_points[1] = surface;
+    return result;
+  }
+
+  Eigen::Vector3d computeClosestSurfacePoint(const CollisionPrimitive &primitive, const Eigen::Vector3d &point)
+  {
+    const Eigen::Vector3d p = primitive.pose.inverse(Eigen::Isometry) * point;
+    Eigen::Vector3d q = p;
+    switch (primitive.type)
+    {
+      case CollisionPrimitive::SPHERE:
+      {
+        double norm = p.norm();
+        q = norm > 0.0 ? Eigen::Vector3d(p * (primitive.radius / norm)) : Eigen::Vector3d(primitive.radius, 0.0, 0.0);
+        break;
+      }
+
+      case CollisionPrimitive::BOX:
+      {
+        const Eigen::Vector3d &h = primitive.half_extents;
+        q = p.cwiseMax(-h).cwiseMin(h);
+        if (q == p)
+        {
+          // inside, the nearest face is moved to
+          Eigen::Vector3d depth = h - p.cwiseAbs();
+          int axis;
+          depth.minCoeff(&axis);
+          q(axis) = p(axis) < 0.0 ? -h(axis) : h(axis);
+        }
+        break;
+      }
+
+      case CollisionPrimitive::CYLINDER:
+      {
+        double rho = std::sqrt(p.x() * p.x() + p.y() * p.y());
+        Eigen::Vector2d radial = rho > 0.0 ? Eigen::Vector2d(p.x() / rho, p.y() / rho) : Eigen::Vector2d(1.0, 0.0);
+        double h = primitive.half_length;
+        if (rho <= primitive.radius && std::abs(p.z()) <= h)
+        {
+          // inside, the side or the cap nearest to the point is moved to
+          if (primitive.radius - rho < h - std::abs(p.z()))
+            q << primitive.radius * radial, p.z();
+          else
+            q << p.x(), p.y(), p.z() < 0.0 ? -h : h;
+        }
+        else
+        {
+          q << std::min(rho, primitive.radius) * radial, std::max(-h, std::min(p.z(), h));
+        }
+        break;
+      }
+
+      case CollisionPrimitive::CAPSULE:
+      {
+        Eigen::Vector3d s(0.0, 0.0, std::max(-primitive.half_length, std::min(p.z(), primitive.half_length)));
+        Eigen::Vector3d d = p - s;
+        double norm = d.norm();
+        q = s + (norm > 0.0 ? Eigen::Vector3d(d * (primitive.radius / norm)) : Eigen::Vector3d(primitive.radius, 0.0, 0.0));
+        break;
+      }
+    }
+
+    return primitive.pose * q;
+  }
+
+}
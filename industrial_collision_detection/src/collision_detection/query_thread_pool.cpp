@@ -0,0 +1,125 @@
+/**
+ * @file query_thread_pool.cpp
+ * @brief This contains the threads shared by the queries that split their work over several workers
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @license Software License Agreement (Apache License)\n
+ * \n
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at\n
+ * \n
+ * http://www.apache.org/licenses/LICENSE-2.0\n
+ * \n
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <industrial_collision_detection/collision_detection/query_thread_pool.h>
+
+namespace
+{
+  thread_local bool IN_POOL_JOB = false; /**< Whether the calling thread executes a job of the pool */
+
+  /** @brief Flags the calling thread as executing a job of the pool for its lifetime */
+  struct PoolJobScope
+  {
+    PoolJobScope() { IN_POOL_JOB = true; }
+    ~PoolJobScope() { IN_POOL_JOB = false; }
+  };
+}
+
+namespace collision_detection
+{
+  QueryThreadPool& QueryThreadPool::instance()
+  {
+    static QueryThreadPool pool;
+    return pool;
+  }
+
+  QueryThreadPool::QueryThreadPool() : job_(NULL), num_workers_(0), pending_(0), generation_(0), stop_(false)
+  {
+  }
+
+  QueryThreadPool::~QueryThreadPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    start_.notify_all();
+    for (std::size_t i = 0 ; i < threads_.size() ; ++i)
+      threads_[i].join();
+  }
+
+  void QueryThreadPool::run(std::size_t num_workers, const Job &job)
+  {
+    // a job that starts a query of its own runs it serially, its thread may already hold run_mutex_
+    if (IN_POOL_JOB || num_workers < 2)
+    {
+      job(0);
+      return;
+    }
+
+    std::unique_lock<std::mutex> run_lock(run_mutex_, std::try_to_lock);
+    if (!run_lock.owns_lock())
+    {
+      job(0);
+      return;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      while (threads_.size() + 1 < num_workers)
+        threads_.push_back(std::thread(&QueryThreadPool::work, this, threads_.size() + 1));
+
+      job_ = &job;
+      num_workers_ = num_workers;
+      pending_ = num_workers - 1;
+      ++generation_;
+    }
+    start_.notify_all();
+
+    {
+      PoolJobScope scope;
+      job(0);
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this]() { return pending_ == 0; });
+  }
+
+  void QueryThreadPool::work(std::size_t worker)
+  {
+    std::size_t generation = 0;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true)
+    {
+      start_.wait(lock, [&]() { return stop_ || generation_ != generation; });
+      if (stop_)
+        return;
+
+      generation = generation_;
+      if (worker >= num_workers_)
+        continue;
+
+      const Job *job = job_;
+      lock.unlock();
+      {
+        PoolJobScope scope;
+        (*job)(worker);
+      }
+      lock.lock();
+      if (--pending_ == 0)
+        done_.notify_one();
+    }
+  }
+}
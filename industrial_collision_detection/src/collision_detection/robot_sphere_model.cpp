@@ -0,0 +1,328 @@
+/**
+ * @file robot_sphere_model.cpp
+ * @brief This contains an approximation of the robot collision shapes by sets of spheres
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @license Software License Agreement (Apache License)\n
+ * \n
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at\n
+ * \n
+ * http://www.apache.org/licenses/LICENSE-2.0\n
+ * \n
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <industrial_collision_detection/collision_detection/robot_sphere_model.h>
+#include <industrial_collision_detection/collision_detection/collision_common.h>
+#include <geometric_shapes/mesh_operations.h>
+#include <boost/filesystem.hpp>
+#include <ros/console.h>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+
+namespace
+{
+
+const std::string FILE_HEADER = "robot_sphere_model";   /**< The first token of the sphere files */
+const int FILE_VERSION = 1;                             /**< The version of the sphere file format */
+
+/**
+ * @brief Samples points on the surface of a mesh such that every surface point lies within the spacing of a sample
+ * @param mesh    The mesh
+ * @param spacing The maximum distance in between neighboring samples along the triangle edges
+ * @param points  The sampled points
+ */
+void sampleMeshSurface(const shapes::Mesh &mesh, double spacing, std::vector<Eigen::Vector3d> &points)
+{
+  for (unsigned int v = 0; v < mesh.vertex_count; ++v)
+    points.push_back(Eigen::Vector3d(mesh.vertices[3 * v], mesh.vertices[3 * v + 1], mesh.vertices[3 * v + 2]));
+
+  for (unsigned int t = 0; t < mesh.triangle_count; ++t)
+  {
+    const Eigen::Vector3d a(&mesh.vertices[3 * mesh.triangles[3 * t]]);
+    const Eigen::Vector3d b(&mesh.vertices[3 * mesh.triangles[3 * t + 1]]);
+    const Eigen::Vector3d c(&mesh.vertices[3 * mesh.triangles[3 * t + 2]]);
+    const double longest_edge = std::max((b - a).norm(), std::max((c - a).norm(), (c - b).norm()));
+    const int n = std::max(1, static_cast<int>(std::ceil(longest_edge / spacing)));
+    if (n == 1)
+      continue; // the vertices are already in
+
+    for (int i = 0; i <= n; ++i)
+      for (int j = 0; j <= n - i; ++j)
+        points.push_back(a + (b - a) * (static_cast<double>(i) / n) + (c - a) * (static_cast<double>(j) / n));
+  }
+}
+
+/** @brief A set of surface points bounded by one sphere */
+struct PointCluster
+{
+  std::vector<int> indices;         /**< The indices of the points */
+  Eigen::Vector3d min, max;         /**< The bounds of the points */
+  Eigen::Vector3d center;           /**< The center of the bounds */
+  double radius;                    /**< The distance to the farthest point from the center */
+  bool splittable;                  /**< False once a split left one of the halves empty */
+};
+
+/**
+ * @brief Computes the bounds and the bounding sphere of a cluster
+ * @param points  All the points
+ * @param cluster The cluster
+ */
+void boundCluster(const std::vector<Eigen::Vector3d> &points, PointCluster &cluster)
+{
+  cluster.min.setConstant(std::numeric_limits<double>::max());
+  cluster.max.setConstant(-std::numeric_limits<double>::max());
+  for (int i : cluster.indices)
+  {
+    cluster.min = cluster.min.cwiseMin(points[i]);
+    cluster.max = cluster.max.cwiseMax(points[i]);
+  }
+
+  cluster.center = 0.5 * (cluster.min + cluster.max);
+  cluster.radius = 0.0;
+  for (int i : cluster.indices)
+    cluster.radius = std::max(cluster.radius, (points[i] - cluster.center).norm());
+}
+
+}
+
+namespace collision_detection
+{
+  RobotSphereModel::RobotSphereModel(const robot_model::RobotModelConstPtr &model, const Parameters &params) :
+    RobotSphereModel(model, params, true)
+  {
+  }
+
+  RobotSphereModel::RobotSphereModel(const robot_model::RobotModelConstPtr &model, const Parameters &params, bool generate_spheres) :
+    model_(model),
+    params_(params),
+    body_spheres_(model->getLinkGeometryCount()),
+    body_signatures_(model->getLinkGeometryCount(), 0)
+  {
+    for (const robot_model::LinkModel *link : model_->getLinkModelsWithCollisionGeometry())
+      for (std::size_t s = 0; s < link->getShapes().size(); ++s)
+        body_signatures_[link->getFirstCollisionBodyTransformIndex() + s] = collision_detection::computeShapeSignature(*link->getShapes()[s]);
+
+    if (generate_spheres)
+      generate();
+  }
+
+  void RobotSphereModel::generate()
+  {
+    for (const robot_model::LinkModel *link : model_->getLinkModelsWithCollisionGeometry())
+      for (std::size_t s = 0; s < link->getShapes().size(); ++s)
+      {
+        CollisionSpheres &spheres = body_spheres_[link->getFirstCollisionBodyTransformIndex() + s];
+        spheres.clear();
+        decomposeShape(*link->getShapes()[s], params_, spheres);
+      }
+  }
+
+  RobotSphereModelPtr RobotSphereModel::create(const robot_model::RobotModelConstPtr &model, const Parameters &params,
+                                               const std::string &cache_directory)
+  {
+    RobotSphereModelPtr sphere_model(new RobotSphereModel(model, params, false));
+    if (cache_directory.empty())
+    {
+      sphere_model->generate();
+      return sphere_model;
+    }
+
+    const std::string path = cache_directory + "/" + model->getName() + ".spheres";
+    if (sphere_model->load(path))
+      return sphere_model;
+
+    ROS_INFO("Generating the sphere model of robot '%s', it is cached in '%s'", model->getName().c_str(), path.c_str());
+    sphere_model->generate();
+    sphere_model->save(path);
+    return sphere_model;
+  }
+
+  std::string RobotSphereModel::getDefaultCacheDirectory()
+  {
+    const char *ros_home = std::getenv("ROS_HOME");
+    if (ros_home)
+      return std::string(ros_home) + "/sphere_models";
+
+    const char *home = std::getenv("HOME");
+    if (home)
+      return std::string(home) + "/.ros/sphere_models";
+
+    return std::string();
+  }
+
+  void RobotSphereModel::decomposeShape(const shapes::Shape &shape, const Parameters &params, CollisionSpheres &spheres)
+  {
+    std::unique_ptr<shapes::Mesh> primitive_mesh;
+    const shapes::Mesh *mesh = NULL;
+    switch (shape.type)
+    {
+      case shapes::SPHERE:
+      {
+        CollisionSphere sphere;
+        sphere.center.setZero();
+        sphere.radius = static_cast<const shapes::Sphere&>(shape).radius;
+        spheres.push_back(sphere);
+        return;
+      }
+      case shapes::BOX:
+      case shapes::CYLINDER:
+      case shapes::CONE:
+        primitive_mesh.reset(shapes::createMeshFromShape(&shape));
+        mesh = primitive_mesh.get();
+        break;
+      case shapes::MESH:
+        mesh = static_cast<const shapes::Mesh*>(&shape);
+        break;
+      default:
+        return;
+    }
+
+    if (!mesh || mesh->vertex_count == 0)
+      return;
+
+    std::vector<Eigen::Vector3d> points;
+    sampleMeshSurface(*mesh, params.sample_spacing, points);
+
+    std::vector<PointCluster> clusters(1);
+    clusters[0].indices.resize(points.size());
+    for (std::size_t i = 0; i < points.size(); ++i)
+      clusters[0].indices[i] = i;
+    clusters[0].splittable = true;
+    boundCluster(points, clusters[0]);
+
+    // the largest sphere is split in halves along the longest side of its bounds until all are small enough
+    while (static_cast<int>(clusters.size()) < params.max_spheres_per_shape)
+    {
+      int largest = -1;
+      for (std::size_t c = 0; c < clusters.size(); ++c)
+        if (clusters[c].splittable && clusters[c].radius > params.max_radius &&
+            (largest < 0 || clusters[c].radius > clusters[largest].radius))
+          largest = c;
+
+      if (largest < 0)
+        break;
+
+      int axis;
+      (clusters[largest].max - clusters[largest].min).maxCoeff(&axis);
+      const double split = clusters[largest].center(axis);
+
+      PointCluster upper;
+      std::vector<int> lower_indices;
+      for (int i : clusters[largest].indices)
+      {
+        if (points[i](axis) > split)
+          upper.indices.push_back(i);
+        else
+          lower_indices.push_back(i);
+      }
+
+      if (upper.indices.empty() || lower_indices.empty())
+      {
+        clusters[largest].splittable = false;
+        continue;
+      }
+
+      clusters[largest].indices.swap(lower_indices);
+      boundCluster(points, clusters[largest]);
+      upper.splittable = true;
+      boundCluster(points, upper);
+      clusters.push_back(upper);
+    }
+
+    // every surface point lies within the sample spacing of a sample
+    for (const PointCluster &cluster : clusters)
+    {
+      CollisionSphere sphere;
+      sphere.center = cluster.center;
+      sphere.radius = cluster.radius + params.sample_spacing;
+      spheres.push_back(sphere);
+    }
+  }
+
+  bool RobotSphereModel::save(const std::string &path) const
+  {
+    boost::system::error_code ec;
+    boost::filesystem::create_directories(boost::filesystem::path(path).parent_path(), ec);
+
+    std::ofstream file(path.c_str());
+    if (!file)
+    {
+      ROS_ERROR("Unable to write the sphere model file '%s'", path.c_str());
+      return false;
+    }
+
+    file << std::setprecision(std::numeric_limits<double>::max_digits10);
+    file << FILE_HEADER << " " << FILE_VERSION << "\n";
+    file << model_->getName() << "\n";
+    file << params_.max_radius << " " << params_.sample_spacing << " " << params_.max_spheres_per_shape << "\n";
+    file << body_spheres_.size() << "\n";
+    for (std::size_t b = 0; b < body_spheres_.size(); ++b)
+    {
+      file << body_signatures_[b] << " " << body_spheres_[b].size() << "\n";
+      for (const CollisionSphere &sphere : body_spheres_[b])
+        file << sphere.center.x() << " " << sphere.center.y() << " " << sphere.center.z() << " " << sphere.radius << "\n";
+    }
+
+    return static_cast<bool>(file);
+  }
+
+  bool RobotSphereModel::load(const std::string &path)
+  {
+    std::ifstream file(path.c_str());
+    if (!file)
+      return false;
+
+    std::string header, robot_name;
+    int version;
+    Parameters params;
+    std::size_t num_bodies;
+    file >> header >> version >> robot_name >> params.max_radius >> params.sample_spacing >> params.max_spheres_per_shape >> num_bodies;
+    if (!file || header != FILE_HEADER || version != FILE_VERSION || robot_name != model_->getName() ||
+        !(params == params_) || num_bodies != body_spheres_.size())
+    {
+      ROS_WARN("The sphere model file '%s' does not match the robot or the parameters", path.c_str());
+      return false;
+    }
+
+    std::vector<CollisionSpheres> body_spheres(num_bodies);
+    for (std::size_t b = 0; b < num_bodies; ++b)
+    {
+      std::uint64_t signature;
+      std::size_t num_spheres;
+      file >> signature >> num_spheres;
+      if (!file || signature != body_signatures_[b])
+      {
+        ROS_WARN("The sphere model file '%s' was generated from different collision shapes", path.c_str());
+        return false;
+      }
+
+      body_spheres[b].resize(num_spheres);
+      for (CollisionSphere &sphere : body_spheres[b])
+        file >> sphere.center.x() >> sphere.center.y() >> sphere.center.z() >> sphere.radius;
+    }
+
+    if (!file)
+    {
+      ROS_WARN("The sphere model file '%s' is truncated", path.c_str());
+      return false;
+    }
+
+    body_spheres_.swap(body_spheres);
+    return true;
+  }
+}
@@ -0,0 +1,178 @@
+/**
+ * @file temporal_distance_cache.cpp
+ * @brief This contains a cache that skips the distance queries of links that can not have come close to an obstacle
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @license Software License Agreement (Apache License)\n
+ * \n
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at\n
+ * \n
+ * http://www.apache.org/licenses/LICENSE-2.0\n
+ * \n
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <industrial_collision_detection/collision_detection/temporal_distance_cache.h>
+#include <geometric_shapes/shape_operations.h>
+#include <algorithm>
+#include <cmath>
+
+namespace collision_detection
+{
+  TemporalDistanceCache::TemporalDistanceCache(double margin) :
+    margin_(margin),
+    threshold_(0.0),
+    active_links_(NULL),
+    robot_model_(NULL),
+    has_last_transforms_(false),
+    total_motion_(0.0),
+    num_evaluated_links_(0)
+  {
+  }
+
+  void TemporalDistanceCache::clear()
+  {
+    links_.clear();
+    active_links_ = NULL;
+    robot_model_ = NULL;
+    has_last_transforms_ = false;
+    total_motion_ = 0.0;
+  }
+
+  double TemporalDistanceCache::motionBound(const Eigen::Affine3d &from, const Eigen::Affine3d &to, double radius)
+  {
+    // a point at distance r from the frame origin moves by at most the translation plus the rotation angle times r
+    const double angle = Eigen::AngleAxisd(from.linear().transpose() * to.linear()).angle();
+    return (to.translation() - from.translation()).norm() + std::abs(angle) * radius;
+  }
+
+  double TemporalDistanceCache::linkRadius(const CollisionRobotIndustrial &robot, const robot_state::RobotState &state,
+                                           const robot_model::LinkModel *link)
+  {
+    double radius = 0.0;
+    Eigen::Vector3d center;
+    double shape_radius;
+
+    const double scale = robot.getLinkScale(link->getName());
+    const double padding = robot.getLinkPadding(link->getName());
+    const EigenSTL::vector_Affine3d &origins = link->getCollisionOriginTransforms();
+    for (std::size_t i = 0; i < link->getShapes().size(); ++i)
+    {
+      shapes::computeShapeBoundingSphere(link->getShapes()[i].get(), center, shape_radius);
+      radius = std::max(radius, (origins[i] * center).norm() + shape_radius * scale + padding);
+    }
+
+    std::vector<const robot_state::AttachedBody*> bodies;
+    state.getAttachedBodies(bodies);
+    for (std::size_t b = 0; b < bodies.size(); ++b)
+    {
+      if (bodies[b]->getAttachedLink() != link)
+        continue;
+
+      const EigenSTL::vector_Affine3d &fixed = bodies[b]->getFixedTransforms();
+      for (std::size_t i = 0; i < bodies[b]->getShapes().size(); ++i)
+      {
+        shapes::computeShapeBoundingSphere(bodies[b]->getShapes()[i].get(), center, shape_radius);
+        radius = std::max(radius, (fixed[i] * center).norm() + shape_radius);
+      }
+    }
+
+    return radius;
+  }
+
+  void TemporalDistanceCache::distance(const DistanceRequest &req, DistanceResult &res, const CollisionRobotIndustrial &robot,
+                                       const CollisionWorldIndustrial &world, const robot_state::RobotState &state)
+  {
+    if (req.global || !req.active_components_only)
+    {
+      robot.distanceSelf(req, res, state);
+      world.distanceRobot(req, res, robot, state);
+      num_evaluated_links_ = 0;
+      return;
+    }
+
+    const robot_model::RobotModel *model = state.getRobotModel().get();
+    if (req.active_components_only != active_links_ || req.distance_threshold != threshold_ || model != robot_model_)
+    {
+      clear();
+      active_links_ = req.active_components_only;
+      threshold_ = req.distance_threshold;
+      robot_model_ = model;
+    }
+    links_.resize(model->getLinkModelCount());
+
+    // the largest motion of any link since the previous query bounds the motion of the other side of the self pairs
+    const std::vector<const robot_model::LinkModel*> &links = model->getLinkModelsWithCollisionGeometry();
+    double max_motion = 0.0;
+    for (std::size_t i = 0; i < links.size(); ++i)
+    {
+      LinkBound &bound = links_[links[i]->getLinkIndex()];
+      if (bound.radius < 0.0)
+        bound.radius = linkRadius(robot, state, links[i]);
+
+      const Eigen::Affine3d &transform = state.getGlobalLinkTransform(links[i]);
+      if (has_last_transforms_)
+        max_motion = std::max(max_motion, motionBound(bound.last_transform, transform, bound.radius));
+      bound.last_transform = transform;
+    }
+    total_motion_ += max_motion;
+    has_last_transforms_ = true;
+
+    // the links that may have come within the threshold since their evaluation are evaluated again
+    evaluated_links_.clear();
+    evaluated_mask_.assign(model->getLinkModelCount(), false);
+    for (std::set<const robot_model::LinkModel*>::const_iterator it = active_links_->begin(); it != active_links_->end(); ++it)
+    {
+      LinkBound &bound = links_[(*it)->getLinkIndex()];
+      if (bound.radius < 0.0)
+        bound.radius = linkRadius(robot, state, *it);
+
+      if (!bound.evaluated ||
+          bound.lower_bound - motionBound(bound.transform, state.getGlobalLinkTransform(*it), bound.radius) -
+          (total_motion_ - bound.motion_at_evaluation) < threshold_)
+      {
+        evaluated_links_.insert(*it);
+        evaluated_mask_[(*it)->getLinkIndex()] = true;
+      }
+    }
+    num_evaluated_links_ = evaluated_links_.size();
+    if (evaluated_links_.empty())
+    {
+      res.resize(model->getLinkModelCount());
+      return;
+    }
+
+    DistanceRequest evaluation_req = req;
+    evaluation_req.setActiveComponents(&evaluated_links_, &evaluated_mask_);
+    evaluation_req.distance_threshold = threshold_ + margin_;
+    robot.distanceSelf(evaluation_req, res, state);
+    world.distanceRobot(evaluation_req, res, robot, state);
+
+    // remember the bounds and only report the links within the requested threshold
+    for (std::set<const robot_model::LinkModel*>::const_iterator it = evaluated_links_.begin(); it != evaluated_links_.end(); ++it)
+    {
+      LinkBound &bound = links_[(*it)->getLinkIndex()];
+      DistanceResultsData &entry = res.distance[(*it)->getLinkIndex()];
+      bound.evaluated = true;
+      bound.transform = state.getGlobalLinkTransform(*it);
+      bound.lower_bound = std::min(entry.min_distance, evaluation_req.distance_threshold);
+      bound.motion_at_evaluation = total_motion_;
+      if (entry.min_distance >= threshold_)
+        entry.clear();
+    }
+
+    if (res.minimum_distance.min_distance >= threshold_)
+      res.minimum_distance.clear();
+  }
+}
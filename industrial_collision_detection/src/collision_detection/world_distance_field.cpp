@@ -0,0 +1,117 @@
+/**
+ * @file world_distance_field.cpp
+ * @brief This contains a signed distance field of the static objects in a collision world
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @license Software License Agreement (Apache License)\n
+ * \n
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at\n
+ * \n
+ * http://www.apache.org/licenses/LICENSE-2.0\n
+ * \n
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <industrial_collision_detection/collision_detection/world_distance_field.h>
+#include <algorithm>
+#include <cmath>
+
+namespace collision_detection
+{
+  WorldDistanceField::WorldDistanceField(const Parameters &params) :
+    params_(params),
+    field_(params.size_x, params.size_y, params.size_z, params.resolution,
+           params.origin_x, params.origin_y, params.origin_z, params.max_distance, true)
+  {
+  }
+
+  void WorldDistanceField::updateObject(const World::ObjectConstPtr &obj)
+  {
+    removeObject(obj->id_);
+
+    for (std::size_t i = 0; i < obj->shapes_.size(); ++i)
+      field_.addShapeToField(obj->shapes_[i].get(), obj->shape_poses_[i]);
+
+    objects_[obj->id_] = obj;
+  }
+
+  void WorldDistanceField::removeObject(const std::string &id)
+  {
+    std::map<std::string, World::ObjectConstPtr>::iterator it = objects_.find(id);
+    if (it == objects_.end())
+      return;
+
+    // the object kept is the one whose shapes were added, the world replaces objects instead of modifying them
+    const World::Object &obj = *it->second;
+    for (std::size_t i = 0; i < obj.shapes_.size(); ++i)
+      field_.removeShapeFromField(obj.shapes_[i].get(), obj.shape_poses_[i]);
+
+    objects_.erase(it);
+  }
+
+  void WorldDistanceField::clear()
+  {
+    field_.reset();
+    objects_.clear();
+  }
+
+  bool WorldDistanceField::getDistanceGradient(const Eigen::Vector3d &point, double &distance, Eigen::Vector3d &gradient) const
+  {
+    int cell[3];
+    if (!field_.worldToGrid(point.x(), point.y(), point.z(), cell[0], cell[1], cell[2]) ||
+        !field_.isCellValid(cell[0], cell[1], cell[2]))
+    {
+      distance = params_.max_distance;
+      gradient.setZero();
+      return false;
+    }
+
+    // the voxel centers surrounding the point and the fractional position of the point in between them
+    const double resolution = field_.getResolution();
+    const double origin[3] = {field_.getOriginX(), field_.getOriginY(), field_.getOriginZ()};
+    const int num_cells[3] = {field_.getXNumCells(), field_.getYNumCells(), field_.getZNumCells()};
+    int low[3], high[3];
+    double frac[3];
+    for (int k = 0; k < 3; ++k)
+    {
+      const double g = (point(k) - origin[k]) / resolution;
+      low[k] = static_cast<int>(std::floor(g));
+      frac[k] = g - low[k];
+      high[k] = std::min(low[k] + 1, num_cells[k] - 1);
+      low[k] = std::max(low[k], 0);
+    }
+
+    // trilinear interpolation, the gradient is the derivative of the interpolant
+    distance = 0.0;
+    gradient.setZero();
+    for (int c = 0; c < 8; ++c)
+    {
+      const bool upper[3] = {(c & 1) != 0, (c & 2) != 0, (c & 4) != 0};
+      double weights[3];
+      for (int k = 0; k < 3; ++k)
+        weights[k] = upper[k] ? frac[k] : 1.0 - frac[k];
+
+      const double value = field_.getDistance(upper[0] ? high[0] : low[0],
+                                              upper[1] ? high[1] : low[1],
+                                              upper[2] ? high[2] : low[2]);
+      distance += value * weights[0] * weights[1] * weights[2];
+      gradient(0) += (upper[0] ? value : -value) * weights[1] * weights[2];
+      gradient(1) += (upper[1] ? value : -value) * weights[0] * weights[2];
+      gradient(2) += (upper[2] ? value : -value) * weights[0] * weights[1];
+    }
+    gradient /= resolution;
+
+    return true;
+  }
+}
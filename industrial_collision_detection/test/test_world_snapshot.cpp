@@ -0,0 +1,176 @@
+/**
+ * @file test_world_snapshot.cpp
+ * @brief This tests the concurrent queries of world snapshots while the source world is edited
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @license Software License Agreement (Apache License)\n
+ * \n
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at\n
+ * \n
+ * http://www.apache.org/licenses/LICENSE-2.0\n
+ * \n
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <gtest/gtest.h>
+#include <industrial_collision_detection/collision_detection/collision_world_industrial.h>
+#include <industrial_collision_detection/collision_detection/collision_robot_industrial.h>
+#include <moveit/robot_model/robot_model.h>
+#include <moveit/robot_state/robot_state.h>
+#include <geometric_shapes/shapes.h>
+#include <urdf_parser/urdf_parser.h>
+#include <srdfdom/model.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace collision_detection;
+
+namespace
+{
+
+/** @brief A two link arm made of boxes, the robot spans about a cube of 0.4 m around the origin */
+const std::string URDF =
+    "<?xml version=\"1.0\"?>"
+    "<robot name=\"arm\">"
+    "  <link name=\"base_link\">"
+    "    <collision><geometry><box size=\"0.2 0.2 0.2\"/></geometry></collision>"
+    "  </link>"
+    "  <link name=\"link_1\">"
+    "    <collision><origin xyz=\"0 0 0.1\"/><geometry><box size=\"0.1 0.1 0.2\"/></geometry></collision>"
+    "  </link>"
+    "  <joint name=\"joint_1\" type=\"revolute\">"
+    "    <parent link=\"base_link\"/><child link=\"link_1\"/><origin xyz=\"0 0 0.1\"/><axis xyz=\"0 0 1\"/>"
+    "    <limit lower=\"-3.14\" upper=\"3.14\" effort=\"1\" velocity=\"1\"/>"
+    "  </joint>"
+    "</robot>";
+
+const std::string SRDF =
+    "<?xml version=\"1.0\"?>"
+    "<robot name=\"arm\">"
+    "  <group name=\"manipulator\"><chain base_link=\"base_link\" tip_link=\"link_1\"/></group>"
+    "  <disable_collisions link1=\"base_link\" link2=\"link_1\" reason=\"Adjacent\"/>"
+    "</robot>";
+
+const int NUM_EDITS = 200;  /**< The number of edits of the source world */
+const int NUM_READERS = 4;  /**< The number of threads querying the snapshots */
+
+/** @brief A snapshot and whether the robot collides with it */
+struct PublishedSnapshot
+{
+  CollisionWorldIndustrialConstPtr world;
+  bool collision;
+};
+
+robot_model::RobotModelConstPtr loadRobotModel()
+{
+  urdf::ModelInterfaceSharedPtr urdf_model = urdf::parseURDF(URDF);
+  if (!urdf_model)
+    return robot_model::RobotModelConstPtr();
+
+  srdf::ModelSharedPtr srdf_model(new srdf::Model());
+  if (!srdf_model->initString(*urdf_model, SRDF))
+    return robot_model::RobotModelConstPtr();
+
+  return robot_model::RobotModelConstPtr(new robot_model::RobotModel(urdf_model, srdf_model));
+}
+
+}
+
+/**
+ * @brief Several threads query the latest snapshot while the source world is edited and publishes a new snapshot after
+ * each edit.  Every snapshot must report the world as it was when it was created.
+ */
+TEST(CollisionWorldIndustrial, concurrent_snapshot_queries)
+{
+  robot_model::RobotModelConstPtr model = loadRobotModel();
+  ASSERT_TRUE(bool(model));
+
+  robot_state::RobotState state(model);
+  state.setToDefaultValues();
+  state.update();
+
+  CollisionRobotIndustrial robot(model);
+  WorldPtr world(new World());
+  CollisionWorldIndustrial source(world);
+
+  // a box far from the robot is moved by every edit, a box at the robot is added and removed by every other edit
+  const Eigen::Affine3d far_pose(Eigen::Translation3d(2.0, 0.0, 0.0));
+  world->addToObject("far", shapes::ShapeConstPtr(new shapes::Box(0.5, 0.5, 0.5)), far_pose);
+
+  std::mutex published_mutex;
+  PublishedSnapshot published = {source.createSnapshot(), false};
+
+  std::atomic<bool> editing(true);
+  std::atomic<int> queries(0), mismatches(0);
+  std::vector<std::thread> readers;
+  for (int r = 0; r < NUM_READERS; ++r)
+    readers.push_back(std::thread([&]()
+    {
+      CollisionRequest req;
+      while (editing || queries == 0)
+      {
+        PublishedSnapshot snapshot;
+        {
+          std::lock_guard<std::mutex> lock(published_mutex);
+          snapshot = published;
+        }
+
+        CollisionResult res;
+        snapshot.world->checkRobotCollision(req, res, robot, state);
+        double distance = snapshot.world->distanceRobot(robot, state);
+        if (res.collision != snapshot.collision || (!snapshot.collision && distance <= 0.0))
+          ++mismatches;
+
+        ++queries;
+      }
+    }));
+
+  bool collision = false;
+  for (int i = 0; i < NUM_EDITS; ++i)
+  {
+    const Eigen::Affine3d pose(Eigen::Translation3d(2.0, 0.001 * i, 0.0));
+    world->moveShapeInObject("far", world->getObject("far")->shapes_[0], pose);
+
+    collision = !collision;
+    if (collision)
+      world->addToObject("near", shapes::ShapeConstPtr(new shapes::Box(0.1, 0.1, 0.1)), Eigen::Affine3d::Identity());
+    else
+      world->removeObject("near");
+
+    PublishedSnapshot snapshot = {source.createSnapshot(), collision};
+    std::lock_guard<std::mutex> lock(published_mutex);
+    published = snapshot;
+  }
+
+  editing = false;
+  for (std::size_t r = 0; r < readers.size(); ++r)
+    readers[r].join();
+
+  EXPECT_GT(queries, 0);
+  EXPECT_EQ(mismatches, 0);
+
+  // the source world reflects every edit
+  CollisionRequest req;
+  CollisionResult res;
+  source.checkRobotCollision(req, res, robot, state);
+  EXPECT_EQ(res.collision, collision);
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
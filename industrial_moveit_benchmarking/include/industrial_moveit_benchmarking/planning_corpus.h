@@ -0,0 +1,134 @@
+/**
+ * @file planning_corpus.h
+ * @brief This contains the parsing of the planning problem files shared by the stomp benchmarking tools
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @license Software License Agreement (Apache License)\n
+ * \n
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at\n
+ * \n
+ * http://www.apache.org/licenses/LICENSE-2.0\n
+ * \n
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef INDUSTRIAL_MOVEIT_BENCHMARKING_PLANNING_CORPUS_H
+#define INDUSTRIAL_MOVEIT_BENCHMARKING_PLANNING_CORPUS_H
+
+#include <moveit/collision_plugin_loader/collision_plugin_loader.h>
+#include <moveit/planning_interface/planning_interface.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <XmlRpcValue.h>
+#include <yaml-cpp/yaml.h>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace industrial_moveit_benchmarking
+{
+
+/** @brief A box added to the planning scene world */
+struct Obstacle
+{
+  std::string name;
+  Eigen::Vector3d size;
+  Eigen::Affine3d pose;
+};
+
+/** @brief A single planning problem of the corpus */
+struct Problem
+{
+  std::string name;
+  std::string category;
+  std::string group_name;
+  std::map<std::string, double> start;
+  std::map<std::string, double> goal;
+  std::vector<Obstacle> obstacles;
+  double allowed_planning_time;
+};
+
+/**
+ * @brief Resolves a path of the form package://<package>/<relative path>, other paths are returned unchanged
+ * @param path The path
+ * @return The absolute path or an empty string if the package was not found
+ */
+std::string resolvePath(const std::string& path);
+
+/**
+ * @brief Reads the whole content of a file
+ * @param path    The path, it may be relative to a package
+ * @param content The content
+ * @return False if the file could not be read
+ */
+bool readFile(const std::string& path, std::string& content);
+
+/**
+ * @brief Converts a yaml node into the XmlRpc representation that would have been loaded onto the parameter server, so
+ * that the planner can be configured without a ros master.
+ * @param node  The yaml node
+ * @return The XmlRpc value
+ */
+XmlRpc::XmlRpcValue toXmlRpc(const YAML::Node& node);
+
+/**
+ * @brief Parses the problems of the corpus
+ * @param node          The 'problems' sequence
+ * @param planning_time The planning time used when a problem does not specify it
+ * @param problems      The problems
+ * @return False if a problem is malformed
+ */
+bool parseProblems(const YAML::Node& node, double planning_time, std::vector<Problem>& problems);
+
+/**
+ * @brief Parses the named joint configurations of a cell and adds a problem for every ordered pair of them, the
+ * problem from 'a' to 'b' is named 'a_to_b'.
+ * @param node          The 'stations' map of a group name to a map of station names to joint values
+ * @param planning_time The planning time of the problems
+ * @param problems      The problems
+ * @return False if a station is malformed
+ */
+bool parseStations(const YAML::Node& node, double planning_time, std::vector<Problem>& problems);
+
+/**
+ * @brief Loads the robot model of the 'urdf' and 'srdf' files of the corpus
+ * @param corpus  The corpus
+ * @return The robot model, null on failure
+ */
+robot_model::RobotModelPtr loadRobotModel(const YAML::Node& corpus);
+
+/**
+ * @brief Creates the planning scene of a problem
+ * @param robot_model         The robot model
+ * @param collision_detector  The collision detector to activate, the default one if empty
+ * @param cd_loader           The collision plugin loader
+ * @param problem             The problem whose obstacles are added to the world
+ * @return The planning scene, null if the collision detector could not be activated
+ */
+planning_scene::PlanningScenePtr createPlanningScene(const robot_model::RobotModelConstPtr& robot_model,
+                                                     const std::string& collision_detector,
+                                                     collision_detection::CollisionPluginLoader& cd_loader,
+                                                     const Problem& problem);
+
+/**
+ * @brief Creates the motion plan request of a problem, a single attempt to the joint goal
+ * @param planning_scene  The planning scene of the problem
+ * @param problem         The problem
+ * @param req             The request
+ */
+void createMotionPlanRequest(const planning_scene::PlanningSceneConstPtr& planning_scene, const Problem& problem,
+                             planning_interface::MotionPlanRequest& req);
+
+}
+
+#endif // INDUSTRIAL_MOVEIT_BENCHMARKING_PLANNING_CORPUS_H
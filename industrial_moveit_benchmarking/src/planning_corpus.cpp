@@ -0,0 +1,302 @@
+/**
+ * @file planning_corpus.cpp
+ * @brief This contains the parsing of the planning problem files shared by the stomp benchmarking tools
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @license Software License Agreement (Apache License)\n
+ * \n
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at\n
+ * \n
+ * http://www.apache.org/licenses/LICENSE-2.0\n
+ * \n
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <industrial_moveit_benchmarking/planning_corpus.h>
+#include <ros/package.h>
+#include <ros/console.h>
+#include <moveit/robot_model_loader/robot_model_loader.h>
+#include <moveit/robot_state/conversions.h>
+#include <moveit/kinematic_constraints/utils.h>
+#include <geometric_shapes/shapes.h>
+#include <fstream>
+
+using namespace std;
+
+namespace
+{
+
+const string PACKAGE_URL = "package://";   /**< The prefix of the paths resolved relative to a package */
+
+/**
+ * @brief Parses the joint values of a problem
+ * @param node    A map of joint names to positions
+ * @param joints  The joint positions
+ */
+void parseJoints(const YAML::Node& node, map<string, double>& joints)
+{
+  for(YAML::const_iterator it = node.begin(); it != node.end(); ++it)
+  {
+    joints[it->first.as<string>()] = it->second.as<double>();
+  }
+}
+
+}
+
+namespace industrial_moveit_benchmarking
+{
+
+string resolvePath(const string& path)
+{
+  if(path.compare(0, PACKAGE_URL.size(), PACKAGE_URL) != 0)
+  {
+    return path;
+  }
+
+  string package_path = path.substr(PACKAGE_URL.size());
+  size_t pos = package_path.find('/');
+  string package_dir = ros::package::getPath(package_path.substr(0, pos));
+  if(package_dir.empty())
+  {
+    return package_dir;
+  }
+
+  return pos == string::npos ? package_dir : package_dir + package_path.substr(pos);
+}
+
+bool readFile(const string& path, string& content)
+{
+  string file_path = resolvePath(path);
+  ifstream ifs(file_path.c_str());
+  if(!ifs)
+  {
+    ROS_ERROR("Unable to read the file '%s'", path.c_str());
+    return false;
+  }
+
+  content.assign((istreambuf_iterator<char>(ifs)), istreambuf_iterator<char>());
+  return true;
+}
+
+XmlRpc::XmlRpcValue toXmlRpc(const YAML::Node& node)
+{
+  XmlRpc::XmlRpcValue value;
+  switch(node.Type())
+  {
+    case YAML::NodeType::Map:
+      for(YAML::const_iterator it = node.begin(); it != node.end(); ++it)
+      {
+        value[it->first.as<string>()] = toXmlRpc(it->second);
+      }
+      break;
+
+    case YAML::NodeType::Sequence:
+      value.setSize(node.size());
+      for(size_t i = 0; i < node.size(); i++)
+      {
+        value[i] = toXmlRpc(node[i]);
+      }
+      break;
+
+    case YAML::NodeType::Scalar:
+    {
+      // quoted scalars are always strings
+      if(node.Tag() == "!")
+      {
+        value = node.as<string>();
+        break;
+      }
+
+      int i;
+      double d;
+      bool b;
+      if(YAML::convert<int>::decode(node, i))
+      {
+        value = i;
+      }
+      else if(YAML::convert<double>::decode(node, d))
+      {
+        value = d;
+      }
+      else if(YAML::convert<bool>::decode(node, b))
+      {
+        value = b;
+      }
+      else
+      {
+        value = node.as<string>();
+      }
+      break;
+    }
+
+    default:
+      break;
+  }
+
+  return value;
+}
+
+bool parseProblems(const YAML::Node& node, double planning_time, vector<Problem>& problems)
+{
+  try
+  {
+    for(size_t i = 0; i < node.size(); i++)
+    {
+      const YAML::Node& p = node[i];
+      Problem problem;
+      problem.name = p["name"].as<string>();
+      problem.category = p["category"] ? p["category"].as<string>() : string("uncategorized");
+      problem.group_name = p["group_name"].as<string>();
+      problem.allowed_planning_time = p["allowed_planning_time"] ? p["allowed_planning_time"].as<double>() : planning_time;
+      parseJoints(p["start"], problem.start);
+      parseJoints(p["goal"], problem.goal);
+
+      const YAML::Node& obstacles = p["obstacles"];
+      for(size_t j = 0; obstacles && j < obstacles.size(); j++)
+      {
+        const YAML::Node& o = obstacles[j];
+        vector<double> size = o["size"].as<vector<double> >();
+        vector<double> position = o["position"].as<vector<double> >();
+        vector<double> orientation = o["orientation"] ? o["orientation"].as<vector<double> >() : vector<double>({0, 0, 0, 1});
+        if(size.size() != 3 || position.size() != 3 || orientation.size() != 4)
+        {
+          ROS_ERROR("The obstacle %lu of problem '%s' requires a 3 element 'size', a 3 element 'position' and a 4 "
+              "element 'orientation' quaternion [x, y, z, w]", j, problem.name.c_str());
+          return false;
+        }
+
+        Obstacle obstacle;
+        obstacle.name = o["name"] ? o["name"].as<string>() : problem.name + "_obstacle_" + to_string(j);
+        obstacle.size = Eigen::Vector3d(size[0], size[1], size[2]);
+        obstacle.pose = Eigen::Translation3d(position[0], position[1], position[2]) *
+            Eigen::Quaterniond(orientation[3], orientation[0], orientation[1], orientation[2]).normalized();
+        problem.obstacles.push_back(obstacle);
+      }
+
+      problems.push_back(problem);
+    }
+  }
+  catch(YAML::Exception& e)
+  {
+    ROS_ERROR("Unable to parse the benchmark problems: %s", e.what());
+    return false;
+  }
+
+  return true;
+}
+
+bool parseStations(const YAML::Node& node, double planning_time, vector<Problem>& problems)
+{
+  try
+  {
+    for(YAML::const_iterator group = node.begin(); group != node.end(); ++group)
+    {
+      vector<pair<string, map<string, double> > > stations;
+      for(YAML::const_iterator s = group->second.begin(); s != group->second.end(); ++s)
+      {
+        stations.push_back(make_pair(s->first.as<string>(), map<string, double>()));
+        parseJoints(s->second, stations.back().second);
+      }
+
+      for(size_t i = 0; i < stations.size(); i++)
+      {
+        for(size_t j = 0; j < stations.size(); j++)
+        {
+          if(i == j)
+          {
+            continue;
+          }
+
+          Problem problem;
+          problem.name = stations[i].first + "_to_" + stations[j].first;
+          problem.category = "stations";
+          problem.group_name = group->first.as<string>();
+          problem.allowed_planning_time = planning_time;
+          problem.start = stations[i].second;
+          problem.goal = stations[j].second;
+          problems.push_back(problem);
+        }
+      }
+    }
+  }
+  catch(YAML::Exception& e)
+  {
+    ROS_ERROR("Unable to parse the stations: %s", e.what());
+    return false;
+  }
+
+  return true;
+}
+
+robot_model::RobotModelPtr loadRobotModel(const YAML::Node& corpus)
+{
+  string urdf_string, srdf_string;
+  if(!corpus["urdf"] || !corpus["srdf"] || !readFile(corpus["urdf"].as<string>(), urdf_string) ||
+      !readFile(corpus["srdf"].as<string>(), srdf_string))
+  {
+    ROS_ERROR("The corpus requires readable 'urdf' and 'srdf' files");
+    return robot_model::RobotModelPtr();
+  }
+
+  robot_model_loader::RobotModelLoader::Options opts(urdf_string, srdf_string);
+  robot_model_loader::RobotModelLoader loader(opts);
+  robot_model::RobotModelPtr robot_model = loader.getModel();
+  if(!robot_model)
+  {
+    ROS_ERROR("Unable to load robot model from urdf and srdf.");
+  }
+  return robot_model;
+}
+
+planning_scene::PlanningScenePtr createPlanningScene(const robot_model::RobotModelConstPtr& robot_model,
+                                                     const string& collision_detector,
+                                                     collision_detection::CollisionPluginLoader& cd_loader,
+                                                     const Problem& problem)
+{
+  planning_scene::PlanningScenePtr planning_scene(new planning_scene::PlanningScene(robot_model));
+  if(!collision_detector.empty() && !cd_loader.activate(collision_detector, planning_scene, true))
+  {
+    ROS_ERROR("Unable to activate the collision detector '%s'", collision_detector.c_str());
+    return planning_scene::PlanningScenePtr();
+  }
+
+  for(const Obstacle& obstacle : problem.obstacles)
+  {
+    shapes::ShapeConstPtr box(new shapes::Box(obstacle.size.x(), obstacle.size.y(), obstacle.size.z()));
+    planning_scene->getWorldNonConst()->addToObject(obstacle.name, box, obstacle.pose);
+  }
+
+  return planning_scene;
+}
+
+void createMotionPlanRequest(const planning_scene::PlanningSceneConstPtr& planning_scene, const Problem& problem,
+                             planning_interface::MotionPlanRequest& req)
+{
+  req.allowed_planning_time = problem.allowed_planning_time;
+  req.num_planning_attempts = 1;
+  req.group_name = problem.group_name;
+
+  robot_state::RobotState start = planning_scene->getCurrentState();
+  start.setVariablePositions(problem.start);
+  moveit::core::robotStateToRobotStateMsg(start, req.start_state);
+  req.start_state.is_diff = true;
+
+  robot_state::RobotState goal = planning_scene->getCurrentState();
+  goal.setVariablePositions(problem.goal);
+  req.goal_constraints.resize(1);
+  req.goal_constraints[0] = kinematic_constraints::constructGoalConstraints(goal,
+                                                                            goal.getJointModelGroup(problem.group_name));
+}
+
+}
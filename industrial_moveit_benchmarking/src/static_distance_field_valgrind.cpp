@@ -0,0 +1,240 @@
+/**
+ * @file static_distance_field_valgrind.cpp
+ * @brief This is used for benchmarking the distance field queries against the fcl distance queries
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @license Software License Agreement (Apache License)\n
+ * \n
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at\n
+ * \n
+ * http://www.apache.org/licenses/LICENSE-2.0\n
+ * \n
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <ros/ros.h>
+#include <ros/package.h>
+#include <ros/console.h>
+#include <moveit/robot_model_loader/robot_model_loader.h>
+#include <moveit/robot_model/joint_model_group.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/collision_plugin_loader/collision_plugin_loader.h>
+#include <industrial_collision_detection/collision_detection/collision_world_industrial.h>
+#include <industrial_collision_detection/collision_detection/robot_sphere_model.h>
+#include <industrial_collision_detection/collision_detection/world_distance_field.h>
+#include <geometric_shapes/shapes.h>
+#include <cmath>
+#include <fstream>
+
+using namespace ros;
+using namespace Eigen;
+using namespace moveit::core;
+using namespace std;
+
+namespace
+{
+
+const string GROUP_NAME = "manipulator_rail";   /**< The group whose links are queried */
+const int NUM_OBSTACLES = 5;                    /**< The number of boxes along each side of the workcell */
+const int NUM_STATES = 1000;                    /**< The number of random states queried */
+const int NUM_BUILDS = 5;                       /**< The number of times the distance field is built from scratch */
+const int NUM_UPDATES = 20;                     /**< The number of times an obstacle is moved */
+
+/** @brief A sphere of a link collision shape */
+struct LinkSphere
+{
+  const LinkModel* link;
+  size_t shape_index;
+  collision_detection::CollisionSphere sphere;
+};
+
+/**
+ * @brief Computes the minimum distance between the spheres of the links and the obstacles of the field
+ * @param field   The distance field
+ * @param spheres The link spheres
+ * @param state   The robot state, its collision body transforms must be up to date
+ * @return The minimum distance
+ */
+double sphereDistance(const collision_detection::WorldDistanceField& field, const vector<LinkSphere>& spheres,
+                      const RobotState& state)
+{
+  double min_distance = field.getParameters().max_distance;
+  double distance;
+  Vector3d gradient;
+  for(const LinkSphere& s : spheres)
+  {
+    field.getDistanceGradient(state.getCollisionBodyTransform(s.link, s.shape_index) * s.sphere.center, distance,
+                              gradient);
+    min_distance = min(min_distance, distance - s.sphere.radius);
+  }
+  return min_distance;
+}
+
+}
+
+int main (int argc, char *argv[])
+{
+  ros::init(argc,argv,"static_distance_field_valgrind");
+  ros::NodeHandle pnh;
+
+  robot_model_loader::RobotModelLoaderPtr loader;
+  robot_model::RobotModelPtr robot_model;
+  string urdf_file_path, srdf_file_path;
+
+  urdf_file_path = package::getPath("stomp_test_support") + "/urdf/test_kr210l150_500K.urdf";
+  srdf_file_path = package::getPath("stomp_test_kr210_moveit_config") + "/config/test_kr210.srdf";
+
+  ifstream ifs1 (urdf_file_path.c_str());
+  string urdf_string((istreambuf_iterator<char>(ifs1)), (istreambuf_iterator<char>()));
+
+  ifstream ifs2 (srdf_file_path.c_str());
+  string srdf_string((istreambuf_iterator<char>(ifs2)), (istreambuf_iterator<char>()));
+
+  robot_model_loader::RobotModelLoader::Options opts(urdf_string, srdf_string);
+  loader.reset(new robot_model_loader::RobotModelLoader(opts));
+  robot_model = loader->getModel();
+
+  if (!robot_model)
+  {
+    ROS_ERROR_STREAM("Unable to load robot model from urdf and srdf.");
+    return 1;
+  }
+
+  const JointModelGroup* jmg = robot_model->getJointModelGroup(GROUP_NAME);
+  if (!jmg)
+  {
+    ROS_ERROR_STREAM("The group '" << GROUP_NAME << "' was not found");
+    return 1;
+  }
+
+  planning_scene::PlanningScenePtr planning_scene(new planning_scene::PlanningScene(robot_model));
+  collision_detection::CollisionPluginLoader cd_loader;
+  std::string class_name = "IndustrialFCL";
+  cd_loader.activate(class_name, planning_scene, true);
+
+  // boxes along both sides of the rail
+  collision_detection::WorldPtr world = planning_scene->getWorldNonConst();
+  shapes::ShapeConstPtr box(new shapes::Box(0.3, 0.3, 0.3));
+  for (int i = 0; i < NUM_OBSTACLES; i++)
+  {
+    double x = -2.0 + 4.0 * i / (NUM_OBSTACLES - 1);
+    world->addToObject("box_left_" + to_string(i), box, Affine3d(Translation3d(x, 1.8, 0.5 + 0.4 * i)));
+    world->addToObject("box_right_" + to_string(i), box, Affine3d(Translation3d(x, -1.8, 0.5 + 0.4 * i)));
+  }
+
+  collision_detection::CollisionWorldIndustrialConstPtr collision_world =
+      std::dynamic_pointer_cast<const collision_detection::CollisionWorldIndustrial>(planning_scene->getCollisionWorld());
+  if (!collision_world)
+  {
+    ROS_ERROR_STREAM("The collision world is not an industrial collision world");
+    return 1;
+  }
+
+  // the field covers the workcell
+  collision_detection::WorldDistanceField::Parameters field_params;
+  field_params.size_x = 5.0;
+  field_params.size_y = 5.0;
+  field_params.size_z = 3.5;
+  field_params.origin_x = -2.5;
+  field_params.origin_y = -2.5;
+  field_params.origin_z = -0.25;
+
+  // building from scratch
+  ros::WallTime t1, t2;
+  t1 = ros::WallTime::now();
+  for (int i = 0; i < NUM_BUILDS; i++)
+  {
+    collision_detection::WorldDistanceField field(field_params);
+    for (auto it = world->begin(); it != world->end(); it++)
+    {
+      field.updateObject(it->second);
+    }
+  }
+  t2 = ros::WallTime::now();
+  ROS_INFO("Distance field build time: %4.10f seconds", (t2 - t1).toSec() / NUM_BUILDS);
+
+  // incremental updates of the field kept by the collision world
+  collision_detection::WorldDistanceFieldConstPtr field = collision_world->getDistanceField(field_params);
+  t1 = ros::WallTime::now();
+  for (int i = 0; i < NUM_UPDATES; i++)
+  {
+    world->moveShapeInObject("box_left_0", box, Affine3d(Translation3d(-2.0, 1.8 - 0.01 * (i + 1), 0.5)));
+    field = collision_world->getDistanceField(field_params);
+  }
+  t2 = ros::WallTime::now();
+  ROS_INFO("Distance field update time after moving an obstacle: %4.10f seconds", (t2 - t1).toSec() / NUM_UPDATES);
+
+  // the sphere model is cached on disk, it is generated on the first run only
+  collision_detection::RobotSphereModelPtr sphere_model = collision_detection::RobotSphereModel::create(
+      robot_model, collision_detection::RobotSphereModel::Parameters(),
+      collision_detection::RobotSphereModel::getDefaultCacheDirectory());
+
+  vector<LinkSphere> spheres;
+  for (const LinkModel* link : jmg->getUpdatedLinkModelsWithGeometry())
+  {
+    for (size_t s = 0; s < link->getShapes().size(); s++)
+    {
+      for (const collision_detection::CollisionSphere& sphere : sphere_model->getSpheres(link, s))
+      {
+        spheres.push_back({link, s, sphere});
+      }
+    }
+  }
+
+  // the forward kinematics are computed beforehand so that only the distance queries are timed
+  vector<RobotState> states(NUM_STATES, planning_scene->getCurrentState());
+  for (RobotState& state : states)
+  {
+    state.setToRandomPositions(jmg);
+    state.updateCollisionBodyTransforms();
+  }
+
+  vector<double> field_distances(NUM_STATES), fcl_distances(NUM_STATES);
+  t1 = ros::WallTime::now();
+  for (int i = 0; i < NUM_STATES; i++)
+  {
+    field_distances[i] = sphereDistance(*field, spheres, states[i]);
+  }
+  t2 = ros::WallTime::now();
+  double field_time = (t2 - t1).toSec();
+
+  const collision_detection::CollisionRobot& collision_robot = *planning_scene->getCollisionRobot();
+  const collision_detection::AllowedCollisionMatrix& acm = planning_scene->getAllowedCollisionMatrix();
+  t1 = ros::WallTime::now();
+  for (int i = 0; i < NUM_STATES; i++)
+  {
+    fcl_distances[i] = collision_world->distanceRobot(collision_robot, states[i], acm);
+  }
+  t2 = ros::WallTime::now();
+  double fcl_time = (t2 - t1).toSec();
+
+  // the spheres overestimate the links, the error is only meaningful within the range of the field
+  double max_error = 0.0;
+  int num_compared = 0;
+  for (int i = 0; i < NUM_STATES; i++)
+  {
+    if (fcl_distances[i] < field_params.max_distance)
+    {
+      max_error = max(max_error, abs(field_distances[i] - fcl_distances[i]));
+      num_compared++;
+    }
+  }
+
+  ROS_INFO("Distance field: %lu spheres, %4.1f queries/s, %4.1f sphere lookups/s", spheres.size(),
+           NUM_STATES / field_time, NUM_STATES * spheres.size() / field_time);
+  ROS_INFO("FCL: %4.1f queries/s", NUM_STATES / fcl_time);
+  ROS_INFO("Max distance field error in %i states closer than %4.3f: %4.5f", num_compared, field_params.max_distance,
+           max_error);
+  return 0;
+}
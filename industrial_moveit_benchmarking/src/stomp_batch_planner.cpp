@@ -0,0 +1,436 @@
+/**
+ * @file stomp_batch_planner.cpp
+ * @brief This precomputes the stomp plans of a list of problems with several worker processes sharing a work queue
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @license Software License Agreement (Apache License)\n
+ * \n
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at\n
+ * \n
+ * http://www.apache.org/licenses/LICENSE-2.0\n
+ * \n
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <ros/ros.h>
+#include <ros/console.h>
+#include <industrial_moveit_benchmarking/planning_corpus.h>
+#include <stomp_moveit/stomp_planner.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace stomp_moveit;
+using namespace industrial_moveit_benchmarking;
+using namespace std;
+
+namespace
+{
+
+/** @brief The exit code of a worker that ran to completion but failed to solve some of its problems */
+const int WORKER_EXIT_PLANNING_FAILURES = 2;
+
+/** @brief The options of the command line */
+struct Options
+{
+  string problems_file;
+  string queue_directory;
+  string output_file;
+  int num_workers;
+};
+
+/**
+ * @brief Parses the command line
+ * @param argc    The number of arguments
+ * @param argv    The arguments
+ * @param options The options
+ * @return False if the command line is malformed
+ */
+bool parseOptions(int argc, char *argv[], Options& options)
+{
+  options.num_workers = 1;
+  for(int i = 1; i < argc; i++)
+  {
+    string arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if(arg == "--workers" && has_value)
+    {
+      options.num_workers = max(atoi(argv[++i]), 1);
+    }
+    else if(arg == "--queue" && has_value)
+    {
+      options.queue_directory = argv[++i];
+    }
+    else if(arg == "--output" && has_value)
+    {
+      options.output_file = argv[++i];
+    }
+    else if(options.problems_file.empty() && arg.compare(0, 2, "--") != 0)
+    {
+      options.problems_file = arg;
+    }
+    else
+    {
+      return false;
+    }
+  }
+
+  return !options.problems_file.empty();
+}
+
+/**
+ * @brief The path of a file of a problem in the queue directory
+ * @param directory The queue directory
+ * @param index     The index of the problem in the problem list
+ * @param extension The extension, 'claim' or 'result'
+ * @return The path
+ */
+string queuePath(const string& directory, size_t index, const string& extension)
+{
+  return directory + "/" + to_string(index) + "." + extension;
+}
+
+/**
+ * @brief Claims a problem of the queue, exactly one process of any machine sharing the directory succeeds
+ * @param directory The queue directory
+ * @param index     The index of the problem
+ * @param worker    The identity of the claiming worker written into the claim
+ * @return True if the problem was claimed by this call
+ */
+bool claimProblem(const string& directory, size_t index, const string& worker)
+{
+  int fd = open(queuePath(directory, index, "claim").c_str(), O_CREAT | O_EXCL | O_WRONLY, 0644);
+  if(fd < 0)
+  {
+    return false;
+  }
+
+  // the claim content is informational, a worker that dies leaves its claim without a result
+  ssize_t written = write(fd, worker.c_str(), worker.size());
+  (void)written;
+  close(fd);
+  return true;
+}
+
+/**
+ * @brief Writes the result of a problem, it replaces the file atomically so that readers never see a partial result
+ * @param directory The queue directory
+ * @param index     The index of the problem
+ * @param result    The result as a json object
+ * @return False if the file could not be written
+ */
+bool writeResult(const string& directory, size_t index, const string& result)
+{
+  string path = queuePath(directory, index, "result");
+  string tmp_path = path + ".tmp." + to_string(getpid());
+  {
+    ofstream ofs(tmp_path.c_str());
+    if(!ofs || !(ofs << result << "\n"))
+    {
+      return false;
+    }
+  }
+
+  return rename(tmp_path.c_str(), path.c_str()) == 0;
+}
+
+/**
+ * @brief Solves the problems claimed by a worker process until the queue is empty.  The planners of the groups are
+ * created once and stay warm across the problems, the successful trajectories are stored in their experience library.
+ * @param worker        The index of the worker within this process tree, it spreads the first claims of the workers
+ * @param num_workers   The number of workers of this process tree
+ * @param corpus        The problem file
+ * @param stomp_config  The stomp configuration of each group
+ * @param problems      The problems
+ * @param directory     The queue directory
+ * @return The number of problems that failed
+ */
+int runWorker(int worker, int num_workers, const YAML::Node& corpus, XmlRpc::XmlRpcValue stomp_config,
+              const vector<Problem>& problems, const string& directory)
+{
+  robot_model::RobotModelPtr robot_model = loadRobotModel(corpus);
+  if(!robot_model)
+  {
+    return static_cast<int>(problems.size());
+  }
+
+  char host[256] = {0};
+  gethostname(host, sizeof(host) - 1);
+  string identity = string(host) + ":" + to_string(getpid());
+  string collision_detector = corpus["collision_detector"] ? corpus["collision_detector"].as<string>() : string();
+  collision_detection::CollisionPluginLoader cd_loader;
+  map<string, std::shared_ptr<StompPlanner> > planners;
+
+  int failures = 0;
+  size_t first = problems.size() * worker / num_workers;
+  for(size_t n = 0; n < problems.size(); n++)
+  {
+    size_t index = (first + n) % problems.size();
+    if(!claimProblem(directory, index, identity))
+    {
+      continue;
+    }
+
+    const Problem& problem = problems[index];
+    std::shared_ptr<StompPlanner>& planner = planners[problem.group_name];
+    planning_scene::PlanningScenePtr planning_scene;
+    bool success = false;
+    ros::WallTime start_time = ros::WallTime::now();
+    try
+    {
+      if(!planner)
+      {
+        planner.reset(new StompPlanner(problem.group_name, stomp_config[problem.group_name], robot_model));
+      }
+
+      planning_scene = createPlanningScene(robot_model, collision_detector, cd_loader, problem);
+      if(planning_scene)
+      {
+        planning_interface::MotionPlanRequest req;
+        planning_interface::MotionPlanResponse res;
+        createMotionPlanRequest(planning_scene, problem, req);
+        planner->clear();
+        planner->setPlanningScene(planning_scene);
+        planner->setMotionPlanRequest(req);
+        success = planner->solve(res);
+      }
+    }
+    catch(std::exception& e)
+    {
+      ROS_ERROR("Problem '%s' failed: %s", problem.name.c_str(), e.what());
+    }
+    double latency = (ros::WallTime::now() - start_time).toSec();
+
+    ostringstream os;
+    os << setprecision(9) << "{\"index\": " << index << ", \"name\": \"" << problem.name << "\", \"group_name\": \""
+       << problem.group_name << "\", \"success\": " << (success ? "true" : "false") << ", \"latency\": " << latency
+       << ", \"worker\": \"" << identity << "\"}";
+    if(!writeResult(directory, index, os.str()))
+    {
+      ROS_ERROR("Unable to write the result of problem '%s' to '%s'", problem.name.c_str(), directory.c_str());
+    }
+
+    failures += success ? 0 : 1;
+    ROS_INFO("Problem '%s' %s in %f s", problem.name.c_str(), success ? "solved" : "failed", latency);
+  }
+
+  return failures;
+}
+
+}
+
+/**
+ * @brief Usage: stomp_batch_planner_node <problems.yaml> [--workers N] [--queue DIR] [--output results.json]
+ *
+ * The problem file has the format of the benchmark corpus, see config/stomp_benchmark_corpus.yaml, and may list
+ * 'stations' instead of or in addition to 'problems', every ordered pair of the stations of a group is planned.  When
+ * 'experience_library' is set every group stores its trajectories in that file, which is sized to hold all the problems
+ * unless the group configuration says otherwise, otherwise the 'experience_library_file' of the group configurations
+ * is used.
+ *
+ * The problems are solved by N worker processes, each one claims the next unclaimed problem of the queue directory
+ * until none is left.  Several machines share the work by running the node on the same problem file with a queue
+ * directory on a shared file system, each machine should then use its own experience library file.  The result of every
+ * problem is written next to its claim, the results found in the queue when the workers of this node are done are
+ * written as json to the output file or to the standard output.  A problem whose worker died keeps its claim without a
+ * result, deleting the claim queues it again.  The workers of this node that crashed or were killed are listed under
+ * 'failed_workers' with their exit code or signal.  No ros master is required.
+ */
+int main(int argc, char *argv[])
+{
+  ros::init(argc, argv, "stomp_batch_planner", ros::init_options::NoRosout | ros::init_options::AnonymousName);
+  Options options;
+  if(!parseOptions(argc, argv, options))
+  {
+    cerr << "Usage: " << argv[0] << " <problems.yaml> [--workers N] [--queue DIR] [--output results.json]" << endl;
+    return 1;
+  }
+
+  YAML::Node corpus;
+  try
+  {
+    corpus = YAML::LoadFile(resolvePath(options.problems_file));
+  }
+  catch(YAML::Exception& e)
+  {
+    ROS_ERROR("Unable to load the problem file '%s': %s", options.problems_file.c_str(), e.what());
+    return 1;
+  }
+
+  double planning_time = corpus["allowed_planning_time"] ? corpus["allowed_planning_time"].as<double>() : 10.0;
+  vector<Problem> problems;
+  if((corpus["problems"] && !parseProblems(corpus["problems"], planning_time, problems)) ||
+      (corpus["stations"] && !parseStations(corpus["stations"], planning_time, problems)) || problems.empty())
+  {
+    ROS_ERROR("The problem file has no valid 'problems' or 'stations'");
+    return 1;
+  }
+
+  XmlRpc::XmlRpcValue stomp_config;
+  try
+  {
+    stomp_config = toXmlRpc(corpus["stomp"]);
+    for(const Problem& problem : problems)
+    {
+      if(!stomp_config.hasMember(problem.group_name) || !stomp_config[problem.group_name].hasMember("optimization"))
+      {
+        ROS_ERROR("The problem file has no 'stomp' optimization configuration for the group '%s'",
+                  problem.group_name.c_str());
+        return 1;
+      }
+
+      XmlRpc::XmlRpcValue& optimization = stomp_config[problem.group_name]["optimization"];
+      if(corpus["experience_library"])
+      {
+        optimization["experience_library_file"] = resolvePath(corpus["experience_library"].as<string>());
+        if(!optimization.hasMember("experience_library_size"))
+        {
+          optimization["experience_library_size"] = static_cast<int>(problems.size());
+        }
+      }
+    }
+  }
+  catch(std::exception& e)
+  {
+    ROS_ERROR("Unable to read the stomp configuration: %s", e.what());
+    return 1;
+  }
+
+  // the queue directory is created by the first node, the others join it
+  if(options.queue_directory.empty())
+  {
+    char queue_template[] = "/tmp/stomp_batch_XXXXXX";
+    if(!mkdtemp(queue_template))
+    {
+      ROS_ERROR("Unable to create a queue directory: %s", strerror(errno));
+      return 1;
+    }
+    options.queue_directory = queue_template;
+  }
+  else if(mkdir(options.queue_directory.c_str(), 0755) != 0 && errno != EEXIST)
+  {
+    ROS_ERROR("Unable to create the queue directory '%s': %s", options.queue_directory.c_str(), strerror(errno));
+    return 1;
+  }
+  ROS_INFO("Planning %lu problems with %i workers, queue '%s'", problems.size(), options.num_workers,
+           options.queue_directory.c_str());
+
+  // the workers are forked before any planner thread exists
+  ros::WallTime start_time = ros::WallTime::now();
+  vector<pair<int, pid_t> > workers;
+  for(int w = 1; w < options.num_workers; w++)
+  {
+    pid_t pid = fork();
+    if(pid == 0)
+    {
+      int failures = runWorker(w, options.num_workers, corpus, stomp_config, problems, options.queue_directory);
+      _exit(failures == 0 ? 0 : WORKER_EXIT_PLANNING_FAILURES);
+    }
+    else if(pid < 0)
+    {
+      ROS_ERROR("Unable to fork a worker: %s", strerror(errno));
+      break;
+    }
+    workers.push_back(make_pair(w, pid));
+  }
+
+  runWorker(0, options.num_workers, corpus, stomp_config, problems, options.queue_directory);
+
+  // a worker that did not exit on its own, or exited with anything but its planning outcome, left its claim unfinished
+  ostringstream failed_workers;
+  size_t num_failed_workers = 0;
+  for(const auto& worker : workers)
+  {
+    int status = 0;
+    pid_t res;
+    while((res = waitpid(worker.second, &status, 0)) < 0 && errno == EINTR) {}
+
+    string failure;
+    if(res < 0)
+    {
+      failure = string("\"error\": \"") + strerror(errno) + "\"";
+      ROS_ERROR("Unable to wait for worker %i: %s", worker.first, strerror(errno));
+    }
+    else if(WIFSIGNALED(status))
+    {
+      failure = "\"signal\": " + to_string(WTERMSIG(status));
+      ROS_ERROR("Worker %i was killed by signal %i", worker.first, WTERMSIG(status));
+    }
+    else if(WIFEXITED(status) && WEXITSTATUS(status) != 0 && WEXITSTATUS(status) != WORKER_EXIT_PLANNING_FAILURES)
+    {
+      failure = "\"exit_code\": " + to_string(WEXITSTATUS(status));
+      ROS_ERROR("Worker %i exited with code %i", worker.first, WEXITSTATUS(status));
+    }
+
+    if(!failure.empty())
+    {
+      failed_workers << (num_failed_workers == 0 ? "\n" : ",\n") << "    {\"worker\": " << worker.first << ", " << failure
+                     << "}";
+      num_failed_workers++;
+    }
+  }
+  double duration = (ros::WallTime::now() - start_time).toSec();
+
+  // gathering the results of every machine sharing the queue
+  ostringstream os;
+  os << setprecision(9);
+  os << "{\n  \"problems\": " << problems.size() << ",\n  \"duration\": " << duration << ",\n  \"results\": [";
+  size_t num_results = 0, successes = 0;
+  for(size_t i = 0; i < problems.size(); i++)
+  {
+    ifstream ifs(queuePath(options.queue_directory, i, "result").c_str());
+    string line;
+    if(!getline(ifs, line))
+    {
+      continue;
+    }
+
+    os << (num_results == 0 ? "\n" : ",\n") << "    " << line;
+    num_results++;
+    successes += line.find("\"success\": true") != string::npos ? 1 : 0;
+  }
+  os << "\n  ],\n  \"failed_workers\": [" << failed_workers.str() << (num_failed_workers == 0 ? "]" : "\n  ]");
+  os << ",\n  \"finished\": " << num_results << ",\n  \"successes\": " << successes << "\n}\n";
+
+  if(!options.output_file.empty())
+  {
+    ofstream ofs(options.output_file.c_str());
+    if(!ofs)
+    {
+      ROS_ERROR("Unable to write the results to '%s'", options.output_file.c_str());
+      return 1;
+    }
+    ofs << os.str();
+  }
+  else
+  {
+    cout << os.str();
+  }
+
+  ROS_INFO("%lu of %lu problems finished, %lu solved, in %f s", num_results, problems.size(), successes, duration);
+  if(num_failed_workers > 0)
+  {
+    ROS_ERROR("%lu of %lu workers failed, their claimed problems have no result", num_failed_workers, workers.size());
+  }
+  return successes == problems.size() && num_failed_workers == 0 ? 0 : 1;
+}
@@ -0,0 +1,326 @@
+/**
+ * @file stomp_benchmark.cpp
+ * @brief This runs the stomp planner over a corpus of planning problems and reports latency and quality statistics
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @license Software License Agreement (Apache License)\n
+ * \n
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at\n
+ * \n
+ * http://www.apache.org/licenses/LICENSE-2.0\n
+ * \n
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <ros/ros.h>
+#include <ros/console.h>
+#include <industrial_moveit_benchmarking/planning_corpus.h>
+#include <stomp_moveit/stomp_planner.h>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+using namespace stomp_moveit;
+using namespace industrial_moveit_benchmarking;
+using namespace std;
+
+namespace
+{
+
+/** @brief The outcome of a single call to StompPlanner::solve() */
+struct RunResult
+{
+  bool success;
+  double latency;
+  int iterations;
+  double cost;
+  string termination;
+};
+
+/**
+ * @brief Returns the name of a termination reason
+ * @param reason  The reason
+ * @return The name
+ */
+string terminationName(stomp_core::TerminationReasons::TerminationReason reason)
+{
+  using namespace stomp_core::TerminationReasons;
+  switch(reason)
+  {
+    case MAX_ITERATIONS:
+      return "max_iterations";
+    case VALID_SOLUTION:
+      return "valid_solution";
+    case COST_CONVERGED:
+      return "cost_converged";
+    case UPDATES_CONVERGED:
+      return "updates_converged";
+    case TIME_LIMIT:
+      return "time_limit";
+    case CANCELLED:
+      return "cancelled";
+    default:
+      return "failed";
+  }
+}
+
+/**
+ * @brief Writes the mean and the nearest rank percentiles of the samples as a json object
+ * @param os      The output stream
+ * @param samples The samples, they are sorted in place
+ */
+void writeStatistics(ostream& os, vector<double>& samples)
+{
+  if(samples.empty())
+  {
+    os << "null";
+    return;
+  }
+
+  sort(samples.begin(), samples.end());
+  auto percentile = [&samples](double p)
+  {
+    size_t rank = static_cast<size_t>(ceil(p * samples.size()));
+    return samples[max<size_t>(rank, 1) - 1];
+  };
+
+  double mean = 0;
+  for(double s : samples)
+  {
+    mean += s;
+  }
+  mean /= samples.size();
+
+  os << "{\"count\": " << samples.size() << ", \"mean\": " << mean << ", \"min\": " << samples.front()
+     << ", \"p50\": " << percentile(0.5) << ", \"p90\": " << percentile(0.9) << ", \"p99\": " << percentile(0.99)
+     << ", \"max\": " << samples.back() << "}";
+}
+
+/**
+ * @brief Writes the summary of a set of runs as the members of a json object
+ * @param os      The output stream
+ * @param runs    The runs
+ * @param indent  The indentation of the members
+ */
+void writeSummary(ostream& os, const vector<RunResult>& runs, const string& indent)
+{
+  vector<double> latencies, iterations, costs;
+  int successes = 0;
+  for(const RunResult& r : runs)
+  {
+    latencies.push_back(r.latency);
+    if(r.success)
+    {
+      successes++;
+      iterations.push_back(r.iterations);
+      costs.push_back(r.cost);
+    }
+  }
+
+  os << indent << "\"runs\": " << runs.size() << ",\n";
+  os << indent << "\"successes\": " << successes << ",\n";
+  os << indent << "\"success_rate\": " << (runs.empty() ? 0.0 : static_cast<double>(successes) / runs.size()) << ",\n";
+  os << indent << "\"latency\": ";
+  writeStatistics(os, latencies);
+  os << ",\n" << indent << "\"iterations\": ";
+  writeStatistics(os, iterations);
+  os << ",\n" << indent << "\"final_cost\": ";
+  writeStatistics(os, costs);
+}
+
+/**
+ * @brief Solves a problem once
+ * @param planner         The planner of the problem group
+ * @param planning_scene  The planning scene holding the obstacles of the problem
+ * @param problem         The problem
+ * @return The run result
+ */
+RunResult runProblem(StompPlanner& planner, const planning_scene::PlanningScenePtr& planning_scene,
+                     const Problem& problem)
+{
+  planning_interface::MotionPlanRequest req;
+  planning_interface::MotionPlanResponse res;
+  createMotionPlanRequest(planning_scene, problem, req);
+
+  planner.clear();
+  planner.setPlanningScene(planning_scene);
+  planner.setMotionPlanRequest(req);
+
+  RunResult result;
+  ros::WallTime start_time = ros::WallTime::now();
+  result.success = planner.solve(res);
+  result.latency = (ros::WallTime::now() - start_time).toSec();
+
+  std::shared_ptr<const stomp_core::Stomp> optimizer = planner.getSelectedOptimizer();
+  result.iterations = optimizer ? static_cast<int>(optimizer->getNumIterations()) : 0;
+  result.cost = optimizer ? optimizer->getOptimizedCost() : 0.0;
+  result.termination = optimizer ? terminationName(optimizer->getTerminationReason()) : string("no_trajectory");
+
+  return result;
+}
+
+}
+
+/**
+ * @brief Usage: stomp_benchmark_node <corpus.yaml> [results.json]
+ *
+ * The corpus file lists the robot model, the stomp configuration of each group and the planning problems, see
+ * config/stomp_benchmark_corpus.yaml.  The results are written as json to the given file or to the standard output.
+ * No ros master is required.
+ */
+int main(int argc, char *argv[])
+{
+  ros::init(argc, argv, "stomp_benchmark", ros::init_options::NoRosout | ros::init_options::AnonymousName);
+  if(argc < 2)
+  {
+    cerr << "Usage: " << argv[0] << " <corpus.yaml> [results.json]" << endl;
+    return 1;
+  }
+
+  string corpus_path = argv[1];
+  YAML::Node corpus;
+  try
+  {
+    corpus = YAML::LoadFile(resolvePath(corpus_path));
+  }
+  catch(YAML::Exception& e)
+  {
+    ROS_ERROR("Unable to load the benchmark corpus '%s': %s", corpus_path.c_str(), e.what());
+    return 1;
+  }
+
+  // loading robot model
+  robot_model::RobotModelPtr robot_model = loadRobotModel(corpus);
+  if(!robot_model)
+  {
+    return 1;
+  }
+
+  // loading problems
+  int num_runs = corpus["runs"] ? corpus["runs"].as<int>() : 10;
+  int warmup_runs = corpus["warmup_runs"] ? corpus["warmup_runs"].as<int>() : 1;
+  double planning_time = corpus["allowed_planning_time"] ? corpus["allowed_planning_time"].as<double>() : 10.0;
+  vector<Problem> problems;
+  if(!corpus["problems"] || !parseProblems(corpus["problems"], planning_time, problems) || problems.empty())
+  {
+    ROS_ERROR("The benchmark corpus has no valid 'problems'");
+    return 1;
+  }
+
+  // creating a planner per group
+  map<string, std::shared_ptr<StompPlanner> > planners;
+  try
+  {
+    XmlRpc::XmlRpcValue stomp_config = toXmlRpc(corpus["stomp"]);
+    for(const Problem& problem : problems)
+    {
+      if(planners.count(problem.group_name) > 0)
+      {
+        continue;
+      }
+
+      if(!stomp_config.hasMember(problem.group_name))
+      {
+        ROS_ERROR("The benchmark corpus has no 'stomp' configuration for the group '%s'", problem.group_name.c_str());
+        return 1;
+      }
+
+      planners[problem.group_name].reset(new StompPlanner(problem.group_name, stomp_config[problem.group_name],
+                                                          robot_model));
+    }
+  }
+  catch(std::exception& e)
+  {
+    ROS_ERROR("Unable to create the stomp planners: %s", e.what());
+    return 1;
+  }
+
+  string collision_detector = corpus["collision_detector"] ? corpus["collision_detector"].as<string>() : string();
+  collision_detection::CollisionPluginLoader cd_loader;
+
+  // benchmarking
+  ostringstream os;
+  os << setprecision(9);
+  os << "{\n  \"corpus\": \"" << corpus_path << "\",\n  \"runs_per_problem\": " << num_runs
+     << ",\n  \"warmup_runs\": " << warmup_runs << ",\n  \"problems\": [\n";
+
+  map<string, vector<RunResult> > category_runs;
+  for(size_t i = 0; i < problems.size(); i++)
+  {
+    const Problem& problem = problems[i];
+    planning_scene::PlanningScenePtr planning_scene = createPlanningScene(robot_model, collision_detector, cd_loader,
+                                                                          problem);
+    if(!planning_scene)
+    {
+      return 1;
+    }
+
+    StompPlanner& planner = *planners[problem.group_name];
+    for(int r = 0; r < warmup_runs; r++)
+    {
+      runProblem(planner, planning_scene, problem);
+    }
+
+    vector<RunResult> runs;
+    for(int r = 0; r < num_runs; r++)
+    {
+      runs.push_back(runProblem(planner, planning_scene, problem));
+    }
+    category_runs[problem.category].insert(category_runs[problem.category].end(), runs.begin(), runs.end());
+
+    os << "    {\n      \"name\": \"" << problem.name << "\",\n      \"category\": \"" << problem.category
+       << "\",\n      \"group_name\": \"" << problem.group_name << "\",\n      \"obstacles\": "
+       << problem.obstacles.size() << ",\n";
+    writeSummary(os, runs, "      ");
+    os << ",\n      \"samples\": [";
+    for(size_t r = 0; r < runs.size(); r++)
+    {
+      os << (r == 0 ? "\n" : ",\n") << "        {\"success\": " << (runs[r].success ? "true" : "false")
+         << ", \"latency\": " << runs[r].latency << ", \"iterations\": " << runs[r].iterations << ", \"final_cost\": "
+         << runs[r].cost << ", \"termination\": \"" << runs[r].termination << "\"}";
+    }
+    os << "\n      ]\n    }" << (i + 1 < problems.size() ? "," : "") << "\n";
+
+    ROS_INFO("Problem '%s': %i runs finished", problem.name.c_str(), num_runs);
+  }
+
+  os << "  ],\n  \"categories\": {";
+  for(auto it = category_runs.begin(); it != category_runs.end(); ++it)
+  {
+    os << (it == category_runs.begin() ? "\n" : ",\n") << "    \"" << it->first << "\": {\n";
+    writeSummary(os, it->second, "      ");
+    os << "\n    }";
+  }
+  os << "\n  }\n}\n";
+
+  if(argc > 2)
+  {
+    ofstream ofs(argv[2]);
+    if(!ofs)
+    {
+      ROS_ERROR("Unable to write the benchmark results to '%s'", argv[2]);
+      return 1;
+    }
+    ofs << os.str();
+  }
+  else
+  {
+    cout << os.str();
+  }
+
+  return 0;
+}
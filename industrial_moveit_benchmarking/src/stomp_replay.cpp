@@ -0,0 +1,195 @@
+/**
+ * @file stomp_replay.cpp
+ * @brief This replays the plans captured by the stomp planner and reports where their time goes
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @license Software License Agreement (Apache License)\n
+ * \n
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at\n
+ * \n
+ * http://www.apache.org/licenses/LICENSE-2.0\n
+ * \n
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <ros/ros.h>
+#include <ros/console.h>
+#include <moveit/robot_model_loader/robot_model_loader.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/collision_plugin_loader/collision_plugin_loader.h>
+#include <stomp_moveit/stomp_planner.h>
+#include <stomp_moveit/utils/plan_capture.h>
+#include <stomp_moveit/utils/planner_metrics.h>
+
+using namespace stomp_moveit;
+using namespace std;
+
+namespace
+{
+
+/**
+ * @brief Returns the file name of a path without its directory and extension
+ * @param path The path
+ * @return The file name
+ */
+string getStem(const string& path)
+{
+  size_t begin = path.find_last_of('/');
+  begin = begin == string::npos ? 0 : begin + 1;
+  size_t end = path.find_last_of('.');
+  return path.substr(begin, end == string::npos || end < begin ? string::npos : end - begin);
+}
+
+/**
+ * @brief Replays a captured plan
+ * @param file_name The capture file
+ * @param robot_model The robot model the plan was captured with
+ * @param num_runs The number of times the plan is solved
+ * @param ignore_time_limit Whether to drop the allowed planning time of the request, which makes the replay
+ * deterministic since the optimization is no longer interrupted at a time dependent point
+ * @param trace_directory The directory the Chrome trace of the optimization is written to, empty to disable it
+ * @return True if the plan could be replayed, otherwise false.
+ */
+bool replay(const string& file_name, const robot_model::RobotModelConstPtr& robot_model, int num_runs,
+            bool ignore_time_limit, const string& trace_directory)
+{
+  utils::PlanCapture capture;
+  if(!capture.read(file_name))
+  {
+    return false;
+  }
+
+  if(capture.scene.robot_model_name != robot_model->getName())
+  {
+    ROS_WARN("'%s' was captured with the robot '%s' but the robot '%s' is loaded", file_name.c_str(),
+             capture.scene.robot_model_name.c_str(), robot_model->getName().c_str());
+  }
+
+  planning_scene::PlanningScenePtr planning_scene(new planning_scene::PlanningScene(robot_model));
+  collision_detection::CollisionPluginLoader cd_loader;
+  if(!capture.collision_detector.empty() && capture.collision_detector != planning_scene->getActiveCollisionDetectorName() &&
+     !cd_loader.activate(capture.collision_detector, planning_scene, true))
+  {
+    ROS_ERROR("Unable to activate the collision detector '%s'", capture.collision_detector.c_str());
+    return false;
+  }
+  planning_scene->setPlanningSceneMsg(capture.scene);
+
+  // the replay must not capture itself
+  XmlRpc::XmlRpcValue config = capture.config;
+  config["optimization"]["capture_directory"] = string();
+  if(!trace_directory.empty())
+  {
+    config["optimization"]["instrumentation_trace_file"] = trace_directory + "/" + getStem(file_name) + ".trace.json";
+  }
+
+  planning_interface::MotionPlanRequest req = capture.request;
+  if(ignore_time_limit)
+  {
+    req.allowed_planning_time = 0.0;
+  }
+
+  std::shared_ptr<StompPlanner> planner;
+  try
+  {
+    planner.reset(new StompPlanner(capture.group, config, robot_model));
+  }
+  catch(std::exception& e)
+  {
+    ROS_ERROR("Unable to create the stomp planner for '%s': %s", file_name.c_str(), e.what());
+    return false;
+  }
+
+  utils::PlannerMetricsPtr metrics(new utils::PlannerMetrics(max(num_runs, 1)));
+  planner->setMetrics(metrics);
+
+  ROS_INFO("Replaying '%s': group '%s', seed %i, captured after %.3f seconds", file_name.c_str(),
+           capture.group.c_str(), capture.seed, capture.planning_time);
+  for(int r = 0; r < num_runs; r++)
+  {
+    planner->clear();
+    planner->setPlanningScene(planning_scene);
+    planner->setMotionPlanRequest(req);
+
+    planning_interface::MotionPlanDetailedResponse res;
+    ros::WallTime start_time = ros::WallTime::now();
+    bool success = planner->solve(res);
+    double latency = (ros::WallTime::now() - start_time).toSec();
+
+    std::shared_ptr<const stomp_core::Stomp> optimizer = planner->getSelectedOptimizer();
+    ROS_INFO("  run %i: %s in %.3f seconds, error code %i, %u iterations, cost %f", r,
+             success ? "succeeded" : "failed", latency, res.error_code_.val,
+             optimizer ? optimizer->getNumIterations() : 0u, optimizer ? optimizer->getOptimizedCost() : 0.0);
+    if(r == 0 && !res.description_.empty())
+    {
+      ROS_INFO_STREAM("  plugin profile:\n" << res.description_[0]);
+    }
+  }
+
+  vector<diagnostic_msgs::DiagnosticStatus> statuses;
+  metrics->getStatuses(statuses);
+  for(const diagnostic_msgs::DiagnosticStatus& status : statuses)
+  {
+    for(const diagnostic_msgs::KeyValue& kv : status.values)
+    {
+      ROS_INFO("  %s: %s", kv.key.c_str(), kv.value.c_str());
+    }
+  }
+
+  return true;
+}
+
+}
+
+/**
+ * @brief Usage: stomp_replay_node <capture.stompcap>...
+ *
+ * The robot model is loaded from the robot_description parameter.  The private parameters are 'runs' (default 1),
+ * 'ignore_time_limit' (default false) and 'trace_directory' (default empty, requires stomp_core to be built with
+ * STOMP_CORE_INSTRUMENTATION).
+ */
+int main(int argc, char *argv[])
+{
+  ros::init(argc, argv, "stomp_replay");
+  ros::NodeHandle pnh("~");
+
+  if(argc < 2)
+  {
+    ROS_ERROR("Usage: stomp_replay_node <capture.stompcap>...");
+    return 1;
+  }
+
+  int num_runs;
+  bool ignore_time_limit;
+  string trace_directory;
+  pnh.param("runs", num_runs, 1);
+  pnh.param("ignore_time_limit", ignore_time_limit, false);
+  pnh.param("trace_directory", trace_directory, string());
+
+  robot_model_loader::RobotModelLoader loader("robot_description");
+  robot_model::RobotModelConstPtr robot_model = loader.getModel();
+  if(!robot_model)
+  {
+    ROS_ERROR("Unable to load the robot model from the robot_description parameter");
+    return 1;
+  }
+
+  int failures = 0;
+  for(int i = 1; i < argc; i++)
+  {
+    failures += replay(argv[i], robot_model, num_runs, ignore_time_limit, trace_directory) ? 0 : 1;
+  }
+
+  return failures == 0 ? 0 : 1;
+}
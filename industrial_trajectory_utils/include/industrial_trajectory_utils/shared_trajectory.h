@@ -0,0 +1,86 @@
+/**
+ * @file shared_trajectory.h
+ * @brief This contains the immutable planner output handed to the consumers of the same process without conversion
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @license Software License Agreement (Apache License)\n
+ * \n
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at\n
+ * \n
+ * http://www.apache.org/licenses/LICENSE-2.0\n
+ * \n
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef INDUSTRIAL_TRAJECTORY_UTILS_SHARED_TRAJECTORY_H_
+#define INDUSTRIAL_TRAJECTORY_UTILS_SHARED_TRAJECTORY_H_
+
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <trajectory_msgs/JointTrajectory.h>
+#include <Eigen/Core>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace trajectory
+{
+
+  /**
+   * @brief A timed joint trajectory of a planning group stored as matrices, the planners hand it to the consumers of the
+   * same process, e.g. an executor loaded in the same nodelet manager, through a pointer to const so that every consumer
+   * reads the same copy.  It is only converted to a message, see toJointTrajectoryMsg(), when it crosses a process.
+   */
+  struct SharedTrajectory
+  {
+    std::string group_name;               /**< The planning group */
+    std::vector<std::string> joint_names; /**< The active joints of the group, one per row */
+    Eigen::MatrixXd positions;            /**< The joint values [num_joints][num_waypoints] */
+    Eigen::MatrixXd velocities;           /**< The joint velocities [num_joints][num_waypoints], empty if not timed */
+    Eigen::MatrixXd accelerations;        /**< The joint accelerations [num_joints][num_waypoints], empty if not timed */
+    Eigen::VectorXd time_from_start;      /**< The time of each waypoint since the first one (s) [num_waypoints] */
+
+    /** @brief The number of waypoints */
+    std::size_t getWayPointCount() const { return static_cast<std::size_t>(positions.cols()); }
+  };
+  typedef std::shared_ptr<SharedTrajectory> SharedTrajectoryPtr;
+  typedef std::shared_ptr<const SharedTrajectory> SharedTrajectoryConstPtr;
+
+  /**
+   * @brief Copies the active joints of the group of a robot trajectory, the velocities and accelerations are left empty
+   * when every one of them is zero.
+   * @param trajectory the trajectory, it must have a group
+   * @return The shared trajectory, a null pointer if the trajectory has no group
+   */
+  SharedTrajectoryConstPtr makeSharedTrajectory(const robot_trajectory::RobotTrajectory &trajectory);
+
+  /**
+   * @brief Converts a shared trajectory to a message for the consumers of another process
+   * @param trajectory the shared trajectory
+   * @param msg returns the joint trajectory, its header is left untouched
+   */
+  void toJointTrajectoryMsg(const SharedTrajectory &trajectory, trajectory_msgs::JointTrajectory &msg);
+
+  /**
+   * @brief Converts a shared trajectory to a robot trajectory for the MoveIt interfaces that require one
+   * @param trajectory the shared trajectory
+   * @param reference the state whose values the joints outside of the group keep
+   * @param output returns the robot trajectory, it must be of the same robot model
+   * @return True if the group and the joints exist in the robot model, otherwise false
+   */
+  bool toRobotTrajectory(const SharedTrajectory &trajectory, const robot_state::RobotState &reference,
+                         robot_trajectory::RobotTrajectory &output);
+
+}
+
+#endif /* INDUSTRIAL_TRAJECTORY_UTILS_SHARED_TRAJECTORY_H_ */
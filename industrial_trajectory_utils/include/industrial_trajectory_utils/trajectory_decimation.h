@@ -0,0 +1,70 @@
+/**
+ * @file trajectory_decimation.h
+ * @brief This contains the removal of the planner output waypoints that their neighbors interpolate within tolerance
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @license Software License Agreement (Apache License)\n
+ * \n
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at\n
+ * \n
+ * http://www.apache.org/licenses/LICENSE-2.0\n
+ * \n
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef INDUSTRIAL_TRAJECTORY_UTILS_TRAJECTORY_DECIMATION_H_
+#define INDUSTRIAL_TRAJECTORY_UTILS_TRAJECTORY_DECIMATION_H_
+
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <string>
+
+namespace trajectory
+{
+
+  /** @brief The tolerances of decimateTrajectory(), a tolerance that is not positive is not checked */
+  struct TrajectoryDecimationParameters
+  {
+    TrajectoryDecimationParameters() : joint_tolerance(0.0), cartesian_tolerance(0.0) {}
+
+    double joint_tolerance;     /**< The largest deviation of a joint from the removed waypoints (rad or m) */
+    double cartesian_tolerance; /**< The largest deviation of the tip link origin from the removed waypoints (m) */
+    std::string tip_link;       /**< The link of the cartesian tolerance, the last link of the group if empty */
+
+    /** @brief Whether any tolerance is set, the trajectory is left untouched otherwise */
+    bool isEnabled() const { return joint_tolerance > 0.0 || cartesian_tolerance > 0.0; }
+  };
+
+  /**
+   * @brief Removes the waypoints of a trajectory that the interpolation of the waypoints kept around them reproduces
+   * within the tolerances, in the manner of the Douglas-Peucker polyline simplification.  A span between two kept
+   * waypoints is interpolated in joint space, each waypoint in between is compared with the state at the same fraction of
+   * the joint space path length.  The span is split at the waypoint of the largest deviation relative to its tolerance
+   * until every deviation is within tolerance.  The first and last waypoints are always kept.
+   *
+   * When a planning scene is given the interpolated states replacing the removed waypoints must also be valid, so the
+   * output is checked at the same density as the input.  The duration of a removed waypoint is added to the next kept
+   * one, the velocities and accelerations of the kept waypoints are left as they were and should be recomputed.
+   * @param trajectory      The trajectory, decimated in place
+   * @param params          The tolerances
+   * @param planning_scene  The scene the interpolated states must be valid in, not checked if null
+   * @return The number of removed waypoints
+   */
+  std::size_t decimateTrajectory(robot_trajectory::RobotTrajectory &trajectory,
+                                 const TrajectoryDecimationParameters &params,
+                                 const planning_scene::PlanningScene *planning_scene = NULL);
+
+}
+
+#endif /* INDUSTRIAL_TRAJECTORY_UTILS_TRAJECTORY_DECIMATION_H_ */
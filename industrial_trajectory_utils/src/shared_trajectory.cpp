@@ -0,0 +1,134 @@
+/**
+ * @file shared_trajectory.cpp
+ * @brief This contains the immutable planner output handed to the consumers of the same process without conversion
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @license Software License Agreement (Apache License)\n
+ * \n
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at\n
+ * \n
+ * http://www.apache.org/licenses/LICENSE-2.0\n
+ * \n
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <industrial_trajectory_utils/shared_trajectory.h>
+
+namespace trajectory
+{
+  SharedTrajectoryConstPtr makeSharedTrajectory(const robot_trajectory::RobotTrajectory &trajectory)
+  {
+    const robot_model::JointModelGroup *group = trajectory.getGroup();
+    if (!group)
+      return SharedTrajectoryConstPtr();
+
+    const std::vector<const robot_model::JointModel*> &joints = group->getActiveJointModels();
+    std::size_t count = trajectory.getWayPointCount();
+    SharedTrajectoryPtr shared(new SharedTrajectory());
+    shared->group_name = group->getName();
+    shared->joint_names = group->getActiveJointModelNames();
+    shared->positions.resize(joints.size(), count);
+    shared->velocities.resize(joints.size(), count);
+    shared->accelerations.resize(joints.size(), count);
+    shared->time_from_start.resize(count);
+
+    double time = 0.0;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      const robot_state::RobotState &state = trajectory.getWayPoint(i);
+      for (std::size_t j = 0; j < joints.size(); ++j)
+      {
+        int index = joints[j]->getFirstVariableIndex();
+        shared->positions(j, i) = state.getVariablePosition(index);
+        shared->velocities(j, i) = state.hasVelocities() ? state.getVariableVelocity(index) : 0.0;
+        shared->accelerations(j, i) = state.hasAccelerations() ? state.getVariableAcceleration(index) : 0.0;
+      }
+      time += i > 0 ? trajectory.getWayPointDurationFromPrevious(i) : 0.0;
+      shared->time_from_start(i) = time;
+    }
+
+    if (shared->velocities.isZero(0.0) && shared->accelerations.isZero(0.0))
+    {
+      shared->velocities.resize(0, 0);
+      shared->accelerations.resize(0, 0);
+    }
+    return shared;
+  }
+
+  void toJointTrajectoryMsg(const SharedTrajectory &trajectory, trajectory_msgs::JointTrajectory &msg)
+  {
+    std::size_t num_joints = trajectory.joint_names.size();
+    bool timed = trajectory.velocities.cols() == trajectory.positions.cols();
+    msg.joint_names = trajectory.joint_names;
+    msg.points.resize(trajectory.getWayPointCount());
+    for (std::size_t i = 0; i < msg.points.size(); ++i)
+    {
+      trajectory_msgs::JointTrajectoryPoint &point = msg.points[i];
+      point.positions.assign(trajectory.positions.col(i).data(), trajectory.positions.col(i).data() + num_joints);
+      if (timed)
+      {
+        point.velocities.assign(trajectory.velocities.col(i).data(), trajectory.velocities.col(i).data() + num_joints);
+        point.accelerations.assign(trajectory.accelerations.col(i).data(),
+                                   trajectory.accelerations.col(i).data() + num_joints);
+      }
+      else
+      {
+        point.velocities.clear();
+        point.accelerations.clear();
+      }
+      point.effort.clear();
+      point.time_from_start = ros::Duration(trajectory.time_from_start(i));
+    }
+  }
+
+  bool toRobotTrajectory(const SharedTrajectory &trajectory, const robot_state::RobotState &reference,
+                         robot_trajectory::RobotTrajectory &output)
+  {
+    const robot_model::JointModelGroup *group = reference.getRobotModel()->getJointModelGroup(trajectory.group_name);
+    if (!group || group->getActiveJointModels().size() != trajectory.joint_names.size())
+    {
+      logError("Shared trajectory group '%s' does not match the robot model", trajectory.group_name.c_str());
+      return false;
+    }
+
+    std::vector<int> indices(trajectory.joint_names.size());
+    for (std::size_t j = 0; j < indices.size(); ++j)
+    {
+      const robot_model::JointModel *joint = reference.getRobotModel()->getJointModel(trajectory.joint_names[j]);
+      if (!joint)
+      {
+        logError("Shared trajectory joint '%s' does not exist", trajectory.joint_names[j].c_str());
+        return false;
+      }
+      indices[j] = joint->getFirstVariableIndex();
+    }
+
+    bool timed = trajectory.velocities.cols() == trajectory.positions.cols();
+    robot_state::RobotState state(reference);
+    output.clear();
+    for (std::size_t i = 0; i < trajectory.getWayPointCount(); ++i)
+    {
+      for (std::size_t j = 0; j < indices.size(); ++j)
+      {
+        state.setVariablePosition(indices[j], trajectory.positions(j, i));
+        state.setVariableVelocity(indices[j], timed ? trajectory.velocities(j, i) : 0.0);
+        state.setVariableAcceleration(indices[j], timed ? trajectory.accelerations(j, i) : 0.0);
+      }
+      state.update();
+      output.addSuffixWayPoint(state, i > 0 ? trajectory.time_from_start(i) - trajectory.time_from_start(i - 1) : 0.0);
+    }
+    return true;
+  }
+
+}
@@ -0,0 +1,157 @@
+/**
+ * @file trajectory_decimation.cpp
+ * @brief This contains the removal of the planner output waypoints that their neighbors interpolate within tolerance
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @license Software License Agreement (Apache License)\n
+ * \n
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at\n
+ * \n
+ * http://www.apache.org/licenses/LICENSE-2.0\n
+ * \n
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <industrial_trajectory_utils/trajectory_decimation.h>
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace trajectory
+{
+  std::size_t decimateTrajectory(robot_trajectory::RobotTrajectory &trajectory,
+                                 const TrajectoryDecimationParameters &params,
+                                 const planning_scene::PlanningScene *planning_scene)
+  {
+    const robot_model::JointModelGroup *group = trajectory.getGroup();
+    std::size_t count = trajectory.getWayPointCount();
+    if (!params.isEnabled() || !group || count < 3)
+      return 0;
+
+    const std::vector<const robot_model::JointModel*> &joints = group->getActiveJointModels();
+    const robot_model::LinkModel *tip = NULL;
+    if (params.cartesian_tolerance > 0.0)
+    {
+      const std::string &tip_name = params.tip_link.empty() ? group->getLinkModelNames().back() : params.tip_link;
+      tip = trajectory.getRobotModel()->getLinkModel(tip_name);
+      if (!tip)
+      {
+        logError("Trajectory decimation tip link '%s' does not exist, nothing removed", tip_name.c_str());
+        return 0;
+      }
+    }
+
+    // the interpolation fraction of a waypoint is its share of the joint space path length of its span
+    std::vector<double> length(count, 0.0);
+    for (std::size_t i = 1; i < count; ++i)
+      length[i] = length[i - 1] + trajectory.getWayPoint(i - 1).distance(trajectory.getWayPoint(i), group);
+
+    // the waypoints of the planners may not have up to date link transforms
+    robot_state::RobotState state(trajectory.getWayPoint(0));
+    std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> > tip_positions;
+    if (tip)
+    {
+      tip_positions.resize(count);
+      for (std::size_t i = 0; i < count; ++i)
+      {
+        state = trajectory.getWayPoint(i);
+        state.update();
+        tip_positions[i] = state.getGlobalLinkTransform(tip).translation();
+      }
+    }
+
+    std::vector<bool> keep(count, false);
+    keep[0] = true;
+    keep[count - 1] = true;
+
+    std::vector<std::pair<std::size_t, std::size_t> > spans(1, std::make_pair(std::size_t(0), count - 1));
+    while (!spans.empty())
+    {
+      std::size_t first = spans.back().first;
+      std::size_t last = spans.back().second;
+      spans.pop_back();
+      if (last - first < 2)
+        continue;
+
+      const robot_state::RobotState &first_state = trajectory.getWayPoint(first);
+      const robot_state::RobotState &last_state = trajectory.getWayPoint(last);
+      double span_length = length[last] - length[first];
+
+      // the deviations are relative to their tolerance, an invalid interpolated state must be kept
+      std::size_t worst = first;
+      double worst_deviation = 1.0;
+      for (std::size_t i = first + 1; i < last; ++i)
+      {
+        double fraction = span_length > 0.0 ? (length[i] - length[first]) / span_length : 0.0;
+        first_state.interpolate(last_state, fraction, state, group);
+        const robot_state::RobotState &waypoint = trajectory.getWayPoint(i);
+
+        double deviation = 0.0;
+        if (params.joint_tolerance > 0.0)
+        {
+          for (std::size_t j = 0; j < joints.size(); ++j)
+          {
+            double delta = joints[j]->distance(state.getJointPositions(joints[j]), waypoint.getJointPositions(joints[j]));
+            deviation = std::max(deviation, delta / params.joint_tolerance);
+          }
+        }
+
+        if (tip || planning_scene)
+          state.update();
+
+        if (tip)
+        {
+          double delta = (state.getGlobalLinkTransform(tip).translation() - tip_positions[i]).norm();
+          deviation = std::max(deviation, delta / params.cartesian_tolerance);
+        }
+
+        if (deviation <= 1.0 && planning_scene && !planning_scene->isStateValid(state, group->getName()))
+          deviation = std::numeric_limits<double>::max();
+
+        if (deviation > worst_deviation)
+        {
+          worst = i;
+          worst_deviation = deviation;
+        }
+      }
+
+      if (worst != first)
+      {
+        keep[worst] = true;
+        spans.push_back(std::make_pair(first, worst));
+        spans.push_back(std::make_pair(worst, last));
+      }
+    }
+
+    std::size_t removed = std::count(keep.begin(), keep.end(), false);
+    if (removed == 0)
+      return 0;
+
+    robot_trajectory::RobotTrajectory decimated(trajectory.getRobotModel(), group->getName());
+    double duration = 0.0;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      duration += trajectory.getWayPointDurationFromPrevious(i);
+      if (!keep[i])
+        continue;
+
+      decimated.addSuffixWayPoint(trajectory.getWayPoint(i), duration);
+      duration = 0.0;
+    }
+
+    trajectory.swap(decimated);
+    return removed;
+  }
+}
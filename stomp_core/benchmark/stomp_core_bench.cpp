@@ -0,0 +1,204 @@
+/**
+ * @file stomp_core_bench.cpp
+ * @brief This measures the cost of the stomp optimization steps as the problem size grows
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <benchmark/benchmark.h>
+#include <Eigen/Sparse>
+#include "stomp_core/stomp.h"
+#include "simple_optimization_task.h"
+
+namespace
+{
+
+using namespace stomp_core;
+
+const double DELTA_T = 0.1;                           /**< Timestep in seconds */
+const std::vector<int64_t> TIMESTEPS = {20, 80, 320};  /**< The numbers of timesteps swept */
+const std::vector<int64_t> DIMENSIONS = {3, 7};        /**< The numbers of dimensions swept */
+const std::vector<int64_t> ROLLOUTS = {10, 40};        /**< The numbers of rollouts swept */
+
+/**
+ * @brief Create a STOMP configuration for the given problem size, a single iteration is run to fill the rollouts.
+ * @param num_timesteps   The number of timesteps
+ * @param num_dimensions  The number of dimensions
+ * @param num_rollouts    The number of rollouts generated and kept
+ * @return  StompConfiguration
+ */
+StompConfiguration createConfiguration(int num_timesteps,int num_dimensions,int num_rollouts)
+{
+  StompConfiguration c;
+  c.num_timesteps = num_timesteps;
+  c.num_iterations = 1;
+  c.num_dimensions = num_dimensions;
+  c.delta_t = DELTA_T;
+  c.control_cost_weight = 0.1;
+  c.initialization_method = TrajectoryInitializations::MININUM_CONTROL_COST;
+  c.exponentiated_cost_sensitivity = 10.0;
+  c.num_iterations_after_valid = 0;
+  c.num_rollouts = num_rollouts;
+  c.max_rollouts = num_rollouts;
+  c.min_rollouts = 0;
+  c.seed = 0;
+  c.num_threads = 1;
+  c.window_size = 0;
+  c.num_control_points = 0;
+  c.single_precision = false;
+  c.streaming_block_size = 0;
+  c.convergence_iterations = 0;
+  c.convergence_cost_epsilon = 0.0;
+  c.convergence_update_threshold = 0.0;
+  c.max_optimization_time = 0.0;
+
+  return c;
+}
+
+/**
+ * @brief Exposes the optimization steps of Stomp.  Its constructor runs a single iteration of the
+ * SimpleOptimizationTask so that the rollouts, their costs and probabilities hold realistic values.
+ */
+class StompSteps: public Stomp
+{
+public:
+
+  StompSteps(int num_timesteps,int num_dimensions,int num_rollouts):
+    Stomp(createConfiguration(num_timesteps,num_dimensions,num_rollouts),createTask(num_timesteps,num_dimensions)),
+    first_(num_dimensions,0.0),
+    last_(num_dimensions,1.0)
+  {
+    Eigen::MatrixXd optimized;
+    solve(first_,last_,optimized);
+  }
+
+  /** @brief Computes the control costs of every rollout, as if they had all been generated in this iteration */
+  bool computeAllRolloutsControlCosts()
+  {
+    for(auto r = 0u; r < num_active_rollouts_; r++)
+    {
+      noisy_rollouts_.setDirty(r,true);
+    }
+    return computeRolloutsControlCosts();
+  }
+
+  /** @brief Computes the minimum control cost initial trajectory */
+  bool computeMinCostTrajectory()
+  {
+    return computeInitialTrajectory(first_,last_);
+  }
+
+  using Stomp::computeProbabilities;
+  using Stomp::updateParameters;
+
+protected:
+
+  static TaskPtr createTask(int num_timesteps,int num_dimensions)
+  {
+    return TaskPtr(new stomp_core_examples::SimpleOptimizationTask(Eigen::MatrixXd::Zero(num_dimensions,num_timesteps),
+                                                                   std::vector<double>(num_dimensions,0.1),
+                                                                   std::vector<double>(num_dimensions,0.1)));
+  }
+
+  std::vector<double> first_;   /**< The start of the initial trajectory */
+  std::vector<double> last_;    /**< The end of the initial trajectory */
+};
+
+/** @brief Sets the counters that relate the time per iteration to the problem size */
+void setCounters(benchmark::State& state)
+{
+  state.counters["timesteps"] = state.range(0);
+  state.counters["dimensions"] = state.range(1);
+  state.counters["rollouts"] = state.range(2);
+}
+
+void BM_computeProbabilities(benchmark::State& state)
+{
+  StompSteps stomp(state.range(0),state.range(1),state.range(2));
+  for(auto _ : state)
+  {
+    benchmark::DoNotOptimize(stomp.computeProbabilities());
+  }
+  setCounters(state);
+}
+
+void BM_updateParameters(benchmark::State& state)
+{
+  StompSteps stomp(state.range(0),state.range(1),state.range(2));
+  for(auto _ : state)
+  {
+    benchmark::DoNotOptimize(stomp.updateParameters());
+  }
+  setCounters(state);
+}
+
+void BM_computeRolloutsControlCosts(benchmark::State& state)
+{
+  StompSteps stomp(state.range(0),state.range(1),state.range(2));
+  for(auto _ : state)
+  {
+    benchmark::DoNotOptimize(stomp.computeAllRolloutsControlCosts());
+  }
+  setCounters(state);
+}
+
+void BM_computeMinCostTrajectory(benchmark::State& state)
+{
+  StompSteps stomp(state.range(0),state.range(1),state.range(2));
+  for(auto _ : state)
+  {
+    benchmark::DoNotOptimize(stomp.computeMinCostTrajectory());
+  }
+  setCounters(state);
+}
+
+void BM_generateFiniteDifferenceMatrixDense(benchmark::State& state)
+{
+  Eigen::MatrixXd diff_matrix;
+  for(auto _ : state)
+  {
+    generateFiniteDifferenceMatrix(state.range(0),DerivativeOrders::STOMP_ACCELERATION,DELTA_T,diff_matrix);
+    benchmark::DoNotOptimize(diff_matrix.data());
+  }
+  state.counters["timesteps"] = state.range(0);
+}
+
+void BM_generateFiniteDifferenceMatrixSparse(benchmark::State& state)
+{
+  Eigen::SparseMatrix<double> diff_matrix;
+  for(auto _ : state)
+  {
+    generateFiniteDifferenceMatrix(state.range(0),DerivativeOrders::STOMP_ACCELERATION,DELTA_T,diff_matrix);
+    benchmark::DoNotOptimize(diff_matrix.valuePtr());
+  }
+  state.counters["timesteps"] = state.range(0);
+}
+
+}
+
+BENCHMARK(BM_computeProbabilities)->ArgsProduct({TIMESTEPS,DIMENSIONS,ROLLOUTS});
+BENCHMARK(BM_updateParameters)->ArgsProduct({TIMESTEPS,DIMENSIONS,ROLLOUTS});
+BENCHMARK(BM_computeRolloutsControlCosts)->ArgsProduct({TIMESTEPS,DIMENSIONS,ROLLOUTS});
+BENCHMARK(BM_computeMinCostTrajectory)->ArgsProduct({TIMESTEPS,DIMENSIONS,{ROLLOUTS.front()}});
+BENCHMARK(BM_generateFiniteDifferenceMatrixDense)->ArgsProduct({TIMESTEPS});
+BENCHMARK(BM_generateFiniteDifferenceMatrixSparse)->ArgsProduct({TIMESTEPS});
+
+BENCHMARK_MAIN();
@@ -59,6 +59,17 @@ stomp_core::StompConfiguration create3DOFConfiguration()
   c.num_iterations_after_valid = 0;
   c.num_rollouts = 20;
   c.max_rollouts = 20;
+  c.min_rollouts = 0;
+  c.seed = 0;
+  c.num_threads = 1;
+  c.window_size = 0;
+  c.num_control_points = 0;
+  c.single_precision = false;
+  c.streaming_block_size = 0;
+  c.convergence_iterations = 0;
+  c.convergence_cost_epsilon = 0.0;
+  c.convergence_update_threshold = 0.0;
+  c.max_optimization_time = 0.0;
   //! [Create Config]
 
   return c;
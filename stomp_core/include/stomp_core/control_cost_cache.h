@@ -0,0 +1,80 @@
+/**
+ * @file control_cost_cache.h
+ * @brief This contains a process wide cache of the control cost matrices used by stomp
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef INDUSTRIAL_MOVEIT_STOMP_CORE_INCLUDE_STOMP_CORE_CONTROL_COST_CACHE_H_
+#define INDUSTRIAL_MOVEIT_STOMP_CORE_INCLUDE_STOMP_CORE_CONTROL_COST_CACHE_H_
+
+#include <memory>
+#include <stomp_core/utils.h>
+
+namespace stomp_core
+{
+
+/**
+ * @brief The finite difference and control cost matrices for a given number of timesteps, timestep and
+ * differentiation order.  The control cost matrices are scaled such that max(R^-1) == 1.
+ */
+struct ControlCostMatrices
+{
+  int num_timesteps;                                   /**< @brief The number of timesteps */
+  int num_timesteps_padded;                            /**< @brief The number of timesteps including padding: timesteps + 2*(FINITE_DIFF_RULE_LENGTH - 1) */
+  int start_index_padded;                              /**< @brief The index corresponding to the start of the non-paded section in the padded arrays */
+  Eigen::SparseMatrix<double> finite_diff_matrix_A_padded;   /**< @brief The banded finite difference matrix including padding */
+  Eigen::SparseMatrix<double> control_cost_matrix_R_padded;  /**< @brief The banded control cost matrix including padding */
+  Eigen::SparseMatrix<double> control_cost_matrix_R;         /**< @brief A banded matrix [timesteps][timesteps], Referred to as 'R = A x A_transpose' in the literature */
+  BandedCholesky control_cost_matrix_R_llt;                  /**< @brief The factorization of R, used to solve against R instead of storing the dense R^-1 matrix */
+  Eigen::VectorXd control_cost_matrix_R_inv_diagonal;        /**< @brief The diagonal of R^-1, the smoothing matrix M is R^-1 with its columns scaled by 1/(num_timesteps*diagonal) */
+};
+typedef std::shared_ptr<const ControlCostMatrices> ControlCostMatricesConstPtr; /**< Defines a shared ptr for type const ControlCostMatrices */
+typedef std::shared_ptr<const Eigen::MatrixXd> SmoothingMatrixConstPtr;         /**< Defines a shared ptr to a const smoothing matrix */
+
+/**
+ * @brief Returns the control cost matrices for the requested arguments, they are only computed the first time a
+ * combination of arguments is requested.  This function is thread safe.
+ * @param num_timesteps The number of timesteps
+ * @param dt            The timestep in seconds
+ * @param order         The differentiation order used to build the finite difference matrix
+ * @return The shared matrices or a null pointer if the control cost matrix could not be factorized.
+ */
+ControlCostMatricesConstPtr getControlCostMatrices(int num_timesteps, double dt,
+                                                   DerivativeOrders::DerivativeOrder order = DerivativeOrders::STOMP_ACCELERATION);
+
+/**
+ * @brief Returns the smoothing matrix M computed by generateSmoothingMatrix(), it is only computed the first time a
+ * combination of arguments is requested.  This function is thread safe.
+ * @param num_timesteps The number of timesteps
+ * @param dt            The timestep in seconds
+ * @return The shared smoothing matrix or a null pointer if the control cost matrix could not be factorized.
+ */
+SmoothingMatrixConstPtr getSmoothingMatrix(int num_timesteps, double dt);
+
+/**
+ * @brief Releases all the cached matrices, the ones still referenced by their users remain valid.
+ */
+void clearControlCostCache();
+
+} /* namespace stomp_core */
+
+#endif /* INDUSTRIAL_MOVEIT_STOMP_CORE_INCLUDE_STOMP_CORE_CONTROL_COST_CACHE_H_ */
@@ -0,0 +1,241 @@
+/**
+ * @file instrumentation.h
+ * @brief This defines the interface that receives the profile of every stomp iteration and its exporters
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef INDUSTRIAL_MOVEIT_STOMP_CORE_INCLUDE_STOMP_CORE_INSTRUMENTATION_H_
+#define INDUSTRIAL_MOVEIT_STOMP_CORE_INCLUDE_STOMP_CORE_INSTRUMENTATION_H_
+
+#include <array>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stomp_core/utils.h>
+
+namespace stomp_core
+{
+
+namespace IterationStages
+{
+/** @brief The timed steps of an iteration, in the order they run */
+enum IterationStage
+{
+  GENERATE_NOISY_ROLLOUTS = 0,      /**< Generates, filters and computes the state costs of the new rollouts */
+  COMPUTE_NOISY_ROLLOUTS_COSTS,     /**< Computes the control and total costs of the rollouts */
+  COMPUTE_PROBABILITIES,            /**< Computes the probabilities of the rollouts */
+  UPDATE_PARAMETERS,                /**< Computes and filters the parameter updates */
+  COMPUTE_OPTIMIZED_COST,           /**< Evaluates the updated parameters and accepts or rejects them */
+  NUM_STAGES
+};
+
+/**
+ * @brief Returns the name of a stage
+ * @param stage The stage
+ * @return The name of the Stomp method that implements the stage
+ */
+const char* getName(IterationStage stage);
+}
+
+/** @brief The profile of a single iteration of Stomp::solve() */
+struct IterationProfile
+{
+  typedef std::chrono::steady_clock Clock;
+
+  unsigned int iteration;                           /**< @brief The iteration number, starting at 1 */
+  int num_stages;                                   /**< @brief The number of stages that ran, a stage that fails or reaches the deadline ends the iteration */
+  bool completed;                                   /**< @brief Whether all the stages succeeded */
+  std::array<Clock::time_point,IterationStages::NUM_STAGES> stage_starts;  /**< @brief The time at which each stage started */
+  std::array<double,IterationStages::NUM_STAGES> stage_durations;          /**< @brief The wall time of each stage in seconds, 0 if it did not run */
+  int rollouts_generated;                           /**< @brief The number of new rollouts */
+  int rollouts_reused;                              /**< @brief The number of rollouts reused from the previous iteration */
+  int rollouts_active;                              /**< @brief The number of rollouts used by the update, including the optimized parameters */
+  double min_rollout_cost;                          /**< @brief The lowest total cost of the active rollouts, only set when the costs were computed */
+  double mean_rollout_cost;                         /**< @brief The mean total cost of the active rollouts, only set when the costs were computed */
+  double max_rollout_cost;                          /**< @brief The highest total cost of the active rollouts, only set when the costs were computed */
+  double optimized_cost;                            /**< @brief The lowest cost of the optimized parameters at the end of the iteration */
+  bool valid;                                       /**< @brief Whether the optimized parameters are valid at the end of the iteration */
+
+  /**
+   * @brief Clears the profile for a new iteration
+   * @param iteration The iteration number
+   */
+  void reset(unsigned int iteration);
+
+  /**
+   * @brief Runs and times a stage, the stages must be run in order.
+   * @param stage The stage
+   * @param step  Callable that runs the stage and returns whether it succeeded
+   * @return The result of the step
+   */
+  template<typename Step>
+  bool timeStage(IterationStages::IterationStage stage,Step step)
+  {
+    stage_starts[stage] = Clock::now();
+    bool success = step();
+    stage_durations[stage] = std::chrono::duration<double>(Clock::now() - stage_starts[stage]).count();
+    num_stages = stage + 1;
+    return success;
+  }
+};
+
+/** @brief The outcome of a call to Stomp::solve() */
+struct SolveProfile
+{
+  std::chrono::steady_clock::time_point start;      /**< @brief The time at which the optimization started */
+  std::chrono::steady_clock::time_point end;        /**< @brief The time at which the optimization ended */
+  TerminationReasons::TerminationReason reason;     /**< @brief Why the optimization stopped iterating */
+  unsigned int iterations;                          /**< @brief The number of iterations run, see Stomp::getNumIterations() */
+  double cost;                                      /**< @brief The lowest cost of the optimized parameters */
+  bool valid;                                       /**< @brief Whether the optimized parameters are valid */
+};
+
+/**
+ * @brief Receives the profile of every iteration of the Stomp instances it is attached to.  The profiles are only
+ * recorded when stomp_core is built with the STOMP_CORE_INSTRUMENTATION option, otherwise the instrumentation
+ * compiles to nothing and the sink is never called.  Several Stomp instances optimizing concurrently may share a
+ * sink, the methods are then called from their threads and must be thread-safe.  They are called from the
+ * optimization loop and should return quickly.
+ */
+class InstrumentationSink
+{
+public:
+  virtual ~InstrumentationSink(){}
+
+  /**
+   * @brief Called at the end of every iteration, including an iteration that fails or reaches the deadline.
+   * @param profile The profile of the iteration
+   */
+  virtual void recordIteration(const IterationProfile& profile) = 0;
+
+  /**
+   * @brief Called at the end of every call to Stomp::solve() that ran the optimization loop.
+   * @param profile The profile of the optimization
+   */
+  virtual void recordSolve(const SolveProfile& profile) {}
+};
+
+typedef std::shared_ptr<InstrumentationSink> InstrumentationSinkPtr; /**< @brief Type definition for the instrumentation sink shared pointer */
+
+/**
+ * @brief Checks whether the profiles are recorded
+ * @return True if stomp_core was built with the STOMP_CORE_INSTRUMENTATION option, otherwise false.
+ */
+bool isInstrumentationEnabled();
+
+/** @brief Forwards the profiles to several sinks, in the order they were added */
+class InstrumentationSinkGroup: public InstrumentationSink
+{
+public:
+  /**
+   * @brief Adds a sink, it must not be called while the group is attached to an optimization in progress.
+   * @param sink The sink
+   */
+  void add(InstrumentationSinkPtr sink);
+
+  /** @brief See base class for documentation */
+  void recordIteration(const IterationProfile& profile) override;
+
+  /** @brief See base class for documentation */
+  void recordSolve(const SolveProfile& profile) override;
+
+protected:
+  std::vector<InstrumentationSinkPtr> sinks_;       /**< @brief The sinks */
+};
+
+/**
+ * @brief Writes the profiles to a file in the Chrome trace event format, which chrome://tracing and Perfetto display as
+ * a timeline.  Each solve, iteration and stage is a complete event on the track of the thread that ran the
+ * optimization, the rollout counts and costs are the arguments of the iteration events.  The events are kept in memory
+ * and the whole file is rewritten at the end of every solve.
+ */
+class ChromeTraceSink: public InstrumentationSink
+{
+public:
+  /**
+   * @brief Constructor
+   * @param file_name   The file to write
+   * @param capacity    The number of events kept, the oldest ones are dropped
+   */
+  ChromeTraceSink(const std::string& file_name,std::size_t capacity = 100000);
+
+  /** @brief See base class for documentation */
+  void recordIteration(const IterationProfile& profile) override;
+
+  /** @brief See base class for documentation */
+  void recordSolve(const SolveProfile& profile) override;
+
+  /**
+   * @brief Writes the events kept to the file
+   * @return True if the file was written, otherwise false.
+   */
+  bool write() const;
+
+protected:
+
+  /** @brief A complete event */
+  struct Event
+  {
+    std::string name;                               /**< @brief The event name */
+    double timestamp;                               /**< @brief The start time in microseconds since the sink was created */
+    double duration;                                /**< @brief The duration in microseconds */
+    int thread;                                     /**< @brief The track of the event */
+    std::string args;                               /**< @brief The arguments as a JSON object, may be empty */
+  };
+
+  /**
+   * @brief Adds an event, the mutex must be locked
+   * @param name  The event name
+   * @param start The start time
+   * @param duration  The duration in seconds
+   * @param args  The arguments as a JSON object, may be empty
+   */
+  void addEvent(const std::string& name,const std::chrono::steady_clock::time_point& start,double duration,
+                const std::string& args);
+
+  std::string file_name_;                           /**< @brief The file written */
+  std::size_t capacity_;                            /**< @brief The number of events kept */
+  mutable std::mutex mutex_;                        /**< @brief Guards the events */
+  std::deque<Event> events_;                        /**< @brief The events, the oldest first */
+  std::chrono::steady_clock::time_point origin_;    /**< @brief The time at which the sink was created, the origin of the timestamps */
+  std::map<std::thread::id,int> threads_;           /**< @brief The track of each thread that recorded events */
+};
+
+} /* namespace stomp_core */
+
+#ifdef STOMP_CORE_INSTRUMENTATION
+/** @brief Runs a stage through IterationProfile::timeStage() when the sink is not null, otherwise runs it directly */
+#define STOMP_CORE_INSTRUMENT_STAGE(sink, profile, stage, step) \
+  ((sink) ? (profile).timeStage((stage), [&]() { return static_cast<bool>(step); }) : static_cast<bool>(step))
+/** @brief Runs a statement when the sink is not null */
+#define STOMP_CORE_INSTRUMENT(sink, statement) do { if (sink) { statement; } } while (0)
+#else
+#define STOMP_CORE_INSTRUMENT_STAGE(sink, profile, stage, step) static_cast<bool>(step)
+#define STOMP_CORE_INSTRUMENT(sink, statement) do {} while (0)
+#endif
+
+#endif /* INDUSTRIAL_MOVEIT_STOMP_CORE_INCLUDE_STOMP_CORE_INSTRUMENTATION_H_ */
@@ -0,0 +1,152 @@
+/**
+ * @file rollout_buffer.h
+ * @brief This contains the structure-of-arrays storage of the stomp noisy rollouts
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef INDUSTRIAL_MOVEIT_STOMP_CORE_INCLUDE_STOMP_CORE_ROLLOUT_BUFFER_H_
+#define INDUSTRIAL_MOVEIT_STOMP_CORE_INCLUDE_STOMP_CORE_ROLLOUT_BUFFER_H_
+
+#include <vector>
+#include <Eigen/Core>
+
+namespace stomp_core
+{
+
+/**
+ * @brief Stores every quantity of the noisy rollouts in its own array indexed by rollout.
+ *
+ * The quantities that carry over from one iteration to the next (noise, parameters, state costs and weights) live in
+ * storage slots that are addressed through a permutation, therefore reordering the rollouts only moves indices.  The
+ * quantities that are recomputed every iteration from those (total costs and probabilities) are kept in contiguous
+ * [rollouts][timesteps] blocks per dimension, in rollout order, so that they can be processed with array expressions.
+ * A copy of the noise is kept in the same layout so that the parameter updates reduce contiguous blocks.  In single
+ * precision those blocks are stored as floats instead, the streaming update doesn't store them at all.
+ */
+class RolloutBuffer
+{
+public:
+
+  RolloutBuffer();
+
+  /**
+   * @brief Allocates the storage and resets the rollout order, all quantities are zeroed and every rollout is dirty.
+   * @param max_rollouts      The maximum number of rollouts
+   * @param num_dimensions    The parameter dimensionality
+   * @param num_timesteps     The number of timesteps
+   * @param importance_weight The initial importance weight of every rollout
+   * @param single_precision  Whether the per dimension blocks are allocated in single instead of double precision
+   * @param dimension_blocks  Whether the per dimension blocks are allocated at all, the streaming update doesn't use them
+   */
+  void resize(int max_rollouts,int num_dimensions,int num_timesteps,double importance_weight,
+              bool single_precision = false,bool dimension_blocks = true);
+
+  /**
+   * @brief Moves the rollouts at the positions 'source_indices' to the positions [first, first + source_indices.size()).
+   * The storage of the rollouts at the remaining positions is handed out to the positions left over in an unspecified
+   * order. No rollout data is copied and no memory is allocated.
+   * @param source_indices  The current positions of the rollouts to move, must be unique
+   * @param count           The number of entries of 'source_indices' to use
+   * @param first           The position that receives the first rollout
+   */
+  void reorder(const std::vector<int>& source_indices,int count,int first);
+
+  /** @brief The maximum number of rollouts */
+  int size() const { return static_cast<int>(slots_.size()); }
+
+  /** @brief A matrix [num_dimensions][num_time_steps] of random noise applied to the parameters of rollout r */
+  Eigen::MatrixXd& noise(int r) { return noise_[slots_[r]]; }
+
+  /** @brief A matrix [num_dimensions][num_time_steps] of the sum of parameters + noise of rollout r */
+  Eigen::MatrixXd& parametersNoise(int r) { return parameters_noise_[slots_[r]]; }
+
+  /** @brief A vector [num_time_steps] of the state cost at each timestep of rollout r */
+  Eigen::VectorXd& stateCosts(int r) { return state_costs_[slots_[r]]; }
+
+  /** @brief A matrix [num_dimensions][num_time_steps] of the control cost of each parameter of rollout r */
+  Eigen::MatrixXd& controlCosts(int r) { return control_costs_[slots_[r]]; }
+
+  /** @brief The importance sampling weight of rollout r */
+  double& importanceWeight(int r) { return importance_weights_(slots_[r]); }
+
+  /** @brief The combined state + control cost over the entire trajectory for all joints of rollout r */
+  double& totalCost(int r) { return total_cost_(slots_[r]); }
+
+  /** @brief Whether the parameters of rollout r changed since its control costs were last computed */
+  bool isDirty(int r) const { return dirty_[slots_[r]] != 0; }
+
+  /** @brief Marks the parameters of rollout r as changed or as matching its control costs */
+  void setDirty(int r,bool dirty) { dirty_[slots_[r]] = dirty ? 1 : 0; }
+
+  /** @brief A matrix [rollouts][num_time_steps] of the total cost of dimension d, state_costs + control_costs.row(d) */
+  Eigen::MatrixXd& totalCosts(int d) { return total_costs_[d]; }
+
+  /** @brief A matrix [rollouts][num_time_steps] of the probability of dimension d at every timestep */
+  Eigen::MatrixXd& probabilities(int d) { return probabilities_[d]; }
+
+  /** @brief A matrix [rollouts][num_time_steps] of the noise of dimension d in rollout order */
+  Eigen::MatrixXd& dimensionNoise(int d) { return dimension_noise_[d]; }
+
+  /** @brief Single precision version of totalCosts(), only allocated in single precision */
+  Eigen::MatrixXf& singleTotalCosts(int d) { return single_total_costs_[d]; }
+
+  /** @brief Single precision version of probabilities(), only allocated in single precision */
+  Eigen::MatrixXf& singleProbabilities(int d) { return single_probabilities_[d]; }
+
+  /** @brief Single precision version of dimensionNoise(), only allocated in single precision */
+  Eigen::MatrixXf& singleNoise(int d) { return single_noise_[d]; }
+
+  /** @brief A matrix [rollouts][num_dimensions] of the full cost, state_cost.sum() + control_cost[d].sum() */
+  Eigen::MatrixXd& fullCosts() { return full_costs_; }
+
+  /** @brief A matrix [rollouts][num_dimensions] of the probabilities for the full trajectory */
+  Eigen::MatrixXd& fullProbabilities() { return full_probabilities_; }
+
+protected:
+
+  std::vector<int> slots_;                          /**< @brief Maps each rollout position to its storage slot */
+  std::vector<int> reordered_slots_;                /**< @brief Workspace used to build the new permutation */
+  std::vector<bool> slot_taken_;                    /**< @brief Workspace used to track the slots handed out */
+
+  // slot indexed quantities
+  std::vector<Eigen::MatrixXd> noise_;              /**< @brief The noise of each slot */
+  std::vector<Eigen::MatrixXd> parameters_noise_;   /**< @brief The noisy parameters of each slot */
+  std::vector<Eigen::VectorXd> state_costs_;        /**< @brief The state costs of each slot */
+  std::vector<Eigen::MatrixXd> control_costs_;      /**< @brief The control costs of each slot */
+  Eigen::VectorXd importance_weights_;              /**< @brief The importance weight of each slot */
+  Eigen::VectorXd total_cost_;                      /**< @brief The total cost of each slot */
+  std::vector<char> dirty_;                         /**< @brief Whether each slot changed, a byte per slot so that workers can flag distinct slots concurrently */
+
+  // position indexed quantities
+  std::vector<Eigen::MatrixXd> total_costs_;        /**< @brief Per dimension [rollouts][timesteps] total costs */
+  std::vector<Eigen::MatrixXd> probabilities_;      /**< @brief Per dimension [rollouts][timesteps] probabilities */
+  std::vector<Eigen::MatrixXd> dimension_noise_;    /**< @brief Per dimension [rollouts][timesteps] noise */
+  Eigen::MatrixXd full_costs_;                      /**< @brief [rollouts][dimensions] full costs */
+  Eigen::MatrixXd full_probabilities_;              /**< @brief [rollouts][dimensions] full probabilities */
+  std::vector<Eigen::MatrixXf> single_total_costs_;   /**< @brief Per dimension [rollouts][timesteps] total costs in single precision */
+  std::vector<Eigen::MatrixXf> single_probabilities_; /**< @brief Per dimension [rollouts][timesteps] probabilities in single precision */
+  std::vector<Eigen::MatrixXf> single_noise_;         /**< @brief Per dimension [rollouts][timesteps] noise in single precision */
+};
+
+} /* namespace stomp_core */
+
+#endif /* INDUSTRIAL_MOVEIT_STOMP_CORE_INCLUDE_STOMP_CORE_ROLLOUT_BUFFER_H_ */
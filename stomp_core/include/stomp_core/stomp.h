@@ -27,9 +27,15 @@
 #define INDUSTRIAL_MOVEIT_STOMP_CORE_INCLUDE_STOMP_CORE_STOMP_H_
 
 #include <atomic>
+#include <chrono>
+#include <mutex>
 #include <stomp_core/utils.h>
+#include <stomp_core/control_cost_cache.h>
 #include <XmlRpc.h>
+#include "stomp_core/instrumentation.h"
+#include "stomp_core/rollout_buffer.h"
 #include "stomp_core/task.h"
+#include "stomp_core/thread_pool.h"
 
 namespace stomp_core
 {
@@ -50,29 +56,69 @@ public:
    * @param first Start state for the task
    * @param last Final state for the task
    * @param parameters_optimized Optimized solution [parameters][timesteps]
+   * @param deadline The optimization stops as soon as this time is reached, see solve(initial_parameters,...)
    * @return True if solution was found, otherwise false.
    */
   bool solve(const std::vector<double>& first,const std::vector<double>& last,
-             Eigen::MatrixXd& parameters_optimized);
+             Eigen::MatrixXd& parameters_optimized,
+             const std::chrono::steady_clock::time_point& deadline = std::chrono::steady_clock::time_point::max());
 
   /**
    * @brief Find the optimal solution provided a start and end goal.
    * @param first Start state for the task
    * @param last Final state for the task
    * @param parameters_optimized Optimized solution [Parameters][timesteps]
+   * @param deadline The optimization stops as soon as this time is reached, see solve(initial_parameters,...)
    * @return True if solution was found, otherwise false.
    */
   bool solve(const Eigen::VectorXd& first,const Eigen::VectorXd& last,
-             Eigen::MatrixXd& parameters_optimized);
+             Eigen::MatrixXd& parameters_optimized,
+             const std::chrono::steady_clock::time_point& deadline = std::chrono::steady_clock::time_point::max());
 
   /**
    * @brief Find the optimal solution provided an intial guess.
    * @param initial_parameters A matrix [Parameters][timesteps]
    * @param parameters_optimized The optimized solution [Parameters][timesteps]
+   * @param deadline The optimization stops as soon as this time is reached.  It is checked before every rollout
+   * evaluation and every step of an iteration, an interrupted iteration is discarded and the lowest cost parameters
+   * found so far are returned with the TerminationReasons::TIME_LIMIT reason.
    * @return True if solution was found, otherwise false.
    */
   bool solve(const Eigen::MatrixXd& initial_parameters,
-             Eigen::MatrixXd& parameters_optimized);
+             Eigen::MatrixXd& parameters_optimized,
+             const std::chrono::steady_clock::time_point& deadline = std::chrono::steady_clock::time_point::max());
+
+  /**
+   * @brief Continues the optimization of the last solution in a receding horizon fashion, e.g. while replanning
+   * towards a moving goal.  The optimized trajectory and the rollouts kept for reuse are shifted forward by the
+   * executed timesteps, as many timesteps are appended at their end, holding the last configuration, and the offset
+   * to the new goal is blended in linearly so that the first timestep stays at the current state.  The cached
+   * matrices and the preserved rollouts carry over, the internal variables are not reset.
+   * @param executed_timesteps The number of timesteps executed since the last solution, less than 'num_timesteps'
+   * @param goal The goal of the shifted trajectory [Parameters]
+   * @param parameters_optimized The optimized solution [Parameters][timesteps]
+   * @param deadline The optimization stops as soon as this time is reached, see solve(initial_parameters,...)
+   * @return True if solution was found, otherwise false.
+   */
+  bool solveRecedingHorizon(std::size_t executed_timesteps,const Eigen::VectorXd& goal,
+                            Eigen::MatrixXd& parameters_optimized,
+                            const std::chrono::steady_clock::time_point& deadline = std::chrono::steady_clock::time_point::max());
+
+  /**
+   * @brief Optimizes a fixed window of timesteps of a trajectory while the remaining ones are held, e.g. to repair the
+   * part of a trajectory that became invalid.  Only the window is perturbed and its costs evaluated through the
+   * 'start_timestep' and 'num_timesteps' arguments of the task, the duration of an iteration therefore scales with the
+   * size of the window.  The configured 'window_size' is restored afterwards.
+   * @param initial_parameters The trajectory to repair [Parameters][timesteps]
+   * @param window_start The first timestep of the window
+   * @param window_timesteps The number of timesteps of the window
+   * @param parameters_optimized The optimized solution [Parameters][timesteps]
+   * @param deadline The optimization stops as soon as this time is reached, see solve(initial_parameters,...)
+   * @return True if solution was found, otherwise false.
+   */
+  bool solveWindow(const Eigen::MatrixXd& initial_parameters,std::size_t window_start,std::size_t window_timesteps,
+                   Eigen::MatrixXd& parameters_optimized,
+                   const std::chrono::steady_clock::time_point& deadline = std::chrono::steady_clock::time_point::max());
 
   /**
    * @brief Sets the configuration and resets all internal variables
@@ -93,6 +139,49 @@ public:
    */
   bool clear();
 
+  /**
+   * @brief Returns the reason for which the last call to solve() stopped iterating.
+   * @return TerminationReasons::TerminationReason
+   */
+  TerminationReasons::TerminationReason getTerminationReason() const;
+
+  /**
+   * @brief Returns the lowest cost of the optimized parameters found by the last call to solve().
+   * @return The total cost [Control Cost + State Cost]
+   */
+  double getOptimizedCost() const;
+
+  /**
+   * @brief Returns the number of iterations run by the last call to solve().
+   * @return The iteration at which the optimization stopped, an interrupted iteration is counted.
+   */
+  unsigned int getNumIterations() const;
+
+  /**
+   * @brief Copies the lowest cost valid parameters found so far by the optimization in progress or the last one.
+   * This method is thread-safe and meant to be polled from another thread while solve() runs, the snapshot is updated
+   * at the end of every iteration that finds a better valid trajectory.
+   * @param parameters  Returns the valid parameters [Parameters][timesteps]
+   * @param cost        Returns the total cost of the valid parameters
+   * @param iteration   Returns the iteration at which the parameters were found, 0 for the initial trajectory
+   * @return True if a valid trajectory has been found, otherwise false.
+   */
+  bool getBestValidParameters(Eigen::MatrixXd& parameters,double& cost,unsigned int& iteration) const;
+
+  /**
+   * @brief Sets the sink that receives the profile of every iteration, it must not be called while solve() runs.  The
+   * profiles are only recorded when stomp_core is built with the STOMP_CORE_INSTRUMENTATION option.
+   * @param sink The sink, a null pointer disables the profiling
+   */
+  void setInstrumentationSink(InstrumentationSinkPtr sink);
+
+  /**
+   * @brief Evaluates the rollouts with a pool shared by other optimizers, such as every planner of a process, instead
+   * of one owned by this optimizer.  The 'num_threads' parameter then follows the size of the pool, the task must
+   * allocate as many workers.  It must not be called while solve() runs.
+   * @param pool  The shared pool, a null pointer creates an own pool of 'num_threads' again
+   */
+  void setThreadPool(ThreadPoolPtr pool);
 
 protected:
 
@@ -112,6 +201,24 @@ protected:
   bool computeInitialTrajectory(const std::vector<double>& first,const std::vector<double>& last);
 
   // optimization steps
+  /**
+   * @brief Sets the window of timesteps perturbed on each iteration and allocates its cost buffers.
+   * @param window_start The first timestep of the window
+   * @param window_timesteps The number of timesteps of the window
+   * @param fixed True to hold the window in place and the timesteps outside of it fixed, false to slide it over the
+   *              trajectory when it is shorter than the trajectory
+   */
+  void setOptimizationWindow(int window_start,int window_timesteps,bool fixed);
+
+  /**
+   * @brief Shifts a trajectory forward, the appended timesteps hold its last configuration, and blends in an offset
+   * that grows linearly from zero at the first timestep to 'goal_offset' at the last one.
+   * @param executed_timesteps The number of timesteps to shift by
+   * @param goal_offset The offset added to the last timestep [Parameters]
+   * @param trajectory The trajectory [Parameters][timesteps], modified in place
+   */
+  void shiftTrajectory(int executed_timesteps,const Eigen::VectorXd& goal_offset,Eigen::MatrixXd& trajectory) const;
+
   /**
    * @brief Run a single iteration of the stomp algorithm
    * @return True if it was able to succesfully perform a single iteration. False
@@ -120,34 +227,58 @@ protected:
   bool runSingleIteration();
 
   /**
-   * @brief Generate a set of noisy rollouts
+   * @brief Generate a set of noisy rollouts, each new rollout is generated, filtered and has its state costs computed
+   * by the same worker so that its data stays in that core's cache.  The rollouts are distributed among 'num_threads'
+   * threads, see Task for the thread-safety requirements.
    * @return True if sucessful, otherwise false.
    */
   bool generateNoisyRollouts();
 
   /**
-   * @brief Applies the optimization task's filter methods to the noisy trajectories.
+   * @brief Generates the noise of a new rollout, when 'window_size' is used only the window is perturbed.  When
+   * 'num_control_points' is used the noise is first projected onto the spline basis.
+   * @param r       The rollout position
+   * @param worker  The worker index of the calling thread
    * @return True if sucessful, otherwise false.
    */
-  bool filterNoisyRollouts();
+  bool generateNoisyRollout(int r,std::size_t worker);
 
   /**
-   * @brief Computes the total cost for each of the noisy rollouts.
+   * @brief Applies the optimization task's filter methods to a new noisy rollout.
+   * @param r The rollout position
    * @return True if sucessful, otherwise false.
    */
-  bool computeNoisyRolloutsCosts();
+  bool filterNoisyRollout(int r);
 
   /**
-   * @brief Computes the cost at every timestep for each noisy rollout.
+   * @brief Computes the cost at every timestep of a new noisy rollout.
+   * When 'window_size' is used only the window is evaluated and the remaining timesteps take the optimized parameters costs.
+   * @param r       The rollout position
+   * @param worker  The worker index of the calling thread
    * @return True if sucessful, otherwise false.
    */
-  bool computeRolloutsStateCosts();
+  bool computeRolloutStateCosts(int r,std::size_t worker);
+
+  /**
+   * @brief Computes the cost at every timestep of all the new noisy rollouts with a single call to the task, used when
+   * Task::supportsBatchCosts() is true.  When 'window_size' is used the remaining timesteps take the optimized parameters costs.
+   * @param num_rollouts The number of new rollouts, their parameters have been copied into the batch
+   * @return True if sucessful, otherwise false.
+   */
+  bool computeRolloutsStateCostsBatch(int num_rollouts);
+
+  /**
+   * @brief Computes the total cost for each of the noisy rollouts.
+   * @return True if sucessful, otherwise false.
+   */
+  bool computeNoisyRolloutsCosts();
 
   /**
    * @brief Compute the control cost for each noisy rollout.
    * This is the sum of the acceleration squared, then each
    * noisy rollouts control cost is divided by the maximum
-   * control cost found amoung the noisy rollouts.
+   * control cost found amoung the noisy rollouts.  The noise of
+   * all the rollouts is stacked and multiplied by R at once.
    * @return True if sucessful, otherwise false.
    */
   bool computeRolloutsControlCosts();
@@ -172,6 +303,44 @@ protected:
    */
   bool computeOptimizedCost();
 
+  /**
+   * @brief Checks the convergence criteria at the end of an iteration
+   * @param reason Set to the criterion that was met
+   * @return True if the optimization has converged, otherwise false.
+   */
+  bool checkConvergence(TerminationReasons::TerminationReason& reason);
+
+  /**
+   * @brief Adapts the number of new rollouts generated per iteration to the cost improvement of the last iteration
+   * when 'min_rollouts' is enabled.  The count grows while the cost of an invalid trajectory does not improve and shrinks
+   * as the cost converges.
+   * @param previous_cost The lowest cost before the last iteration
+   */
+  void adaptRolloutCount(double previous_cost);
+
+  /**
+   * @brief Checks whether the deadline of the current optimization has been reached
+   * @return True if the optimization must stop, otherwise false.
+   */
+  bool deadlineReached() const;
+
+  /**
+   * @brief Records the optimized parameters as the best valid ones when they are valid and cheaper than the current best.
+   */
+  void updateBestValidParameters();
+
+  /**
+   * @brief Hands the best valid parameters over to getBestValidParameters() if they changed since the last call.
+   * @param wait  Whether to wait for a concurrent reader to finish, otherwise the hand over is retried on the next call.
+   */
+  void publishBestValidParameters(bool wait);
+
+  /**
+   * @brief Completes the profile of the current iteration with its rollout counts and costs and hands it to the sink.
+   * @param completed Whether all the stages of the iteration succeeded
+   */
+  void recordIterationProfile(bool completed);
+
 protected:
 
   // process control
@@ -179,6 +348,14 @@ protected:
   TaskPtr task_;                                   /**< @brief The task to be optimized. */
   StompConfiguration config_;                      /**< @brief Configuration parameters. */
   unsigned int current_iteration_;                 /**< @brief Current iteration for the optimization. */
+  TerminationReasons::TerminationReason termination_reason_; /**< @brief Why the last optimization stopped iterating */
+  std::chrono::steady_clock::time_point solve_start_time_;   /**< @brief The time at which the last optimization started */
+  std::chrono::steady_clock::time_point deadline_;           /**< @brief The earliest of the solve() deadline and 'max_optimization_time' */
+  std::vector<double> cost_history_;               /**< @brief Ring buffer with the lowest cost of the last 'convergence_iterations' iterations */
+  ThreadPoolPtr thread_pool_;                      /**< @brief Evaluates the noisy rollouts concurrently when 'num_threads' > 1 */
+  bool shared_thread_pool_;                        /**< @brief Whether the pool was set by setThreadPool() and its size overrides 'num_threads' */
+  InstrumentationSinkPtr instrumentation_sink_;    /**< @brief Receives the profile of every iteration, may be null */
+  IterationProfile iteration_profile_;             /**< @brief The profile of the current iteration */
 
   // optimized parameters
   bool parameters_valid_;                          /**< @brief whether or not the optimized parameters are valid */
@@ -188,19 +365,83 @@ protected:
   Eigen::MatrixXd parameters_updates_;             /**< @brief A matrix [dimensions][timesteps] of the parameter updates*/
   Eigen::VectorXd parameters_state_costs_;         /**< @brief A vector [timesteps] of the parameters state costs */
   Eigen::MatrixXd parameters_control_costs_;       /**< @brief A matrix [dimensions][timesteps] of the parameters control costs*/
+  Eigen::VectorXd candidate_state_costs_;          /**< @brief The state costs of the updated parameters before they are accepted */
+  Eigen::MatrixXd candidate_control_costs_;        /**< @brief The control costs of the updated parameters before they are accepted */
+  bool parameters_dirty_;                          /**< @brief Whether the optimized parameters changed since their costs were computed */
+
+  // best valid parameters, double buffered so that readers never wait for the optimization
+  Eigen::MatrixXd best_valid_parameters_;          /**< @brief A matrix [dimensions][timesteps] of the lowest cost valid parameters */
+  double best_valid_cost_;                         /**< @brief The total cost of the best valid parameters */
+  unsigned int best_valid_iteration_;              /**< @brief The iteration at which the best valid parameters were found */
+  bool best_valid_pending_;                        /**< @brief Whether the best valid parameters have not been published yet */
+  mutable std::mutex published_mutex_;             /**< @brief Guards the published best valid parameters */
+  Eigen::MatrixXd published_parameters_;           /**< @brief The best valid parameters returned by getBestValidParameters() */
+  double published_cost_;                          /**< @brief The total cost of the published parameters */
+  unsigned int published_iteration_;               /**< @brief The iteration at which the published parameters were found */
+  bool published_valid_;                           /**< @brief Whether valid parameters have been published */
 
   // rollouts
-  std::vector<Rollout> noisy_rollouts_;            /**< @brief Holds the noisy rollouts */
-  std::vector<Rollout> reused_rollouts_;           /**< @brief Used for reordering arrays based on cost */
+  RolloutBuffer noisy_rollouts_;                   /**< @brief Holds the noisy rollouts */
+  std::vector<int> reused_rollout_indices_;        /**< @brief The rollouts reused from the previous iteration, ordered by cost */
   int num_active_rollouts_;                        /**< @brief Number of active rollouts */
+  int num_rollouts_;                               /**< @brief Number of new rollouts generated on each iteration, see 'min_rollouts' */
+
+  // optimization window
+  int window_start_;                               /**< @brief The first timestep perturbed in the current iteration */
+  int window_timesteps_;                           /**< @brief The number of timesteps perturbed on each iteration */
+  bool fixed_window_;                              /**< @brief Whether the window stays in place and the timesteps outside of it are held */
+  std::vector<Eigen::VectorXd> window_state_costs_; /**< @brief Per worker vector that receives the state costs of the window */
+
+  // task interface
+  bool ref_interface_;                             /**< @brief Whether the task is called through its Eigen::Ref based methods */
+
+  // batch cost evaluation
+  bool batch_costs_;                               /**< @brief Whether the task evaluates the new rollouts in a single batch */
+  Eigen::MatrixXd batch_parameters_;               /**< @brief A matrix [num_dimensions][num_rollouts x num_timesteps] of the new noisy parameters */
+  Eigen::MatrixXd batch_state_costs_;              /**< @brief A matrix [num_rollouts][window timesteps] of the new rollouts state costs */
+  std::vector<bool> batch_validities_;             /**< @brief The validity of each new rollout */
+
+  // spline parameterization, empty when every timestep is optimized directly
+  Eigen::MatrixXd spline_basis_;                   /**< @brief A matrix [control points][timesteps] that expands the control points to timesteps */
+  Eigen::MatrixXd spline_projection_;              /**< @brief A matrix [timesteps][control points], the least squares fit of a trajectory by control points */
+  Eigen::MatrixXd spline_cost_weights_;            /**< @brief A matrix [timesteps][control points] that averages the timestep costs over the support of each control point */
+  std::vector<Eigen::MatrixXd> spline_noise_;      /**< @brief Per worker matrix [dimensions][control points] of the noise of a new rollout */
+  Eigen::MatrixXd spline_rollout_noise_;           /**< @brief A matrix [dimensions][control points] of the noise of a rollout during the update */
+  Eigen::MatrixXd spline_updates_;                 /**< @brief A matrix [dimensions][control points] of the parameter updates */
+  std::vector<Eigen::MatrixXd> spline_costs_;      /**< @brief Per dimension [rollouts][control points] total costs */
+  std::vector<Eigen::MatrixXd> spline_probabilities_; /**< @brief Per dimension [rollouts][control points] probabilities */
+  Eigen::RowVectorXd spline_min_costs_;            /**< @brief A vector [control points] of the minimum rollout cost at each control point */
+  Eigen::RowVectorXd spline_normalizers_;          /**< @brief A vector [control points] used to normalize the probabilities at each control point */
 
   // finite difference and optimization matrices
-  int num_timesteps_padded_;                       /**< @brief The number of timesteps to pad the optimization with: timesteps + 2*(FINITE_DIFF_RULE_LENGTH - 1) */
-  int start_index_padded_;                         /**< @brief The index corresponding to the start of the non-paded section in the padded arrays */
-  Eigen::MatrixXd finite_diff_matrix_A_padded_;    /**< @brief The finite difference matrix including padding */
-  Eigen::MatrixXd control_cost_matrix_R_padded_;   /**< @brief The control cost matrix including padding */
-  Eigen::MatrixXd control_cost_matrix_R_;          /**< @brief A matrix [timesteps][timesteps], Referred to as 'R = A x A_transpose' in the literature */
-  Eigen::MatrixXd inv_control_cost_matrix_R_;      /**< @brief A matrix [timesteps][timesteps], R^-1 ' matrix */
+  ControlCostMatricesConstPtr control_cost_matrices_;   /**< @brief The finite difference and control cost matrices, shared through the control cost cache */
+
+  // iteration workspace, allocated once in resetVariables() so that the optimization loop does not allocate memory
+  Eigen::VectorXd control_cost_workspace_;         /**< @brief A vector [timesteps] used to hold the product of R and the parameters */
+  std::vector<int> control_cost_rollouts_;         /**< @brief The rollouts whose control costs are computed in the current iteration */
+  Eigen::MatrixXd control_cost_noise_;             /**< @brief A matrix [rollouts x dimensions][timesteps] of the stacked noise of those rollouts */
+  Eigen::MatrixXd control_cost_products_;          /**< @brief A matrix [rollouts x dimensions][timesteps] of the products of the stacked noise and R */
+  Eigen::VectorXd control_cost_values_;            /**< @brief A vector [rollouts x dimensions] of the control cost of each stacked row */
+  Eigen::RowVectorXd control_cost_scales_;         /**< @brief A vector [rollouts] of the factors normalizing the control costs of each rollout */
+  std::vector< std::pair<double,int> > rollout_cost_sorter_; /**< @brief Used to sort noisy trajectories in ascending order wrt their total cost */
+  Eigen::VectorXd rollout_importance_weights_;     /**< @brief A vector [rollouts] of the rollouts importance weights */
+  Eigen::RowVectorXd timestep_min_costs_;          /**< @brief A vector [timesteps] of the minimum rollout cost at each timestep */
+  Eigen::RowVectorXd timestep_normalizers_;        /**< @brief A vector [timesteps] used to normalize the probabilities at each timestep */
+
+  // streaming update, only allocated when 'streaming_block_size' applies
+  int streaming_block_size_;                       /**< @brief The number of timesteps of a block of the streaming update, 0 if disabled */
+  std::vector<Eigen::MatrixXd> streaming_costs_;   /**< @brief Per worker matrix [rollouts][block timesteps] of the total costs of a block */
+  std::vector<Eigen::MatrixXd> streaming_probabilities_; /**< @brief Per worker matrix [rollouts][block timesteps] of the probabilities of a block */
+  std::vector<Eigen::RowVectorXd> streaming_min_costs_;  /**< @brief Per worker vector [block timesteps] of the minimum rollout cost */
+  std::vector<Eigen::RowVectorXd> streaming_normalizers_; /**< @brief Per worker vector [block timesteps] used to normalize the probabilities */
+
+  // single precision kernels, only allocated when 'single_precision' is enabled
+  Eigen::VectorXf single_importance_weights_;      /**< @brief A vector [rollouts] of the rollouts importance weights */
+  Eigen::RowVectorXf single_min_costs_;            /**< @brief A vector [timesteps or control points] of the minimum rollout cost */
+  Eigen::RowVectorXf single_normalizers_;          /**< @brief A vector [timesteps or control points] used to normalize the probabilities */
+  Eigen::MatrixXf single_spline_cost_weights_;     /**< @brief Single precision copy of 'spline_cost_weights_' */
+  std::vector<Eigen::MatrixXf> single_spline_costs_;         /**< @brief Per dimension [rollouts][control points] total costs */
+  std::vector<Eigen::MatrixXf> single_spline_probabilities_; /**< @brief Per dimension [rollouts][control points] probabilities */
 
 
 };
@@ -26,6 +26,7 @@
 #ifndef STOMP_TASK_H_
 #define STOMP_TASK_H_
 
+#include <vector>
 #include <XmlRpcValue.h>
 #include <boost/shared_ptr.hpp>
 #include <Eigen/Core>
@@ -37,7 +38,15 @@ namespace stomp_core
 class Task;
 typedef std::shared_ptr<Task> TaskPtr; /**< Defines a boost shared ptr for type Task */
 
-/** @brief Defines the STOMP improvement policy */
+/**
+ * @brief Defines the STOMP improvement policy
+ *
+ * @par Thread-safety:
+ * When StompConfiguration::num_threads is greater than 1 the generateNoisyParameters(), filterNoisyParameters() and
+ * computeNoisyCosts() methods are called concurrently from several threads, each call operating on a different rollout.
+ * A new rollout is generated, filtered and evaluated in that order by the same thread.  All other methods are always
+ * called sequentially from the thread running Stomp::solve().
+ */
 class Task
 {
 
@@ -47,6 +56,7 @@ public:
 
     /**
      * @brief Generates a noisy trajectory from the parameters.
+     * This method must be thread-safe whenever StompConfiguration::num_threads > 1.
      * @param parameters        A matrix [num_dimensions][num_parameters] of the current optimized parameters
      * @param start_timestep    The start index into the 'parameters' array, usually 0.
      * @param num_timesteps     The number of elements to use from 'parameters' starting from 'start_timestep'
@@ -66,12 +76,17 @@ public:
 
     /**
      * @brief computes the state costs as a function of the noisy parameters for each time step.
+     * This method must be thread-safe whenever StompConfiguration::num_threads > 1, any per-call scratch data can be
+     * selected with ThreadPool::getWorkerIndex() which is unique among the concurrently running calls.
      * @param parameters        A matrix [num_dimensions][num_parameters] of the policy parameters to execute
      * @param start_timestep    The start index into the 'parameters' array, usually 0.
      * @param num_timesteps     The number of elements to use from 'parameters' starting from 'start_timestep'
      * @param iteration_number  The current iteration count in the optimization loop
      * @param rollout_number    The index of the noisy trajectory whose cost is being evaluated.
-     * @param costs vector      A vector containing the state costs per timestep.
+     * @param costs vector      A vector containing the state costs per timestep.  When StompConfiguration::window_size
+     *                          is used only the window [start_timestep, start_timestep + num_timesteps) has been
+     *                          perturbed and the costs may contain either the 'num_timesteps' window entries or the
+     *                          entries of the whole trajectory.
      * @param validity          Whether or not the trajectory is valid
      * @return True if cost were properly computed, otherwise false
      */
@@ -83,6 +98,48 @@ public:
                          Eigen::VectorXd& costs,
                          bool& validity) = 0 ;
 
+    /**
+     * @brief Whether Stomp should evaluate the noisy rollouts of each iteration with a single call to
+     * computeNoisyCostsBatch() instead of one computeNoisyCosts() call per rollout.  Tasks that can amortize work
+     * across rollouts (a shared broadphase update per timestep, evaluation on an accelerator, etc) return true.
+     * @return False by default.
+     */
+    virtual bool supportsBatchCosts() const
+    {
+      return false;
+    }
+
+    /**
+     * @brief computes the state costs of all the new noisy rollouts of an iteration at once, it is used instead of
+     * computeNoisyCosts() when supportsBatchCosts() returns true.  It is called from a single thread after all the
+     * rollouts have been generated and filtered.  The default implementation calls computeNoisyCosts() for each rollout.
+     * @param parameters        A matrix [num_dimensions][num_rollouts x num_parameters] with the noisy parameters of every
+     *                          rollout stored contiguously, rollout r occupies the columns [r*num_parameters, (r+1)*num_parameters)
+     * @param start_timestep    The start index into the parameters of each rollout, usually 0.
+     * @param num_timesteps     The number of timesteps to evaluate starting from 'start_timestep'
+     * @param iteration_number  The current iteration count in the optimization loop
+     * @param num_rollouts      The number of rollouts stored in 'parameters'
+     * @param costs             A preallocated matrix [num_rollouts][num_timesteps] that receives the state cost of each
+     *                          rollout at each of the evaluated timesteps.
+     * @param validities        Receives whether or not each rollout is valid
+     * @return True if cost were properly computed, otherwise false
+     */
+    virtual bool computeNoisyCostsBatch(const Eigen::MatrixXd& parameters,
+                                        std::size_t start_timestep,
+                                        std::size_t num_timesteps,
+                                        int iteration_number,
+                                        int num_rollouts,
+                                        Eigen::MatrixXd& costs,
+                                        std::vector<bool>& validities)
+    {
+      auto compute = [&](const Eigen::MatrixXd& rollout_parameters,int rollout,Eigen::VectorXd& rollout_costs,bool& valid)
+      {
+        return computeNoisyCosts(rollout_parameters,start_timestep,num_timesteps,iteration_number,rollout,rollout_costs,
+                                 valid);
+      };
+      return computeBatchCostsPerRollout(parameters,start_timestep,num_timesteps,num_rollouts,compute,costs,validities);
+    }
+
     /**
      * @brief computes the state costs as a function of the optimized parameters for each time step.
      * @param parameters        A matrix [num_dimensions][num_parameters] of the policy parameters to execute
@@ -100,9 +157,116 @@ public:
                          Eigen::VectorXd& costs,
                          bool& validity) = 0 ;
 
+    /**
+     * @brief Whether Stomp should call the Eigen::Ref based generateNoisyParametersRef(), computeNoisyCostsRef() and
+     * computeCostsRef() methods instead of their counterparts.  These receive views into the rollout storage of Stomp,
+     * the window of a rollout and the state costs entries it replaces included, so that nothing is copied in between.
+     * The batches of computeNoisyCostsBatch() are always passed as dense matrices since they are contiguous already.  The default implementations of the Ref methods adapt the calls to the methods
+     * taking dense matrices and copy their arguments, a task returns true only when it overrides them.
+     * @return False by default.
+     */
+    virtual bool supportsRefInterface() const
+    {
+      return false;
+    }
+
+    /**
+     * @brief Same as generateNoisyParameters() but only the window [start_timestep, start_timestep + num_timesteps) is
+     * written, Stomp sets the timesteps outside of it.  This method must be thread-safe whenever
+     * StompConfiguration::num_threads > 1.  The default implementation calls generateNoisyParameters().
+     * @param parameters        A matrix [num_dimensions][num_parameters] of the current optimized parameters
+     * @param start_timestep    The start index into the 'parameters' array, usually 0.
+     * @param num_timesteps     The number of elements to use from 'parameters' starting from 'start_timestep'
+     * @param iteration_number  The current iteration count in the optimization loop
+     * @param rollout_number    The index of the noisy trajectory.
+     * @param parameters_noise  A view [num_dimensions][num_timesteps] that receives the parameters + noise of the window
+     * @param noise             A view [num_dimensions][num_timesteps] that receives the noise of the window
+     * @return True if cost were properly computed, otherwise false
+     */
+    virtual bool generateNoisyParametersRef(const Eigen::Ref<const Eigen::MatrixXd>& parameters,
+                                            std::size_t start_timestep,
+                                            std::size_t num_timesteps,
+                                            int iteration_number,
+                                            int rollout_number,
+                                            Eigen::Ref<Eigen::MatrixXd> parameters_noise,
+                                            Eigen::Ref<Eigen::MatrixXd> noise)
+    {
+      Eigen::MatrixXd full_parameters = parameters;
+      Eigen::MatrixXd full_parameters_noise = full_parameters;
+      Eigen::MatrixXd full_noise = Eigen::MatrixXd::Zero(parameters.rows(),parameters.cols());
+      if(!generateNoisyParameters(full_parameters,start_timestep,num_timesteps,iteration_number,rollout_number,
+                                  full_parameters_noise,full_noise))
+      {
+        return false;
+      }
+
+      parameters_noise = full_parameters_noise.middleCols(start_timestep,num_timesteps);
+      noise = full_noise.middleCols(start_timestep,num_timesteps);
+      return true;
+    }
+
+    /**
+     * @brief Same as computeNoisyCosts() but the costs are written into a view of exactly 'num_timesteps' entries.
+     * This method must be thread-safe whenever StompConfiguration::num_threads > 1.  The default implementation calls
+     * computeNoisyCosts().
+     * @param parameters        A matrix [num_dimensions][num_parameters] of the policy parameters to execute
+     * @param start_timestep    The start index into the 'parameters' array, usually 0.
+     * @param num_timesteps     The number of elements to use from 'parameters' starting from 'start_timestep'
+     * @param iteration_number  The current iteration count in the optimization loop
+     * @param rollout_number    The index of the noisy trajectory whose cost is being evaluated.
+     * @param costs             A view [num_timesteps] that receives the state costs of the evaluated timesteps
+     * @param validity          Whether or not the trajectory is valid
+     * @return True if cost were properly computed, otherwise false
+     */
+    virtual bool computeNoisyCostsRef(const Eigen::Ref<const Eigen::MatrixXd>& parameters,
+                                      std::size_t start_timestep,
+                                      std::size_t num_timesteps,
+                                      int iteration_number,
+                                      int rollout_number,
+                                      Eigen::Ref<Eigen::VectorXd> costs,
+                                      bool& validity)
+    {
+      Eigen::VectorXd rollout_costs;
+      if(!computeNoisyCosts(parameters,start_timestep,num_timesteps,iteration_number,rollout_number,rollout_costs,
+                            validity))
+      {
+        return false;
+      }
+
+      return copyCosts(rollout_costs,start_timestep,num_timesteps,parameters.cols(),costs);
+    }
+
+    /**
+     * @brief Same as computeCosts() but the costs are written into a view of exactly 'num_timesteps' entries.  The
+     * default implementation calls computeCosts().
+     * @param parameters        A matrix [num_dimensions][num_parameters] of the policy parameters to execute
+     * @param start_timestep    The start index into the 'parameters' array, usually 0.
+     * @param num_timesteps     The number of elements to use from 'parameters' starting from 'start_timestep'
+     * @param iteration_number  The current iteration count in the optimization loop
+     * @param costs             A view [num_timesteps] that receives the state costs of the evaluated timesteps
+     * @param validity          Whether or not the trajectory is valid
+     * @return True if cost were properly computed, otherwise false
+     */
+    virtual bool computeCostsRef(const Eigen::Ref<const Eigen::MatrixXd>& parameters,
+                                 std::size_t start_timestep,
+                                 std::size_t num_timesteps,
+                                 int iteration_number,
+                                 Eigen::Ref<Eigen::VectorXd> costs,
+                                 bool& validity)
+    {
+      Eigen::VectorXd parameters_costs;
+      if(!computeCosts(parameters,start_timestep,num_timesteps,iteration_number,parameters_costs,validity))
+      {
+        return false;
+      }
+
+      return copyCosts(parameters_costs,start_timestep,num_timesteps,parameters.cols(),costs);
+    }
+
     /**
      * @brief Filters the given noisy parameters which is applied after noisy trajectory generation. It could be used for clipping
-     * of joint limits or projecting into the null space of the Jacobian.
+     * of joint limits or projecting into the null space of the Jacobian.  The state costs are computed afterwards from
+     * the filtered parameters.  This method must be thread-safe whenever StompConfiguration::num_threads > 1.
      *
      * @param start_timestep    The start index into the 'parameters' array, usually 0.
      * @param num_timesteps     The number of elements to use from 'parameters' starting from 'start_timestep'
@@ -165,6 +329,39 @@ public:
      */
     virtual void done(bool success,int total_iterations,double final_cost,const Eigen::MatrixXd& parameters){}
 
+    /**
+     * @brief Called by Stomp at the end of the optimization process, the default implementation calls the overload
+     * without the termination reason.
+     *
+     * @param success           Whether the optimization succeeded
+     * @param total_iterations  Number of iterations used
+     * @param final_cost        The cost value after optimizing.
+     * @param parameters        The parameters generated at the end of the optimization [num_dimensions x num_timesteps]
+     * @param reason            TerminationReasons::TerminationReason, why the optimization loop ended
+     */
+    virtual void done(bool success,int total_iterations,double final_cost,const Eigen::MatrixXd& parameters,
+                      TerminationReasons::TerminationReason reason)
+    {
+      done(success,total_iterations,final_cost,parameters);
+    }
+
+protected:
+
+    /**
+     * @brief Copies the costs returned by the methods taking dense matrices into a view of the evaluated timesteps.
+     * @param costs           The costs of the evaluated timesteps only or those of the whole trajectory
+     * @param start_timestep  The first evaluated timestep
+     * @param num_timesteps   The number of evaluated timesteps
+     * @param num_parameters  The number of timesteps of the whole trajectory
+     * @param view            A view [num_timesteps] that receives the costs
+     * @return False if 'costs' has neither size, otherwise true
+     */
+    static bool copyCosts(const Eigen::VectorXd& costs,std::size_t start_timestep,std::size_t num_timesteps,
+                          std::size_t num_parameters,Eigen::Ref<Eigen::VectorXd> view)
+    {
+      return copyStateCosts(costs,start_timestep,num_timesteps,num_parameters,view);
+    }
+
 };
 
 }
@@ -0,0 +1,157 @@
+/**
+ * @file thread_pool.h
+ * @brief This contains a fixed size thread pool used to parallelize the stomp optimization steps
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef INDUSTRIAL_MOVEIT_STOMP_CORE_INCLUDE_STOMP_CORE_THREAD_POOL_H_
+#define INDUSTRIAL_MOVEIT_STOMP_CORE_INCLUDE_STOMP_CORE_THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace stomp_core
+{
+
+class ThreadPool;
+typedef std::shared_ptr<ThreadPool> ThreadPoolPtr; /**< Defines a shared ptr for type ThreadPool */
+
+/**
+ * @brief A fixed size pool of worker threads that executes index based jobs.
+ * The thread calling parallelFor() participates in the work as worker 0, therefore a pool
+ * of size 1 does not spawn any threads and runs every job serially on the calling thread.
+ * Several threads may call parallelFor() concurrently, e.g. the planners of a process sharing
+ * one pool, the spawned threads then take the work items of the pending jobs in turn so that
+ * an idle thread always helps the busiest callers.
+ */
+class ThreadPool
+{
+public:
+
+  /**
+   * @brief The job signature
+   * @param index   The index of the work item in the range [0, n)
+   * @param worker  The index of the worker executing the item in the range [0, size())
+   */
+  typedef std::function<void (std::size_t index, std::size_t worker)> Job;
+
+  /**
+   * @brief Constructor
+   * @param num_threads The total number of threads including the calling thread, values less than 1 are treated as 1.
+   */
+  explicit ThreadPool(std::size_t num_threads);
+
+  /**
+   * @brief Constructor that also sets the CPU affinity and scheduling priority of the spawned threads.
+   * Both are only applied on Linux, the calling thread is never modified.
+   * @param num_threads   The total number of threads including the calling thread, values less than 1 are treated as 1.
+   * @param cpus          The CPUs the spawned threads may run on, empty to leave the affinity unchanged.
+   * @param nice          The nice value of the spawned threads in the range [-20, 19], 0 to leave it unchanged.
+   */
+  ThreadPool(std::size_t num_threads, const std::vector<int>& cpus, int nice);
+
+  ~ThreadPool();
+
+  /**
+   * @brief The number of threads that execute jobs, including the calling thread.
+   * @return The number of threads
+   */
+  std::size_t size() const;
+
+  /**
+   * @brief Executes the job for every index in the range [0, n) and blocks until all of them have completed.
+   * Any exception thrown by the job is rethrown in the calling thread once all workers have finished.
+   * The worker indices are unique among the concurrent calls of a single job, the calling thread
+   * always being worker 0.  This method must not be called from within a job of the same pool.
+   * @param n   The number of work items
+   * @param job The function invoked for each work item
+   */
+  void parallelFor(std::size_t n, const Job& job);
+
+  /**
+   * @brief Returns the worker index of the calling thread while it executes a job from any pool.
+   * @return The worker index or 0 when the calling thread is not executing a job.
+   */
+  static std::size_t getWorkerIndex();
+
+protected:
+
+  /**
+   * @brief The state of a job started by parallelFor()
+   */
+  struct JobState
+  {
+    const Job* job;                        /**< @brief The function invoked for each work item */
+    std::size_t size;                      /**< @brief The number of work items */
+    std::atomic<std::size_t> next_index;   /**< @brief The next work item to execute */
+    std::size_t busy_workers;              /**< @brief The number of spawned threads executing an item of the job */
+    std::exception_ptr exception;          /**< @brief The first exception thrown by the job */
+  };
+
+  /**
+   * @brief Applies the CPU affinity and priority to the calling thread
+   */
+  void configureThread() const;
+
+  /**
+   * @brief Executes a work item and records the exception it throws
+   * @param state   The job
+   * @param index   The work item
+   * @param worker  The worker index of the calling thread
+   */
+  void runItem(JobState& state, std::size_t index, std::size_t worker);
+
+  /**
+   * @brief Removes a job from the pending jobs, the mutex must be locked.
+   * @param state The job
+   */
+  void removeJob(JobState* state);
+
+  /**
+   * @brief The loop run by each of the spawned threads
+   * @param worker The worker index assigned to the thread
+   */
+  void workerLoop(std::size_t worker);
+
+protected:
+
+  std::vector<std::thread> threads_;       /**< @brief The spawned threads, one less than the pool size */
+  std::vector<int> cpus_;                  /**< @brief The CPUs the spawned threads may run on, empty for any */
+  int nice_;                               /**< @brief The nice value of the spawned threads, 0 to inherit it */
+  std::mutex mutex_;                       /**< @brief Guards the pending jobs */
+  std::condition_variable start_cond_;     /**< @brief Signals the workers that a new job is available */
+  std::condition_variable done_cond_;      /**< @brief Signals the callers that a worker has finished an item */
+  std::vector<JobState*> jobs_;            /**< @brief The jobs with work items left, in the order they were started */
+  std::size_t next_job_;                   /**< @brief The pending job the next idle worker takes an item from */
+  bool stop_;                              /**< @brief Requests the spawned threads to exit */
+
+};
+
+} /* namespace stomp_core */
+
+#endif /* INDUSTRIAL_MOVEIT_STOMP_CORE_INCLUDE_STOMP_CORE_THREAD_POOL_H_ */
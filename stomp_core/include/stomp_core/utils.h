@@ -26,34 +26,16 @@
 #ifndef INDUSTRIAL_MOVEIT_STOMP_CORE_INCLUDE_STOMP_CORE_STOMP_UTILS_H_
 #define INDUSTRIAL_MOVEIT_STOMP_CORE_INCLUDE_STOMP_CORE_STOMP_UTILS_H_
 
+#include <functional>
 #include <string>
 #include <vector>
 #include <Eigen/Core>
+#include <Eigen/Sparse>
+#include <Eigen/SparseCholesky>
 
 namespace stomp_core
 {
 
-/** @brief The data structure used to store information about a single rollout. */
-struct Rollout
-{
-  Eigen::MatrixXd noise;                   /**< @brief A matrix [num_dimensions][num_time_steps] of random noise applied to the parameters*/
-  Eigen::MatrixXd parameters_noise;        /**< @brief A matrix [num_dimensions][num_time_steps] of the sum of parameters + noise */
-
-  Eigen::VectorXd state_costs;             /**< @brief A vector [num_time_steps] of the cost at each timestep */
-  Eigen::MatrixXd control_costs;           /**< @brief A matrix [num_dimensions][num_time_steps] of the control cost for each parameter at every timestep */
-  Eigen::MatrixXd total_costs;             /**< @brief A matrix [num_dimensions][num_time_steps] of the total cost, where total_cost[d] = state_costs_ + control_costs_[d]*/
-  Eigen::MatrixXd probabilities;           /**< @brief A matrix [num_dimensions][num_time_steps] of the probability for each parameter at every timestep */
-
-  std::vector<double> full_probabilities; /**< @brief A vector [num_dimensions] of the probabilities for the full trajectory */
-  std::vector<double> full_costs;         /**< @brief A vector [num_dimensions] of the full coss, state_cost + control_cost for each joint over the entire trajectory
-                                               full_costs_[d] = state_cost.sum() + control_cost[d].sum() */
-
-  double importance_weight;               /**< @brief importance sampling weight */
-  double total_cost;                      /**< @brief combined state + control cost over the entire trajectory for all joints */
-
-};
-
-
 namespace DerivativeOrders
 {
 /** @brief Available finite differentiation methods */
@@ -77,6 +59,28 @@ enum TrajectoryInitialization
 };
 }
 
+namespace TerminationReasons
+{
+/** @brief The reasons for which the optimization loop ends */
+enum TerminationReason
+{
+  MAX_ITERATIONS = 0,   /**< The maximum number of iterations was reached */
+  VALID_SOLUTION,       /**< A valid solution was found and improved for 'num_iterations_after_valid' iterations */
+  COST_CONVERGED,       /**< The relative cost improvement over 'convergence_iterations' fell below 'convergence_cost_epsilon' */
+  UPDATES_CONVERGED,    /**< The max-norm of the parameter updates fell below 'convergence_update_threshold' */
+  TIME_LIMIT,           /**< The optimization ran longer than 'max_optimization_time' */
+  CANCELLED,            /**< The optimization was cancelled */
+  FAILED                /**< An iteration step failed */
+};
+
+/**
+ * @brief Returns the name of a termination reason
+ * @param reason The termination reason
+ * @return The lower case name of the enumerator, "unknown" for an invalid value
+ */
+const char* getName(TerminationReason reason);
+}
+
 /** @brief The data structure used to store STOMP configuration parameters. */
 struct StompConfiguration
 {
@@ -94,11 +98,42 @@ struct StompConfiguration
   // Noisy trajectory generation
   int num_rollouts;                      /**< @brief Number of noisy trajectories*/
   int max_rollouts;                      /**< @brief The combined number of new and old rollouts during each iteration shouldn't exceed this value */
+  int min_rollouts;                      /**< @brief Enables the adaptive rollout count when > 0.  The number of new rollouts starts at 'num_rollouts',
+                                              grows up to max(num_rollouts, max_rollouts - 1) while the cost of an invalid trajectory does not improve and shrinks down
+                                              to this value as the cost converges */
+  int seed;                              /**< @brief Seed of the random streams used by the noise generators, the same seed reproduces the same noise */
+  int window_size;                       /**< @brief Number of consecutive timesteps perturbed and re-evaluated on each iteration, the window slides
+                                              along the trajectory by half its size every iteration.  Values <= 0 or >= num_timesteps perturb the
+                                              whole trajectory */
+  int num_control_points;                /**< @brief Number of cubic B-spline control points per dimension in which the noise, the probabilities and
+                                              the updates are computed, the rollouts are expanded to timesteps for the cost evaluation.  Values < 4 or
+                                              >= num_timesteps optimize every timestep directly */
 
   // Cost calculation
   double control_cost_weight;            /**< @brief Percentage of the trajectory accelerations cost to be applied in the total cost calculation >*/
+
+  // Precision
+  bool single_precision;                 /**< @brief Computes the rollout total costs, the probabilities and the parameter updates in single precision,
+                                              the noisy parameters, their costs and the optimized parameters stay in double precision */
+
+  // Memory
+  int streaming_block_size;              /**< @brief Enables the streaming update when > 0.  The total costs and the probabilities are computed per block
+                                              of this many timesteps and reduced into the parameter updates right away instead of being stored for the
+                                              whole trajectory of every dimension.  Only applies in double precision when every timestep is optimized */
+
+  // Convergence criteria, disabled when <= 0
+  int convergence_iterations;            /**< @brief Number of iterations over which the relative cost improvement is measured */
+  double convergence_cost_epsilon;       /**< @brief Stomp stops when the relative cost improvement over 'convergence_iterations' is below this value */
+  double convergence_update_threshold;   /**< @brief Stomp stops when the max-norm of the parameter updates is below this value */
+  double max_optimization_time;          /**< @brief Wall-clock time in seconds after which Stomp stops iterating */
+
+  // Parallelization
+  int num_threads;                       /**< @brief Number of threads used to evaluate the noisy rollouts concurrently, 1 evaluates them serially */
 };
 
+/** @brief A sparse Cholesky factorization that preserves the band structure of the control cost matrix */
+typedef Eigen::SimplicialLLT<Eigen::SparseMatrix<double>,Eigen::Lower,Eigen::NaturalOrdering<int> > BandedCholesky;
+
 /** @brief The number of columns in the finite differentiation rule */
 static const int FINITE_DIFF_RULE_LENGTH = 7;
 
@@ -115,9 +150,58 @@ static const double FINITE_FORWARD_DIFF_COEFFS[FINITE_DIFF_RULE_LENGTH][FINITE_D
     {1          , 0         , 0         , 0      , 0        , 0         , 0    }, // position
     {-25.0/12.0 , 4.0       , -3.0      , 4.0/3.0, -1.0/4.0 , 0         , 0    }, // velocity
     {15.0/4.0   , -77.0/6.0 , 107.0/6.0 , -13.0  , 61.0/12.0, -5.0/6.0  , 0    }, // acceleration (five point stencil)
-    {-49/8      , 29        , -461/8    , 62     , -307/8   , 13        , -15/8}  // jerk
+    {-49.0/8.0  , 29.0      , -461.0/8.0, 62.0   , -307.0/8.0, 13.0     , -15.0/8.0}  // jerk
 };
 
+/**
+ * @brief The largest number of new rollouts that Stomp generates in a single iteration with the given configuration
+ * @param config The Stomp configuration
+ * @return 'num_rollouts' or the upper bound of the adaptive rollout count when 'min_rollouts' is enabled
+ */
+int getMaxGeneratedRollouts(const StompConfiguration& config);
+
+/**
+ * @brief Computes the state costs of a single rollout, see computeBatchCostsPerRollout()
+ * @param parameters  The noisy parameters of the rollout [num_dimensions][num_parameters]
+ * @param rollout     The index of the rollout in the batch
+ * @param costs       Returns the costs of the evaluated timesteps only or those of the whole trajectory
+ * @param validity    Returns whether or not the rollout is valid
+ * @return True if the costs were computed, otherwise false
+ */
+typedef std::function<bool (const Eigen::MatrixXd& parameters,int rollout,Eigen::VectorXd& costs,bool& validity)>
+    RolloutCostsFunction;
+
+/**
+ * @brief Copies the state costs of the evaluated timesteps into a view, the costs may be those of the evaluated timesteps
+ * only or those of the whole trajectory.
+ * @param costs           The costs [num_timesteps] or [num_parameters]
+ * @param start_timestep  The first evaluated timestep
+ * @param num_timesteps   The number of evaluated timesteps
+ * @param num_parameters  The number of timesteps of the whole trajectory
+ * @param view            A view [num_timesteps] that receives the costs
+ * @return False if 'costs' has neither size, otherwise true
+ */
+bool copyStateCosts(const Eigen::VectorXd& costs,std::size_t start_timestep,std::size_t num_timesteps,
+                    std::size_t num_parameters,Eigen::Ref<Eigen::VectorXd,0,Eigen::InnerStride<> > view);
+
+/**
+ * @brief Computes the state costs of a batch of rollouts by evaluating each one on its own, it is the default
+ * implementation of the batch cost interfaces.
+ * @param parameters      The noisy parameters of every rollout stored contiguously [num_dimensions][num_rollouts x num_parameters],
+ *                        rollout r occupies the columns [r*num_parameters, (r+1)*num_parameters)
+ * @param start_timestep  The start index into the parameters of each rollout, usually 0.
+ * @param num_timesteps   The number of timesteps to evaluate starting from 'start_timestep'
+ * @param num_rollouts    The number of rollouts stored in 'parameters'
+ * @param compute         Computes the costs of a single rollout
+ * @param costs           Returns the state costs of each rollout at each evaluated timestep [num_rollouts][num_timesteps]
+ * @param validities      Returns whether or not each rollout is valid
+ * @return False if the parameters do not hold 'num_rollouts' rollouts, if a rollout failed or if its costs have neither
+ * the size of the evaluated timesteps nor that of the trajectory, otherwise true
+ */
+bool computeBatchCostsPerRollout(const Eigen::MatrixXd& parameters,std::size_t start_timestep,std::size_t num_timesteps,
+                                 int num_rollouts,const RolloutCostsFunction& compute,Eigen::MatrixXd& costs,
+                                 std::vector<bool>& validities);
+
 /**
  * @brief Generate a finite difference matrix based on the input DerivativeOrder
  * @param num_time_steps The number of timesteps
@@ -128,18 +212,61 @@ static const double FINITE_FORWARD_DIFF_COEFFS[FINITE_DIFF_RULE_LENGTH][FINITE_D
 void generateFiniteDifferenceMatrix(int num_time_steps, DerivativeOrders::DerivativeOrder order, double dt,
                                     Eigen::MatrixXd& diff_matrix);
 
+/**
+ * @brief Generate a sparse finite difference matrix based on the input DerivativeOrder.  The matrix is banded with
+ * a bandwidth of FINITE_DIFF_RULE_LENGTH/2 on each side of the diagonal.
+ * @param num_time_steps The number of timesteps
+ * @param order          The differentiation order
+ * @param dt             The timestep in seconds
+ * @param diff_matrix    The generated sparse finite difference matrix
+ */
+void generateFiniteDifferenceMatrix(int num_time_steps, DerivativeOrders::DerivativeOrder order, double dt,
+                                    Eigen::SparseMatrix<double>& diff_matrix);
+
 /**
  * @brief Differentiates the input parameters based on the DerivativeOrder.
- * @param parameters  The parameters to be differentiated
+ * @param parameters  The parameters to be differentiated, at least FINITE_DIFF_RULE_LENGTH of them
  * @param order       The differentiation order
  * @param dt          The timestep in seconds
- * @param derivatives The differentiation of the input parameters
+ * @param derivatives The differentiation of the input parameters, zero when there are too few parameters
  */
 void differentiate(const Eigen::VectorXd& parameters, DerivativeOrders::DerivativeOrder order,
                           double dt, Eigen::VectorXd& derivatives );
 
 /**
- * @brief Generate a smoothing matrix M
+ * @brief Differentiates each row of the input parameters based on the DerivativeOrder.  Central differences are used
+ * in the interior and one-sided differences at both ends, the cost is linear in the number of timesteps.
+ * @param parameters  The parameters [dimensions][timesteps] to be differentiated, at least FINITE_DIFF_RULE_LENGTH timesteps
+ * @param order       The differentiation order
+ * @param dt          The timestep in seconds
+ * @param derivatives The derivatives [dimensions][timesteps], zero when there are too few timesteps
+ */
+void differentiate(const Eigen::MatrixXd& parameters, DerivativeOrders::DerivativeOrder order,
+                   double dt, Eigen::MatrixXd& derivatives);
+
+/**
+ * @brief Generate the basis of a clamped uniform cubic B-spline sampled at evenly spaced timesteps.  The trajectory
+ * given by the control points 'c' [dimensions][control points] is 'c * basis', its first and last timesteps are the
+ * first and last control points.
+ * @param num_control_points The number of control points, at least 4
+ * @param num_time_steps     The number of timesteps
+ * @param basis              The basis [control points][timesteps], each column sums to 1
+ */
+void generateBSplineBasis(int num_control_points, int num_time_steps, Eigen::MatrixXd& basis);
+
+/**
+ * @brief Resample a trajectory to a different number of evenly spaced timesteps by piecewise cubic Hermite interpolation
+ * of its timesteps.  The tangents are the central differences of the neighbouring timesteps and zero at both ends, as in
+ * the cubic polynomial initialization, so the resampled trajectory keeps the first and last timesteps and starts and
+ * ends at rest.
+ * @param parameters      The trajectory [dimensions][timesteps], at least 2 timesteps
+ * @param num_time_steps  The number of timesteps of the resampled trajectory, at least 2
+ * @param resampled       The resampled trajectory [dimensions][num_time_steps]
+ */
+void resampleTrajectory(const Eigen::MatrixXd& parameters, int num_time_steps, Eigen::MatrixXd& resampled);
+
+/**
+ * @brief Generate a smoothing matrix M, the matrix is copied from the control cost cache (see getSmoothingMatrix())
  * @param num_time_steps       The number of timesteps
  * @param dt                   The timestep in seconds
  * @param projection_matrix_M  The smoothing matrix
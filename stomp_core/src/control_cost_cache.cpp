@@ -0,0 +1,213 @@
+/**
+ * @file control_cost_cache.cpp
+ * @brief This contains a process wide cache of the control cost matrices used by stomp
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <ros/console.h>
+#include "stomp_core/control_cost_cache.h"
+
+static const std::size_t MAX_CACHED_ENTRIES = 32; /**< Number of entries after which the cache is flushed */
+
+/**
+ * @brief Computes the diagonal of R^-1 from the Cholesky factor of the banded matrix R without forming the inverse.  The
+ * entries of R^-1 within the band of R only depend on each other, therefore only those are computed (Takahashi
+ * recurrence).  The largest coefficient of a positive definite matrix lies on its diagonal.
+ * @param control_cost_matrix_R_llt The factorization of the control cost matrix
+ * @return The diagonal of R^-1
+ */
+static Eigen::VectorXd computeInverseDiagonal(const stomp_core::BandedCholesky& control_cost_matrix_R_llt)
+{
+  typedef Eigen::SparseMatrix<double>::InnerIterator InnerIterator;
+
+  const Eigen::SparseMatrix<double> L = control_cost_matrix_R_llt.matrixL();
+  int num_timesteps = L.rows();
+  int bandwidth = 0;
+  for(int i = 0; i < num_timesteps; i++)
+  {
+    for(InnerIterator it(L,i); it; ++it)
+    {
+      bandwidth = std::max<int>(bandwidth,it.row() - i);
+    }
+  }
+
+  // banded storage of the inverse where inv_band(i,m) = R^-1(i,i+m)
+  Eigen::MatrixXd inv_band = Eigen::MatrixXd::Zero(num_timesteps,bandwidth + 1);
+  auto inverse_coeff = [&inv_band](int i, int j)
+  {
+    return i <= j ? inv_band(i,j - i) : inv_band(j,i - j);
+  };
+
+  for(int i = num_timesteps - 1; i >= 0; i--)
+  {
+    double l_ii = L.coeff(i,i);
+    for(int j = i + 1; j <= std::min(i + bandwidth,num_timesteps - 1); j++)
+    {
+      double sum = 0;
+      for(InnerIterator it(L,i); it; ++it)
+      {
+        if(it.row() > i)
+        {
+          sum += it.value() * inverse_coeff(it.row(),j);
+        }
+      }
+      inv_band(i,j - i) = -sum/l_ii;
+    }
+
+    double sum = 0;
+    for(InnerIterator it(L,i); it; ++it)
+    {
+      if(it.row() > i)
+      {
+        sum += it.value() * inv_band(i,it.row() - i);
+      }
+    }
+    inv_band(i,0) = 1.0/(l_ii*l_ii) - sum/l_ii;
+  }
+
+  return inv_band.col(0);
+}
+
+namespace stomp_core
+{
+
+typedef std::tuple<int,double,int> CacheKey;   /**< (num_timesteps, dt, derivative order) */
+
+static std::mutex CACHE_MUTEX;                                        /**< Guards the cached matrices */
+static std::map<CacheKey,ControlCostMatricesConstPtr> CONTROL_COST_CACHE; /**< The cached control cost matrices */
+static std::map<CacheKey,SmoothingMatrixConstPtr> SMOOTHING_CACHE;        /**< The cached smoothing matrices */
+
+/**
+ * @brief Computes the control cost matrices, see getControlCostMatrices()
+ * @param num_timesteps The number of timesteps
+ * @param dt            The timestep in seconds
+ * @param order         The differentiation order
+ * @return The matrices or a null pointer if the factorization failed
+ */
+static std::shared_ptr<ControlCostMatrices> computeControlCostMatrices(int num_timesteps, double dt,
+                                                                       DerivativeOrders::DerivativeOrder order)
+{
+  std::shared_ptr<ControlCostMatrices> m(new ControlCostMatrices());
+  m->num_timesteps = num_timesteps;
+  m->start_index_padded = FINITE_DIFF_RULE_LENGTH-1;
+  m->num_timesteps_padded = num_timesteps + 2*(FINITE_DIFF_RULE_LENGTH-1);
+  generateFiniteDifferenceMatrix(m->num_timesteps_padded,order,dt,m->finite_diff_matrix_A_padded);
+
+  /* control cost matrix (R = A_transpose * A):
+   * Note: Original code multiplies the A product by the time interval.  However this is not
+   * what was described in the literature
+   */
+  m->control_cost_matrix_R_padded = dt*m->finite_diff_matrix_A_padded.transpose() * m->finite_diff_matrix_A_padded;
+  m->control_cost_matrix_R = m->control_cost_matrix_R_padded.block(
+      m->start_index_padded,m->start_index_padded,num_timesteps,num_timesteps);
+  m->control_cost_matrix_R_llt.compute(m->control_cost_matrix_R);
+  if(m->control_cost_matrix_R_llt.info() != Eigen::Success)
+  {
+    ROS_ERROR("Failed to factorize the control cost matrix");
+    return nullptr;
+  }
+
+  /*
+   * Applying scale factor to ensure that max(R^-1)==1
+   */
+  Eigen::VectorXd inverse_diagonal = computeInverseDiagonal(m->control_cost_matrix_R_llt);
+  double maxVal = std::abs(inverse_diagonal.maxCoeff());
+  m->control_cost_matrix_R_padded *= maxVal;
+  m->control_cost_matrix_R *= maxVal;
+  m->control_cost_matrix_R_llt.compute(m->control_cost_matrix_R); // used in computing the minimum control cost initial trajectory
+  m->control_cost_matrix_R_inv_diagonal = inverse_diagonal / maxVal;
+
+  return m;
+}
+
+ControlCostMatricesConstPtr getControlCostMatrices(int num_timesteps, double dt, DerivativeOrders::DerivativeOrder order)
+{
+  CacheKey key(num_timesteps,dt,order);
+
+  std::lock_guard<std::mutex> lock(CACHE_MUTEX);
+  auto entry = CONTROL_COST_CACHE.find(key);
+  if(entry != CONTROL_COST_CACHE.end())
+  {
+    return entry->second;
+  }
+
+  ControlCostMatricesConstPtr m = computeControlCostMatrices(num_timesteps,dt,order);
+  if(!m)
+  {
+    return m;
+  }
+
+  if(CONTROL_COST_CACHE.size() >= MAX_CACHED_ENTRIES)
+  {
+    CONTROL_COST_CACHE.clear();
+  }
+  CONTROL_COST_CACHE[key] = m;
+  return m;
+}
+
+SmoothingMatrixConstPtr getSmoothingMatrix(int num_timesteps, double dt)
+{
+  CacheKey key(num_timesteps,dt,DerivativeOrders::STOMP_ACCELERATION);
+  {
+    std::lock_guard<std::mutex> lock(CACHE_MUTEX);
+    auto entry = SMOOTHING_CACHE.find(key);
+    if(entry != SMOOTHING_CACHE.end())
+    {
+      return entry->second;
+    }
+  }
+
+  ControlCostMatricesConstPtr m = getControlCostMatrices(num_timesteps,dt,DerivativeOrders::STOMP_ACCELERATION);
+  if(!m)
+  {
+    return nullptr;
+  }
+
+  // computing projection matrix M, the column scaling makes it independent of the scale applied to R
+  std::shared_ptr<Eigen::MatrixXd> projection_matrix_M(new Eigen::MatrixXd(
+      m->control_cost_matrix_R_llt.solve(Eigen::MatrixXd::Identity(num_timesteps,num_timesteps))));
+  for(int t = 0; t < num_timesteps; t++)
+  {
+    double max = (*projection_matrix_M)(t,t);
+    projection_matrix_M->col(t)*= (1.0/(num_timesteps*max)); // scaling such that the maximum value is 1/num_timesteps
+  }
+
+  std::lock_guard<std::mutex> lock(CACHE_MUTEX);
+  if(SMOOTHING_CACHE.size() >= MAX_CACHED_ENTRIES)
+  {
+    SMOOTHING_CACHE.clear();
+  }
+  SMOOTHING_CACHE[key] = projection_matrix_M;
+  return projection_matrix_M;
+}
+
+void clearControlCostCache()
+{
+  std::lock_guard<std::mutex> lock(CACHE_MUTEX);
+  CONTROL_COST_CACHE.clear();
+  SMOOTHING_CACHE.clear();
+}
+
+} /* namespace stomp_core */
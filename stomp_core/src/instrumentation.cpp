@@ -0,0 +1,232 @@
+/**
+ * @file instrumentation.cpp
+ * @brief This contains the exporters of the stomp iteration profiles
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <ros/console.h>
+#include "stomp_core/instrumentation.h"
+
+/**
+ * @brief Formats a number as a JSON value, the values that JSON can not represent are written as null
+ * @param value The number
+ * @return The JSON value
+ */
+static std::string toJson(double value)
+{
+  if(!std::isfinite(value))
+  {
+    return "null";
+  }
+
+  std::ostringstream ss;
+  ss.precision(std::numeric_limits<double>::digits10);
+  ss << value;
+  return ss.str();
+}
+
+namespace stomp_core
+{
+
+const char* IterationStages::getName(IterationStage stage)
+{
+  switch(stage)
+  {
+    case GENERATE_NOISY_ROLLOUTS:
+      return "generateNoisyRollouts";
+    case COMPUTE_NOISY_ROLLOUTS_COSTS:
+      return "computeNoisyRolloutsCosts";
+    case COMPUTE_PROBABILITIES:
+      return "computeProbabilities";
+    case UPDATE_PARAMETERS:
+      return "updateParameters";
+    case COMPUTE_OPTIMIZED_COST:
+      return "computeOptimizedCost";
+    default:
+      return "unknown";
+  }
+}
+
+void IterationProfile::reset(unsigned int iteration)
+{
+  this->iteration = iteration;
+  num_stages = 0;
+  completed = false;
+  stage_durations.fill(0.0);
+  rollouts_generated = 0;
+  rollouts_reused = 0;
+  rollouts_active = 0;
+  min_rollout_cost = 0.0;
+  mean_rollout_cost = 0.0;
+  max_rollout_cost = 0.0;
+  optimized_cost = 0.0;
+  valid = false;
+}
+
+bool isInstrumentationEnabled()
+{
+#ifdef STOMP_CORE_INSTRUMENTATION
+  return true;
+#else
+  return false;
+#endif
+}
+
+void InstrumentationSinkGroup::add(InstrumentationSinkPtr sink)
+{
+  sinks_.push_back(sink);
+}
+
+void InstrumentationSinkGroup::recordIteration(const IterationProfile& profile)
+{
+  for(auto& sink : sinks_)
+  {
+    sink->recordIteration(profile);
+  }
+}
+
+void InstrumentationSinkGroup::recordSolve(const SolveProfile& profile)
+{
+  for(auto& sink : sinks_)
+  {
+    sink->recordSolve(profile);
+  }
+}
+
+ChromeTraceSink::ChromeTraceSink(const std::string& file_name,std::size_t capacity):
+    file_name_(file_name),
+    capacity_(std::max<std::size_t>(capacity,1)),
+    origin_(std::chrono::steady_clock::now())
+{
+
+}
+
+void ChromeTraceSink::recordIteration(const IterationProfile& profile)
+{
+  using namespace IterationStages;
+
+  std::ostringstream args;
+  args << "{\"iteration\":" << profile.iteration
+       << ",\"completed\":" << (profile.completed ? "true" : "false")
+       << ",\"rollouts_generated\":" << profile.rollouts_generated
+       << ",\"rollouts_reused\":" << profile.rollouts_reused
+       << ",\"rollouts_active\":" << profile.rollouts_active;
+  if(profile.num_stages > COMPUTE_NOISY_ROLLOUTS_COSTS)
+  {
+    args << ",\"min_rollout_cost\":" << toJson(profile.min_rollout_cost)
+         << ",\"mean_rollout_cost\":" << toJson(profile.mean_rollout_cost)
+         << ",\"max_rollout_cost\":" << toJson(profile.max_rollout_cost);
+  }
+  args << ",\"optimized_cost\":" << toJson(profile.optimized_cost)
+       << ",\"valid\":" << (profile.valid ? "true" : "false") << "}";
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if(profile.num_stages == 0)
+  {
+    return;
+  }
+
+  // the iteration spans its stages, the deadline checks between them included
+  int last = profile.num_stages - 1;
+  double duration = std::chrono::duration<double>(profile.stage_starts[last] - profile.stage_starts[0]).count() +
+      profile.stage_durations[last];
+  addEvent("iteration",profile.stage_starts[0],duration,args.str());
+  for(int s = 0; s < profile.num_stages; s++)
+  {
+    addEvent(getName(static_cast<IterationStage>(s)),profile.stage_starts[s],profile.stage_durations[s],"");
+  }
+}
+
+void ChromeTraceSink::recordSolve(const SolveProfile& profile)
+{
+  std::ostringstream args;
+  args << "{\"reason\":\"" << TerminationReasons::getName(profile.reason) << "\""
+       << ",\"iterations\":" << profile.iterations
+       << ",\"cost\":" << toJson(profile.cost)
+       << ",\"valid\":" << (profile.valid ? "true" : "false") << "}";
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    addEvent("solve",profile.start,std::chrono::duration<double>(profile.end - profile.start).count(),args.str());
+  }
+
+  if(!write())
+  {
+    ROS_ERROR("Failed to write the STOMP trace to '%s'",file_name_.c_str());
+  }
+}
+
+bool ChromeTraceSink::write() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::ofstream file(file_name_.c_str(),std::ios::trunc);
+  if(!file)
+  {
+    return false;
+  }
+
+  file.precision(std::numeric_limits<double>::digits10);
+  file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  bool first = true;
+  for(const auto& entry : threads_)
+  {
+    file << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << entry.second
+         << ",\"args\":{\"name\":\"stomp " << entry.second << "\"}}";
+    first = false;
+  }
+
+  for(const Event& e : events_)
+  {
+    file << (first ? "" : ",") << "\n{\"name\":\"" << e.name << "\",\"cat\":\"stomp\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+         << e.thread << ",\"ts\":" << e.timestamp << ",\"dur\":" << e.duration;
+    if(!e.args.empty())
+    {
+      file << ",\"args\":" << e.args;
+    }
+    file << "}";
+    first = false;
+  }
+  file << "\n]}\n";
+
+  return static_cast<bool>(file);
+}
+
+void ChromeTraceSink::addEvent(const std::string& name,const std::chrono::steady_clock::time_point& start,
+                               double duration,const std::string& args)
+{
+  // each thread that ran an optimization gets its own track
+  auto thread = threads_.emplace(std::this_thread::get_id(),static_cast<int>(threads_.size()) + 1).first;
+
+  if(events_.size() >= capacity_)
+  {
+    events_.pop_front();
+  }
+  events_.push_back({name,std::chrono::duration<double,std::micro>(start - origin_).count(),duration*1e6,
+                     thread->second,args});
+}
+
+} /* namespace stomp_core */
@@ -0,0 +1,99 @@
+/**
+ * @file rollout_buffer.cpp
+ * @brief This contains the structure-of-arrays storage of the stomp noisy rollouts
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <algorithm>
+#include "stomp_core/rollout_buffer.h"
+
+namespace stomp_core
+{
+
+RolloutBuffer::RolloutBuffer()
+{
+
+}
+
+void RolloutBuffer::resize(int max_rollouts,int num_dimensions,int num_timesteps,double importance_weight,
+                           bool single_precision,bool dimension_blocks)
+{
+  slots_.resize(max_rollouts);
+  reordered_slots_.resize(max_rollouts);
+  slot_taken_.resize(max_rollouts);
+  for(int r = 0; r < max_rollouts; r++)
+  {
+    slots_[r] = r;
+  }
+
+  noise_.assign(max_rollouts,Eigen::MatrixXd::Zero(num_dimensions,num_timesteps));
+  parameters_noise_.assign(max_rollouts,Eigen::MatrixXd::Zero(num_dimensions,num_timesteps));
+  state_costs_.assign(max_rollouts,Eigen::VectorXd::Zero(num_timesteps));
+  control_costs_.assign(max_rollouts,Eigen::MatrixXd::Zero(num_dimensions,num_timesteps));
+  importance_weights_.setConstant(max_rollouts,importance_weight);
+  total_cost_.setZero(max_rollouts);
+  dirty_.assign(max_rollouts,1);
+
+  // only the blocks of the selected precision are allocated
+  int block_dimensions = dimension_blocks ? num_dimensions : 0;
+  int double_dimensions = single_precision ? 0 : block_dimensions;
+  int single_dimensions = single_precision ? block_dimensions : 0;
+  total_costs_.assign(double_dimensions,Eigen::MatrixXd::Zero(max_rollouts,num_timesteps));
+  probabilities_.assign(double_dimensions,Eigen::MatrixXd::Zero(max_rollouts,num_timesteps));
+  dimension_noise_.assign(double_dimensions,Eigen::MatrixXd::Zero(max_rollouts,num_timesteps));
+  single_total_costs_.assign(single_dimensions,Eigen::MatrixXf::Zero(max_rollouts,num_timesteps));
+  single_probabilities_.assign(single_dimensions,Eigen::MatrixXf::Zero(max_rollouts,num_timesteps));
+  single_noise_.assign(single_dimensions,Eigen::MatrixXf::Zero(max_rollouts,num_timesteps));
+  full_costs_.setZero(max_rollouts,num_dimensions);
+  full_probabilities_.setZero(max_rollouts,num_dimensions);
+}
+
+void RolloutBuffer::reorder(const std::vector<int>& source_indices,int count,int first)
+{
+  std::fill(slot_taken_.begin(),slot_taken_.end(),false);
+  for(int i = 0; i < count; i++)
+  {
+    int slot = slots_[source_indices[i]];
+    reordered_slots_[first + i] = slot;
+    slot_taken_[slot] = true;
+  }
+
+  // handing out the remaining slots to the positions left over
+  int next_slot = 0;
+  for(int r = 0; r < size(); r++)
+  {
+    if(r >= first && r < first + count)
+    {
+      continue;
+    }
+
+    while(slot_taken_[next_slot])
+    {
+      next_slot++;
+    }
+    reordered_slots_[r] = next_slot++;
+  }
+
+  slots_.swap(reordered_slots_);
+}
+
+} /* namespace stomp_core */
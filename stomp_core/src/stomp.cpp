@@ -26,8 +26,9 @@
 
 #include <ros/console.h>
 #include <limits.h>
-#include <Eigen/LU>
 #include <Eigen/Cholesky>
+#include <Eigen/Sparse>
+#include <Eigen/SparseCholesky>
 #include <math.h>
 #include <stomp_core/utils.h>
 #include <numeric>
@@ -36,6 +37,8 @@
 static const double DEFAULT_NOISY_COST_IMPORTANCE_WEIGHT = 1.0; /**< Default noisy cost importance weight */
 static const double MIN_COST_DIFFERENCE = 1e-8; /**< Minimum cost difference allowed during probability calculation */
 static const double MIN_CONTROL_COST_WEIGHT = 1e-8; /**< Minimum control cost weight allowed */
+static const double CONVERGING_COST_IMPROVEMENT = 0.01; /**< Relative cost improvement below which the adaptive rollout count shrinks */
+static const int ROLLOUT_GROWTH_DIVISOR = 4; /**< The adaptive rollout count grows by this fraction of itself when the cost does not improve */
 
 /**
  * @brief Compute a linear interpolated trajectory given a start and end state
@@ -93,14 +96,14 @@ static void computeCubicInterpolation(const std::vector<double>& first,const std
  * @param first                        The start position
  * @param last                         The final position
  * @param control_cost_matrix_R_padded The control cost matrix with padding
- * @param inv_control_cost_matrix_R    The inverse constrol cost matrix
+ * @param control_cost_matrix_R_llt    The factorization of the control cost matrix used in place of its inverse
  * @param trajectory_joints            The returned minimum cost trajectory
  * @return True if successful, otherwise false
  */
 bool computeMinCostTrajectory(const std::vector<double>& first,
                               const std::vector<double>& last,
-                              const Eigen::MatrixXd& control_cost_matrix_R_padded,
-                              const Eigen::MatrixXd& inv_control_cost_matrix_R,
+                              const Eigen::SparseMatrix<double>& control_cost_matrix_R_padded,
+                              const stomp_core::BandedCholesky& control_cost_matrix_R_llt,
                               Eigen::MatrixXd& trajectory_joints)
 {
   using namespace stomp_core;
@@ -130,7 +133,7 @@ bool computeMinCostTrajectory(const std::vector<double>& first,
 
     linear_control_cost[d] *=2;
 
-    trajectory_joints.row(d) = -0.5*inv_control_cost_matrix_R*linear_control_cost[d];
+    trajectory_joints.row(d) = -0.5*control_cost_matrix_R_llt.solve(linear_control_cost[d]);
     trajectory_joints(d,0) = first[d];
     trajectory_joints(d,timesteps - 1) = last[d];
   }
@@ -138,25 +141,64 @@ bool computeMinCostTrajectory(const std::vector<double>& first,
   return true;
 }
 
+/**
+ * @brief Computes the exponentiated cost probability of each rollout at every timestep, the loops over the rollouts
+ * are written as array expressions on contiguous columns so that they get vectorized.  It is instantiated in double
+ * and in single precision, see StompConfiguration::single_precision.
+ * @param costs           A matrix [max_rollouts][timesteps] of the rollout costs, only the first 'num_rollouts' rows are used
+ * @param weights         A vector [max_rollouts] of the rollout importance weights
+ * @param num_rollouts    The number of active rollouts
+ * @param h               The exponentiated cost sensitivity
+ * @param min_costs       Workspace [timesteps] that receives the minimum cost at each timestep
+ * @param normalizers     Workspace [timesteps] used to hold the cost range and the probability sum at each timestep
+ * @param probabilities   A matrix [max_rollouts][timesteps] that receives the normalized probabilities
+ */
+template<typename Scalar>
+static void computeExponentiatedCostProbabilities(const Eigen::Matrix<Scalar,Eigen::Dynamic,Eigen::Dynamic>& costs,
+                                                  const Eigen::Matrix<Scalar,Eigen::Dynamic,1>& weights,
+                                                  int num_rollouts,Scalar h,
+                                                  Eigen::Matrix<Scalar,1,Eigen::Dynamic>& min_costs,
+                                                  Eigen::Matrix<Scalar,1,Eigen::Dynamic>& normalizers,
+                                                  Eigen::Matrix<Scalar,Eigen::Dynamic,Eigen::Dynamic>& probabilities)
+{
+  min_costs = costs.topRows(num_rollouts).colwise().minCoeff();
+  normalizers = costs.topRows(num_rollouts).colwise().maxCoeff() - min_costs;
+
+  // prevent division by zero:
+  normalizers = normalizers.array().max(static_cast<Scalar>(MIN_COST_DIFFERENCE)).matrix();
+
+  // this is the exponential term in the probability calculation described in the literature
+  probabilities.topRows(num_rollouts).array() =
+      (-h*((costs.topRows(num_rollouts).array().rowwise() - min_costs.array()).rowwise()/normalizers.array())).exp();
+  probabilities.topRows(num_rollouts).array().colwise() *= weights.head(num_rollouts).array();
+
+  // scaling each probability value by the sum of all probabilities corresponding to all rollouts at time "t"
+  normalizers = probabilities.topRows(num_rollouts).colwise().sum();
+  probabilities.topRows(num_rollouts).array().rowwise() /= normalizers.array();
+}
+
 /**
  * @brief Compute the parameters control costs
  * @param parameters            The parameters used to compute the control cost
  * @param dt                    The timestep in seconds
  * @param control_cost_weight   The control cost weight
- * @param control_cost_matrix_R The control cost matrix
+ * @param control_cost_matrix_R The banded control cost matrix
+ * @param workspace             Preallocated vector [timesteps] used to hold intermediate products
  * @param control_costs returns The parameters control costs
  */
 void computeParametersControlCosts(const Eigen::MatrixXd& parameters,
                                           double dt,
                                           double control_cost_weight,
-                                          const Eigen::MatrixXd& control_cost_matrix_R,
+                                          const Eigen::SparseMatrix<double>& control_cost_matrix_R,
+                                          Eigen::VectorXd& workspace,
                                           Eigen::MatrixXd& control_costs)
 {
   std::size_t num_timesteps = parameters.cols();
   double cost = 0;
   for(auto d = 0u; d < parameters.rows(); d++)
   {
-    cost = double(parameters.row(d)*(control_cost_matrix_R*parameters.row(d).transpose()));
+    workspace.noalias() = control_cost_matrix_R*parameters.row(d).transpose();
+    cost = parameters.row(d).dot(workspace);
     control_costs.row(d).setConstant( 0.5*(1/dt)*cost );
   }
 
@@ -171,7 +213,10 @@ namespace stomp_core {
 
 Stomp::Stomp(const StompConfiguration& config,TaskPtr task):
     config_(config),
-    task_(task)
+    task_(task),
+    deadline_(std::chrono::steady_clock::time_point::max()),
+    shared_thread_pool_(false),
+    streaming_block_size_(0)
 {
 
   resetVariables();
@@ -190,7 +235,8 @@ void Stomp::setConfig(const StompConfiguration& config)
 }
 
 bool Stomp::solve(const std::vector<double>& first,const std::vector<double>& last,
-                  Eigen::MatrixXd& parameters_optimized)
+                  Eigen::MatrixXd& parameters_optimized,
+                  const std::chrono::steady_clock::time_point& deadline)
 {
   // initialize trajectory
   if(!computeInitialTrajectory(first,last))
@@ -198,11 +244,12 @@ bool Stomp::solve(const std::vector<double>& first,const std::vector<double>& la
     ROS_ERROR("Unable to generate initial trajectory");
   }
 
-  return solve(parameters_optimized_,parameters_optimized);
+  return solve(parameters_optimized_,parameters_optimized,deadline);
 }
 
 bool Stomp::solve(const Eigen::VectorXd& first,const Eigen::VectorXd& last,
-                  Eigen::MatrixXd& parameters_optimized)
+                  Eigen::MatrixXd& parameters_optimized,
+                  const std::chrono::steady_clock::time_point& deadline)
 {
   // converting to std vectors
   std::vector<double> start(first.size());
@@ -211,11 +258,12 @@ bool Stomp::solve(const Eigen::VectorXd& first,const Eigen::VectorXd& last,
   Eigen::VectorXd::Map(&start[0],first.size()) = first;
   Eigen::VectorXd::Map(&end[0],last.size()) = last;
 
-  return solve(start,end,parameters_optimized);
+  return solve(start,end,parameters_optimized,deadline);
 }
 
 bool Stomp::solve(const Eigen::MatrixXd& initial_parameters,
-                  Eigen::MatrixXd& parameters_optimized)
+                  Eigen::MatrixXd& parameters_optimized,
+                  const std::chrono::steady_clock::time_point& deadline)
 {
   if(parameters_optimized_.isZero())
   {
@@ -238,18 +286,50 @@ bool Stomp::solve(const Eigen::MatrixXd& initial_parameters,
   }
 
   current_iteration_ = 1;
+  num_rollouts_ = config_.num_rollouts;
   unsigned int valid_iterations = 0;
   current_lowest_cost_ = std::numeric_limits<double>::max();
+  termination_reason_ = TerminationReasons::MAX_ITERATIONS;
+  solve_start_time_ = std::chrono::steady_clock::now();
+  deadline_ = deadline;
+  if(config_.max_optimization_time > 0)
+  {
+    auto time_limit = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(config_.max_optimization_time));
+    deadline_ = std::min(deadline_,solve_start_time_ + time_limit);
+  }
+
+  best_valid_cost_ = std::numeric_limits<double>::max();
+  best_valid_pending_ = false;
+  {
+    std::lock_guard<std::mutex> lock(published_mutex_);
+    published_valid_ = false;
+  }
 
   // computing initialial trajectory cost
+  parameters_dirty_ = true;
   if(!computeOptimizedCost())
   {
     ROS_ERROR("Failed to calculate initial trajectory cost");
     return false;
   }
+  best_valid_iteration_ = 0; // found before the first iteration
+  publishBestValidParameters(false);
 
-  while(current_iteration_ <= config_.num_iterations && runSingleIteration())
+  while(current_iteration_ <= config_.num_iterations)
   {
+    if(!runSingleIteration())
+    {
+      if(!proceed_)
+      {
+        termination_reason_ = TerminationReasons::CANCELLED;
+      }
+      else
+      {
+        termination_reason_ = deadlineReached() ? TerminationReasons::TIME_LIMIT : TerminationReasons::FAILED;
+      }
+      break;
+    }
 
     ROS_DEBUG("STOMP completed iteration %i with cost %f",current_iteration_,current_lowest_cost_);
 
@@ -268,6 +348,13 @@ bool Stomp::solve(const Eigen::MatrixXd& initial_parameters,
 
     if(valid_iterations > config_.num_iterations_after_valid)
     {
+      termination_reason_ = TerminationReasons::VALID_SOLUTION;
+      break;
+    }
+
+    if(checkConvergence(termination_reason_))
+    {
+      ROS_DEBUG("STOMP converged after %i iterations",current_iteration_);
       break;
     }
 
@@ -281,27 +368,143 @@ bool Stomp::solve(const Eigen::MatrixXd& initial_parameters,
   }
   else
   {
-    if (proceed_)
-      ROS_ERROR("STOMP failed to find a valid solution after %i iterations",current_iteration_);
-    else
+    if (!proceed_)
       ROS_ERROR_STREAM("Stomp was terminated");
+    else if(termination_reason_ == TerminationReasons::TIME_LIMIT)
+      ROS_ERROR("STOMP reached its deadline without a valid solution after %i iterations",current_iteration_);
+    else
+      ROS_ERROR("STOMP failed to find a valid solution after %i iterations",current_iteration_);
   }
 
   parameters_optimized = parameters_optimized_;
+  publishBestValidParameters(true);
+
+  STOMP_CORE_INSTRUMENT(instrumentation_sink_,instrumentation_sink_->recordSolve(
+      {solve_start_time_,std::chrono::steady_clock::now(),termination_reason_,getNumIterations(),current_lowest_cost_,
+       parameters_valid_}));
 
   // notifying task
-  task_->done(parameters_valid_,current_iteration_,current_lowest_cost_,parameters_optimized);
+  task_->done(parameters_valid_,current_iteration_,current_lowest_cost_,parameters_optimized,termination_reason_);
 
   return parameters_valid_;
 }
 
+bool Stomp::solveRecedingHorizon(std::size_t executed_timesteps,const Eigen::VectorXd& goal,
+                                 Eigen::MatrixXd& parameters_optimized,
+                                 const std::chrono::steady_clock::time_point& deadline)
+{
+  if(current_iteration_ == 0 || parameters_optimized_.isZero())
+  {
+    ROS_ERROR("No previous solution to continue in a receding horizon");
+    return false;
+  }
+
+  if(goal.size() != config_.num_dimensions)
+  {
+    ROS_ERROR("Receding horizon goal dimensions is incorrect");
+    return false;
+  }
+
+  if(executed_timesteps >= static_cast<std::size_t>(config_.num_timesteps))
+  {
+    ROS_ERROR("Receding horizon executed timesteps %i exceed the %i time steps",int(executed_timesteps),
+              config_.num_timesteps);
+    return false;
+  }
+
+  // the rollouts kept for reuse are shifted with the trajectory, their state costs at the appended timesteps are
+  // approximated by that of their last timestep as the reused costs already approximate the shifted noise
+  int shift = static_cast<int>(executed_timesteps);
+  Eigen::VectorXd goal_offset = goal - parameters_optimized_.col(config_.num_timesteps - 1);
+  int rollouts_stored = std::max(num_active_rollouts_ - 1,0);
+  for(auto r = 0; r < rollouts_stored; r++)
+  {
+    shiftTrajectory(shift,goal_offset,noisy_rollouts_.parametersNoise(r));
+    Eigen::VectorXd& state_costs = noisy_rollouts_.stateCosts(r);
+    int kept = config_.num_timesteps - shift;
+    state_costs.head(kept) = state_costs.tail(kept).eval();
+    state_costs.tail(shift).setConstant(state_costs(kept - 1));
+    noisy_rollouts_.setDirty(r,true);
+  }
+
+  shiftTrajectory(shift,goal_offset,parameters_optimized_);
+  parameters_dirty_ = true;
+
+  return solve(parameters_optimized_,parameters_optimized,deadline);
+}
+
+void Stomp::shiftTrajectory(int executed_timesteps,const Eigen::VectorXd& goal_offset,Eigen::MatrixXd& trajectory) const
+{
+  int num_timesteps = trajectory.cols();
+  int kept = num_timesteps - executed_timesteps;
+  if(executed_timesteps > 0)
+  {
+    trajectory.leftCols(kept) = trajectory.rightCols(kept).eval();
+    trajectory.rightCols(executed_timesteps) = trajectory.col(kept - 1).replicate(1,executed_timesteps);
+  }
+
+  for(auto t = 1; t < num_timesteps; t++)
+  {
+    trajectory.col(t) += (static_cast<double>(t)/(num_timesteps - 1))*goal_offset;
+  }
+}
+
+bool Stomp::solveWindow(const Eigen::MatrixXd& initial_parameters,std::size_t window_start,
+                        std::size_t window_timesteps,Eigen::MatrixXd& parameters_optimized,
+                        const std::chrono::steady_clock::time_point& deadline)
+{
+  if(initial_parameters.rows() != config_.num_dimensions || initial_parameters.cols() != config_.num_timesteps)
+  {
+    ROS_ERROR("Initial trajectory dimensions is incorrect");
+    return false;
+  }
+
+  if(window_timesteps == 0 || window_start + window_timesteps > static_cast<std::size_t>(config_.num_timesteps))
+  {
+    ROS_ERROR("Optimization window [%i, %i) exceeds the %i time steps",int(window_start),
+              int(window_start + window_timesteps),config_.num_timesteps);
+    return false;
+  }
+
+  // the rollouts kept from a previous optimization perturbed another trajectory
+  num_active_rollouts_ = 0;
+  parameters_optimized_ = initial_parameters;
+  setOptimizationWindow(window_start,window_timesteps,true);
+
+  bool solved = solve(initial_parameters,parameters_optimized,deadline);
+
+  // restoring the configured window
+  int configured_timesteps = config_.num_timesteps;
+  if(config_.window_size > 0 && config_.window_size < config_.num_timesteps)
+  {
+    configured_timesteps = config_.window_size;
+  }
+  setOptimizationWindow(0,configured_timesteps,false);
+
+  return solved;
+}
+
+void Stomp::setOptimizationWindow(int window_start,int window_timesteps,bool fixed)
+{
+  window_start_ = window_start;
+  window_timesteps_ = window_timesteps;
+  fixed_window_ = fixed;
+  window_state_costs_.assign(config_.num_threads,Eigen::VectorXd::Zero(window_timesteps_));
+  if(batch_state_costs_.size() > 0)
+  {
+    batch_state_costs_.setZero(batch_state_costs_.rows(),window_timesteps_);
+  }
+}
+
 bool Stomp::resetVariables()
 {
   proceed_= true;
   parameters_total_cost_ = 0;
   parameters_valid_ = false;
   num_active_rollouts_ = 0;
+  num_rollouts_ = config_.num_rollouts;
   current_iteration_ = 0;
+  termination_reason_ = TerminationReasons::MAX_ITERATIONS;
 
   // verifying configuration
   if(config_.max_rollouts <= config_.num_rollouts)
@@ -310,46 +513,45 @@ bool Stomp::resetVariables()
     config_.max_rollouts = config_.num_rollouts + 1; // one more to accommodate optimized trajectory
   }
 
-  // noisy rollouts allocation
-  int d = config_.num_dimensions;
-  num_active_rollouts_ = 0;
-  noisy_rollouts_.resize(config_.max_rollouts);
-  reused_rollouts_.resize(config_.max_rollouts);
-
-  // initializing rollout
-  Rollout rollout;
-  rollout.noise.resize(d, config_.num_timesteps);
-  rollout.noise.setZero();
-
-  rollout.parameters_noise.resize(d, config_.num_timesteps);
-  rollout.parameters_noise.setZero();
-
-  rollout.probabilities.resize(d, config_.num_timesteps);
-  rollout.probabilities.setZero();
-
-  rollout.full_probabilities.clear();
-  rollout.full_probabilities.resize(d);
-
-  rollout.full_costs.clear();
-  rollout.full_costs.resize(d);
-
-  rollout.control_costs.resize(d, config_.num_timesteps);
-  rollout.control_costs.setZero();
-
-  rollout.total_costs.resize(d, config_.num_timesteps);
-  rollout.total_costs.setZero();
-
-  rollout.state_costs.resize(config_.num_timesteps);
-  rollout.state_costs.setZero();
+  if(config_.num_threads < 1)
+  {
+    ROS_DEBUG_STREAM("'num_threads' must be at least 1, rollouts will be evaluated serially.");
+    config_.num_threads = 1;
+  }
 
-  rollout.importance_weight = DEFAULT_NOISY_COST_IMPORTANCE_WEIGHT;
+  // worker threads allocation
+  if(shared_thread_pool_)
+  {
+    config_.num_threads = static_cast<int>(thread_pool_->size());
+  }
+  else if(!thread_pool_ || thread_pool_->size() != static_cast<std::size_t>(config_.num_threads))
+  {
+    thread_pool_.reset(new ThreadPool(config_.num_threads));
+  }
 
-  for(unsigned int r = 0; r < config_.max_rollouts ; r++)
+  // the streaming update only replaces the double precision timestep blocks
+  bool timestep_updates = config_.num_control_points < 4 || config_.num_control_points >= config_.num_timesteps;
+  if(config_.streaming_block_size > 0 && !config_.single_precision && timestep_updates)
   {
-    noisy_rollouts_[r] = rollout;
-    reused_rollouts_[r] = rollout;
+    streaming_block_size_ = std::min(config_.streaming_block_size,config_.num_timesteps);
+  }
+  else
+  {
+    if(config_.streaming_block_size > 0)
+    {
+      ROS_DEBUG_STREAM("'streaming_block_size' only applies in double precision without control points, it is ignored.");
+    }
+    streaming_block_size_ = 0;
   }
 
+  // noisy rollouts allocation
+  int d = config_.num_dimensions;
+  num_active_rollouts_ = 0;
+  noisy_rollouts_.resize(config_.max_rollouts,d,config_.num_timesteps,DEFAULT_NOISY_COST_IMPORTANCE_WEIGHT,
+                         config_.single_precision,streaming_block_size_ == 0);
+  reused_rollout_indices_.clear();
+  reused_rollout_indices_.reserve(config_.max_rollouts);
+
   // parameter updates
   parameters_updates_.resize(d, config_.num_timesteps);
   parameters_updates_.setZero();
@@ -360,31 +562,143 @@ bool Stomp::resetVariables()
   parameters_state_costs_.resize(config_.num_timesteps);
   parameters_state_costs_.setZero();
 
+  candidate_control_costs_.setZero(d, config_.num_timesteps);
+  candidate_state_costs_.setZero(config_.num_timesteps);
+  parameters_dirty_ = true;
+
   parameters_optimized_.resize(config_.num_dimensions,config_.num_timesteps);
   parameters_optimized_.setZero();
 
-  // generate finite difference matrix
-  start_index_padded_ = FINITE_DIFF_RULE_LENGTH-1;
-  num_timesteps_padded_ = config_.num_timesteps + 2*(FINITE_DIFF_RULE_LENGTH-1);
-  generateFiniteDifferenceMatrix(num_timesteps_padded_,DerivativeOrders::STOMP_ACCELERATION,
-                                 config_.delta_t,finite_diff_matrix_A_padded_);
-
-  /* control cost matrix (R = A_transpose * A):
-   * Note: Original code multiplies the A product by the time interval.  However this is not
-   * what was described in the literature
-   */
-  control_cost_matrix_R_padded_ = config_.delta_t*finite_diff_matrix_A_padded_.transpose() * finite_diff_matrix_A_padded_;
-  control_cost_matrix_R_ = control_cost_matrix_R_padded_.block(
-      start_index_padded_,start_index_padded_,config_.num_timesteps,config_.num_timesteps);
-  inv_control_cost_matrix_R_ = control_cost_matrix_R_.fullPivLu().inverse();
-
-  /*
-   * Applying scale factor to ensure that max(R^-1)==1
-   */
-  double maxVal = std::abs(inv_control_cost_matrix_R_.maxCoeff());
-  control_cost_matrix_R_padded_ *= maxVal;
-  control_cost_matrix_R_ *= maxVal;
-  inv_control_cost_matrix_R_ /= maxVal; // used in computing the minimum control cost initial trajectory
+  // best valid parameters
+  best_valid_parameters_.setZero(d, config_.num_timesteps);
+  best_valid_cost_ = std::numeric_limits<double>::max();
+  best_valid_iteration_ = 0;
+  best_valid_pending_ = false;
+  {
+    std::lock_guard<std::mutex> lock(published_mutex_);
+    published_parameters_.setZero(d, config_.num_timesteps);
+    published_cost_ = std::numeric_limits<double>::max();
+    published_iteration_ = 0;
+    published_valid_ = false;
+  }
+
+  // iteration workspace
+  control_cost_workspace_.setZero(config_.num_timesteps);
+  control_cost_rollouts_.clear();
+  control_cost_rollouts_.reserve(config_.max_rollouts);
+  control_cost_noise_.setZero(config_.max_rollouts*d,config_.num_timesteps);
+  control_cost_products_.setZero(config_.max_rollouts*d,config_.num_timesteps);
+  control_cost_values_.setZero(config_.max_rollouts*d);
+  control_cost_scales_.setZero(config_.max_rollouts);
+  rollout_cost_sorter_.clear();
+  rollout_cost_sorter_.reserve(config_.max_rollouts);
+  rollout_importance_weights_.setZero(config_.max_rollouts);
+
+  // convergence
+  cost_history_.assign(std::max(config_.convergence_iterations,0),std::numeric_limits<double>::max());
+
+  // optimization window
+  int window_timesteps = config_.num_timesteps;
+  if(config_.window_size > 0 && config_.window_size < config_.num_timesteps)
+  {
+    window_timesteps = config_.window_size;
+  }
+  setOptimizationWindow(0,window_timesteps,false);
+
+  // the Ref interface writes into the storage above, which already has the sizes it expects
+  ref_interface_ = task_->supportsRefInterface();
+
+  // batch cost evaluation, the per rollout path does not need the contiguous copy of the rollouts
+  batch_costs_ = task_->supportsBatchCosts();
+  if(batch_costs_)
+  {
+    batch_parameters_.setZero(config_.num_dimensions,num_rollouts_*config_.num_timesteps);
+    batch_state_costs_.setZero(num_rollouts_,window_timesteps_);
+    batch_validities_.assign(num_rollouts_,true);
+  }
+  else
+  {
+    batch_parameters_.resize(0,0);
+    batch_state_costs_.resize(0,0);
+    batch_validities_.clear();
+  }
+  timestep_min_costs_.setZero(config_.num_timesteps);
+  timestep_normalizers_.setZero(config_.num_timesteps);
+
+  // streaming update workspace, a block per worker
+  int block_columns = streaming_block_size_;
+  int block_threads = block_columns > 0 ? config_.num_threads : 0;
+  streaming_costs_.assign(block_threads,Eigen::MatrixXd::Zero(config_.max_rollouts,block_columns));
+  streaming_probabilities_.assign(block_threads,Eigen::MatrixXd::Zero(config_.max_rollouts,block_columns));
+  streaming_min_costs_.assign(block_threads,Eigen::RowVectorXd::Zero(block_columns));
+  streaming_normalizers_.assign(block_threads,Eigen::RowVectorXd::Zero(block_columns));
+
+  // single precision kernels, the workspace holds a value per timestep or per control point
+  bool spline = config_.num_control_points > 3 && config_.num_control_points < config_.num_timesteps;
+  int single_columns = spline ? config_.num_control_points : config_.num_timesteps;
+  if(config_.single_precision)
+  {
+    single_importance_weights_.setZero(config_.max_rollouts);
+    single_min_costs_.setZero(single_columns);
+    single_normalizers_.setZero(single_columns);
+  }
+  else
+  {
+    single_importance_weights_.resize(0);
+    single_min_costs_.resize(0);
+    single_normalizers_.resize(0);
+  }
+
+  // spline parameterization, the control points are fitted to the timesteps by least squares
+  if(spline)
+  {
+    int k = config_.num_control_points;
+    generateBSplineBasis(k,config_.num_timesteps,spline_basis_);
+    Eigen::MatrixXd gram = spline_basis_*spline_basis_.transpose();
+    spline_projection_ = spline_basis_.transpose()*gram.ldlt().solve(Eigen::MatrixXd::Identity(k,k));
+    spline_cost_weights_ = spline_basis_.transpose();
+    spline_cost_weights_.array().rowwise() /= spline_cost_weights_.colwise().sum().array();
+
+    spline_noise_.assign(config_.num_threads,Eigen::MatrixXd::Zero(d,k));
+    spline_rollout_noise_.setZero(d,k);
+    spline_updates_.setZero(d,k);
+    int double_dimensions = config_.single_precision ? 0 : d;
+    int single_dimensions = config_.single_precision ? d : 0;
+    spline_costs_.assign(double_dimensions,Eigen::MatrixXd::Zero(config_.max_rollouts,k));
+    spline_probabilities_.assign(double_dimensions,Eigen::MatrixXd::Zero(config_.max_rollouts,k));
+    spline_min_costs_.setZero(k);
+    spline_normalizers_.setZero(k);
+    single_spline_cost_weights_ = spline_cost_weights_.cast<float>();
+    single_spline_costs_.assign(single_dimensions,Eigen::MatrixXf::Zero(config_.max_rollouts,k));
+    single_spline_probabilities_.assign(single_dimensions,Eigen::MatrixXf::Zero(config_.max_rollouts,k));
+  }
+  else
+  {
+    if(config_.num_control_points > 0 && config_.num_control_points < 4)
+    {
+      ROS_DEBUG_STREAM("'num_control_points' must be at least 4, every timestep will be optimized.");
+    }
+    spline_basis_.resize(0,0);
+    spline_projection_.resize(0,0);
+    spline_cost_weights_.resize(0,0);
+    spline_noise_.clear();
+    spline_rollout_noise_.resize(0,0);
+    spline_updates_.resize(0,0);
+    spline_costs_.clear();
+    spline_probabilities_.clear();
+    single_spline_cost_weights_.resize(0,0);
+    single_spline_costs_.clear();
+    single_spline_probabilities_.clear();
+  }
+
+  // finite difference and control cost matrices, shared by every instance with the same timesteps and delta_t
+  control_cost_matrices_ = getControlCostMatrices(config_.num_timesteps,config_.delta_t,
+                                                  DerivativeOrders::STOMP_ACCELERATION);
+  if(!control_cost_matrices_)
+  {
+    ROS_ERROR("Failed to compute the control cost matrices");
+    return false;
+  }
 
   return true;
 }
@@ -405,13 +719,42 @@ bool Stomp::computeInitialTrajectory(const std::vector<double>& first,const std:
       break;
     case TrajectoryInitializations::MININUM_CONTROL_COST:
 
-      valid = computeMinCostTrajectory(first,last,control_cost_matrix_R_padded_,inv_control_cost_matrix_R_,parameters_optimized_);
+      valid = computeMinCostTrajectory(first,last,control_cost_matrices_->control_cost_matrix_R_padded,
+                                       control_cost_matrices_->control_cost_matrix_R_llt,parameters_optimized_);
       break;
   }
 
   return valid;
 }
 
+TerminationReasons::TerminationReason Stomp::getTerminationReason() const
+{
+  return termination_reason_;
+}
+
+double Stomp::getOptimizedCost() const
+{
+  return current_lowest_cost_;
+}
+
+unsigned int Stomp::getNumIterations() const
+{
+  // the iteration counter is advanced past 'num_iterations' when all the iterations are run
+  return std::min(current_iteration_,static_cast<unsigned int>(config_.num_iterations));
+}
+
+void Stomp::setInstrumentationSink(InstrumentationSinkPtr sink)
+{
+  instrumentation_sink_ = sink;
+}
+
+void Stomp::setThreadPool(ThreadPoolPtr pool)
+{
+  shared_thread_pool_ = pool != nullptr;
+  thread_pool_ = pool;
+  resetVariables();
+}
+
 bool Stomp::cancel()
 {
   ROS_WARN("Interrupting STOMP");
@@ -421,17 +764,36 @@ bool Stomp::cancel()
 
 bool Stomp::runSingleIteration()
 {
-  if(!proceed_)
+  if(!proceed_ || deadlineReached())
   {
     return false;
   }
 
-  bool proceed = generateNoisyRollouts() &&
-      computeNoisyRolloutsCosts() &&
-      filterNoisyRollouts() &&
-      computeProbabilities() &&
-      updateParameters() &&
-      computeOptimizedCost();
+  // the iteration is abandoned before the parameters are updated when the deadline is reached
+  double previous_cost = current_lowest_cost_;
+  STOMP_CORE_INSTRUMENT(instrumentation_sink_,iteration_profile_.reset(current_iteration_);
+                        iteration_profile_.rollouts_generated = num_rollouts_);
+  bool proceed = STOMP_CORE_INSTRUMENT_STAGE(instrumentation_sink_,iteration_profile_,
+                                             IterationStages::GENERATE_NOISY_ROLLOUTS,generateNoisyRollouts()) &&
+      !deadlineReached() &&
+      STOMP_CORE_INSTRUMENT_STAGE(instrumentation_sink_,iteration_profile_,
+                                  IterationStages::COMPUTE_NOISY_ROLLOUTS_COSTS,computeNoisyRolloutsCosts()) &&
+      !deadlineReached() &&
+      STOMP_CORE_INSTRUMENT_STAGE(instrumentation_sink_,iteration_profile_,
+                                  IterationStages::COMPUTE_PROBABILITIES,computeProbabilities()) &&
+      !deadlineReached() &&
+      STOMP_CORE_INSTRUMENT_STAGE(instrumentation_sink_,iteration_profile_,
+                                  IterationStages::UPDATE_PARAMETERS,updateParameters()) &&
+      STOMP_CORE_INSTRUMENT_STAGE(instrumentation_sink_,iteration_profile_,
+                                  IterationStages::COMPUTE_OPTIMIZED_COST,computeOptimizedCost());
+
+  if(proceed)
+  {
+    publishBestValidParameters(false);
+    adaptRolloutCount(previous_cost);
+  }
+
+  STOMP_CORE_INSTRUMENT(instrumentation_sink_,recordIterationProfile(proceed));
 
   // notifying end of iteration
   task_->postIteration(0,config_.num_timesteps,current_iteration_,current_lowest_cost_,parameters_optimized_);
@@ -442,11 +804,11 @@ bool Stomp::runSingleIteration()
 bool Stomp::generateNoisyRollouts()
 {
   // calculating number of rollouts to reuse from previous iteration
-  std::vector< std::pair<double,int> > rollout_cost_sorter; // Used to sort noisy trajectories in ascending order wrt their total cost
+  rollout_cost_sorter_.clear();
   double h = config_.exponentiated_cost_sensitivity;
   int rollouts_stored = num_active_rollouts_-1; // don't take the optimized rollout into account
   rollouts_stored = rollouts_stored < 0 ? 0 : rollouts_stored;
-  int rollouts_generate = config_.num_rollouts;
+  int rollouts_generate = num_rollouts_;
   int rollouts_total = rollouts_generate + rollouts_stored +1;
   int rollouts_reuse =  rollouts_total < config_.max_rollouts  ? rollouts_stored :  config_.max_rollouts - (rollouts_generate + 1) ; // +1 for optimized params
 
@@ -458,7 +820,7 @@ bool Stomp::generateNoisyRollouts()
     double max_cost = std::numeric_limits<double>::min();
     for (int r=1; r<rollouts_stored; ++r)
     {
-      double c = noisy_rollouts_[r].total_cost;
+      double c = noisy_rollouts_.totalCost(r);
       if (c < min_cost)
         min_cost = c;
       if (c > max_cost)
@@ -472,79 +834,164 @@ bool Stomp::generateNoisyRollouts()
     // compute weighted cost on all rollouts
     double cost_prob;
     double weighted_prob;
-    for (auto r = 0u; r<rollouts_stored; ++r)
+    for(int r = 0; r<rollouts_stored; ++r)
     {
 
       // Apply noise generated on the previous iteration onto the current trajectory
-      noisy_rollouts_[r].noise = noisy_rollouts_[r].parameters_noise
+      noisy_rollouts_.noise(r) = noisy_rollouts_.parametersNoise(r)
           - parameters_optimized_;
 
-      cost_prob = exp(-h*(noisy_rollouts_[r].total_cost - min_cost)/cost_denom);
-      weighted_prob = cost_prob * noisy_rollouts_[r].importance_weight;
-      rollout_cost_sorter.push_back(std::make_pair(-weighted_prob,r));
+      cost_prob = exp(-h*(noisy_rollouts_.totalCost(r) - min_cost)/cost_denom);
+      weighted_prob = cost_prob * noisy_rollouts_.importanceWeight(r);
+      rollout_cost_sorter_.push_back(std::make_pair(-weighted_prob,r));
     }
 
 
-    std::sort(rollout_cost_sorter.begin(), rollout_cost_sorter.end());
-
-    // use the best ones: (copy them into reused_rollouts)
-    for (auto r = 0u; r<rollouts_stored; ++r)
-    {
-      int reuse_index = rollout_cost_sorter[r].second;
-      reused_rollouts_[r] = noisy_rollouts_[reuse_index];
-    }
+    std::sort(rollout_cost_sorter_.begin(), rollout_cost_sorter_.end());
 
-    // copy them back from reused_rollouts_ into rollouts_
-    for (auto r = 0u; r<rollouts_reuse; ++r)
+    // use the best ones: (move them after the rollouts that will be generated, only their indices are reordered)
+    reused_rollout_indices_.clear();
+    for(int r = 0; r<rollouts_reuse; ++r)
     {
-      noisy_rollouts_[rollouts_generate + r ] = reused_rollouts_[r];
+      reused_rollout_indices_.push_back(rollout_cost_sorter_[r].second);
     }
+    noisy_rollouts_.reorder(reused_rollout_indices_,rollouts_reuse,rollouts_generate);
   }
 
   // adding optimized trajectory as the last rollout
-  noisy_rollouts_[rollouts_generate + rollouts_reuse].parameters_noise = parameters_optimized_;
-  noisy_rollouts_[rollouts_generate + rollouts_reuse].noise.setZero();
-  noisy_rollouts_[rollouts_generate + rollouts_reuse].state_costs = parameters_state_costs_;
-  noisy_rollouts_[rollouts_generate + rollouts_reuse].control_costs = parameters_control_costs_;
+  int optimized_index = rollouts_generate + rollouts_reuse;
+  noisy_rollouts_.parametersNoise(optimized_index) = parameters_optimized_;
+  noisy_rollouts_.noise(optimized_index).setZero();
+  noisy_rollouts_.stateCosts(optimized_index) = parameters_state_costs_;
+  noisy_rollouts_.controlCosts(optimized_index) = parameters_control_costs_;
+  noisy_rollouts_.setDirty(optimized_index,false);
 
 
-  // generate new noisy rollouts
-  for(auto r = 0u; r < rollouts_generate; r++)
+  // selecting the window of timesteps to perturb, it advances by half its size every iteration
+  if(window_timesteps_ < config_.num_timesteps && !fixed_window_)
+  {
+    int window_stride = std::max(window_timesteps_/2,1);
+    int num_window_starts = config_.num_timesteps - window_timesteps_ + 1;
+    window_start_ = ((current_iteration_ - 1)*window_stride) % num_window_starts;
+  }
+
+  // the batch follows the adaptive rollout count
+  if(batch_costs_ && batch_state_costs_.rows() != rollouts_generate)
+  {
+    batch_parameters_.setZero(config_.num_dimensions,rollouts_generate*config_.num_timesteps);
+    batch_state_costs_.setZero(rollouts_generate,window_timesteps_);
+    batch_validities_.assign(rollouts_generate,true);
+  }
+
+  // generate, filter and evaluate the new noisy rollouts, each one by a single worker.  Batch capable tasks evaluate
+  // all of them at once afterwards from a contiguous copy
+  std::atomic<bool> proceed(true);
+  auto process_rollout = [&](std::size_t r, std::size_t worker)
   {
-    if(!task_->generateNoisyParameters(parameters_optimized_,
-                                      0,config_.num_timesteps,
-                                      current_iteration_,r,
-                                      noisy_rollouts_[r].parameters_noise,
-                                      noisy_rollouts_[r].noise))
+    if(!proceed_ || !proceed || deadlineReached())
     {
-      ROS_ERROR("Failed to generate noisy parameters at iteration %i",current_iteration_);
-      return false;
+      proceed = false;
+      return;
+    }
+
+    noisy_rollouts_.setDirty(r,true);
+    if(!generateNoisyRollout(r,worker) || !filterNoisyRollout(r))
+    {
+      proceed = false;
     }
+    else if(batch_costs_)
+    {
+      batch_parameters_.middleCols(r*config_.num_timesteps,config_.num_timesteps) = noisy_rollouts_.parametersNoise(r);
+    }
+    else if(!computeRolloutStateCosts(r,worker))
+    {
+      proceed = false;
+    }
+  };
+
+  thread_pool_->parallelFor(rollouts_generate,process_rollout);
 
+  if(batch_costs_ && proceed && !computeRolloutsStateCostsBatch(rollouts_generate))
+  {
+    proceed = false;
   }
 
   // update total active rollouts
   num_active_rollouts_ = rollouts_reuse + rollouts_generate + 1;
 
+  return proceed;
+}
+
+bool Stomp::generateNoisyRollout(int r,std::size_t worker)
+{
+  bool generated;
+  int tail = config_.num_timesteps - (window_start_ + window_timesteps_);
+  if(ref_interface_)
+  {
+    // the task writes the window only, the noise outside of it is cleared before the spline projection reads it
+    generated = task_->generateNoisyParametersRef(parameters_optimized_,
+                                                  window_start_,window_timesteps_,
+                                                  current_iteration_,r,
+                                                  noisy_rollouts_.parametersNoise(r).middleCols(window_start_,window_timesteps_),
+                                                  noisy_rollouts_.noise(r).middleCols(window_start_,window_timesteps_));
+    if(generated && window_timesteps_ < config_.num_timesteps)
+    {
+      noisy_rollouts_.noise(r).leftCols(window_start_).setZero();
+      noisy_rollouts_.noise(r).rightCols(tail).setZero();
+    }
+  }
+  else
+  {
+    generated = task_->generateNoisyParameters(parameters_optimized_,
+                                               window_start_,window_timesteps_,
+                                               current_iteration_,r,
+                                               noisy_rollouts_.parametersNoise(r),
+                                               noisy_rollouts_.noise(r));
+  }
+
+  if(!generated)
+  {
+    ROS_ERROR("Failed to generate noisy parameters at iteration %i",current_iteration_);
+    return false;
+  }
+
+  if(spline_basis_.size() > 0)
+  {
+    // the rollout only explores the motions that the control points can represent
+    Eigen::MatrixXd& noise = noisy_rollouts_.noise(r);
+    Eigen::MatrixXd& coefficients = spline_noise_[worker];
+    coefficients.noalias() = noise*spline_projection_;
+    noise.noalias() = coefficients*spline_basis_;
+    noisy_rollouts_.parametersNoise(r) = parameters_optimized_ + noise;
+  }
+
+  if(window_timesteps_ < config_.num_timesteps)
+  {
+    // only the timesteps inside the window are perturbed
+    Eigen::MatrixXd& noise = noisy_rollouts_.noise(r);
+    Eigen::MatrixXd& parameters_noise = noisy_rollouts_.parametersNoise(r);
+    noise.leftCols(window_start_).setZero();
+    noise.rightCols(tail).setZero();
+    parameters_noise.leftCols(window_start_) = parameters_optimized_.leftCols(window_start_);
+    parameters_noise.rightCols(tail) = parameters_optimized_.rightCols(tail);
+  }
+
   return true;
 }
 
-bool Stomp::filterNoisyRollouts()
+bool Stomp::filterNoisyRollout(int r)
 {
   // apply post noise generation filters
   bool filtered = false;
-  for(auto r = 0u ; r < config_.num_rollouts; r++)
+  if(!task_->filterNoisyParameters(0,config_.num_timesteps,current_iteration_,r,noisy_rollouts_.parametersNoise(r),filtered))
   {
-    if(!task_->filterNoisyParameters(0,config_.num_timesteps,current_iteration_,r,noisy_rollouts_[r].parameters_noise,filtered))
-    {
-      ROS_ERROR_STREAM("Failed to filter noisy parameters");
-      return false;
-    }
+    ROS_ERROR_STREAM("Failed to filter noisy parameters");
+    return false;
+  }
 
-    if(filtered)
-    {
-      noisy_rollouts_[r].noise = noisy_rollouts_[r].parameters_noise - parameters_optimized_;
-    }
+  if(filtered)
+  {
+    noisy_rollouts_.noise(r) = noisy_rollouts_.parametersNoise(r) - parameters_optimized_;
   }
 
   return true;
@@ -552,8 +999,8 @@ bool Stomp::filterNoisyRollouts()
 
 bool Stomp::computeNoisyRolloutsCosts()
 {
-  // computing state and control costs
-  bool valid = computeRolloutsStateCosts() && computeRolloutsControlCosts();
+  // the state costs of the new rollouts were computed when they were generated
+  bool valid = computeRolloutsControlCosts();
 
   if(valid)
   {
@@ -561,26 +1008,46 @@ bool Stomp::computeNoisyRolloutsCosts()
     double total_state_cost ;
     double total_control_cost;
 
-    for(auto r = 0u ; r < num_active_rollouts_;r++)
+    for(int r = 0; r < num_active_rollouts_;r++)
     {
-      Rollout& rollout = noisy_rollouts_[r];
-      total_state_cost = rollout.state_costs.sum();
+      const Eigen::VectorXd& state_costs = noisy_rollouts_.stateCosts(r);
+      const Eigen::MatrixXd& control_costs = noisy_rollouts_.controlCosts(r);
+      total_state_cost = state_costs.sum();
 
       // Compute control + state cost for each joint
       total_control_cost = 0;
       double ccost = 0;
-      for(auto d = 0u; d < config_.num_dimensions; d++)
+      for(int d = 0; d < config_.num_dimensions; d++)
       {
-        ccost = rollout.control_costs.row(d).sum();
+        ccost = control_costs.row(d).sum();
         total_control_cost += ccost;
-        rollout.full_costs[d] = ccost + total_state_cost;
+        noisy_rollouts_.fullCosts()(r,d) = ccost + total_state_cost;
       }
-      rollout.total_cost = total_state_cost + total_control_cost;
+      noisy_rollouts_.totalCost(r) = total_state_cost + total_control_cost;
 
-      // Compute total cost for each time step
-      for(auto d = 0u; d < config_.num_dimensions; d++)
+      // Compute total cost for each time step, the noise is copied next to it in rollout order
+      if(config_.single_precision)
       {
-        rollout.total_costs.row(d) = rollout.state_costs.transpose() + rollout.control_costs.row(d);
+        const Eigen::MatrixXd& noise = noisy_rollouts_.noise(r);
+        for(int d = 0; d < config_.num_dimensions; d++)
+        {
+          noisy_rollouts_.singleTotalCosts(d).row(r) = (state_costs.transpose() + control_costs.row(d)).cast<float>();
+          noisy_rollouts_.singleNoise(d).row(r) = noise.row(d).cast<float>();
+        }
+        continue;
+      }
+
+      // the streaming update computes the timestep costs per block when it needs them
+      if(streaming_block_size_ > 0)
+      {
+        continue;
+      }
+
+      const Eigen::MatrixXd& noise = noisy_rollouts_.noise(r);
+      for(int d = 0; d < config_.num_dimensions; d++)
+      {
+        noisy_rollouts_.totalCosts(d).row(r) = state_costs.transpose() + control_costs.row(d);
+        noisy_rollouts_.dimensionNoise(d).row(r) = noise.row(d);
       }
     }
   }
@@ -588,122 +1055,220 @@ bool Stomp::computeNoisyRolloutsCosts()
   return valid;
 }
 
-bool Stomp::computeRolloutsStateCosts()
+bool Stomp::computeRolloutStateCosts(int r,std::size_t worker)
 {
-
-  bool all_valid = true;
-  bool proceed = true;
-  for(auto r = 0u ; r < config_.num_rollouts; r++)
+  // each rollout writes into its own slot so they can be evaluated concurrently
+  bool valid;
+  if(ref_interface_)
   {
-    if(!proceed_)
+    // the costs of the window are written in place, those of the remaining timesteps are of the optimized parameters
+    Eigen::VectorXd& state_costs = noisy_rollouts_.stateCosts(r);
+    if(window_timesteps_ < config_.num_timesteps)
     {
-      proceed = false;
-      break;
+      state_costs = parameters_state_costs_;
     }
 
-    Rollout& rollout = noisy_rollouts_[r];
-    if(!task_->computeNoisyCosts(rollout.parameters_noise,0,
+    if(!task_->computeNoisyCostsRef(noisy_rollouts_.parametersNoise(r),window_start_,
+                                    window_timesteps_,
+                                    current_iteration_,r,
+                                    state_costs.segment(window_start_,window_timesteps_),valid))
+    {
+      ROS_ERROR("Trajectory cost computation failed for rollout %i.",r);
+      return false;
+    }
+    return true;
+  }
+
+  if(window_timesteps_ == config_.num_timesteps)
+  {
+    if(!task_->computeNoisyCosts(noisy_rollouts_.parametersNoise(r),0,
                             config_.num_timesteps,
                             current_iteration_,r,
-                            rollout.state_costs,all_valid))
+                            noisy_rollouts_.stateCosts(r),valid))
     {
       ROS_ERROR("Trajectory cost computation failed for rollout %i.",r);
-      proceed = false;
-      break;
+      return false;
     }
+    return true;
   }
 
-  return proceed;
+  // only the window was perturbed, the costs of the remaining timesteps are those of the optimized parameters
+  Eigen::VectorXd& window_costs = window_state_costs_[worker];
+  if(!task_->computeNoisyCosts(noisy_rollouts_.parametersNoise(r),window_start_,
+                          window_timesteps_,
+                          current_iteration_,r,
+                          window_costs,valid))
+  {
+    ROS_ERROR("Trajectory cost computation failed for rollout %i.",r);
+    return false;
+  }
+
+  Eigen::VectorXd& state_costs = noisy_rollouts_.stateCosts(r);
+  state_costs = parameters_state_costs_;
+  if(window_costs.size() == config_.num_timesteps)
+  {
+    state_costs.segment(window_start_,window_timesteps_) = window_costs.segment(window_start_,window_timesteps_);
+  }
+  else if(window_costs.size() == window_timesteps_)
+  {
+    state_costs.segment(window_start_,window_timesteps_) = window_costs;
+  }
+  else
+  {
+    ROS_ERROR("The state costs of rollout %i have an unexpected size %i",r,int(window_costs.size()));
+    return false;
+  }
+
+  return true;
 }
-bool Stomp::computeRolloutsControlCosts()
+
+bool Stomp::computeRolloutsStateCostsBatch(int num_rollouts)
 {
-  Eigen::ArrayXXd Ax; // accelerations
-  for(auto r = 0u ; r < num_active_rollouts_; r++)
+  if(!task_->computeNoisyCostsBatch(batch_parameters_,window_start_,window_timesteps_,
+                                    current_iteration_,num_rollouts,
+                                    batch_state_costs_,batch_validities_))
+  {
+    ROS_ERROR("Trajectory cost computation failed for the batch of %i rollouts.",num_rollouts);
+    return false;
+  }
+
+  if(batch_state_costs_.rows() != num_rollouts || batch_state_costs_.cols() != window_timesteps_)
   {
-    Rollout& rollout = noisy_rollouts_[r];
+    ROS_ERROR("The batch state costs have an unexpected size %i x %i",int(batch_state_costs_.rows()),
+              int(batch_state_costs_.cols()));
+    return false;
+  }
 
-    if(config_.control_cost_weight < MIN_CONTROL_COST_WEIGHT)
+  for(auto r = 0; r < num_rollouts; r++)
+  {
+    Eigen::VectorXd& state_costs = noisy_rollouts_.stateCosts(r);
+    if(window_timesteps_ < config_.num_timesteps)
     {
-      for(auto d = 0u; d < config_.num_dimensions; d++)
-      {
-        rollout.control_costs.row(d).setConstant(0);
-      }
+      // only the window was perturbed, the costs of the remaining timesteps are those of the optimized parameters
+      state_costs = parameters_state_costs_;
     }
-    else
+    state_costs.segment(window_start_,window_timesteps_) = batch_state_costs_.row(r).transpose();
+  }
+
+  return true;
+}
+
+bool Stomp::computeRolloutsControlCosts()
+{
+  // the reused rollouts and the optimized parameters still hold the control costs of their unchanged parameters
+  control_cost_rollouts_.clear();
+  for(int r = 0; r < num_active_rollouts_; r++)
+  {
+    if(noisy_rollouts_.isDirty(r))
     {
-      computeParametersControlCosts(rollout.parameters_noise,
-                                    config_.delta_t,
-                                    config_.control_cost_weight,
-                                    control_cost_matrix_R_,rollout.control_costs);
+      control_cost_rollouts_.push_back(r);
+      noisy_rollouts_.setDirty(r,false);
     }
   }
+
+  if(control_cost_rollouts_.empty())
+  {
+    return true;
+  }
+
+  if(config_.control_cost_weight < MIN_CONTROL_COST_WEIGHT)
+  {
+    for(int r : control_cost_rollouts_)
+    {
+      noisy_rollouts_.controlCosts(r).setZero();
+    }
+    return true;
+  }
+
+  // stacking the noise of all the rollouts so that R multiplies them in a single pass, R is symmetric
+  const int d = config_.num_dimensions;
+  const int num_rollouts = control_cost_rollouts_.size();
+  const int num_rows = num_rollouts*d;
+  for(auto k = 0; k < num_rollouts; k++)
+  {
+    control_cost_noise_.middleRows(k*d,d) = noisy_rollouts_.parametersNoise(control_cost_rollouts_[k]);
+  }
+
+  control_cost_products_.topRows(num_rows).noalias() =
+      control_cost_noise_.topRows(num_rows)*control_cost_matrices_->control_cost_matrix_R;
+  control_cost_values_.head(num_rows) = 0.5*(1/config_.delta_t)*
+      control_cost_noise_.topRows(num_rows).cwiseProduct(control_cost_products_.topRows(num_rows)).rowwise().sum();
+
+  // normalizing each rollout by its maximum dimension cost
+  Eigen::Map<Eigen::MatrixXd> costs(control_cost_values_.data(),d,num_rollouts);
+  control_cost_scales_.head(num_rollouts) = costs.colwise().maxCoeff();
+  control_cost_scales_.head(num_rollouts) = config_.control_cost_weight*
+      (control_cost_scales_.head(num_rollouts).array() > 1e-8).select(
+          control_cost_scales_.head(num_rollouts).array(),1.0).inverse();
+  costs.array().rowwise() *= control_cost_scales_.head(num_rollouts).array();
+
+  for(auto k = 0; k < num_rollouts; k++)
+  {
+    noisy_rollouts_.controlCosts(control_cost_rollouts_[k]).colwise() = costs.col(k);
+  }
   return true;
 }
 
 bool Stomp::computeProbabilities()
 {
 
-  double cost;
   double min_cost;
   double max_cost;
   double denom;
-  double numerator;
   double probl_sum = 0.0; // total probability sum of all rollouts for each joint
   const double h = config_.exponentiated_cost_sensitivity;
-  double exponent = 0;
 
-  for (auto d = 0u; d<config_.num_dimensions; ++d)
+  for(int r = 0; r < num_active_rollouts_; r++)
   {
+    rollout_importance_weights_(r) = noisy_rollouts_.importanceWeight(r);
+  }
 
-    for (auto t = 0u; t<config_.num_timesteps; t++)
-    {
-
-      // find min and max cost over all rollouts at timestep 't':
-      min_cost = noisy_rollouts_[0].total_costs(d,t);
-      max_cost = min_cost;
-      for (auto r=0u; r<num_active_rollouts_; ++r)
-      {
-          cost = noisy_rollouts_[r].total_costs(d,t);
-          if (cost < min_cost)
-              min_cost = cost;
-          if (cost > max_cost)
-              max_cost = cost;
-      }
-
-      denom = max_cost - min_cost;
-
-      // prevent division by zero:
-      if (denom < MIN_COST_DIFFERENCE)
-      {
-        denom = MIN_COST_DIFFERENCE;
-      }
-
-      probl_sum = 0.0;
-      for (auto r = 0u; r<num_active_rollouts_; ++r)
-      {
-        // this is the exponential term in the probability calculation described in the literature
-        exponent = -h*(noisy_rollouts_[r].total_costs(d,t) - min_cost)/denom;
-        noisy_rollouts_[r].probabilities(d,t) = noisy_rollouts_[r].importance_weight *
-            exp(exponent);
+  if(config_.single_precision)
+  {
+    single_importance_weights_.head(num_active_rollouts_) =
+        rollout_importance_weights_.head(num_active_rollouts_).cast<float>();
+  }
 
-        probl_sum += noisy_rollouts_[r].probabilities(d,t);
-      }
+  for(int d = 0; d<config_.num_dimensions; ++d)
+  {
 
-      // scaling each probability value by the sum of all probabilities corresponding to all rollouts at time "t"
-      for (auto r = 0u; r<num_active_rollouts_; ++r)
-      {
-        noisy_rollouts_[r].probabilities(d,t) /= probl_sum;
-      }
+    if(config_.single_precision && spline_basis_.size() > 0)
+    {
+      single_spline_costs_[d].topRows(num_active_rollouts_).noalias() =
+          noisy_rollouts_.singleTotalCosts(d).topRows(num_active_rollouts_)*single_spline_cost_weights_;
+      computeExponentiatedCostProbabilities(single_spline_costs_[d],single_importance_weights_,num_active_rollouts_,
+                                            static_cast<float>(h),single_min_costs_,single_normalizers_,
+                                            single_spline_probabilities_[d]);
+    }
+    else if(config_.single_precision)
+    {
+      computeExponentiatedCostProbabilities(noisy_rollouts_.singleTotalCosts(d),single_importance_weights_,
+                                            num_active_rollouts_,static_cast<float>(h),single_min_costs_,
+                                            single_normalizers_,noisy_rollouts_.singleProbabilities(d));
+    }
+    else if(spline_basis_.size() > 0)
+    {
+      // the probabilities of each control point follow the costs of the timesteps it influences
+      spline_costs_[d].topRows(num_active_rollouts_).noalias() =
+          noisy_rollouts_.totalCosts(d).topRows(num_active_rollouts_)*spline_cost_weights_;
+      computeExponentiatedCostProbabilities(spline_costs_[d],rollout_importance_weights_,
+                                            num_active_rollouts_,h,spline_min_costs_,spline_normalizers_,
+                                            spline_probabilities_[d]);
+    }
+    else if(streaming_block_size_ == 0)
+    {
+      computeExponentiatedCostProbabilities(noisy_rollouts_.totalCosts(d),rollout_importance_weights_,
+                                            num_active_rollouts_,h,timestep_min_costs_,timestep_normalizers_,
+                                            noisy_rollouts_.probabilities(d));
     }
-
 
     // computing full probabilities
-    min_cost = noisy_rollouts_[0].full_costs[d];
+    min_cost = noisy_rollouts_.fullCosts()(0,d);
     max_cost = min_cost;
     double c = 0.0;
     for (int r=1; r<num_active_rollouts_; ++r)
     {
-      c = noisy_rollouts_[r].full_costs[d];
+      c = noisy_rollouts_.fullCosts()(r,d);
       if (c < min_cost)
         min_cost = c;
       if (c > max_cost)
@@ -716,13 +1281,13 @@ bool Stomp::computeProbabilities()
     probl_sum = 0.0;
     for (int r=0; r<num_active_rollouts_; ++r)
     {
-      noisy_rollouts_[r].full_probabilities[d] = noisy_rollouts_[r].importance_weight *
-          exp(-h*(noisy_rollouts_[r].full_costs[d] - min_cost)/denom);
-      probl_sum += noisy_rollouts_[r].full_probabilities[d];
+      noisy_rollouts_.fullProbabilities()(r,d) = rollout_importance_weights_(r) *
+          exp(-h*(noisy_rollouts_.fullCosts()(r,d) - min_cost)/denom);
+      probl_sum += noisy_rollouts_.fullProbabilities()(r,d);
     }
     for (int r=0; r<num_active_rollouts_; ++r)
     {
-        noisy_rollouts_[r].full_probabilities[d] /= probl_sum;
+        noisy_rollouts_.fullProbabilities()(r,d) /= probl_sum;
     }
   }
 
@@ -732,16 +1297,81 @@ bool Stomp::computeProbabilities()
 bool Stomp::updateParameters()
 {
   // computing updates from probabilities using convex combination
-  parameters_updates_.setZero();
-  for(auto d = 0u; d < config_.num_dimensions ; d++)
+  if(spline_basis_.size() > 0)
   {
-
-    for(auto r = 0u; r < num_active_rollouts_; r++)
+    // the convex combination of the control points noise, expanded to timesteps once
+    spline_updates_.setZero();
+    for(int r = 0; r < num_active_rollouts_; r++)
     {
-      auto& rollout = noisy_rollouts_[r];
-      parameters_updates_.row(d) +=  (rollout.noise.row(d).array() * rollout.probabilities.row(d).array()).matrix();
+      spline_rollout_noise_.noalias() = noisy_rollouts_.noise(r)*spline_projection_;
+      for(int d = 0; d < config_.num_dimensions ; d++)
+      {
+        if(config_.single_precision)
+        {
+          spline_updates_.row(d) += (spline_rollout_noise_.row(d).array() *
+              single_spline_probabilities_[d].row(r).array().cast<double>()).matrix();
+        }
+        else
+        {
+          spline_updates_.row(d) += (spline_rollout_noise_.row(d).array() *
+              spline_probabilities_[d].row(r).array()).matrix();
+        }
+      }
     }
-
+    parameters_updates_.noalias() = spline_updates_*spline_basis_;
+  }
+  else if(streaming_block_size_ > 0)
+  {
+    // the probabilities of each block of timesteps are computed from the rollout costs and reduced into the updates
+    // before the next block overwrites them, the dimensions are reduced concurrently
+    auto update_dimension = [this](std::size_t d, std::size_t worker)
+    {
+      Eigen::MatrixXd& costs = streaming_costs_[worker];
+      Eigen::MatrixXd& probabilities = streaming_probabilities_[worker];
+      const int block_size = streaming_block_size_;
+      for(int start = 0; start < config_.num_timesteps; start += block_size)
+      {
+        // the columns past the end of the last block keep stale finite costs and are ignored
+        const int columns = std::min(block_size,config_.num_timesteps - start);
+        for(int r = 0; r < num_active_rollouts_; r++)
+        {
+          costs.row(r).head(columns) = noisy_rollouts_.stateCosts(r).segment(start,columns).transpose() +
+              noisy_rollouts_.controlCosts(r).row(d).segment(start,columns);
+        }
+
+        computeExponentiatedCostProbabilities(costs,rollout_importance_weights_,num_active_rollouts_,
+                                              config_.exponentiated_cost_sensitivity,streaming_min_costs_[worker],
+                                              streaming_normalizers_[worker],probabilities);
+
+        auto updates = parameters_updates_.row(d).segment(start,columns);
+        updates.setZero();
+        for(int r = 0; r < num_active_rollouts_; r++)
+        {
+          updates.array() += noisy_rollouts_.noise(r).row(d).segment(start,columns).array() *
+              probabilities.row(r).head(columns).array();
+        }
+      }
+    };
+    thread_pool_->parallelFor(config_.num_dimensions,update_dimension);
+  }
+  else
+  {
+    // each dimension reduces the rollouts along the contiguous columns of its noise and probability blocks, the
+    // dimensions are independent and are reduced concurrently
+    auto update_dimension = [this](std::size_t d, std::size_t worker)
+    {
+      if(config_.single_precision)
+      {
+        parameters_updates_.row(d) = (noisy_rollouts_.singleNoise(d).topRows(num_active_rollouts_).array() *
+            noisy_rollouts_.singleProbabilities(d).topRows(num_active_rollouts_).array()).colwise().sum().cast<double>();
+      }
+      else
+      {
+        parameters_updates_.row(d) = (noisy_rollouts_.dimensionNoise(d).topRows(num_active_rollouts_).array() *
+            noisy_rollouts_.probabilities(d).topRows(num_active_rollouts_).array()).colwise().sum();
+      }
+    };
+    thread_pool_->parallelFor(config_.num_dimensions,update_dimension);
   }
 
   // filtering updates
@@ -751,54 +1381,238 @@ bool Stomp::updateParameters()
     return false;
   }
 
-  // updating parameters
+  // a fixed window holds the timesteps outside of it, even if the filters spread the updates
+  if(fixed_window_)
+  {
+    parameters_updates_.leftCols(window_start_).setZero();
+    parameters_updates_.rightCols(config_.num_timesteps - (window_start_ + window_timesteps_)).setZero();
+  }
+
+  // updating parameters, their costs only need to be evaluated again if they changed
   parameters_optimized_ += parameters_updates_;
+  parameters_dirty_ = (parameters_updates_.array() != 0.0).any();
 
   return true;
 }
 
 bool Stomp::computeOptimizedCost()
 {
+  // the costs of unchanged parameters are already known
+  if(!parameters_dirty_)
+  {
+    return true;
+  }
 
-  // control costs
+  // the costs are evaluated into the candidate buffers so that those of the current parameters survive a rejection
+  bool accepted_valid = parameters_valid_;
+  double accepted_total_cost = parameters_total_cost_;
   parameters_total_cost_ = 0;
-  if(config_.control_cost_weight > MIN_CONTROL_COST_WEIGHT)
+
+  // control costs
+  if(config_.control_cost_weight < MIN_CONTROL_COST_WEIGHT)
+  {
+    candidate_control_costs_.setZero();
+  }
+  else
   {
     computeParametersControlCosts(parameters_optimized_,
                                   config_.delta_t,
                                   config_.control_cost_weight,
-                                  control_cost_matrix_R_,
-                                  parameters_control_costs_);
+                                  control_cost_matrices_->control_cost_matrix_R,
+                                  control_cost_workspace_,
+                                  candidate_control_costs_);
 
     // adding all costs
-    parameters_total_cost_ = parameters_control_costs_.rowwise().sum().sum();
+    parameters_total_cost_ = candidate_control_costs_.rowwise().sum().sum();
 
   }
 
   // state costs
-  if(task_->computeCosts(parameters_optimized_,
-                         0,config_.num_timesteps,current_iteration_,parameters_state_costs_,parameters_valid_))
+  bool computed;
+  if(ref_interface_)
+  {
+    computed = task_->computeCostsRef(parameters_optimized_,0,config_.num_timesteps,current_iteration_,
+                                      candidate_state_costs_,parameters_valid_);
+  }
+  else
+  {
+    computed = task_->computeCosts(parameters_optimized_,0,config_.num_timesteps,current_iteration_,
+                                   candidate_state_costs_,parameters_valid_);
+  }
+
+  if(computed)
   {
 
 
-    parameters_total_cost_ += parameters_state_costs_.sum();
+    parameters_total_cost_ += candidate_state_costs_.sum();
   }
   else
   {
     return false;
   }
+  parameters_dirty_ = false;
+
+  // a valid trajectory is recorded even if it is reverted below
+  updateBestValidParameters();
 
   if(current_lowest_cost_ > parameters_total_cost_)
   {
     current_lowest_cost_ = parameters_total_cost_;
+    parameters_control_costs_.swap(candidate_control_costs_);
+    parameters_state_costs_.swap(candidate_state_costs_);
   }
   else
   {
     // reverting updates as no improvement was made
     parameters_optimized_ -= parameters_updates_;
+    parameters_valid_ = accepted_valid;
+    parameters_total_cost_ = accepted_total_cost;
+  }
+
+  return true;
+}
+
+void Stomp::adaptRolloutCount(double previous_cost)
+{
+  if(config_.min_rollouts <= 0)
+  {
+    return;
+  }
+
+  int min_rollouts = std::min(config_.min_rollouts,config_.num_rollouts);
+  int max_rollouts = std::max(config_.num_rollouts,config_.max_rollouts - 1); // one is taken by the optimized parameters
+  double improvement = (previous_cost - current_lowest_cost_)/std::max(std::abs(previous_cost),MIN_COST_DIFFERENCE);
+  if(improvement <= 0 && !parameters_valid_)
+  {
+    // no better trajectory was found and the current one is invalid, explore more
+    num_rollouts_ = std::min(num_rollouts_ + std::max(num_rollouts_/ROLLOUT_GROWTH_DIVISOR,1),max_rollouts);
+  }
+  else if(improvement < CONVERGING_COST_IMPROVEMENT)
+  {
+    // the cost is converging, a valid trajectory that does not improve has converged as well
+    num_rollouts_ = std::max(num_rollouts_ - 1,min_rollouts);
+  }
+}
+
+bool Stomp::checkConvergence(TerminationReasons::TerminationReason& reason)
+{
+  // relative cost improvement over the last 'convergence_iterations'
+  if(!cost_history_.empty() && config_.convergence_cost_epsilon > 0)
+  {
+    double& previous_cost = cost_history_[current_iteration_ % cost_history_.size()];
+    if(current_iteration_ > cost_history_.size())
+    {
+      double improvement = (previous_cost - current_lowest_cost_)/std::max(std::abs(previous_cost),MIN_COST_DIFFERENCE);
+      if(improvement < config_.convergence_cost_epsilon)
+      {
+        reason = TerminationReasons::COST_CONVERGED;
+        return true;
+      }
+    }
+    previous_cost = current_lowest_cost_;
+  }
+
+  // update magnitude
+  if(config_.convergence_update_threshold > 0 &&
+      parameters_updates_.cwiseAbs().maxCoeff() < config_.convergence_update_threshold)
+  {
+    reason = TerminationReasons::UPDATES_CONVERGED;
+    return true;
+  }
+
+  // wall-clock budget
+  if(deadlineReached())
+  {
+    reason = TerminationReasons::TIME_LIMIT;
+    return true;
   }
 
+  return false;
+}
+
+bool Stomp::getBestValidParameters(Eigen::MatrixXd& parameters,double& cost,unsigned int& iteration) const
+{
+  std::lock_guard<std::mutex> lock(published_mutex_);
+  if(!published_valid_)
+  {
+    return false;
+  }
+
+  parameters = published_parameters_;
+  cost = published_cost_;
+  iteration = published_iteration_;
   return true;
 }
 
+void Stomp::updateBestValidParameters()
+{
+  if(parameters_valid_ && parameters_total_cost_ < best_valid_cost_)
+  {
+    best_valid_parameters_ = parameters_optimized_;
+    best_valid_cost_ = parameters_total_cost_;
+    best_valid_iteration_ = current_iteration_;
+    best_valid_pending_ = true;
+  }
+}
+
+void Stomp::publishBestValidParameters(bool wait)
+{
+  if(!best_valid_pending_)
+  {
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock(published_mutex_,std::defer_lock);
+  if(wait)
+  {
+    lock.lock();
+  }
+  else if(!lock.try_lock())
+  {
+    return; // a reader is copying the snapshot, try again after the next iteration
+  }
+
+  // swapping only exchanges the buffers, the previous snapshot becomes the next staging buffer
+  published_parameters_.swap(best_valid_parameters_);
+  published_cost_ = best_valid_cost_;
+  published_iteration_ = best_valid_iteration_;
+  published_valid_ = true;
+  best_valid_pending_ = false;
+}
+
+bool Stomp::deadlineReached() const
+{
+  return deadline_ != std::chrono::steady_clock::time_point::max() && std::chrono::steady_clock::now() >= deadline_;
+}
+
+void Stomp::recordIterationProfile(bool completed)
+{
+  IterationProfile& profile = iteration_profile_;
+  profile.completed = completed;
+  if(profile.num_stages > IterationStages::GENERATE_NOISY_ROLLOUTS)
+  {
+    profile.rollouts_active = num_active_rollouts_;
+    profile.rollouts_reused = std::max(num_active_rollouts_ - profile.rollouts_generated - 1,0);
+  }
+
+  if(profile.num_stages > IterationStages::COMPUTE_NOISY_ROLLOUTS_COSTS && num_active_rollouts_ > 0)
+  {
+    profile.min_rollout_cost = std::numeric_limits<double>::max();
+    profile.max_rollout_cost = -std::numeric_limits<double>::max();
+    double total = 0.0;
+    for(int r = 0; r < num_active_rollouts_; r++)
+    {
+      double c = noisy_rollouts_.totalCost(r);
+      profile.min_rollout_cost = std::min(profile.min_rollout_cost,c);
+      profile.max_rollout_cost = std::max(profile.max_rollout_cost,c);
+      total += c;
+    }
+    profile.mean_rollout_cost = total/num_active_rollouts_;
+  }
+
+  profile.optimized_cost = current_lowest_cost_;
+  profile.valid = parameters_valid_;
+  instrumentation_sink_->recordIteration(profile);
+}
+
 } /* namespace stomp */
@@ -0,0 +1,234 @@
+/**
+ * @file thread_pool.cpp
+ * @brief This contains a fixed size thread pool used to parallelize the stomp optimization steps
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <algorithm>
+#include <ros/console.h>
+#include "stomp_core/thread_pool.h"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static thread_local std::size_t WORKER_INDEX = 0; /**< The worker index of the calling thread */
+
+namespace stomp_core
+{
+
+ThreadPool::ThreadPool(std::size_t num_threads):
+    ThreadPool(num_threads,std::vector<int>(),0)
+{
+
+}
+
+ThreadPool::ThreadPool(std::size_t num_threads, const std::vector<int>& cpus, int nice):
+    cpus_(cpus),
+    nice_(nice),
+    next_job_(0),
+    stop_(false)
+{
+  num_threads = num_threads < 1 ? 1 : num_threads;
+  for(auto w = 1u; w < num_threads; w++)
+  {
+    threads_.push_back(std::thread(&ThreadPool::workerLoop,this,w));
+  }
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  start_cond_.notify_all();
+
+  for(auto& t : threads_)
+  {
+    t.join();
+  }
+}
+
+std::size_t ThreadPool::size() const
+{
+  return threads_.size() + 1;
+}
+
+std::size_t ThreadPool::getWorkerIndex()
+{
+  return WORKER_INDEX;
+}
+
+void ThreadPool::parallelFor(std::size_t n, const Job& job)
+{
+  if(n == 0)
+  {
+    return;
+  }
+
+  if(threads_.empty() || n == 1)
+  {
+    for(auto i = 0u; i < n; i++)
+    {
+      job(i,0);
+    }
+    return;
+  }
+
+  JobState state;
+  state.job = &job;
+  state.size = n;
+  state.next_index = 0;
+  state.busy_workers = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    jobs_.push_back(&state);
+  }
+  start_cond_.notify_all();
+
+  // the calling thread works as worker 0
+  std::size_t index;
+  while((index = state.next_index.fetch_add(1)) < n)
+  {
+    runItem(state,index,0);
+  }
+
+  // no worker takes an item once the job is removed, the ones still executing one are waited for
+  std::unique_lock<std::mutex> lock(mutex_);
+  removeJob(&state);
+  done_cond_.wait(lock,[&state](){ return state.busy_workers == 0; });
+
+  if(state.exception)
+  {
+    std::rethrow_exception(state.exception);
+  }
+}
+
+void ThreadPool::runItem(JobState& state, std::size_t index, std::size_t worker)
+{
+  std::size_t previous_worker = WORKER_INDEX;
+  WORKER_INDEX = worker;
+
+  try
+  {
+    (*state.job)(index,worker);
+  }
+  catch(...)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if(!state.exception)
+    {
+      state.exception = std::current_exception();
+    }
+  }
+
+  WORKER_INDEX = previous_worker;
+}
+
+void ThreadPool::removeJob(JobState* state)
+{
+  auto pos = std::find(jobs_.begin(),jobs_.end(),state);
+  if(pos == jobs_.end())
+  {
+    return;
+  }
+
+  if(static_cast<std::size_t>(std::distance(jobs_.begin(),pos)) < next_job_)
+  {
+    next_job_--;
+  }
+  jobs_.erase(pos);
+}
+
+void ThreadPool::configureThread() const
+{
+#ifdef __linux__
+  if(!cpus_.empty())
+  {
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for(int cpu : cpus_)
+    {
+      if(cpu >= 0 && cpu < CPU_SETSIZE)
+      {
+        CPU_SET(cpu,&cpu_set);
+      }
+    }
+
+    if(pthread_setaffinity_np(pthread_self(),sizeof(cpu_set),&cpu_set) != 0)
+    {
+      ROS_WARN("Failed to set the CPU affinity of a thread pool worker");
+    }
+  }
+
+  // the nice value of a linux thread is set through its thread id
+  if(nice_ != 0 && setpriority(PRIO_PROCESS,static_cast<id_t>(syscall(SYS_gettid)),nice_) != 0)
+  {
+    ROS_WARN("Failed to set the nice value %i of a thread pool worker",nice_);
+  }
+#endif
+}
+
+void ThreadPool::workerLoop(std::size_t worker)
+{
+  configureThread();
+
+  while(true)
+  {
+    // the pending jobs take turns so that concurrent callers share the workers
+    JobState* state;
+    std::size_t index;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      start_cond_.wait(lock,[this](){ return stop_ || !jobs_.empty(); });
+      if(stop_)
+      {
+        return;
+      }
+
+      next_job_ = next_job_ % jobs_.size();
+      state = jobs_[next_job_++];
+      index = state->next_index.fetch_add(1);
+      if(index >= state->size)
+      {
+        removeJob(state);
+        continue;
+      }
+      state->busy_workers++;
+    }
+
+    runItem(*state,index,worker);
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      state->busy_workers--;
+    }
+    done_cond_.notify_all();
+  }
+}
+
+} /* namespace stomp_core */
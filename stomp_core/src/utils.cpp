@@ -24,6 +24,8 @@
  * limitations under the License.
  */
 #include <stomp_core/utils.h>
+#include <stomp_core/control_cost_cache.h>
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 #include <Eigen/Dense>
@@ -31,7 +33,69 @@
 namespace stomp_core
 {
 
+const char* TerminationReasons::getName(TerminationReason reason)
+{
+  static const char* NAMES[] = {"max_iterations","valid_solution","cost_converged","updates_converged","time_limit",
+                                "cancelled","failed"};
+  return reason >= MAX_ITERATIONS && reason <= FAILED ? NAMES[reason] : "unknown";
+}
+
+int getMaxGeneratedRollouts(const StompConfiguration& config)
+{
+  if(config.min_rollouts > 0)
+  {
+    return std::max(config.num_rollouts,config.max_rollouts - 1);
+  }
+  return config.num_rollouts;
+}
+
+bool copyStateCosts(const Eigen::VectorXd& costs,std::size_t start_timestep,std::size_t num_timesteps,
+                    std::size_t num_parameters,Eigen::Ref<Eigen::VectorXd,0,Eigen::InnerStride<> > view)
+{
+  Eigen::Index size = costs.size();
+  if(size == static_cast<Eigen::Index>(num_timesteps))
+  {
+    view = costs;
+  }
+  else if(size == static_cast<Eigen::Index>(num_parameters) && start_timestep + num_timesteps <= num_parameters)
+  {
+    view = costs.segment(start_timestep,num_timesteps);
+  }
+  else
+  {
+    return false;
+  }
+  return true;
+}
+
+bool computeBatchCostsPerRollout(const Eigen::MatrixXd& parameters,std::size_t start_timestep,std::size_t num_timesteps,
+                                 int num_rollouts,const RolloutCostsFunction& compute,Eigen::MatrixXd& costs,
+                                 std::vector<bool>& validities)
+{
+  if(num_rollouts <= 0 || parameters.cols() % num_rollouts != 0)
+  {
+    return false;
+  }
+
+  Eigen::Index num_parameters = parameters.cols()/num_rollouts;
+  Eigen::MatrixXd rollout_parameters(parameters.rows(),num_parameters);
+  Eigen::VectorXd rollout_costs;
+  validities.resize(num_rollouts);
+  costs.resize(num_rollouts,num_timesteps);
+  for(int r = 0; r < num_rollouts; r++)
+  {
+    bool valid;
+    rollout_parameters = parameters.middleCols(r*num_parameters,num_parameters);
+    if(!compute(rollout_parameters,r,rollout_costs,valid) ||
+        !copyStateCosts(rollout_costs,start_timestep,num_timesteps,num_parameters,costs.row(r).transpose()))
+    {
+      return false;
+    }
+    validities[r] = valid;
+  }
 
+  return true;
+}
 
 void generateFiniteDifferenceMatrix(int num_time_steps,
                                              DerivativeOrders::DerivativeOrder order,
@@ -61,83 +125,177 @@ void generateFiniteDifferenceMatrix(int num_time_steps,
   }
 }
 
+void generateFiniteDifferenceMatrix(int num_time_steps,
+                                             DerivativeOrders::DerivativeOrder order,
+                                             double dt, Eigen::SparseMatrix<double>& diff_matrix)
+{
+  std::vector< Eigen::Triplet<double> > coefficients;
+  coefficients.reserve(num_time_steps*FINITE_DIFF_RULE_LENGTH);
+  double multiplier = 1.0/pow(dt,(int)order);
+  for (int i=0; i<num_time_steps; ++i)
+  {
+    for (int j=-FINITE_DIFF_RULE_LENGTH/2; j<=FINITE_DIFF_RULE_LENGTH/2; ++j)
+    {
+      int index = i+j;
+      if (index < 0 || index >= num_time_steps)
+      {
+        continue;
+      }
+
+      double coeff = FINITE_CENTRAL_DIFF_COEFFS[order][j+FINITE_DIFF_RULE_LENGTH/2];
+      if(coeff != 0)
+      {
+        coefficients.push_back(Eigen::Triplet<double>(i,index,multiplier * coeff));
+      }
+    }
+  }
+
+  diff_matrix.resize(num_time_steps, num_time_steps);
+  diff_matrix.setFromTriplets(coefficients.begin(),coefficients.end());
+}
+
 void generateSmoothingMatrix(int num_timesteps,double dt, Eigen::MatrixXd& projection_matrix_M)
 {
-  using namespace Eigen;
+  SmoothingMatrixConstPtr cached_matrix_M = getSmoothingMatrix(num_timesteps,dt);
+  if(!cached_matrix_M)
+  {
+    projection_matrix_M = Eigen::MatrixXd::Identity(num_timesteps,num_timesteps);
+    return;
+  }
+
+  projection_matrix_M = *cached_matrix_M;
+}
+
+void generateBSplineBasis(int num_control_points, int num_time_steps, Eigen::MatrixXd& basis)
+{
+  static const int DEGREE = 3;
+  basis.setZero(num_control_points,num_time_steps);
+  if(num_control_points <= DEGREE || num_time_steps < 2)
+  {
+    return;
+  }
+
+  // clamped uniform knots, the first and last ones are repeated DEGREE + 1 times
+  int num_spans = num_control_points - DEGREE;
+  std::vector<double> knots(num_control_points + DEGREE + 1);
+  for(int i = 0; i < static_cast<int>(knots.size()); i++)
+  {
+    knots[i] = std::min(std::max(i - DEGREE,0),num_spans)/static_cast<double>(num_spans);
+  }
+
+  // the nonzero basis functions at each timestep by the Cox-de Boor recursion
+  double left[DEGREE + 1];
+  double right[DEGREE + 1];
+  double values[DEGREE + 1];
+  for(int t = 0; t < num_time_steps; t++)
+  {
+    double u = t/static_cast<double>(num_time_steps - 1);
+    int span = std::min(static_cast<int>(u*num_spans),num_spans - 1) + DEGREE;
+
+    values[0] = 1.0;
+    for(int j = 1; j <= DEGREE; j++)
+    {
+      left[j] = u - knots[span + 1 - j];
+      right[j] = knots[span + j] - u;
+      double saved = 0.0;
+      for(int r = 0; r < j; r++)
+      {
+        double temp = values[r]/(right[r + 1] + left[j - r]);
+        values[r] = saved + right[r + 1]*temp;
+        saved = left[j - r]*temp;
+      }
+      values[j] = saved;
+    }
 
-  // generate augmented finite differencing matrix
-  int start_index_padded = FINITE_DIFF_RULE_LENGTH-1;
-  int num_timesteps_padded = num_timesteps + 2*(FINITE_DIFF_RULE_LENGTH-1);
-  MatrixXd finite_diff_matrix_A_padded;
-  generateFiniteDifferenceMatrix(num_timesteps_padded,DerivativeOrders::STOMP_ACCELERATION,
-                                 dt,finite_diff_matrix_A_padded);
+    for(int j = 0; j <= DEGREE; j++)
+    {
+      basis(span - DEGREE + j,t) = values[j];
+    }
+  }
+}
 
+void resampleTrajectory(const Eigen::MatrixXd& parameters, int num_time_steps, Eigen::MatrixXd& resampled)
+{
+  int num_points = parameters.cols();
+  resampled.resize(parameters.rows(),num_time_steps);
+  if(num_points < 2 || num_time_steps < 2)
+  {
+    resampled.setZero();
+    return;
+  }
 
-  /* computing control cost matrix (R = A_transpose * A):
-   * Note: Original code multiplies the A product by the time interval.  However this is not
-   * what was described in the literature
-   */
-  MatrixXd control_cost_matrix_R_padded = dt*finite_diff_matrix_A_padded.transpose() * finite_diff_matrix_A_padded;
-  MatrixXd control_cost_matrix_R = control_cost_matrix_R_padded.block(
-      start_index_padded,start_index_padded,num_timesteps,num_timesteps);
-  MatrixXd inv_control_cost_matrix_R = control_cost_matrix_R.fullPivLu().inverse();
+  // the tangents per segment, zero at both ends
+  Eigen::MatrixXd tangents = Eigen::MatrixXd::Zero(parameters.rows(),num_points);
+  for(int i = 1; i < num_points - 1; i++)
+  {
+    tangents.col(i) = 0.5*(parameters.col(i + 1) - parameters.col(i - 1));
+  }
 
-  // computing projection matrix M
-  projection_matrix_M = inv_control_cost_matrix_R;
-  double max = 0;
-  for(auto t = 0u; t < num_timesteps; t++)
+  for(int t = 0; t < num_time_steps; t++)
   {
-    max = projection_matrix_M(t,t);
-    projection_matrix_M.col(t)*= (1.0/(num_timesteps*max)); // scaling such that the maximum value is 1/num_timesteps
+    double u = t*(num_points - 1)/static_cast<double>(num_time_steps - 1);
+    int i = std::min(static_cast<int>(u),num_points - 2);
+    double s = u - i;
+    double s2 = s*s;
+    double s3 = s2*s;
+    resampled.col(t) = (2*s3 - 3*s2 + 1)*parameters.col(i) + (s3 - 2*s2 + s)*tangents.col(i) +
+        (-2*s3 + 3*s2)*parameters.col(i + 1) + (s3 - s2)*tangents.col(i + 1);
   }
 }
 
 void differentiate(const Eigen::VectorXd& parameters, DerivativeOrders::DerivativeOrder order,
                           double dt, Eigen::VectorXd& derivatives )
 {
+  Eigen::MatrixXd derivatives_row;
+  differentiate(parameters.transpose(),order,dt,derivatives_row);
+  derivatives = derivatives_row.transpose();
+}
 
+void differentiate(const Eigen::MatrixXd& parameters, DerivativeOrders::DerivativeOrder order,
+                   double dt, Eigen::MatrixXd& derivatives)
+{
   using namespace Eigen;
 
-  derivatives = Eigen::VectorXd::Zero(parameters.size());
-
-
-  // coefficient arrays
-  VectorXd central_coeffs = VectorXd::Map(&FINITE_CENTRAL_DIFF_COEFFS[order][0],FINITE_DIFF_RULE_LENGTH);
-  VectorXd forward_coeffs = VectorXd::Map(&FINITE_FORWARD_DIFF_COEFFS[order][0],FINITE_DIFF_RULE_LENGTH);
-  VectorXd backward_coeffs = forward_coeffs.reverse();
+  int rule_length = FINITE_DIFF_RULE_LENGTH;
+  int size = parameters.cols();
+  derivatives.setZero(parameters.rows(),size);
+  if(size < rule_length)
+  {
+    return;
+  }
 
-  // check order eveness
+  // coefficient arrays, the backward rule is the reversed forward rule with the sign flipped for the odd orders
+  Matrix<double,1,FINITE_DIFF_RULE_LENGTH> central_coeffs, forward_coeffs, backward_coeffs;
+  for(int i = 0; i < rule_length; i++)
+  {
+    central_coeffs(i) = FINITE_CENTRAL_DIFF_COEFFS[order][i];
+    forward_coeffs(i) = FINITE_FORWARD_DIFF_COEFFS[order][i];
+  }
+  backward_coeffs = forward_coeffs.reverse();
   if(order %2 != 0)
   {
     backward_coeffs*= -1.0;
   }
 
-  // creating difference matrix
-  int rule_length = FINITE_DIFF_RULE_LENGTH;
-  int size = parameters.size();
+  // the rules are applied to the columns around each timestep, one-sided rules at both ends
   int skip = FINITE_DIFF_RULE_LENGTH/2;
-  Eigen::MatrixXd A = Eigen::MatrixXd::Zero(size,size);
-  int start_ind, end_ind;
-  for(auto i = 0; i < size; i++)
+  for(int i = 0; i < size; i++)
   {
     if(i < skip)
     {
-      start_ind = i;
-      A.row(i).segment(start_ind,rule_length) = forward_coeffs;
+      derivatives.col(i).noalias() = parameters.middleCols(i,rule_length)*forward_coeffs.transpose();
     }
-    else if(i >= skip && i < size - skip)
+    else if(i < size - skip)
     {
-      start_ind = i - skip;
-      A.row(i).segment(start_ind,rule_length) = central_coeffs;
+      derivatives.col(i).noalias() = parameters.middleCols(i - skip,rule_length)*central_coeffs.transpose();
     }
     else
     {
-      start_ind = i - rule_length+1;
-      A.row(i).segment(start_ind,rule_length) = backward_coeffs;
+      derivatives.col(i).noalias() = parameters.middleCols(i - rule_length + 1,rule_length)*backward_coeffs.transpose();
     }
   }
 
-  derivatives = A*parameters/std::pow(dt,2);
+  derivatives /= std::pow(dt,static_cast<int>(order));
 }
 
 void toVector(const Eigen::MatrixXd& m,std::vector<Eigen::VectorXd>& v)
@@ -0,0 +1,85 @@
+/**
+ * @file control_cost_cache.cpp
+ * @brief This tests the control cost matrices cache
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <Eigen/Dense>
+#include <gtest/gtest.h>
+#include "stomp_core/control_cost_cache.h"
+
+using namespace stomp_core;
+
+/** @brief This tests that the same matrices are returned for identical arguments */
+TEST(ControlCostCache,reuse_matrices)
+{
+  ControlCostMatricesConstPtr m1 = getControlCostMatrices(20,0.1,DerivativeOrders::STOMP_ACCELERATION);
+  ControlCostMatricesConstPtr m2 = getControlCostMatrices(20,0.1,DerivativeOrders::STOMP_ACCELERATION);
+  ControlCostMatricesConstPtr m3 = getControlCostMatrices(20,0.2,DerivativeOrders::STOMP_ACCELERATION);
+  ControlCostMatricesConstPtr m4 = getControlCostMatrices(30,0.1,DerivativeOrders::STOMP_ACCELERATION);
+
+  ASSERT_TRUE(m1 && m2 && m3 && m4);
+  EXPECT_EQ(m1,m2);
+  EXPECT_NE(m1,m3);
+  EXPECT_NE(m1,m4);
+  EXPECT_EQ(m4->control_cost_matrix_R.rows(),30);
+
+  clearControlCostCache();
+  ControlCostMatricesConstPtr m5 = getControlCostMatrices(20,0.1,DerivativeOrders::STOMP_ACCELERATION);
+  EXPECT_NE(m1,m5);
+  EXPECT_TRUE(m1->control_cost_matrix_R.isApprox(m5->control_cost_matrix_R));
+}
+
+/** @brief This tests that the cached smoothing matrix matches the one computed from the dense inverse of R */
+TEST(ControlCostCache,smoothing_matrix)
+{
+  const int num_timesteps = 20;
+  const double dt = 1.0;
+
+  Eigen::MatrixXd A_padded;
+  int num_timesteps_padded = num_timesteps + 2*(FINITE_DIFF_RULE_LENGTH-1);
+  generateFiniteDifferenceMatrix(num_timesteps_padded,DerivativeOrders::STOMP_ACCELERATION,dt,A_padded);
+  Eigen::MatrixXd R_padded = dt*A_padded.transpose()*A_padded;
+  Eigen::MatrixXd expected_M = R_padded.block(FINITE_DIFF_RULE_LENGTH-1,FINITE_DIFF_RULE_LENGTH-1,
+                                              num_timesteps,num_timesteps).fullPivLu().inverse();
+  for(auto t = 0u; t < num_timesteps; t++)
+  {
+    expected_M.col(t) *= (1.0/(num_timesteps*expected_M(t,t)));
+  }
+
+  SmoothingMatrixConstPtr M = getSmoothingMatrix(num_timesteps,dt);
+  ASSERT_TRUE(static_cast<bool>(M));
+  EXPECT_EQ(M,getSmoothingMatrix(num_timesteps,dt));
+  EXPECT_TRUE(M->isApprox(expected_M,1e-8));
+
+  Eigen::MatrixXd copied_M;
+  generateSmoothingMatrix(num_timesteps,dt,copied_M);
+  EXPECT_TRUE(copied_M.isApprox(expected_M,1e-8));
+
+  // applying M is a solve against R with the right hand side scaled by the diagonal of R^-1
+  ControlCostMatricesConstPtr m = getControlCostMatrices(num_timesteps,dt,DerivativeOrders::STOMP_ACCELERATION);
+  ASSERT_TRUE(static_cast<bool>(m));
+  Eigen::MatrixXd updates = Eigen::MatrixXd::Random(num_timesteps,3);
+  Eigen::VectorXd scale = (num_timesteps*m->control_cost_matrix_R_inv_diagonal).cwiseInverse();
+  Eigen::MatrixXd solved = m->control_cost_matrix_R_llt.solve(scale.asDiagonal()*updates);
+  EXPECT_TRUE(solved.isApprox(expected_M*updates,1e-8));
+}
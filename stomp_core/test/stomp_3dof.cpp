@@ -24,6 +24,9 @@
  * limitations under the License.
  */
 #include <iostream>
+#include <limits>
+#include <numeric>
+#include <thread>
 #include <Eigen/Dense>
 #include <gtest/gtest.h>
 #include "stomp_core/stomp.h"
@@ -115,7 +118,7 @@ public:
     double cost = 0.0;
     validity = true;
 
-    for(std::size_t t = 0u; t < num_timesteps; t++)
+    for(std::size_t t = start_timestep; t < start_timestep + num_timesteps; t++)
     {
       cost = 0;
       for(std::size_t d = 0u; d < parameters.rows() ; d++)
@@ -129,7 +132,7 @@ public:
         }
       }
 
-      costs(t) = cost;
+      costs(t - start_timestep) = cost;
     }
 
     return true;
@@ -219,6 +222,17 @@ StompConfiguration create3DOFConfiguration()
   c.num_iterations_after_valid = 0;
   c.num_rollouts = 20;
   c.max_rollouts = 20;
+  c.min_rollouts = 0;
+  c.seed = 0;
+  c.num_threads = 1;
+  c.window_size = 0;
+  c.num_control_points = 0;
+  c.single_precision = false;
+  c.streaming_block_size = 0;
+  c.convergence_iterations = 0;
+  c.convergence_cost_epsilon = 0.0;
+  c.convergence_update_threshold = 0.0;
+  c.max_optimization_time = 0.0;
 
   return c;
 }
@@ -440,3 +454,951 @@ TEST(Stomp3DOF,solve_60_timesteps)
   std::cout<<"Differences"<<"\n"<<toString(diff)<<line_separator;
 }
 
+
+/** @brief This tests the Stomp solve method when the rollouts are evaluated concurrently */
+TEST(Stomp3DOF,solve_multithreaded)
+{
+  Trajectory trajectory_bias;
+  interpolate(START_POS,END_POS,NUM_TIMESTEPS,trajectory_bias);
+  TaskPtr task(new DummyTask(trajectory_bias,BIAS_THRESHOLD,STD_DEV));
+
+  StompConfiguration config = create3DOFConfiguration();
+  config.num_threads = 4;
+  Stomp stomp(config,task);
+
+  Trajectory optimized;
+  EXPECT_TRUE(stomp.solve(START_POS,END_POS,optimized));
+
+  EXPECT_EQ(optimized.rows(),NUM_DIMENSIONS);
+  EXPECT_EQ(optimized.cols(),NUM_TIMESTEPS);
+  EXPECT_TRUE(compareDiff(optimized,trajectory_bias,BIAS_THRESHOLD));
+}
+
+/** @brief This tests the Stomp solve method when only a sliding window of the trajectory is perturbed */
+TEST(Stomp3DOF,solve_windowed)
+{
+  Trajectory trajectory_bias;
+  interpolate(START_POS,END_POS,NUM_TIMESTEPS,trajectory_bias);
+  TaskPtr task(new DummyTask(trajectory_bias,BIAS_THRESHOLD,STD_DEV));
+
+  StompConfiguration config = create3DOFConfiguration();
+  config.window_size = NUM_TIMESTEPS/4;
+  config.num_iterations = 200;
+  Stomp stomp(config,task);
+
+  Trajectory optimized;
+  EXPECT_TRUE(stomp.solve(START_POS,END_POS,optimized));
+
+  EXPECT_EQ(optimized.rows(),NUM_DIMENSIONS);
+  EXPECT_EQ(optimized.cols(),NUM_TIMESTEPS);
+  EXPECT_TRUE(compareDiff(optimized,trajectory_bias,BIAS_THRESHOLD));
+}
+
+/** @brief This tests that the receding horizon mode shifts the last solution and moves its end onto the new goal */
+TEST(Stomp3DOF,solve_receding_horizon)
+{
+  // without noise the parameters are not updated, the result is the shifted trajectory
+  Trajectory trajectory_bias;
+  interpolate(START_POS,END_POS,NUM_TIMESTEPS,trajectory_bias);
+  TaskPtr task(new DummyTask(trajectory_bias,BIAS_THRESHOLD,std::vector<double>(NUM_DIMENSIONS,0.0)));
+
+  StompConfiguration config = create3DOFConfiguration();
+  Stomp stomp(config,task);
+
+  // there is no solution to continue yet
+  Eigen::VectorXd goal = Eigen::VectorXd::Map(END_POS.data(),END_POS.size());
+  Trajectory optimized;
+  EXPECT_FALSE(stomp.solveRecedingHorizon(5,goal,optimized));
+
+  stomp.solve(START_POS,END_POS,optimized);
+  EXPECT_FALSE(stomp.solveRecedingHorizon(NUM_TIMESTEPS,goal,optimized));
+
+  int executed = 5;
+  Trajectory previous = optimized;
+  goal.array() += 0.1;
+  stomp.solveRecedingHorizon(executed,goal,optimized);
+
+  EXPECT_EQ(optimized.rows(),NUM_DIMENSIONS);
+  EXPECT_EQ(optimized.cols(),NUM_TIMESTEPS);
+  EXPECT_TRUE(optimized.col(0).isApprox(previous.col(executed),1e-6));
+  EXPECT_TRUE(optimized.col(NUM_TIMESTEPS - executed - 1).isApprox(previous.col(NUM_TIMESTEPS - 1) +
+      (goal - previous.col(NUM_TIMESTEPS - 1))*(NUM_TIMESTEPS - executed - 1)/(NUM_TIMESTEPS - 1),1e-6));
+  EXPECT_TRUE(optimized.col(NUM_TIMESTEPS - 1).isApprox(goal,1e-6));
+}
+
+/** @brief This tests that only a fixed window of the trajectory is optimized while the remaining timesteps are held */
+TEST(Stomp3DOF,solve_fixed_window)
+{
+  Trajectory trajectory_bias;
+  interpolate(START_POS,END_POS,NUM_TIMESTEPS,trajectory_bias);
+  TaskPtr task(new DummyTask(trajectory_bias,BIAS_THRESHOLD,STD_DEV));
+
+  StompConfiguration config = create3DOFConfiguration();
+  config.num_iterations = 200;
+  Stomp stomp(config,task);
+
+  // the middle of the trajectory is displaced by a smooth bump
+  int window_start = NUM_TIMESTEPS/4;
+  int window_timesteps = NUM_TIMESTEPS/2;
+  Trajectory initial = trajectory_bias;
+  for(auto t = 0; t < window_timesteps; t++)
+  {
+    initial.col(window_start + t).array() += 0.2*std::sin(M_PI*(t + 1)/(window_timesteps + 1));
+  }
+
+  Trajectory optimized;
+  EXPECT_FALSE(stomp.solveWindow(initial,window_start,NUM_TIMESTEPS,optimized));
+  stomp.solveWindow(initial,window_start,window_timesteps,optimized);
+
+  EXPECT_EQ(optimized.rows(),NUM_DIMENSIONS);
+  EXPECT_EQ(optimized.cols(),NUM_TIMESTEPS);
+  EXPECT_TRUE(optimized.leftCols(window_start) == initial.leftCols(window_start));
+  int tail = NUM_TIMESTEPS - (window_start + window_timesteps);
+  EXPECT_TRUE(optimized.rightCols(tail) == initial.rightCols(tail));
+
+  // the bump shrinks
+  double initial_error = (initial - trajectory_bias).cwiseAbs().maxCoeff();
+  double optimized_error = (optimized - trajectory_bias).cwiseAbs().maxCoeff();
+  EXPECT_LT(optimized_error,initial_error);
+}
+
+/** @brief This tests that the B-spline basis interpolates the end points and reproduces straight lines */
+TEST(Stomp3DOF,bspline_basis)
+{
+  int num_control_points = 8;
+  Eigen::MatrixXd basis;
+  generateBSplineBasis(num_control_points,NUM_TIMESTEPS,basis);
+
+  ASSERT_EQ(basis.rows(),num_control_points);
+  ASSERT_EQ(basis.cols(),NUM_TIMESTEPS);
+  EXPECT_TRUE(basis.colwise().sum().isApprox(Eigen::RowVectorXd::Ones(NUM_TIMESTEPS)));
+  EXPECT_DOUBLE_EQ(basis(0,0),1.0);
+  EXPECT_DOUBLE_EQ(basis(num_control_points - 1,NUM_TIMESTEPS - 1),1.0);
+  EXPECT_GE(basis.minCoeff(),0.0);
+
+  // the control points of a line are evenly spaced at the Greville abscissae
+  Eigen::RowVectorXd control_points(num_control_points);
+  for(int k = 0; k < num_control_points; k++)
+  {
+    control_points(k) = std::min(std::max(k - 1.0,0.0),num_control_points - 3.0) +
+        std::min(std::max(k - 0.0,0.0),num_control_points - 3.0) + std::min(std::max(k - 2.0,0.0),num_control_points - 3.0);
+  }
+  control_points /= 3.0*(num_control_points - 3);
+  Eigen::RowVectorXd line = Eigen::RowVectorXd::LinSpaced(NUM_TIMESTEPS,0.0,1.0);
+  EXPECT_TRUE((control_points*basis - line).cwiseAbs().maxCoeff() < 1e-12);
+}
+
+/** @brief This tests that a resampled trajectory goes through the original timesteps and reproduces a straight line */
+TEST(Stomp3DOF,resample_trajectory)
+{
+  Trajectory coarse;
+  interpolate(START_POS,END_POS,NUM_TIMESTEPS,coarse);
+  coarse.row(1).setRandom();
+
+  // every third timestep of the resampled trajectory is one of the original timesteps
+  int num_timesteps = 3*(NUM_TIMESTEPS - 1) + 1;
+  Trajectory fine;
+  resampleTrajectory(coarse,num_timesteps,fine);
+  ASSERT_EQ(fine.rows(),NUM_DIMENSIONS);
+  ASSERT_EQ(fine.cols(),num_timesteps);
+  for(std::size_t t = 0; t < NUM_TIMESTEPS; t++)
+  {
+    EXPECT_TRUE(fine.col(3*t).isApprox(coarse.col(t),1e-12));
+  }
+
+  // the interior of a straight line is exact, only the ends slow down to rest
+  Trajectory line;
+  interpolate(START_POS,END_POS,num_timesteps,line);
+  EXPECT_TRUE((fine.row(0) - line.row(0)).segment(3,num_timesteps - 6).cwiseAbs().maxCoeff() < 1e-12);
+
+  // resampling to the same number of timesteps returns the trajectory
+  Trajectory same;
+  resampleTrajectory(coarse,NUM_TIMESTEPS,same);
+  EXPECT_TRUE(same.isApprox(coarse,1e-12));
+}
+
+/** @brief This tests a coarse solve whose resampled result seeds a short solve at full resolution */
+TEST(Stomp3DOF,solve_multi_resolution)
+{
+  int num_timesteps = 3*(NUM_TIMESTEPS - 1) + 1;
+  Trajectory trajectory_bias;
+  interpolate(START_POS,END_POS,num_timesteps,trajectory_bias);
+  TaskPtr task(new DummyTask(trajectory_bias,BIAS_THRESHOLD,STD_DEV));
+
+  // the dummy task compares timesteps against the bias by index, the coarse bias is the full one subsampled
+  Trajectory coarse_bias(NUM_DIMENSIONS,NUM_TIMESTEPS);
+  for(std::size_t t = 0; t < NUM_TIMESTEPS; t++)
+  {
+    coarse_bias.col(t) = trajectory_bias.col(3*t);
+  }
+  TaskPtr coarse_task(new DummyTask(coarse_bias,BIAS_THRESHOLD,STD_DEV));
+
+  StompConfiguration coarse_config = create3DOFConfiguration();
+  coarse_config.delta_t = DELTA_T*(num_timesteps - 1)/(NUM_TIMESTEPS - 1);
+  Stomp coarse_stomp(coarse_config,coarse_task);
+  Trajectory coarse;
+  EXPECT_TRUE(coarse_stomp.solve(START_POS,END_POS,coarse));
+
+  StompConfiguration config = create3DOFConfiguration();
+  config.num_timesteps = num_timesteps;
+  config.num_iterations = 10;
+  Stomp stomp(config,task);
+  Trajectory seed, optimized;
+  resampleTrajectory(coarse,num_timesteps,seed);
+  EXPECT_TRUE(stomp.solve(seed,optimized));
+
+  EXPECT_EQ(optimized.rows(),NUM_DIMENSIONS);
+  EXPECT_EQ(optimized.cols(),num_timesteps);
+  EXPECT_TRUE(compareDiff(optimized,trajectory_bias,BIAS_THRESHOLD));
+}
+
+/** @brief This tests that the finite differences are exact for a quadratic trajectory, including at both ends */
+TEST(Stomp3DOF,differentiate)
+{
+  Eigen::MatrixXd parameters(2,NUM_TIMESTEPS);
+  for(std::size_t t = 0; t < NUM_TIMESTEPS; t++)
+  {
+    double time = t*DELTA_T;
+    parameters(0,t) = 3.0*time*time - time + 1.0;
+    parameters(1,t) = 0.5*time;
+  }
+
+  Eigen::MatrixXd velocities, accelerations;
+  differentiate(parameters,DerivativeOrders::STOMP_VELOCITY,DELTA_T,velocities);
+  differentiate(parameters,DerivativeOrders::STOMP_ACCELERATION,DELTA_T,accelerations);
+  for(std::size_t t = 0; t < NUM_TIMESTEPS; t++)
+  {
+    EXPECT_NEAR(velocities(0,t),6.0*t*DELTA_T - 1.0,1e-9);
+    EXPECT_NEAR(velocities(1,t),0.5,1e-9);
+    EXPECT_NEAR(accelerations(0,t),6.0,1e-6);
+    EXPECT_NEAR(accelerations(1,t),0.0,1e-6);
+  }
+
+  // the vector overload differentiates a single row
+  Eigen::VectorXd row_velocities;
+  differentiate(Eigen::VectorXd(parameters.row(0).transpose()),DerivativeOrders::STOMP_VELOCITY,DELTA_T,row_velocities);
+  EXPECT_TRUE(row_velocities.isApprox(velocities.row(0).transpose()));
+}
+
+/** @brief This tests the Stomp solve method when the updates are computed in a spline parameter space */
+TEST(Stomp3DOF,solve_spline_parameterization)
+{
+  Trajectory trajectory_bias;
+  interpolate(START_POS,END_POS,NUM_TIMESTEPS,trajectory_bias);
+  TaskPtr task(new DummyTask(trajectory_bias,BIAS_THRESHOLD,STD_DEV));
+
+  StompConfiguration config = create3DOFConfiguration();
+  config.num_control_points = 8;
+  Stomp stomp(config,task);
+
+  Trajectory optimized;
+  EXPECT_TRUE(stomp.solve(START_POS,END_POS,optimized));
+
+  EXPECT_EQ(optimized.rows(),NUM_DIMENSIONS);
+  EXPECT_EQ(optimized.cols(),NUM_TIMESTEPS);
+  EXPECT_TRUE(compareDiff(optimized,trajectory_bias,BIAS_THRESHOLD));
+}
+
+/** @brief This tests the Stomp solve method when the probabilities and the updates are computed in single precision */
+TEST(Stomp3DOF,solve_single_precision)
+{
+  Trajectory trajectory_bias;
+  interpolate(START_POS,END_POS,NUM_TIMESTEPS,trajectory_bias);
+
+  for(int num_control_points : {0, 8})
+  {
+    TaskPtr task(new DummyTask(trajectory_bias,BIAS_THRESHOLD,STD_DEV));
+    StompConfiguration config = create3DOFConfiguration();
+    config.single_precision = true;
+    config.num_control_points = num_control_points;
+    Stomp stomp(config,task);
+
+    Trajectory optimized;
+    EXPECT_TRUE(stomp.solve(START_POS,END_POS,optimized));
+
+    EXPECT_EQ(optimized.rows(),NUM_DIMENSIONS);
+    EXPECT_EQ(optimized.cols(),NUM_TIMESTEPS);
+    EXPECT_TRUE(compareDiff(optimized,trajectory_bias,BIAS_THRESHOLD));
+  }
+}
+
+/** @brief This tests that the streaming update computes the same trajectory as the update of the whole trajectory */
+TEST(Stomp3DOF,solve_streaming_update)
+{
+  Trajectory trajectory_bias;
+  interpolate(START_POS,END_POS,NUM_TIMESTEPS,trajectory_bias);
+
+  Trajectory expected;
+  {
+    TaskPtr task(new DummyTask(trajectory_bias,BIAS_THRESHOLD,STD_DEV));
+    Stomp stomp(create3DOFConfiguration(),task);
+    EXPECT_TRUE(stomp.solve(START_POS,END_POS,expected));
+  }
+
+  for(int block_size : {1, 7, static_cast<int>(NUM_TIMESTEPS), static_cast<int>(2*NUM_TIMESTEPS)})
+  {
+    TaskPtr task(new DummyTask(trajectory_bias,BIAS_THRESHOLD,STD_DEV));
+    StompConfiguration config = create3DOFConfiguration();
+    config.streaming_block_size = block_size;
+    config.num_threads = 2;
+    Stomp stomp(config,task);
+
+    Trajectory optimized;
+    EXPECT_TRUE(stomp.solve(START_POS,END_POS,optimized));
+
+    EXPECT_EQ(optimized.rows(),NUM_DIMENSIONS);
+    EXPECT_EQ(optimized.cols(),NUM_TIMESTEPS);
+    EXPECT_TRUE(compareDiff(optimized,trajectory_bias,BIAS_THRESHOLD));
+    EXPECT_TRUE(optimized.isApprox(expected,1e-6)) << "block size " << block_size;
+  }
+}
+
+/** @brief A dummy task that evaluates the noisy rollouts in batches through the default per rollout adapter */
+class BatchCostTask: public DummyTask
+{
+public:
+
+  using DummyTask::DummyTask;
+
+  /** @brief See base clase for documentation */
+  bool supportsBatchCosts() const override
+  {
+    return true;
+  }
+
+  /** @brief See base clase for documentation */
+  bool computeNoisyCostsBatch(const Eigen::MatrixXd& parameters,
+                              std::size_t start_timestep,
+                              std::size_t num_timesteps,
+                              int iteration_number,
+                              int num_rollouts,
+                              Eigen::MatrixXd& costs,
+                              std::vector<bool>& validities) override
+  {
+    num_batches_++;
+    return DummyTask::computeNoisyCostsBatch(parameters,start_timestep,num_timesteps,iteration_number,num_rollouts,
+                                             costs,validities);
+  }
+
+  int num_batches_ = 0;   /**< The number of batches evaluated */
+};
+
+/** @brief This tests that evaluating the rollouts in batches produces the same trajectory as the per rollout path */
+TEST(Stomp3DOF,solve_batch_costs)
+{
+  Trajectory trajectory_bias;
+  interpolate(START_POS,END_POS,NUM_TIMESTEPS,trajectory_bias);
+
+  for(int window_size : {0, int(NUM_TIMESTEPS/4)})
+  {
+    StompConfiguration config = create3DOFConfiguration();
+    config.window_size = window_size;
+
+    // both tasks reset the random sequence when constructed
+    Trajectory expected;
+    TaskPtr task(new DummyTask(trajectory_bias,BIAS_THRESHOLD,STD_DEV));
+    Stomp stomp(config,task);
+    stomp.solve(START_POS,END_POS,expected);
+
+    Trajectory optimized;
+    std::shared_ptr<BatchCostTask> batch_task(new BatchCostTask(trajectory_bias,BIAS_THRESHOLD,STD_DEV));
+    Stomp batch_stomp(config,batch_task);
+    batch_stomp.solve(START_POS,END_POS,optimized);
+
+    EXPECT_GT(batch_task->num_batches_,0);
+    EXPECT_TRUE(optimized.isApprox(expected)) << "window size " << window_size;
+  }
+}
+
+/** @brief This tests that the per rollout batch adapter accepts the costs of the window or of the whole trajectory only */
+TEST(Stomp3DOF,batch_costs_per_rollout)
+{
+  const int num_rollouts = 3;
+  const int num_parameters = 10;
+  Eigen::MatrixXd parameters = Eigen::MatrixXd::Zero(NUM_DIMENSIONS,num_rollouts*num_parameters);
+  Eigen::MatrixXd costs;
+  std::vector<bool> validities;
+
+  int costs_size = 0;
+  auto compute = [&](const Eigen::MatrixXd& rollout_parameters,int rollout,Eigen::VectorXd& rollout_costs,bool& valid)
+  {
+    rollout_costs = Eigen::VectorXd::LinSpaced(costs_size,0,costs_size - 1) + Eigen::VectorXd::Constant(costs_size,rollout);
+    valid = rollout != 1;
+    return rollout_parameters.cols() == num_parameters;
+  };
+
+  costs_size = num_parameters;
+  ASSERT_TRUE(computeBatchCostsPerRollout(parameters,2,4,num_rollouts,compute,costs,validities));
+  EXPECT_EQ(costs.rows(),num_rollouts);
+  EXPECT_EQ(costs.cols(),4);
+  EXPECT_DOUBLE_EQ(costs(2,0),4.0);
+  EXPECT_EQ(validities,std::vector<bool>({true,false,true}));
+
+  costs_size = 4;
+  ASSERT_TRUE(computeBatchCostsPerRollout(parameters,2,4,num_rollouts,compute,costs,validities));
+  EXPECT_DOUBLE_EQ(costs(1,3),4.0);
+
+  costs_size = 5;
+  EXPECT_FALSE(computeBatchCostsPerRollout(parameters,2,4,num_rollouts,compute,costs,validities));
+  EXPECT_FALSE(computeBatchCostsPerRollout(parameters,2,4,4,compute,costs,validities));
+}
+
+/** @brief A dummy task that is called through the Eigen::Ref based methods and writes into the views it receives */
+class RefTask: public DummyTask
+{
+public:
+
+  using DummyTask::DummyTask;
+
+  /** @brief See base clase for documentation */
+  bool supportsRefInterface() const override
+  {
+    return true;
+  }
+
+  /** @brief See base clase for documentation */
+  bool generateNoisyParametersRef(const Eigen::Ref<const Eigen::MatrixXd>& parameters,
+                                  std::size_t start_timestep,
+                                  std::size_t num_timesteps,
+                                  int iteration_number,
+                                  int rollout_number,
+                                  Eigen::Ref<Eigen::MatrixXd> parameters_noise,
+                                  Eigen::Ref<Eigen::MatrixXd> noise) override
+  {
+    // draws the same random sequence as DummyTask, the noise outside of the window is discarded
+    num_ref_calls_++;
+    double rand_noise;
+    for(Eigen::Index d = 0; d < parameters.rows(); d++)
+    {
+      for(Eigen::Index t = 0; t < parameters.cols(); t++)
+      {
+        rand_noise = static_cast<double>(rand()%RAND_MAX)/static_cast<double>(RAND_MAX - 1); // 0 to 1
+        rand_noise = 2*(0.5 - rand_noise);
+        if(t >= static_cast<Eigen::Index>(start_timestep) && t < static_cast<Eigen::Index>(start_timestep + num_timesteps))
+        {
+          noise(d,t - start_timestep) = rand_noise*std_dev_[d];
+        }
+      }
+    }
+
+    parameters_noise = parameters.middleCols(start_timestep,num_timesteps) + noise;
+    return true;
+  }
+
+  /** @brief See base clase for documentation */
+  bool computeNoisyCostsRef(const Eigen::Ref<const Eigen::MatrixXd>& parameters,
+                            std::size_t start_timestep,
+                            std::size_t num_timesteps,
+                            int iteration_number,
+                            int rollout_number,
+                            Eigen::Ref<Eigen::VectorXd> costs,
+                            bool& validity) override
+  {
+    num_ref_calls_++;
+    validity = true;
+    for(std::size_t t = start_timestep; t < start_timestep + num_timesteps; t++)
+    {
+      double cost = 0;
+      for(Eigen::Index d = 0; d < parameters.rows() ; d++)
+      {
+        double diff = std::abs(parameters(d,t) - parameters_bias_(d,t));
+        if( diff > std::abs(bias_thresholds_[d]))
+        {
+          cost += diff;
+          validity = false;
+        }
+      }
+      costs(t - start_timestep) = cost;
+    }
+
+    return true;
+  }
+
+  /** @brief See base clase for documentation */
+  bool computeCostsRef(const Eigen::Ref<const Eigen::MatrixXd>& parameters,
+                       std::size_t start_timestep,
+                       std::size_t num_timesteps,
+                       int iteration_number,
+                       Eigen::Ref<Eigen::VectorXd> costs,
+                       bool& validity) override
+  {
+    return computeNoisyCostsRef(parameters,start_timestep,num_timesteps,iteration_number,-1,costs,validity);
+  }
+
+  int num_ref_calls_ = 0;   /**< The number of calls to the Ref based methods */
+};
+
+/** @brief This tests that the Ref based task methods produce the same trajectory as the methods taking dense matrices */
+TEST(Stomp3DOF,solve_ref_interface)
+{
+  Trajectory trajectory_bias;
+  interpolate(START_POS,END_POS,NUM_TIMESTEPS,trajectory_bias);
+
+  for(int window_size : {0, int(NUM_TIMESTEPS/4)})
+  {
+    for(int num_control_points : {0, 8})
+    {
+      StompConfiguration config = create3DOFConfiguration();
+      config.window_size = window_size;
+      config.num_control_points = num_control_points;
+
+      // both tasks reset the random sequence when constructed
+      Trajectory expected;
+      TaskPtr task(new DummyTask(trajectory_bias,BIAS_THRESHOLD,STD_DEV));
+      Stomp stomp(config,task);
+      stomp.solve(START_POS,END_POS,expected);
+
+      Trajectory optimized;
+      std::shared_ptr<RefTask> ref_task(new RefTask(trajectory_bias,BIAS_THRESHOLD,STD_DEV));
+      Stomp ref_stomp(config,ref_task);
+      ref_stomp.solve(START_POS,END_POS,optimized);
+
+      EXPECT_GT(ref_task->num_ref_calls_,0);
+      EXPECT_TRUE(optimized.isApprox(expected)) << "window size " << window_size << ", control points "
+                                                << num_control_points;
+    }
+  }
+}
+
+/** @brief A dummy task that records the number of rollouts generated on each iteration */
+class RolloutCountingTask: public DummyTask
+{
+public:
+
+  /**
+   * @brief A dummy task that counts the generated rollouts
+   * @param parameters_bias default parameter bias used for computing cost for the test
+   * @param bias_thresholds threshold to determine whether two trajectories are equal
+   * @param std_dev standard deviation used for generating noisy parameters
+   * @param constant_cost whether every trajectory has the same cost so that no improvement is ever found
+   */
+  RolloutCountingTask(const Trajectory& parameters_bias,
+                      const std::vector<double>& bias_thresholds,
+                      const std::vector<double>& std_dev,
+                      bool constant_cost):
+    DummyTask(parameters_bias,bias_thresholds,std_dev),
+    constant_cost_(constant_cost)
+  {
+
+  }
+
+  /** @brief See base clase for documentation */
+  bool generateNoisyParameters(const Eigen::MatrixXd& parameters,
+                               std::size_t start_timestep,
+                               std::size_t num_timesteps,
+                               int iteration_number,
+                               int rollout_number,
+                               Eigen::MatrixXd& parameters_noise,
+                               Eigen::MatrixXd& noise) override
+  {
+    rollout_counts_.resize(std::max<std::size_t>(rollout_counts_.size(),iteration_number + 1),0);
+    rollout_counts_[iteration_number]++;
+    return DummyTask::generateNoisyParameters(parameters,start_timestep,num_timesteps,iteration_number,rollout_number,
+                                              parameters_noise,noise);
+  }
+
+  /** @brief See base clase for documentation */
+  bool computeNoisyCosts(const Trajectory& parameters,
+                         std::size_t start_timestep,
+                         std::size_t num_timesteps,
+                         int iteration_number,
+                         int rollout_number,
+                         Eigen::VectorXd& costs,
+                         bool& validity) override
+  {
+    if(!constant_cost_)
+    {
+      return DummyTask::computeNoisyCosts(parameters,start_timestep,num_timesteps,iteration_number,rollout_number,
+                                          costs,validity);
+    }
+
+    costs.setOnes(num_timesteps);
+    validity = false;
+    return true;
+  }
+
+  std::vector<int> rollout_counts_;   /**< The number of rollouts generated on each iteration */
+
+protected:
+
+  bool constant_cost_;                /**< Whether every trajectory has the same cost */
+};
+
+/** @brief This tests that the adaptive rollout count grows while the cost does not improve */
+TEST(Stomp3DOF,adaptive_rollouts_grow)
+{
+  Trajectory trajectory_bias;
+  interpolate(START_POS,END_POS,NUM_TIMESTEPS,trajectory_bias);
+  std::shared_ptr<RolloutCountingTask> task(new RolloutCountingTask(trajectory_bias,BIAS_THRESHOLD,STD_DEV,true));
+
+  StompConfiguration config = create3DOFConfiguration();
+  config.num_rollouts = 10;
+  config.max_rollouts = 30;
+  config.min_rollouts = 5;
+  config.num_iterations = 20;
+  Stomp stomp(config,task);
+
+  Trajectory optimized;
+  EXPECT_FALSE(stomp.solve(START_POS,END_POS,optimized));
+
+  ASSERT_EQ(task->rollout_counts_.size(),config.num_iterations + 1);
+  EXPECT_EQ(task->rollout_counts_[1],config.num_rollouts);
+  EXPECT_EQ(task->rollout_counts_.back(),config.max_rollouts - 1);
+  EXPECT_EQ(getMaxGeneratedRollouts(config),config.max_rollouts - 1);
+}
+
+/** @brief This tests that the adaptive rollout count shrinks as the cost converges */
+TEST(Stomp3DOF,adaptive_rollouts_shrink)
+{
+  Trajectory trajectory_bias;
+  interpolate(START_POS,END_POS,NUM_TIMESTEPS,trajectory_bias);
+  std::shared_ptr<RolloutCountingTask> task(new RolloutCountingTask(trajectory_bias,BIAS_THRESHOLD,STD_DEV,false));
+
+  StompConfiguration config = create3DOFConfiguration();
+  config.min_rollouts = 5;
+  config.num_iterations_after_valid = 40;
+  Stomp stomp(config,task);
+
+  Trajectory optimized;
+  EXPECT_TRUE(stomp.solve(START_POS,END_POS,optimized));
+  EXPECT_TRUE(compareDiff(optimized,trajectory_bias,BIAS_THRESHOLD));
+
+  int total_rollouts = std::accumulate(task->rollout_counts_.begin(),task->rollout_counts_.end(),0);
+  EXPECT_LT(total_rollouts,config.num_rollouts*(int(task->rollout_counts_.size()) - 1));
+  EXPECT_EQ(task->rollout_counts_.back(),config.min_rollouts);
+}
+
+/** @brief A dummy task that records the termination reason reported by Stomp */
+class TerminationReasonTask: public DummyTask
+{
+public:
+
+  using DummyTask::DummyTask;
+  using DummyTask::done;
+
+  /** @brief See base clase for documentation */
+  void done(bool success,int total_iterations,double final_cost,const Eigen::MatrixXd& parameters,
+            TerminationReasons::TerminationReason reason) override
+  {
+    reason_ = reason;
+    total_iterations_ = total_iterations;
+  }
+
+  TerminationReasons::TerminationReason reason_ = TerminationReasons::FAILED; /**< The reported termination reason */
+  int total_iterations_ = 0;                                                  /**< The reported number of iterations */
+};
+
+/** @brief This tests that the convergence criteria stop the optimization before the maximum number of iterations */
+TEST(Stomp3DOF,convergence_criteria)
+{
+  // a zero threshold never produces a valid trajectory
+  const std::vector<double> zero_threshold = {0.0, 0.0, 0.0};
+  Trajectory trajectory_bias;
+  interpolate(START_POS,END_POS,NUM_TIMESTEPS,trajectory_bias);
+  trajectory_bias.array() += 0.5;
+
+  StompConfiguration config = create3DOFConfiguration();
+  config.num_iterations = 100;
+
+  // no criteria
+  {
+    std::shared_ptr<TerminationReasonTask> task(new TerminationReasonTask(trajectory_bias,zero_threshold,STD_DEV));
+    Stomp stomp(config,task);
+    Trajectory optimized;
+    EXPECT_FALSE(stomp.solve(START_POS,END_POS,optimized));
+    EXPECT_EQ(task->reason_,TerminationReasons::MAX_ITERATIONS);
+    EXPECT_EQ(stomp.getTerminationReason(),TerminationReasons::MAX_ITERATIONS);
+  }
+
+  // relative cost improvement, requiring the cost to vanish over 2 iterations
+  {
+    StompConfiguration c = config;
+    c.convergence_iterations = 2;
+    c.convergence_cost_epsilon = 1.0;
+    std::shared_ptr<TerminationReasonTask> task(new TerminationReasonTask(trajectory_bias,zero_threshold,STD_DEV));
+    Stomp stomp(c,task);
+    Trajectory optimized;
+    stomp.solve(START_POS,END_POS,optimized);
+    EXPECT_EQ(task->reason_,TerminationReasons::COST_CONVERGED);
+    EXPECT_EQ(task->total_iterations_,3);
+  }
+
+  // update magnitude
+  {
+    StompConfiguration c = config;
+    c.convergence_update_threshold = 1e6;
+    std::shared_ptr<TerminationReasonTask> task(new TerminationReasonTask(trajectory_bias,zero_threshold,STD_DEV));
+    Stomp stomp(c,task);
+    Trajectory optimized;
+    stomp.solve(START_POS,END_POS,optimized);
+    EXPECT_EQ(task->reason_,TerminationReasons::UPDATES_CONVERGED);
+    EXPECT_EQ(task->total_iterations_,1);
+  }
+
+  // wall-clock budget
+  {
+    StompConfiguration c = config;
+    c.max_optimization_time = 1e-9;
+    std::shared_ptr<TerminationReasonTask> task(new TerminationReasonTask(trajectory_bias,zero_threshold,STD_DEV));
+    Stomp stomp(c,task);
+    Trajectory optimized;
+    stomp.solve(START_POS,END_POS,optimized);
+    EXPECT_EQ(task->reason_,TerminationReasons::TIME_LIMIT);
+    EXPECT_EQ(task->total_iterations_,1);
+  }
+}
+
+/** @brief This tests that the reported number of iterations does not count past the last iteration that was run */
+TEST(Stomp3DOF,num_iterations)
+{
+  const std::vector<double> zero_threshold = {0.0, 0.0, 0.0};
+  Trajectory trajectory_bias;
+  interpolate(START_POS,END_POS,NUM_TIMESTEPS,trajectory_bias);
+  trajectory_bias.array() += 0.5;
+
+  StompConfiguration config = create3DOFConfiguration();
+  config.num_iterations = 20;
+
+  // all the iterations are run
+  {
+    TaskPtr task(new DummyTask(trajectory_bias,zero_threshold,STD_DEV));
+    Stomp stomp(config,task);
+    Trajectory optimized;
+    EXPECT_FALSE(stomp.solve(START_POS,END_POS,optimized));
+    EXPECT_EQ(stomp.getNumIterations(),static_cast<unsigned int>(config.num_iterations));
+  }
+
+  // the cost converges at the third iteration
+  {
+    StompConfiguration c = config;
+    c.convergence_iterations = 2;
+    c.convergence_cost_epsilon = 1.0;
+    TaskPtr task(new DummyTask(trajectory_bias,zero_threshold,STD_DEV));
+    Stomp stomp(c,task);
+    Trajectory optimized;
+    stomp.solve(START_POS,END_POS,optimized);
+    EXPECT_EQ(stomp.getTerminationReason(),TerminationReasons::COST_CONVERGED);
+    EXPECT_EQ(stomp.getNumIterations(),3u);
+  }
+}
+
+/** @brief This tests that a deadline stops the optimization and returns the best trajectory found so far */
+TEST(Stomp3DOF,solve_deadline)
+{
+  using namespace std::chrono;
+
+  // a large threshold makes every trajectory valid
+  const std::vector<double> large_threshold = {1e6, 1e6, 1e6};
+  Trajectory trajectory_bias;
+  interpolate(START_POS,END_POS,NUM_TIMESTEPS,trajectory_bias);
+  trajectory_bias.array() += 0.5;
+
+  StompConfiguration config = create3DOFConfiguration();
+  config.num_iterations = std::numeric_limits<int>::max();
+  config.num_iterations_after_valid = std::numeric_limits<int>::max();
+
+  // expired deadline, the initial trajectory is returned
+  {
+    std::shared_ptr<TerminationReasonTask> task(new TerminationReasonTask(trajectory_bias,large_threshold,STD_DEV));
+    Stomp stomp(config,task);
+    Trajectory initial, optimized;
+    interpolate(START_POS,END_POS,NUM_TIMESTEPS,initial);
+    EXPECT_TRUE(stomp.solve(initial,optimized,steady_clock::now()));
+    EXPECT_EQ(task->reason_,TerminationReasons::TIME_LIMIT);
+    EXPECT_TRUE(optimized.isApprox(initial));
+  }
+
+  // future deadline, the optimization keeps iterating until it is reached
+  {
+    std::shared_ptr<TerminationReasonTask> task(new TerminationReasonTask(trajectory_bias,large_threshold,STD_DEV));
+    Stomp stomp(config,task);
+    Trajectory optimized;
+    steady_clock::time_point start = steady_clock::now();
+    EXPECT_TRUE(stomp.solve(START_POS,END_POS,optimized,start + milliseconds(50)));
+    duration<double> elapsed = steady_clock::now() - start;
+    EXPECT_EQ(task->reason_,TerminationReasons::TIME_LIMIT);
+    EXPECT_GE(elapsed.count(),0.05);
+    EXPECT_LT(elapsed.count(),1.0);
+    EXPECT_GT(task->total_iterations_,1);
+  }
+}
+
+/** @brief This tests that the best valid trajectory can be read while the optimization is in progress */
+TEST(Stomp3DOF,best_valid_parameters)
+{
+  Trajectory trajectory_bias;
+  interpolate(START_POS,END_POS,NUM_TIMESTEPS,trajectory_bias);
+
+  StompConfiguration config = create3DOFConfiguration();
+  config.num_iterations_after_valid = 10;
+
+  // a zero threshold never produces a valid trajectory away from the bias
+  {
+    Trajectory offset_bias = trajectory_bias.array() + 0.5;
+    TaskPtr task(new DummyTask(offset_bias,{0.0, 0.0, 0.0},STD_DEV));
+    Stomp stomp(config,task);
+    Trajectory optimized, best;
+    double cost;
+    unsigned int iteration;
+    EXPECT_FALSE(stomp.solve(START_POS,END_POS,optimized));
+    EXPECT_FALSE(stomp.getBestValidParameters(best,cost,iteration));
+  }
+
+  // polling from another thread, the snapshot cost never increases
+  TaskPtr task(new DummyTask(trajectory_bias,BIAS_THRESHOLD,STD_DEV));
+  Stomp stomp(config,task);
+  std::atomic<bool> solving(true);
+  int snapshots = 0;
+  bool cost_increased = false;
+  std::thread reader([&]()
+  {
+    Trajectory best;
+    double cost, previous_cost = std::numeric_limits<double>::max();
+    unsigned int iteration;
+    while(solving)
+    {
+      if(stomp.getBestValidParameters(best,cost,iteration))
+      {
+        cost_increased |= cost > previous_cost;
+        previous_cost = cost;
+        snapshots++;
+      }
+    }
+  });
+
+  Trajectory optimized, best;
+  bool success = stomp.solve(START_POS,END_POS,optimized);
+  solving = false;
+  reader.join();
+  EXPECT_TRUE(success);
+  EXPECT_FALSE(cost_increased);
+
+  double cost;
+  unsigned int iteration;
+  ASSERT_TRUE(stomp.getBestValidParameters(best,cost,iteration));
+  EXPECT_TRUE(compareDiff(best,trajectory_bias,BIAS_THRESHOLD));
+  EXPECT_DOUBLE_EQ(cost,stomp.getOptimizedCost());
+  EXPECT_TRUE(best.isApprox(optimized));
+}
+
+/** @brief A dummy task that discards every update and counts the evaluations of the optimized parameters */
+class FrozenParametersTask: public DummyTask
+{
+public:
+
+  using DummyTask::DummyTask;
+
+  /** @brief See base clase for documentation */
+  bool computeCosts(const Trajectory& parameters,
+                    std::size_t start_timestep,
+                    std::size_t num_timesteps,
+                    int iteration_number,
+                    Eigen::VectorXd& costs,
+                    bool& validity) override
+  {
+    num_evaluations_++;
+    return DummyTask::computeCosts(parameters,start_timestep,num_timesteps,iteration_number,costs,validity);
+  }
+
+  /** @brief See base clase for documentation */
+  bool filterParameterUpdates(std::size_t start_timestep,
+                              std::size_t num_timesteps,
+                              int iteration_number,
+                              const Eigen::MatrixXd& parameters,
+                              Eigen::MatrixXd& updates) override
+  {
+    updates.setZero();
+    return true;
+  }
+
+  int num_evaluations_ = 0;   /**< The number of times the optimized parameters were evaluated */
+};
+
+/** @brief This tests that the costs of optimized parameters left unchanged by an iteration are not evaluated again */
+TEST(Stomp3DOF,unchanged_parameters_not_evaluated)
+{
+  Trajectory trajectory_bias;
+  interpolate(START_POS,END_POS,NUM_TIMESTEPS,trajectory_bias);
+  std::shared_ptr<FrozenParametersTask> task(new FrozenParametersTask(trajectory_bias,BIAS_THRESHOLD,STD_DEV));
+
+  StompConfiguration config = create3DOFConfiguration();
+  config.num_iterations = 10;
+  Stomp stomp(config,task);
+
+  Trajectory initial, optimized;
+  interpolate(START_POS,END_POS,NUM_TIMESTEPS,initial);
+  stomp.solve(START_POS,END_POS,optimized);
+
+  EXPECT_EQ(task->num_evaluations_,1);
+  EXPECT_TRUE(optimized.isApprox(initial));
+}
+
+/** @brief An instrumentation sink that keeps the profiles it receives */
+class RecordingSink: public InstrumentationSink
+{
+public:
+
+  /** @brief See base class for documentation */
+  void recordIteration(const IterationProfile& profile) override
+  {
+    iterations_.push_back(profile);
+  }
+
+  /** @brief See base class for documentation */
+  void recordSolve(const SolveProfile& profile) override
+  {
+    solves_.push_back(profile);
+  }
+
+  std::vector<IterationProfile> iterations_;  /**< The iteration profiles received */
+  std::vector<SolveProfile> solves_;          /**< The solve profiles received */
+};
+
+/** @brief This tests that the instrumentation sink receives the profile of every iteration when it is enabled */
+TEST(Stomp3DOF,instrumentation_sink)
+{
+  Trajectory trajectory_bias;
+  interpolate(START_POS,END_POS,NUM_TIMESTEPS,trajectory_bias);
+  TaskPtr task(new DummyTask(trajectory_bias,BIAS_THRESHOLD,STD_DEV));
+
+  StompConfiguration config = create3DOFConfiguration();
+  config.num_rollouts = 10;
+  Stomp stomp(config,task);
+  std::shared_ptr<RecordingSink> sink(new RecordingSink());
+  stomp.setInstrumentationSink(sink);
+
+  Trajectory optimized;
+  EXPECT_TRUE(stomp.solve(START_POS,END_POS,optimized));
+
+  if(!isInstrumentationEnabled())
+  {
+    EXPECT_TRUE(sink->iterations_.empty());
+    EXPECT_TRUE(sink->solves_.empty());
+    return;
+  }
+
+  ASSERT_EQ(sink->iterations_.size(),stomp.getNumIterations());
+  ASSERT_EQ(sink->solves_.size(),1u);
+  for(std::size_t i = 0; i < sink->iterations_.size(); i++)
+  {
+    const IterationProfile& profile = sink->iterations_[i];
+    EXPECT_EQ(profile.iteration,i + 1);
+    EXPECT_TRUE(profile.completed);
+    EXPECT_EQ(profile.num_stages,static_cast<int>(IterationStages::NUM_STAGES));
+    for(int s = 1; s < profile.num_stages; s++)
+    {
+      EXPECT_GE(profile.stage_starts[s],profile.stage_starts[s - 1]);
+    }
+    EXPECT_EQ(profile.rollouts_generated,config.num_rollouts);
+    EXPECT_EQ(profile.rollouts_active,profile.rollouts_generated + profile.rollouts_reused + 1);
+    EXPECT_LE(profile.min_rollout_cost,profile.mean_rollout_cost);
+    EXPECT_LE(profile.mean_rollout_cost,profile.max_rollout_cost);
+  }
+
+  const SolveProfile& solve = sink->solves_.front();
+  EXPECT_EQ(solve.reason,stomp.getTerminationReason());
+  EXPECT_EQ(solve.iterations,stomp.getNumIterations());
+  EXPECT_DOUBLE_EQ(solve.cost,stomp.getOptimizedCost());
+  EXPECT_TRUE(solve.valid);
+  EXPECT_TRUE(sink->iterations_.back().valid);
+}
@@ -0,0 +1,385 @@
+/**
+ * @file stomp_allocations.cpp
+ * @brief This verifies that the stomp optimization loop does not allocate heap memory
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <atomic>
+#include <cstdlib>
+#include <Eigen/Dense>
+#include <gtest/gtest.h>
+#include "stomp_core/stomp.h"
+#include "stomp_core/task.h"
+
+#ifdef __GLIBC__
+
+static std::atomic<bool> COUNT_ALLOCATIONS(false);     /**< Whether heap allocations are being counted */
+static std::atomic<std::size_t> NUM_ALLOCATIONS(0);    /**< The number of heap allocations counted */
+
+extern "C"
+{
+void* __libc_malloc(std::size_t size);
+void* __libc_calloc(std::size_t num, std::size_t size);
+void* __libc_realloc(void* ptr, std::size_t size);
+
+/** @brief Counts every heap allocation made by the process, Eigen and operator new end up here on glibc */
+void* malloc(std::size_t size)
+{
+  if(COUNT_ALLOCATIONS)
+  {
+    NUM_ALLOCATIONS++;
+  }
+  return __libc_malloc(size);
+}
+
+/** @brief Counts every zero initialized heap allocation */
+void* calloc(std::size_t num, std::size_t size)
+{
+  if(COUNT_ALLOCATIONS)
+  {
+    NUM_ALLOCATIONS++;
+  }
+  return __libc_calloc(num,size);
+}
+
+/** @brief Counts every heap reallocation */
+void* realloc(void* ptr, std::size_t size)
+{
+  if(COUNT_ALLOCATIONS)
+  {
+    NUM_ALLOCATIONS++;
+  }
+  return __libc_realloc(ptr,size);
+}
+}
+
+namespace
+{
+
+const std::size_t NUM_DIMENSIONS = 3;          /**< Number of parameters to optimize */
+const std::size_t NUM_TIMESTEPS = 20;          /**< Number of timesteps */
+const int NUM_ITERATIONS = 10;                 /**< Number of iterations to run */
+const int WARMUP_ITERATIONS = 2;               /**< Iterations allowed to allocate before the loop reaches steady state */
+
+using namespace stomp_core;
+
+/**
+ * @brief A task that does not allocate memory in any of its callbacks and never produces a valid trajectory so that
+ * every iteration is executed.  It counts the allocations made in between consecutive iterations.
+ */
+class AllocationCountingTask: public Task
+{
+public:
+
+  AllocationCountingTask():
+    smoothed_update_(Eigen::VectorXd::Zero(NUM_TIMESTEPS))
+  {
+    generateSmoothingMatrix(NUM_TIMESTEPS,1.0,smoothing_M_);
+    srand(1);
+  }
+
+  /** @brief See base clase for documentation */
+  bool generateNoisyParameters(const Eigen::MatrixXd& parameters,
+                               std::size_t start_timestep,
+                               std::size_t num_timesteps,
+                               int iteration_number,
+                               int rollout_number,
+                               Eigen::MatrixXd& parameters_noise,
+                               Eigen::MatrixXd& noise) override
+  {
+    for(auto d = 0u; d < parameters.rows(); d++)
+    {
+      for(auto t = 0u; t < parameters.cols(); t++)
+      {
+        noise(d,t) = 2*(0.5 - static_cast<double>(rand())/static_cast<double>(RAND_MAX));
+      }
+    }
+
+    parameters_noise = parameters + noise;
+    return true;
+  }
+
+  /** @brief See base clase for documentation */
+  bool computeCosts(const Eigen::MatrixXd& parameters,
+                    std::size_t start_timestep,
+                    std::size_t num_timesteps,
+                    int iteration_number,
+                    Eigen::VectorXd& costs,
+                    bool& validity) override
+  {
+    return computeNoisyCosts(parameters,start_timestep,num_timesteps,iteration_number,-1,costs,validity);
+  }
+
+  /** @brief See base clase for documentation */
+  bool computeNoisyCosts(const Eigen::MatrixXd& parameters,
+                         std::size_t start_timestep,
+                         std::size_t num_timesteps,
+                         int iteration_number,
+                         int rollout_number,
+                         Eigen::VectorXd& costs,
+                         bool& validity) override
+  {
+    costs = parameters.colwise().squaredNorm().transpose();
+    validity = false;
+    return true;
+  }
+
+  /** @brief See base clase for documentation */
+  bool filterParameterUpdates(std::size_t start_timestep,
+                              std::size_t num_timesteps,
+                              int iteration_number,
+                              const Eigen::MatrixXd& parameters,
+                              Eigen::MatrixXd& updates) override
+  {
+    for(auto d = 0u; d < updates.rows(); d++)
+    {
+      smoothed_update_.noalias() = smoothing_M_*updates.row(d).transpose();
+      updates.row(d) = smoothed_update_.transpose();
+    }
+    return true;
+  }
+
+  /** @brief Records the number of allocations made during the iteration that just finished */
+  void postIteration(std::size_t start_timestep,
+                     std::size_t num_timesteps,int iteration_number,double cost,const Eigen::MatrixXd& parameters) override
+  {
+    if(iteration_number > WARMUP_ITERATIONS)
+    {
+      steady_state_allocations_ += NUM_ALLOCATIONS;
+    }
+    NUM_ALLOCATIONS = 0;
+    COUNT_ALLOCATIONS = true;
+  }
+
+  using Task::done;
+
+  /** @brief Stops counting allocations */
+  void done(bool success,int total_iterations,double final_cost,const Eigen::MatrixXd& parameters) override
+  {
+    COUNT_ALLOCATIONS = false;
+  }
+
+  std::size_t steady_state_allocations_ = 0;  /**< The allocations made after the warmup iterations */
+
+protected:
+
+  Eigen::MatrixXd smoothing_M_;         /**< Matrix used for smoothing the trajectory */
+  Eigen::VectorXd smoothed_update_;     /**< Preallocated smoothed update */
+};
+
+/** @brief Same as AllocationCountingTask but called through the Eigen::Ref based methods */
+class RefAllocationCountingTask: public AllocationCountingTask
+{
+public:
+
+  /** @brief See base clase for documentation */
+  bool supportsRefInterface() const override
+  {
+    return true;
+  }
+
+  /** @brief See base clase for documentation */
+  bool generateNoisyParametersRef(const Eigen::Ref<const Eigen::MatrixXd>& parameters,
+                                  std::size_t start_timestep,
+                                  std::size_t num_timesteps,
+                                  int iteration_number,
+                                  int rollout_number,
+                                  Eigen::Ref<Eigen::MatrixXd> parameters_noise,
+                                  Eigen::Ref<Eigen::MatrixXd> noise) override
+  {
+    for(auto d = 0u; d < noise.rows(); d++)
+    {
+      for(auto t = 0u; t < noise.cols(); t++)
+      {
+        noise(d,t) = 2*(0.5 - static_cast<double>(rand())/static_cast<double>(RAND_MAX));
+      }
+    }
+
+    parameters_noise = parameters.middleCols(start_timestep,num_timesteps) + noise;
+    return true;
+  }
+
+  /** @brief See base clase for documentation */
+  bool computeNoisyCostsRef(const Eigen::Ref<const Eigen::MatrixXd>& parameters,
+                            std::size_t start_timestep,
+                            std::size_t num_timesteps,
+                            int iteration_number,
+                            int rollout_number,
+                            Eigen::Ref<Eigen::VectorXd> costs,
+                            bool& validity) override
+  {
+    costs = parameters.middleCols(start_timestep,num_timesteps).colwise().squaredNorm().transpose();
+    validity = false;
+    return true;
+  }
+
+  /** @brief See base clase for documentation */
+  bool computeCostsRef(const Eigen::Ref<const Eigen::MatrixXd>& parameters,
+                       std::size_t start_timestep,
+                       std::size_t num_timesteps,
+                       int iteration_number,
+                       Eigen::Ref<Eigen::VectorXd> costs,
+                       bool& validity) override
+  {
+    return computeNoisyCostsRef(parameters,start_timestep,num_timesteps,iteration_number,-1,costs,validity);
+  }
+};
+
+/**
+ * @brief Create a STOMP configuration that runs all iterations
+ * @return  StompConfiguration
+ */
+StompConfiguration createConfiguration()
+{
+  StompConfiguration c;
+  c.num_timesteps = NUM_TIMESTEPS;
+  c.num_iterations = NUM_ITERATIONS;
+  c.num_dimensions = NUM_DIMENSIONS;
+  c.delta_t = 0.1;
+  c.control_cost_weight = 0.1;
+  c.initialization_method = TrajectoryInitializations::LINEAR_INTERPOLATION;
+  c.exponentiated_cost_sensitivity = 10.0;
+  c.num_iterations_after_valid = 0;
+  c.num_rollouts = 10;
+  c.max_rollouts = 20;
+  c.min_rollouts = 0;
+  c.seed = 0;
+  c.num_threads = 1;
+  c.window_size = 0;
+  c.num_control_points = 0;
+  c.single_precision = false;
+  c.streaming_block_size = 0;
+  c.convergence_iterations = 0;
+  c.convergence_cost_epsilon = 0.0;
+  c.convergence_update_threshold = 0.0;
+  c.max_optimization_time = 0.0;
+
+  return c;
+}
+
+}
+
+/** @brief This tests that the optimization loop does not allocate memory once it has reached steady state */
+TEST(StompAllocations,steady_state_iterations)
+{
+  std::shared_ptr<AllocationCountingTask> task(new AllocationCountingTask());
+  Stomp stomp(createConfiguration(),task);
+
+  Eigen::MatrixXd optimized;
+  stomp.solve(std::vector<double>(NUM_DIMENSIONS,0.5),std::vector<double>(NUM_DIMENSIONS,-0.5),optimized);
+
+  EXPECT_EQ(task->steady_state_allocations_,0u);
+}
+
+/** @brief This tests that evaluating the rollouts concurrently does not allocate memory either */
+TEST(StompAllocations,steady_state_iterations_multithreaded)
+{
+  std::shared_ptr<AllocationCountingTask> task(new AllocationCountingTask());
+  StompConfiguration config = createConfiguration();
+  config.num_threads = 4;
+  Stomp stomp(config,task);
+
+  Eigen::MatrixXd optimized;
+  stomp.solve(std::vector<double>(NUM_DIMENSIONS,0.5),std::vector<double>(NUM_DIMENSIONS,-0.5),optimized);
+
+  EXPECT_EQ(task->steady_state_allocations_,0u);
+}
+
+/** @brief This tests that perturbing a sliding window of the trajectory does not allocate memory either */
+TEST(StompAllocations,steady_state_iterations_windowed)
+{
+  std::shared_ptr<AllocationCountingTask> task(new AllocationCountingTask());
+  StompConfiguration config = createConfiguration();
+  config.window_size = NUM_TIMESTEPS/4;
+  Stomp stomp(config,task);
+
+  Eigen::MatrixXd optimized;
+  stomp.solve(std::vector<double>(NUM_DIMENSIONS,0.5),std::vector<double>(NUM_DIMENSIONS,-0.5),optimized);
+
+  EXPECT_EQ(task->steady_state_allocations_,0u);
+}
+
+/** @brief This tests that computing the probabilities and the updates in single precision does not allocate memory either */
+TEST(StompAllocations,steady_state_iterations_single_precision)
+{
+  for(int num_control_points : {0, 8})
+  {
+    std::shared_ptr<AllocationCountingTask> task(new AllocationCountingTask());
+    StompConfiguration config = createConfiguration();
+    config.single_precision = true;
+    config.num_control_points = num_control_points;
+    Stomp stomp(config,task);
+
+    Eigen::MatrixXd optimized;
+    stomp.solve(std::vector<double>(NUM_DIMENSIONS,0.5),std::vector<double>(NUM_DIMENSIONS,-0.5),optimized);
+
+    EXPECT_EQ(task->steady_state_allocations_,0u);
+  }
+}
+
+/** @brief This tests that the streaming update does not allocate memory either */
+TEST(StompAllocations,steady_state_iterations_streaming)
+{
+  std::shared_ptr<AllocationCountingTask> task(new AllocationCountingTask());
+  StompConfiguration config = createConfiguration();
+  config.streaming_block_size = 16;
+  config.num_threads = 2;
+  Stomp stomp(config,task);
+
+  Eigen::MatrixXd optimized;
+  stomp.solve(std::vector<double>(NUM_DIMENSIONS,0.5),std::vector<double>(NUM_DIMENSIONS,-0.5),optimized);
+
+  EXPECT_EQ(task->steady_state_allocations_,0u);
+}
+
+/** @brief This tests that computing the updates in a spline parameter space does not allocate memory either */
+TEST(StompAllocations,steady_state_iterations_spline)
+{
+  std::shared_ptr<AllocationCountingTask> task(new AllocationCountingTask());
+  StompConfiguration config = createConfiguration();
+  config.num_control_points = 8;
+  Stomp stomp(config,task);
+
+  Eigen::MatrixXd optimized;
+  stomp.solve(std::vector<double>(NUM_DIMENSIONS,0.5),std::vector<double>(NUM_DIMENSIONS,-0.5),optimized);
+
+  EXPECT_EQ(task->steady_state_allocations_,0u);
+}
+
+/** @brief This tests that writing the windows of the rollouts in place through the Ref based methods does not allocate memory either */
+TEST(StompAllocations,steady_state_iterations_ref_interface)
+{
+  for(int window_size : {0, int(NUM_TIMESTEPS/4)})
+  {
+    std::shared_ptr<RefAllocationCountingTask> task(new RefAllocationCountingTask());
+    StompConfiguration config = createConfiguration();
+    config.window_size = window_size;
+    Stomp stomp(config,task);
+
+    Eigen::MatrixXd optimized;
+    stomp.solve(std::vector<double>(NUM_DIMENSIONS,0.5),std::vector<double>(NUM_DIMENSIONS,-0.5),optimized);
+
+    EXPECT_EQ(task->steady_state_allocations_,0u);
+  }
+}
+
+#endif
@@ -0,0 +1,129 @@
+/**
+ * @file thread_pool.cpp
+ * @brief This tests the thread pool shared by concurrent jobs
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include "stomp_core/thread_pool.h"
+
+using namespace stomp_core;
+
+/** @brief This tests that every item of a job is executed once by a worker of the pool */
+TEST(ThreadPool,parallel_for)
+{
+  const std::size_t num_items = 1000;
+  ThreadPool pool(4);
+  ASSERT_EQ(pool.size(),4u);
+
+  std::vector<int> counts(num_items,0);
+  std::atomic<bool> valid_workers(true);
+  pool.parallelFor(num_items,[&](std::size_t index, std::size_t worker)
+  {
+    counts[index]++;
+    if(worker >= pool.size() || ThreadPool::getWorkerIndex() != worker)
+    {
+      valid_workers = false;
+    }
+  });
+
+  EXPECT_TRUE(valid_workers);
+  for(auto i = 0u; i < num_items; i++)
+  {
+    EXPECT_EQ(counts[i],1) << "item " << i;
+  }
+}
+
+/** @brief This tests that concurrent callers complete their jobs with unique worker indices within each job */
+TEST(ThreadPool,concurrent_jobs)
+{
+  const std::size_t num_callers = 4;
+  const std::size_t num_items = 200;
+  ThreadPool pool(3,std::vector<int>(),0);
+
+  std::vector<std::vector<int> > counts(num_callers,std::vector<int>(num_items,0));
+  std::vector<int> unique_workers(num_callers,1);
+  std::vector<std::thread> callers;
+  for(auto c = 0u; c < num_callers; c++)
+  {
+    callers.push_back(std::thread([&,c]()
+    {
+      for(auto repeat = 0; repeat < 10; repeat++)
+      {
+        std::vector<std::atomic<int> > active(pool.size());
+        for(auto& a : active)
+        {
+          a = 0;
+        }
+
+        pool.parallelFor(num_items,[&](std::size_t index, std::size_t worker)
+        {
+          if(active[worker]++ != 0)
+          {
+            unique_workers[c] = 0;
+          }
+          counts[c][index]++;
+          active[worker]--;
+        });
+      }
+    }));
+  }
+
+  for(auto& t : callers)
+  {
+    t.join();
+  }
+
+  for(auto c = 0u; c < num_callers; c++)
+  {
+    EXPECT_TRUE(unique_workers[c]);
+    for(auto i = 0u; i < num_items; i++)
+    {
+      EXPECT_EQ(counts[c][i],10) << "caller " << c << " item " << i;
+    }
+  }
+}
+
+/** @brief This tests that an exception thrown by a job reaches its caller once the pool is idle */
+TEST(ThreadPool,exception)
+{
+  ThreadPool pool(4);
+  std::atomic<int> executed(0);
+  EXPECT_THROW(pool.parallelFor(100,[&](std::size_t index, std::size_t)
+  {
+    executed++;
+    if(index == 50)
+    {
+      throw std::runtime_error("failed item");
+    }
+  }),std::runtime_error);
+  EXPECT_EQ(executed,100);
+
+  // the pool remains usable
+  executed = 0;
+  pool.parallelFor(10,[&](std::size_t, std::size_t){ executed++; });
+  EXPECT_EQ(executed,10);
+}
@@ -28,7 +28,11 @@
 
 #include <Eigen/Sparse>
 #include <moveit/robot_model/robot_model.h>
+#include <industrial_collision_detection/collision_detection/collision_robot_industrial.h>
+#include <industrial_collision_detection/collision_detection/collision_world_industrial.h>
+#include <stomp_core/thread_pool.h>
 #include "stomp_moveit/cost_functions/stomp_cost_function.h"
+#include "stomp_moveit/utils/configuration_cache.h"
 
 namespace stomp_moveit
 {
@@ -98,6 +102,20 @@ public:
                             Eigen::VectorXd& costs,
                             bool& validity) override;
 
+  /**
+   * @brief Creates a copy of this cost function for concurrent rollout evaluation.
+   * @return A new instance holding the same configuration
+   */
+  virtual StompCostFunctionPtr clone() const override
+  {
+    // the copy allocates its own states on the next motion plan request and its own timestep threads
+    CollisionCheck* copy = new CollisionCheck(*this);
+    copy->robot_state_.reset();
+    copy->contexts_.clear();
+    copy->timestep_pool_.reset(new stomp_core::ThreadPool(timestep_threads_));
+    return StompCostFunctionPtr(copy);
+  }
+
   virtual std::string getGroupName() const override
   {
     return group_name_;
@@ -111,17 +129,82 @@ public:
 
   virtual void done(bool success,int total_iterations,double final_cost,const Eigen::MatrixXd& parameters) override;
 
+  /**
+   * @brief The last optimized parameters are certified when every timestep was checked exactly, the coarse checks are
+   *        not exact.
+   * @param certificate Returns the checks and the parameters they cover
+   * @return True if the last optimized parameters were checked exactly and found free of collisions.
+   */
+  virtual bool getValidityCertificate(ValidityCertificate& certificate) const override;
+
 protected:
 
+  /**
+   * @brief The scratch data used by a thread to check timesteps, one per timestep thread.
+   */
+  struct TimestepContext
+  {
+    moveit::core::RobotStatePtr state;                /**< @brief Holds the timestep poses when the Task shares none */
+    moveit::core::RobotStatePtr intermediate_state;   /**< @brief Holds each intermediate pose in between two consecutive poses */
+    Eigen::VectorXd intermediate_positions;           /**< @brief The joint values of the group at the intermediate pose */
+    collision_detection::CollisionResult result;      /**< @brief Cleared and reused by every query */
+  };
+
   /**
    * @brief Checks for collision between consecutive points by dividing the joint move into sub-moves where the maximum joint motion
    *        can not exceed the @e longest_valid_joint_move value.
+   *        The sub-moves are interpolated on the joint values of the group and applied to a single reusable state.
+   * @param context                   The scratch data of the calling thread
    * @param start                     The start joint pose
    * @param end                       The end joint pose
    * @param longest_valid_joint_move  The maximum distance that the joints are allowed to move before checking for collisions.
    * @return  True if the interval is collision free, false otherwise.
    */
-  bool checkIntermediateCollisions(const Eigen::VectorXd& start, const Eigen::VectorXd& end,double longest_valid_joint_move);
+  bool checkIntermediateCollisions(TimestepContext& context,const Eigen::Ref<const Eigen::VectorXd>& start,
+                                   const Eigen::Ref<const Eigen::VectorXd>& end,double longest_valid_joint_move);
+
+  /**
+   * @brief Checks the robot vs world and self collisions of the state at a timestep
+   * @param context     The scratch data of the calling thread
+   * @param parameters  The parameter values [num_dimensions x num_parameters]
+   * @param t           The timestep
+   * @param robot       The collision robot to check with, either the exact or the padded one
+   * @return  True if the state is in collision, false otherwise.
+   */
+  bool isColliding(TimestepContext& context,const Eigen::MatrixXd& parameters, std::size_t t,
+                   const collision_detection::CollisionRobot& robot);
+
+  /**
+   * @brief Checks the robot vs world and self collisions of a state
+   * @param context The scratch data of the calling thread
+   * @param state   The state with its transforms up to date
+   * @param robot   The collision robot to check with, either the exact or the padded one
+   * @return  True if the state is in collision, false otherwise.
+   */
+  bool isStateColliding(TimestepContext& context,const moveit::core::RobotState& state,
+                        const collision_detection::CollisionRobot& robot);
+
+  /**
+   * @brief Assigns the exact raw costs of the timesteps [first, last] by checking each of them and the intermediate poses
+   *        in between consecutive timesteps.  The intermediate poses are checked first, concurrently on the timestep
+   *        threads, then the timesteps that follow a free interval.
+   * @param parameters  The parameter values [num_dimensions x num_parameters]
+   * @param first       The first timestep of the range
+   * @param last        The last timestep of the range, inclusive
+   * @return  True if the range is collision free, false otherwise.
+   */
+  bool checkTimesteps(const Eigen::MatrixXd& parameters,std::size_t first,std::size_t last);
+
+  /**
+   * @brief Checks the states of the timesteps [first, last] against the world and the robot itself as one trajectory of
+   *        the industrial checker, which computes the forward kinematics of each timestep on the shared query threads.
+   *        The states that follow a colliding interval are not marked as colliding.
+   * @param parameters  The parameter values [num_dimensions x num_parameters]
+   * @param first       The first timestep of the range
+   * @param last        The last timestep of the range, inclusive
+   * @return  False if the trajectory queries failed, the states are then checked one by one.
+   */
+  bool checkTrajectoryStates(const Eigen::MatrixXd& parameters,std::size_t first,std::size_t last);
 
   std::string name_;
 
@@ -138,18 +221,47 @@ protected:
   double collision_penalty_;            /**< @brief The value assigned to a collision state */
   double kernel_window_percentage_;     /**< @brief The value assigned to a collision state */
   double longest_valid_joint_move_;     /**< @brief how far can a joint move in between consecutive trajectory points */
+  int coarse_stride_;                   /**< @brief The timesteps in between the coarse checks, 1 checks every timestep exactly */
+  double coarse_padding_;               /**< @brief The padding added to the links during the coarse checks */
+  int timestep_threads_;                /**< @brief The threads that check the timesteps of a trajectory concurrently */
+  double cache_resolution_;             /**< @brief The joint space grid of the cached collision results, 0 disables the cache */
+  int cache_size_;                      /**< @brief The number of configurations whose collision result is cached */
 
   // cost calculation
   Eigen::VectorXd raw_costs_;
+  Eigen::VectorXd smoothed_costs_;       /**< @brief The kernel smoothed costs over the whole trajectory */
+  Eigen::MatrixXd smoothing_workspace_;  /**< @brief The prefix sums of the kernel smoothing */
   Eigen::ArrayXd intermediate_costs_slots_;
 
   // collision
   collision_detection::CollisionRequest collision_request_;
   collision_detection::CollisionRobotConstPtr collision_robot_;
   collision_detection::CollisionWorldConstPtr collision_world_;
+  collision_detection::CollisionRobotConstPtr coarse_collision_robot_;  /**< @brief The robot padded by coarse_padding_ */
+  collision_detection::CollisionWorldIndustrialConstPtr industrial_collision_world_; /**< @brief Set when the scene uses the industrial
+                                                                                          checker, which checks world and self collisions in one query */
+  collision_detection::AllowedCollisionBitMatrixConstPtr acm_bits_; /**< @brief The bits of the allowed collision matrix of the scene,
+                                                                          set with the industrial checker */
+  collision_detection::CollisionRobotIndustrialConstPtr industrial_collision_robot_; /**< @brief Set when the states of a range are
+                                                                                          checked as one trajectory, see checkTrajectoryStates() */
+  Eigen::MatrixXd trajectory_;                                      /**< @brief The joint values of the range checked as one trajectory */
+  collision_detection::TrajectoryCollisionResult world_results_;    /**< @brief The world collisions of the range */
+  collision_detection::TrajectoryCollisionResult self_results_;     /**< @brief The self collisions of the range */
+
+  // timestep checks, the flags hold a byte per timestep so that the threads can set distinct ones concurrently
+  stomp_core::ThreadPoolPtr timestep_pool_;         /**< @brief Checks the timesteps, it runs them serially with a single thread */
+  std::vector<TimestepContext> contexts_;           /**< @brief The scratch data of each timestep thread */
+  std::vector<char> state_colliding_;               /**< @brief Whether the state at each timestep is in collision */
+  std::vector<char> interval_free_;                 /**< @brief Whether the intermediate poses from each timestep to the next are free */
+  std::vector<char> coarse_free_;                   /**< @brief Whether each coarse sample is free of collisions */
+
+  // collision results of the configurations already checked during the request, shared with the clones
+  utils::ConfigurationCachePtr state_cache_;        /**< @brief Whether each checked configuration collides */
+  utils::ConfigurationCachePtr coarse_cache_;       /**< @brief Whether each configuration checked with the padded robot collides */
 
-  // intermediate collision check support
-  std::array<moveit::core::RobotStatePtr,3 > intermediate_coll_states_;   /**< @brief Used in checking collisions between to consecutive poses*/
+  // certificate of the last optimized parameters
+  bool certified_;                                  /**< @brief Whether the last optimized parameters were checked exactly and are free */
+  Eigen::MatrixXd certified_parameters_;            /**< @brief The last optimized parameters evaluated */
 
 };
 
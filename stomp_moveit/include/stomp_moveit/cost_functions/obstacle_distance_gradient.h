@@ -28,7 +28,10 @@
 #define INDUSTRIAL_MOVEIT_STOMP_MOVEIT_INCLUDE_STOMP_MOVEIT_COST_FUNCTIONS_OBSTACLE_DISTANCE_GRADIENT_H_
 
 #include <stomp_moveit/cost_functions/stomp_cost_function.h>
-#include <array>
+#include <stomp_moveit/utils/configuration_cache.h>
+#include <stomp_moveit/utils/obstacle_gradient.h>
+#include <industrial_collision_detection/collision_detection/robot_sphere_model.h>
+#include <stomp_core/thread_pool.h>
 
 namespace stomp_moveit
 {
@@ -92,6 +95,20 @@ public:
   virtual bool computeCosts(const Eigen::MatrixXd& parameters, std::size_t start_timestep, std::size_t num_timesteps,
                             int iteration_number, int rollout_number, Eigen::VectorXd& costs, bool& validity) override;
 
+  /**
+   * @brief Creates a copy of this cost function for concurrent rollout evaluation.
+   * @return A new instance holding the same configuration
+   */
+  virtual StompCostFunctionPtr clone() const override
+  {
+    // the copy allocates its own states on the next motion plan request and its own timestep threads
+    ObstacleDistanceGradient* copy = new ObstacleDistanceGradient(*this);
+    copy->robot_state_.reset();
+    copy->contexts_.clear();
+    copy->timestep_pool_.reset(new stomp_core::ThreadPool(timestep_threads_));
+    return StompCostFunctionPtr(copy);
+  }
+
   virtual std::string getGroupName() const override
   {
     return group_name_;
@@ -104,18 +121,53 @@ public:
 
   virtual void done(bool success,int total_iterations,double final_cost,const Eigen::MatrixXd& parameters) override;
 
+  /**
+   * @brief The nearest obstacle and the cartesian distance gradient at each timestep evaluated by the last call to
+   *        computeCosts(), entry i holds timestep 'start_timestep + i'.  Only filled when 'compute_gradients' is enabled.
+   * @return The gradients
+   */
+  const std::vector<utils::ObstacleGradient>& getGradients() const
+  {
+    return gradients_;
+  }
+
 
 protected:
 
+  /**
+   * @brief The scratch data used by a thread to evaluate timesteps, one per timestep thread.
+   */
+  struct TimestepContext
+  {
+    moveit::core::RobotStatePtr state;                  /**< @brief Holds the timestep poses when the Task shares none */
+    moveit::core::RobotStatePtr intermediate_state;     /**< @brief Holds each intermediate pose in between two consecutive poses */
+    Eigen::VectorXd intermediate_positions;             /**< @brief The joint values of the group at the intermediate pose */
+    collision_detection::CollisionResult collision_result;  /**< @brief Cleared and reused by every query */
+    collision_detection::DistanceResult distance_result;    /**< @brief Workspace for the detailed distance results */
+  };
+
   /**
    * @brief Checks for collision between consecutive points by dividing the joint move into sub-moves where the maximum joint motion
    *        can not exceed the @e longest_valid_joint_move value.
+   * @param context                   The scratch data of the calling thread
    * @param start                     The start joint pose
    * @param end                       The end joint pose
    * @param longest_valid_joint_move  The maximum distance that the joints are allowed to move before checking for collisions.
    * @return  True if the interval is collision free, false otherwise.
    */
-  bool checkIntermediateCollisions(const Eigen::VectorXd& start, const Eigen::VectorXd& end,double longest_valid_joint_move);
+  bool checkIntermediateCollisions(TimestepContext& context,const Eigen::Ref<const Eigen::VectorXd>& start,
+                                   const Eigen::Ref<const Eigen::VectorXd>& end,double longest_valid_joint_move);
+
+  /**
+   * @brief Computes the distance from the state at a timestep to the nearest obstacle
+   * @param context     The scratch data of the calling thread
+   * @param parameters  The parameter values [num_dimensions x num_parameters]
+   * @param t           The timestep
+   * @param obstacle    Receives the nearest obstacle and the gradient when 'compute_gradients' is enabled
+   * @return The distance or -1 when the state is in collision
+   */
+  double computeDistance(TimestepContext& context,const Eigen::MatrixXd& parameters,std::size_t t,
+                         utils::ObstacleGradient& obstacle);
 
 
   std::string name_;
@@ -125,9 +177,11 @@ protected:
   moveit::core::RobotModelConstPtr robot_model_ptr_;
   moveit::core::RobotStatePtr robot_state_;
 
-  // intermediate collision check support
-  std::array<moveit::core::RobotStatePtr,3 > intermediate_coll_states_;   /**< @brief Used in checking collisions between to consecutive poses*/
-
+  // timestep evaluation, the flags hold a byte per timestep so that the threads can set distinct ones concurrently
+  stomp_core::ThreadPoolPtr timestep_pool_;     /**< @brief Evaluates the timesteps, it runs them serially with a single thread */
+  std::vector<TimestepContext> contexts_;       /**< @brief The scratch data of each timestep thread */
+  std::vector<char> interval_free_;             /**< @brief Whether the intermediate poses from each timestep to the next are free */
+  Eigen::VectorXd distances_;                   /**< @brief The distance computed at each timestep */
 
   // planning context information
   planning_scene::PlanningSceneConstPtr planning_scene_;
@@ -135,11 +189,28 @@ protected:
 
   // distance and collision check
   collision_detection::CollisionRequest collision_request_;
-  collision_detection::CollisionResult collision_result_;
 
   // parameters
   double max_distance_;               /**< @brief maximum distance from at which the trajectory will be penalized */
   double longest_valid_joint_move_;   /**< @brief how far can a joint move in between consecutive trajectory points */
+  bool compute_gradients_;            /**< @brief Whether the detailed distances and their gradient are computed */
+  int timestep_threads_;              /**< @brief The threads that evaluate the timesteps of a trajectory concurrently */
+  double cache_resolution_;           /**< @brief The joint space grid of the cached results, 0 disables the cache */
+  int cache_size_;                    /**< @brief The number of configurations whose result is cached */
+  double lod_margin_;                 /**< @brief The distance beyond which the coarse link meshes are used */
+  bool sphere_fast_path_;             /**< @brief Whether the links far from the world are skipped using their spheres */
+  collision_detection::RobotSphereModelConstPtr sphere_model_;           /**< @brief The spheres covering the links */
+
+  // results of the configurations already evaluated during the request, shared with the clones
+  utils::ConfigurationCachePtr distance_cache_;   /**< @brief The distance of each evaluated configuration, unused with the gradients */
+  utils::ConfigurationCachePtr collision_cache_;  /**< @brief Whether each checked intermediate configuration collides */
+
+  // distance gradient support, only used with the industrial collision checker
+  collision_detection::CollisionRobotIndustrialConstPtr industrial_robot_;  /**< @brief The collision robot of the scene */
+  collision_detection::CollisionWorldIndustrialConstPtr industrial_world_;  /**< @brief The collision world of the scene */
+  collision_detection::DistanceRequest distance_request_;                 /**< @brief The detailed request of the group links */
+  collision_detection::AllowedCollisionBitMatrixConstPtr acm_bits_;      /**< @brief The bits of the allowed collision matrix of the request */
+  std::vector<utils::ObstacleGradient> gradients_;                        /**< @brief The gradient at each evaluated timestep */
 
 };
 
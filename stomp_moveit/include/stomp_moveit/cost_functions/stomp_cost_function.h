@@ -27,12 +27,15 @@
 #define INDUSTRIAL_MOVEIT_STOMP_CORE_INCLUDE_STOMP_CORE_STOMP_COST_FUNCTION_H_
 
 #include <string>
+#include <vector>
 #include <XmlRpc.h>
+#include <ros/console.h>
 #include <stomp_core/utils.h>
 #include <moveit_msgs/GetMotionPlan.h>
 #include <moveit/robot_model/robot_model.h>
 #include <moveit/robot_trajectory/robot_trajectory.h>
 #include <moveit/planning_scene/planning_scene.h>
+#include <stomp_moveit/utils/rollout_states.h>
 
 namespace stomp_moveit
 {
@@ -43,6 +46,37 @@ namespace cost_functions
 class StompCostFunction;
 typedef std::shared_ptr<StompCostFunction> StompCostFunctionPtr;
 
+/**
+ * @brief Describes the validity checks that a cost function ran on the last optimized parameters it evaluated, the
+ *        planner uses it to avoid checking the returned trajectory a second time.
+ */
+struct ValidityCertificate
+{
+  ValidityCertificate():
+    collisions_checked(false),
+    longest_valid_joint_move(0.0),
+    planning_scene(nullptr)
+  {
+  }
+
+  bool collisions_checked;                            /**< @brief Every timestep was checked exactly for world and self collisions */
+  double longest_valid_joint_move;                    /**< @brief The resolution of the checks in between timesteps, 0 when they were not checked */
+  const planning_scene::PlanningScene* planning_scene; /**< @brief The scene the checks ran against */
+  Eigen::MatrixXd parameters;                         /**< @brief The parameters found valid [num_dimensions x num_timesteps] */
+};
+
+/**
+ * @brief The timesteps a cost function can assign a non zero cost to
+ */
+namespace CostSupports
+{
+enum CostSupport
+{
+  ALL_TIMESTEPS = 0,    /**< Every timestep may be costed, the costs are returned for each timestep */
+  LAST_TIMESTEP         /**< Only the last timestep of the trajectory is costed, its cost is returned in the last entry */
+};
+}
+
 /**
  * @class stomp_moveit::cost_functions::StompCostFunction
  * @brief The interface class for the STOMP cost functions.
@@ -54,7 +88,8 @@ class StompCostFunction
 {
 public:
   StompCostFunction():
-    cost_weight_(1.0)
+    cost_weight_(1.0),
+    rollout_states_(nullptr)
   {
 
   }
@@ -92,6 +127,18 @@ public:
                    moveit_msgs::MoveItErrorCodes& error_code) = 0;
 
 
+  /**
+   * @brief Creates an independent instance of this cost function so that the Task can evaluate several rollouts
+   *        concurrently, one instance per worker thread.  The Task calls setMotionPlanRequest() on the new instance
+   *        before using it, therefore only the state set by initialize() needs to be carried over.
+   * @return  A new instance or a null pointer when cloning is not supported, in which case the Task serializes the
+   *          calls to computeCosts() on this instance.
+   */
+  virtual StompCostFunctionPtr clone() const
+  {
+    return StompCostFunctionPtr();
+  }
+
   /**
    * @brief computes the state costs as a function of the parameters for each time step.
    * @param parameters        The parameter values to evaluate for state costs [num_dimensions x num_parameters]
@@ -111,6 +158,123 @@ public:
                             Eigen::VectorXd& costs,
                             bool& validity) = 0 ;
 
+  /**
+   * @brief Whether this cost function overrides computeCostsRef(), the Task is only called through its Eigen::Ref based
+   *        methods when all of its cost functions do.
+   * @return  False by default.
+   */
+  virtual bool supportsRefInterface() const
+  {
+    return false;
+  }
+
+  /**
+   * @brief Same as computeCosts() but the parameters may be a view into storage owned by the caller and the costs are
+   *        written into a view of exactly 'num_timesteps' entries.  The default implementation copies the parameters and
+   *        calls computeCosts().
+   * @param parameters        The parameter values to evaluate for state costs [num_dimensions x num_parameters]
+   * @param start_timestep    start index into the 'parameters' array, usually 0.
+   * @param num_timesteps     number of elements to use from 'parameters' starting from 'start_timestep'
+   * @param iteration_number  The current iteration count in the optimization loop
+   * @param rollout_number    index of the noisy trajectory whose cost is being evaluated.
+   * @param costs             view [num_timesteps] that receives the state costs of the evaluated timesteps.  A cost
+   *                          function of the last timestep only needs to write the last entry.
+   * @param validity          whether or not the trajectory is valid
+   * @return false if there was an irrecoverable failure, true otherwise.
+   */
+  virtual bool computeCostsRef(const Eigen::Ref<const Eigen::MatrixXd>& parameters,
+                               std::size_t start_timestep,
+                               std::size_t num_timesteps,
+                               int iteration_number,
+                               int rollout_number,
+                               Eigen::Ref<Eigen::VectorXd> costs,
+                               bool& validity)
+  {
+    Eigen::MatrixXd dense_parameters = parameters;
+    Eigen::VectorXd dense_costs;
+    if(!computeCosts(dense_parameters,start_timestep,num_timesteps,iteration_number,rollout_number,dense_costs,validity))
+    {
+      return false;
+    }
+
+    // the costs of the requested timesteps only or those of the whole trajectory may be returned
+    if(getCostSupport() == CostSupports::LAST_TIMESTEP && dense_costs.size() > 0)
+    {
+      costs(num_timesteps - 1) = dense_costs(dense_costs.size() - 1);
+    }
+    else if(dense_costs.size() == num_timesteps)
+    {
+      costs = dense_costs;
+    }
+    else if(dense_costs.size() == parameters.cols())
+    {
+      costs = dense_costs.segment(start_timestep,num_timesteps);
+    }
+    else
+    {
+      ROS_ERROR("%s returned %i costs for %i timesteps",getName().c_str(),int(dense_costs.size()),int(num_timesteps));
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   * @brief The timesteps this cost function costs.  The Task only calls computeCosts() on a cost function that costs the
+   *        last timestep when the requested range includes it, and it only reads the last entry of the returned costs,
+   *        therefore such a cost function neither needs to zero nor to fill the other entries.
+   * @return  CostSupports::ALL_TIMESTEPS by default.
+   */
+  virtual CostSupports::CostSupport getCostSupport() const
+  {
+    return CostSupports::ALL_TIMESTEPS;
+  }
+
+  /**
+   * @brief Whether this cost function implements computeCostsBatch() more efficiently than evaluating each rollout on
+   *        its own, the Task only evaluates the rollouts in batches when all of its cost functions do.
+   * @return  False by default.
+   */
+  virtual bool supportsBatchCosts() const
+  {
+    return false;
+  }
+
+  /**
+   * @brief computes the state costs of several noisy rollouts at once.  The default implementation calls computeCosts()
+   *        for each rollout, see stomp_core::computeBatchCostsPerRollout().
+   * @param parameters        The noisy parameters of every rollout stored contiguously [num_dimensions x (num_rollouts x num_parameters)],
+   *                          rollout r occupies the columns [r*num_parameters, (r+1)*num_parameters)
+   * @param start_timestep    start index into the parameters of each rollout, usually 0.
+   * @param num_timesteps     number of elements to evaluate starting from 'start_timestep'
+   * @param iteration_number  The current iteration count in the optimization loop
+   * @param num_rollouts      The number of rollouts stored in 'parameters'
+   * @param costs             matrix [num_rollouts x num_timesteps] that receives the state costs of each rollout per timestep.
+   * @param validities        whether or not each trajectory is valid
+   * @return false if there was an irrecoverable failure, true otherwise.
+   */
+  virtual bool computeCostsBatch(const Eigen::MatrixXd& parameters,
+                                 std::size_t start_timestep,
+                                 std::size_t num_timesteps,
+                                 int iteration_number,
+                                 int num_rollouts,
+                                 Eigen::MatrixXd& costs,
+                                 std::vector<bool>& validities)
+  {
+    auto compute = [&](const Eigen::MatrixXd& rollout_parameters,int rollout,Eigen::VectorXd& rollout_costs,bool& valid)
+    {
+      return computeCosts(rollout_parameters,start_timestep,num_timesteps,iteration_number,rollout,rollout_costs,valid);
+    };
+    if(!stomp_core::computeBatchCostsPerRollout(parameters,start_timestep,num_timesteps,num_rollouts,compute,costs,
+                                                validities))
+    {
+      ROS_ERROR("%s failed to compute the costs of %i rollouts from %i columns of parameters, or returned costs of the "
+                "wrong size",getName().c_str(),num_rollouts,int(parameters.cols()));
+      return false;
+    }
+
+    return true;
+  }
+
   /**
    * @brief Called by STOMP at the end of each iteration.
    * @param start_timestep    The start index into the 'parameters' array, usually 0.
@@ -132,6 +296,17 @@ public:
    */
   virtual void done(bool success,int total_iterations,double final_cost,const Eigen::MatrixXd& parameters){}
 
+  /**
+   * @brief Reports the checks that found the last optimized parameters (see getOptimizedIndex()) evaluated by
+   *        computeCosts() valid.
+   * @param certificate Returns the checks and the parameters they cover
+   * @return False when the last optimized parameters were invalid or this cost function certifies nothing, the default.
+   */
+  virtual bool getValidityCertificate(ValidityCertificate& certificate) const
+  {
+    return false;
+  }
+
 
   virtual std::string getGroupName() const
   {
@@ -158,10 +333,45 @@ public:
     return -1;
   }
 
+  /**
+   * @brief Hands the robot states of the rollout being evaluated, the Task sets them before each call to computeCosts()
+   *        from the thread that makes the call.  The cost functions obtain their states through getTimestepState() so
+   *        that the forward kinematics of a timestep are computed once for all of them.
+   * @param states  The states of the calling worker or null when none are shared
+   */
+  void setRolloutStates(utils::RolloutStates* states)
+  {
+    rollout_states_ = states;
+  }
+
 
 protected:
 
+  /**
+   * @brief Returns the state of the robot at a timestep of the parameters with its forward kinematics computed.  The
+   *        state shared by the Task is returned when available, otherwise the joint values are set on 'state'.
+   * @param parameters  The parameters [num_dimensions x num_timesteps]
+   * @param t           The timestep
+   * @param joint_group The planning group of the parameters
+   * @param state       The state updated when no shared state is available
+   * @return The up to date state
+   */
+  const moveit::core::RobotState& getTimestepState(const Eigen::Ref<const Eigen::MatrixXd>& parameters, std::size_t t,
+                                                   const moveit::core::JointModelGroup* joint_group,
+                                                   moveit::core::RobotState& state)
+  {
+    if(rollout_states_ && t < rollout_states_->size())
+    {
+      return rollout_states_->getState(t,parameters.col(t));
+    }
+
+    state.setJointGroupPositions(joint_group,parameters.col(t));
+    state.update();
+    return state;
+  }
+
   double cost_weight_;
+  utils::RolloutStates* rollout_states_;    /**< The states shared by the Task for the current call, null if none */
 
 };
 
@@ -0,0 +1,154 @@
+/**
+ * @file adaptive_covariance_sampling.h
+ * @brief This is a noisy trajectory generator that adapts its covariance to the updates of the optimization
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef INDUSTRIAL_MOVEIT_STOMP_MOVEIT_INCLUDE_STOMP_MOVEIT_NOISE_GENERATORS_ADAPTIVE_COVARIANCE_SAMPLING_H_
+#define INDUSTRIAL_MOVEIT_STOMP_MOVEIT_INCLUDE_STOMP_MOVEIT_NOISE_GENERATORS_ADAPTIVE_COVARIANCE_SAMPLING_H_
+
+#include <stomp_moveit/noise_generators/stomp_noise_generator.h>
+#include <stomp_moveit/utils/random.h>
+
+namespace stomp_moveit
+{
+
+namespace noise_generators
+{
+
+/**
+ * @class stomp_moveit::noise_generators::AdaptiveCovarianceSampling
+ * @brief Samples the noise of each joint from a covariance over the timesteps that adapts to the updates of the
+ * optimization, in the spirit of PI^2-CMA.  The covariance starts at the acceleration penalizing distribution used by
+ * NormalDistributionSampling.  After each iteration the parameter update, i.e. the probability weighted average of the
+ * noise, is accumulated into an evolution path and the covariance learns its direction through a rank-one update of
+ * its cholesky factor while the decaying acceleration penalizing prior keeps it smooth and full rank.  The amplitude of each joint grows while the path
+ * is longer than the average update, the updates point in a consistent direction, and shrinks while they cancel out.
+ *
+ * @par Examples:
+ * All examples are located here @ref stomp_moveit_examples
+ */
+class AdaptiveCovarianceSampling: public StompNoiseGenerator
+{
+public:
+  AdaptiveCovarianceSampling();
+  virtual ~AdaptiveCovarianceSampling();
+
+  /** @brief see base class for documentation*/
+  virtual bool initialize(moveit::core::RobotModelConstPtr robot_model_ptr,
+                          const std::string& group_name,const XmlRpc::XmlRpcValue& config) override;
+
+  /** @brief see base class for documentation*/
+  virtual bool configure(const XmlRpc::XmlRpcValue& config) override;
+
+  /** @brief see base class for documentation*/
+  virtual bool setMotionPlanRequest(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                   const moveit_msgs::MotionPlanRequest &req,
+                   const stomp_core::StompConfiguration &config,
+                   moveit_msgs::MoveItErrorCodes& error_code) override;
+
+  /**
+   * @brief Generates a noisy trajectory from the parameters.
+   * @param parameters        The current value of the optimized parameters to add noise to [num_dimensions x num_parameters]
+   * @param start_timestep    start index into the 'parameters' array, usually 0.
+   * @param num_timesteps     number of elements to use from 'parameters' starting from 'start_timestep'
+   * @param iteration_number  The current iteration count in the optimization loop
+   * @param rollout_number    index of the noisy trajectory.
+   * @param parameters_noise  the parameters + noise
+   * @param noise             the noise applied to the parameters
+   * @return true if cost were properly computed
+   */
+  virtual bool generateNoise(const Eigen::MatrixXd& parameters,
+                                       std::size_t start_timestep,
+                                       std::size_t num_timesteps,
+                                       int iteration_number,
+                                       int rollout_number,
+                                       Eigen::MatrixXd& parameters_noise,
+                                       Eigen::MatrixXd& noise) override;
+
+  /**
+   * @brief Adapts the covariance and the amplitude of the noise of each joint to the update of the parameters made by
+   * the iteration.
+   * @param start_timestep    The start index into the 'parameters' array, usually 0.
+   * @param num_timesteps     The number of elements to use from 'parameters' starting from 'start_timestep'
+   * @param iteration_number  The current iteration count in the optimization loop
+   * @param cost              The cost value for the current parameters.
+   * @param parameters        The value of the parameters at the end of the current iteration [num_dimensions x num_timesteps].
+   */
+  virtual void postIteration(std::size_t start_timestep,
+                             std::size_t num_timesteps,int iteration_number,double cost,const Eigen::MatrixXd& parameters) override;
+
+  virtual std::string getName() const
+  {
+    return name_ + "/" + group_;
+  }
+
+
+  virtual std::string getGroupName() const
+  {
+    return group_;
+  }
+
+protected:
+
+  /**
+   * @brief Mixes the rank-one update of the evolution path of a joint into the cholesky factor of its covariance in
+   * O(num_timesteps^2)
+   * @param d The joint index
+   * @return True if the factor was updated, otherwise it is reset to the prior and false is returned.
+   */
+  bool updateCovariance(std::size_t d);
+
+protected:
+
+  // names
+  std::string name_;
+  std::string group_;
+
+  // parameters
+  std::vector<double> stddev_;               /**< @brief The initial amplitude of the noise of each joint */
+  std::vector<double> min_stddev_;           /**< @brief The lower bound of the amplitude of each joint */
+  std::vector<double> max_stddev_;           /**< @brief The upper bound of the amplitude of each joint */
+  double learning_rate_;                     /**< @brief The weight of the rank-one update of the covariance */
+  double path_rate_;                         /**< @brief The rate at which the evolution path forgets older updates */
+  double stddev_damping_;                    /**< @brief Damps the change of the amplitude per iteration */
+
+  // adapted distribution
+  Eigen::MatrixXd prior_;                    /**< @brief The acceleration penalizing covariance [num_timesteps][num_timesteps] */
+  Eigen::MatrixXd prior_cholesky_;           /**< @brief The lower cholesky factor of the prior */
+  std::vector<Eigen::MatrixXd> cholesky_;    /**< @brief The lower cholesky factor of the covariance of each joint */
+  std::vector<Eigen::VectorXd> path_;        /**< @brief The evolution path of each joint [num_timesteps] */
+  std::vector<double> mean_update_;          /**< @brief The running average of the squared norm of the updates */
+  std::vector<double> current_stddev_;       /**< @brief The adapted amplitude of the noise of each joint */
+  Eigen::MatrixXd previous_parameters_;      /**< @brief The parameters at the end of the previous iteration */
+
+  // sampling
+  std::vector<Eigen::MatrixXd> raw_noise_;   /**< @brief The standard normal values of a rollout [num_timesteps][num_dimensions]
+                                                  per worker thread, see stomp_core::ThreadPool::getWorkerIndex() */
+  int seed_;                                 /**< @brief The seed of the random streams, see StompConfiguration::seed */
+
+};
+
+} /* namespace noise_generators */
+} /* namespace stomp_moveit */
+
+#endif /* INDUSTRIAL_MOVEIT_STOMP_MOVEIT_INCLUDE_STOMP_MOVEIT_NOISE_GENERATORS_ADAPTIVE_COVARIANCE_SAMPLING_H_ */
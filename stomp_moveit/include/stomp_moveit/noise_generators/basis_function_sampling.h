@@ -0,0 +1,118 @@
+/**
+ * @file basis_function_sampling.h
+ * @brief This is a noisy trajectory generator that samples smooth noise in a low dimensional basis
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef INDUSTRIAL_MOVEIT_STOMP_MOVEIT_INCLUDE_STOMP_MOVEIT_NOISE_GENERATORS_BASIS_FUNCTION_SAMPLING_H_
+#define INDUSTRIAL_MOVEIT_STOMP_MOVEIT_INCLUDE_STOMP_MOVEIT_NOISE_GENERATORS_BASIS_FUNCTION_SAMPLING_H_
+
+#include <stomp_moveit/noise_generators/stomp_noise_generator.h>
+#include <stomp_moveit/utils/random.h>
+
+namespace stomp_moveit
+{
+
+namespace noise_generators
+{
+
+/**
+ * @class stomp_moveit::noise_generators::BasisFunctionSampling
+ * @brief Samples smooth noise as a weighted sum of a few sine basis functions per joint.  The sines are the eigenvectors
+ * of the finite difference acceleration operator, weighting the k-th one by 1/k^2 truncates the expansion of the
+ * acceleration penalizing distribution used by NormalDistributionSampling to its smoothest components.  Each rollout only
+ * needs num_basis_functions random values per joint, the noise vanishes at the start and the goal.
+ *
+ * @par Examples:
+ * All examples are located here @ref stomp_moveit_examples
+ */
+class BasisFunctionSampling: public StompNoiseGenerator
+{
+public:
+  BasisFunctionSampling();
+  virtual ~BasisFunctionSampling();
+
+  /** @brief see base class for documentation*/
+  virtual bool initialize(moveit::core::RobotModelConstPtr robot_model_ptr,
+                          const std::string& group_name,const XmlRpc::XmlRpcValue& config) override;
+
+  /** @brief see base class for documentation*/
+  virtual bool configure(const XmlRpc::XmlRpcValue& config) override;
+
+  /** @brief see base class for documentation*/
+  virtual bool setMotionPlanRequest(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                   const moveit_msgs::MotionPlanRequest &req,
+                   const stomp_core::StompConfiguration &config,
+                   moveit_msgs::MoveItErrorCodes& error_code) override;
+
+  /**
+   * @brief Generates a noisy trajectory from the parameters.
+   * @param parameters        The current value of the optimized parameters to add noise to [num_dimensions x num_parameters]
+   * @param start_timestep    start index into the 'parameters' array, usually 0.
+   * @param num_timesteps     number of elements to use from 'parameters' starting from 'start_timestep'
+   * @param iteration_number  The current iteration count in the optimization loop
+   * @param rollout_number    index of the noisy trajectory.
+   * @param parameters_noise  the parameters + noise
+   * @param noise             the noise applied to the parameters
+   * @return true if cost were properly computed
+   */
+  virtual bool generateNoise(const Eigen::MatrixXd& parameters,
+                                       std::size_t start_timestep,
+                                       std::size_t num_timesteps,
+                                       int iteration_number,
+                                       int rollout_number,
+                                       Eigen::MatrixXd& parameters_noise,
+                                       Eigen::MatrixXd& noise) override;
+
+  virtual std::string getName() const
+  {
+    return name_ + "/" + group_;
+  }
+
+
+  virtual std::string getGroupName() const
+  {
+    return group_;
+  }
+
+protected:
+
+  // names
+  std::string name_;
+  std::string group_;
+
+  // parameters
+  std::vector<double> stddev_;               /**< @brief The amplitude of the noise of each joint */
+  int num_basis_functions_;                  /**< @brief The number of basis functions per joint */
+
+  // sampling
+  Eigen::MatrixXd basis_;                    /**< @brief The weighted basis functions [num_basis_functions][num_timesteps] */
+  std::vector<Eigen::MatrixXd> coefficients_; /**< @brief The coefficients of a rollout [num_dimensions][num_basis_functions]
+                                                  per worker thread, see stomp_core::ThreadPool::getWorkerIndex() */
+  int seed_;                                 /**< @brief The seed of the random streams, see StompConfiguration::seed */
+
+};
+
+} /* namespace noise_generators */
+} /* namespace stomp_moveit */
+
+#endif /* INDUSTRIAL_MOVEIT_STOMP_MOVEIT_INCLUDE_STOMP_MOVEIT_NOISE_GENERATORS_BASIS_FUNCTION_SAMPLING_H_ */
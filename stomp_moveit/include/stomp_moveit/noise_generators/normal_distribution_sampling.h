@@ -26,6 +26,7 @@
 #ifndef INDUSTRIAL_MOVEIT_STOMP_MOVEIT_INCLUDE_STOMP_MOVEIT_NOISE_GENERATORS_NORMAL_DISTRIBUTION_SAMPLING_H_
 #define INDUSTRIAL_MOVEIT_STOMP_MOVEIT_INCLUDE_STOMP_MOVEIT_NOISE_GENERATORS_NORMAL_DISTRIBUTION_SAMPLING_H_
 
+#include <mutex>
 #include <stomp_moveit/noise_generators/stomp_noise_generator.h>
 #include <stomp_moveit/utils/multivariate_gaussian.h>
 
@@ -80,6 +81,18 @@ public:
                                        Eigen::MatrixXd& parameters_noise,
                                        Eigen::MatrixXd& noise) override;
 
+  /**
+   * @brief Anneals the standard deviation of the noise from the cost history when 'update_rate' is configured.  It shrinks
+   * towards 'min_stddev' as the cost converges and grows back towards 'stddev' while the cost does not improve.
+   * @param start_timestep    The start index into the 'parameters' array, usually 0.
+   * @param num_timesteps     The number of elements to use from 'parameters' starting from 'start_timestep'
+   * @param iteration_number  The current iteration count in the optimization loop
+   * @param cost              The cost value for the current parameters.
+   * @param parameters        The value of the parameters at the end of the current iteration [num_dimensions x num_timesteps].
+   */
+  virtual void postIteration(std::size_t start_timestep,
+                             std::size_t num_timesteps,int iteration_number,double cost,const Eigen::MatrixXd& parameters) override;
+
   /**
    * @brief Called by the Stomp at the end of the optimization process
    *
@@ -102,6 +115,13 @@ public:
     return group_;
   }
 
+protected:
+
+  /**
+   * @brief Gives the generator of each dimension its own seed derived from the configured seed
+   */
+  void updateSeeds();
+
 protected:
 
   // names
@@ -113,6 +133,19 @@ protected:
   Eigen::VectorXd raw_noise_;
   std::vector<double> stddev_;
 
+  // noise annealing, disabled when the update rate is 0
+  std::vector<double> current_stddev_;       /**< @brief The annealed standard deviation of each joint */
+  std::vector<double> min_stddev_;           /**< @brief The lower bound of the annealed standard deviation of each joint */
+  double update_rate_;                       /**< @brief The fraction by which the standard deviation changes per iteration */
+  double previous_cost_;                     /**< @brief The cost at the end of the previous iteration */
+
+  // the noise of all the rollouts of an iteration is sampled at once
+  std::vector<Eigen::MatrixXd> batch_noise_;  /**< @brief Per dimension matrix [timesteps][rollouts] of raw noise */
+  int batch_iteration_;                      /**< @brief The iteration the batch was sampled for */
+  int batch_size_;                           /**< @brief The number of rollouts sampled per batch */
+  int seed_;                                 /**< @brief The seed of the random streams, see StompConfiguration::seed */
+  std::mutex batch_mutex_;                   /**< @brief Guards the batch, rollouts are generated concurrently */
+
 };
 
 } /* namespace noise_generators */
@@ -87,7 +87,8 @@ public:
                    moveit_msgs::MoveItErrorCodes& error_code) = 0;
 
   /**
-   * @brief Generates a noisy trajectory from the parameters.
+   * @brief Generates a noisy trajectory from the parameters.  The rollouts of an iteration are generated concurrently,
+   * therefore this method must be thread-safe.
    * @param parameters        The current value of the optimized parameters to add noise to [num_dimensions x num_parameters]
    * @param start_timestep    start index into the 'parameters' array, usually 0.
    * @param num_timesteps     number of elements to use from 'parameters' starting from 'start_timestep'
@@ -105,6 +106,50 @@ public:
                                        Eigen::MatrixXd& parameters_noise,
                                        Eigen::MatrixXd& noise) = 0;
 
+  /**
+   * @brief Whether this noise generator overrides generateNoiseRef()
+   * @return  False by default.
+   */
+  virtual bool supportsRefInterface() const
+  {
+    return false;
+  }
+
+  /**
+   * @brief Same as generateNoise() but only the window [start_timestep, start_timestep + num_timesteps) is written into
+   *        views owned by the caller.  This method must be thread-safe.  The default implementation copies the
+   *        parameters and calls generateNoise().
+   * @param parameters        The current value of the optimized parameters to add noise to [num_dimensions x num_parameters]
+   * @param start_timestep    start index into the 'parameters' array, usually 0.
+   * @param num_timesteps     number of elements to use from 'parameters' starting from 'start_timestep'
+   * @param iteration_number  The current iteration count in the optimization loop
+   * @param rollout_number    index of the noisy trajectory.
+   * @param parameters_noise  view [num_dimensions x num_timesteps] that receives the parameters + noise of the window
+   * @param noise             view [num_dimensions x num_timesteps] that receives the noise of the window
+   * @return false if there was an irrecoverable failure, true otherwise.
+   */
+  virtual bool generateNoiseRef(const Eigen::Ref<const Eigen::MatrixXd>& parameters,
+                                std::size_t start_timestep,
+                                std::size_t num_timesteps,
+                                int iteration_number,
+                                int rollout_number,
+                                Eigen::Ref<Eigen::MatrixXd> parameters_noise,
+                                Eigen::Ref<Eigen::MatrixXd> noise)
+  {
+    Eigen::MatrixXd dense_parameters = parameters;
+    Eigen::MatrixXd dense_parameters_noise = dense_parameters;
+    Eigen::MatrixXd dense_noise = Eigen::MatrixXd::Zero(parameters.rows(),parameters.cols());
+    if(!generateNoise(dense_parameters,start_timestep,num_timesteps,iteration_number,rollout_number,
+                      dense_parameters_noise,dense_noise))
+    {
+      return false;
+    }
+
+    parameters_noise = dense_parameters_noise.middleCols(start_timestep,num_timesteps);
+    noise = dense_noise.middleCols(start_timestep,num_timesteps);
+    return true;
+  }
+
   /**
    * @brief Called by STOMP at the end of each iteration.
    * @param start_timestep    The start index into the 'parameters' array, usually 0.
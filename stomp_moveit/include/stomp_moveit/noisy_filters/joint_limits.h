@@ -104,6 +104,13 @@ protected:
   moveit::core::RobotStatePtr start_state_;
   moveit::core::RobotStatePtr goal_state_;
 
+  // cached joint properties
+  std::vector<const moveit::core::JointModel*> joint_models_;   /**< @brief The active joints of the group */
+  std::vector<int> special_joints_;                             /**< @brief Indices of the joints whose bounds aren't a plain interval, e.g. continuous joints */
+  Eigen::ArrayXd min_positions_;                                /**< @brief The lower position bound of every joint, -inf for the special joints */
+  Eigen::ArrayXd max_positions_;                                /**< @brief The upper position bound of every joint, +inf for the special joints */
+  Eigen::VectorXd start_positions_;                             /**< @brief The joint positions of the start state */
+  Eigen::VectorXd goal_positions_;                              /**< @brief The joint positions of the goal state */
 
 };
 
@@ -26,12 +26,16 @@
 #ifndef INDUSTRIAL_MOVEIT_STOMP_MOVEIT_INCLUDE_STOMP_MOVEIT_NOISY_FILTERS_MULTI_TRAJECTORY_VISUALIZATION_H_
 #define INDUSTRIAL_MOVEIT_STOMP_MOVEIT_INCLUDE_STOMP_MOVEIT_NOISY_FILTERS_MULTI_TRAJECTORY_VISUALIZATION_H_
 
+#include <atomic>
+#include <chrono>
+#include <mutex>
 #include <ros/node_handle.h>
 #include <ros/publisher.h>
 #include <Eigen/Core>
 #include <visualization_msgs/MarkerArray.h>
 #include <geometry_msgs/Point.h>
 #include <stomp_moveit/noisy_filters/stomp_noisy_filter.h>
+#include <stomp_moveit/utils/background_worker.h>
 
 namespace stomp_moveit
 {
@@ -40,7 +44,9 @@ namespace noisy_filters
 
 /**
  * @class stomp_moveit::noisy_filters::MultiTrajectoryVisualization
- * @brief Publishes rviz markers to visualize the noisy trajectories
+ * @brief Publishes rviz markers to visualize the noisy trajectories.  The noisy parameters are only copied while the marker
+ * topic has subscribers and at most at the configured rate, the forward kinematics and the messages are computed by a
+ * background thread.
  *
  * @par Examples:
  * All examples are located here @ref stomp_moveit_examples
@@ -66,7 +72,7 @@ public:
                    moveit_msgs::MoveItErrorCodes& error_code) override;
 
   /**
-   * @brief Creates rviz markers for visualizing the noisy trajectories, it does not change the parameters.
+   * @brief Stores a copy of the noisy trajectories when the iteration is published, it does not change the parameters.
    *
    * @param start_timestep    Start index into the 'parameters' array, usually 0.
    * @param num_timesteps     Number of elements to use from 'parameters' starting from 'start_timestep'
@@ -83,6 +89,18 @@ public:
                       Eigen::MatrixXd& parameters,
                       bool& filtered) override;
 
+  /**
+   * @brief Hands the noisy trajectories collected during the iteration off to the publisher thread.
+   * @param start_timestep    The start index into the 'parameters' array, usually 0.
+   * @param num_timesteps     The number of elements to use from 'parameters' starting from 'start_timestep'
+   * @param iteration_number  The current iteration count in the optimization loop
+   * @param cost              The cost value for the current parameters.
+   * @param parameters        The value of the parameters at the end of the current iteration [num_dimensions x num_timesteps].
+   */
+  virtual void postIteration(std::size_t start_timestep,
+                             std::size_t num_timesteps,int iteration_number,double cost,
+                             const Eigen::MatrixXd& parameters) override;
+
 
   virtual std::string getName() const override
   {
@@ -96,6 +114,16 @@ public:
 
 protected:
 
+  /** @brief Whether the next iteration should be published, depends on the subscribers and the publish rate */
+  bool shouldPublish() const;
+
+  /**
+   * @brief Computes the tool path of the rollouts and publishes their markers, runs on the publisher thread.
+   * @param rollouts    The indices of the rollouts
+   * @param parameters  The parameters of each rollout
+   */
+  void publishMarkers(const std::vector<int>& rollouts,const std::vector<Eigen::MatrixXd>& parameters);
+
   // identity
   std::string name_;
 
@@ -113,12 +141,21 @@ protected:
   std_msgs::ColorRGBA rgb_;
   std::string marker_topic_;
   std::string marker_namespace_;
+  double publish_rate_;                                   /**< @brief The maximum rate in Hz, 0 publishes every iteration */
 
-  // tool trajectory
+  // tool trajectory, only used by the publisher thread
   std::size_t traj_total_;
   Eigen::MatrixXd tool_traj_line_;
   visualization_msgs::MarkerArray tool_traj_markers_;
   visualization_msgs::MarkerArray tool_points_markers_;
+
+  // noisy parameters collected during the iteration, the rollouts are filtered concurrently
+  std::mutex markers_mutex_;
+  std::atomic<bool> capturing_;                           /**< @brief Whether the current iteration is collected */
+  std::chrono::steady_clock::time_point last_publish_;    /**< @brief When the last iteration was handed off */
+  std::vector<Eigen::MatrixXd> rollout_parameters_;       /**< @brief The copy of the noisy parameters of each rollout */
+  std::vector<char> captured_;                            /**< @brief Whether each rollout was copied during the iteration */
+  utils::BackgroundWorker publisher_;                     /**< @brief Computes and publishes the markers */
 };
 
 } /* namespace filters */
@@ -88,7 +88,8 @@ public:
                    moveit_msgs::MoveItErrorCodes& error_code) = 0;
 
   /**
-   * @brief Applies a filtering method to the parameters which may modify the original values
+   * @brief Applies a filtering method to the parameters which may modify the original values.  The rollouts of an
+   * iteration are filtered concurrently, therefore this method must be thread-safe.
    *
    * @param start_timestep    Start index into the 'parameters' array, usually 0.
    * @param num_timesteps     Number of elements to use from 'parameters' starting from 'start_timestep'
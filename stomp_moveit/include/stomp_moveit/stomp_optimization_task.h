@@ -27,6 +27,7 @@
 #define INDUSTRIAL_MOVEIT_STOMP_MOVEIT_INCLUDE_STOMP_MOVEIT_STOMP_OPTIMIZATION_TASK_H_
 
 #include <memory>
+#include <mutex>
 #include <moveit_msgs/MotionPlanRequest.h>
 #include <moveit/robot_model/robot_model.h>
 #include <stomp_core/task.h>
@@ -36,6 +37,7 @@
 #include <stomp_moveit/noise_generators/stomp_noise_generator.h>
 #include <stomp_moveit/noisy_filters/stomp_noisy_filter.h>
 #include <stomp_moveit/update_filters/stomp_update_filter.h>
+#include <stomp_moveit/utils/plugin_profiler.h>
 
 
 namespace stomp_moveit
@@ -87,6 +89,7 @@ public:
 
   /**
    * @brief Generates a noisy trajectory from the parameters by calling the active Noise Generator plugin.
+   *        This method is thread-safe as long as the Noise Generator plugin is.
    * @param parameters        [num_dimensions] x [num_parameters] the current value of the optimized parameters
    * @param start_timestep    start index into the 'parameters' array, usually 0.
    * @param num_timesteps     number of elements to use from 'parameters' starting from 'start_timestep'
@@ -106,6 +109,7 @@ public:
 
   /**
    * @brief computes the state costs as a function of the noisy parameters for each time step. It does this by calling the loaded Cost Function plugins
+   *        This method is thread-safe, each worker thread evaluates its own clone of the cost function plugins.
    * @param parameters [num_dimensions] num_parameters - policy parameters to execute
    * @param start_timestep    start index into the 'parameters' array, usually 0.
    * @param num_timesteps     number of elements to use from 'parameters' starting from 'start_timestep'
@@ -123,8 +127,36 @@ public:
                        Eigen::VectorXd& costs,
                        bool& validity) override;
 
+  /**
+   * @brief Whether all the loaded Cost Function plugins evaluate rollouts in batches
+   * @return  True when every Cost Function plugin supports batches, false otherwise.
+   */
+  virtual bool supportsBatchCosts() const override;
+
+  /**
+   * @brief computes the state costs of all the noisy rollouts of an iteration at once by calling the batch method of the
+   *        loaded Cost Function plugins.
+   * @param parameters        [num_dimensions] x [num_rollouts x num_parameters] the noisy parameters of every rollout
+   * @param start_timestep    start index into the parameters of each rollout, usually 0.
+   * @param num_timesteps     number of elements to evaluate starting from 'start_timestep'
+   * @param iteration_number  The current iteration count in the optimization loop
+   * @param num_rollouts      The number of rollouts stored in 'parameters'
+   * @param costs             [num_rollouts] x [num_timesteps] matrix that receives the state costs of each rollout.
+   * @param validities        whether or not each trajectory is valid
+   * @return  false if there was an irrecoverable failure, true otherwise.
+   */
+  virtual bool computeNoisyCostsBatch(const Eigen::MatrixXd& parameters,
+                                      std::size_t start_timestep,
+                                      std::size_t num_timesteps,
+                                      int iteration_number,
+                                      int num_rollouts,
+                                      Eigen::MatrixXd& costs,
+                                      std::vector<bool>& validities) override;
+
   /**
    * @brief computes the state costs as a function of the optimized parameters for each time step. It does this by calling the loaded Cost Function plugins
+   *        The result is memoized, a repeated query of the same timesteps of identical parameters within an iteration
+   *        returns the previous costs and validity without calling the plugins.
    * @param parameters        [num_dimensions] num_parameters - policy parameters to execute
    * @param start_timestep    start index into the 'parameters' array, usually 0.
    * @param num_timesteps     number of elements to use from 'parameters' starting from 'start_timestep'
@@ -140,9 +172,73 @@ public:
                        Eigen::VectorXd& costs,
                        bool& validity) override;
 
+  /**
+   * @brief Whether the active Noise Generator plugin and all the loaded Cost Function plugins override their Eigen::Ref
+   *        based methods
+   * @return  True when they all do, false otherwise.
+   */
+  virtual bool supportsRefInterface() const override;
+
+  /**
+   * @brief Same as generateNoisyParameters() but only the window is written into views owned by the caller, see
+   *        stomp_core::Task::generateNoisyParametersRef().
+   * @param parameters        [num_dimensions] x [num_parameters] the current value of the optimized parameters
+   * @param start_timestep    start index into the 'parameters' array, usually 0.
+   * @param num_timesteps     number of elements to use from 'parameters' starting from 'start_timestep'
+   * @param iteration_number  The current iteration count in the optimization loop
+   * @param rollout_number    index of the noisy trajectory.
+   * @param parameters_noise  [num_dimensions] x [num_timesteps] view that receives the parameters + noise of the window
+   * @param noise             [num_dimensions] x [num_timesteps] view that receives the noise of the window
+   * @return  false if there was an irrecoverable failure, true otherwise.
+   */
+  virtual bool generateNoisyParametersRef(const Eigen::Ref<const Eigen::MatrixXd>& parameters,
+                                          std::size_t start_timestep,
+                                          std::size_t num_timesteps,
+                                          int iteration_number,
+                                          int rollout_number,
+                                          Eigen::Ref<Eigen::MatrixXd> parameters_noise,
+                                          Eigen::Ref<Eigen::MatrixXd> noise) override;
+
+  /**
+   * @brief Same as computeNoisyCosts() but the costs are written into a view of exactly 'num_timesteps' entries.
+   * @param parameters        [num_dimensions] num_parameters - policy parameters to execute
+   * @param start_timestep    start index into the 'parameters' array, usually 0.
+   * @param num_timesteps     number of elements to use from 'parameters' starting from 'start_timestep'
+   * @param iteration_number  The current iteration count in the optimization loop
+   * @param rollout_number    index of the noisy trajectory whose cost is being evaluated.
+   * @param costs             [num_timesteps] view that receives the state costs of the evaluated timesteps.
+   * @param validity          whether or not the trajectory is valid
+   * @return  false if there was an irrecoverable failure, true otherwise.
+   */
+  virtual bool computeNoisyCostsRef(const Eigen::Ref<const Eigen::MatrixXd>& parameters,
+                                    std::size_t start_timestep,
+                                    std::size_t num_timesteps,
+                                    int iteration_number,
+                                    int rollout_number,
+                                    Eigen::Ref<Eigen::VectorXd> costs,
+                                    bool& validity) override;
+
+  /**
+   * @brief Same as computeCosts() but the costs are written into a view of exactly 'num_timesteps' entries.
+   * @param parameters        [num_dimensions] num_parameters - policy parameters to execute
+   * @param start_timestep    start index into the 'parameters' array, usually 0.
+   * @param num_timesteps     number of elements to use from 'parameters' starting from 'start_timestep'
+   * @param iteration_number  The current iteration count in the optimization loop
+   * @param costs             [num_timesteps] view that receives the state costs of the evaluated timesteps.
+   * @param validity          whether or not the trajectory is valid
+   * @return  false if there was an irrecoverable failure, true otherwise.
+   */
+  virtual bool computeCostsRef(const Eigen::Ref<const Eigen::MatrixXd>& parameters,
+                               std::size_t start_timestep,
+                               std::size_t num_timesteps,
+                               int iteration_number,
+                               Eigen::Ref<Eigen::VectorXd> costs,
+                               bool& validity) override;
+
   /**
    * @brief Filters the given noisy parameters which is applied after noisy trajectory generation. It could be used for clipping
    * of joint limits or projecting into the null space of the Jacobian.  It accomplishes this by calling the loaded Noisy Filter plugins.
+   * This method is thread-safe as long as the Noisy Filter plugins are.
    *
    * @param start_timestep    start index into the 'parameters' array, usually 0.
    * @param num_timesteps     number of elements to use from 'parameters' starting from 'start_timestep'
@@ -196,6 +292,86 @@ public:
    * @param parameters        The parameters generated at the end of current iteration[num_dimensions x num_timesteps]
    */
   virtual void done(bool success,int total_iterations,double final_cost,const Eigen::MatrixXd& parameters) override;
+  using stomp_core::Task::done;
+
+  /**
+   * @brief The time spent in each plugin since the last motion plan request.  It must not be read while optimizing.
+   * @return The profiler of the cost functions, noisy filters, update filters and the active noise generator
+   */
+  const utils::PluginProfiler& getProfiler() const
+  {
+    return profiler_;
+  }
+
+  /**
+   * @brief Finds a cost function that certified exactly the given parameters in its last evaluation of the optimized
+   *        parameters.  It must not be called while optimizing.
+   * @param parameters  The parameters to look for [num_dimensions x num_timesteps]
+   * @param certificate Returns the certificate of the first cost function that covers them
+   * @return True if a certificate was found, otherwise false.
+   */
+  bool getValidityCertificate(const Eigen::MatrixXd& parameters,cost_functions::ValidityCertificate& certificate) const;
+
+protected:
+
+  /**
+   * @brief Creates one set of cost functions per worker thread so that computeNoisyCosts can be called concurrently.
+   *        Cost functions that do not support cloning are shared among the workers and guarded by a lock.
+   * @param num_threads The number of threads that will evaluate the noisy rollouts.
+   */
+  void allocateWorkerCostFunctions(std::size_t num_threads);
+
+  /**
+   * @brief Computes the costs of the optimized parameters or returns those of the previous identical query, see
+   *        computeCosts().  The plugins are called through their Eigen::Ref based methods when 'parameters' is a view.
+   * @param parameters        [num_dimensions] num_parameters - policy parameters to execute
+   * @param start_timestep    start index into the 'parameters' array, usually 0.
+   * @param num_timesteps     number of elements to use from 'parameters' starting from 'start_timestep'
+   * @param iteration_number  The current iteration count in the optimization loop
+   * @param costs             vector or view containing the state costs per timestep.
+   * @param validity          whether or not the trajectory is valid
+   * @return  false if there was an irrecoverable failure, true otherwise.
+   */
+  template<typename Parameters,typename Costs>
+  bool computeMemoizedCosts(const Parameters& parameters,
+                            std::size_t start_timestep,
+                            std::size_t num_timesteps,
+                            int iteration_number,
+                            Costs& costs,
+                            bool& validity);
+
+  /**
+   * @brief Computes the weighted sum of the state costs produced by the given cost functions.  The plugins are called
+   *        through their Eigen::Ref based methods when 'parameters' is a view.
+   * @param cost_functions    The cost function instances owned by the calling thread
+   * @param parameters        [num_dimensions] num_parameters - policy parameters to execute
+   * @param start_timestep    start index into the 'parameters' array, usually 0.
+   * @param num_timesteps     number of elements to use from 'parameters' starting from 'start_timestep'
+   * @param iteration_number  The current iteration count in the optimization loop
+   * @param rollout_number    index of the noisy trajectory, a negative value indicates the optimized parameters.
+   * @param worker            The calling thread whose robot states and workspace are used
+   * @param costs             vector or view containing the state costs per timestep.
+   * @param validity          whether or not the trajectory is valid, a noisy trajectory rejected by the cost cascade is
+   *                          invalid and its costs are those of the cost functions evaluated so far.
+   * @return  false if there was an irrecoverable failure, true otherwise.
+   */
+  template<typename Parameters,typename Costs>
+  bool computeCostFunctionsCosts(const std::vector<cost_functions::StompCostFunctionPtr>& cost_functions,
+                                 const Parameters& parameters,
+                                 std::size_t start_timestep,
+                                 std::size_t num_timesteps,
+                                 int iteration_number,
+                                 int rollout_number,
+                                 std::size_t worker,
+                                 Costs& costs,
+                                 bool& validity);
+
+  /**
+   * @brief Orders the cost functions from the cheapest to the most expensive one and computes the mean state cost above
+   *        which the noisy trajectories of the next iteration are rejected, from the range of the mean state costs of
+   *        those of the current iteration.  It must not be called while optimizing.
+   */
+  void updateCostCascade();
 
 protected:
 
@@ -215,6 +391,35 @@ protected:
   std::vector<noisy_filters::StompNoisyFilterPtr> noisy_filters_;
   std::vector<update_filters::StompUpdateFilterPtr> update_filters_;
   std::vector<noise_generators::StompNoiseGeneratorPtr> noise_generators_;
+
+  /**< Per-thread cost function instances, the first entry holds the 'cost_functions_' array >*/
+  std::vector< std::vector<cost_functions::StompCostFunctionPtr> > worker_cost_functions_;
+  std::vector< std::shared_ptr<std::mutex> > cost_function_locks_;  /**< Guards each shared cost function, null when it was cloned >*/
+  std::vector<Eigen::VectorXd> worker_state_costs_;                  /**< Per-thread workspace [num_timesteps] for the cost function results >*/
+  std::vector<utils::RolloutStates> worker_rollout_states_;          /**< Per-thread robot states of the timesteps shared by the cost functions >*/
+  Eigen::MatrixXd batch_state_costs_;                                /**< Workspace [num_rollouts][num_timesteps] for the batch cost function results >*/
+  std::vector<bool> batch_validities_;                               /**< Workspace for the validity of each rollout of a batch >*/
+
+  /**< The cost cascade, it stops evaluating a noisy trajectory once its probability is bound to be negligible >*/
+  double cascade_weight_;                                            /**< Probability weight below which a noisy trajectory is rejected, 0 if disabled >*/
+  double cascade_sensitivity_;                                       /**< The exponentiated cost sensitivity of the request >*/
+  double cascade_bound_;                                             /**< Mean state cost above which a noisy trajectory is rejected >*/
+  std::vector<std::size_t> cascade_order_;                           /**< The indices of the cost functions from the cheapest to the most expensive one >*/
+  std::vector<double> worker_min_costs_;                             /**< Per-thread lowest mean state cost of the noisy trajectories of the iteration >*/
+  std::vector<double> worker_max_costs_;                             /**< Per-thread highest mean state cost of the noisy trajectories of the iteration >*/
+
+  /**< The last evaluation of the optimized parameters, reused by identical queries within the same iteration >*/
+  bool cached_costs_valid_;                                          /**< Whether the cached evaluation can be reused >*/
+  int cached_iteration_;                                             /**< The iteration of the cached evaluation >*/
+  std::size_t cached_start_timestep_;                                /**< The first timestep of the cached evaluation >*/
+  Eigen::MatrixXd cached_parameters_;                                /**< The evaluated columns of the parameters >*/
+  Eigen::VectorXd cached_costs_;                                     /**< The costs of the cached evaluation >*/
+  bool cached_validity_;                                             /**< The validity of the cached evaluation >*/
+
+  utils::PluginProfiler profiler_;                                   /**< Measures the time spent in each plugin >*/
+  std::size_t noisy_filters_profile_offset_;                         /**< The profiler index of the first noisy filter >*/
+  std::size_t update_filters_profile_offset_;                        /**< The profiler index of the first update filter >*/
+  std::size_t noise_generator_profile_index_;                        /**< The profiler index of the active noise generator >*/
 };
 
 
@@ -29,14 +29,147 @@
 #include <moveit/planning_interface/planning_interface.h>
 #include <stomp_core/stomp.h>
 #include <stomp_moveit/stomp_optimization_task.h>
+#include <stomp_moveit/utils/experience_library.h>
+#include <stomp_moveit/utils/planner_metrics.h>
+#include <stomp_moveit/utils/trajectory_cache.h>
+#include <industrial_trajectory_utils/shared_trajectory.h>
+#include <industrial_trajectory_utils/trajectory_decimation.h>
 #include <boost/thread.hpp>
 #include <ros/ros.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
 
 namespace stomp_moveit
 {
 
 using StompOptimizationTaskPtr = std::shared_ptr<StompOptimizationTask>;
 
+class StompPlanner;
+
+/**
+ * @brief The handle of a plan queued with StompPlanner::solveAsync().  It reports the progress of the plan, the best
+ * valid trajectory found so far and the response once the plan is done.  This class is thread-safe.
+ */
+class PlanHandle
+{
+public:
+
+  /** @brief The stages of a plan */
+  enum Status
+  {
+    QUEUED = 0,     /**< @brief Waits for the plans queued before it */
+    RUNNING,        /**< @brief Is being optimized */
+    SUCCEEDED,      /**< @brief Found a valid trajectory */
+    FAILED,         /**< @brief Did not find a valid trajectory */
+    CANCELLED       /**< @brief Was cancelled before it found a valid trajectory */
+  };
+
+  /**
+   * @brief The stage of the plan
+   * @return The status
+   */
+  Status getStatus() const;
+
+  /**
+   * @brief Whether the plan is done, it succeeded, failed or was cancelled.
+   * @return True if the plan is done, otherwise false.
+   */
+  bool isDone() const;
+
+  /**
+   * @brief Blocks until the plan is done
+   * @param timeout The longest time to wait in seconds, negative to wait until the plan is done
+   * @return True if the plan is done, otherwise false.
+   */
+  bool wait(double timeout = -1.0) const;
+
+  /**
+   * @brief The future of the plan, it becomes ready once the plan is done.
+   * @return A future holding whether the plan succeeded
+   */
+  std::shared_future<bool> getFuture() const;
+
+  /**
+   * @brief Cancels the plan, a queued plan never runs while a running one stops at the next rollout evaluation and
+   * returns the best valid trajectory it found by then.
+   */
+  void cancel();
+
+  /**
+   * @brief The time spent optimizing the plan
+   * @return The seconds elapsed since the plan started running, until it was done, 0 while it is queued.
+   */
+  double getElapsedTime() const;
+
+  /**
+   * @brief Copies the lowest cost valid trajectory found so far, see stomp_core::Stomp::getBestValidParameters().
+   * @param parameters  The trajectory [num_dimensions][num_timesteps]
+   * @param cost        Its total cost
+   * @param iteration   The iteration at which it was found
+   * @return True if a valid trajectory was found, otherwise false.
+   */
+  bool getBestValidParameters(Eigen::MatrixXd& parameters,double& cost,unsigned int& iteration) const;
+
+  /**
+   * @brief Copies the response of the plan
+   * @param res The response of StompPlanner::solve()
+   * @return True if the plan is done, otherwise false and the response is left untouched.
+   */
+  bool getResponse(planning_interface::MotionPlanDetailedResponse& res) const;
+
+  /**
+   * @brief The trajectory of the plan shared without a copy, see StompPlanner::getSharedTrajectory()
+   * @return The trajectory or a null pointer while the plan is not done or when it found no valid trajectory.
+   */
+  trajectory::SharedTrajectoryConstPtr getSharedTrajectory() const;
+
+protected:
+
+  friend class StompPlanner;
+
+  PlanHandle(StompPlanner* planner,const planning_scene::PlanningSceneConstPtr& planning_scene,
+             const moveit_msgs::MotionPlanRequest& req);
+
+  /**
+   * @brief Marks the plan as running
+   * @return False if the plan was cancelled while queued, it is then done.
+   */
+  bool start();
+
+  /**
+   * @brief Marks the plan as done and stores its results
+   * @param success   Whether a valid trajectory was found
+   * @param res       The response of the plan
+   */
+  void finish(bool success,const planning_interface::MotionPlanDetailedResponse& res);
+
+protected:
+
+  StompPlanner* planner_;                                /**< @brief The planner, only used while the plan runs */
+  planning_scene::PlanningSceneConstPtr planning_scene_; /**< @brief The planning scene of the plan */
+  moveit_msgs::MotionPlanRequest request_;               /**< @brief The request of the plan */
+
+  mutable std::mutex mutex_;                             /**< @brief Guards the members below */
+  Status status_;                                        /**< @brief The stage of the plan */
+  bool cancel_requested_;                                /**< @brief Whether cancel() was called */
+  ros::WallTime start_time_;                             /**< @brief When the plan started running */
+  ros::WallTime end_time_;                               /**< @brief When the plan was done */
+  planning_interface::MotionPlanDetailedResponse response_; /**< @brief The response once done */
+  Eigen::MatrixXd best_parameters_;                      /**< @brief The best valid trajectory once done */
+  double best_cost_;                                     /**< @brief The cost of the best valid trajectory */
+  unsigned int best_iteration_;                          /**< @brief The iteration of the best valid trajectory */
+  bool best_valid_;                                      /**< @brief Whether a valid trajectory was found once done */
+  trajectory::SharedTrajectoryConstPtr shared_trajectory_; /**< @brief The trajectory of the plan once done */
+  std::promise<bool> promise_;                           /**< @brief Fulfilled once the plan is done */
+  std::shared_future<bool> future_;                      /**< @brief The future of the promise */
+};
+
+typedef std::shared_ptr<PlanHandle> PlanHandlePtr;
+
 /**
  * @brief The PlanningContext specialization that wraps the STOMP algorithm.
  *
@@ -70,6 +203,54 @@ public:
    */
   virtual bool solve(planning_interface::MotionPlanDetailedResponse &res) override;
 
+  /**
+   * @brief Queues a plan that runs on the executor thread of the planner and returns immediately, so that the caller
+   * can overlap planning with execution and queue the next request while the current one still optimizes.  The plans
+   * run one at a time in the order they were queued, each one sets its planning scene and request on this context
+   * before it is solved, therefore the context must not be used synchronously while plans are queued.
+   * @param planning_scene  The planning scene of the plan
+   * @param req             The motion plan request
+   * @return The handle of the plan
+   */
+  PlanHandlePtr solveAsync(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                           const moveit_msgs::MotionPlanRequest& req);
+
+  /**
+   * @brief Queues a plan of the current planning scene and request, see solveAsync(planning_scene,req).
+   * @return The handle of the plan
+   */
+  PlanHandlePtr solveAsync();
+
+  /**
+   * @brief Copies the lowest cost valid trajectory found so far by the planning attempts of the plan in progress or the
+   * last one.  This method is thread-safe.
+   * @param parameters  The trajectory [num_dimensions][num_timesteps]
+   * @param cost        Its total cost
+   * @param iteration   The iteration at which it was found
+   * @return True if a valid trajectory was found, otherwise false.
+   */
+  bool getBestValidParameters(Eigen::MatrixXd& parameters,double& cost,unsigned int& iteration) const;
+
+  /**
+   * @brief Repairs a trajectory that became invalid after the planning scene changed, e.g. when an object appeared in
+   * the workcell during its execution.  The waypoints are checked against the current planning scene, the window that
+   * spans the colliding ones padded by 'repair_padding' timesteps is optimized while the rest of the trajectory is held,
+   * see stomp_core::Stomp::solveWindow().  The time spent therefore scales with the size of the blocked region.
+   * @param trajectory  The trajectory to repair, its joints are the active joints of the group in order
+   * @param res         Contains the repaired path, the same path when no waypoint collides.
+   * @return true if the repaired path is valid, false otherwise.
+   */
+  bool repair(const trajectory_msgs::JointTrajectory& trajectory,planning_interface::MotionPlanResponse& res);
+
+  /**
+   * @brief Plans a short synthetic joint motion of the group in an empty planning scene so that the plugins, the collision
+   * geometry, the control cost matrices and the buffers are initialized before the first real request.  The plan is not
+   * recorded in the metrics, the captures or the warm start caches.
+   * @param allowed_planning_time The time allowed to the synthetic request
+   * @return true if the synthetic plan succeeded, false otherwise.
+   */
+  bool warmUp(double allowed_planning_time);
+
   /**
    * @brief Thread-safe method that request early termination, if a solve() function is currently computing plans.
    * @return true if succeeded, false otherwise.
@@ -81,6 +262,27 @@ public:
    */
   virtual void clear() override;
 
+  /**
+   * @brief The optimizer of the planning attempt whose trajectory was returned by the last call to solve(), it reports
+   * the iterations, the cost and the termination reason of that attempt.  It must not be used while solving.
+   * @return The optimizer or a null pointer when the last call to solve() found no trajectory.
+   */
+  std::shared_ptr<const stomp_core::Stomp> getSelectedOptimizer() const;
+
+  /**
+   * @brief The trajectory returned by the last call to solve() or repair() as matrices shared with the consumers of the
+   * same process, which read it without the message conversions of the response.  When the uniform time scaling timed
+   * the waypoints it holds the optimized parameters as they are.  It is never modified, the next call replaces it.
+   * @return The trajectory or a null pointer when the last call found no valid trajectory.
+   */
+  trajectory::SharedTrajectoryConstPtr getSharedTrajectory() const;
+
+  /**
+   * @brief Sets the metrics that record the latency and the outcome of every call to solve().
+   * @param metrics The metrics, usually shared by all the planners, a null pointer disables the recording
+   */
+  void setMetrics(utils::PlannerMetricsPtr metrics);
+
   /**
    * @brief Convenience method to load extract the parameters for each supported planning group.
    * @param nh      A ros node handle.
@@ -101,7 +303,7 @@ public:
    * a 'seed' for the optimization planning.
    * @param seed The trajectory to encode into 'seed' trajectory constraints
    * @return The encoded trajectory constraints which can be added directly to a moveit planning request. In the case
-   * of failure, may throw a std::runtime_error.
+   * of failure, may throw a std::runtime_error.  Long seeds are cheaper to pass by reference, see utils::seeds.
    */
   static moveit_msgs::TrajectoryConstraints encodeSeedTrajectory(const trajectory_msgs::JointTrajectory& seed);
 
@@ -114,11 +316,55 @@ protected:
 
   /**
    * @brief Gets the start and goal joint values from the motion plan request passed.
-   * @param start The start joint values
-   * @param goal  The goal joint values
+   * @param start           The start joint values
+   * @param goal            The goal joint values
+   * @param goal_candidates Returns the valid goals sorted by their distance to the start when 'goal_selection_seeds' is
+   *                        positive, the first one being 'goal'.  It is left empty otherwise, may be null.
    * @return  true if succeeded, false otherwise.
    */
-  bool getStartAndGoal(Eigen::VectorXd& start, Eigen::VectorXd& goal);
+  bool getStartAndGoal(Eigen::VectorXd& start, Eigen::VectorXd& goal,
+                       std::vector<Eigen::VectorXd>* goal_candidates = nullptr);
+
+  /**
+   * @brief Solves every goal constraint of the request concurrently, the cartesian ones from 'goal_selection_seeds' IK
+   * seeds each, and sorts the distinct valid solutions by their joint distance to the start.
+   * @param start_state     The start state of the request
+   * @param start           The start joint values
+   * @param goal_candidates Returns the valid goals, nearest first
+   * @return True if at least one valid goal was found, otherwise false.
+   */
+  bool selectGoalCandidates(const moveit::core::RobotState& start_state, const Eigen::VectorXd& start,
+                            std::vector<Eigen::VectorXd>& goal_candidates) const;
+
+  /**
+   * @brief Creates the tasks and optimizers needed to run concurrent planning attempts, they are kept for later requests.
+   * @param num_attempts The number of independent optimizations
+   * @return  true if succeeded, false otherwise.
+   */
+  bool allocateAttempts(std::size_t num_attempts);
+
+  /**
+   * @brief Solves the motion planning problem, records its metrics and captures it when it failed or was slow.  The
+   * cancellation latched by terminate() is left as it is, the callers clear it before the plan starts.
+   * @param res Contains the solved planned path.
+   * @return true if succeeded, false otherwise.
+   */
+  bool runPlan(planning_interface::MotionPlanDetailedResponse &res);
+
+  /**
+   * @brief Solves the motion planning problem and measures the phases of the plan.
+   * @param res     Contains the solved planned path.
+   * @param record  Returns the duration of the phases that ran, the iterations and the failure reason
+   * @return true if succeeded, false otherwise.
+   */
+  bool solve(planning_interface::MotionPlanDetailedResponse &res,utils::PlanRecord& record);
+
+  /**
+   * @brief Writes the request, the planning scene and the configuration of the last plan into a new file of the
+   * capture directory, see utils::PlanCapture.
+   * @param record The measurements of the last plan
+   */
+  void capturePlan(const utils::PlanRecord& record) const;
 
   /**
    * @brief This function 1) gets the seed trajectory from the active motion plan request, 2) checks to see if
@@ -131,12 +377,59 @@ protected:
   bool getSeedParameters(Eigen::MatrixXd& parameters) const;
 
   /**
-   * @brief Converts from an Eigen Matrix to to a joint trajectory
+   * @brief The planning scene hash under which the trajectories are stored into and looked up from the experience library
+   * @return The hash of the current planning scene or 0 when the library ignores the scene.
+   */
+  std::uint64_t getExperienceSceneHash() const;
+
+  /**
+   * @brief Selects the number of timesteps of an unseeded request from the largest joint displacement between the
+   * start and the goal.  The count is rounded up to a multiple of the configured increment so that consecutive requests
+   * reuse the control cost matrices cached for the same number of timesteps and 'delta_t'.
+   * @param start The start joint values
+   * @param goal  The goal joint values
+   * @return The number of timesteps, the configured 'num_timesteps' when the adaptive mode is disabled
+   */
+  int selectNumTimesteps(const Eigen::VectorXd& start, const Eigen::VectorXd& goal) const;
+
+  /**
+   * @brief Optimizes a planning attempt at the coarse resolution with the robot links padded further and resamples the
+   * result to the full resolution, it seeds a short optimization at full resolution.
+   * @param attempt     The planning attempt whose task and optimizer are used
+   * @param config      The configuration of the attempt at full resolution
+   * @param start       The start joint values
+   * @param goal        The goal joint values
+   * @param deadline    The optimization stops as soon as this time is reached
+   * @param parameters  Returns the resampled trajectory [num joints][num_timesteps]
+   * @return True if the coarse optimization found a valid trajectory, otherwise false.
+   */
+  bool solveCoarse(std::size_t attempt, const stomp_core::StompConfiguration& config, const Eigen::VectorXd& start,
+                   const Eigen::VectorXd& goal, const std::chrono::steady_clock::time_point& deadline,
+                   Eigen::MatrixXd& parameters);
+
+  /**
+   * @brief The loop of the executor thread, it solves the queued plans until the planner is destroyed.
+   */
+  void runAsyncPlans();
+
+  /**
+   * @brief Finds the window of timesteps that spans the waypoints in collision with the planning scene, padded by
+   * 'repair_padding' timesteps and excluding the first and last timesteps.
+   * @param parameters        The trajectory [num_dimensions][num_timesteps]
+   * @param window_start      The first timestep of the window
+   * @param window_timesteps  The number of timesteps of the window
+   * @return True if a waypoint is in collision, otherwise false.
+   */
+  bool findInvalidWindow(const Eigen::MatrixXd& parameters, int& window_start, int& window_timesteps) const;
+
+  /**
+   * @brief Builds the timed robot trajectory straight from an Eigen Matrix, the waypoints are timed in place.  The shared
+   * trajectory is set from the result, see getSharedTrajectory().
    * @param parameters  The input matrix of size [num joints][num_timesteps] containing the trajectory joint values.
-   * @param traj        A trajectory in joint space.
+   * @param traj        Returns the trajectory, the joints outside of the group keep their start state values.
    * @return  true if succeeded, false otherwise.
    */
-  bool parametersToJointTrajectory(const Eigen::MatrixXd& parameters, trajectory_msgs::JointTrajectory& traj);
+  bool parametersToRobotTrajectory(const Eigen::MatrixXd& parameters, robot_trajectory::RobotTrajectory& traj);
 
   /**
    * @brief Converts from a joint trajectory to an Eigen Matrix.
@@ -163,6 +456,58 @@ protected:
   XmlRpc::XmlRpcValue config_;
   stomp_core::StompConfiguration stomp_config_;
 
+  // multi-start optimization, the first entries are 'stomp_' and 'task_'
+  std::vector< std::shared_ptr<stomp_core::Stomp> > attempt_stomps_;  /**< @brief One optimizer per planning attempt */
+  std::vector<StompOptimizationTaskPtr> attempt_tasks_;               /**< @brief One task per planning attempt */
+  double multi_start_cost_threshold_;                                 /**< @brief Cost below which the first valid attempt wins */
+  std::size_t max_planning_attempts_;                                 /**< @brief The most concurrent attempts of a request, bounded by the thread budget */
+  std::atomic<bool> cancel_requested_;                                /**< @brief Latched by terminate() until the next plan starts */
+  mutable std::mutex attempts_mutex_;                                 /**< @brief Guards the attempts allocation */
+  int selected_attempt_;                                              /**< @brief The attempt returned by the last solve(), -1 if none */
+  trajectory::SharedTrajectoryConstPtr shared_trajectory_;   /**< @brief The trajectory returned by the last solve(), null if none */
+  stomp_core::ThreadPoolPtr executor_;                                /**< @brief The pool shared by the planners of the process, null if each optimizer owns one */
+
+  // warm start
+  utils::TrajectoryCache trajectory_cache_;                           /**< @brief Previously optimized trajectories of this group */
+  std::shared_ptr<utils::ExperienceLibrary> experience_library_;     /**< @brief Trajectories persisted across processes, null if disabled */
+  bool match_experience_scene_;                                       /**< @brief Whether the library only returns trajectories of the same planning scene */
+
+  // adaptive number of timesteps
+  double timestep_resolution_;                                        /**< @brief Largest joint displacement in radians per timestep, 0 if disabled */
+  int min_timesteps_;                                                 /**< @brief Lower bound of the adaptive number of timesteps */
+  int max_timesteps_;                                                 /**< @brief Upper bound of the adaptive number of timesteps */
+  int timesteps_increment_;                                           /**< @brief The adaptive number of timesteps is a multiple of this value */
+
+  // multi-resolution optimization
+  int coarse_timesteps_;                                              /**< @brief Timesteps of the coarse optimization of the unseeded attempts, 0 if disabled */
+  int refine_iterations_;                                             /**< @brief Iterations of the full resolution optimization seeded by the coarse one */
+  double coarse_padding_;                                             /**< @brief Padding added to the robot links during the coarse optimization */
+
+  // goal selection
+  int goal_selection_seeds_;                                          /**< @brief IK seeds per cartesian goal when all goals are compared, 0 takes the first feasible goal */
+  int goal_selection_candidates_;                                     /**< @brief Number of the nearest goals the planning attempts start from in turn */
+
+  // trajectory repair
+  int repair_padding_;                                                /**< @brief Timesteps added on each side of the colliding waypoints */
+
+  // asynchronous plans
+  std::deque<PlanHandlePtr> async_queue_;                             /**< @brief The plans waiting for the executor */
+  PlanHandlePtr async_running_;                                       /**< @brief The plan being solved, null if none */
+  std::mutex async_mutex_;                                            /**< @brief Guards the queue and the running plan */
+  std::condition_variable async_condition_;                           /**< @brief Wakes the executor up */
+  std::thread async_thread_;                                          /**< @brief The executor, started by the first solveAsync() */
+  bool async_shutdown_;                                               /**< @brief Stops the executor */
+
+  // output timing
+  bool uniform_time_scaling_;                                         /**< @brief Whether to time the trajectory from 'delta_t' instead of the iterative parabolic parameterization */
+  trajectory::TrajectoryDecimationParameters decimation_;  /**< @brief The tolerances of the waypoint decimation, disabled by default */
+
+  // profiling
+  stomp_core::InstrumentationSinkPtr instrumentation_sink_;           /**< @brief Receives the iteration profiles of every attempt, null if disabled */
+  utils::PlannerMetricsPtr metrics_;                                  /**< @brief Records every plan, null if disabled */
+  std::string capture_directory_;                                     /**< @brief Where the failed and slow plans are captured, empty if disabled */
+  double capture_time_threshold_;                                     /**< @brief Plans that take longer than this in seconds are captured */
+
   // robot environment
   moveit::core::RobotModelConstPtr robot_model_;
 
@@ -26,11 +26,17 @@
 #ifndef STOMP_MOVEIT_STOMP_PLANNER_MANAGER_H_
 #define STOMP_MOVEIT_STOMP_PLANNER_MANAGER_H_
 
+#include <atomic>
+#include <mutex>
 #include <moveit/planning_interface/planning_interface.h>
 #include <ros/node_handle.h>
+#include <stomp_moveit/utils/planner_metrics.h>
 
 namespace stomp_moveit
 {
+
+class StompPlanner;
+
 /**
  * @class stomp_moveit::StompPlannerManager
  * @brief The PlannerManager implementation that loads STOMP into moveit
@@ -50,7 +56,9 @@ public:
   virtual ~StompPlannerManager();
 
   /**
-   * @brief Loads the ros parameters for each planning group and initializes the all the planners
+   * @brief Loads the ros parameters for each planning group and initializes the all the planners.  When the
+   * 'stomp_startup/lazy_planners' parameter is true only the groups in 'stomp_startup/prewarm_groups' get their planner
+   * now, the others on their first request.
    * @param model The robot model
    * @param ns    The parameter namespace
    * @return      True if succeeded, False otherwise
@@ -98,11 +106,57 @@ public:
       moveit_msgs::MoveItErrorCodes &error_code) const override;
 
 
+protected:
+
+  /**
+   * @brief A planner owned by the pool of its group
+   */
+  struct PooledPlanner
+  {
+    std::shared_ptr<StompPlanner> planner;          /**< The planner */
+    std::shared_ptr<std::atomic<bool>> available;   /**< Cleared while a planning context refers to the planner */
+  };
+
+  /**
+   * @brief Returns the planner of a configured group, it is created on the first call for the group.
+   * @param group The planning group
+   * @return  A pointer to the planner, null if the group is not configured or its planner failed to set up
+   */
+  std::shared_ptr<StompPlanner> getGroupPlanner(const std::string& group) const;
+
+  /**
+   * @brief Creates the planner of a configured group and seeds its pool with it, the pools mutex must be locked.
+   * @param group The planning group
+   * @return  A pointer to the planner
+   */
+  std::shared_ptr<StompPlanner> createGroupPlanner(const std::string& group) const;
+
+  /**
+   * @brief Hands out an idle planner of the group, a new planner is created when all of them are in use.
+   * The planner returns to the pool once the last copy of the returned pointer is released.
+   * @param group The planning group
+   * @return  A pointer to the planner, null if a new planner could not be created
+   */
+  std::shared_ptr<StompPlanner> acquirePlanner(const std::string& group) const;
+
+  /**
+   * @brief Publishes the planner metrics of every group as a diagnostic array
+   */
+  void publishMetrics(const ros::WallTimerEvent&);
+
 protected:
   ros::NodeHandle nh_;
 
 
-  std::map< std::string, planning_interface::PlanningContextPtr> planners_; /**< The planners for each planning group */
+  mutable std::map< std::string, planning_interface::PlanningContextPtr> planners_; /**< The planners created so far for each planning group */
+  std::map< std::string, XmlRpc::XmlRpcValue> group_config_;               /**< The configuration of each planning group */
+  mutable std::map< std::string, std::vector<PooledPlanner> > planner_pools_; /**< The planners of each group that can run concurrently */
+  mutable std::mutex planner_pools_mutex_;                                  /**< Guards the planners and the planner pools */
+
+  // planning latency of every group
+  utils::PlannerMetricsPtr metrics_;                                        /**< The metrics shared by all the planners */
+  ros::Publisher metrics_publisher_;                                        /**< Publishes the metrics on /diagnostics */
+  ros::WallTimer metrics_timer_;                                            /**< Triggers the metrics publication */
 
   // the robot model
   moveit::core::RobotModelConstPtr robot_model_;
@@ -30,6 +30,7 @@
 
 #include <stomp_moveit/update_filters/stomp_update_filter.h>
 #include <Eigen/Core>
+#include <stomp_core/control_cost_cache.h>
 
 namespace stomp_moveit
 {
@@ -103,7 +104,9 @@ protected:
 
   // smoothing matrix
   int num_timesteps_;
-  Eigen::MatrixXd projection_matrix_M_;
+  stomp_core::ControlCostMatricesConstPtr control_cost_matrices_;   /**< @brief The factorization of R, M is applied by solving against it */
+  Eigen::VectorXd column_scales_;                                   /**< @brief The column scaling of M = R^-1 * diag(column_scales_) */
+  Eigen::MatrixXd projected_updates_;                               /**< @brief [timesteps][dimensions] workspace of the projected updates */
 
 };
 
@@ -0,0 +1,126 @@
+/**
+ * @file obstacle_gradient_descent.h
+ * @brief This defines an update filter that pushes the trajectory away from the obstacles along the distance gradient
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+#ifndef INDUSTRIAL_MOVEIT_STOMP_MOVEIT_INCLUDE_STOMP_MOVEIT_UPDATE_FILTERS_OBSTACLE_GRADIENT_DESCENT_H_
+#define INDUSTRIAL_MOVEIT_STOMP_MOVEIT_INCLUDE_STOMP_MOVEIT_UPDATE_FILTERS_OBSTACLE_GRADIENT_DESCENT_H_
+
+#include <stomp_moveit/update_filters/stomp_update_filter.h>
+#include <stomp_moveit/utils/obstacle_gradient.h>
+#include <Eigen/Core>
+
+namespace stomp_moveit
+{
+namespace update_filters
+{
+
+/**
+ * @class stomp_moveit::update_filters::ObstacleGradientDescent
+ * @brief Adds a gradient descent step on the obstacle cost of ObstacleDistanceGradient to the updates, similar to CHOMP.
+ *    At each timestep of the updated trajectory closer than 'max_distance' to an obstacle the cartesian distance
+ *    gradient at the nearest link point is mapped to the joints through the transpose of the link jacobian.  The start
+ *    and goal timesteps are not modified.  It requires the industrial collision detector.
+ *
+ * @par Examples:
+ * All examples are located here @ref stomp_moveit_examples
+ *
+ */
+class ObstacleGradientDescent : public StompUpdateFilter
+{
+public:
+  ObstacleGradientDescent();
+  virtual ~ObstacleGradientDescent();
+
+  /** @brief see base class for documentation*/
+  virtual bool initialize(moveit::core::RobotModelConstPtr robot_model_ptr,
+                          const std::string& group_name,const XmlRpc::XmlRpcValue& config) override;
+
+  /** @brief see base class for documentation*/
+  virtual bool configure(const XmlRpc::XmlRpcValue& config) override;
+
+  /** @brief see base class for documentation*/
+  virtual bool setMotionPlanRequest(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                   const moveit_msgs::MotionPlanRequest &req,
+                   const stomp_core::StompConfiguration &config,
+                   moveit_msgs::MoveItErrorCodes& error_code) override;
+
+  /**
+   * @brief Adds the obstacle gradient step to the updates.
+   *
+   * @param start_timestep    start index into the 'parameters' array, usually 0.
+   * @param num_timesteps     number of elements to use from 'parameters' starting from 'start_timestep'
+   * @param iteration_number  The current iteration count in the optimization loop
+   * @param parameters        The parameters generated in the previous iteration [num_dimensions x num_timesteps]
+   * @param updates           Output argument which contains the updates to be applied to the parameters [num_dimensions x num_timesteps]
+   * @param filtered          Output argument which is set to 'true' if the updates were modified.
+   * @return false if there was an irrecoverable failure, true otherwise.
+   */
+  virtual bool filter(std::size_t start_timestep,
+                      std::size_t num_timesteps,
+                      int iteration_number,
+                      const Eigen::MatrixXd& parameters,
+                      Eigen::MatrixXd& updates,
+                      bool& filtered) override;
+
+  virtual std::string getGroupName() const
+  {
+    return group_name_;
+  }
+
+  virtual std::string getName() const
+  {
+    return name_ + "/" + group_name_;
+  }
+
+protected:
+
+  // local
+  std::string name_;
+
+  // robot properties
+  moveit::core::RobotModelConstPtr robot_model_;
+  std::string group_name_;
+  moveit::core::RobotStatePtr state_;
+
+  // parameters
+  double max_distance_;         /**< @brief The distance beyond which the obstacles have no influence */
+  double step_size_;            /**< @brief The step applied to the joint gradient */
+  double max_joint_step_;       /**< @brief The largest change of a joint per timestep and iteration */
+
+  // distance queries
+  collision_detection::CollisionRobotIndustrialConstPtr collision_robot_;
+  collision_detection::CollisionWorldIndustrialConstPtr collision_world_;
+  collision_detection::DistanceRequest distance_request_;
+  collision_detection::AllowedCollisionBitMatrixConstPtr acm_bits_;
+  collision_detection::DistanceResult distance_result_;
+
+  // workspace
+  Eigen::VectorXd joint_values_;
+  Eigen::MatrixXd jacobian_;
+  Eigen::VectorXd joint_step_;
+};
+
+} /* namespace update_filters */
+} /* namespace stomp_moveit */
+
+#endif /* INDUSTRIAL_MOVEIT_STOMP_MOVEIT_INCLUDE_STOMP_MOVEIT_UPDATE_FILTERS_OBSTACLE_GRADIENT_DESCENT_H_ */
@@ -29,6 +29,7 @@
 #define INDUSTRIAL_MOVEIT_STOMP_MOVEIT_INCLUDE_STOMP_MOVEIT_UPDATE_FILTERS_POLYNOMIAL_SMOOTHER_H_
 
 #include <stomp_moveit/update_filters/stomp_update_filter.h>
+#include <stomp_moveit/utils/polynomial.h>
 
 namespace stomp_moveit
 {
@@ -113,6 +114,9 @@ protected:
 
   // robot
   moveit::core::RobotModelConstPtr robot_model_;
+
+  // the fit factorized for the number of timesteps of the request
+  utils::polynomial::EndpointPolynomialFit fit_;
 };
 
 } /* namespace update_filters */
@@ -26,11 +26,13 @@
 #ifndef INDUSTRIAL_MOVEIT_STOMP_MOVEIT_INCLUDE_STOMP_MOVEIT_UPDATE_FILTERS_TRAJECTORY_VISUALIZATION_H_
 #define INDUSTRIAL_MOVEIT_STOMP_MOVEIT_INCLUDE_STOMP_MOVEIT_UPDATE_FILTERS_TRAJECTORY_VISUALIZATION_H_
 
+#include <chrono>
 #include <ros/node_handle.h>
 #include <ros/publisher.h>
 #include <Eigen/Core>
 #include <geometry_msgs/Point.h>
 #include <stomp_moveit/update_filters/stomp_update_filter.h>
+#include <stomp_moveit/utils/background_worker.h>
 #include <visualization_msgs/Marker.h>
 
 namespace stomp_moveit
@@ -40,7 +42,9 @@ namespace update_filters
 
 /**
  * @class stomp_moveit::update_filters::TrajectoryVisualization
- * @brief Publishes rviz markers to visualize the optimized trajectory
+ * @brief Publishes rviz markers to visualize the optimized trajectory.  The intermediate trajectories are only published
+ * while the marker topic has subscribers and at most at the configured rate, the forward kinematics and the messages are
+ * computed by a background thread.
  *
  * @par Examples:
  * All examples are located here @ref stomp_moveit_examples
@@ -66,7 +70,7 @@ public:
                    moveit_msgs::MoveItErrorCodes& error_code) override;
 
   /**
-   * @brief Publishes rviz markers to visualize the optimized trajectory at each iteration.
+   * @brief Hands the updated trajectory off to the publisher thread at each iteration.
    *
    * @param start_timestep    start index into the 'parameters' array, usually 0.
    * @param num_timesteps     number of elements to use from 'parameters' starting from 'start_timestep'
@@ -108,6 +112,16 @@ public:
 
 protected:
 
+  /** @brief Whether an intermediate trajectory should be published, depends on the subscribers and the publish rate */
+  bool shouldPublish() const;
+
+  /**
+   * @brief Computes the tool path of the trajectory and publishes its marker, runs on the publisher thread.
+   * @param parameters  The trajectory [num_dimensions x num_timesteps]
+   * @param rgb         The marker color
+   */
+  void publishToolPath(const Eigen::MatrixXd& parameters,const std_msgs::ColorRGBA& rgb);
+
   // identity
   std::string name_;
 
@@ -127,11 +141,15 @@ protected:
   bool publish_intermediate_;
   std::string marker_topic_;
   std::string marker_namespace_;
+  double publish_rate_;                                   /**< @brief The maximum rate in Hz of the intermediate trajectories, 0 publishes every iteration */
 
-  // tool trajectory
+  // tool trajectory, only used by the publisher thread
   Eigen::MatrixXd tool_traj_line_;
   visualization_msgs::Marker tool_traj_marker_;
 
+  std::chrono::steady_clock::time_point last_publish_;    /**< @brief When the last intermediate trajectory was handed off */
+  utils::BackgroundWorker publisher_;                     /**< @brief Computes and publishes the marker */
+
 
 };
 
@@ -27,6 +27,7 @@
 #define INDUSTRIAL_MOVEIT_STOMP_MOVEIT_INCLUDE_STOMP_MOVEIT_UPDATE_FILTERS_UPDATE_LOGGER_H_
 
 #include <stomp_moveit/update_filters/stomp_update_filter.h>
+#include <stomp_moveit/utils/binary_log_writer.h>
 #include <fstream>
 
 namespace stomp_moveit
@@ -39,6 +40,8 @@ namespace update_filters
  * @brief Saves the update values into a file for post analysis.  The file is compatible with the python numpy
  *  library and can be loaded into a numpy array by running.
  *    'numpy.loadtxt(file_name)'
+ *  In binary mode fixed size records are streamed to the file by a background thread instead, they can be loaded with
+ *  the 'load_update_log.py' script.
  *
  * @par Examples:
  * All examples are located here @ref stomp_moveit_examples
@@ -91,6 +94,18 @@ public:
     return name_ + "/" + group_name_;
   }
 
+  /**
+   * @brief Appends the record of the iteration in binary mode.
+   * @param start_timestep    The start index into the 'parameters' array, usually 0.
+   * @param num_timesteps     The number of elements to use from 'parameters' starting from 'start_timestep'
+   * @param iteration_number  The current iteration count in the optimization loop
+   * @param cost              The cost value for the current parameters.
+   * @param parameters        The value of the parameters at the end of the current iteration [num_dimensions x num_timesteps].
+   */
+  virtual void postIteration(std::size_t start_timestep,
+                             std::size_t num_timesteps,int iteration_number,double cost,
+                             const Eigen::MatrixXd& parameters) override;
+
   virtual void done(bool success, int total_iterations,double final_cost,const Eigen::MatrixXd& parameters) override;
 
 protected:
@@ -102,6 +117,8 @@ protected:
   std::string filename_;
   std::string package_;
   std::string directory_;
+  bool binary_;                                   /**< @brief Whether the records are streamed into a binary file */
+  int buffer_size_;                               /**< @brief The number of records buffered in binary mode */
 
   // config
   stomp_core::StompConfiguration stomp_config_;
@@ -112,6 +129,12 @@ protected:
   std::ofstream file_stream_;
   Eigen::IOFormat format_;
 
+  // binary logging
+  utils::BinaryLogWriter binary_writer_;          /**< @brief Streams the records to the file */
+  int staged_iteration_;                          /**< @brief The iteration of the staged record */
+  Eigen::MatrixXd staged_parameters_;             /**< @brief The parameters received by the filter during the iteration */
+  Eigen::MatrixXd staged_updates_;                /**< @brief The updates received by the filter during the iteration */
+
 };
 
 } /* namespace smoothers */
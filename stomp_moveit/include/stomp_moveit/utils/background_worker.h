@@ -0,0 +1,92 @@
+/**
+ * @file background_worker.h
+ * @brief This runs work handed off by the plugins on a separate thread
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INCLUDE_STOMP_MOVEIT_UTILS_BACKGROUND_WORKER_H_
+#define INCLUDE_STOMP_MOVEIT_UTILS_BACKGROUND_WORKER_H_
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+/**
+ * @namespace stomp_moveit
+ */
+namespace stomp_moveit
+{
+
+/**
+ * @namespace utils
+ */
+namespace utils
+{
+
+/**
+ * @brief Runs the jobs handed off by the optimization loop on its own thread so that work that does not affect the
+ * optimization, such as building and publishing messages, stays off the critical path.  Only the latest job is kept:
+ * a job that has not started when a new one is posted is discarded, therefore a slow job never delays the loop.
+ */
+class BackgroundWorker
+{
+public:
+
+  typedef std::function<void()> Job;
+
+  BackgroundWorker();
+
+  /** @brief Waits for the running job to finish, the pending job is discarded */
+  ~BackgroundWorker();
+
+  /**
+   * @brief Schedules a job, the thread is started the first time this is called.
+   * @param job The job, it replaces the pending job if there is one.
+   * @return False if a pending job was discarded, true otherwise.
+   */
+  bool post(Job job);
+
+  /** @brief Blocks until the pending and the running jobs have finished */
+  void wait();
+
+  /** @brief Discards the pending job, waits for the running one and stops the thread.  Posting restarts it. */
+  void stop();
+
+protected:
+
+  /** @brief The thread main loop */
+  void run();
+
+  std::thread thread_;                  /**< @brief The thread running the jobs */
+  std::mutex mutex_;                    /**< @brief Guards the members below */
+  std::condition_variable condition_;   /**< @brief Signals a new job, the completion of a job or the stop request */
+  Job pending_job_;                     /**< @brief The job to run next, empty if there is none */
+  bool busy_;                           /**< @brief Whether a job is running */
+  bool stop_;                           /**< @brief Whether the thread has been requested to exit */
+};
+
+} /* namespace utils */
+} /* namespace stomp_moveit */
+
+#endif /* INCLUDE_STOMP_MOVEIT_UTILS_BACKGROUND_WORKER_H_ */
@@ -0,0 +1,141 @@
+/**
+ * @file binary_log_writer.h
+ * @brief This streams fixed size optimization records into a binary file from a background thread
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INCLUDE_STOMP_MOVEIT_UTILS_BINARY_LOG_WRITER_H_
+#define INCLUDE_STOMP_MOVEIT_UTILS_BINARY_LOG_WRITER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <Eigen/Core>
+
+/**
+ * @namespace stomp_moveit
+ */
+namespace stomp_moveit
+{
+
+/**
+ * @namespace utils
+ */
+namespace utils
+{
+
+/**
+ * @brief Streams fixed size records of the optimization into a binary file.  The records are copied into a preallocated
+ * single producer single consumer ring buffer and written by a background thread, therefore appending never blocks nor
+ * allocates and the memory used does not grow with the number of iterations.  A record is dropped when the ring buffer is
+ * full.
+ *
+ * The file starts with a Header followed by the records, each record has the layout
+ *   int64 iteration, float64 cost, float64 parameters[num_dimensions][num_timesteps], float64 updates[num_dimensions][num_timesteps]
+ * in native byte order, so that the file can be memory mapped as an array of records.
+ */
+class BinaryLogWriter
+{
+public:
+
+  static const char MAGIC[8];                   /**< @brief The file signature "STOMPLOG" */
+  static const std::uint32_t VERSION = 1;       /**< @brief The file layout version */
+
+  /** @brief The file header, 64 bytes */
+  struct Header
+  {
+    char magic[8];                  /**< @brief MAGIC */
+    std::uint32_t version;          /**< @brief VERSION */
+    std::uint32_t header_size;      /**< @brief The offset of the first record in bytes */
+    std::uint32_t num_dimensions;   /**< @brief The number of rows of the parameters and the updates */
+    std::uint32_t num_timesteps;    /**< @brief The number of columns of the parameters and the updates */
+    std::uint64_t record_size;      /**< @brief The size of a record in bytes */
+    std::uint64_t num_records;      /**< @brief The number of records, only valid once the file has been closed */
+    std::uint64_t dropped_records;  /**< @brief The number of records dropped because the ring buffer was full */
+    char reserved[16];              /**< @brief Zeroed */
+  };
+
+  BinaryLogWriter();
+
+  /** @brief Closes the file */
+  ~BinaryLogWriter();
+
+  /**
+   * @brief Creates the file, allocates the ring buffer and starts the writer thread.  An open file is closed first.
+   * @param file_name       The file path
+   * @param num_dimensions  The number of rows of the parameters and the updates
+   * @param num_timesteps   The number of columns of the parameters and the updates
+   * @param capacity        The number of records the ring buffer holds
+   * @return False if the file could not be created, true otherwise.
+   */
+  bool open(const std::string& file_name,int num_dimensions,int num_timesteps,std::size_t capacity);
+
+  /**
+   * @brief Copies a record into the ring buffer, it is safe to call from a single thread at a time.
+   * @param iteration   The iteration number
+   * @param cost        The cost of the iteration
+   * @param parameters  The parameters [num_dimensions x num_timesteps]
+   * @param updates     The updates [num_dimensions x num_timesteps]
+   * @return False if the file is not open, the sizes are wrong or the ring buffer is full.
+   */
+  bool append(int iteration,double cost,const Eigen::MatrixXd& parameters,const Eigen::MatrixXd& updates);
+
+  /**
+   * @brief Waits until all the records have been written, completes the header and closes the file.
+   * @return The number of records written.
+   */
+  std::size_t close();
+
+  /** @brief Whether the file is open */
+  bool isOpen() const { return file_ != nullptr; }
+
+  /** @brief The number of records dropped since the file was opened */
+  std::size_t getDroppedRecords() const { return dropped_; }
+
+protected:
+
+  /** @brief The writer thread main loop */
+  void run();
+
+  std::FILE* file_;                         /**< @brief The log file */
+  Header header_;                           /**< @brief The header written at the start of the file */
+  std::vector<char> ring_;                  /**< @brief The storage of the ring buffer slots */
+  std::size_t capacity_;                    /**< @brief The number of slots */
+  std::atomic<std::size_t> head_;           /**< @brief The number of records appended, only written by the producer */
+  std::atomic<std::size_t> tail_;           /**< @brief The number of records written, only written by the writer thread */
+  std::size_t dropped_;                     /**< @brief The number of records dropped, only accessed by the producer */
+  std::atomic<bool> closing_;               /**< @brief Requests the writer thread to exit once the ring buffer is empty */
+  std::thread thread_;                      /**< @brief The writer thread */
+  std::mutex mutex_;                        /**< @brief Used to sleep the writer thread */
+  std::condition_variable condition_;       /**< @brief Wakes the writer thread */
+};
+
+} /* namespace utils */
+} /* namespace stomp_moveit */
+
+#endif /* INCLUDE_STOMP_MOVEIT_UTILS_BINARY_LOG_WRITER_H_ */
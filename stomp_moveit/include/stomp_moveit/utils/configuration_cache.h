@@ -0,0 +1,159 @@
+/**
+ * @file configuration_cache.h
+ * @brief A cache of the collision and distance results of quantized joint configurations
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INCLUDE_STOMP_MOVEIT_UTILS_CONFIGURATION_CACHE_H_
+#define INCLUDE_STOMP_MOVEIT_UTILS_CONFIGURATION_CACHE_H_
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <Eigen/Core>
+
+/**
+ * @namespace stomp_moveit
+ */
+namespace stomp_moveit
+{
+
+/**
+ * @namespace utils
+ */
+namespace utils
+{
+
+/**
+ * @brief Stores a value per joint configuration, such as whether it collides or its distance to the obstacles, so that
+ * the rollouts and the iterations that pass through the same configuration evaluate it once.  The joint values are
+ * rounded to a grid of the configured resolution, the configurations of a grid cell share their value.  The table has
+ * a fixed number of slots indexed by the hash of the cell, a new cell replaces the one stored in its slot.  The values
+ * are only valid in the context they were computed in, e.g. a planning scene and a start state, see setContext().  This
+ * class is thread-safe and it doesn't allocate after configure().
+ */
+class ConfigurationCache
+{
+public:
+
+  /**
+   * @brief Constructor, the cache is disabled
+   */
+  ConfigurationCache();
+
+  ConfigurationCache(const ConfigurationCache&) = delete;
+  ConfigurationCache& operator=(const ConfigurationCache&) = delete;
+
+  /**
+   * @brief Allocates the table, the stored values are dropped.
+   * @param num_dimensions  The number of joint values of a configuration
+   * @param resolution      The size of a grid cell in joint space, 0 disables the cache
+   * @param capacity        The number of slots, 0 disables the cache
+   */
+  void configure(std::size_t num_dimensions, double resolution, std::size_t capacity);
+
+  /**
+   * @brief Whether the cache stores values
+   * @return True if configured with a positive resolution and capacity, otherwise false.
+   */
+  bool isEnabled() const;
+
+  /**
+   * @brief Drops the stored values unless they were computed in the same context.  It must not be called concurrently
+   * with lookup() or insert().
+   * @param context The hash of whatever the values depend on, see hashContext()
+   */
+  void setContext(std::uint64_t context);
+
+  /**
+   * @brief Retrieves the value of the grid cell of a configuration
+   * @param positions The joint values [num_dimensions]
+   * @param value     Returns the stored value
+   * @return True if the cell was found, otherwise false.
+   */
+  bool lookup(const Eigen::Ref<const Eigen::VectorXd>& positions, double& value) const;
+
+  /**
+   * @brief Stores the value of the grid cell of a configuration
+   * @param positions The joint values [num_dimensions]
+   * @param value     The value
+   */
+  void insert(const Eigen::Ref<const Eigen::VectorXd>& positions, double value);
+
+  /**
+   * @brief Combines an identity, such as the address of a planning scene, with a hash and a set of values into a
+   * context for setContext()
+   * @param identity  The address of the object the values depend on
+   * @param hash      A hash of its content
+   * @param values    Other values they depend on, such as the joint values of the start state
+   * @return The context
+   */
+  static std::uint64_t hashContext(const void* identity, std::uint64_t hash,
+                                   const Eigen::Ref<const Eigen::VectorXd>& values);
+
+protected:
+
+  /**
+   * @brief Hashes the grid cell of a configuration
+   * @param positions The joint values
+   * @return The hash, never 0 which marks an empty slot
+   */
+  std::uint64_t hashCell(const Eigen::Ref<const Eigen::VectorXd>& positions) const;
+
+  /**
+   * @brief Whether a slot holds the grid cell of a configuration, the stripe of the slot must be locked.
+   * @param slot      The slot
+   * @param hash      The hash of the cell
+   * @param positions The joint values
+   * @return True if the slot holds the cell, otherwise false.
+   */
+  bool matches(std::size_t slot, std::uint64_t hash, const Eigen::Ref<const Eigen::VectorXd>& positions) const;
+
+  /**
+   * @brief The coordinate of a joint value on the grid
+   * @param value The joint value
+   * @return The index of its grid cell along the joint
+   */
+  std::int64_t quantize(double value) const;
+
+protected:
+
+  static const std::size_t NUM_STRIPES = 64;    /**< @brief The number of locks guarding the slots */
+
+  std::size_t num_dimensions_;                  /**< @brief The number of joint values of a configuration */
+  double resolution_;                           /**< @brief The size of a grid cell, 0 if disabled */
+  std::size_t capacity_;                        /**< @brief The number of slots */
+  std::uint64_t context_;                       /**< @brief The context of the stored values */
+  std::vector<std::uint64_t> hashes_;           /**< @brief The hash of the cell in each slot, 0 if empty */
+  std::vector<std::int64_t> cells_;             /**< @brief The grid coordinates of the cell in each slot [capacity][num_dimensions] */
+  std::vector<double> values_;                  /**< @brief The value of the cell in each slot */
+  std::unique_ptr<std::mutex[]> stripes_;       /**< @brief Slot 's' is guarded by stripe 's % NUM_STRIPES' */
+};
+
+typedef std::shared_ptr<ConfigurationCache> ConfigurationCachePtr;
+
+} /* namespace utils */
+} /* namespace stomp_moveit */
+
+#endif /* INCLUDE_STOMP_MOVEIT_UTILS_CONFIGURATION_CACHE_H_ */
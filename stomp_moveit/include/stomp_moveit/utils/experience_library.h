@@ -0,0 +1,213 @@
+/**
+ * @file experience_library.h
+ * @brief A persistent library of optimized trajectories shared by several processes to seed the planner
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INCLUDE_STOMP_MOVEIT_UTILS_EXPERIENCE_LIBRARY_H_
+#define INCLUDE_STOMP_MOVEIT_UTILS_EXPERIENCE_LIBRARY_H_
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <Eigen/Core>
+#include <moveit/planning_scene/planning_scene.h>
+
+/**
+ * @namespace stomp_moveit
+ */
+namespace stomp_moveit
+{
+
+/**
+ * @namespace utils
+ */
+namespace utils
+{
+
+/**
+ * @brief Stores optimized trajectories of a planning group in a memory mapped file and retrieves the one whose start and
+ * goal joint values are the nearest to a new request within the same planning scene.  The file survives the processes
+ * that use it and any number of processes planning for the same group may share it, they coordinate through an advisory
+ * lock of the file.  The distance between two entries is the sum of the absolute joint differences of their start and
+ * goal configurations, as in the TrajectoryCache.
+ *
+ * The file holds a fixed number of slots and an index of the occupied slots sorted by the sum of the start and goal joint
+ * values of their trajectory.  The difference between the sums of two entries never exceeds their distance, a lookup
+ * therefore only measures the entries whose sum is within tolerance of that of the request, which are found by a binary
+ * search.  Once the library is full a new trajectory replaces the oldest one.  This class is thread-safe.
+ */
+class ExperienceLibrary
+{
+public:
+
+  ExperienceLibrary();
+  ~ExperienceLibrary();
+
+  ExperienceLibrary(const ExperienceLibrary&) = delete;
+  ExperienceLibrary& operator=(const ExperienceLibrary&) = delete;
+
+  /**
+   * @brief Maps a library file, it is created when it does not exist.  An existing file must have been created with the
+   * same group, number of dimensions, timesteps and capacity.
+   * @param file_name         The library file
+   * @param group             The planning group of the trajectories
+   * @param num_dimensions    The number of joints of the group
+   * @param max_timesteps     The maximum number of timesteps of a stored trajectory
+   * @param capacity          The number of trajectories stored
+   * @param tolerance         The maximum distance at which a stored trajectory is used
+   * @return True if the file was mapped, otherwise false.
+   */
+  bool open(const std::string& file_name, const std::string& group, std::size_t num_dimensions,
+            std::size_t max_timesteps, std::size_t capacity, double tolerance);
+
+  /**
+   * @brief Unmaps the library file, the stored trajectories remain in it.
+   */
+  void close();
+
+  /**
+   * @brief Whether a library file is mapped
+   * @return True if open() succeeded, otherwise false.
+   */
+  bool isOpen() const;
+
+  /**
+   * @brief Stores a trajectory, it replaces a stored one of the same scene within tolerance or else the oldest once the
+   * library is full.
+   * @param parameters  The optimized trajectory [num_dimensions][num_timesteps], its first and last columns are the
+   *                    start and goal configurations.
+   * @param scene_hash  The hash of the planning scene the trajectory was optimized in, see hashPlanningScene()
+   * @return True if the trajectory was stored, otherwise false.
+   */
+  bool insert(const Eigen::MatrixXd& parameters, std::uint64_t scene_hash);
+
+  /**
+   * @brief Retrieves the nearest stored trajectory of the same scene within tolerance.  Its end points are moved onto
+   * the requested start and goal, see TrajectoryCache::blendEndPoints().
+   * @param start       The requested start joint values
+   * @param goal        The requested goal joint values
+   * @param scene_hash  The hash of the planning scene of the request
+   * @param parameters  The output trajectory [num_dimensions][num_timesteps]
+   * @return True if a trajectory was found, otherwise false.
+   */
+  bool lookup(const Eigen::VectorXd& start, const Eigen::VectorXd& goal, std::uint64_t scene_hash,
+              Eigen::MatrixXd& parameters) const;
+
+  /**
+   * @brief The number of stored trajectories
+   * @return The number of occupied slots, 0 if no file is mapped.
+   */
+  std::size_t size() const;
+
+protected:
+
+  struct FileHeader;
+  struct IndexEntry;
+  struct SlotHeader;
+
+  /** @brief The header at the start of the file */
+  FileHeader* header() const;
+
+  /** @brief The index of the occupied slots which follows the header */
+  IndexEntry* index() const;
+
+  /**
+   * @brief The header of a slot, followed by the joint values of its trajectory in column major order
+   * @param slot  The slot
+   * @return The slot header
+   */
+  SlotHeader* slotHeader(std::size_t slot) const;
+
+  /**
+   * @brief The joint values of the trajectory stored in a slot
+   * @param slot  The slot
+   * @return The first joint value
+   */
+  double* slotData(std::size_t slot) const;
+
+  /**
+   * @brief Computes the value by which the index is sorted
+   * @param start The start joint values
+   * @param goal  The goal joint values
+   * @return The sum of the start and goal joint values
+   */
+  static double computeProjection(const Eigen::Ref<const Eigen::VectorXd>& start,
+                                  const Eigen::Ref<const Eigen::VectorXd>& goal);
+
+  /**
+   * @brief Finds the stored trajectory of a scene nearest to the start and goal, the file must be locked.
+   * @param start       The start joint values
+   * @param goal        The goal joint values
+   * @param scene_hash  The hash of the planning scene
+   * @param distance    The distance to the nearest stored trajectory
+   * @return The slot of the nearest trajectory within tolerance or -1 if none
+   */
+  int findNearest(const Eigen::Ref<const Eigen::VectorXd>& start, const Eigen::Ref<const Eigen::VectorXd>& goal,
+                  std::uint64_t scene_hash, double& distance) const;
+
+  /**
+   * @brief Removes a slot from the index, the file must be locked exclusively.
+   * @param slot  The slot
+   */
+  void removeFromIndex(std::size_t slot);
+
+  /**
+   * @brief Adds a slot to the index, the file must be locked exclusively.
+   * @param slot        The slot
+   * @param projection  The sum of the start and goal joint values of its trajectory
+   */
+  void addToIndex(std::size_t slot, double projection);
+
+  /**
+   * @brief Rebuilds the index from the occupied slots after a process was terminated while modifying the file, the
+   * file must be locked exclusively.
+   */
+  void rebuildIndex();
+
+protected:
+
+  std::string file_name_;                   /**< @brief The library file */
+  int fd_;                                  /**< @brief The descriptor of the library file, -1 if closed */
+  unsigned char* data_;                     /**< @brief The mapped file, null if closed */
+  std::size_t file_size_;                   /**< @brief The size of the mapped file */
+  std::size_t num_dimensions_;              /**< @brief The number of joints of the group */
+  std::size_t max_timesteps_;               /**< @brief The maximum number of timesteps of a stored trajectory */
+  std::size_t capacity_;                    /**< @brief The number of slots */
+  std::size_t slot_size_;                   /**< @brief The size of a slot in bytes */
+  double tolerance_;                        /**< @brief The maximum distance at which a stored trajectory is used */
+  mutable std::mutex mutex_;                /**< @brief Serializes the threads of this process, the file lock does not */
+};
+
+/**
+ * @brief Computes a hash of the collision objects of the world of a planning scene, their poses are rounded to the
+ * millimeter so that identical scenes published again hash the same.
+ * @param planning_scene  The planning scene
+ * @return The hash value
+ */
+std::uint64_t hashPlanningScene(const planning_scene::PlanningScene& planning_scene);
+
+} /* namespace utils */
+} /* namespace stomp_moveit */
+
+#endif /* INCLUDE_STOMP_MOVEIT_UTILS_EXPERIENCE_LIBRARY_H_ */
@@ -0,0 +1,71 @@
+/**
+ * @file instrumentation_publisher.h
+ * @brief Publishes the profile of every STOMP iteration on a ROS topic
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INCLUDE_STOMP_MOVEIT_UTILS_INSTRUMENTATION_PUBLISHER_H_
+#define INCLUDE_STOMP_MOVEIT_UTILS_INSTRUMENTATION_PUBLISHER_H_
+
+#include <ros/ros.h>
+#include <stomp_core/instrumentation.h>
+
+/**
+ * @namespace stomp_moveit
+ */
+namespace stomp_moveit
+{
+
+/**
+ * @namespace utils
+ */
+namespace utils
+{
+
+/**
+ * @brief An instrumentation sink that publishes a stomp_moveit/IterationProfile message at the end of every iteration.
+ * ros::Publisher is thread-safe, the sink may then be shared by the concurrent planning attempts.
+ */
+class InstrumentationPublisher: public stomp_core::InstrumentationSink
+{
+public:
+  /**
+   * @brief Constructor
+   * @param nh    The node handle the topic is advertised on
+   * @param topic The topic name
+   * @param group The planning group written in the messages
+   */
+  InstrumentationPublisher(ros::NodeHandle& nh,const std::string& topic,const std::string& group);
+
+  /** @brief See base class for documentation */
+  void recordIteration(const stomp_core::IterationProfile& profile) override;
+
+protected:
+  ros::Publisher publisher_;                          /**< @brief Publishes the profiles */
+  std::string group_;                                 /**< @brief The planning group */
+};
+
+} /* namespace utils */
+} /* namespace stomp_moveit */
+
+#endif /* INCLUDE_STOMP_MOVEIT_UTILS_INSTRUMENTATION_PUBLISHER_H_ */
@@ -0,0 +1,79 @@
+/**
+ * @file kernel_smoothing.h
+ * @brief Kernel smoothing of per timestep values in linear time
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INCLUDE_STOMP_MOVEIT_UTILS_KERNEL_SMOOTHING_H_
+#define INCLUDE_STOMP_MOVEIT_UTILS_KERNEL_SMOOTHING_H_
+
+#include <Eigen/Core>
+
+/**
+ * @namespace stomp_moveit
+ */
+namespace stomp_moveit
+{
+
+/**
+ * @namespace utils
+ */
+namespace utils
+{
+
+/**
+ * @namespace smoothing
+ */
+namespace smoothing
+{
+
+/**
+ * @brief Averages each value with its neighbors within half a window on either side, the values beyond the ends are
+ * those at the ends.  The window sums are differences of prefix sums so the cost does not depend on the window size.
+ * @param window_size The size of the window, it is forced into an odd number.
+ * @param data        The original values
+ * @param smoothed    The smoothed values [data.size()]
+ * @param workspace   Holds the prefix sums, it is only reallocated when the size of the data changes.
+ */
+void applyBoxKernel(std::size_t window_size, const Eigen::VectorXd& data, Eigen::VectorXd& smoothed,
+                    Eigen::MatrixXd& workspace);
+
+/**
+ * @brief Weights each value with its neighbors within half a window on either side using the Epanechnikov kernel
+ * 0.75*(1 - (j/window_size)^2) at an offset j, the values beyond the ends are those at the ends.  The quadratic kernel
+ * is expanded into the prefix sums of the values and of their first and second moments, therefore the cost does not
+ * depend on the window size.
+ * @param window_size The size of the window, it is forced into an odd number.
+ * @param data        The original values
+ * @param smoothed    The smoothed values [data.size()]
+ * @param workspace   Holds the prefix sums, it is only reallocated when the size of the data changes.
+ */
+void applyEpanechnikovKernel(std::size_t window_size, const Eigen::VectorXd& data, Eigen::VectorXd& smoothed,
+                             Eigen::MatrixXd& workspace);
+
+} /* namespace smoothing */
+} /* namespace utils */
+} /* namespace stomp_moveit */
+
+#endif /* INCLUDE_STOMP_MOVEIT_UTILS_KERNEL_SMOOTHING_H_ */
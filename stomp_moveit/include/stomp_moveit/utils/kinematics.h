@@ -279,12 +279,156 @@ namespace kinematics
     jacb_pseudo_inv = V * inv_Sv.asDiagonal() * U.transpose();
   }
 
+  /**
+   * @struct stomp_moveit::utils::kinematics::IKWorkspace
+   * @brief The cached group properties and the preallocated storage used by solveIK().  A workspace can be kept across calls for
+   * the same group so that no memory is allocated once it has been used, but it must not be shared by concurrent calls, each thread
+   * should own its workspace instead.
+   */
+  struct IKWorkspace
+  {
+    /**
+     * @brief Caches the properties of the group and allocates the storage.
+     * @param group The kinematic group. The tool link is assumed to be the last link in this group.
+     * @return  True if succeeded, false otherwise
+     */
+    bool initialize(const moveit::core::JointModelGroup* group)
+    {
+      using namespace Eigen;
+      using namespace moveit::core;
+
+      if(!group || group->getLinkModels().empty())
+      {
+        ROS_ERROR("IK workspace requires a group with at least one link");
+        return false;
+      }
+
+      joint_group = group;
+      tool_link = group->getLinkModels().back();
+
+      // bounds of the revolute joints, used to bring the joint values back within range
+      const std::vector<const JointModel*>& joint_models = group->getActiveJointModels();
+      revolute_joints.clear();
+      min_positions.resize(joint_models.size());
+      max_positions.resize(joint_models.size());
+      for(std::size_t i = 0; i < joint_models.size(); i++)
+      {
+        const JointModel::Bounds& bounds = joint_models[i]->getVariableBounds();
+        if(joint_models[i]->getType() != JointModel::REVOLUTE || bounds.empty())
+        {
+          continue;
+        }
+
+        revolute_joints.push_back(i);
+        min_positions(i) = bounds[0].min_position_;
+        max_positions(i) = bounds[0].max_position_;
+      }
+
+      // storage
+      int num_joints = group->getVariableCount();
+      constrained_dofs.resize(6);
+      indices.reserve(6);
+      tool_twist.resize(6);
+      tool_twist_reduced.resize(6);
+      delta_j.resize(num_joints);
+      null_space_proj.resize(num_joints);
+      jacb.resize(6,num_joints);
+      jacb_tool.resize(6,num_joints);
+      jacb_reduced.resize(6,num_joints);
+      jacb_pseudo_inv.resize(num_joints,6);
+      svd = JacobiSVD<MatrixXd>(6,num_joints,ComputeThinU | ComputeThinV);
+      inv_sv.resize(std::min(6,num_joints));
+      v_scaled.resize(num_joints,inv_sv.size());
+
+      return true;
+    }
+
+    /**
+     * @brief Sets the cartesian dofs that the jacobian pseudo inverse and the reduced twist are computed for.
+     * @param dofs  A vector of the form [x y z rx ry rz] filled with 0's and 1's to indicate an unconstrained or fully constrained DOF.
+     */
+    void setConstrainedDofs(const Eigen::Array<int,6,1>& dofs)
+    {
+      constrained_dofs = dofs;
+      indices.clear();
+      for(auto i = 0u; i < dofs.size(); i++)
+      {
+        if(dofs(i) != 0)
+        {
+          indices.push_back(i);
+        }
+      }
+      tool_twist_reduced.resize(indices.size());
+    }
+
+    const moveit::core::JointModelGroup* joint_group = nullptr;   /**< @brief The group the workspace was initialized for */
+    const moveit::core::LinkModel* tool_link = nullptr;           /**< @brief The last link of the group **/
+    std::vector<int> revolute_joints;                             /**< @brief Indices of the revolute joints among the active joints **/
+    Eigen::ArrayXd min_positions;                                 /**< @brief The lower position bound of the revolute joints **/
+    Eigen::ArrayXd max_positions;                                 /**< @brief The upper position bound of the revolute joints **/
+
+    Eigen::ArrayXi constrained_dofs;                              /**< @brief The constrained cartesian dofs of the current call **/
+    std::vector<int> indices;                                     /**< @brief The indices of the constrained cartesian dofs **/
+    Eigen::VectorXd tool_twist;                                   /**< @brief The tool twist [6 x 1] **/
+    Eigen::VectorXd tool_twist_reduced;                           /**< @brief The constrained entries of the tool twist **/
+    Eigen::VectorXd delta_j;                                      /**< @brief The joint update [num_dimensions x 1] **/
+    Eigen::VectorXd null_space_proj;                              /**< @brief The projection of the null space vector [num_dimensions x 1] **/
+    Eigen::VectorXd reduced_proj;                                 /**< @brief The null space vector mapped by the reduced jacobian **/
+    Eigen::MatrixXd jacb;                                         /**< @brief The jacobian in world coordinates [6 x num_dimensions] **/
+    Eigen::MatrixXd jacb_tool;                                    /**< @brief The jacobian in tool coordinates [6 x num_dimensions] **/
+    Eigen::MatrixXd jacb_reduced;                                 /**< @brief The constrained rows of the tool jacobian **/
+    Eigen::MatrixXd jacb_pseudo_inv;                              /**< @brief The damped pseudo inverse of the reduced jacobian **/
+    Eigen::JacobiSVD<Eigen::MatrixXd> svd;                        /**< @brief The decomposition of the reduced jacobian **/
+    Eigen::VectorXd inv_sv;                                       /**< @brief The damped reciprocal of the singular values **/
+    Eigen::MatrixXd v_scaled;                                     /**< @brief The right singular vectors scaled by inv_sv **/
+  };
+
+  /**
+   * @brief Computes the damped pseudo inverse of the tool jacobian in tool coordinates, reduced to the constrained dofs of the workspace.
+   * The results are stored in the 'jacb_reduced' and 'jacb_pseudo_inv' members of the workspace.
+   * @param robot_state The robot state, its link transforms must be up to date.
+   * @param workspace   The workspace initialized for the kinematic group and whose constrained dofs are set.
+   * @param tool_pose   The current pose of the tool link in world coordinates.
+   * @return  True if succeeded, false otherwise.
+   */
+  static bool computeToolJacobianPseudoInverse(moveit::core::RobotStatePtr robot_state, IKWorkspace& workspace,
+                                               const Eigen::Affine3d& tool_pose)
+  {
+    using namespace Eigen;
+
+    IKWorkspace& w = workspace;
+    if(!robot_state->getJacobian(w.joint_group,w.tool_link,Vector3d::Zero(),w.jacb))
+    {
+      ROS_ERROR("Failed to get Jacobian for link %s",w.tool_link->getName().c_str());
+      return false;
+    }
+
+    // transform jacobian to tool coordinates
+    Matrix3d rot = tool_pose.inverse().rotation();
+    w.jacb_tool.topRows(3).noalias() = rot*w.jacb.topRows(3);
+    w.jacb_tool.bottomRows(3).noalias() = rot*w.jacb.bottomRows(3);
+
+    // reduce jacobian and compute its damped pseudo inverse
+    reduceJacobian(w.jacb_tool,w.indices,w.jacb_reduced);
+    w.svd.compute(w.jacb_reduced,ComputeThinU | ComputeThinV);
+    const VectorXd& sv = w.svd.singularValues();
+    w.inv_sv.resize(sv.size());
+    for(auto i = 0u; i < sv.size(); ++i)
+    {
+      w.inv_sv(i) = std::fabs(sv(i)) > EPSILON ? 1/sv(i) : sv(i) / (sv(i)*sv(i) + LAMBDA*LAMBDA);
+    }
+    w.v_scaled.noalias() = w.svd.matrixV()*w.inv_sv.asDiagonal();
+    w.jacb_pseudo_inv.noalias() = w.v_scaled*w.svd.matrixU().transpose();
+
+    return true;
+  }
+
   /**
    * @brief Solves the inverse kinematics for a given tool pose using a gradient descent method.  It can handle under constrained DOFs for
    *  the cartesian tool pose and can also apply a vector onto the null space of the jacobian in order to meet a secondary objective.  It
    *  also checks for joint limits.
    * @param robot_state                       A pointer to the robot state.
-   * @param group_name                        The name of the kinematic group. The tool link name is assumed to be the last link in this group.
+   * @param workspace                         The workspace initialized for the kinematic group, it is used exclusively by this call.
    * @param constrained_dofs                  A vector of the form [x y z rx ry rz] filled with 0's and 1's to indicate an unconstrained or fully constrained DOF.
    * @param joint_update_rates                The weights to be applied to each update during every iteration [num_dimensions x 1].
    * @param cartesian_convergence_thresholds  The error margin for each dimension of the twist vector [6 x 1].
@@ -296,7 +440,7 @@ namespace kinematics
    * @param joint_pose                        IK joint solution [num_dimension x 1].
    * @return  True if a solution was found, false otherwise.
    */
-  static bool solveIK(moveit::core::RobotStatePtr robot_state, const std::string& group_name,
+  static bool solveIK(moveit::core::RobotStatePtr robot_state, IKWorkspace& workspace,
                       const Eigen::Array<int,6,1>& constrained_dofs,
                       const Eigen::ArrayXd& joint_update_rates,
                       const Eigen::Array<double,6,1>& cartesian_convergence_thresholds,
@@ -311,70 +455,44 @@ namespace kinematics
     using namespace Eigen;
     using namespace moveit::core;
 
+    IKWorkspace& w = workspace;
+    const JointModelGroup* joint_group = w.joint_group;
+    if(!joint_group || init_joint_pose.size() != w.delta_j.size())
+    {
+      ROS_ERROR("IK workspace was not initialized for a group with %i joints",static_cast<int>(init_joint_pose.size()));
+      return false;
+    }
+
     // joint variables
-    VectorXd delta_j = VectorXd::Zero(init_joint_pose.size());
     joint_pose = init_joint_pose;
-    const JointModelGroup* joint_group = robot_state->getJointModelGroup(group_name);
     robot_state->setJointGroupPositions(joint_group,joint_pose);
-    const auto& joint_names = joint_group->getActiveJointModelNames();
-    std::string tool_link = joint_group->getLinkModelNames().back();
-    Affine3d tool_current_pose = robot_state->getGlobalLinkTransform(tool_link);
+    robot_state->updateLinkTransforms();
+    Affine3d tool_current_pose = robot_state->getGlobalLinkTransform(w.tool_link);
 
-    auto harmonize_joints = [&joint_group,&joint_names](Eigen::VectorXd& joint_vals) -> bool
+    // brings the revolute joints back within their bounds
+    auto harmonize_joints = [&w](Eigen::VectorXd& joint_vals)
     {
-      if(joint_names.size() != joint_vals.size())
-      {
-        return false;
-      }
-
       const double incr = 2*M_PI;
-      for(std::size_t i = 0; i < joint_names.size();i++)
+      for(int i : w.revolute_joints)
       {
-        if( joint_group->getJointModel(joint_names[i])->getType() != JointModel::REVOLUTE )
+        double j = joint_vals(i);
+        while(j > w.max_positions(i))
         {
-          continue;
+          j-= incr;
         }
 
-        const JointModel::Bounds& bounds = joint_group->getJointModel(joint_names[i])->getVariableBounds();
-
-        double j = joint_vals(i);
-        for(const VariableBounds& b: bounds)
+        while(j < w.min_positions(i))
         {
-
-          while(j > b.max_position_)
-          {
-            j-= incr;
-          }
-
-          while(j < b.min_position_)
-          {
-            j += incr;
-          }
+          j += incr;
         }
 
         joint_vals(i) = j;
       }
-
-      return true;
     };
 
     // tool twist variables
-    VectorXd tool_twist, tool_twist_reduced;
-    std::vector<int> indices;
-    for(auto i = 0u; i < constrained_dofs.size(); i++)
-    {
-      if(constrained_dofs(i) != 0)
-      {
-        indices.push_back(i);
-      }
-    }
-    tool_twist_reduced = VectorXd::Zero(indices.size());
+    w.setConstrainedDofs(constrained_dofs);
 
-    // jacobian calculation variables
-    static MatrixXd jacb_transform(6,6);
-    MatrixXd jacb, jacb_reduced, jacb_pseudo_inv;
-    MatrixXd identity = MatrixXd::Identity(init_joint_pose.size(),init_joint_pose.size());
-    VectorXd null_space_proj;
     bool project_into_nullspace = (null_proj_weights.size()> 0) &&  (null_proj_weights >1e-8).any();
 
     unsigned int iteration_count = 0;
@@ -382,10 +500,10 @@ namespace kinematics
     while(iteration_count < max_iterations)
     {
       // computing twist vector
-      computeTwist(tool_current_pose,tool_goal_pose,constrained_dofs,tool_twist);
+      computeTwist(tool_current_pose,tool_goal_pose,w.constrained_dofs,w.tool_twist);
 
       // check convergence
-      if((tool_twist.cwiseAbs().array() <= cartesian_convergence_thresholds).all())
+      if((w.tool_twist.cwiseAbs().array() <= cartesian_convergence_thresholds).all())
       {
         if(robot_state->satisfiesBounds(joint_group))
         {
@@ -399,60 +517,107 @@ namespace kinematics
       }
 
       // updating reduced tool twist
-      for(auto i = 0u; i < indices.size(); i++)
+      for(auto i = 0u; i < w.indices.size(); i++)
       {
-        tool_twist_reduced(i) = tool_twist(indices[i]);
+        w.tool_twist_reduced(i) = w.tool_twist(w.indices[i]);
       }
 
-      // computing jacobian
-      if(!robot_state->getJacobian(joint_group,robot_state->getLinkModel(tool_link),Vector3d::Zero(),jacb))
+      // computing the reduced jacobian in tool coordinates and its pseudo inverse
+      if(!computeToolJacobianPseudoInverse(robot_state,w,tool_current_pose))
       {
-        ROS_ERROR("Failed to get Jacobian for link %s",tool_link.c_str());
         return false;
       }
 
-      // transform jacobian to tool coordinates
-      auto rot = tool_current_pose.inverse().rotation();
-      jacb_transform.setZero();
-      jacb_transform.block(0,0,3,3) = rot;
-      jacb_transform.block(3,3,3,3) = rot;
-      jacb = jacb_transform*jacb;
-
-      // reduce jacobian and compute its pseudo inverse
-      reduceJacobian(jacb,indices,jacb_reduced);
-      calculateDampedPseudoInverse(jacb_reduced,jacb_pseudo_inv,EPSILON,LAMBDA);
-
+      // computing joint change
+      w.delta_j.noalias() = w.jacb_pseudo_inv*w.tool_twist_reduced;
       if(project_into_nullspace)
       {
-        null_space_proj = (identity - jacb_pseudo_inv*jacb_reduced)*null_space_vector;
-        null_space_proj = (null_space_proj.array() * null_proj_weights).matrix();
-
-        // computing joint change
-        delta_j = (jacb_pseudo_inv*tool_twist_reduced) + null_space_proj;
-      }
-      else
-      {
-        // computing joint change
-        delta_j = (jacb_pseudo_inv*tool_twist_reduced);
+        // (I - J+ * J) * v
+        w.reduced_proj.noalias() = w.jacb_reduced*null_space_vector;
+        w.null_space_proj = null_space_vector;
+        w.null_space_proj.noalias() -= w.jacb_pseudo_inv*w.reduced_proj;
+        w.delta_j += (w.null_space_proj.array() * null_proj_weights).matrix();
       }
 
       // updating joint values
-      joint_pose += (joint_update_rates* delta_j.array()).matrix();
+      joint_pose += (joint_update_rates* w.delta_j.array()).matrix();
       harmonize_joints(joint_pose);
 
       // updating tool pose
       robot_state->setJointGroupPositions(joint_group,joint_pose);
       robot_state->updateLinkTransforms();
-      tool_current_pose = robot_state->getGlobalLinkTransform(tool_link);
+      tool_current_pose = robot_state->getGlobalLinkTransform(w.tool_link);
 
       iteration_count++;
     }
 
-    ROS_DEBUG_STREAM_COND(!converged,"Error tool twist "<<tool_twist.transpose());
+    ROS_DEBUG_STREAM_COND(!converged,"Error tool twist "<<w.tool_twist.transpose());
 
     return converged;
   }
 
+  /**
+   * @brief Solves the inverse kinematics for a given tool pose using a gradient descent method.  It can handle under constrained DOFs for
+   *  the cartesian tool pose and can also apply a vector onto the null space of the jacobian in order to meet a secondary objective.  It
+   *  also checks for joint limits.  A temporary workspace is used, callers that solve repeatedly should keep an IKWorkspace instead.
+   * @param robot_state                       A pointer to the robot state.
+   * @param group_name                        The name of the kinematic group. The tool link name is assumed to be the last link in this group.
+   * @param constrained_dofs                  A vector of the form [x y z rx ry rz] filled with 0's and 1's to indicate an unconstrained or fully constrained DOF.
+   * @param joint_update_rates                The weights to be applied to each update during every iteration [num_dimensions x 1].
+   * @param cartesian_convergence_thresholds  The error margin for each dimension of the twist vector [6 x 1].
+   * @param null_proj_weights                 The weights to be multiplied to the null space vector [num_dimension x 1].
+   * @param null_space_vector                 The null space vector which is applied into the jacobian's null space [num_dimension x 1].
+   * @param max_iterations                    The maximum number of iterations that the algorithm will run until convergence is reached.
+   * @param tool_goal_pose                    The desired tool pose.
+   * @param init_joint_pose                   Seed joint pose [num_dimension x 1].
+   * @param joint_pose                        IK joint solution [num_dimension x 1].
+   * @return  True if a solution was found, false otherwise.
+   */
+  static bool solveIK(moveit::core::RobotStatePtr robot_state, const std::string& group_name,
+                      const Eigen::Array<int,6,1>& constrained_dofs,
+                      const Eigen::ArrayXd& joint_update_rates,
+                      const Eigen::Array<double,6,1>& cartesian_convergence_thresholds,
+                      const Eigen::ArrayXd& null_proj_weights,
+                      const Eigen::VectorXd& null_space_vector,
+                      int max_iterations,
+                      const Eigen::Affine3d& tool_goal_pose,
+                      const Eigen::VectorXd& init_joint_pose,
+                      Eigen::VectorXd& joint_pose)
+  {
+    IKWorkspace workspace;
+    if(!workspace.initialize(robot_state->getJointModelGroup(group_name)))
+    {
+      return false;
+    }
+
+    return solveIK(robot_state,workspace,constrained_dofs,joint_update_rates,cartesian_convergence_thresholds,
+                   null_proj_weights,null_space_vector,max_iterations,tool_goal_pose,init_joint_pose,joint_pose);
+  }
+
+  /**
+   * @brief Solves the inverse kinematics for a given tool pose using a gradient descent method and a workspace kept by the caller.
+   * @param robot_state A pointer to the robot state.
+   * @param workspace   The workspace initialized for the kinematic group, it is used exclusively by this call.
+   * @param config      A structure containing the variables to be used in finding a solution.
+   * @param joint_pose  IK joint solution [num_dimension x 1].
+   * @return  True if a solution was found, false otherwise.
+   */
+  static bool solveIK(moveit::core::RobotStatePtr robot_state, IKWorkspace& workspace,const KinematicConfig& config, Eigen::VectorXd& joint_pose)
+  {
+
+    return solveIK(robot_state,
+                   workspace,
+                   config.constrained_dofs,
+                   config.joint_update_rates,
+                   config.cartesian_convergence_thresholds,
+                   config.null_proj_weights,
+                   config.null_space_vector,
+                   config.max_iterations,
+                   config.tool_goal_pose,
+                   config.init_joint_pose,
+                   joint_pose);
+  }
+
   /**
    * @brief Solves the inverse kinematics for a given tool pose using a gradient descent method.  It can handle under constrained DOFs for
    *  the cartesian tool pose and can also apply a vector onto the null space of the jacobian in order to meet a secondary objective.  It
@@ -502,9 +667,8 @@ namespace kinematics
     Affine3d tool_pose = state->getGlobalLinkTransform(tool_link);
 
     // jacobian calculations
-    static MatrixXd jacb_transform(6,6);
+    MatrixXd jacb_transform = MatrixXd::Zero(6,6);
     MatrixXd jacb, jacb_reduced, jacb_pseudo_inv;
-    jacb_transform.setZero();
 
     if(!state->getJacobian(joint_group,state->getLinkModel(tool_link),Vector3d::Zero(),jacb))
     {
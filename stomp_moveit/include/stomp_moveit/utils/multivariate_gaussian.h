@@ -39,11 +39,9 @@
 
 #include <Eigen/Core>
 #include <Eigen/Cholesky>
-#include <boost/random/variate_generator.hpp>
-#include <boost/random/normal_distribution.hpp>
-#include <boost/random/mersenne_twister.hpp>
 #include <boost/shared_ptr.hpp>
-#include <cstdlib>
+#include <cstdint>
+#include <stomp_moveit/utils/random.h>
 
 namespace stomp_moveit
 {
@@ -60,8 +58,25 @@ typedef std::shared_ptr<MultivariateGaussian> MultivariateGaussianPtr;
 class MultivariateGaussian
 {
 public:
+  /**
+   * @brief Constructor
+   * @param mean        The mean of the distribution
+   * @param covariance  The covariance of the distribution
+   * @param seed        The seed of the random values
+   */
   template <typename Derived1, typename Derived2>
-  MultivariateGaussian(const Eigen::MatrixBase<Derived1>& mean, const Eigen::MatrixBase<Derived2>& covariance);
+  MultivariateGaussian(const Eigen::MatrixBase<Derived1>& mean, const Eigen::MatrixBase<Derived2>& covariance,
+                       std::uint64_t seed = 0);
+
+  /**
+   * @brief Restarts the random values from the given seed
+   * @param seed  The seed of the random values
+   */
+  void setSeed(std::uint64_t seed)
+  {
+    seed_ = seed;
+    rng_.seed(seed);
+  }
 
   /**
    * @brief generates random values using a normal distribution.
@@ -71,46 +86,135 @@ public:
   template <typename Derived>
   void sample(Eigen::MatrixBase<Derived>& output,bool use_covariance = true);
 
+  /**
+   * @brief generates a batch of independent samples at once, the covariance is applied with a single matrix product.
+   * @param output          A matrix [size][num_samples] that receives one sample per column
+   * @param use_covariance  True to apply the covariance matrix onto the random values, false otherwise
+   */
+  template <typename Derived>
+  void sampleBatch(Eigen::MatrixBase<Derived>& output,bool use_covariance = true);
+
+  /**
+   * @brief generates a batch of samples where the column c is drawn from the random stream keyed by (seed, iteration, c),
+   * the samples are therefore reproducible and do not depend on the order in which the batches are requested.
+   * @param output          A matrix [size][num_samples] that receives one sample per column
+   * @param iteration       The iteration that keys the streams
+   * @param use_covariance  True to apply the covariance matrix onto the random values, false otherwise
+   */
+  template <typename Derived>
+  void sampleStreams(Eigen::MatrixBase<Derived>& output,std::uint64_t iteration,bool use_covariance = true);
+
+  /**
+   * @brief generates the sample drawn from the random stream keyed by (seed, iteration, stream), it equals the column
+   * 'stream' of sampleStreams().  It does not modify the distribution and may be called concurrently.
+   * @param output          The random values
+   * @param iteration       The iteration that keys the stream
+   * @param stream          The index of the stream within the iteration, e.g. the rollout
+   * @param normal          Storage for the standard normal values, owned by the calling thread
+   * @param use_covariance  True to apply the covariance matrix onto the random values, false otherwise
+   */
+  template <typename Derived>
+  void sampleStream(Eigen::MatrixBase<Derived>& output,std::uint64_t iteration,std::uint64_t stream,
+                    Eigen::VectorXd& normal,bool use_covariance = true) const;
+
 private:
   Eigen::VectorXd mean_;                /**< Mean of the gaussian distribution */
   Eigen::MatrixXd covariance_;          /**< Covariance of the gaussian distribution */
   Eigen::MatrixXd covariance_cholesky_; /**< Cholesky decomposition (LL^T) of the covariance */
 
   int size_;
-  boost::mt19937 rng_;
-  boost::normal_distribution<> normal_dist_;
-  std::shared_ptr<boost::variate_generator<boost::mt19937, boost::normal_distribution<> > > gaussian_;
+  std::uint64_t seed_;                  /**< The seed of the random values */
+  RandomNumberGenerator rng_;           /**< Generates the standard normal values */
+  Eigen::VectorXd sample_;              /**< Standard normal values of a single sample */
+  Eigen::MatrixXd batch_;               /**< Standard normal values of a batch of samples */
 };
 
 //////////////////////// template function definitions follow //////////////////////////////
 
 template <typename Derived1, typename Derived2>
-MultivariateGaussian::MultivariateGaussian(const Eigen::MatrixBase<Derived1>& mean, const Eigen::MatrixBase<Derived2>& covariance):
+MultivariateGaussian::MultivariateGaussian(const Eigen::MatrixBase<Derived1>& mean, const Eigen::MatrixBase<Derived2>& covariance,
+                                           std::uint64_t seed):
   mean_(mean),
   covariance_(covariance),
   covariance_cholesky_(covariance_.llt().matrixL()),
-  normal_dist_(0.0,1.0)
+  seed_(seed),
+  rng_(seed)
 {
-
-  rng_.seed(rand());
   size_ = mean.rows();
-  gaussian_.reset(new boost::variate_generator<boost::mt19937, boost::normal_distribution<> >(rng_, normal_dist_));
+  sample_.resize(size_);
 }
 
 template <typename Derived>
 void MultivariateGaussian::sample(Eigen::MatrixBase<Derived>& output,bool use_covariance)
 {
-  for (int i=0; i<size_; ++i)
-    output(i) = (*gaussian_)();
+  rng_.fillStandardNormal(sample_.array());
+
+  if(use_covariance)
+  {
+    output = mean_ + covariance_cholesky_.triangularView<Eigen::Lower>()*sample_;
+  }
+  else
+  {
+    output = mean_ + sample_;
+  }
+}
+
+template <typename Derived>
+void MultivariateGaussian::sampleBatch(Eigen::MatrixBase<Derived>& output,bool use_covariance)
+{
+  batch_.resize(size_,output.cols());
+  rng_.fillStandardNormal(Eigen::Map<Eigen::ArrayXd>(batch_.data(),batch_.size()));
+
+  if(use_covariance)
+  {
+    output.noalias() = covariance_cholesky_.triangularView<Eigen::Lower>()*batch_;
+  }
+  else
+  {
+    output = batch_;
+  }
+  output.colwise() += mean_;
+}
+
+template <typename Derived>
+void MultivariateGaussian::sampleStreams(Eigen::MatrixBase<Derived>& output,std::uint64_t iteration,bool use_covariance)
+{
+  batch_.resize(size_,output.cols());
+  for(auto c = 0u; c < batch_.cols(); c++)
+  {
+    rng_.seed(seed_,iteration,c);
+    rng_.fillStandardNormal(batch_.col(c).array());
+  }
+
+  if(use_covariance)
+  {
+    output.noalias() = covariance_cholesky_.triangularView<Eigen::Lower>()*batch_;
+  }
+  else
+  {
+    output = batch_;
+  }
+  output.colwise() += mean_;
+}
+
+template <typename Derived>
+void MultivariateGaussian::sampleStream(Eigen::MatrixBase<Derived>& output,std::uint64_t iteration,std::uint64_t stream,
+                                        Eigen::VectorXd& normal,bool use_covariance) const
+{
+  RandomNumberGenerator rng;
+  rng.seed(seed_,iteration,stream);
+  normal.resize(size_);
+  rng.fillStandardNormal(normal.array());
 
   if(use_covariance)
   {
-    output = mean_ + covariance_cholesky_*output;
+    output.noalias() = covariance_cholesky_.triangularView<Eigen::Lower>()*normal;
   }
   else
   {
-    output = mean_ + output;
+    output = normal;
   }
+  output += mean_;
 }
 
 }
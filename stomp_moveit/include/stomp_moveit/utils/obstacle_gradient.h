@@ -0,0 +1,89 @@
+/**
+ * @file obstacle_gradient.h
+ * @brief The distance from a planning group to the nearest obstacle and its gradient
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef INCLUDE_STOMP_MOVEIT_UTILS_OBSTACLE_GRADIENT_H_
+#define INCLUDE_STOMP_MOVEIT_UTILS_OBSTACLE_GRADIENT_H_
+
+#include <Eigen/Core>
+#include <moveit/robot_state/robot_state.h>
+#include <industrial_collision_detection/collision_detection/collision_world_industrial.h>
+
+/**
+ * @namespace stomp_moveit
+ */
+namespace stomp_moveit
+{
+
+/**
+ * @namespace utils
+ */
+namespace utils
+{
+
+/**
+ * @brief The nearest obstacle of a planning group, the world objects and the links outside of the allowed collision
+ * matrix are obstacles.
+ */
+struct ObstacleGradient
+{
+  ObstacleGradient():
+    distance(0.0),
+    link(nullptr),
+    link_point(Eigen::Vector3d::Zero()),
+    gradient(Eigen::Vector3d::Zero())
+  {
+
+  }
+
+  double distance;                        /**< @brief The distance to the nearest obstacle, negative or zero in collision */
+  const moveit::core::LinkModel* link;    /**< @brief The link nearest to the obstacle, null when none is within the threshold */
+  Eigen::Vector3d link_point;             /**< @brief The point of the link nearest to the obstacle in the model frame */
+  Eigen::Vector3d gradient;               /**< @brief The unit gradient of the distance with respect to the position of
+                                                      'link_point', zero when it is not defined */
+};
+
+/**
+ * @brief Computes the distance from the links of a group to the nearest obstacle and its gradient from the detailed
+ * self and world distances of the industrial collision checker.
+ * @param robot     The collision robot
+ * @param world     The collision world
+ * @param req       The request, it must not be global and its active components select the links of the group.  The
+ *                  detailed and gradient flags are required for the nearest points and the gradient.
+ * @param state     The state of the robot with its transforms up to date
+ * @param res       Workspace for the distance results, it is cleared first
+ * @param obstacle  The nearest obstacle
+ * @return True if an obstacle is within the distance threshold of the request, false otherwise.
+ */
+bool computeObstacleGradient(const collision_detection::CollisionRobotIndustrial& robot,
+                             const collision_detection::CollisionWorldIndustrial& world,
+                             const collision_detection::DistanceRequest& req,
+                             const moveit::core::RobotState& state,
+                             collision_detection::DistanceResult& res,
+                             ObstacleGradient& obstacle);
+
+} /* namespace utils */
+} /* namespace stomp_moveit */
+
+#endif /* INCLUDE_STOMP_MOVEIT_UTILS_OBSTACLE_GRADIENT_H_ */
@@ -0,0 +1,88 @@
+/**
+ * @file plan_capture.h
+ * @brief Records the inputs of a STOMP plan so that it can be replayed offline
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INCLUDE_STOMP_MOVEIT_UTILS_PLAN_CAPTURE_H_
+#define INCLUDE_STOMP_MOVEIT_UTILS_PLAN_CAPTURE_H_
+
+#include <cstdint>
+#include <string>
+#include <XmlRpcValue.h>
+#include <moveit_msgs/MotionPlanRequest.h>
+#include <moveit_msgs/PlanningScene.h>
+
+/**
+ * @namespace stomp_moveit
+ */
+namespace stomp_moveit
+{
+
+/**
+ * @namespace utils
+ */
+namespace utils
+{
+
+/**
+ * @brief The inputs and the outcome of a call to StompPlanner::solve(), written by the planner when plan capture is
+ * enabled and read by the replay tool of industrial_moveit_benchmarking.
+ *
+ * The file starts with the characters "STOMPCAP" and the format version as uint32, followed by the fields in the
+ * order they are declared, each one in the ROS message serialization format.  The configuration is stored as its
+ * XML-RPC representation.
+ */
+struct PlanCapture
+{
+  static const char MAGIC[8];                     /**< @brief The file signature "STOMPCAP" */
+  static const std::uint32_t VERSION = 1;         /**< @brief The file layout version */
+
+  std::string group;                              /**< @brief The planning group */
+  XmlRpc::XmlRpcValue config;                     /**< @brief The planner configuration of the group, with the 'optimization' and 'task' members */
+  std::int32_t seed;                              /**< @brief The seed of the noise of the first planning attempt */
+  std::string collision_detector;                 /**< @brief The active collision detector of the planning scene */
+  double planning_time;                           /**< @brief The wall time the plan took in seconds */
+  std::int32_t failure;                           /**< @brief The PlanFailures::PlanFailure of the plan */
+  moveit_msgs::MotionPlanRequest request;         /**< @brief The motion plan request */
+  moveit_msgs::PlanningScene scene;               /**< @brief The complete planning scene */
+
+  /**
+   * @brief Writes the capture to a file
+   * @param file_name The file path
+   * @return True if the file was written, otherwise false.
+   */
+  bool write(const std::string& file_name) const;
+
+  /**
+   * @brief Reads a capture from a file
+   * @param file_name The file path
+   * @return True if the file was read, otherwise false.
+   */
+  bool read(const std::string& file_name);
+};
+
+} /* namespace utils */
+} /* namespace stomp_moveit */
+
+#endif /* INCLUDE_STOMP_MOVEIT_UTILS_PLAN_CAPTURE_H_ */
@@ -0,0 +1,145 @@
+/**
+ * @file planner_metrics.h
+ * @brief Collects the latency and the outcome of the STOMP plans of every planning group
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INCLUDE_STOMP_MOVEIT_UTILS_PLANNER_METRICS_H_
+#define INCLUDE_STOMP_MOVEIT_UTILS_PLANNER_METRICS_H_
+
+#include <array>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <diagnostic_msgs/DiagnosticStatus.h>
+#include <stomp_core/utils.h>
+
+/**
+ * @namespace stomp_moveit
+ */
+namespace stomp_moveit
+{
+
+/**
+ * @namespace utils
+ */
+namespace utils
+{
+
+namespace PlanPhases
+{
+/** @brief The timed phases of StompPlanner::solve() */
+enum PlanPhase
+{
+  SETUP = 0,          /**< Sets up the optimization tasks of the planning attempt from the request */
+  OPTIMIZATION,       /**< Runs the STOMP optimization of the planning attempt */
+  CONVERSION,         /**< Converts the optimized parameters into a timed robot trajectory */
+  VALIDATION,         /**< Checks the trajectory against the planning scene */
+  TOTAL,              /**< The whole call to solve() */
+  NUM_PHASES
+};
+}
+
+namespace PlanFailures
+{
+/** @brief The reasons for which StompPlanner::solve() fails */
+enum PlanFailure
+{
+  NONE = 0,           /**< The plan succeeded */
+  ATTEMPTS,           /**< The planning attempts could not be allocated */
+  START_GOAL,         /**< The start and goal could not be extracted from the request */
+  SETUP,              /**< None of the planning attempts could be set up */
+  OPTIMIZATION,       /**< None of the planning attempts found a valid trajectory */
+  CONVERSION,         /**< The optimized parameters could not be converted into a robot trajectory */
+  INVALID_PATH,       /**< The trajectory is invalid in the planning scene */
+  NUM_FAILURES
+};
+}
+
+/** @brief The measurements of a single call to StompPlanner::solve() */
+struct PlanRecord
+{
+  PlanRecord();
+
+  std::array<double,PlanPhases::NUM_PHASES> durations;   /**< @brief The wall time of each phase in seconds, 0 if it did not run */
+  int iterations;                                        /**< @brief The iterations run by the optimizer of the reported attempt, -1 if it did not run */
+  stomp_core::TerminationReasons::TerminationReason termination_reason; /**< @brief Why the optimizer of the reported attempt stopped */
+  PlanFailures::PlanFailure failure;                     /**< @brief Why the plan failed */
+};
+
+/**
+ * @brief Keeps the latency and outcome of the last plans of every planning group and summarizes them as diagnostics.
+ * The phase durations and the iteration counts are kept in rolling windows of the last plans from which the
+ * percentiles are computed, the failures and termination reasons are counted since the creation.  This class is
+ * thread-safe, the planners of all the groups share a single instance.
+ */
+class PlannerMetrics
+{
+public:
+  /**
+   * @brief Constructor
+   * @param window_size The number of plans of each group kept for the percentiles
+   */
+  PlannerMetrics(std::size_t window_size = 1000);
+
+  /**
+   * @brief Records a plan
+   * @param group   The planning group
+   * @param record  The measurements of the plan
+   */
+  void record(const std::string& group,const PlanRecord& record);
+
+  /**
+   * @brief Summarizes the plans of every group that planned at least once, the statuses are named
+   * "stomp_planner: <group>".  The level is WARN when the last plan of the group failed, otherwise OK.
+   * @param statuses Returns a status per group
+   */
+  void getStatuses(std::vector<diagnostic_msgs::DiagnosticStatus>& statuses) const;
+
+protected:
+
+  /** @brief The metrics of a planning group */
+  struct GroupMetrics
+  {
+    std::array<std::vector<double>,PlanPhases::NUM_PHASES> durations;   /**< @brief Rolling windows of the phase durations */
+    std::vector<double> iterations;                                     /**< @brief Rolling window of the iteration counts */
+    std::size_t next;                                                   /**< @brief The window position written by the next plan */
+    std::size_t num_plans;                                              /**< @brief The number of plans recorded */
+    std::array<std::size_t,PlanFailures::NUM_FAILURES> failures;        /**< @brief The number of plans per outcome */
+    std::map<std::string,std::size_t> termination_reasons;              /**< @brief The number of optimizations per termination reason */
+    PlanFailures::PlanFailure last_failure;                             /**< @brief The outcome of the last plan */
+  };
+
+  std::size_t window_size_;                                             /**< @brief The number of plans kept per group */
+  mutable std::mutex mutex_;                                            /**< @brief Guards the metrics */
+  std::map<std::string,GroupMetrics> groups_;                           /**< @brief The metrics of each group */
+};
+
+typedef std::shared_ptr<PlannerMetrics> PlannerMetricsPtr; /**< @brief Type definition for the planner metrics shared pointer */
+
+} /* namespace utils */
+} /* namespace stomp_moveit */
+
+#endif /* INCLUDE_STOMP_MOVEIT_UTILS_PLANNER_METRICS_H_ */
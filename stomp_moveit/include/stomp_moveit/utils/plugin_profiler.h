@@ -0,0 +1,119 @@
+/**
+ * @file plugin_profiler.h
+ * @brief Measures the time spent in each STOMP plugin
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INCLUDE_STOMP_MOVEIT_UTILS_PLUGIN_PROFILER_H_
+#define INCLUDE_STOMP_MOVEIT_UTILS_PLUGIN_PROFILER_H_
+
+#include <array>
+#include <chrono>
+#include <string>
+#include <vector>
+
+/**
+ * @namespace stomp_moveit
+ */
+namespace stomp_moveit
+{
+
+/**
+ * @namespace utils
+ */
+namespace utils
+{
+
+/**
+ * @brief Accumulates the wall time and the number of calls of each plugin.  Every worker thread records into its own
+ * accumulators, selected by the index of the stomp_core::ThreadPool worker executing the call, so that recording never
+ * locks.  The distribution of the call durations is kept in a logarithmic histogram from which the percentiles are
+ * estimated within 19%.  Recording is thread-safe as long as each worker index is used by a single thread at a time.
+ */
+class PluginProfiler
+{
+public:
+
+  typedef std::chrono::steady_clock Clock;
+
+  /** @brief The time spent in a plugin */
+  struct Statistics
+  {
+    std::string name;       /**< @brief The plugin name */
+    std::size_t calls;      /**< @brief The number of calls */
+    double total_time;      /**< @brief The cumulative wall time in seconds */
+    double mean_time;       /**< @brief The mean time of a call in seconds */
+    double p50_time;        /**< @brief The median time of a call in seconds */
+    double p90_time;        /**< @brief The 90th percentile of the time of a call in seconds */
+    double p99_time;        /**< @brief The 99th percentile of the time of a call in seconds */
+  };
+
+  PluginProfiler();
+
+  /**
+   * @brief Allocates the accumulators and clears the statistics
+   * @param names       The name of each plugin, a plugin is identified by its index in this array
+   * @param num_workers The number of worker threads that record calls
+   */
+  void initialize(const std::vector<std::string>& names,std::size_t num_workers);
+
+  /**
+   * @brief Records a call from the calling worker thread, calls from unknown plugins or workers are ignored.
+   * @param plugin  The plugin index
+   * @param elapsed The duration of the call
+   */
+  void record(std::size_t plugin,Clock::duration elapsed);
+
+  /**
+   * @brief Merges the accumulators of all workers, it must not be called while calls are being recorded.
+   * @return The statistics of each plugin in the order of the names
+   */
+  std::vector<Statistics> getStatistics() const;
+
+  /**
+   * @brief Formats the statistics into one line per plugin
+   * @return The report
+   */
+  std::string toString() const;
+
+protected:
+
+  static const int BUCKETS_PER_OCTAVE = 4;            /**< @brief The histogram resolution */
+  static const int NUM_BUCKETS = 32*BUCKETS_PER_OCTAVE; /**< @brief Covers durations up to 2^32 nanoseconds */
+
+  /** @brief The calls of a plugin recorded by a worker */
+  struct Accumulator
+  {
+    std::size_t calls;                                  /**< @brief The number of calls */
+    Clock::duration total;                              /**< @brief The cumulative duration */
+    std::array<std::size_t,NUM_BUCKETS> histogram;      /**< @brief The number of calls in each duration bucket */
+  };
+
+  std::vector<std::string> names_;                      /**< @brief The plugin names */
+  std::vector< std::vector<Accumulator> > accumulators_;/**< @brief Per worker accumulators of each plugin [worker][plugin] */
+};
+
+} /* namespace utils */
+} /* namespace stomp_moveit */
+
+#endif /* INCLUDE_STOMP_MOVEIT_UTILS_PLUGIN_PROFILER_H_ */
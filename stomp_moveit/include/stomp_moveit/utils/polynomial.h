@@ -96,6 +96,52 @@ namespace polynomial
   };
 
 
+  /**
+   * @brief The fit applied by applyPolynomialSmoothing(), a polynomial through the first and last values of each row over
+   * the domain [0, 1] sampled uniformly.  The coefficients depend linearly on the values so the fit is factorized once
+   * for a number of timesteps and a polynomial order, and then applied to all the rows at once.
+   */
+  class EndpointPolynomialFit
+  {
+  public:
+    EndpointPolynomialFit(): num_timesteps_(0), poly_order_(0) {}
+
+    /**
+     * @brief Factorizes the fit
+     * @param num_timesteps The number of values of each row
+     * @param poly_order    The order of the polynomial
+     * @return False if the fit is not well posed, otherwise true
+     */
+    bool prepare(int num_timesteps, int poly_order);
+
+    /**
+     * @brief Checks if the fit was prepared for the arguments
+     * @param num_timesteps The number of values of each row
+     * @param poly_order    The order of the polynomial
+     * @return True if prepared, otherwise false
+     */
+    bool isPrepared(int num_timesteps, int poly_order) const
+    {
+      return num_timesteps_ == num_timesteps && poly_order_ == poly_order && coefficients_.size() > 0;
+    }
+
+    /** @brief The number of values of each row the fit was prepared for, zero if it is not prepared */
+    int getNumTimesteps() const { return num_timesteps_; }
+
+    /**
+     * @brief Replaces every row by its polynomial fit
+     * @param values The values [num_rows x num_timesteps]
+     */
+    void fit(Eigen::MatrixXd& values) const;
+
+  protected:
+    int num_timesteps_;                      /**< @brief The number of values of each row */
+    int poly_order_;                         /**< @brief The order of the polynomial */
+    Eigen::MatrixXd coefficients_;           /**< @brief Maps the values to the polynomial coefficients [num_timesteps x poly_order + 1] */
+    Eigen::MatrixXd vandermonde_;            /**< @brief The Vandermonde matrix of the domain [poly_order + 1 x num_timesteps] */
+    mutable Eigen::MatrixXd p_;              /**< @brief Preallocated polynomial coefficients of the rows */
+  };
+
   /**
    * @brief Fit a polynomial with fixed indices
    * @param request The polynimal fit request data
@@ -140,6 +186,18 @@ namespace polynomial
   bool applyPolynomialSmoothing(moveit::core::RobotModelConstPtr robot_model, const std::string& group_name, Eigen::MatrixXd& parameters,
                                        int poly_order = 5, double joint_limit_margin = 1e-5);
 
+  /**
+   * @brief Applies the same smoothing as the overload above using a fit prepared for the number of timesteps and order.
+   * @param robot_model
+   * @param group_name
+   * @param parameters
+   * @param fit                 The prepared fit
+   * @param joint_limit_margin
+   * @return
+   */
+  bool applyPolynomialSmoothing(moveit::core::RobotModelConstPtr robot_model, const std::string& group_name, Eigen::MatrixXd& parameters,
+                                const EndpointPolynomialFit& fit, double joint_limit_margin = 1e-5);
+
 } // end of namespace smoothing
 } // end of namespace utils
 } // end of namespace stomp_moveit
@@ -0,0 +1,129 @@
+/**
+ * @file random.h
+ * @brief A fast pseudo random number generator used for sampling noise
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INCLUDE_STOMP_MOVEIT_UTILS_RANDOM_H_
+#define INCLUDE_STOMP_MOVEIT_UTILS_RANDOM_H_
+
+#include <array>
+#include <cstdint>
+#include <Eigen/Core>
+
+/**
+ * @namespace stomp_moveit
+ */
+namespace stomp_moveit
+{
+
+/**
+ * @namespace utils
+ */
+namespace utils
+{
+
+/**
+ * @brief The xoshiro256** pseudo random number generator.  It is much cheaper than the mersenne twister and its
+ * state fits in four words, the state is initialized from the seed with the splitmix64 generator.
+ */
+class RandomNumberGenerator
+{
+public:
+
+  /**
+   * @brief Constructor
+   * @param seed  The seed of the sequence
+   */
+  explicit RandomNumberGenerator(std::uint64_t seed = 0);
+
+  /**
+   * @brief Restarts the sequence from the given seed
+   * @param seed  The seed of the sequence
+   */
+  void seed(std::uint64_t seed);
+
+  /**
+   * @brief Restarts the generator at the stream identified by the key, streams with different keys are independent so
+   * that every piece of work can draw from its own deterministic stream regardless of the thread that executes it.
+   * @param seed      The seed shared by all the streams
+   * @param iteration The iteration the stream is used for
+   * @param stream    The index of the stream within the iteration, e.g. the rollout
+   */
+  void seed(std::uint64_t seed, std::uint64_t iteration, std::uint64_t stream);
+
+  /**
+   * @brief Returns the next 64 bit value of the sequence
+   * @return A uniformly distributed value
+   */
+  std::uint64_t operator()()
+  {
+    const std::uint64_t result = rotl(state_[1] * 5, 7) * 9;
+    const std::uint64_t t = state_[1] << 17;
+    state_[2] ^= state_[0];
+    state_[3] ^= state_[1];
+    state_[1] ^= state_[2];
+    state_[0] ^= state_[3];
+    state_[2] ^= t;
+    state_[3] = rotl(state_[3], 45);
+    return result;
+  }
+
+  /**
+   * @brief Returns a uniformly distributed value in the interval (0, 1]
+   * @return The random value
+   */
+  double uniform()
+  {
+    return (static_cast<double>((*this)() >> 11) + 1.0) * (1.0 / 9007199254740992.0);
+  }
+
+  /**
+   * @brief Fills the output with standard normal values using the ziggurat method, which only needs one draw, a
+   * comparison and a multiplication for almost every value.
+   * @param output  The values to fill
+   */
+  void fillStandardNormal(Eigen::Ref<Eigen::ArrayXd> output);
+
+protected:
+
+  static std::uint64_t rotl(std::uint64_t x, int k)
+  {
+    return (x << k) | (x >> (64 - k));
+  }
+
+  /** @brief The splitmix64 finalizer, a bijective mixing of all the bits of its argument */
+  static std::uint64_t mix(std::uint64_t z)
+  {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  }
+
+  std::array<std::uint64_t,4> state_;   /**< The generator state */
+};
+
+} /* namespace utils */
+} /* namespace stomp_moveit */
+
+#endif /* INCLUDE_STOMP_MOVEIT_UTILS_RANDOM_H_ */
@@ -0,0 +1,95 @@
+/**
+ * @file rollout_states.h
+ * @brief The robot states of the timesteps of a rollout shared by the cost functions
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef INCLUDE_STOMP_MOVEIT_UTILS_ROLLOUT_STATES_H_
+#define INCLUDE_STOMP_MOVEIT_UTILS_ROLLOUT_STATES_H_
+
+#include <vector>
+#include <Eigen/Core>
+#include <moveit/robot_state/robot_state.h>
+
+/**
+ * @namespace stomp_moveit
+ */
+namespace stomp_moveit
+{
+
+/**
+ * @namespace utils
+ */
+namespace utils
+{
+
+/**
+ * @brief Keeps one robot state per timestep with its forward kinematics computed.  A state is only updated when it is
+ * requested with joint values that differ from those it holds, therefore the cost functions evaluating the same rollout
+ * share the forward kinematics and the timesteps left unchanged from one rollout to the next are not recomputed.  Each
+ * worker thread uses its own instance, the states of distinct timesteps can however be requested concurrently so that
+ * the cost functions may evaluate the timesteps of a rollout in parallel.
+ */
+class RolloutStates
+{
+public:
+
+  RolloutStates();
+
+  /**
+   * @brief Allocates the states from a reference state, the states are only reallocated when the robot model or the
+   * number of timesteps change.
+   * @param reference_state The state providing the values of the joints that are not in the group
+   * @param group_name      The planning group whose joints are set at each timestep
+   * @param num_timesteps   The number of timesteps
+   * @return False if the group does not exist, true otherwise.
+   */
+  bool initialize(const moveit::core::RobotState& reference_state, const std::string& group_name, std::size_t num_timesteps);
+
+  /** @brief The number of timesteps */
+  std::size_t size() const { return states_.size(); }
+
+  /**
+   * @brief Returns the state of a timestep with the given joint values of the group, its forward kinematics are only
+   * computed when the joint values differ from the previous request of that timestep.
+   * @param t             The timestep, must be less than size()
+   * @param joint_values  The joint values of the group
+   * @return The up to date state, valid until the next call to initialize()
+   */
+  const moveit::core::RobotState& getState(std::size_t t, const Eigen::Ref<const Eigen::VectorXd>& joint_values);
+
+  /** @brief The number of forward kinematics computed since initialize(), useful to evaluate the reuse */
+  std::size_t getNumUpdates() const;
+
+protected:
+
+  const moveit::core::JointModelGroup* joint_group_;      /**< @brief The planning group */
+  std::vector<moveit::core::RobotStatePtr> states_;       /**< @brief The state of each timestep */
+  Eigen::MatrixXd joint_values_;                          /**< @brief The group joint values held by each state [dimensions][timesteps] */
+  std::vector<char> valid_;                               /**< @brief Whether each state holds the values in 'joint_values_' */
+  std::vector<std::size_t> num_updates_;                  /**< @brief The forward kinematics computed for each timestep since initialize() */
+};
+
+} /* namespace utils */
+} /* namespace stomp_moveit */
+
+#endif /* INCLUDE_STOMP_MOVEIT_UTILS_ROLLOUT_STATES_H_ */
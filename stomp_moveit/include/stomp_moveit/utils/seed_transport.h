@@ -0,0 +1,118 @@
+/**
+ * @file seed_transport.h
+ * @brief Passes seed trajectories to the planner by reference instead of serializing them into the request
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INCLUDE_STOMP_MOVEIT_UTILS_SEED_TRANSPORT_H_
+#define INCLUDE_STOMP_MOVEIT_UTILS_SEED_TRANSPORT_H_
+
+#include <memory>
+#include <string>
+#include <Eigen/Core>
+#include <moveit_msgs/TrajectoryConstraints.h>
+
+/**
+ * @namespace stomp_moveit
+ */
+namespace stomp_moveit
+{
+
+/**
+ * @namespace utils
+ */
+namespace utils
+{
+
+/**
+ * @namespace seeds
+ *
+ * A seed trajectory is a matrix [num joints][num points] of the active joints of the planning group in the order of
+ * the group.  Instead of one moveit_msgs::Constraints per point the request holds a single one whose name references
+ * the matrix, which is either registered with the process planning the request or written to a shared memory object.
+ * The planner then copies the matrix straight into the seed parameters.
+ */
+namespace seeds
+{
+
+/** @brief The prefix of the name of the constraints that reference a seed */
+static const std::string SEED_REFERENCE_PREFIX = "stomp_seed:";
+
+/**
+ * @brief Registers a seed with the process, the requests planned in the same process may then reference it.
+ * @param parameters  The seed [num joints][num points], it is shared and not copied
+ * @return The reference to the seed, see encodeSeedReference()
+ */
+std::string registerLocalSeed(std::shared_ptr<const Eigen::MatrixXd> parameters);
+
+/**
+ * @brief Unregisters a seed from the process, the requests that reference it no longer find it.
+ * @param reference The reference returned by registerLocalSeed()
+ */
+void releaseLocalSeed(const std::string& reference);
+
+/**
+ * @brief Writes a seed to a shared memory object so that the requests planned by other processes of the same machine
+ * may reference it.  An existing object of the same name is replaced.
+ * @param name        The name of the shared memory object, without slashes
+ * @param parameters  The seed [num joints][num points]
+ * @param reference   Returns the reference to the seed, see encodeSeedReference()
+ * @return True if the seed was written, otherwise false.
+ */
+bool writeSharedSeed(const std::string& name, const Eigen::MatrixXd& parameters, std::string& reference);
+
+/**
+ * @brief Removes a shared memory object written by writeSharedSeed()
+ * @param name  The name of the shared memory object
+ */
+void removeSharedSeed(const std::string& name);
+
+/**
+ * @brief Wraps a seed reference into trajectory constraints that can be added to a moveit planning request
+ * @param reference The reference to the seed
+ * @return The trajectory constraints
+ */
+moveit_msgs::TrajectoryConstraints encodeSeedReference(const std::string& reference);
+
+/**
+ * @brief Whether trajectory constraints reference a seed
+ * @param constraints The trajectory constraints of a request
+ * @param reference   Returns the reference to the seed
+ * @return True if the constraints reference a seed, otherwise false.
+ */
+bool decodeSeedReference(const moveit_msgs::TrajectoryConstraints& constraints, std::string& reference);
+
+/**
+ * @brief Copies a referenced seed
+ * @param reference   The reference to the seed
+ * @param num_joints  The number of joints of the planning group, a seed with a different number of rows is rejected
+ * @param parameters  Returns the seed [num joints][num points]
+ * @return True if the seed was found and has 'num_joints' rows, otherwise false.
+ */
+bool readSeed(const std::string& reference, std::size_t num_joints, Eigen::MatrixXd& parameters);
+
+} /* namespace seeds */
+} /* namespace utils */
+} /* namespace stomp_moveit */
+
+#endif /* INCLUDE_STOMP_MOVEIT_UTILS_SEED_TRANSPORT_H_ */
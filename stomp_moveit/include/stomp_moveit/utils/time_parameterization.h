@@ -0,0 +1,89 @@
+/**
+ * @file time_parameterization.h
+ * @brief Fast time parameterization of the evenly spaced STOMP trajectories
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INCLUDE_STOMP_MOVEIT_UTILS_TIME_PARAMETERIZATION_H_
+#define INCLUDE_STOMP_MOVEIT_UTILS_TIME_PARAMETERIZATION_H_
+
+#include <moveit/robot_model/joint_model_group.h>
+#include <trajectory_msgs/JointTrajectory.h>
+#include <Eigen/Core>
+
+/**
+ * @namespace stomp_moveit
+ */
+namespace stomp_moveit
+{
+
+/**
+ * @namespace utils
+ */
+namespace utils
+{
+
+/**
+ * @namespace time_parameterization
+ */
+namespace time_parameterization
+{
+
+/**
+ * @brief Times the evenly spaced waypoints of a trajectory with the shortest common timestep that keeps every joint
+ * within its velocity and acceleration limits.  The velocities and accelerations are the finite differences of the
+ * waypoints at 'delta_t' stretched by the same factor as the timestep, which takes a single linear pass over the
+ * trajectory. The first and last waypoints are at rest.
+ * @param group                 The joint group, its active joints are the rows of 'parameters'
+ * @param parameters            The joint values [num joints][num_timesteps], at least stomp_core::FINITE_DIFF_RULE_LENGTH timesteps
+ * @param delta_t               The timestep between consecutive waypoints that the optimization used
+ * @param velocity_scaling      The fraction of the velocity limits to use, values outside (0, 1] use the full limits
+ * @param acceleration_scaling  The fraction of the acceleration limits to use, values outside (0, 1] use the full limits
+ * @param velocities            Returns the joint velocities [num joints][num_timesteps]
+ * @param accelerations         Returns the joint accelerations [num joints][num_timesteps]
+ * @param timestep              Returns the time between consecutive waypoints
+ * @return False when the trajectory has too few waypoints or does not match the group, otherwise true.
+ */
+bool computeUniformTimeScaling(const moveit::core::JointModelGroup* group,const Eigen::MatrixXd& parameters,
+                               double delta_t,double velocity_scaling,double acceleration_scaling,
+                               Eigen::MatrixXd& velocities,Eigen::MatrixXd& accelerations,double& timestep);
+
+/**
+ * @brief Times the evenly spaced waypoints of a trajectory, see the overload above.
+ * @param group                 The joint group, its active joints are the rows of 'parameters'
+ * @param parameters            The joint values [num joints][num_timesteps], at least stomp_core::FINITE_DIFF_RULE_LENGTH timesteps
+ * @param delta_t               The timestep between consecutive waypoints that the optimization used
+ * @param velocity_scaling      The fraction of the velocity limits to use, values outside (0, 1] use the full limits
+ * @param acceleration_scaling  The fraction of the acceleration limits to use, values outside (0, 1] use the full limits
+ * @param trajectory            Returns the timed trajectory
+ * @return False when the trajectory has too few waypoints or does not match the group, otherwise true.
+ */
+bool computeUniformTimeScaling(const moveit::core::JointModelGroup* group,const Eigen::MatrixXd& parameters,
+                               double delta_t,double velocity_scaling,double acceleration_scaling,
+                               trajectory_msgs::JointTrajectory& trajectory);
+
+} // end of namespace time_parameterization
+} // end of namespace utils
+} // end of namespace stomp_moveit
+
+#endif /* INCLUDE_STOMP_MOVEIT_UTILS_TIME_PARAMETERIZATION_H_ */
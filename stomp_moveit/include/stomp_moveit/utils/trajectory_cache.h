@@ -0,0 +1,122 @@
+/**
+ * @file trajectory_cache.h
+ * @brief A cache of optimized trajectories used to warm start the planner
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef INCLUDE_STOMP_MOVEIT_UTILS_TRAJECTORY_CACHE_H_
+#define INCLUDE_STOMP_MOVEIT_UTILS_TRAJECTORY_CACHE_H_
+
+#include <mutex>
+#include <vector>
+#include <Eigen/Core>
+
+/**
+ * @namespace stomp_moveit
+ */
+namespace stomp_moveit
+{
+
+/**
+ * @namespace utils
+ */
+namespace utils
+{
+
+/**
+ * @brief Stores previously optimized trajectories and retrieves the one whose start and goal joint values are the
+ * nearest to a new request.  The distance between two entries is the sum of the absolute joint differences of their
+ * start and goal configurations.  This class is thread-safe.
+ */
+class TrajectoryCache
+{
+public:
+
+  /**
+   * @brief Constructor
+   * @param max_entries The maximum number of trajectories stored, 0 disables the cache
+   * @param tolerance   The maximum distance at which a stored trajectory is used
+   */
+  TrajectoryCache(std::size_t max_entries = 0, double tolerance = 0.0);
+
+  /**
+   * @brief Changes the cache capacity and tolerance, the stored trajectories are dropped.
+   * @param max_entries The maximum number of trajectories stored, 0 disables the cache
+   * @param tolerance   The maximum distance at which a stored trajectory is used
+   */
+  void configure(std::size_t max_entries, double tolerance);
+
+  /**
+   * @brief Stores a trajectory, it replaces a stored one within tolerance or else the oldest once the cache is full.
+   * @param parameters  The optimized trajectory [num_dimensions][num_timesteps], its first and last columns are the
+   *                    start and goal configurations.
+   */
+  void insert(const Eigen::MatrixXd& parameters);
+
+  /**
+   * @brief Retrieves the nearest stored trajectory within tolerance. Its end points are moved onto the requested start
+   * and goal by blending the offsets linearly along the trajectory.
+   * @param start       The requested start joint values
+   * @param goal        The requested goal joint values
+   * @param parameters  The output trajectory [num_dimensions][num_timesteps]
+   * @return True if a trajectory was found, otherwise false.
+   */
+  bool lookup(const Eigen::VectorXd& start, const Eigen::VectorXd& goal, Eigen::MatrixXd& parameters) const;
+
+  /**
+   * @brief Drops all the stored trajectories
+   */
+  void clear();
+
+  /**
+   * @brief Moves the end points of a trajectory onto a start and goal by blending the offsets linearly along it.
+   * @param start       The start joint values
+   * @param goal        The goal joint values
+   * @param parameters  The trajectory [num_dimensions][num_timesteps] modified in place
+   */
+  static void blendEndPoints(const Eigen::VectorXd& start, const Eigen::VectorXd& goal, Eigen::MatrixXd& parameters);
+
+protected:
+
+  /**
+   * @brief Finds the stored trajectory nearest to the start and goal, the mutex must be locked.
+   * @param start     The start joint values
+   * @param goal      The goal joint values
+   * @param distance  The distance to the nearest stored trajectory
+   * @return The index of the nearest trajectory or -1 if empty
+   */
+  int findNearest(const Eigen::VectorXd& start, const Eigen::VectorXd& goal, double& distance) const;
+
+protected:
+
+  std::size_t max_entries_;                 /**< @brief The maximum number of stored trajectories */
+  double tolerance_;                        /**< @brief The maximum distance at which a stored trajectory is used */
+  std::size_t next_entry_;                  /**< @brief The entry replaced next once the cache is full */
+  std::vector<Eigen::MatrixXd> entries_;    /**< @brief The stored trajectories */
+  mutable std::mutex mutex_;                /**< @brief Guards the stored trajectories */
+};
+
+} /* namespace utils */
+} /* namespace stomp_moveit */
+
+#endif /* INCLUDE_STOMP_MOVEIT_UTILS_TRAJECTORY_CACHE_H_ */
@@ -0,0 +1,66 @@
+#!/usr/bin/env python
+"""
+Loads the binary log written by the stomp_moveit/UpdateLogger plugin into numpy arrays.
+
+Usage:
+  python load_update_log.py file_name.bin
+
+From python:
+  from load_update_log import load_update_log
+  log = load_update_log('file_name.bin')
+  log['updates'][i]     # the updates of the i-th record [num_dimensions x num_timesteps]
+"""
+
+import sys
+import numpy
+
+HEADER_DTYPE = numpy.dtype([('magic', 'S8'),
+                            ('version', '<u4'),
+                            ('header_size', '<u4'),
+                            ('num_dimensions', '<u4'),
+                            ('num_timesteps', '<u4'),
+                            ('record_size', '<u8'),
+                            ('num_records', '<u8'),
+                            ('dropped_records', '<u8'),
+                            ('reserved', 'S16')])
+
+
+def record_dtype(num_dimensions, num_timesteps):
+    shape = (num_dimensions, num_timesteps)
+    return numpy.dtype([('iteration', '<i8'),
+                        ('cost', '<f8'),
+                        ('parameters', '<f8', shape),
+                        ('updates', '<f8', shape)])
+
+
+def load_update_log(file_name, mmap=True):
+    """
+    Returns a structured array with the fields 'iteration', 'cost', 'parameters' and 'updates', one entry per record.
+    The file is memory mapped unless 'mmap' is False.  A file that was not closed properly still loads, the number of
+    records is then deduced from the file size.
+    """
+    header = numpy.fromfile(file_name, dtype=HEADER_DTYPE, count=1)[0]
+    if header['magic'] != b'STOMPLOG':
+        raise ValueError('%s is not a stomp update log' % file_name)
+
+    dtype = record_dtype(int(header['num_dimensions']), int(header['num_timesteps']))
+    if dtype.itemsize != header['record_size']:
+        raise ValueError('%s has records of %i bytes, expected %i' % (file_name, header['record_size'], dtype.itemsize))
+
+    offset = int(header['header_size'])
+    if mmap:
+        return numpy.memmap(file_name, dtype=dtype, mode='r', offset=offset)
+
+    with open(file_name, 'rb') as f:
+        f.seek(offset)
+        return numpy.fromfile(f, dtype=dtype)
+
+
+if __name__ == '__main__':
+    if len(sys.argv) != 2:
+        print(__doc__)
+        sys.exit(1)
+
+    log = load_update_log(sys.argv[1])
+    print('%i records, iterations %i to %i, final cost %f' %
+          (len(log), log['iteration'][0], log['iteration'][-1], log['cost'][-1]))
@@ -27,96 +27,13 @@
 #include <pluginlib/class_list_macros.h>
 #include <moveit/robot_state/conversions.h>
 #include "stomp_moveit/cost_functions/collision_check.h"
+#include "stomp_moveit/utils/experience_library.h"
+#include "stomp_moveit/utils/kernel_smoothing.h"
 
 PLUGINLIB_EXPORT_CLASS(stomp_moveit::cost_functions::CollisionCheck,stomp_moveit::cost_functions::StompCostFunction)
 
 static const int MIN_KERNEL_WINDOW_SIZE = 3;
-
-/**
- * @brief Convenience method that propagates the cost value at center to the window to the adjacent points.
- * @param window_size   Size of the kernel, must be less than the size of the  'data' array.
- * @param data          The original data vector
- * @param smoothed      The smoothed data after applying the kernel.
- */
-static void applyKernelSmoothing(std::size_t window_size, const Eigen::VectorXd& data, Eigen::VectorXd& smoothed)
-{
-  using namespace Eigen;
-
-  // allocation
-  window_size = 2*(window_size/2) + 1;// forcing it into an odd number
-  smoothed.setZero(data.size());
-  VectorXd x_nneighbors = VectorXd::Zero(window_size);
-  VectorXd y_nneighbors = VectorXd::Zero(window_size);
-  VectorXd kernel_weights = VectorXd::Zero(window_size);
-
-
-  // indexing
-  int index_left, index_right;
-  std::size_t window_index_middle = window_size/2;
-
-  // kernel function
-  //Epanechnikov(x,neighbors,lambda)
-  auto epanechnikov_function = [](double x_m,const VectorXd& neighbors,double lambda, VectorXd& weights )
-  {
-
-    double t = 0;
-    for(int i = 0; i < neighbors.size(); i++)
-    {
-      t = std::abs(x_m - neighbors(i))/lambda;
-      if(t < 1)
-      {
-        weights(i) = 0.75f*(1 - std::pow(t,2));
-      }
-      else
-      {
-        weights(i) = 0;
-      }
-    }
-
-  };
-
-  for(int i = 0; i < data.size(); i++)
-  {
-    // middle term
-    x_nneighbors(window_index_middle) = i;
-    y_nneighbors(window_index_middle) = data(i);
-
-    // grabbing neighbors
-    for(int j = 1; j <= window_size/2; j++)
-    {
-      index_left = i - j;
-      index_right = i + j;
-
-      if(index_left < 0)
-      {
-        x_nneighbors(window_index_middle - j) = 0;
-        y_nneighbors(window_index_middle - j) = data(0);
-      }
-      else
-      {
-        x_nneighbors(window_index_middle - j) = index_left;
-        y_nneighbors(window_index_middle - j) = data(index_left);
-      }
-
-      if(index_right > data.rows()-1)
-      {
-        x_nneighbors(window_index_middle + j) = data.rows()-1;
-        y_nneighbors(window_index_middle + j) = data(data.rows() - 1);
-      }
-      else
-      {
-        x_nneighbors(window_index_middle + j) = index_right;
-        y_nneighbors(window_index_middle + j) = data(index_right);
-      }
-
-    }
-
-    epanechnikov_function(i,x_nneighbors,window_size,kernel_weights);
-    smoothed(i) = (y_nneighbors.array()*kernel_weights.array()).sum()/kernel_weights.sum();
-  }
-
-
-}
+static const int DEFAULT_CACHE_SIZE = 65536;
 
 namespace stomp_moveit
 {
@@ -126,7 +43,15 @@ namespace cost_functions
 CollisionCheck::CollisionCheck():
     name_("CollisionCheckPlugin"),
     robot_state_(),
-    collision_penalty_(0.0)
+    collision_penalty_(0.0),
+    coarse_stride_(1),
+    coarse_padding_(0.0),
+    timestep_threads_(1),
+    cache_resolution_(0.0),
+    cache_size_(0),
+    certified_(false),
+    state_cache_(new utils::ConfigurationCache()),
+    coarse_cache_(new utils::ConfigurationCache())
 {
   // TODO Auto-generated constructor stub
 
@@ -162,29 +87,90 @@ bool CollisionCheck::setMotionPlanRequest(const planning_scene::PlanningSceneCon
   collision_request_.distance = false;
   collision_request_.max_contacts = 1;
   collision_request_.max_contacts_per_pair = 1;
-  collision_request_.contacts = true;
+  collision_request_.contacts = false;
   collision_request_.verbose = false;
 
   collision_robot_ = planning_scene->getCollisionRobot();
   collision_world_ = planning_scene->getCollisionWorld();
+  industrial_collision_world_ = std::dynamic_pointer_cast<const collision_detection::CollisionWorldIndustrial>(collision_world_);
+
+  // the pairs are filtered by bit tests during the request, the names are looked up once per scene
+  acm_bits_.reset();
+  if(industrial_collision_world_)
+  {
+    acm_bits_.reset(new collision_detection::AllowedCollisionBitMatrix(planning_scene->getAllowedCollisionMatrix()));
+  }
+
+  // without cached results the industrial checker computes the states of a range itself, see checkTrajectoryStates()
+  industrial_collision_robot_.reset();
+  if(industrial_collision_world_ && !state_cache_->isEnabled())
+  {
+    industrial_collision_robot_ =
+        std::dynamic_pointer_cast<const collision_detection::CollisionRobotIndustrial>(collision_robot_);
+  }
+
+  // the coarse checks use a copy of the collision robot whose links are all padded further
+  coarse_collision_robot_.reset();
+  if(coarse_stride_ > 1)
+  {
+    planning_scene::PlanningScenePtr coarse_scene = planning_scene->diff();
+    collision_detection::CollisionRobotPtr padded_robot = coarse_scene->getCollisionRobotNonConst();
+    std::map<std::string, double> link_padding = padded_robot->getLinkPadding();
+    for(auto& lp : link_padding)
+    {
+      lp.second += coarse_padding_;
+    }
+    padded_robot->setLinkPadding(link_padding);
+    coarse_collision_robot_ = padded_robot;
+  }
 
   // storing robot state
-  robot_state_.reset(new RobotState(robot_model_ptr_));
+  // the states are only reallocated when the robot model changes, otherwise the start state is just reassigned
+  if(!robot_state_ || robot_state_->getRobotModel() != robot_model_ptr_)
+  {
+    robot_state_.reset(new RobotState(robot_model_ptr_));
+  }
   if(!robotStateMsgToRobotState(req.start_state,*robot_state_,true))
   {
     ROS_ERROR("%s Failed to get current robot state from request",getName().c_str());
     return false;
   }
 
-  // copying into intermediate robot states
-  for(auto& rs : intermediate_coll_states_)
+  // the cached results depend on the scene and on the joints outside of the group, the clones share the caches and
+  // leave them as the first one set them
+  if(state_cache_->isEnabled())
   {
-    rs.reset(new RobotState(*robot_state_));
+    std::uint64_t context = utils::ConfigurationCache::hashContext(planning_scene.get(),
+        utils::hashPlanningScene(*planning_scene),
+        Eigen::Map<const Eigen::VectorXd>(robot_state_->getVariablePositions(),robot_state_->getVariableCount()));
+    state_cache_->setContext(context);
+    coarse_cache_->setContext(context);
   }
 
-  // allocating arrays
-  raw_costs_ = Eigen::VectorXd::Zero(config.num_timesteps);
+  // each timestep thread only changes the joints of the group on its copies of the start state
+  contexts_.resize(timestep_pool_->size());
+  for(auto& context : contexts_)
+  {
+    for(auto rs : {&context.state, &context.intermediate_state})
+    {
+      if(*rs && (*rs)->getRobotModel() == robot_model_ptr_)
+      {
+        **rs = *robot_state_;
+      }
+      else
+      {
+        rs->reset(new RobotState(*robot_state_));
+      }
+    }
+    context.intermediate_positions.setZero(robot_model_ptr_->getJointModelGroup(group_name_)->getVariableCount());
+  }
 
+  // allocating arrays
+  raw_costs_.setZero(config.num_timesteps);
+  state_colliding_.assign(config.num_timesteps,0);
+  interval_free_.assign(config.num_timesteps,1);
+  coarse_free_.assign(config.num_timesteps,1);
+  certified_ = false;
 
   return true;
 }
@@ -207,82 +193,80 @@ bool CollisionCheck::computeCosts(const Eigen::MatrixXd& parameters,
     return false;
   }
 
-  typedef collision_detection::CollisionResult::ContactMap ContactMap;
-  typedef ContactMap::iterator ContactMapIterator;
-  typedef std::vector<collision_detection::Contact> ContactArray;
-
   // initializing result array
   costs = Eigen::VectorXd::Zero(num_timesteps);
 
   // resetting array
   raw_costs_.setZero();
-
-  // collision
-  collision_detection::CollisionRequest request = collision_request_;
-  collision_detection::CollisionResult result_world_collision, result_robot_collision;
-  std::vector<collision_detection::CollisionResult> results(2);
   validity = true;
 
-  // planning groups
-  const JointModelGroup* joint_group = robot_model_ptr_->getJointModelGroup(group_name_);
-
   if(parameters.cols()< (start_timestep + num_timesteps))
   {
     ROS_ERROR_STREAM("Size in the 'parameters' matrix is less than required");
     return false;
   }
 
-  // check for collisions at each state
-  bool skip_next_check = false;
-  for (auto t=start_timestep; t<start_timestep + num_timesteps; ++t)
+  if(start_timestep + num_timesteps > state_colliding_.size())
+  {
+    ROS_ERROR("%s the timesteps exceed those of the motion plan request",getName().c_str());
+    return false;
+  }
+
+  std::size_t last_timestep = start_timestep + num_timesteps - 1;
+  if(coarse_collision_robot_ && num_timesteps > 1)
   {
-    if(!skip_next_check)
+    // checking every coarse_stride_ timestep and the last one with the padded robot
+    std::size_t num_samples = (num_timesteps - 2)/coarse_stride_ + 2;
+    auto sample_timestep = [&](std::size_t k)
+    {
+      return std::min<std::size_t>(start_timestep + k*coarse_stride_,last_timestep);
+    };
+    timestep_pool_->parallelFor(num_samples,[&](std::size_t k, std::size_t worker)
+    {
+      coarse_free_[k] = !isColliding(contexts_[worker],parameters,sample_timestep(k),*coarse_collision_robot_);
+    });
+
+    // the segments whose ends are both free are taken as free and keep a zero cost, the others are merged into runs
+    // that are checked exactly
+    bool refining = false;
+    std::size_t refine_start = start_timestep;
+    for(auto k = 0u; k + 1 < num_samples; k++)
     {
-      robot_state_->setJointGroupPositions(joint_group,parameters.col(t));
-      robot_state_->update();
-
-      // checking robot vs world (attached objects, octomap, not in urdf) collisions
-      result_world_collision.distance = std::numeric_limits<double>::max();
-
-      collision_world_->checkRobotCollision(request,
-                                            result_world_collision,
-                                            *collision_robot_,
-                                            *robot_state_,
-                                            planning_scene_->getAllowedCollisionMatrix());
-
-      collision_robot_->checkSelfCollision(request,
-                                           result_robot_collision,
-                                           *robot_state_,
-                                           planning_scene_->getAllowedCollisionMatrix());
-
-      results[0]= result_world_collision;
-      results[1] = result_robot_collision;
-      for(std::vector<collision_detection::CollisionResult>::iterator i = results.begin(); i != results.end(); i++)
+      std::size_t t = sample_timestep(k);
+      bool previous_free = coarse_free_[k];
+      bool next_free = coarse_free_[k + 1];
+      if(!previous_free || !next_free)
       {
-        collision_detection::CollisionResult& result = *i;
-        if(result.collision)
+        if(!refining)
         {
-          raw_costs_(t) = collision_penalty_;
-          validity = false;
-          break;
+          refine_start = t;
+          refining = true;
         }
       }
+      else if(refining)
+      {
+        validity = checkTimesteps(parameters,refine_start,t) && validity;
+        refining = false;
+      }
     }
 
-    // check intermediate poses to the next position (skip the last one)
-    if(t  < start_timestep + num_timesteps - 1)
+    if(refining)
     {
-      if(!checkIntermediateCollisions(parameters.col(t),parameters.col(t+1),longest_valid_joint_move_))
-      {
-        raw_costs_(t) = 1.0;
-        raw_costs_(t+1) = 1.0;
-        validity = false;
-        skip_next_check = true;
-      }
-      else
-      {
-        skip_next_check = false;
-      }
+      validity = checkTimesteps(parameters,refine_start,last_timestep) && validity;
+    }
+  }
+  else
+  {
+    validity = checkTimesteps(parameters,start_timestep,last_timestep);
+  }
+
+  // the optimized parameters are certified when all of their timesteps were checked exactly
+  if(rollout_number < 0)
+  {
+    certified_ = validity && !coarse_collision_robot_ && start_timestep == 0 && num_timesteps == parameters.cols();
+    if(certified_)
+    {
+      certified_parameters_ = parameters;
     }
   }
 
@@ -300,11 +284,12 @@ bool CollisionCheck::computeCosts(const Eigen::MatrixXd& parameters,
       raw_costs_ += (raw_costs_.sum()/raw_costs_.size())*(intermediate_costs_slots_.matrix());
 
       // smoothing
-      applyKernelSmoothing(window_size,raw_costs_,costs);
+      utils::smoothing::applyEpanechnikovKernel(window_size,raw_costs_,smoothed_costs_,smoothing_workspace_);
+      costs = smoothed_costs_.segment(start_timestep,num_timesteps);
     }
     else
     {
-      costs = raw_costs_;
+      costs = raw_costs_.segment(start_timestep,num_timesteps);
     }
 
   }
@@ -312,44 +297,167 @@ bool CollisionCheck::computeCosts(const Eigen::MatrixXd& parameters,
   return true;
 }
 
-bool CollisionCheck::checkIntermediateCollisions(const Eigen::VectorXd& start,
-                                                           const Eigen::VectorXd& end,double longest_valid_joint_move)
+bool CollisionCheck::getValidityCertificate(ValidityCertificate& certificate) const
 {
-  Eigen::VectorXd diff = end - start;
-  int num_intermediate = std::ceil(((diff.cwiseAbs())/longest_valid_joint_move).maxCoeff()) - 1;
+  if(!certified_)
+  {
+    return false;
+  }
+
+  certificate.collisions_checked = true;
+  certificate.longest_valid_joint_move = longest_valid_joint_move_;
+  certificate.planning_scene = planning_scene_.get();
+  certificate.parameters = certified_parameters_;
+  return true;
+}
+
+bool CollisionCheck::isColliding(TimestepContext& context,const Eigen::MatrixXd& parameters, std::size_t t,
+                                 const collision_detection::CollisionRobot& robot)
+{
+  utils::ConfigurationCache& cache = &robot == coarse_collision_robot_.get() ? *coarse_cache_ : *state_cache_;
+  double colliding;
+  if(cache.lookup(parameters.col(t),colliding))
+  {
+    return colliding > 0.0;
+  }
+
+  const moveit::core::JointModelGroup* joint_group = robot_model_ptr_->getJointModelGroup(group_name_);
+  bool result = isStateColliding(context,getTimestepState(parameters,t,joint_group,*context.state),robot);
+  cache.insert(parameters.col(t),result ? 1.0 : 0.0);
+  return result;
+}
+
+bool CollisionCheck::isStateColliding(TimestepContext& context,const moveit::core::RobotState& state,
+                                      const collision_detection::CollisionRobot& robot)
+{
+  // only whether the state collides matters, the industrial world answers it without generating contacts
+  if(industrial_collision_world_)
+  {
+    return industrial_collision_world_->isRobotColliding(robot,state,group_name_,
+                                                         &planning_scene_->getAllowedCollisionMatrix(),
+                                                         acm_bits_.get());
+  }
+
+  collision_detection::CollisionResult& result = context.result;
+  result.clear();
+
+  // checking robot vs world (attached objects, octomap, not in urdf) collisions
+  collision_world_->checkRobotCollision(collision_request_,result,robot,state,
+                                        planning_scene_->getAllowedCollisionMatrix());
+  if(result.collision)
+  {
+    return true;
+  }
+
+  result.clear();
+  robot.checkSelfCollision(collision_request_,result,state,planning_scene_->getAllowedCollisionMatrix());
+  return result.collision;
+}
+
+bool CollisionCheck::checkTimesteps(const Eigen::MatrixXd& parameters,std::size_t first,std::size_t last)
+{
+  // the intermediate poses first since a timestep that follows a colliding interval is not checked
+  timestep_pool_->parallelFor(last - first,[&](std::size_t i, std::size_t worker)
+  {
+    std::size_t t = first + i;
+    interval_free_[t] = checkIntermediateCollisions(contexts_[worker],parameters.col(t),parameters.col(t+1),
+                                                    longest_valid_joint_move_);
+  });
+
+  // the states are computed by the trajectory queries unless the Task shares them
+  if(rollout_states_ || !industrial_collision_robot_ || !checkTrajectoryStates(parameters,first,last))
+  {
+    timestep_pool_->parallelFor(last - first + 1,[&](std::size_t i, std::size_t worker)
+    {
+      std::size_t t = first + i;
+      bool skip_check = t > first && !interval_free_[t-1];
+      state_colliding_[t] = !skip_check && isColliding(contexts_[worker],parameters,t,*collision_robot_);
+    });
+  }
+
+  bool valid = true;
+  for(auto t = first; t <= last; ++t)
+  {
+    if(state_colliding_[t])
+    {
+      raw_costs_(t) = collision_penalty_;
+      valid = false;
+    }
+
+    // the intermediate poses to the next position (skip the last one)
+    if(t < last && !interval_free_[t])
+    {
+      raw_costs_(t) = 1.0;
+      raw_costs_(t+1) = 1.0;
+      valid = false;
+    }
+  }
+
+  return valid;
+}
+
+bool CollisionCheck::checkTrajectoryStates(const Eigen::MatrixXd& parameters,std::size_t first,std::size_t last)
+{
+  trajectory_ = parameters.middleCols(first,last - first + 1);
+  const collision_detection::AllowedCollisionMatrix& acm = planning_scene_->getAllowedCollisionMatrix();
+  if(!industrial_collision_world_->checkTrajectoryCollision(collision_request_,world_results_,*collision_robot_,
+                                                            *robot_state_,trajectory_,&acm,timestep_threads_) ||
+     !industrial_collision_robot_->checkSelfTrajectoryCollision(collision_request_,self_results_,*robot_state_,
+                                                                trajectory_,&acm,timestep_threads_))
+  {
+    return false;
+  }
+
+  for(auto t = first; t <= last; ++t)
+  {
+    bool skip_check = t > first && !interval_free_[t-1];
+    state_colliding_[t] = !skip_check && (world_results_.collisions(t - first) || self_results_.collisions(t - first));
+  }
+
+  return true;
+}
+
+bool CollisionCheck::checkIntermediateCollisions(TimestepContext& context,
+                                                 const Eigen::Ref<const Eigen::VectorXd>& start,
+                                                 const Eigen::Ref<const Eigen::VectorXd>& end,
+                                                 double longest_valid_joint_move)
+{
+  int num_intermediate = std::ceil(((end - start).cwiseAbs()/longest_valid_joint_move).maxCoeff()) - 1;
   if(num_intermediate < 1.0)
   {
     // no interpolation needed
     return true;
   }
 
-  // grabbing states
-  auto& start_state = intermediate_coll_states_[0];
-  auto& mid_state = intermediate_coll_states_[1];
-  auto& end_state = intermediate_coll_states_[2];
-
-  if(!start_state || !mid_state || !end_state)
+  if(!context.intermediate_state)
   {
-    ROS_ERROR("%s intermediate states not initialized",getName().c_str());
+    ROS_ERROR("%s intermediate state not initialized",getName().c_str());
     return false;
   }
 
-  // setting up collision
-  auto req = collision_request_;
-  req.distance = false;
-  collision_detection::CollisionResult res;
+  // checking intermediate states, only the joint values of the group are interpolated
   const moveit::core::JointModelGroup* joint_group = robot_model_ptr_->getJointModelGroup(group_name_);
-  start_state->setJointGroupPositions(joint_group,start);
-  end_state->setJointGroupPositions(joint_group,end);
-
-  // checking intermediate states
   double dt = 1.0/static_cast<double>(num_intermediate);
   double interval = 0.0;
   for(std::size_t i = 1; i < num_intermediate;i++)
   {
     interval = i*dt;
-    start_state->interpolate(*end_state,interval,*mid_state) ;
-    if(planning_scene_->isStateColliding(*mid_state))
+    joint_group->interpolate(start.data(),end.data(),interval,context.intermediate_positions.data());
+    double colliding;
+    if(state_cache_->lookup(context.intermediate_positions,colliding))
+    {
+      if(colliding > 0.0)
+      {
+        return false;
+      }
+      continue;
+    }
+
+    context.intermediate_state->setJointGroupPositions(joint_group,context.intermediate_positions);
+    context.intermediate_state->update();
+    bool result = isStateColliding(context,*context.intermediate_state,*collision_robot_);
+    state_cache_->insert(context.intermediate_positions,result ? 1.0 : 0.0);
+    if(result)
     {
       return false;
     }
@@ -390,6 +498,22 @@ bool CollisionCheck::configure(const XmlRpc::XmlRpcValue& config)
     collision_penalty_ = static_cast<double>(c["collision_penalty"]);
     kernel_window_percentage_ = static_cast<double>(c["kernel_window_percentage"]);
     longest_valid_joint_move_ = static_cast<double>(c["longest_valid_joint_move"]);
+    coarse_stride_ = c.hasMember("coarse_stride") ? static_cast<int>(c["coarse_stride"]) : 1;
+    coarse_padding_ = c.hasMember("coarse_padding") ? static_cast<double>(c["coarse_padding"]) : 0.0;
+    timestep_threads_ = c.hasMember("timestep_threads") ? static_cast<int>(c["timestep_threads"]) : 1;
+    cache_resolution_ = c.hasMember("cache_resolution") ? static_cast<double>(c["cache_resolution"]) : 0.0;
+    cache_size_ = c.hasMember("cache_size") ? static_cast<int>(c["cache_size"]) : DEFAULT_CACHE_SIZE;
+    if(coarse_stride_ > 1 && coarse_padding_ <= 0.0)
+    {
+      ROS_ERROR("%s the 'coarse_padding' parameter must be positive when 'coarse_stride' is greater than 1",getName().c_str());
+      return false;
+    }
+
+    if(timestep_threads_ < 1)
+    {
+      ROS_ERROR("%s the 'timestep_threads' parameter must be at least 1",getName().c_str());
+      return false;
+    }
   }
   catch(XmlRpc::XmlRpcException& e)
   {
@@ -397,12 +521,23 @@ bool CollisionCheck::configure(const XmlRpc::XmlRpcValue& config)
     return false;
   }
 
+  // a single thread checks the timesteps serially on the calling thread
+  if(!timestep_pool_ || timestep_pool_->size() != static_cast<std::size_t>(timestep_threads_))
+  {
+    timestep_pool_.reset(new stomp_core::ThreadPool(timestep_threads_));
+  }
+
+  const moveit::core::JointModelGroup* joint_group = robot_model_ptr_->getJointModelGroup(group_name_);
+  std::size_t num_dimensions = joint_group ? joint_group->getVariableCount() : 0;
+  state_cache_->configure(num_dimensions,cache_resolution_,std::max(cache_size_,0));
+  coarse_cache_->configure(num_dimensions,cache_resolution_,coarse_stride_ > 1 ? std::max(cache_size_,0) : 0);
+
   return true;
 }
 
 void CollisionCheck::done(bool success,int total_iterations,double final_cost,const Eigen::MatrixXd& parameters)
 {
-  robot_state_.reset();
+  // the robot states are kept so that the next request reuses them
 }
 
 } /* namespace cost_functions */
@@ -28,9 +28,11 @@
 #include <ros/console.h>
 #include <pluginlib/class_list_macros.h>
 #include <moveit/robot_state/conversions.h>
+#include <stomp_moveit/utils/experience_library.h>
 
 PLUGINLIB_EXPORT_CLASS(stomp_moveit::cost_functions::ObstacleDistanceGradient,stomp_moveit::cost_functions::StompCostFunction)
 static const double LONGEST_VALID_JOINT_MOVE = 0.01;
+static const int DEFAULT_CACHE_SIZE = 65536;
 
 namespace stomp_moveit
 {
@@ -39,7 +41,15 @@ namespace cost_functions
 
 ObstacleDistanceGradient::ObstacleDistanceGradient() :
     name_("ObstacleDistanceGradient"),
-    robot_state_()
+    robot_state_(),
+    compute_gradients_(false),
+    timestep_threads_(1),
+    cache_resolution_(0.0),
+    cache_size_(0),
+    lod_margin_(std::numeric_limits<double>::max()),
+    sphere_fast_path_(false),
+    distance_cache_(new utils::ConfigurationCache()),
+    collision_cache_(new utils::ConfigurationCache())
 {
 
 }
@@ -89,6 +99,17 @@ bool ObstacleDistanceGradient::configure(const XmlRpc::XmlRpcValue& config)
     {
       ROS_WARN("%s using default value for 'longest_valid_joint_move' of %f",getName().c_str(),longest_valid_joint_move_);
     }
+    compute_gradients_ = c.hasMember("compute_gradients") ? static_cast<bool>(c["compute_gradients"]) : false;
+    timestep_threads_ = c.hasMember("timestep_threads") ? static_cast<int>(c["timestep_threads"]) : 1;
+    cache_resolution_ = c.hasMember("cache_resolution") ? static_cast<double>(c["cache_resolution"]) : 0.0;
+    cache_size_ = c.hasMember("cache_size") ? static_cast<int>(c["cache_size"]) : DEFAULT_CACHE_SIZE;
+    lod_margin_ = c.hasMember("lod_margin") ? static_cast<double>(c["lod_margin"]) : std::numeric_limits<double>::max();
+    sphere_fast_path_ = c.hasMember("sphere_fast_path") ? static_cast<bool>(c["sphere_fast_path"]) : false;
+    if(timestep_threads_ < 1)
+    {
+      ROS_ERROR("%s the 'timestep_threads' parameter must be at least 1",getName().c_str());
+      return false;
+    }
   }
   catch(XmlRpc::XmlRpcException& e)
   {
@@ -96,6 +117,26 @@ bool ObstacleDistanceGradient::configure(const XmlRpc::XmlRpcValue& config)
     return false;
   }
 
+  // the spheres are generated once and cached on disk
+  if(compute_gradients_ && sphere_fast_path_ && !sphere_model_)
+  {
+    sphere_model_ = collision_detection::RobotSphereModel::create(robot_model_ptr_,
+                                                                  collision_detection::RobotSphereModel::Parameters(),
+                                                                  collision_detection::RobotSphereModel::getDefaultCacheDirectory());
+  }
+
+  // a single thread evaluates the timesteps serially on the calling thread
+  if(!timestep_pool_ || timestep_pool_->size() != static_cast<std::size_t>(timestep_threads_))
+  {
+    timestep_pool_.reset(new stomp_core::ThreadPool(timestep_threads_));
+  }
+
+  // the gradients are not cached, their distances are computed every time
+  const moveit::core::JointModelGroup* joint_group = robot_model_ptr_->getJointModelGroup(group_name_);
+  std::size_t num_dimensions = joint_group ? joint_group->getVariableCount() : 0;
+  distance_cache_->configure(num_dimensions,cache_resolution_,compute_gradients_ ? 0 : std::max(cache_size_,0));
+  collision_cache_->configure(num_dimensions,cache_resolution_,std::max(cache_size_,0));
+
   return true;
 }
 
@@ -111,7 +152,11 @@ bool ObstacleDistanceGradient::setMotionPlanRequest(const planning_scene::Planni
   error_code.val = moveit_msgs::MoveItErrorCodes::SUCCESS;
 
   // storing robot state
-  robot_state_.reset(new RobotState(robot_model_ptr_));
+  // the states are only reallocated when the robot model changes, otherwise the start state is just reassigned
+  if(!robot_state_ || robot_state_->getRobotModel() != robot_model_ptr_)
+  {
+    robot_state_.reset(new RobotState(robot_model_ptr_));
+  }
 
   if(!robotStateMsgToRobotState(req.start_state,*robot_state_,true))
   {
@@ -119,10 +164,65 @@ bool ObstacleDistanceGradient::setMotionPlanRequest(const planning_scene::Planni
     return false;
   }
 
-  // copying into intermediate robot states
-  for(auto& rs : intermediate_coll_states_)
+  // the cached results depend on the scene and on the joints outside of the group, the clones share the caches and
+  // leave them as the first one set them
+  if(collision_cache_->isEnabled())
   {
-    rs.reset(new RobotState(*robot_state_));
+    std::uint64_t context = utils::ConfigurationCache::hashContext(planning_scene.get(),
+        utils::hashPlanningScene(*planning_scene),
+        Eigen::Map<const Eigen::VectorXd>(robot_state_->getVariablePositions(),robot_state_->getVariableCount()));
+    distance_cache_->setContext(context);
+    collision_cache_->setContext(context);
+  }
+
+  // each timestep thread only changes the joints of the group on its copies of the start state
+  contexts_.resize(timestep_pool_->size());
+  for(auto& context : contexts_)
+  {
+    for(auto rs : {&context.state, &context.intermediate_state})
+    {
+      if(*rs && (*rs)->getRobotModel() == robot_model_ptr_)
+      {
+        **rs = *robot_state_;
+      }
+      else
+      {
+        rs->reset(new RobotState(*robot_state_));
+      }
+    }
+    context.intermediate_positions.setZero(robot_model_ptr_->getJointModelGroup(group_name_)->getVariableCount());
+  }
+  interval_free_.assign(config.num_timesteps,1);
+  distances_.setZero(config.num_timesteps);
+
+  // the gradients require the detailed distances of the industrial collision checker
+  industrial_robot_.reset();
+  industrial_world_.reset();
+  if(compute_gradients_)
+  {
+    industrial_robot_ = std::dynamic_pointer_cast<const collision_detection::CollisionRobotIndustrial>(
+        planning_scene->getCollisionRobot());
+    industrial_world_ = std::dynamic_pointer_cast<const collision_detection::CollisionWorldIndustrial>(
+        planning_scene->getCollisionWorld());
+    if(!industrial_robot_ || !industrial_world_)
+    {
+      ROS_ERROR("%s 'compute_gradients' requires the industrial collision detector",getName().c_str());
+      error_code.val = moveit_msgs::MoveItErrorCodes::FAILURE;
+      return false;
+    }
+
+    const JointModelGroup* joint_group = robot_model_ptr_->getJointModelGroup(group_name_);
+    distance_request_ = collision_detection::DistanceRequest(true,false,joint_group->getUpdatedLinkModelsWithGeometrySet(),
+                                                             planning_scene->getAllowedCollisionMatrix(),max_distance_);
+    distance_request_.gradient = true;
+    acm_bits_.reset(new collision_detection::AllowedCollisionBitMatrix(planning_scene->getAllowedCollisionMatrix()));
+    distance_request_.acm_bits = acm_bits_.get();
+    distance_request_.lod_margin = lod_margin_;
+    distance_request_.sphere_model = sphere_fast_path_ ? sphere_model_.get() : NULL;
+    for(auto& context : contexts_)
+    {
+      context.distance_result.resize(robot_model_ptr_->getLinkModelCount());
+    }
   }
 
   return true;
@@ -151,99 +251,141 @@ bool ObstacleDistanceGradient::computeCosts(const Eigen::MatrixXd& parameters, s
     return false;
   }
 
+  if(start_timestep + num_timesteps > interval_free_.size())
+  {
+    ROS_ERROR("%s the timesteps exceed those of the motion plan request",getName().c_str());
+    return false;
+  }
+
+  if(compute_gradients_)
+  {
+    gradients_.assign(num_timesteps,utils::ObstacleGradient());
+  }
+
+  // the intermediate poses first since a timestep that follows a colliding interval is not evaluated
+  std::size_t last_timestep = start_timestep + num_timesteps - 1;
+  timestep_pool_->parallelFor(num_timesteps > 1 ? num_timesteps - 1 : 0,[&](std::size_t i, std::size_t worker)
+  {
+    std::size_t t = start_timestep + i;
+    interval_free_[t] = checkIntermediateCollisions(contexts_[worker],parameters.col(t),parameters.col(t+1),
+                                                    longest_valid_joint_move_);
+  });
+
   // request the distance at each state
+  utils::ObstacleGradient unused;
+  timestep_pool_->parallelFor(num_timesteps,[&](std::size_t i, std::size_t worker)
+  {
+    std::size_t t = start_timestep + i;
+    if(t == start_timestep || interval_free_[t-1])
+    {
+      distances_(t) = computeDistance(contexts_[worker],parameters,t,compute_gradients_ ? gradients_[i] : unused);
+    }
+  });
+
   double dist;
-  bool skip_next_check = false;
   validity = true;
   for (auto t=start_timestep; t<start_timestep + num_timesteps; ++t)
   {
-
-    if(!skip_next_check)
+    bool skip_check = t > start_timestep && !interval_free_[t-1];
+    if(!skip_check)
     {
-      collision_result_.clear();
-      robot_state_->setJointGroupPositions(joint_group,parameters.col(t));
-      robot_state_->update();
-      collision_result_.distance = max_distance_;
-
-      planning_scene_->checkSelfCollision(collision_request_,collision_result_,*robot_state_,planning_scene_->getAllowedCollisionMatrix());
-      dist = collision_result_.collision ? -1.0 :collision_result_.distance ;
-
+      dist = distances_(t);
       if(dist >= max_distance_)
       {
-        costs(t) = 0; // away from obstacle
+        costs(t - start_timestep) = 0; // away from obstacle
       }
       else if(dist < 0)
       {
-        costs(t) = 1.0; // in collision
+        costs(t - start_timestep) = 1.0; // in collision
         validity = false;
       }
       else
       {
-        costs(t) = (max_distance_ - dist)/max_distance_;
+        costs(t - start_timestep) = (max_distance_ - dist)/max_distance_;
       }
     }
 
-    skip_next_check = false;
-
-    // check intermediate poses to the next position (skip the last one)
-    if(t  < start_timestep + num_timesteps - 1)
+    // the intermediate poses to the next position (skip the last one)
+    if(t < last_timestep && !interval_free_[t])
     {
-      if(!checkIntermediateCollisions(parameters.col(t),parameters.col(t+1),longest_valid_joint_move_))
-      {
-        costs(t) = 1.0;
-        costs(t+1) = 1.0;
-        validity = false;
-        skip_next_check = true;
-      }
-      else
-      {
-        skip_next_check = false;
-      }
+      costs(t - start_timestep) = 1.0;
+      costs(t - start_timestep + 1) = 1.0;
+      validity = false;
     }
-
   }
 
   return true;
 }
 
-bool ObstacleDistanceGradient::checkIntermediateCollisions(const Eigen::VectorXd& start,
-                                                           const Eigen::VectorXd& end,double longest_valid_joint_move)
+double ObstacleDistanceGradient::computeDistance(TimestepContext& context,const Eigen::MatrixXd& parameters,
+                                                 std::size_t t,utils::ObstacleGradient& obstacle)
 {
-  Eigen::VectorXd diff = end - start;
-  int num_intermediate = std::ceil(((diff.cwiseAbs())/longest_valid_joint_move).maxCoeff()) - 1;
+  double distance;
+  if(distance_cache_->lookup(parameters.col(t),distance))
+  {
+    return distance;
+  }
+
+  const moveit::core::JointModelGroup* joint_group = robot_model_ptr_->getJointModelGroup(group_name_);
+  const moveit::core::RobotState& state = getTimestepState(parameters,t,joint_group,*context.state);
+  if(compute_gradients_)
+  {
+    // the distance to the world objects and the other links with the nearest points and the gradient
+    utils::computeObstacleGradient(*industrial_robot_,*industrial_world_,distance_request_,state,context.distance_result,
+                                   obstacle);
+    return obstacle.distance <= 0.0 ? -1.0 : obstacle.distance;
+  }
+
+  collision_detection::CollisionResult& result = context.collision_result;
+  result.clear();
+  result.distance = max_distance_;
+  planning_scene_->checkSelfCollision(collision_request_,result,state,planning_scene_->getAllowedCollisionMatrix());
+  distance = result.collision ? -1.0 : result.distance;
+  distance_cache_->insert(parameters.col(t),distance);
+  return distance;
+}
+
+bool ObstacleDistanceGradient::checkIntermediateCollisions(TimestepContext& context,
+                                                           const Eigen::Ref<const Eigen::VectorXd>& start,
+                                                           const Eigen::Ref<const Eigen::VectorXd>& end,
+                                                           double longest_valid_joint_move)
+{
+  int num_intermediate = std::ceil(((end - start).cwiseAbs()/longest_valid_joint_move).maxCoeff()) - 1;
   if(num_intermediate < 1.0)
   {
     // no interpolation needed
     return true;
   }
 
-  // grabbing states
-  auto& start_state = intermediate_coll_states_[0];
-  auto& mid_state = intermediate_coll_states_[1];
-  auto& end_state = intermediate_coll_states_[2];
-
-  if(!start_state || !mid_state || !end_state)
+  if(!context.intermediate_state)
   {
-    ROS_ERROR("%s intermediate states not initialized",getName().c_str());
+    ROS_ERROR("%s intermediate state not initialized",getName().c_str());
     return false;
   }
 
-  // setting up collision
-  auto req = collision_request_;
-  req.distance = false;
-  collision_detection::CollisionResult res;
+  // checking intermediate states, only the joint values of the group are interpolated
   const moveit::core::JointModelGroup* joint_group = robot_model_ptr_->getJointModelGroup(group_name_);
-  start_state->setJointGroupPositions(joint_group,start);
-  end_state->setJointGroupPositions(joint_group,end);
-
-  // checking intermediate states
   double dt = 1.0/static_cast<double>(num_intermediate);
   double interval = 0.0;
   for(std::size_t i = 1; i < num_intermediate;i++)
   {
     interval = i*dt;
-    start_state->interpolate(*end_state,interval,*mid_state) ;
-    if(planning_scene_->isStateColliding(*mid_state))
+    joint_group->interpolate(start.data(),end.data(),interval,context.intermediate_positions.data());
+    double colliding;
+    if(collision_cache_->lookup(context.intermediate_positions,colliding))
+    {
+      if(colliding > 0.0)
+      {
+        return false;
+      }
+      continue;
+    }
+
+    context.intermediate_state->setJointGroupPositions(joint_group,context.intermediate_positions);
+    context.intermediate_state->update();
+    bool result = planning_scene_->isStateColliding(*context.intermediate_state);
+    collision_cache_->insert(context.intermediate_positions,result ? 1.0 : 0.0);
+    if(result)
     {
       return false;
     }
@@ -254,7 +396,7 @@ bool ObstacleDistanceGradient::checkIntermediateCollisions(const Eigen::VectorXd
 
 void ObstacleDistanceGradient::done(bool success,int total_iterations,double final_cost,const Eigen::MatrixXd& parameters)
 {
-  robot_state_.reset();
+  // the robot states are kept so that the next request reuses them
 }
 
 } /* namespace cost_functions */
@@ -0,0 +1,370 @@
+/**
+ * @file adaptive_covariance_sampling.cpp
+ * @brief This is a noisy trajectory generator that adapts its covariance to the updates of the optimization
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <algorithm>
+#include <cmath>
+#include <Eigen/Cholesky>
+#include <Eigen/LU>
+#include <stomp_moveit/noise_generators/adaptive_covariance_sampling.h>
+#include <stomp_core/thread_pool.h>
+#include <XmlRpcException.h>
+#include <pluginlib/class_list_macros.h>
+#include <ros/console.h>
+
+PLUGINLIB_EXPORT_CLASS(stomp_moveit::noise_generators::AdaptiveCovarianceSampling,stomp_moveit::noise_generators::StompNoiseGenerator);
+
+/*
+ * These coefficients correspond to the five point stencil method
+ */
+static const std::vector<double> ACC_MATRIX_DIAGONAL_VALUES = {-1.0/12.0, 16.0/12.0, -30.0/12.0, 16.0/12.0, -1.0/12.0};
+static const std::vector<int> ACC_MATRIX_DIAGONAL_INDICES = {-2, -1, 0 ,1, 2};
+
+static const double DEFAULT_MIN_STDDEV_FRACTION = 0.1;   /**< The default 'min_stddev' as a fraction of 'stddev' */
+static const double DEFAULT_MAX_STDDEV_FRACTION = 2.0;   /**< The default 'max_stddev' as a multiple of 'stddev' */
+static const double DEFAULT_LEARNING_RATE = 0.2;
+static const double DEFAULT_PATH_RATE = 0.3;
+static const double DEFAULT_STDDEV_DAMPING = 2.0;
+static const double MIN_UPDATE_NORM = 1e-12;             /**< Squared norm below which an update carries no direction */
+
+/**
+ * @brief Updates the lower cholesky factor L of a matrix to that of L*L^T + x*x^T in place
+ * @param L The lower cholesky factor [n][n]
+ * @param x The vector of the rank-one update [n], it is overwritten
+ * @return False if the updated factor is not finite
+ */
+static bool rankOneUpdate(Eigen::MatrixXd& L,Eigen::VectorXd& x)
+{
+  const Eigen::Index n = L.rows();
+  for(Eigen::Index k = 0; k < n; k++)
+  {
+    double r = std::hypot(L(k,k),x(k));
+    double c = r/L(k,k);
+    double s = x(k)/L(k,k);
+    L(k,k) = r;
+    if(k + 1 < n)
+    {
+      auto l = L.col(k).tail(n - k - 1);
+      auto y = x.tail(n - k - 1);
+      l = (l + s*y)/c;
+      y = c*y - s*l;
+    }
+  }
+  return L.diagonal().allFinite();
+}
+
+namespace stomp_moveit
+{
+
+namespace noise_generators
+{
+
+AdaptiveCovarianceSampling::AdaptiveCovarianceSampling():
+    name_("AdaptiveCovarianceSampling"),
+    learning_rate_(DEFAULT_LEARNING_RATE),
+    path_rate_(DEFAULT_PATH_RATE),
+    stddev_damping_(DEFAULT_STDDEV_DAMPING),
+    seed_(0)
+{
+
+}
+
+AdaptiveCovarianceSampling::~AdaptiveCovarianceSampling()
+{
+
+}
+
+bool AdaptiveCovarianceSampling::initialize(moveit::core::RobotModelConstPtr robot_model_ptr,
+                        const std::string& group_name,const XmlRpc::XmlRpcValue& config)
+{
+  using namespace moveit::core;
+
+  group_ = group_name;
+  const JointModelGroup* joint_group = robot_model_ptr->getJointModelGroup(group_name);
+  if(!joint_group)
+  {
+    ROS_ERROR("Invalid joint group %s",group_name.c_str());
+    return false;
+  }
+
+  stddev_.resize(joint_group->getActiveJointModelNames().size());
+
+  return configure(config);
+}
+
+bool AdaptiveCovarianceSampling::configure(const XmlRpc::XmlRpcValue& config)
+{
+  using namespace XmlRpc;
+
+  try
+  {
+    XmlRpcValue c = config;
+    XmlRpcValue stddev_param = c["stddev"];
+
+    if(stddev_param.size() < stddev_.size())
+    {
+      ROS_ERROR("%s the 'stddev' parameter has fewer elements than the number of joints",getName().c_str());
+      return false;
+    }
+
+    stddev_.resize(stddev_param.size());
+    for(auto i = 0u; i < stddev_param.size(); i++)
+    {
+      stddev_[i] = static_cast<double>(stddev_param[i]);
+    }
+
+    min_stddev_.assign(stddev_.size(),0.0);
+    max_stddev_.assign(stddev_.size(),0.0);
+    for(auto i = 0u; i < stddev_.size(); i++)
+    {
+      min_stddev_[i] = DEFAULT_MIN_STDDEV_FRACTION * stddev_[i];
+      max_stddev_[i] = DEFAULT_MAX_STDDEV_FRACTION * stddev_[i];
+    }
+
+    if(c.hasMember("min_stddev"))
+    {
+      XmlRpcValue min_stddev_param = c["min_stddev"];
+      if(min_stddev_param.size() < stddev_.size())
+      {
+        ROS_ERROR("%s the 'min_stddev' parameter has fewer elements than 'stddev'",getName().c_str());
+        return false;
+      }
+
+      for(auto i = 0u; i < stddev_.size(); i++)
+      {
+        min_stddev_[i] = std::min(static_cast<double>(min_stddev_param[i]),stddev_[i]);
+      }
+    }
+
+    if(c.hasMember("max_stddev"))
+    {
+      XmlRpcValue max_stddev_param = c["max_stddev"];
+      if(max_stddev_param.size() < stddev_.size())
+      {
+        ROS_ERROR("%s the 'max_stddev' parameter has fewer elements than 'stddev'",getName().c_str());
+        return false;
+      }
+
+      for(auto i = 0u; i < stddev_.size(); i++)
+      {
+        max_stddev_[i] = std::max(static_cast<double>(max_stddev_param[i]),stddev_[i]);
+      }
+    }
+
+    learning_rate_ = c.hasMember("learning_rate") ? static_cast<double>(c["learning_rate"]) : DEFAULT_LEARNING_RATE;
+    if(learning_rate_ < 0.0 || learning_rate_ >= 1.0)
+    {
+      ROS_ERROR("%s the 'learning_rate' parameter must be in the range [0, 1)",getName().c_str());
+      return false;
+    }
+
+    path_rate_ = c.hasMember("path_rate") ? static_cast<double>(c["path_rate"]) : DEFAULT_PATH_RATE;
+    if(path_rate_ <= 0.0 || path_rate_ > 1.0)
+    {
+      ROS_ERROR("%s the 'path_rate' parameter must be in the range (0, 1]",getName().c_str());
+      return false;
+    }
+
+    stddev_damping_ = c.hasMember("stddev_damping") ? static_cast<double>(c["stddev_damping"]) : DEFAULT_STDDEV_DAMPING;
+    if(stddev_damping_ <= 0.0)
+    {
+      ROS_ERROR("%s the 'stddev_damping' parameter must be positive",getName().c_str());
+      return false;
+    }
+  }
+  catch(XmlRpc::XmlRpcException& e)
+  {
+    ROS_ERROR("%s failed to load parameters",getName().c_str());
+    return false;
+  }
+
+  return true;
+}
+
+bool AdaptiveCovarianceSampling::setMotionPlanRequest(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                 const moveit_msgs::MotionPlanRequest &req,
+                 const stomp_core::StompConfiguration &config,
+                 moveit_msgs::MoveItErrorCodes& error_code)
+{
+  using namespace Eigen;
+
+  // the distribution learned during the previous request is discarded
+  seed_ = config.seed;
+  current_stddev_ = stddev_;
+  previous_parameters_.resize(0,0);
+  std::size_t num_timesteps = config.num_timesteps;
+  if(prior_.rows() != num_timesteps)
+  {
+    auto fill_diagonal = [](Eigen::MatrixXd& m,double coeff,int diag_index)
+    {
+      std::size_t size = m.rows() - std::abs(diag_index);
+      m.diagonal(diag_index) = VectorXd::Constant(size,coeff);
+    };
+
+    // creating finite difference acceleration matrix
+    Eigen::MatrixXd A = MatrixXd::Zero(num_timesteps,num_timesteps);
+    for(auto i = 0u; i < ACC_MATRIX_DIAGONAL_INDICES.size() ; i++)
+    {
+      fill_diagonal(A,ACC_MATRIX_DIAGONAL_VALUES[i],ACC_MATRIX_DIAGONAL_INDICES[i]);
+    }
+
+    // create and scale covariance matrix
+    prior_ = (A.transpose() * A).fullPivLu().inverse();
+    prior_ /= prior_.array().abs().maxCoeff();
+  }
+
+  if(prior_cholesky_.rows() != prior_.rows())
+  {
+    prior_cholesky_ = prior_.llt().matrixL();
+  }
+
+  cholesky_.assign(stddev_.size(),prior_cholesky_);
+  path_.assign(stddev_.size(),VectorXd::Zero(num_timesteps));
+  mean_update_.assign(stddev_.size(),0.0);
+
+  // the rollouts are generated concurrently, each worker fills its own raw noise
+  raw_noise_.assign(std::max(1,config.num_threads),MatrixXd(num_timesteps,stddev_.size()));
+
+  return true;
+}
+
+bool AdaptiveCovarianceSampling::generateNoise(const Eigen::MatrixXd& parameters,
+                                     std::size_t start_timestep,
+                                     std::size_t num_timesteps,
+                                     int iteration_number,
+                                     int rollout_number,
+                                     Eigen::MatrixXd& parameters_noise,
+                                     Eigen::MatrixXd& noise)
+{
+  if(parameters.rows() != stddev_.size() || parameters.cols() != prior_.rows())
+  {
+    ROS_ERROR("Number of parameters %ix%i differs from what was preallocated ",int(parameters.rows()),
+              int(parameters.cols()));
+    return false;
+  }
+
+  std::size_t worker_index = stomp_core::ThreadPool::getWorkerIndex();
+  if(worker_index >= raw_noise_.size())
+  {
+    ROS_ERROR("%s has no noise allocated for worker %lu",getName().c_str(),worker_index);
+    return false;
+  }
+  Eigen::MatrixXd& raw_noise = raw_noise_[worker_index];
+
+  // rollouts are generated concurrently and draw from the stream keyed by their index
+  utils::RandomNumberGenerator rng;
+  rng.seed(static_cast<std::uint32_t>(seed_),iteration_number,rollout_number < 0 ? 0 : rollout_number);
+  rng.fillStandardNormal(Eigen::Map<Eigen::ArrayXd>(raw_noise.data(),raw_noise.size()));
+
+  for(auto d = 0u; d < parameters.rows() ; d++)
+  {
+    noise.row(d).noalias() = current_stddev_[d] * (cholesky_[d].triangularView<Eigen::Lower>() * raw_noise.col(d)).transpose();
+    parameters_noise.row(d) = parameters.row(d) + noise.row(d);
+  }
+
+  return true;
+}
+
+void AdaptiveCovarianceSampling::postIteration(std::size_t start_timestep,
+                                               std::size_t num_timesteps,int iteration_number,double cost,
+                                               const Eigen::MatrixXd& parameters)
+{
+  using namespace Eigen;
+
+  if(previous_parameters_.rows() != parameters.rows() || previous_parameters_.cols() != parameters.cols() ||
+      parameters.cols() != prior_.rows())
+  {
+    previous_parameters_ = parameters;
+    return;
+  }
+
+  double path_weight = std::sqrt(path_rate_*(2.0 - path_rate_));
+  for(auto d = 0u; d < current_stddev_.size(); d++)
+  {
+    // the update is the probability weighted average of the noise of the rollouts, in units of the amplitude
+    VectorXd update = (parameters.row(d) - previous_parameters_.row(d)).transpose() / current_stddev_[d];
+    double update_norm = update.squaredNorm();
+    if(mean_update_[d] <= 0.0)
+    {
+      // the path starts as if the updates so far had all pointed the same way
+      path_[d] = update;
+      mean_update_[d] = update_norm;
+    }
+    else
+    {
+      path_[d] = (1.0 - path_rate_)*path_[d] + path_weight*update;
+      mean_update_[d] = (1.0 - path_rate_)*mean_update_[d] + path_rate_*update_norm;
+    }
+
+    if(mean_update_[d] < MIN_UPDATE_NORM)
+    {
+      continue;
+    }
+
+    if(!updateCovariance(d))
+    {
+      // the path that broke the covariance is discarded along with it
+      path_[d].setZero();
+      mean_update_[d] = 0.0;
+      continue;
+    }
+
+    // uncorrelated updates keep the expected length of the path at that of the average update, consistent updates
+    // lengthen it and the amplitude grows while updates that cancel out shorten it and the amplitude shrinks
+    double ratio = path_[d].norm() / std::sqrt(mean_update_[d]);
+    double stddev = current_stddev_[d]*std::exp((ratio - 1.0)/stddev_damping_);
+    current_stddev_[d] = std::max(min_stddev_[d],std::min(stddev,max_stddev_[d]));
+  }
+
+  previous_parameters_ = parameters;
+}
+
+bool AdaptiveCovarianceSampling::updateCovariance(std::size_t d)
+{
+  using namespace Eigen;
+
+  double path_norm = path_[d].squaredNorm();
+  if(learning_rate_ <= 0.0 || path_norm < MIN_UPDATE_NORM)
+  {
+    return true;
+  }
+
+  // the learned covariance forgets older directions and gains as much variance along the direction of the path as the
+  // prior has in total, the factor of (1 - rate)*C is that of C scaled so the update stays rank-one
+  cholesky_[d] *= std::sqrt(1.0 - learning_rate_);
+  VectorXd direction = std::sqrt(learning_rate_*prior_.trace()/path_norm) * path_[d];
+  if(!rankOneUpdate(cholesky_[d],direction))
+  {
+    ROS_WARN("%s the covariance of joint %i is not finite, it is reset",getName().c_str(),int(d));
+    cholesky_[d] = prior_cholesky_;
+    return false;
+  }
+
+  // the diagonal of the covariance is the squared norm of the rows of the factor
+  cholesky_[d] /= std::sqrt(cholesky_[d].rowwise().squaredNorm().maxCoeff());
+  return true;
+}
+
+} /* namespace noise_generators */
+} /* namespace stomp_moveit */
@@ -0,0 +1,195 @@
+/**
+ * @file basis_function_sampling.cpp
+ * @brief This is a noisy trajectory generator that samples smooth noise in a low dimensional basis
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <cmath>
+#include <stomp_moveit/noise_generators/basis_function_sampling.h>
+#include <stomp_core/thread_pool.h>
+#include <XmlRpcException.h>
+#include <pluginlib/class_list_macros.h>
+#include <ros/console.h>
+
+PLUGINLIB_EXPORT_CLASS(stomp_moveit::noise_generators::BasisFunctionSampling,stomp_moveit::noise_generators::StompNoiseGenerator);
+
+static const int DEFAULT_NUM_BASIS_FUNCTIONS = 12;
+
+namespace stomp_moveit
+{
+
+namespace noise_generators
+{
+
+BasisFunctionSampling::BasisFunctionSampling():
+    name_("BasisFunctionSampling"),
+    num_basis_functions_(DEFAULT_NUM_BASIS_FUNCTIONS),
+    seed_(0)
+{
+
+}
+
+BasisFunctionSampling::~BasisFunctionSampling()
+{
+
+}
+
+bool BasisFunctionSampling::initialize(moveit::core::RobotModelConstPtr robot_model_ptr,
+                        const std::string& group_name,const XmlRpc::XmlRpcValue& config)
+{
+  using namespace moveit::core;
+
+  group_ = group_name;
+  const JointModelGroup* joint_group = robot_model_ptr->getJointModelGroup(group_name);
+  if(!joint_group)
+  {
+    ROS_ERROR("Invalid joint group %s",group_name.c_str());
+    return false;
+  }
+
+  stddev_.resize(joint_group->getActiveJointModelNames().size());
+
+  return configure(config);
+}
+
+bool BasisFunctionSampling::configure(const XmlRpc::XmlRpcValue& config)
+{
+  using namespace XmlRpc;
+
+  try
+  {
+    XmlRpcValue c = config;
+    XmlRpcValue stddev_param = c["stddev"];
+
+    if(stddev_param.size() < stddev_.size())
+    {
+      ROS_ERROR("%s the 'stddev' parameter has fewer elements than the number of joints",getName().c_str());
+      return false;
+    }
+
+    stddev_.resize(stddev_param.size());
+    for(auto i = 0u; i < stddev_param.size(); i++)
+    {
+      stddev_[i] = static_cast<double>(stddev_param[i]);
+    }
+
+    num_basis_functions_ = c.hasMember("num_basis_functions") ? static_cast<int>(c["num_basis_functions"]) :
+        DEFAULT_NUM_BASIS_FUNCTIONS;
+    if(num_basis_functions_ < 1)
+    {
+      ROS_ERROR("%s the 'num_basis_functions' parameter must be at least 1",getName().c_str());
+      return false;
+    }
+  }
+  catch(XmlRpc::XmlRpcException& e)
+  {
+    ROS_ERROR("%s failed to load parameters",getName().c_str());
+    return false;
+  }
+
+  return true;
+}
+
+bool BasisFunctionSampling::setMotionPlanRequest(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                 const moveit_msgs::MotionPlanRequest &req,
+                 const stomp_core::StompConfiguration &config,
+                 moveit_msgs::MoveItErrorCodes& error_code)
+{
+  using namespace Eigen;
+
+  seed_ = config.seed;
+
+  // the rollouts are generated concurrently, each worker fills its own coefficients
+  coefficients_.resize(std::max(1,config.num_threads));
+  for(auto& c : coefficients_)
+  {
+    c.resize(stddev_.size(),num_basis_functions_);
+  }
+
+  // the basis only depends on the number of timesteps
+  int num_timesteps = config.num_timesteps;
+  if(basis_.cols() == num_timesteps && basis_.rows() == num_basis_functions_)
+  {
+    error_code.val = error_code.SUCCESS;
+    return true;
+  }
+
+  // sin(pi*k*t/(T - 1)) weighted by 1/k^2, the k-th standard deviation of the acceleration penalizing distribution
+  basis_.resize(num_basis_functions_,num_timesteps);
+  double scale = num_timesteps > 1 ? M_PI/(num_timesteps - 1) : 0.0;
+  for(auto k = 0u; k < num_basis_functions_; k++)
+  {
+    double frequency = k + 1;
+    for(auto t = 0u; t < num_timesteps; t++)
+    {
+      basis_(k,t) = std::sin(scale*frequency*t)/(frequency*frequency);
+    }
+  }
+
+  // scaling such that the largest variance over the trajectory is 1, like the covariance of NormalDistributionSampling
+  double max_variance = basis_.colwise().squaredNorm().maxCoeff();
+  if(max_variance > 0.0)
+  {
+    basis_ /= std::sqrt(max_variance);
+  }
+
+  error_code.val = error_code.SUCCESS;
+  return true;
+}
+
+bool BasisFunctionSampling::generateNoise(const Eigen::MatrixXd& parameters,
+                                     std::size_t start_timestep,
+                                     std::size_t num_timesteps,
+                                     int iteration_number,
+                                     int rollout_number,
+                                     Eigen::MatrixXd& parameters_noise,
+                                     Eigen::MatrixXd& noise)
+{
+  if(parameters.rows() != stddev_.size() || parameters.cols() != basis_.cols())
+  {
+    ROS_ERROR("%s parameters of size %i x %i differ from what was preallocated",getName().c_str(),
+              int(parameters.rows()),int(parameters.cols()));
+    return false;
+  }
+
+  std::size_t worker_index = stomp_core::ThreadPool::getWorkerIndex();
+  if(worker_index >= coefficients_.size())
+  {
+    ROS_ERROR("%s has no coefficients allocated for worker %lu",getName().c_str(),worker_index);
+    return false;
+  }
+  Eigen::MatrixXd& coefficients = coefficients_[worker_index];
+
+  // each rollout draws its coefficients from its own stream so that the noise does not depend on the thread order
+  utils::RandomNumberGenerator rng;
+  rng.seed(static_cast<std::uint32_t>(seed_),iteration_number,rollout_number < 0 ? 0 : rollout_number);
+  rng.fillStandardNormal(Eigen::Map<Eigen::ArrayXd>(coefficients.data(),coefficients.size()));
+  coefficients.array().colwise() *= Eigen::Map<const Eigen::ArrayXd>(stddev_.data(),stddev_.size());
+
+  noise.noalias() = coefficients*basis_;
+  parameters_noise = parameters + noise;
+
+  return true;
+}
+
+} /* namespace noise_generators */
+} /* namespace stomp_moveit */
@@ -23,6 +23,9 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <stomp_moveit/noise_generators/normal_distribution_sampling.h>
 #include <stomp_moveit/utils/multivariate_gaussian.h>
 #include <XmlRpcException.h>
@@ -37,6 +40,10 @@ PLUGINLIB_EXPORT_CLASS(stomp_moveit::noise_generators::NormalDistributionSamplin
 static const std::vector<double> ACC_MATRIX_DIAGONAL_VALUES = {-1.0/12.0, 16.0/12.0, -30.0/12.0, 16.0/12.0, -1.0/12.0};
 static const std::vector<int> ACC_MATRIX_DIAGONAL_INDICES = {-2, -1, 0 ,1, 2};
 
+static const double DEFAULT_MIN_STDDEV_FRACTION = 0.1;   /**< The default 'min_stddev' as a fraction of 'stddev' */
+static const double CONVERGING_COST_IMPROVEMENT = 0.01;  /**< Relative cost improvement below which the noise anneals */
+static const double MIN_COST_DIFFERENCE = 1e-8;          /**< Minimum cost used to compute the relative improvement */
+
 namespace stomp_moveit
 {
 
@@ -44,7 +51,12 @@ namespace noise_generators
 {
 
 NormalDistributionSampling::NormalDistributionSampling():
-    name_("NormalDistributionSampling")
+    name_("NormalDistributionSampling"),
+    batch_iteration_(-1),
+    batch_size_(0),
+    seed_(0),
+    update_rate_(0.0),
+    previous_cost_(std::numeric_limits<double>::max())
 {
   // TODO Auto-generated constructor stub
 
@@ -95,6 +107,36 @@ bool NormalDistributionSampling::configure(const XmlRpc::XmlRpcValue& config)
     {
       stddev_[i] = static_cast<double>(stddev_param[i]);
     }
+
+    // optional noise annealing parameters
+    update_rate_ = c.hasMember("update_rate") ? static_cast<double>(c["update_rate"]) : 0.0;
+    if(update_rate_ < 0.0 || update_rate_ >= 1.0)
+    {
+      ROS_ERROR("%s the 'update_rate' parameter must be in the range [0, 1)",getName().c_str());
+      return false;
+    }
+
+    min_stddev_.assign(stddev_.size(),0.0);
+    for(auto i = 0u; i < stddev_.size(); i++)
+    {
+      min_stddev_[i] = DEFAULT_MIN_STDDEV_FRACTION * stddev_[i];
+    }
+
+    if(c.hasMember("min_stddev"))
+    {
+      XmlRpcValue min_stddev_param = c["min_stddev"];
+      if(min_stddev_param.size() < stddev_.size())
+      {
+        ROS_ERROR("%s the 'min_stddev' parameter has fewer elements than 'stddev'",getName().c_str());
+        return false;
+      }
+
+      for(auto i = 0u; i < stddev_.size(); i++)
+      {
+        min_stddev_[i] = std::min(static_cast<double>(min_stddev_param[i]),stddev_[i]);
+      }
+    }
+    current_stddev_ = stddev_;
   }
   catch(XmlRpc::XmlRpcException& e)
   {
@@ -112,6 +154,20 @@ bool NormalDistributionSampling::setMotionPlanRequest(const planning_scene::Plan
 {
   using namespace Eigen;
 
+  // the batch and the annealed noise of the previous request are discarded
+  batch_iteration_ = -1;
+  batch_size_ = config.num_rollouts;
+  seed_ = config.seed;
+  current_stddev_ = stddev_;
+  previous_cost_ = std::numeric_limits<double>::max();
+
+  // the sampling distribution only depends on the number of timesteps
+  if(raw_noise_.size() == config.num_timesteps && rand_generators_.size() == stddev_.size())
+  {
+    updateSeeds();
+    return true;
+  }
+
   auto fill_diagonal = [](Eigen::MatrixXd& m,double coeff,int diag_index)
   {
     std::size_t size = m.rows() - std::abs(diag_index);
@@ -140,15 +196,25 @@ bool NormalDistributionSampling::setMotionPlanRequest(const planning_scene::Plan
   {
     r.reset(new utils::MultivariateGaussian(VectorXd::Zero(num_timesteps),covariance));
   }
+  updateSeeds();
 
   // preallocating noise data
   raw_noise_.resize(config.num_timesteps);
   raw_noise_.setZero();
+  batch_noise_.assign(stddev_.size(),Eigen::MatrixXd::Zero(num_timesteps,batch_size_));
 
   return true;
 }
 
 
+void NormalDistributionSampling::updateSeeds()
+{
+  for(auto d = 0u; d < rand_generators_.size(); d++)
+  {
+    rand_generators_[d]->setSeed((static_cast<std::uint64_t>(static_cast<std::uint32_t>(seed_)) << 32) | d);
+  }
+}
+
 bool NormalDistributionSampling::generateNoise(const Eigen::MatrixXd& parameters,
                                      std::size_t start_timestep,
                                      std::size_t num_timesteps,
@@ -164,15 +230,60 @@ bool NormalDistributionSampling::generateNoise(const Eigen::MatrixXd& parameters
   }
 
 
+  // sampling the noise of every rollout of the iteration the first time one of them is requested, rollouts are
+  // generated concurrently therefore the batch is guarded
+  std::lock_guard<std::mutex> lock(batch_mutex_);
+  if(iteration_number != batch_iteration_ || rollout_number < 0 || rollout_number >= batch_noise_.front().cols())
+  {
+    // the adaptive rollout count may request more rollouts than were sampled, the batch grows to accommodate them
+    batch_size_ = std::max(batch_size_,rollout_number + 1);
+    int num_samples = batch_size_;
+    for(auto d = 0u; d < batch_noise_.size(); d++)
+    {
+      batch_noise_[d].resize(parameters.cols(),num_samples);
+      rand_generators_[d]->sampleStreams(batch_noise_[d],iteration_number);
+    }
+    batch_iteration_ = iteration_number;
+  }
+
+  int sample_index = rollout_number < 0 ? 0 : rollout_number;
   for(auto d = 0u; d < parameters.rows() ; d++)
   {
-    rand_generators_[d]->sample(raw_noise_);
-    noise.row(d).transpose() = stddev_[d] * raw_noise_;
+    noise.row(d) = current_stddev_[d] * batch_noise_[d].col(sample_index).transpose();
     parameters_noise.row(d) = parameters.row(d) + noise.row(d);
   }
 
   return true;
 }
 
+void NormalDistributionSampling::postIteration(std::size_t start_timestep,
+                                               std::size_t num_timesteps,int iteration_number,double cost,
+                                               const Eigen::MatrixXd& parameters)
+{
+  if(update_rate_ <= 0.0)
+  {
+    return;
+  }
+
+  double improvement = (previous_cost_ - cost)/std::max(std::abs(previous_cost_),MIN_COST_DIFFERENCE);
+  previous_cost_ = cost;
+  if(improvement <= 0.0)
+  {
+    // no better trajectory was found, explore with larger noise
+    for(auto d = 0u; d < current_stddev_.size(); d++)
+    {
+      current_stddev_[d] = std::min(current_stddev_[d]*(1.0 + update_rate_),stddev_[d]);
+    }
+  }
+  else if(improvement < CONVERGING_COST_IMPROVEMENT)
+  {
+    // the cost is converging, refine with smaller noise
+    for(auto d = 0u; d < current_stddev_.size(); d++)
+    {
+      current_stddev_[d] = std::max(current_stddev_[d]*(1.0 - update_rate_),min_stddev_[d]);
+    }
+  }
+}
+
 } /* namespace noise_generators */
 } /* namespace stomp_moveit */
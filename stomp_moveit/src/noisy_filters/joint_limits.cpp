@@ -26,6 +26,8 @@
 #include <ros/console.h>
 #include <pluginlib/class_list_macros.h>
 #include <moveit/robot_state/conversions.h>
+#include <moveit/robot_model/revolute_joint_model.h>
+#include <limits>
 #include <stomp_moveit/noisy_filters/joint_limits.h>
 
 PLUGINLIB_EXPORT_CLASS(stomp_moveit::noisy_filters::JointLimits,stomp_moveit::noisy_filters::StompNoisyFilter);
@@ -140,6 +142,33 @@ bool JointLimits::setMotionPlanRequest(const planning_scene::PlanningSceneConstP
     }
   }
 
+  // caching the bounds, only the single variable joints limited to an interval are clamped in bulk
+  const JointModelGroup* joint_group = robot_model_->getJointModelGroup(group_name_);
+  joint_models_ = joint_group->getActiveJointModels();
+  std::size_t num_joints = joint_models_.size();
+  special_joints_.clear();
+  min_positions_.setConstant(num_joints,-std::numeric_limits<double>::infinity());
+  max_positions_.setConstant(num_joints,std::numeric_limits<double>::infinity());
+  start_positions_.resize(num_joints);
+  goal_positions_.resize(num_joints);
+  for(auto j = 0u; j < num_joints; j++)
+  {
+    const JointModel* joint = joint_models_[j];
+    start_positions_(j) = *start_state_->getJointPositions(joint);
+    goal_positions_(j) = *goal_state_->getJointPositions(joint);
+
+    bool continuous = joint->getType() == JointModel::REVOLUTE &&
+        static_cast<const RevoluteJointModel*>(joint)->isContinuous();
+    if(joint->getVariableCount() != 1 || continuous || !joint->getVariableBounds()[0].position_bounded_)
+    {
+      special_joints_.push_back(j);
+      continue;
+    }
+
+    min_positions_(j) = joint->getVariableBounds()[0].min_position_;
+    max_positions_(j) = joint->getVariableBounds()[0].max_position_;
+  }
+
   return true;
 }
 
@@ -149,9 +178,7 @@ bool JointLimits::filter(std::size_t start_timestep,std::size_t num_timesteps,
   using namespace moveit::core;
 
   filtered = false;
-  const JointModelGroup* joint_group  = robot_model_->getJointModelGroup(group_name_);
-  const std::vector<const JointModel*>& joint_models = joint_group->getActiveJointModels();
-  std::size_t num_joints = joint_group->getActiveJointModelNames().size();
+  std::size_t num_joints = joint_models_.size();
   if(parameters.rows() != num_joints)
   {
     ROS_ERROR("Incorrect number of joints in the 'parameters' matrix");
@@ -160,32 +187,34 @@ bool JointLimits::filter(std::size_t start_timestep,std::size_t num_timesteps,
 
   if(lock_start_)
   {
-    for(auto j = 0u; j < num_joints; j++)
-    {
-      parameters(j,0) =  *start_state_->getJointPositions(joint_models[j]);
-    }
-
+    parameters.col(0) = start_positions_;
     filtered = true;
   }
 
   if(lock_goal_)
   {
-    auto last_index = parameters.cols()-1;
-    for(auto j = 0u; j < num_joints; j++)
+    parameters.col(parameters.cols()-1) = goal_positions_;
+    filtered = true;
+  }
+
+  // clamping whole rows, the bounds of the special joints are infinite and leave their rows untouched
+  for (auto j = 0u; j < num_joints; ++j)
+  {
+    auto row = parameters.row(j).array();
+    if((row < min_positions_(j)).any() || (row > max_positions_(j)).any())
     {
-      parameters(j,last_index) =  *goal_state_->getJointPositions(joint_models[j]);
+      row = row.max(min_positions_(j)).min(max_positions_(j));
+      filtered = true;
     }
-
-    filtered = true;
   }
 
   double val;
-  for (auto j = 0u; j < num_joints; ++j)
+  for (int j : special_joints_)
   {
     for (auto t=0u; t< parameters.cols(); ++t)
     {
       val = parameters(j,t);
-      if(joint_models[j]->enforcePositionBounds(&val))
+      if(joint_models_[j]->enforcePositionBounds(&val))
       {
         parameters(j,t) = val;
         filtered = true;
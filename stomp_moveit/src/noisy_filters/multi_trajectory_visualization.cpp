@@ -94,7 +94,9 @@ namespace noisy_filters
 MultiTrajectoryVisualization::MultiTrajectoryVisualization():
     name_("MultiTrajectoryVisualization"),
     line_width_(0.01),
-    traj_total_(0)
+    publish_rate_(0.0),
+    traj_total_(0),
+    capturing_(false)
 {
   // TODO Auto-generated constructor stub
 
@@ -102,7 +104,7 @@ MultiTrajectoryVisualization::MultiTrajectoryVisualization():
 
 MultiTrajectoryVisualization::~MultiTrajectoryVisualization()
 {
-  // TODO Auto-generated destructor stub
+  publisher_.stop();
 }
 
 
@@ -155,6 +157,7 @@ bool MultiTrajectoryVisualization::configure(const XmlRpc::XmlRpcValue& config)
     rgb_ = toColorRgb(c["rgb"]);
     marker_topic_ = static_cast<std::string>(c["marker_array_topic"]);
     marker_namespace_ = static_cast<std::string>(c["marker_namespace"]);
+    publish_rate_ = c.hasMember("publish_rate") ? static_cast<double>(c["publish_rate"]) : 0.0;
   }
   catch(XmlRpc::XmlRpcException& e)
   {
@@ -174,16 +177,18 @@ bool MultiTrajectoryVisualization::setMotionPlanRequest(const planning_scene::Pl
 
   error_code.val = error_code.SUCCESS;
 
+  // the markers and the state are used by the publisher thread
+  publisher_.wait();
 
   // initializing points array
   tool_traj_line_ = Eigen::MatrixXd::Zero(3,config.num_timesteps);
   Eigen::Vector3d tool_point;
 
   // initializing marker array
-  traj_total_ = config.num_rollouts;
+  traj_total_ = stomp_core::getMaxGeneratedRollouts(config);
   tool_traj_markers_.markers.resize(traj_total_);
   tool_points_markers_.markers.resize(traj_total_);
-  for(auto r = 0u; r < config.num_rollouts; r++)
+  for(auto r = 0u; r < traj_total_; r++)
   {
     createToolPathMarker(tool_traj_line_,
                          r+1,robot_model_->getRootLinkName(),
@@ -197,13 +202,26 @@ bool MultiTrajectoryVisualization::setMotionPlanRequest(const planning_scene::Pl
 
 
   // updating state
-  state_.reset(new RobotState(robot_model_));
+  if(!state_)
+  {
+    state_.reset(new RobotState(robot_model_));
+  }
   if(!robotStateMsgToRobotState(req.start_state,*state_,true))
   {
     ROS_ERROR("%s Failed to get current robot state from request",getName().c_str());
     return false;
   }
 
+  // preallocating the copies of the noisy parameters
+  {
+    std::lock_guard<std::mutex> lock(markers_mutex_);
+    std::size_t num_joints = robot_model_->getJointModelGroup(group_name_)->getActiveJointModels().size();
+    rollout_parameters_.assign(traj_total_,Eigen::MatrixXd::Zero(num_joints,config.num_timesteps));
+    captured_.assign(traj_total_,0);
+    last_publish_ = std::chrono::steady_clock::time_point();
+    capturing_ = shouldPublish();
+  }
+
   //delete current markers
   visualization_msgs::MarkerArray m;
   viz_pub_.publish(m);
@@ -211,6 +229,22 @@ bool MultiTrajectoryVisualization::setMotionPlanRequest(const planning_scene::Pl
   return true;
 }
 
+bool MultiTrajectoryVisualization::shouldPublish() const
+{
+  if(viz_pub_.getNumSubscribers() == 0)
+  {
+    return false;
+  }
+
+  if(publish_rate_ <= 0.0)
+  {
+    return true;
+  }
+
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - last_publish_;
+  return elapsed.count() >= 1.0/publish_rate_;
+}
+
 bool MultiTrajectoryVisualization::filter(std::size_t start_timestep,
                     std::size_t num_timesteps,
                     int iteration_number,
@@ -232,31 +266,76 @@ bool MultiTrajectoryVisualization::filter(std::size_t start_timestep,
     return true;
   }
 
-  // FK on each point
-  const moveit::core::JointModelGroup* joint_group = robot_model_->getJointModelGroup(group_name_);
-  std::string tool_link = joint_group->getLinkModelNames().back();
-  for(auto t = 0u; t < parameters.cols();t++)
+  if(!capturing_)
+  {
+    return true;
+  }
+
+  // the rollouts are filtered concurrently, only the parameters are copied here
+  std::lock_guard<std::mutex> lock(markers_mutex_);
+  rollout_parameters_[rollout_number] = parameters;
+  captured_[rollout_number] = 1;
+
+  return true;
+}
+
+void MultiTrajectoryVisualization::postIteration(std::size_t start_timestep,
+                                                 std::size_t num_timesteps,int iteration_number,double cost,
+                                                 const Eigen::MatrixXd& parameters)
+{
+  // all the rollouts of the iteration have been collected, the number of rollouts may change between iterations
+  std::lock_guard<std::mutex> lock(markers_mutex_);
+  if(capturing_)
   {
-    state_->setJointGroupPositions(joint_group,parameters.col(t));
-    Eigen::Affine3d tool_pos = state_->getFrameTransform(tool_link);
-    tool_traj_line_(0,t) = tool_pos.translation()(0);
-    tool_traj_line_(1,t) = tool_pos.translation()(1);
-    tool_traj_line_(2,t) = tool_pos.translation()(2);
+    auto rollouts = std::make_shared<std::vector<int>>();
+    auto snapshot = std::make_shared<std::vector<Eigen::MatrixXd>>();
+    for(auto r = 0u; r < captured_.size(); r++)
+    {
+      if(captured_[r])
+      {
+        rollouts->push_back(r);
+        snapshot->push_back(rollout_parameters_[r]);
+        captured_[r] = 0;
+      }
+    }
+
+    last_publish_ = std::chrono::steady_clock::now();
+    publisher_.post([this,rollouts,snapshot]()
+    {
+      publishMarkers(*rollouts,*snapshot);
+    });
   }
 
-  // storing into marker
-  eigenToPointsMsgs(tool_traj_line_,tool_traj_markers_.markers[rollout_number].points);
-  Eigen::Vector3d goal_tool_point = tool_traj_line_.rightCols(1);
-  tf::pointEigenToMsg(goal_tool_point, tool_points_markers_.markers[rollout_number].pose.position);
+  capturing_ = shouldPublish();
+}
 
-  // publish after collecting all rollouts
-  if(rollout_number == traj_total_ - 1)
+void MultiTrajectoryVisualization::publishMarkers(const std::vector<int>& rollouts,
+                                                  const std::vector<Eigen::MatrixXd>& parameters)
+{
+  // FK on each point
+  const moveit::core::JointModelGroup* joint_group = robot_model_->getJointModelGroup(group_name_);
+  const std::string& tool_link = joint_group->getLinkModelNames().back();
+  for(auto i = 0u; i < rollouts.size(); i++)
   {
-    viz_pub_.publish(tool_traj_markers_);
-    viz_pub_.publish(tool_points_markers_);
+    const Eigen::MatrixXd& rollout_parameters = parameters[i];
+    for(auto t = 0u; t < rollout_parameters.cols();t++)
+    {
+      state_->setJointGroupPositions(joint_group,rollout_parameters.col(t));
+      Eigen::Affine3d tool_pos = state_->getFrameTransform(tool_link);
+      tool_traj_line_(0,t) = tool_pos.translation()(0);
+      tool_traj_line_(1,t) = tool_pos.translation()(1);
+      tool_traj_line_(2,t) = tool_pos.translation()(2);
+    }
+
+    // storing into marker
+    int r = rollouts[i];
+    eigenToPointsMsgs(tool_traj_line_,tool_traj_markers_.markers[r].points);
+    Eigen::Vector3d goal_tool_point = tool_traj_line_.rightCols(1);
+    tf::pointEigenToMsg(goal_tool_point, tool_points_markers_.markers[r].pose.position);
   }
 
-  return true;
+  viz_pub_.publish(tool_traj_markers_);
+  viz_pub_.publish(tool_points_markers_);
 }
 
 } /* namespace filters */
@@ -23,7 +23,14 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <mutex>
 #include <stdexcept>
+#include <stomp_core/thread_pool.h>
+#include <moveit/robot_state/conversions.h>
 #include "stomp_moveit/stomp_optimization_task.h"
 
 using PluginConfigs = std::vector< std::pair<std::string,XmlRpc::XmlRpcValue> >;
@@ -32,6 +39,70 @@ static const std::string COST_FUNCTIONS_FIELD = "cost_functions";
 static const std::string NOISY_FILTERS_FIELD = "noisy_filters";
 static const std::string UPDATE_FILTERS_FIELD = "update_filters";
 static const std::string NOISE_GENERATOR_FIELD = "noise_generator";
+static const std::string COST_CASCADE_WEIGHT_FIELD = "cost_cascade_weight";
+static const double MIN_CASCADE_COST_RANGE = 1e-8; /**< Below this mean state cost range the cost cascade rejects nothing */
+
+static std::mutex PLUGIN_LOADERS_MUTEX; /**< Serializes the use of the plugin loaders shared by all the tasks */
+
+/**
+ * @brief Returns the plugin loader of a base class shared by the tasks of the process, so that the plugin manifests are only
+ * parsed once however many groups and planners are created.  It lives as long as a task refers to it.
+ * @param base_class  The plugin base class
+ * @return The shared loader
+ */
+template <typename Loader>
+std::shared_ptr<Loader> getSharedLoader(const std::string& base_class)
+{
+  static std::weak_ptr<Loader> shared_loader;
+  std::lock_guard<std::mutex> lock(PLUGIN_LOADERS_MUTEX);
+  std::shared_ptr<Loader> loader = shared_loader.lock();
+  if(!loader)
+  {
+    loader.reset(new Loader("stomp_moveit",base_class));
+    shared_loader = loader;
+  }
+  return loader;
+}
+
+/**
+ * @brief Calls a cost function through the method taking dense matrices
+ * @param cf                The cost function
+ * @param parameters        The parameters [num_dimensions x num_parameters]
+ * @param start_timestep    start index into the 'parameters' array
+ * @param num_timesteps     number of elements to use from 'parameters' starting from 'start_timestep'
+ * @param iteration_number  The current iteration count in the optimization loop
+ * @param rollout_number    index of the noisy trajectory whose cost is being evaluated
+ * @param costs             receives the costs of the requested timesteps or those of the whole trajectory
+ * @param validity          whether or not the trajectory is valid
+ * @return false if there was an irrecoverable failure, true otherwise.
+ */
+bool computePluginCosts(stomp_moveit::cost_functions::StompCostFunction& cf,const Eigen::MatrixXd& parameters,
+                        std::size_t start_timestep,std::size_t num_timesteps,int iteration_number,int rollout_number,
+                        Eigen::VectorXd& costs,bool& validity)
+{
+  return cf.computeCosts(parameters,start_timestep,num_timesteps,iteration_number,rollout_number,costs,validity);
+}
+
+/**
+ * @brief Calls a cost function through its Eigen::Ref based method
+ * @param cf                The cost function
+ * @param parameters        A view of the parameters [num_dimensions x num_parameters]
+ * @param start_timestep    start index into the 'parameters' array
+ * @param num_timesteps     number of elements to use from 'parameters' starting from 'start_timestep'
+ * @param iteration_number  The current iteration count in the optimization loop
+ * @param rollout_number    index of the noisy trajectory whose cost is being evaluated
+ * @param costs             receives the costs of the requested timesteps
+ * @param validity          whether or not the trajectory is valid
+ * @return false if there was an irrecoverable failure, true otherwise.
+ */
+bool computePluginCosts(stomp_moveit::cost_functions::StompCostFunction& cf,
+                        const Eigen::Ref<const Eigen::MatrixXd>& parameters,std::size_t start_timestep,
+                        std::size_t num_timesteps,int iteration_number,int rollout_number,Eigen::VectorXd& costs,
+                        bool& validity)
+{
+  costs.resize(num_timesteps);
+  return cf.computeCostsRef(parameters,start_timestep,num_timesteps,iteration_number,rollout_number,costs,validity);
+}
 
 /**
  * @brief Convenience method to load an array of STOMP plugins
@@ -112,6 +183,7 @@ bool loadPlugins(const PluginData plugin_data,
       PluginPtr plugin;
       try
       {
+        std::lock_guard<std::mutex> lock(PLUGIN_LOADERS_MUTEX);
         plugin.reset(class_loader->createUnmanagedInstance(entry.first));
       }
       catch(pluginlib::PluginlibException& ex)
@@ -182,13 +254,23 @@ StompOptimizationTask::StompOptimizationTask(
     std::string group_name,
     const XmlRpc::XmlRpcValue& config):
         robot_model_ptr_(robot_model_ptr),
-        group_name_(group_name)
+        group_name_(group_name),
+        cached_costs_valid_(false),
+        cached_iteration_(0),
+        cached_start_timestep_(0),
+        cached_validity_(false),
+        cascade_weight_(0.0),
+        cascade_sensitivity_(0.0),
+        cascade_bound_(std::numeric_limits<double>::infinity()),
+        noisy_filters_profile_offset_(0),
+        update_filters_profile_offset_(0),
+        noise_generator_profile_index_(0)
 {
   // initializing plugin loaders
-  cost_function_loader_.reset(new CostFunctionLoader("stomp_moveit", "stomp_moveit::cost_functions::StompCostFunction"));
-  noise_generator_loader_.reset(new NoiseGeneratorLoader("stomp_moveit","stomp_moveit::noise_generators::StompNoiseGenerator"));
-  noisy_filter_loader_.reset(new NoisyFilterLoader("stomp_moveit", "stomp_moveit::noisy_filters::StompNoisyFilter"));
-  update_filter_loader_.reset(new UpdateFilterLoader("stomp_moveit", "stomp_moveit::update_filters::StompUpdateFilter"));
+  cost_function_loader_ = getSharedLoader<CostFunctionLoader>("stomp_moveit::cost_functions::StompCostFunction");
+  noise_generator_loader_ = getSharedLoader<NoiseGeneratorLoader>("stomp_moveit::noise_generators::StompNoiseGenerator");
+  noisy_filter_loader_ = getSharedLoader<NoisyFilterLoader>("stomp_moveit::noisy_filters::StompNoisyFilter");
+  update_filter_loader_ = getSharedLoader<UpdateFilterLoader>("stomp_moveit::update_filters::StompUpdateFilter");
 
   // preparing plugin init data
   PluginData plugin_data;
@@ -206,6 +288,24 @@ StompOptimizationTask::StompOptimizationTask(
     ROS_ERROR("StompOptimizationTask/%s failed to load '%s' plugins from yaml",group_name.c_str(),COST_FUNCTIONS_FIELD.c_str());
     throw std::logic_error("plugin not found");
   }
+  allocateWorkerCostFunctions(1);
+
+  // the cost functions are evaluated in the configured order until their timing is known
+  for(auto i = 0u; i < cost_functions_.size(); i++)
+  {
+    cascade_order_.push_back(i);
+  }
+  XmlRpc::XmlRpcValue c = config;
+  if(c.hasMember(COST_CASCADE_WEIGHT_FIELD))
+  {
+    cascade_weight_ = static_cast<double>(c[COST_CASCADE_WEIGHT_FIELD]);
+  }
+  if(cascade_weight_ < 0.0 || cascade_weight_ >= 1.0)
+  {
+    ROS_ERROR("StompOptimizationTask/%s the '%s' parameter must be in [0, 1)",group_name.c_str(),
+              COST_CASCADE_WEIGHT_FIELD.c_str());
+    throw std::logic_error("invalid cost cascade weight");
+  }
 
   // loading noise generators
   plugin_data.param_key = NOISE_GENERATOR_FIELD;
@@ -253,8 +353,62 @@ bool StompOptimizationTask::generateNoisyParameters(const Eigen::MatrixXd& param
                                      Eigen::MatrixXd& parameters_noise,
                                      Eigen::MatrixXd& noise)
 {
-  return noise_generators_.back()->generateNoise(parameters,start_timestep,num_timesteps,iteration_number,rollout_number,
-                                                 parameters_noise,noise);
+  auto start_time = utils::PluginProfiler::Clock::now();
+  bool succeeded = noise_generators_.back()->generateNoise(parameters,start_timestep,num_timesteps,iteration_number,
+                                                           rollout_number,parameters_noise,noise);
+  profiler_.record(noise_generator_profile_index_,utils::PluginProfiler::Clock::now() - start_time);
+  return succeeded;
+}
+
+bool StompOptimizationTask::supportsRefInterface() const
+{
+  if(noise_generators_.empty() || !noise_generators_.back()->supportsRefInterface())
+  {
+    return false;
+  }
+
+  for(const auto& cf : cost_functions_)
+  {
+    if(!cf->supportsRefInterface())
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool StompOptimizationTask::generateNoisyParametersRef(const Eigen::Ref<const Eigen::MatrixXd>& parameters,
+                                                       std::size_t start_timestep,
+                                                       std::size_t num_timesteps,
+                                                       int iteration_number,
+                                                       int rollout_number,
+                                                       Eigen::Ref<Eigen::MatrixXd> parameters_noise,
+                                                       Eigen::Ref<Eigen::MatrixXd> noise)
+{
+  auto start_time = utils::PluginProfiler::Clock::now();
+  bool succeeded = noise_generators_.back()->generateNoiseRef(parameters,start_timestep,num_timesteps,iteration_number,
+                                                              rollout_number,parameters_noise,noise);
+  profiler_.record(noise_generator_profile_index_,utils::PluginProfiler::Clock::now() - start_time);
+  return succeeded;
+}
+
+bool StompOptimizationTask::computeNoisyCostsRef(const Eigen::Ref<const Eigen::MatrixXd>& parameters,
+                                                 std::size_t start_timestep,
+                                                 std::size_t num_timesteps,
+                                                 int iteration_number,
+                                                 int rollout_number,
+                                                 Eigen::Ref<Eigen::VectorXd> costs,
+                                                 bool& validity)
+{
+  std::size_t worker = stomp_core::ThreadPool::getWorkerIndex();
+  if(worker >= worker_cost_functions_.size())
+  {
+    ROS_ERROR("StompOptimizationTask/%s has no cost functions allocated for worker %lu",group_name_.c_str(),worker);
+    return false;
+  }
+
+  return computeCostFunctionsCosts(worker_cost_functions_[worker],parameters,start_timestep,num_timesteps,
+                                   iteration_number,rollout_number,worker,costs,validity);
 }
 
 bool StompOptimizationTask::computeNoisyCosts(const Eigen::MatrixXd& parameters,
@@ -265,24 +419,71 @@ bool StompOptimizationTask::computeNoisyCosts(const Eigen::MatrixXd& parameters,
                                          Eigen::VectorXd& costs,
                                          bool& validity)
 {
-  Eigen::MatrixXd cost_matrix = Eigen::MatrixXd::Zero(num_timesteps,cost_functions_.size());
-  Eigen::VectorXd state_costs = Eigen::VectorXd::Zero(num_timesteps);
-  validity = true;
-  for(auto i = 0u; i < cost_functions_.size(); i++ )
+  std::size_t worker = stomp_core::ThreadPool::getWorkerIndex();
+  if(worker >= worker_cost_functions_.size())
   {
-    bool valid;
-    auto cf = cost_functions_[i];
+    ROS_ERROR("StompOptimizationTask/%s has no cost functions allocated for worker %lu",group_name_.c_str(),worker);
+    return false;
+  }
 
-    if(!cf->computeCosts(parameters,start_timestep,num_timesteps,iteration_number,rollout_number,state_costs,valid))
+  return computeCostFunctionsCosts(worker_cost_functions_[worker],parameters,start_timestep,num_timesteps,
+                                   iteration_number,rollout_number,worker,costs,validity);
+}
+
+bool StompOptimizationTask::supportsBatchCosts() const
+{
+  if(cost_functions_.empty())
+  {
+    return false;
+  }
+
+  for(const auto& cf : cost_functions_)
+  {
+    if(!cf->supportsBatchCosts())
     {
       return false;
     }
+  }
+  return true;
+}
 
-    validity &= valid;
+bool StompOptimizationTask::computeNoisyCostsBatch(const Eigen::MatrixXd& parameters,
+                                                   std::size_t start_timestep,
+                                                   std::size_t num_timesteps,
+                                                   int iteration_number,
+                                                   int num_rollouts,
+                                                   Eigen::MatrixXd& costs,
+                                                   std::vector<bool>& validities)
+{
+  // batches are evaluated from a single thread by the cost function instances of the first worker
+  costs.setZero(num_rollouts,num_timesteps);
+  validities.assign(num_rollouts,true);
+  for(auto i = 0u; i < cost_functions_.size(); i++)
+  {
+    auto& cf = cost_functions_[i];
+    cf->setRolloutStates(&worker_rollout_states_.front());
+    auto start_time = utils::PluginProfiler::Clock::now();
+    bool succeeded = cf->computeCostsBatch(parameters,start_timestep,num_timesteps,iteration_number,num_rollouts,
+                                           batch_state_costs_,batch_validities_);
+    profiler_.record(i,utils::PluginProfiler::Clock::now() - start_time);
+    if(!succeeded)
+    {
+      return false;
+    }
 
-    cost_matrix.col(i) = state_costs * cf->getWeight();
+    if(batch_state_costs_.rows() != num_rollouts || batch_state_costs_.cols() != num_timesteps ||
+        batch_validities_.size() != num_rollouts)
+    {
+      ROS_ERROR("%s returned batch costs of an unexpected size",cf->getName().c_str());
+      return false;
+    }
+
+    costs += batch_state_costs_ * cf->getWeight();
+    for(auto r = 0; r < num_rollouts; r++)
+    {
+      validities[r] = validities[r] && batch_validities_[r];
+    }
   }
-  costs = cost_matrix.rowwise().sum();
   return true;
 }
 
@@ -293,27 +494,203 @@ bool StompOptimizationTask::computeCosts(const Eigen::MatrixXd& parameters,
                                          Eigen::VectorXd& costs,
                                          bool& validity)
 {
-  Eigen::MatrixXd cost_matrix = Eigen::MatrixXd::Zero(num_timesteps,cost_functions_.size());
-  Eigen::VectorXd state_costs = Eigen::VectorXd::Zero(num_timesteps);
+  return computeMemoizedCosts(parameters,start_timestep,num_timesteps,iteration_number,costs,validity);
+}
+
+bool StompOptimizationTask::computeCostsRef(const Eigen::Ref<const Eigen::MatrixXd>& parameters,
+                                            std::size_t start_timestep,
+                                            std::size_t num_timesteps,
+                                            int iteration_number,
+                                            Eigen::Ref<Eigen::VectorXd> costs,
+                                            bool& validity)
+{
+  return computeMemoizedCosts(parameters,start_timestep,num_timesteps,iteration_number,costs,validity);
+}
+
+template<typename Parameters,typename Costs>
+bool StompOptimizationTask::computeMemoizedCosts(const Parameters& parameters,
+                                                 std::size_t start_timestep,
+                                                 std::size_t num_timesteps,
+                                                 int iteration_number,
+                                                 Costs& costs,
+                                                 bool& validity)
+{
+  // an identical query within the same iteration returns the result of the previous evaluation, the comparison of the
+  // parameters stops at the first differing value
+  if(cached_costs_valid_ && cached_iteration_ == iteration_number && cached_start_timestep_ == start_timestep &&
+      cached_parameters_.rows() == parameters.rows() &&
+      cached_parameters_.cols() == num_timesteps && cached_parameters_ == parameters.middleCols(start_timestep,num_timesteps))
+  {
+    costs = cached_costs_;
+    validity = cached_validity_;
+    return true;
+  }
+
+  cached_costs_valid_ = false;
+  if(!computeCostFunctionsCosts(cost_functions_,parameters,start_timestep,num_timesteps,
+                                iteration_number,-1,0,costs,validity))
+  {
+    return false;
+  }
+
+  cached_parameters_ = parameters.middleCols(start_timestep,num_timesteps);
+  cached_costs_ = costs;
+  cached_validity_ = validity;
+  cached_iteration_ = iteration_number;
+  cached_start_timestep_ = start_timestep;
+  cached_costs_valid_ = true;
+  return true;
+}
+
+template<typename Parameters,typename Costs>
+bool StompOptimizationTask::computeCostFunctionsCosts(const std::vector<cost_functions::StompCostFunctionPtr>& cost_functions,
+                                                      const Parameters& parameters,
+                                                      std::size_t start_timestep,
+                                                      std::size_t num_timesteps,
+                                                      int iteration_number,
+                                                      int rollout_number,
+                                                      std::size_t worker,
+                                                      Costs& costs,
+                                                      bool& validity)
+{
+  utils::RolloutStates& rollout_states = worker_rollout_states_[worker];
+  Eigen::VectorXd& state_costs = worker_state_costs_[worker];
+
+  // a view already has the size of the requested timesteps
+  costs.resize(num_timesteps);
+  costs.setZero();
   validity = true;
-  for(auto i = 0u; i < cost_functions_.size(); i++ )
+  bool cascade = cascade_weight_ > 0.0 && rollout_number >= 0 && worker < worker_min_costs_.size();
+  for(auto j = 0u; j < cascade_order_.size(); j++)
   {
     bool valid;
-    auto cf = cost_functions_[i];
+    auto i = cascade_order_[j];
+    auto cf = cost_functions[i];
+    int index = rollout_number < 0 ? cf->getOptimizedIndex() : rollout_number;
+
+    // a cost function of the last timestep has nothing to add to a range that ends before it
+    bool last_timestep_only = cf->getCostSupport() == cost_functions::CostSupports::LAST_TIMESTEP;
+    if(last_timestep_only && start_timestep + num_timesteps < parameters.cols())
+    {
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock;
+    if(cost_function_locks_[i])
+    {
+      lock = std::unique_lock<std::mutex>(*cost_function_locks_[i]);
+    }
+
+    // the states are computed by the first cost function that requests a timestep and reused by the others
+    cf->setRolloutStates(&rollout_states);
 
-    if(!cf->computeCosts(parameters,start_timestep,num_timesteps,iteration_number,cf->getOptimizedIndex(),state_costs,valid))
+    auto start_time = utils::PluginProfiler::Clock::now();
+    bool succeeded = computePluginCosts(*cf,parameters,start_timestep,num_timesteps,iteration_number,index,state_costs,
+                                        valid);
+    profiler_.record(i,utils::PluginProfiler::Clock::now() - start_time);
+    if(!succeeded)
     {
       return false;
     }
 
     validity &= valid;
 
-    cost_matrix.col(i) = state_costs * cf->getWeight();
+    // cost functions may return the costs of the requested timesteps only or those of the whole trajectory
+    if(last_timestep_only)
+    {
+      costs(num_timesteps - 1) += state_costs(state_costs.size() - 1) * cf->getWeight();
+    }
+    else if(state_costs.size() != num_timesteps && state_costs.size() == parameters.cols())
+    {
+      costs += state_costs.segment(start_timestep,num_timesteps) * cf->getWeight();
+    }
+    else
+    {
+      costs += state_costs * cf->getWeight();
+    }
+
+    // the remaining cost functions can only add to the costs of a noisy trajectory already bound to a negligible weight
+    if(cascade && j + 1 < cascade_order_.size() && costs.sum() > cascade_bound_*num_timesteps)
+    {
+      validity = false;
+      break;
+    }
+  }
+
+  if(cascade)
+  {
+    double mean_cost = costs.sum()/num_timesteps;
+    worker_min_costs_[worker] = std::min(worker_min_costs_[worker],mean_cost);
+    worker_max_costs_[worker] = std::max(worker_max_costs_[worker],mean_cost);
   }
-  costs = cost_matrix.rowwise().sum();
   return true;
 }
 
+void StompOptimizationTask::updateCostCascade()
+{
+  if(cascade_weight_ <= 0.0 || worker_min_costs_.empty())
+  {
+    return;
+  }
+
+  // the profiler lists the cost functions first
+  std::vector<utils::PluginProfiler::Statistics> statistics = profiler_.getStatistics();
+  if(statistics.size() < cost_functions_.size())
+  {
+    return;
+  }
+  std::stable_sort(cascade_order_.begin(),cascade_order_.end(),[&statistics](std::size_t a,std::size_t b){
+    return statistics[a].mean_time < statistics[b].mean_time;
+  });
+
+  // a trajectory whose cost exceeds the lowest one by this fraction of the cost range has at most the configured weight
+  // in the exponentiated cost probabilities, the range of the next iteration is assumed to be similar
+  double min_cost = *std::min_element(worker_min_costs_.begin(),worker_min_costs_.end());
+  double max_cost = *std::max_element(worker_max_costs_.begin(),worker_max_costs_.end());
+  cascade_bound_ = std::numeric_limits<double>::infinity();
+  if(max_cost - min_cost > MIN_CASCADE_COST_RANGE && cascade_sensitivity_ > 0.0)
+  {
+    cascade_bound_ = min_cost + (max_cost - min_cost)*std::log(1.0/cascade_weight_)/cascade_sensitivity_;
+  }
+  std::fill(worker_min_costs_.begin(),worker_min_costs_.end(),std::numeric_limits<double>::infinity());
+  std::fill(worker_max_costs_.begin(),worker_max_costs_.end(),-std::numeric_limits<double>::infinity());
+}
+
+void StompOptimizationTask::allocateWorkerCostFunctions(std::size_t num_threads)
+{
+  num_threads = num_threads < 1 ? 1 : num_threads;
+  if(worker_cost_functions_.size() == num_threads)
+  {
+    return;
+  }
+
+  worker_cost_functions_.resize(1);
+  worker_cost_functions_.front() = cost_functions_;
+  worker_state_costs_.resize(num_threads);
+  worker_rollout_states_.resize(num_threads);
+  cost_function_locks_.assign(cost_functions_.size(),nullptr);
+
+  for(auto w = 1u; w < num_threads; w++)
+  {
+    std::vector<cost_functions::StompCostFunctionPtr> worker_instances;
+    for(auto i = 0u; i < cost_functions_.size(); i++)
+    {
+      cost_functions::StompCostFunctionPtr cf = cost_functions_[i]->clone();
+      if(!cf)
+      {
+        if(!cost_function_locks_[i])
+        {
+          ROS_WARN("%s can not be cloned, its costs will be evaluated serially",cost_functions_[i]->getName().c_str());
+          cost_function_locks_[i].reset(new std::mutex());
+        }
+        cf = cost_functions_[i];
+      }
+      worker_instances.push_back(cf);
+    }
+    worker_cost_functions_.push_back(worker_instances);
+  }
+}
+
 bool StompOptimizationTask::setMotionPlanRequest(const planning_scene::PlanningSceneConstPtr& planning_scene,
                                         const moveit_msgs::MotionPlanRequest &req,
                                         const stomp_core::StompConfiguration &config,
@@ -328,15 +705,78 @@ bool StompOptimizationTask::setMotionPlanRequest(const planning_scene::PlanningS
     }
   }
 
-  for(auto p : cost_functions_)
+  allocateWorkerCostFunctions(config.num_threads);
+  cached_costs_valid_ = false;
+
+  // the plugins are profiled from their first call of this request on
+  std::vector<std::string> plugin_names;
+  for(auto& p : cost_functions_)
   {
-    if(!p->setMotionPlanRequest(planning_scene,req,config,error_code))
+    plugin_names.push_back(p->getName());
+  }
+  noisy_filters_profile_offset_ = plugin_names.size();
+  for(auto& p : noisy_filters_)
+  {
+    plugin_names.push_back(p->getName());
+  }
+  update_filters_profile_offset_ = plugin_names.size();
+  for(auto& p : update_filters_)
+  {
+    plugin_names.push_back(p->getName());
+  }
+  noise_generator_profile_index_ = plugin_names.size();
+  plugin_names.push_back(noise_generators_.back()->getName());
+  profiler_.initialize(plugin_names,worker_cost_functions_.size());
+  for(auto& state_costs : worker_state_costs_)
+  {
+    state_costs.setZero(config.num_timesteps);
+  }
+  batch_state_costs_.setZero(config.num_rollouts,config.num_timesteps);
+  batch_validities_.assign(config.num_rollouts,true);
+
+  // the cost cascade rejects nothing until the costs of a first iteration are known
+  cascade_sensitivity_ = config.exponentiated_cost_sensitivity;
+  cascade_bound_ = std::numeric_limits<double>::infinity();
+  worker_min_costs_.assign(worker_cost_functions_.size(),std::numeric_limits<double>::infinity());
+  worker_max_costs_.assign(worker_cost_functions_.size(),-std::numeric_limits<double>::infinity());
+
+  // the shared states start from the request start state, the cost functions only set the joints of the group
+  moveit::core::RobotState reference_state = planning_scene->getCurrentState();
+  if(!moveit::core::robotStateMsgToRobotState(req.start_state,reference_state,true))
+  {
+    ROS_ERROR("StompOptimizationTask/%s failed to get the start state from the request",group_name_.c_str());
+    error_code.val = moveit_msgs::MoveItErrorCodes::INVALID_ROBOT_STATE;
+    return false;
+  }
+
+  for(auto& states : worker_rollout_states_)
+  {
+    if(!states.initialize(reference_state,group_name_,config.num_timesteps))
     {
-      ROS_ERROR("Failed to set Plan Request on cost function %s",p->getName().c_str());
+      ROS_ERROR("StompOptimizationTask/%s failed to allocate the rollout states",group_name_.c_str());
+      error_code.val = moveit_msgs::MoveItErrorCodes::INVALID_GROUP_NAME;
       return false;
     }
   }
 
+  for(auto w = 0u; w < worker_cost_functions_.size(); w++)
+  {
+    for(auto i = 0u; i < cost_functions_.size(); i++)
+    {
+      auto& p = worker_cost_functions_[w][i];
+      if(w > 0 && p == cost_functions_[i])
+      {
+        continue; // shared instance already set
+      }
+
+      if(!p->setMotionPlanRequest(planning_scene,req,config,error_code))
+      {
+        ROS_ERROR("Failed to set Plan Request on cost function %s",p->getName().c_str());
+        return false;
+      }
+    }
+  }
+
   for(auto p: noisy_filters_)
   {
     if(!p->setMotionPlanRequest(planning_scene,req,config,error_code))
@@ -366,9 +806,12 @@ bool StompOptimizationTask::filterNoisyParameters(std::size_t start_timestep,
 {
   filtered = false;
   bool temp;
-  for(auto& f: noisy_filters_)
+  for(auto i = 0u; i < noisy_filters_.size(); i++)
   {
-    if(f->filter(start_timestep,num_timesteps,iteration_number,rollout_number,parameters,temp))
+    auto start_time = utils::PluginProfiler::Clock::now();
+    bool succeeded = noisy_filters_[i]->filter(start_timestep,num_timesteps,iteration_number,rollout_number,parameters,temp);
+    profiler_.record(noisy_filters_profile_offset_ + i,utils::PluginProfiler::Clock::now() - start_time);
+    if(succeeded)
     {
       filtered |= temp;
     }
@@ -388,9 +831,12 @@ bool StompOptimizationTask::filterParameterUpdates(std::size_t start_timestep,
 {
   bool filtered = false;
   bool temp;
-  for(auto& f: update_filters_)
+  for(auto i = 0u; i < update_filters_.size(); i++)
   {
-    if(f->filter(start_timestep,num_timesteps,iteration_number,parameters,updates,temp))
+    auto start_time = utils::PluginProfiler::Clock::now();
+    bool succeeded = update_filters_[i]->filter(start_timestep,num_timesteps,iteration_number,parameters,updates,temp);
+    profiler_.record(update_filters_profile_offset_ + i,utils::PluginProfiler::Clock::now() - start_time);
+    if(succeeded)
     {
       filtered |= temp;
     }
@@ -410,9 +856,15 @@ void StompOptimizationTask::postIteration(std::size_t start_timestep,
     p->postIteration(start_timestep,num_timesteps,iteration_number,cost,parameters);
   }
 
-  for(auto p : cost_functions_)
+  for(auto w = 0u; w < worker_cost_functions_.size(); w++)
   {
-    p->postIteration(start_timestep,num_timesteps,iteration_number,cost,parameters);
+    for(auto i = 0u; i < cost_functions_.size(); i++)
+    {
+      if(w == 0 || worker_cost_functions_[w][i] != cost_functions_[i])
+      {
+        worker_cost_functions_[w][i]->postIteration(start_timestep,num_timesteps,iteration_number,cost,parameters);
+      }
+    }
   }
 
   for(auto p: noisy_filters_)
@@ -424,19 +876,44 @@ void StompOptimizationTask::postIteration(std::size_t start_timestep,
   {
     p->postIteration(start_timestep,num_timesteps,iteration_number,cost,parameters);
   }
+
+  updateCostCascade();
+}
+
+bool StompOptimizationTask::getValidityCertificate(const Eigen::MatrixXd& parameters,
+                                                   cost_functions::ValidityCertificate& certificate) const
+{
+  for(auto cf : cost_functions_)
+  {
+    if(cf->getValidityCertificate(certificate) && certificate.parameters.rows() == parameters.rows() &&
+        certificate.parameters.cols() == parameters.cols() && certificate.parameters == parameters)
+    {
+      return true;
+    }
+  }
+  return false;
 }
 
 void StompOptimizationTask::done(bool success,int total_iterations,double final_cost,const Eigen::MatrixXd& parameters)
 {
+  // the scene may change before the next optimization
+  cached_costs_valid_ = false;
+
   for(auto p : noise_generators_)
   {
     p->done(success,total_iterations,final_cost,parameters);
   }
 
 
-  for(auto p : cost_functions_)
+  for(auto w = 0u; w < worker_cost_functions_.size(); w++)
   {
-    p->done(success,total_iterations,final_cost,parameters);
+    for(auto i = 0u; i < cost_functions_.size(); i++)
+    {
+      if(w == 0 || worker_cost_functions_[w][i] != cost_functions_[i])
+      {
+        worker_cost_functions_[w][i]->done(success,total_iterations,final_cost,parameters);
+      }
+    }
   }
 
   for(auto p: noisy_filters_)
@@ -29,15 +29,34 @@
 #include <class_loader/class_loader.h>
 #include <stomp_core/utils.h>
 #include <moveit/trajectory_processing/iterative_time_parameterization.h>
+#include <moveit/kinematic_constraints/utils.h>
+#include <random_numbers/random_numbers.h>
+#include <stomp_moveit/utils/instrumentation_publisher.h>
 #include <stomp_moveit/utils/kinematics.h>
+#include <stomp_moveit/utils/plan_capture.h>
 #include <stomp_moveit/utils/polynomial.h>
+#include <stomp_moveit/utils/seed_transport.h>
+#include <stomp_moveit/utils/time_parameterization.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <chrono>
+#include <map>
+#include <thread>
+#include <tuple>
 
 
 static const std::string DESCRIPTION = "STOMP";
-static const double TIMEOUT_INTERVAL = 0.05;
 static int const IK_ATTEMPTS = 10;
 static int const IK_TIMEOUT = 0.05;
 const static double MAX_START_DISTANCE_THRESH = 0.5;
+static const double DEFAULT_WARM_START_TOLERANCE = 0.1;
+static const int DEFAULT_EXPERIENCE_LIBRARY_SIZE = 1000;
+static const int DEFAULT_REFINE_ITERATIONS = 10;
+static const int DEFAULT_MIN_TIMESTEPS = 10;
+static const int DEFAULT_TIMESTEPS_INCREMENT = 5;
+static const int DEFAULT_REPAIR_PADDING = 5;
+static const double GOAL_CANDIDATE_TOLERANCE = 1e-3;
 
 /**
  * @brief Parses a XmlRpcValue and populates a StompComfiguration structure.
@@ -58,7 +77,18 @@ bool parseConfig(XmlRpc::XmlRpcValue config,const moveit::core::JointModelGroup*
   stomp_config.num_iterations_after_valid = 0;
   stomp_config.max_rollouts = 100;
   stomp_config.num_rollouts = 10;
+  stomp_config.min_rollouts = 0;
+  stomp_config.seed = 0;
   stomp_config.exponentiated_cost_sensitivity = 10.0;
+  stomp_config.num_threads = 1;
+  stomp_config.window_size = 0;
+  stomp_config.num_control_points = 0;
+  stomp_config.single_precision = false;
+  stomp_config.streaming_block_size = 0;
+  stomp_config.convergence_iterations = 0;
+  stomp_config.convergence_cost_epsilon = 0.0;
+  stomp_config.convergence_update_threshold = 0.0;
+  stomp_config.max_optimization_time = 0.0;
 
   // Load optional config parameters if they exist
   if (config.hasMember("control_cost_weight"))
@@ -85,9 +115,42 @@ bool parseConfig(XmlRpc::XmlRpcValue config,const moveit::core::JointModelGroup*
   if (config.hasMember("num_rollouts"))
     stomp_config.num_rollouts = static_cast<int>(config["num_rollouts"]);
 
+  if (config.hasMember("min_rollouts"))
+    stomp_config.min_rollouts = static_cast<int>(config["min_rollouts"]);
+
   if (config.hasMember("exponentiated_cost_sensitivity"))
     stomp_config.exponentiated_cost_sensitivity = static_cast<int>(config["exponentiated_cost_sensitivity"]);
 
+  if (config.hasMember("num_threads"))
+    stomp_config.num_threads = static_cast<int>(config["num_threads"]);
+
+  if (config.hasMember("window_size"))
+    stomp_config.window_size = static_cast<int>(config["window_size"]);
+
+  if (config.hasMember("num_control_points"))
+    stomp_config.num_control_points = static_cast<int>(config["num_control_points"]);
+
+  if (config.hasMember("single_precision"))
+    stomp_config.single_precision = static_cast<bool>(config["single_precision"]);
+
+  if (config.hasMember("streaming_block_size"))
+    stomp_config.streaming_block_size = static_cast<int>(config["streaming_block_size"]);
+
+  if (config.hasMember("convergence_iterations"))
+    stomp_config.convergence_iterations = static_cast<int>(config["convergence_iterations"]);
+
+  if (config.hasMember("convergence_cost_epsilon"))
+    stomp_config.convergence_cost_epsilon = static_cast<double>(config["convergence_cost_epsilon"]);
+
+  if (config.hasMember("convergence_update_threshold"))
+    stomp_config.convergence_update_threshold = static_cast<double>(config["convergence_update_threshold"]);
+
+  if (config.hasMember("max_optimization_time"))
+    stomp_config.max_optimization_time = static_cast<double>(config["max_optimization_time"]);
+
+  if (config.hasMember("seed"))
+    stomp_config.seed = static_cast<int>(config["seed"]);
+
   // getting number of joints
   stomp_config.num_dimensions = group->getActiveJointModels().size();
   if(stomp_config.num_dimensions == 0)
@@ -99,21 +162,216 @@ bool parseConfig(XmlRpc::XmlRpcValue config,const moveit::core::JointModelGroup*
   return true;
 }
 
+/**
+ * @brief Returns the thread pool shared by the planners of this process that are configured with the same executor
+ * parameters, so that concurrent planning requests take turns on the same threads instead of oversubscribing the CPUs.
+ * The pool is destroyed with the last planner using it.
+ * @param num_threads The total number of threads of the pool
+ * @param cpus        The CPUs its threads may run on, empty for any
+ * @param nice        The nice value of its threads, 0 to inherit it
+ * @return The shared pool
+ */
+stomp_core::ThreadPoolPtr getSharedExecutor(int num_threads,const std::vector<int>& cpus,int nice)
+{
+  typedef std::tuple<int,std::vector<int>,int> ExecutorKey;
+  static std::mutex executors_mutex;
+  static std::map<ExecutorKey,std::weak_ptr<stomp_core::ThreadPool> > executors;
+
+  std::lock_guard<std::mutex> lock(executors_mutex);
+  ExecutorKey key(num_threads,cpus,nice);
+  stomp_core::ThreadPoolPtr executor = executors[key].lock();
+  if(!executor)
+  {
+    executor = std::make_shared<stomp_core::ThreadPool>(num_threads,cpus,nice);
+    executors[key] = executor;
+  }
+  return executor;
+}
+
 namespace stomp_moveit
 {
 
+PlanHandle::PlanHandle(StompPlanner* planner,const planning_scene::PlanningSceneConstPtr& planning_scene,
+                       const moveit_msgs::MotionPlanRequest& req):
+    planner_(planner),
+    planning_scene_(planning_scene),
+    request_(req),
+    status_(QUEUED),
+    cancel_requested_(false),
+    best_cost_(std::numeric_limits<double>::max()),
+    best_iteration_(0),
+    best_valid_(false)
+{
+  future_ = promise_.get_future().share();
+}
+
+PlanHandle::Status PlanHandle::getStatus() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return status_;
+}
+
+bool PlanHandle::isDone() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return status_ != QUEUED && status_ != RUNNING;
+}
+
+bool PlanHandle::wait(double timeout) const
+{
+  if(timeout < 0.0)
+  {
+    future_.wait();
+    return true;
+  }
+
+  return future_.wait_for(std::chrono::duration<double>(timeout)) == std::future_status::ready;
+}
+
+std::shared_future<bool> PlanHandle::getFuture() const
+{
+  return future_;
+}
+
+void PlanHandle::cancel()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  cancel_requested_ = true;
+  if(status_ == RUNNING)
+  {
+    planner_->terminate();
+  }
+}
+
+double PlanHandle::getElapsedTime() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  switch(status_)
+  {
+    case QUEUED:
+      return 0.0;
+    case RUNNING:
+      return (ros::WallTime::now() - start_time_).toSec();
+    default:
+      return start_time_.isZero() ? 0.0 : (end_time_ - start_time_).toSec();
+  }
+}
+
+bool PlanHandle::getBestValidParameters(Eigen::MatrixXd& parameters,double& cost,unsigned int& iteration) const
+{
+  // the planner outlives the running plan, it is queried under the lock so that the plan can not finish meanwhile
+  std::lock_guard<std::mutex> lock(mutex_);
+  if(status_ == RUNNING)
+  {
+    return planner_->getBestValidParameters(parameters,cost,iteration);
+  }
+
+  if(!best_valid_)
+  {
+    return false;
+  }
+
+  parameters = best_parameters_;
+  cost = best_cost_;
+  iteration = best_iteration_;
+  return true;
+}
+
+bool PlanHandle::getResponse(planning_interface::MotionPlanDetailedResponse& res) const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if(status_ == QUEUED || status_ == RUNNING)
+  {
+    return false;
+  }
+
+  res = response_;
+  return true;
+}
+
+trajectory::SharedTrajectoryConstPtr PlanHandle::getSharedTrajectory() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return shared_trajectory_;
+}
+
+bool PlanHandle::start()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if(!cancel_requested_)
+    {
+      status_ = RUNNING;
+      start_time_ = ros::WallTime::now();
+      return true;
+    }
+    status_ = CANCELLED;
+  }
+
+  promise_.set_value(false);
+  return false;
+}
+
+void PlanHandle::finish(bool success,const planning_interface::MotionPlanDetailedResponse& res)
+{
+  Eigen::MatrixXd parameters;
+  double cost;
+  unsigned int iteration;
+  bool valid = planner_->getBestValidParameters(parameters,cost,iteration);
+  trajectory::SharedTrajectoryConstPtr shared_trajectory = success ? planner_->getSharedTrajectory() :
+      trajectory::SharedTrajectoryConstPtr();
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    end_time_ = ros::WallTime::now();
+    response_ = res;
+    shared_trajectory_ = shared_trajectory;
+    best_valid_ = valid;
+    if(valid)
+    {
+      best_parameters_ = parameters;
+      best_cost_ = cost;
+      best_iteration_ = iteration;
+    }
+    status_ = success ? SUCCEEDED : (cancel_requested_ ? CANCELLED : FAILED);
+  }
+
+  promise_.set_value(success);
+}
+
 StompPlanner::StompPlanner(const std::string& group,const XmlRpc::XmlRpcValue& config,
                            const moveit::core::RobotModelConstPtr& model):
     PlanningContext(DESCRIPTION,group),
     config_(config),
+    cancel_requested_(false),
     robot_model_(model),
-    ph_(new ros::NodeHandle("~"))
+    ph_(new ros::NodeHandle("~")),
+    async_shutdown_(false)
 {
   setup();
 }
 
 StompPlanner::~StompPlanner()
 {
+  // the queued plans are cancelled and the running one stops at its next rollout
+  {
+    std::lock_guard<std::mutex> lock(async_mutex_);
+    async_shutdown_ = true;
+    for(auto& handle : async_queue_)
+    {
+      handle->cancel();
+    }
+    if(async_running_)
+    {
+      async_running_->cancel();
+    }
+  }
+  async_condition_.notify_all();
+
+  if(async_thread_.joinable())
+  {
+    async_thread_.join();
+  }
 }
 
 void StompPlanner::setup()
@@ -146,7 +404,223 @@ void StompPlanner::setup()
       throw std::logic_error(msg);
     }
 
+    // executor shared with the other planners of the process, it replaces the pool of 'num_threads' of each optimizer
+    executor_.reset();
+    if(config_["optimization"].hasMember("executor_threads"))
+    {
+      int executor_threads = static_cast<int>(config_["optimization"]["executor_threads"]);
+      std::vector<int> executor_cpus;
+      if(config_["optimization"].hasMember("executor_cpus"))
+      {
+        XmlRpc::XmlRpcValue& cpus = config_["optimization"]["executor_cpus"];
+        for(auto i = 0; i < cpus.size(); i++)
+        {
+          executor_cpus.push_back(static_cast<int>(cpus[i]));
+        }
+      }
+      int executor_nice = config_["optimization"].hasMember("executor_nice") ?
+          static_cast<int>(config_["optimization"]["executor_nice"]) : 0;
+
+      if(executor_threads > 0)
+      {
+        executor_ = getSharedExecutor(executor_threads,executor_cpus,executor_nice);
+        stomp_config_.num_threads = static_cast<int>(executor_->size());
+      }
+    }
+
     stomp_.reset(new stomp_core::Stomp(stomp_config_,task_));
+    if(executor_)
+    {
+      stomp_->setThreadPool(executor_);
+    }
+    attempt_stomps_.assign(1,stomp_);
+    selected_attempt_ = -1;
+    attempt_tasks_.assign(1,task_);
+
+    // cost below which the first valid planning attempt cancels the remaining ones
+    multi_start_cost_threshold_ = std::numeric_limits<double>::max();
+    if(config_["optimization"].hasMember("multi_start_cost_threshold"))
+    {
+      multi_start_cost_threshold_ = static_cast<double>(config_["optimization"]["multi_start_cost_threshold"]);
+    }
+
+    // every attempt runs on a thread of its own and optimizes on 'num_threads' threads or on the shared executor
+    std::size_t hardware_threads = std::max(1u,std::thread::hardware_concurrency());
+    max_planning_attempts_ = executor_ ? executor_->size() :
+        std::max<std::size_t>(1,hardware_threads/std::max(1,stomp_config_.num_threads));
+    if(config_["optimization"].hasMember("max_planning_attempts"))
+    {
+      max_planning_attempts_ = std::max(1,static_cast<int>(config_["optimization"]["max_planning_attempts"]));
+    }
+
+    // warm start cache of previously optimized trajectories
+    int warm_start_cache_size = 0;
+    double warm_start_tolerance = DEFAULT_WARM_START_TOLERANCE;
+    if(config_["optimization"].hasMember("warm_start_cache_size"))
+    {
+      warm_start_cache_size = static_cast<int>(config_["optimization"]["warm_start_cache_size"]);
+    }
+    if(config_["optimization"].hasMember("warm_start_tolerance"))
+    {
+      warm_start_tolerance = static_cast<double>(config_["optimization"]["warm_start_tolerance"]);
+    }
+    trajectory_cache_.configure(std::max(warm_start_cache_size,0),warm_start_tolerance);
+
+    // number of timesteps selected from the distance between the start and the goal
+    timestep_resolution_ = 0.0;
+    min_timesteps_ = DEFAULT_MIN_TIMESTEPS;
+    max_timesteps_ = stomp_config_.num_timesteps;
+    timesteps_increment_ = DEFAULT_TIMESTEPS_INCREMENT;
+    if(config_["optimization"].hasMember("timestep_resolution"))
+    {
+      timestep_resolution_ = static_cast<double>(config_["optimization"]["timestep_resolution"]);
+    }
+    if(config_["optimization"].hasMember("min_timesteps"))
+    {
+      min_timesteps_ = static_cast<int>(config_["optimization"]["min_timesteps"]);
+    }
+    if(config_["optimization"].hasMember("max_timesteps"))
+    {
+      max_timesteps_ = static_cast<int>(config_["optimization"]["max_timesteps"]);
+    }
+    if(config_["optimization"].hasMember("timesteps_increment"))
+    {
+      timesteps_increment_ = static_cast<int>(config_["optimization"]["timesteps_increment"]);
+    }
+    min_timesteps_ = std::max(min_timesteps_,2);
+    max_timesteps_ = std::max(max_timesteps_,min_timesteps_);
+    timesteps_increment_ = std::max(timesteps_increment_,1);
+
+    // persistent library of optimized trajectories shared with the other processes planning for this group
+    experience_library_.reset();
+    match_experience_scene_ = true;
+    if(config_["optimization"].hasMember("experience_library_file"))
+    {
+      std::string file_name = static_cast<std::string>(config_["optimization"]["experience_library_file"]);
+      int library_size = DEFAULT_EXPERIENCE_LIBRARY_SIZE;
+      int library_timesteps = timestep_resolution_ > 0.0 ? std::max(max_timesteps_,stomp_config_.num_timesteps) :
+          stomp_config_.num_timesteps;
+      double library_tolerance = warm_start_tolerance;
+      if(config_["optimization"].hasMember("experience_library_size"))
+      {
+        library_size = static_cast<int>(config_["optimization"]["experience_library_size"]);
+      }
+      if(config_["optimization"].hasMember("experience_library_max_timesteps"))
+      {
+        library_timesteps = static_cast<int>(config_["optimization"]["experience_library_max_timesteps"]);
+      }
+      if(config_["optimization"].hasMember("experience_library_tolerance"))
+      {
+        library_tolerance = static_cast<double>(config_["optimization"]["experience_library_tolerance"]);
+      }
+      if(config_["optimization"].hasMember("experience_library_match_scene"))
+      {
+        match_experience_scene_ = static_cast<bool>(config_["optimization"]["experience_library_match_scene"]);
+      }
+
+      std::shared_ptr<utils::ExperienceLibrary> library(new utils::ExperienceLibrary());
+      if(library->open(file_name,group_,stomp_config_.num_dimensions,std::max(library_timesteps,0),
+                       std::max(library_size,0),library_tolerance))
+      {
+        experience_library_ = library;
+      }
+      else
+      {
+        ROS_WARN("%s is planning without the experience library '%s'",getName().c_str(),file_name.c_str());
+      }
+    }
+
+    // coarse optimization seeding a short one at full resolution
+    coarse_timesteps_ = 0;
+    refine_iterations_ = DEFAULT_REFINE_ITERATIONS;
+    coarse_padding_ = 0.0;
+    if(config_["optimization"].hasMember("coarse_timesteps"))
+    {
+      coarse_timesteps_ = static_cast<int>(config_["optimization"]["coarse_timesteps"]);
+    }
+    if(config_["optimization"].hasMember("refine_iterations"))
+    {
+      refine_iterations_ = static_cast<int>(config_["optimization"]["refine_iterations"]);
+    }
+    if(config_["optimization"].hasMember("coarse_padding"))
+    {
+      coarse_padding_ = static_cast<double>(config_["optimization"]["coarse_padding"]);
+    }
+
+    // goal selection
+    goal_selection_seeds_ = 0;
+    if(config_["optimization"].hasMember("goal_selection_seeds"))
+    {
+      goal_selection_seeds_ = std::max(static_cast<int>(config_["optimization"]["goal_selection_seeds"]),0);
+    }
+    goal_selection_candidates_ = 1;
+    if(config_["optimization"].hasMember("goal_selection_candidates"))
+    {
+      goal_selection_candidates_ = std::max(static_cast<int>(config_["optimization"]["goal_selection_candidates"]),1);
+    }
+
+    // trajectory repair
+    repair_padding_ = DEFAULT_REPAIR_PADDING;
+    if(config_["optimization"].hasMember("repair_padding"))
+    {
+      repair_padding_ = std::max(static_cast<int>(config_["optimization"]["repair_padding"]),0);
+    }
+
+    // timing of the output trajectory
+    uniform_time_scaling_ = false;
+    if(config_["optimization"].hasMember("uniform_time_scaling"))
+    {
+      uniform_time_scaling_ = static_cast<bool>(config_["optimization"]["uniform_time_scaling"]);
+    }
+
+    // waypoint decimation of the output trajectory
+    decimation_ = trajectory::TrajectoryDecimationParameters();
+    if(config_["optimization"].hasMember("decimation_joint_tolerance"))
+    {
+      decimation_.joint_tolerance = static_cast<double>(config_["optimization"]["decimation_joint_tolerance"]);
+    }
+    if(config_["optimization"].hasMember("decimation_cartesian_tolerance"))
+    {
+      decimation_.cartesian_tolerance = static_cast<double>(config_["optimization"]["decimation_cartesian_tolerance"]);
+    }
+    if(config_["optimization"].hasMember("decimation_tip_link"))
+    {
+      decimation_.tip_link = static_cast<std::string>(config_["optimization"]["decimation_tip_link"]);
+    }
+
+    // profiling of the iterations, the optimizers of the planning attempts share the sinks
+    std::shared_ptr<stomp_core::InstrumentationSinkGroup> sinks(new stomp_core::InstrumentationSinkGroup());
+    instrumentation_sink_.reset();
+    if(config_["optimization"].hasMember("instrumentation_topic"))
+    {
+      std::string topic = static_cast<std::string>(config_["optimization"]["instrumentation_topic"]);
+      sinks->add(std::make_shared<utils::InstrumentationPublisher>(*ph_,topic,group_));
+      instrumentation_sink_ = sinks;
+    }
+    if(config_["optimization"].hasMember("instrumentation_trace_file"))
+    {
+      std::string file_name = static_cast<std::string>(config_["optimization"]["instrumentation_trace_file"]);
+      sinks->add(std::make_shared<stomp_core::ChromeTraceSink>(file_name));
+      instrumentation_sink_ = sinks;
+    }
+    if(instrumentation_sink_ && !stomp_core::isInstrumentationEnabled())
+    {
+      ROS_WARN("Stomp Planner for group '%s' requested instrumentation but stomp_core was built without the "
+               "STOMP_CORE_INSTRUMENTATION option, no profiles will be recorded",group_.c_str());
+    }
+    stomp_->setInstrumentationSink(instrumentation_sink_);
+
+    // capture of the failed and slow plans
+    capture_directory_.clear();
+    capture_time_threshold_ = std::numeric_limits<double>::max();
+    if(config_["optimization"].hasMember("capture_directory"))
+    {
+      capture_directory_ = static_cast<std::string>(config_["optimization"]["capture_directory"]);
+    }
+    if(config_["optimization"].hasMember("capture_time_threshold"))
+    {
+      capture_time_threshold_ = static_cast<double>(config_["optimization"]["capture_time_threshold"]);
+    }
   }
   catch(XmlRpc::XmlRpcException& e)
   {
@@ -172,8 +646,247 @@ bool StompPlanner::solve(planning_interface::MotionPlanResponse &res)
 }
 
 bool StompPlanner::solve(planning_interface::MotionPlanDetailedResponse &res)
+{
+  cancel_requested_ = false;
+  return runPlan(res);
+}
+
+bool StompPlanner::runPlan(planning_interface::MotionPlanDetailedResponse &res)
+{
+  utils::PlanRecord record;
+  ros::WallTime start_time = ros::WallTime::now();
+  bool success = solve(res,record);
+  record.durations[utils::PlanPhases::TOTAL] = (ros::WallTime::now() - start_time).toSec();
+  if(metrics_)
+  {
+    metrics_->record(group_,record);
+  }
+
+  // failed and slow plans are recorded for the offline replay tool
+  if(!capture_directory_.empty() && (record.failure != utils::PlanFailures::NONE ||
+      record.durations[utils::PlanPhases::TOTAL] > capture_time_threshold_))
+  {
+    capturePlan(record);
+  }
+
+  return success;
+}
+
+PlanHandlePtr StompPlanner::solveAsync(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                                       const moveit_msgs::MotionPlanRequest& req)
+{
+  PlanHandlePtr handle(new PlanHandle(this,planning_scene,req));
+  {
+    std::lock_guard<std::mutex> lock(async_mutex_);
+    if(!async_thread_.joinable())
+    {
+      async_thread_ = std::thread(&StompPlanner::runAsyncPlans,this);
+    }
+    async_queue_.push_back(handle);
+  }
+  async_condition_.notify_one();
+
+  return handle;
+}
+
+PlanHandlePtr StompPlanner::solveAsync()
+{
+  return solveAsync(getPlanningScene(),request_);
+}
+
+void StompPlanner::runAsyncPlans()
+{
+  while(true)
+  {
+    PlanHandlePtr handle;
+    {
+      std::unique_lock<std::mutex> lock(async_mutex_);
+      async_condition_.wait(lock,[this](){ return async_shutdown_ || !async_queue_.empty(); });
+      if(async_queue_.empty())
+      {
+        return;
+      }
+
+      handle = async_queue_.front();
+      async_queue_.pop_front();
+      async_running_ = handle;
+    }
+
+    // a plan cancelled while it was queued is done without running, one cancelled once running is latched
+    cancel_requested_ = false;
+    if(handle->start())
+    {
+      setPlanningScene(handle->planning_scene_);
+      setMotionPlanRequest(handle->request_);
+
+      planning_interface::MotionPlanDetailedResponse res;
+      bool success = runPlan(res);
+      handle->finish(success,res);
+    }
+
+    std::lock_guard<std::mutex> lock(async_mutex_);
+    async_running_.reset();
+  }
+}
+
+bool StompPlanner::getBestValidParameters(Eigen::MatrixXd& parameters,double& cost,unsigned int& iteration) const
+{
+  std::lock_guard<std::mutex> lock(attempts_mutex_);
+  bool found = false;
+  Eigen::MatrixXd attempt_parameters;
+  double attempt_cost;
+  unsigned int attempt_iteration;
+  for(const auto& stomp : attempt_stomps_)
+  {
+    if(stomp->getBestValidParameters(attempt_parameters,attempt_cost,attempt_iteration) &&
+        (!found || attempt_cost < cost))
+    {
+      parameters = attempt_parameters;
+      cost = attempt_cost;
+      iteration = attempt_iteration;
+      found = true;
+    }
+  }
+
+  return found;
+}
+
+bool StompPlanner::repair(const trajectory_msgs::JointTrajectory& trajectory,planning_interface::MotionPlanResponse& res)
+{
+  ros::WallTime start_time = ros::WallTime::now();
+  res.error_code_.val = moveit_msgs::MoveItErrorCodes::SUCCESS;
+  selected_attempt_ = -1;
+  shared_trajectory_.reset();
+  cancel_requested_ = false;
+
+  const moveit::core::JointModelGroup* joint_group = robot_model_->getJointModelGroup(group_);
+  if(!planning_scene_ || trajectory.points.size() < 3 ||
+      trajectory.joint_names.size() != joint_group->getActiveJointModelNames().size())
+  {
+    ROS_ERROR("%s can only repair a trajectory of at least 3 points of the group joints in a planning scene",
+              getName().c_str());
+    res.error_code_.val = moveit_msgs::MoveItErrorCodes::INVALID_MOTION_PLAN;
+    return false;
+  }
+
+  Eigen::MatrixXd parameters;
+  jointTrajectorytoParameters(trajectory,parameters);
+
+  // only the timesteps around the waypoints that collide in the new scene are optimized
+  int window_start, window_timesteps;
+  Eigen::MatrixXd repaired = parameters;
+  if(findInvalidWindow(parameters,window_start,window_timesteps))
+  {
+    ROS_INFO("%s repairing timesteps [%i, %i) out of %i",getName().c_str(),window_start,window_start + window_timesteps,
+             int(parameters.cols()));
+    if(!allocateAttempts(1))
+    {
+      res.error_code_.val = moveit_msgs::MoveItErrorCodes::FAILURE;
+      return false;
+    }
+
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+    if(request_.allowed_planning_time > 0)
+    {
+      deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+          std::chrono::duration<double>(request_.allowed_planning_time));
+    }
+
+    stomp_core::StompConfiguration config = stomp_config_;
+    config.num_timesteps = parameters.cols();
+    if(!task_->setMotionPlanRequest(planning_scene_,request_,config,res.error_code_))
+    {
+      ROS_ERROR("%s failed to set up the trajectory repair",getName().c_str());
+      return false;
+    }
+    stomp_->setConfig(config);
+
+    if(cancel_requested_ || !stomp_->solveWindow(parameters,window_start,window_timesteps,repaired,deadline))
+    {
+      ROS_ERROR("%s failed to repair the trajectory",getName().c_str());
+      res.error_code_.val = moveit_msgs::MoveItErrorCodes::PLANNING_FAILED;
+      return false;
+    }
+    selected_attempt_ = 0;
+  }
+
+  res.trajectory_.reset(new robot_trajectory::RobotTrajectory(robot_model_,group_));
+  if(!parametersToRobotTrajectory(repaired,*res.trajectory_))
+  {
+    res.error_code_.val = moveit_msgs::MoveItErrorCodes::PLANNING_FAILED;
+    return false;
+  }
+
+  bool path_valid = planning_scene_->isPathValid(*res.trajectory_,group_,true);
+  if(!path_valid)
+  {
+    ROS_ERROR_STREAM("STOMP repaired trajectory is in collision");
+    shared_trajectory_.reset();
+    res.error_code_.val = moveit_msgs::MoveItErrorCodes::PLANNING_FAILED;
+  }
+
+  ros::WallDuration wd = ros::WallTime::now() - start_time;
+  res.planning_time_ = ros::Duration(wd.sec, wd.nsec).toSec();
+  return path_valid;
+}
+
+bool StompPlanner::findInvalidWindow(const Eigen::MatrixXd& parameters, int& window_start, int& window_timesteps) const
+{
+  const moveit::core::JointModelGroup* joint_group = robot_model_->getJointModelGroup(group_);
+  moveit::core::RobotState state(robot_model_);
+  moveit::core::robotStateMsgToRobotState(request_.start_state,state);
+
+  // a single pass over the waypoints finds the first and the last one in collision
+  int first = -1;
+  int last = -1;
+  for(auto t = 0u; t < parameters.cols(); t++)
+  {
+    state.setJointGroupPositions(joint_group,parameters.col(t).data());
+    state.update();
+    if(planning_scene_->isStateColliding(state,group_))
+    {
+      first = first < 0 ? t : first;
+      last = t;
+    }
+  }
+
+  if(first < 0)
+  {
+    return false;
+  }
+
+  // the start and goal stay in place
+  int num_timesteps = parameters.cols();
+  window_start = std::min(std::max(first - repair_padding_,1),num_timesteps - 2);
+  int window_end = std::min(last + repair_padding_ + 1,num_timesteps - 1);
+  window_timesteps = std::max(window_end - window_start,1);
+  return true;
+}
+
+void StompPlanner::capturePlan(const utils::PlanRecord& record) const
+{
+  utils::PlanCapture capture;
+  capture.group = group_;
+  capture.config = config_;
+  capture.seed = stomp_config_.seed;
+  capture.collision_detector = planning_scene_->getActiveCollisionDetectorName();
+  capture.planning_time = record.durations[utils::PlanPhases::TOTAL];
+  capture.failure = record.failure;
+  capture.request = request_;
+  planning_scene_->getPlanningSceneMsg(capture.scene);
+
+  std::string file_name = capture_directory_ + "/" + group_ + "_" + std::to_string(ros::WallTime::now().toNSec()) +
+      ".stompcap";
+  if(capture.write(file_name))
+  {
+    ROS_INFO("%s captured the plan into '%s'",getName().c_str(),file_name.c_str());
+  }
+}
+
+bool StompPlanner::solve(planning_interface::MotionPlanDetailedResponse &res,utils::PlanRecord& record)
 {
   using namespace stomp_core;
+  using namespace utils::PlanFailures;
 
   // initializing response
   res.description_.resize(1,"");
@@ -183,8 +896,9 @@ bool StompPlanner::solve(planning_interface::MotionPlanDetailedResponse &res)
 
   ros::WallTime start_time = ros::WallTime::now();
   bool success = false;
+  selected_attempt_ = -1;
+  shared_trajectory_.reset();
 
-  trajectory_msgs::JointTrajectory trajectory;
   Eigen::MatrixXd parameters;
   bool planning_success;
 
@@ -194,96 +908,309 @@ bool StompPlanner::solve(planning_interface::MotionPlanDetailedResponse &res)
   // look for seed trajectory
   Eigen::MatrixXd initial_parameters;
   bool use_seed = getSeedParameters(initial_parameters);
+  std::uint64_t experience_scene_hash = experience_library_ ? getExperienceSceneHash() : 0;
+
 
+  // independent optimizations run concurrently, each one with its own task and plugins and thread
+  std::size_t num_attempts = request_.num_planning_attempts > 1 ? request_.num_planning_attempts : 1;
+  if(num_attempts > max_planning_attempts_)
+  {
+    ROS_WARN("%s runs %lu of the %lu requested planning attempts, the thread budget allows no more",getName().c_str(),
+             max_planning_attempts_,num_attempts);
+    num_attempts = max_planning_attempts_;
+  }
+  if(!allocateAttempts(num_attempts))
+  {
+    res.error_code_.val = moveit_msgs::MoveItErrorCodes::FAILURE;
+    record.failure = ATTEMPTS;
+    return false;
+  }
+
+  // extracting start and goal
+  Eigen::VectorXd start, goal;
+  std::vector<Eigen::VectorXd> goal_candidates;
+  if (use_seed)
+  {
+    ROS_INFO("%s Seeding trajectory from MotionPlanRequest",getName().c_str());
+
+    // updating time step in stomp configuraion
+    config_copy.num_timesteps = initial_parameters.cols();
+  }
+  else if(!getStartAndGoal(start,goal,&goal_candidates))
+  {
+    res.error_code_.val = moveit_msgs::MoveItErrorCodes::INVALID_MOTION_PLAN;
+    record.failure = START_GOAL;
+    ROS_ERROR("STOMP failed to get the start and goal positions");
+    return false;
+  }
+  else if(trajectory_cache_.lookup(start,goal,initial_parameters))
+  {
+    ROS_INFO("%s Seeding trajectory from a previously optimized trajectory",getName().c_str());
+    use_seed = true;
+    config_copy.num_timesteps = initial_parameters.cols();
+  }
+  else if(experience_library_ && experience_library_->lookup(start,goal,experience_scene_hash,initial_parameters))
+  {
+    ROS_INFO("%s Seeding trajectory from the experience library",getName().c_str());
+    use_seed = true;
+    config_copy.num_timesteps = initial_parameters.cols();
+  }
+  else
+  {
+    config_copy.num_timesteps = selectNumTimesteps(start,goal);
+  }
+
+  // the allowed planning time is enforced by stomp itself, the best trajectory found by then is returned
+  std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+  if(request_.allowed_planning_time > 0)
+  {
+    ros::WallDuration remaining_time = ros::WallDuration(request_.allowed_planning_time) - (ros::WallTime::now() - start_time);
+    deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(remaining_time.toSec()));
+  }
+
+  // each attempt after the first one starts from a different initialization method
+  static const std::vector<int> INITIALIZATION_METHODS = {TrajectoryInitializations::LINEAR_INTERPOLATION,
+                                                          TrajectoryInitializations::CUBIC_POLYNOMIAL_INTERPOLATION,
+                                                          TrajectoryInitializations::MININUM_CONTROL_COST};
+  std::vector<Eigen::MatrixXd> attempt_parameters(num_attempts);
+  std::vector<char> attempt_success(num_attempts,false); // not std::vector<bool>, it is written concurrently
+  std::vector<double> attempt_costs(num_attempts,std::numeric_limits<double>::max());
+  std::vector<moveit_msgs::MoveItErrorCodes> attempt_error_codes(num_attempts);
+  std::vector<double> attempt_setup_times(num_attempts,0.0);
+  std::vector<double> attempt_optimization_times(num_attempts,-1.0); // negative when the optimization did not run
+  std::atomic<int> winner(-1);
+
+  auto run_attempt = [&](std::size_t k)
+  {
+    // the unseeded attempts start from the nearest goals in turn
+    std::size_t num_goals = std::min<std::size_t>(goal_candidates.size(),goal_selection_candidates_);
+    const Eigen::VectorXd& attempt_goal = num_goals > 0 ? goal_candidates[k % num_goals] : goal;
+
+    StompConfiguration config = config_copy;
+    config.seed += k; // every attempt samples different noise
+    bool seeded = use_seed && k == 0;
+    if(!seeded && k > 0)
+    {
+      auto method = std::find(INITIALIZATION_METHODS.begin(),INITIALIZATION_METHODS.end(),config.initialization_method);
+      std::size_t offset = method == INITIALIZATION_METHODS.end() ? 0 : std::distance(INITIALIZATION_METHODS.begin(),method);
+      config.initialization_method = INITIALIZATION_METHODS[(offset + k) % INITIALIZATION_METHODS.size()];
+    }
+
+    // setting up up optimization task
+    ros::WallTime phase_start = ros::WallTime::now();
+    bool setup = attempt_tasks_[k]->setMotionPlanRequest(planning_scene_,request_,config,attempt_error_codes[k]);
+    attempt_setup_times[k] = (ros::WallTime::now() - phase_start).toSec();
+    if(!setup)
+    {
+      ROS_ERROR("%s failed to set up planning attempt %lu",getName().c_str(),k);
+      return;
+    }
+
+    // a cancellation that arrived before the optimizer started would be reset by its solve
+    attempt_stomps_[k]->setConfig(config);
+    if(winner >= 0 || cancel_requested_)
+    {
+      return; // another attempt already found a solution or the plan was cancelled
+    }
+
+    phase_start = ros::WallTime::now();
+
+    // the unseeded attempts may start from a coarse optimization resampled to the full resolution
+    Eigen::MatrixXd coarse_parameters;
+    bool refine = false;
+    if(!seeded && coarse_timesteps_ > 1 && coarse_timesteps_ < config.num_timesteps)
+    {
+      Eigen::VectorXd first = use_seed ? Eigen::VectorXd(initial_parameters.leftCols(1)) : start;
+      Eigen::VectorXd last = use_seed ? Eigen::VectorXd(initial_parameters.rightCols(1)) : attempt_goal;
+      refine = solveCoarse(k,config,first,last,deadline,coarse_parameters);
+      if(winner >= 0 || cancel_requested_)
+      {
+        return; // another attempt already found a solution or the plan was cancelled
+      }
+
+      // the full resolution task and optimizer replace the coarse ones
+      StompConfiguration refine_config = config;
+      if(refine)
+      {
+        refine_config.num_iterations = refine_iterations_;
+      }
+      if(!attempt_tasks_[k]->setMotionPlanRequest(planning_scene_,request_,refine_config,attempt_error_codes[k]))
+      {
+        ROS_ERROR("%s failed to set up planning attempt %lu",getName().c_str(),k);
+        return;
+      }
+      attempt_stomps_[k]->setConfig(refine_config);
+      if(cancel_requested_)
+      {
+        return;
+      }
+    }
 
-  // create timeout timer
-  ros::WallDuration allowed_time(request_.allowed_planning_time);
-  ROS_WARN_COND(TIMEOUT_INTERVAL > request_.allowed_planning_time,
-                "%s allowed planning time %f is less than the minimum planning time value of %f",
-                getName().c_str(),request_.allowed_planning_time,TIMEOUT_INTERVAL);
-  ros::Timer timeout_timer = ph_->createTimer(ros::Duration(TIMEOUT_INTERVAL), [&](const ros::TimerEvent& evnt)
-  {
-    if((ros::WallTime::now() - start_time) > allowed_time)
+    if(refine)
     {
-      ROS_ERROR("%s exceeded allowed time of %f , terminating",getName().c_str(),allowed_time.toSec());
-      this->terminate();
+      attempt_success[k] = attempt_stomps_[k]->solve(coarse_parameters,attempt_parameters[k],deadline);
     }
+    else if(seeded)
+    {
+      attempt_success[k] = attempt_stomps_[k]->solve(initial_parameters,attempt_parameters[k],deadline);
+    }
+    else if(use_seed)
+    {
+      // the remaining attempts start from the seed end points
+      attempt_success[k] = attempt_stomps_[k]->solve(Eigen::VectorXd(initial_parameters.leftCols(1)),
+                                                     Eigen::VectorXd(initial_parameters.rightCols(1)),
+                                                     attempt_parameters[k],deadline);
+    }
+    else
+    {
+      attempt_success[k] = attempt_stomps_[k]->solve(start,attempt_goal,attempt_parameters[k],deadline);
+    }
+    attempt_costs[k] = attempt_stomps_[k]->getOptimizedCost();
+    attempt_optimization_times[k] = (ros::WallTime::now() - phase_start).toSec();
 
-  },false);
-
-
-  if (use_seed)
-  {
-    ROS_INFO("%s Seeding trajectory from MotionPlanRequest",getName().c_str());
-
-    // updating time step in stomp configuraion
-    config_copy.num_timesteps = initial_parameters.cols();
-
-    // setting up up optimization task
-    if(!task_->setMotionPlanRequest(planning_scene_, request_, config_copy, res.error_code_))
+    // the first good enough solution cancels the remaining attempts
+    int no_winner = -1;
+    if(attempt_success[k] && attempt_costs[k] <= multi_start_cost_threshold_ &&
+        winner.compare_exchange_strong(no_winner,static_cast<int>(k)))
     {
-      res.error_code_.val = moveit_msgs::MoveItErrorCodes::FAILURE;
-      return false;
+      for(auto j = 0u; j < num_attempts; j++)
+      {
+        if(j != k)
+        {
+          attempt_stomps_[j]->cancel();
+        }
+      }
     }
+  };
 
-    stomp_->setConfig(config_copy);
-    planning_success = stomp_->solve(initial_parameters, parameters);
+  std::vector<std::thread> attempt_threads;
+  for(auto k = 1u; k < num_attempts; k++)
+  {
+    attempt_threads.push_back(std::thread(run_attempt,k));
   }
-  else
+  run_attempt(0);
+  for(auto& t : attempt_threads)
   {
+    t.join();
+  }
 
-    // extracting start and goal
-    Eigen::VectorXd start, goal;
-    if(!getStartAndGoal(start,goal))
+  // selecting the winner or else the valid solution with the lowest cost
+  int best = winner;
+  if(best < 0)
+  {
+    for(auto k = 0u; k < num_attempts; k++)
     {
-      res.error_code_.val = moveit_msgs::MoveItErrorCodes::INVALID_MOTION_PLAN;
-      ROS_ERROR("STOMP failed to get the start and goal positions");
-      return false;
+      if(attempt_success[k] && (best < 0 || attempt_costs[k] < attempt_costs[best]))
+      {
+        best = k;
+      }
     }
+  }
 
-    // setting up up optimization task
-    if(!task_->setMotionPlanRequest(planning_scene_,request_, config_copy,res.error_code_))
-    {
-      res.error_code_.val = moveit_msgs::MoveItErrorCodes::FAILURE;
-      return false;
-    }
+  bool setup_failed = std::all_of(attempt_error_codes.begin(),attempt_error_codes.end(),
+                                  [](const moveit_msgs::MoveItErrorCodes& e){
+    return e.val != moveit_msgs::MoveItErrorCodes::SUCCESS;
+  });
+
+  // the phases of the selected attempt are reported, or those of the first one when none succeeded
+  std::size_t reported = best >= 0 ? best : 0;
+  record.durations[utils::PlanPhases::SETUP] = attempt_setup_times[reported];
+  if(attempt_optimization_times[reported] >= 0)
+  {
+    record.durations[utils::PlanPhases::OPTIMIZATION] = attempt_optimization_times[reported];
+    record.iterations = attempt_stomps_[reported]->getNumIterations();
+    record.termination_reason = attempt_stomps_[reported]->getTerminationReason();
+  }
 
-    stomp_->setConfig(config_copy);
-    planning_success = stomp_->solve(start,goal,parameters);
+  if(setup_failed)
+  {
+    res.error_code_.val = moveit_msgs::MoveItErrorCodes::FAILURE;
+    record.failure = SETUP;
+    return false;
   }
 
-  // stopping timer
-  timeout_timer.stop();
+  // the time spent in each plugin of the selected attempt, or of the first one when none succeeded
+  res.description_[0] = attempt_tasks_[reported]->getProfiler().toString();
+  ROS_DEBUG_STREAM(getName()<<" plugin profile:\n"<<res.description_[0]);
+
+  planning_success = best >= 0;
+  if(planning_success)
+  {
+    parameters = attempt_parameters[best];
+    selected_attempt_ = best;
+    ROS_DEBUG("%s selected planning attempt %i out of %lu",getName().c_str(),best,num_attempts);
+  }
 
   // Handle results
   if(planning_success)
   {
-    if(!parametersToJointTrajectory(parameters,trajectory))
+    // creating request response
+    res.trajectory_[0]= robot_trajectory::RobotTrajectoryPtr(new robot_trajectory::RobotTrajectory(
+        robot_model_,group_));
+    ros::WallTime phase_start = ros::WallTime::now();
+    bool converted = parametersToRobotTrajectory(parameters,*res.trajectory_[0]);
+    record.durations[utils::PlanPhases::CONVERSION] = (ros::WallTime::now() - phase_start).toSec();
+    if(!converted)
     {
       res.error_code_.val = moveit_msgs::MoveItErrorCodes::PLANNING_FAILED;
+      record.failure = CONVERSION;
       return false;
     }
-
-    // creating request response
-    moveit::core::RobotState robot_state(robot_model_);
-    moveit::core::robotStateMsgToRobotState(request_.start_state,robot_state);
-    res.trajectory_[0]= robot_trajectory::RobotTrajectoryPtr(new robot_trajectory::RobotTrajectory(
-        robot_model_,group_));
-    res.trajectory_.back()->setRobotTrajectoryMsg( robot_state,trajectory);
   }
   else
   {
     res.error_code_.val = moveit_msgs::MoveItErrorCodes::PLANNING_FAILED;
+    record.failure = OPTIMIZATION;
     return false;
   }
 
-  // checking against planning scene
-  if(planning_scene_ && !planning_scene_->isPathValid(*res.trajectory_.back(),group_,true))
+  // checking against planning scene, the collision checks are skipped when a cost function already ran them on the
+  // returned waypoints against this scene
+  bool path_valid = true;
+  ros::WallTime validation_start = ros::WallTime::now();
+  if(planning_scene_)
+  {
+    cost_functions::ValidityCertificate certificate;
+    bool certified = attempt_tasks_[best]->getValidityCertificate(parameters,certificate) &&
+        certificate.collisions_checked && certificate.planning_scene == planning_scene_.get();
+    if(!certified)
+    {
+      path_valid = planning_scene_->isPathValid(*res.trajectory_.back(),group_,true);
+    }
+    else if(planning_scene_->hasStateFeasibilityPredicate())
+    {
+      const robot_trajectory::RobotTrajectory& path = *res.trajectory_.back();
+      for(auto i = 0u; i < path.getWayPointCount() && path_valid; i++)
+      {
+        path_valid = planning_scene_->isStateFeasible(path.getWayPoint(i),true);
+      }
+    }
+    else
+    {
+      ROS_DEBUG("%s skipped the path check, the cost functions checked every waypoint against the scene",
+                getName().c_str());
+    }
+  }
+
+  record.durations[utils::PlanPhases::VALIDATION] = (ros::WallTime::now() - validation_start).toSec();
+
+  if(!path_valid)
   {
     res.error_code_.val = moveit_msgs::MoveItErrorCodes::PLANNING_FAILED;
+    record.failure = INVALID_PATH;
     success = false;
+    shared_trajectory_.reset();
     ROS_ERROR_STREAM("STOMP Trajectory is in collision");
   }
+  else
+  {
+    trajectory_cache_.insert(parameters);
+    if(experience_library_)
+    {
+      experience_library_->insert(parameters,experience_scene_hash);
+    }
+  }
 
   ros::WallDuration wd = ros::WallTime::now() - start_time;
   res.processing_time_[0] = ros::Duration(wd.sec, wd.nsec).toSec();
@@ -292,6 +1219,77 @@ bool StompPlanner::solve(planning_interface::MotionPlanDetailedResponse &res)
   return true;
 }
 
+std::uint64_t StompPlanner::getExperienceSceneHash() const
+{
+  return match_experience_scene_ && planning_scene_ ? utils::hashPlanningScene(*planning_scene_) : 0;
+}
+
+int StompPlanner::selectNumTimesteps(const Eigen::VectorXd& start, const Eigen::VectorXd& goal) const
+{
+  if(timestep_resolution_ <= 0.0)
+  {
+    return stomp_config_.num_timesteps;
+  }
+
+  double distance = (goal - start).cwiseAbs().maxCoeff();
+  int num_timesteps = static_cast<int>(std::ceil(distance/timestep_resolution_)) + 1;
+  num_timesteps = ((num_timesteps + timesteps_increment_ - 1)/timesteps_increment_)*timesteps_increment_;
+  num_timesteps = std::min(std::max(num_timesteps,min_timesteps_),max_timesteps_);
+  ROS_DEBUG("%s selected %i timesteps for a largest joint displacement of %f",getName().c_str(),num_timesteps,distance);
+  return num_timesteps;
+}
+
+bool StompPlanner::solveCoarse(std::size_t attempt, const stomp_core::StompConfiguration& config,
+                               const Eigen::VectorXd& start, const Eigen::VectorXd& goal,
+                               const std::chrono::steady_clock::time_point& deadline, Eigen::MatrixXd& parameters)
+{
+  using namespace stomp_core;
+
+  // the coarse trajectory lasts as long as the full one, the timestep dependent parameters are scaled down with it
+  StompConfiguration coarse_config = config;
+  coarse_config.num_timesteps = coarse_timesteps_;
+  coarse_config.delta_t = config.delta_t*(config.num_timesteps - 1)/(coarse_timesteps_ - 1);
+  coarse_config.window_size = config.window_size*coarse_timesteps_/config.num_timesteps;
+  if(config.num_control_points >= coarse_timesteps_)
+  {
+    coarse_config.num_control_points = 0;
+  }
+
+  // the links are padded further since the collisions in between the coarse timesteps go unnoticed
+  planning_scene::PlanningSceneConstPtr coarse_scene = planning_scene_;
+  if(coarse_padding_ > 0.0)
+  {
+    planning_scene::PlanningScenePtr padded_scene = planning_scene_->diff();
+    collision_detection::CollisionRobotPtr padded_robot = padded_scene->getCollisionRobotNonConst();
+    std::map<std::string, double> link_padding = padded_robot->getLinkPadding();
+    for(auto& lp : link_padding)
+    {
+      lp.second += coarse_padding_;
+    }
+    padded_robot->setLinkPadding(link_padding);
+    coarse_scene = padded_scene;
+  }
+
+  moveit_msgs::MoveItErrorCodes error_code;
+  if(!attempt_tasks_[attempt]->setMotionPlanRequest(coarse_scene,request_,coarse_config,error_code))
+  {
+    ROS_WARN("%s failed to set up the coarse optimization of planning attempt %lu",getName().c_str(),attempt);
+    return false;
+  }
+
+  attempt_stomps_[attempt]->setConfig(coarse_config);
+  Eigen::MatrixXd coarse_parameters;
+  if(!attempt_stomps_[attempt]->solve(start,goal,coarse_parameters,deadline))
+  {
+    ROS_DEBUG("%s coarse optimization of planning attempt %lu failed, optimizing at full resolution",
+              getName().c_str(),attempt);
+    return false;
+  }
+
+  resampleTrajectory(coarse_parameters,config.num_timesteps,parameters);
+  return true;
+}
+
 bool StompPlanner::getSeedParameters(Eigen::MatrixXd& parameters) const
 {
   using namespace utils::kinematics;
@@ -303,17 +1301,31 @@ bool StompPlanner::getSeedParameters(Eigen::MatrixXd& parameters) const
     return dist <= tol;
   };
 
-  trajectory_msgs::JointTrajectory traj;
-  if(!extractSeedTrajectory(request_,traj))
+  std::string seed_reference;
+  if(utils::seeds::decodeSeedReference(request_.trajectory_constraints,seed_reference))
   {
-    ROS_DEBUG("%s Found no seed trajectory",getName().c_str());
-    return false;
+    // the seed is copied straight into the parameters, see utils::seeds
+    std::size_t num_joints = robot_model_->getJointModelGroup(group_)->getActiveJointModelNames().size();
+    if(!utils::seeds::readSeed(seed_reference,num_joints,parameters))
+    {
+      ROS_ERROR("%s Failed to read the seed trajectory '%s'",getName().c_str(),seed_reference.c_str());
+      return false;
+    }
   }
-
-  if(!jointTrajectorytoParameters(traj,parameters))
+  else
   {
-    ROS_ERROR("%s Failed to created seed parameters from joint trajectory",getName().c_str());
-    return false;
+    trajectory_msgs::JointTrajectory traj;
+    if(!extractSeedTrajectory(request_,traj))
+    {
+      ROS_DEBUG("%s Found no seed trajectory",getName().c_str());
+      return false;
+    }
+
+    if(!jointTrajectorytoParameters(traj,parameters))
+    {
+      ROS_ERROR("%s Failed to created seed parameters from joint trajectory",getName().c_str());
+      return false;
+    }
   }
 
   if(parameters.cols()<= 2)
@@ -435,42 +1447,74 @@ bool StompPlanner::getSeedParameters(Eigen::MatrixXd& parameters) const
   return true;
 }
 
-bool StompPlanner::parametersToJointTrajectory(const Eigen::MatrixXd& parameters,
-                                               trajectory_msgs::JointTrajectory& trajectory)
+bool StompPlanner::parametersToRobotTrajectory(const Eigen::MatrixXd& parameters,
+                                               robot_trajectory::RobotTrajectory& trajectory)
 {
-  // filling trajectory joint values
-  trajectory.joint_names = robot_model_->getJointModelGroup(group_)->getActiveJointModelNames();
-  trajectory.points.clear();
-  trajectory.points.resize(parameters.cols());
-  std::vector<double> vals(parameters.rows());
-  std::vector<double> zeros(parameters.rows(),0.0);
-  for(auto t = 0u; t < parameters.cols() ; t++)
+  const moveit::core::JointModelGroup* joint_group = robot_model_->getJointModelGroup(group_);
+  const std::vector<const moveit::core::JointModel*>& joint_models = joint_group->getActiveJointModels();
+  if(parameters.rows() != joint_models.size())
+  {
+    ROS_ERROR("%s parameters have %i rows but the group has %lu joints",getName().c_str(),int(parameters.rows()),
+              joint_models.size());
+    return false;
+  }
+
+  // the waypoints are evenly spaced in time, stretching their timestep is enough to respect the joint limits
+  Eigen::MatrixXd velocities, accelerations;
+  double timestep = 0.0;
+  bool scaled = uniform_time_scaling_ &&
+      utils::time_parameterization::computeUniformTimeScaling(joint_group,parameters,stomp_config_.delta_t,
+                                                              request_.max_velocity_scaling_factor,
+                                                              request_.max_acceleration_scaling_factor,
+                                                              velocities,accelerations,timestep);
+  if(uniform_time_scaling_ && !scaled)
   {
-    Eigen::VectorXd::Map(&vals[0],vals.size()) = parameters.col(t);
-    trajectory.points[t].positions = vals;
-    trajectory.points[t].velocities = zeros;
-    trajectory.points[t].accelerations = zeros;
-    trajectory.points[t].time_from_start = ros::Duration(0.0);
+    ROS_WARN("%s failed to scale the trajectory timing, using the iterative parabolic parameterization",getName().c_str());
   }
 
-  trajectory_processing::IterativeParabolicTimeParameterization time_generator;
-  robot_trajectory::RobotTrajectory traj(robot_model_,group_);
+  // filling the waypoints directly from the parameters, the joints outside of the group keep their start values
   moveit::core::RobotState robot_state(robot_model_);
   moveit::core::robotStateMsgToRobotState(request_.start_state,robot_state);
-  traj.setRobotTrajectoryMsg(robot_state,trajectory);
+  trajectory.clear();
+  for(auto t = 0u; t < parameters.cols() ; t++)
+  {
+    robot_state.setJointGroupPositions(joint_group,parameters.col(t).data());
+    for(auto d = 0u; d < joint_models.size(); d++)
+    {
+      int index = joint_models[d]->getFirstVariableIndex();
+      robot_state.setVariableVelocity(index,scaled ? velocities(d,t) : 0.0);
+      robot_state.setVariableAcceleration(index,scaled ? accelerations(d,t) : 0.0);
+    }
+    trajectory.addSuffixWayPoint(robot_state,t > 0 ? timestep : 0.0);
+  }
 
-  // converting to msg
-  moveit_msgs::RobotTrajectory robot_traj_msgs;
-  if(time_generator.computeTimeStamps(traj,request_.max_velocity_scaling_factor))
+  // the remaining waypoints are no longer evenly spaced, they are timed by the parabolic parameterization
+  if(decimation_.isEnabled() && trajectory::decimateTrajectory(trajectory,decimation_,planning_scene_.get()) > 0)
   {
-    traj.getRobotTrajectoryMsg(robot_traj_msgs);
-    trajectory = robot_traj_msgs.joint_trajectory;
+    scaled = false;
   }
-  else
+
+  // the evenly timed waypoints are shared as the optimizer returned them, the others are read back once timed
+  if(scaled)
+  {
+    trajectory::SharedTrajectoryPtr shared(new trajectory::SharedTrajectory());
+    shared->group_name = group_;
+    shared->joint_names = joint_group->getActiveJointModelNames();
+    shared->positions = parameters;
+    shared->velocities.swap(velocities);
+    shared->accelerations.swap(accelerations);
+    shared->time_from_start = Eigen::VectorXd::LinSpaced(parameters.cols(),0.0,timestep*(parameters.cols() - 1));
+    shared_trajectory_ = shared;
+    return true;
+  }
+
+  trajectory_processing::IterativeParabolicTimeParameterization time_generator;
+  if(!time_generator.computeTimeStamps(trajectory,request_.max_velocity_scaling_factor))
   {
     ROS_ERROR("%s Failed to generate timing data",getName().c_str());
     return false;
   }
+  shared_trajectory_ = trajectory::makeSharedTrajectory(trajectory);
   return true;
 }
 
@@ -562,7 +1606,8 @@ moveit_msgs::TrajectoryConstraints StompPlanner::encodeSeedTrajectory(const traj
   return res;
 }
 
-bool StompPlanner::getStartAndGoal(Eigen::VectorXd& start, Eigen::VectorXd& goal)
+bool StompPlanner::getStartAndGoal(Eigen::VectorXd& start, Eigen::VectorXd& goal,
+                                   std::vector<Eigen::VectorXd>* goal_candidates)
 {
   using namespace moveit::core;
   using namespace utils::kinematics;
@@ -604,6 +1649,24 @@ bool StompPlanner::getStartAndGoal(Eigen::VectorXd& start, Eigen::VectorXd& goal
       return false;
     }
 
+    // comparing every goal instead of taking the first feasible one
+    if(goal_selection_seeds_ > 0)
+    {
+      std::vector<Eigen::VectorXd> candidates;
+      if(!selectGoalCandidates(*state,start,candidates))
+      {
+        ROS_ERROR("%s was unable to retrieve the goal from the MotionPlanRequest",getName().c_str());
+        return false;
+      }
+
+      goal = candidates.front();
+      if(goal_candidates)
+      {
+        *goal_candidates = std::move(candidates);
+      }
+      return true;
+    }
+
     // extracting goal joint values
     for(const auto& gc : request_.goal_constraints)
     {
@@ -669,6 +1732,140 @@ bool StompPlanner::getStartAndGoal(Eigen::VectorXd& start, Eigen::VectorXd& goal
   return found_goal;
 }
 
+bool StompPlanner::selectGoalCandidates(const moveit::core::RobotState& start_state, const Eigen::VectorXd& start,
+                                        std::vector<Eigen::VectorXd>& goal_candidates) const
+{
+  using namespace moveit::core;
+  using namespace utils::kinematics;
+
+  const JointModelGroup* joint_group = robot_model_->getJointModelGroup(group_);
+  const std::vector<std::string>& joint_names = joint_group->getActiveJointModelNames();
+
+  // one item per joint goal and per seed of each cartesian goal, the first seed being the start
+  std::vector<std::pair<const moveit_msgs::Constraints*,int> > items;
+  for(const auto& gc : request_.goal_constraints)
+  {
+    if(!gc.joint_constraints.empty())
+    {
+      items.push_back(std::make_pair(&gc,0));
+    }
+    else if(!gc.position_constraints.empty() && !gc.orientation_constraints.empty())
+    {
+      for(auto seed = 0; seed < goal_selection_seeds_; seed++)
+      {
+        items.push_back(std::make_pair(&gc,seed));
+      }
+    }
+  }
+
+  if(items.empty())
+  {
+    return false;
+  }
+
+  // the items are solved by the shared executor or else by a pool of this call, each worker owns a state and an IK workspace
+  stomp_core::ThreadPoolPtr pool = executor_;
+  if(!pool)
+  {
+    std::size_t num_threads = std::max(1u,std::thread::hardware_concurrency());
+    pool = std::make_shared<stomp_core::ThreadPool>(std::min(num_threads,items.size()));
+  }
+
+  std::vector<RobotStatePtr> states(pool->size());
+  std::vector<IKWorkspace> workspaces(pool->size());
+  for(auto w = 0u; w < pool->size(); w++)
+  {
+    states[w].reset(new RobotState(start_state));
+    if(!workspaces[w].initialize(joint_group))
+    {
+      return false;
+    }
+  }
+
+  std::vector<Eigen::VectorXd> solutions(items.size());
+  std::vector<char> valid(items.size(),false); // not std::vector<bool>, it is written concurrently
+  pool->parallelFor(items.size(),[&](std::size_t i, std::size_t worker)
+  {
+    const moveit_msgs::Constraints& gc = *items[i].first;
+    RobotStatePtr state = states[worker];
+    *state = start_state;
+    Eigen::VectorXd& solution = solutions[i];
+
+    if(!gc.joint_constraints.empty())
+    {
+      for(const auto& jc : gc.joint_constraints)
+      {
+        state->setVariablePosition(jc.joint_name,jc.position);
+      }
+
+      if(!state->satisfiesBounds(joint_group))
+      {
+        ROS_DEBUG("%s Requested Goal joint pose is out of bounds",getName().c_str());
+        return;
+      }
+
+      solution.resize(joint_names.size());
+      for(auto j = 0u; j < joint_names.size(); j++)
+      {
+        solution(j) = state->getVariablePosition(joint_names[j]);
+      }
+    }
+    else
+    {
+      // the additional seeds are drawn reproducibly from the configured seed
+      Eigen::VectorXd seed = start;
+      if(items[i].second > 0)
+      {
+        random_numbers::RandomNumberGenerator rng(static_cast<std::uint32_t>(stomp_config_.seed + i));
+        state->setToRandomPositions(joint_group,rng);
+        for(auto j = 0u; j < joint_names.size(); j++)
+        {
+          seed(j) = state->getVariablePosition(joint_names[j]);
+        }
+      }
+
+      KinematicConfig kc;
+      if(!createKinematicConfig(joint_group,gc.position_constraints.front(),gc.orientation_constraints.front(),seed,kc) ||
+          !solveIK(state,workspaces[worker],kc,solution))
+      {
+        return;
+      }
+      state->setJointGroupPositions(joint_group,solution);
+    }
+
+    state->update();
+    valid[i] = planning_scene_->isStateValid(*state,group_);
+  });
+
+  // the nearest valid goals first, the duplicates found by several seeds are dropped
+  std::vector<std::pair<double,std::size_t> > sorted;
+  for(auto i = 0u; i < items.size(); i++)
+  {
+    if(valid[i])
+    {
+      sorted.push_back(std::make_pair((solutions[i] - start).norm(),i));
+    }
+  }
+  std::sort(sorted.begin(),sorted.end());
+
+  goal_candidates.clear();
+  for(const auto& s : sorted)
+  {
+    const Eigen::VectorXd& solution = solutions[s.second];
+    bool duplicate = std::any_of(goal_candidates.begin(),goal_candidates.end(),[&solution](const Eigen::VectorXd& g)
+    {
+      return (g - solution).cwiseAbs().maxCoeff() < GOAL_CANDIDATE_TOLERANCE;
+    });
+    if(!duplicate)
+    {
+      goal_candidates.push_back(solution);
+    }
+  }
+
+  ROS_DEBUG("%s Found %lu valid goals out of %lu candidates",getName().c_str(),goal_candidates.size(),items.size());
+  return !goal_candidates.empty();
+}
+
 
 bool StompPlanner::canServiceRequest(const moveit_msgs::MotionPlanRequest &req) const
 {
@@ -698,9 +1895,11 @@ bool StompPlanner::canServiceRequest(const moveit_msgs::MotionPlanRequest &req)
 
 bool StompPlanner::terminate()
 {
-  if(stomp_)
+  cancel_requested_ = true;
+  std::lock_guard<std::mutex> lock(attempts_mutex_);
+  for(auto& stomp : attempt_stomps_)
   {
-    if(!stomp_->cancel())
+    if(!stomp->cancel())
     {
       ROS_ERROR_STREAM("Failed to interrupt Stomp");
       return false;
@@ -709,9 +1908,112 @@ bool StompPlanner::terminate()
   return true;
 }
 
+bool StompPlanner::allocateAttempts(std::size_t num_attempts)
+{
+  std::lock_guard<std::mutex> lock(attempts_mutex_);
+  try
+  {
+    while(attempt_stomps_.size() < num_attempts)
+    {
+      StompOptimizationTaskPtr task(new StompOptimizationTask(robot_model_,group_,config_["task"]));
+      attempt_tasks_.push_back(task);
+      attempt_stomps_.push_back(std::make_shared<stomp_core::Stomp>(stomp_config_,task));
+      attempt_stomps_.back()->setInstrumentationSink(instrumentation_sink_);
+      if(executor_)
+      {
+        attempt_stomps_.back()->setThreadPool(executor_);
+      }
+    }
+  }
+  catch(XmlRpc::XmlRpcException& e)
+  {
+    ROS_ERROR("%s failed to create the tasks for %lu planning attempts; %s",getName().c_str(),num_attempts,
+              e.getMessage().c_str());
+    return false;
+  }
+
+  return true;
+}
+
+bool StompPlanner::warmUp(double allowed_planning_time)
+{
+  using namespace moveit::core;
+
+  // the start is the default state, every joint moves a quarter of the way towards its upper bound
+  const JointModelGroup* joint_group = robot_model_->getJointModelGroup(group_);
+  RobotState start_state(robot_model_);
+  start_state.setToDefaultValues();
+  start_state.update();
+  RobotState goal_state(start_state);
+  for(const JointModel* joint_model : joint_group->getActiveJointModels())
+  {
+    if(joint_model->getVariableCount() != 1)
+    {
+      continue;
+    }
+
+    const VariableBounds& bounds = joint_model->getVariableBounds()[0];
+    double position = start_state.getVariablePosition(joint_model->getFirstVariableIndex());
+    double target = bounds.position_bounded_ ? position + 0.25*(bounds.max_position_ - position) : position + 0.5;
+    goal_state.setVariablePosition(joint_model->getFirstVariableIndex(),target);
+  }
+  goal_state.update();
+
+  moveit_msgs::MotionPlanRequest req;
+  req.group_name = group_;
+  req.allowed_planning_time = allowed_planning_time;
+  req.num_planning_attempts = 1;
+  robotStateToRobotStateMsg(start_state,req.start_state);
+  req.goal_constraints.push_back(kinematic_constraints::constructGoalConstraints(goal_state,joint_group));
+
+  // the synthetic plan is kept out of the records and caches of the real ones
+  utils::PlannerMetricsPtr metrics = metrics_;
+  std::shared_ptr<utils::ExperienceLibrary> experience_library = experience_library_;
+  std::string capture_directory = capture_directory_;
+  metrics_.reset();
+  experience_library_.reset();
+  capture_directory_.clear();
+
+  ros::WallTime start_time = ros::WallTime::now();
+  planning_scene::PlanningScenePtr planning_scene(new planning_scene::PlanningScene(robot_model_));
+  setPlanningScene(planning_scene);
+  setMotionPlanRequest(req);
+  planning_interface::MotionPlanResponse res;
+  bool success = solve(res);
+
+  metrics_ = metrics;
+  experience_library_ = experience_library;
+  capture_directory_ = capture_directory;
+  trajectory_cache_.clear();
+  clear();
+
+  ROS_INFO("%s warmed up group %s in %f seconds",getName().c_str(),group_.c_str(),(ros::WallTime::now() - start_time).toSec());
+  return success;
+}
+
 void StompPlanner::clear()
 {
   stomp_->clear();
+  shared_trajectory_.reset();
+}
+
+void StompPlanner::setMetrics(utils::PlannerMetricsPtr metrics)
+{
+  metrics_ = metrics;
+}
+
+std::shared_ptr<const stomp_core::Stomp> StompPlanner::getSelectedOptimizer() const
+{
+  if(selected_attempt_ < 0 || selected_attempt_ >= attempt_stomps_.size())
+  {
+    return std::shared_ptr<const stomp_core::Stomp>();
+  }
+  return attempt_stomps_[selected_attempt_];
+}
+
+trajectory::SharedTrajectoryConstPtr StompPlanner::getSharedTrajectory() const
+{
+  return shared_trajectory_;
 }
 
 bool StompPlanner::getConfigData(ros::NodeHandle &nh, std::map<std::string, XmlRpc::XmlRpcValue> &config, std::string param)
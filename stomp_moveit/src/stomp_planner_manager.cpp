@@ -23,7 +23,10 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include <algorithm>
+#include <iterator>
 #include <class_loader/class_loader.h>
+#include <diagnostic_msgs/DiagnosticArray.h>
 #include <stomp_moveit/stomp_planner_manager.h>
 #include <stomp_moveit/stomp_planner.h>
 
@@ -51,6 +54,18 @@ bool StompPlannerManager::initialize(const robot_model::RobotModelConstPtr &mode
 
   robot_model_ = model;
 
+  // the plans of every group are summarized on /diagnostics, a non positive period disables the metrics
+  double metrics_period;
+  int metrics_window_size;
+  nh_.param("stomp_metrics/publish_period",metrics_period,10.0);
+  nh_.param("stomp_metrics/window_size",metrics_window_size,1000);
+  if(metrics_period > 0)
+  {
+    metrics_.reset(new utils::PlannerMetrics(std::max(metrics_window_size,1)));
+    metrics_publisher_ = nh_.advertise<diagnostic_msgs::DiagnosticArray>("/diagnostics",1);
+    metrics_timer_ = nh_.createWallTimer(ros::WallDuration(metrics_period),&StompPlannerManager::publishMetrics,this);
+  }
+
   // each element under 'stomp' should be a group name
   std::map<std::string, XmlRpc::XmlRpcValue> group_config;
 
@@ -59,6 +74,18 @@ bool StompPlannerManager::initialize(const robot_model::RobotModelConstPtr &mode
     return false;
   }
 
+  // with many groups the planners are only created on their first request, except for the prewarmed ones
+  bool lazy_planners;
+  std::vector<std::string> prewarm_groups;
+  nh_.param("stomp_startup/lazy_planners",lazy_planners,false);
+  nh_.param("stomp_startup/prewarm_groups",prewarm_groups,std::vector<std::string>());
+
+  // the planners created now may plan a synthetic request so that the first real one does not pay the cold start
+  bool warmup;
+  double warmup_time;
+  nh_.param("stomp_startup/warmup",warmup,false);
+  nh_.param("stomp_startup/warmup_time",warmup_time,5.0);
+
   for(std::map<std::string, XmlRpc::XmlRpcValue>::iterator v = group_config.begin(); v != group_config.end(); v++)
   {
     if(!model->hasJointModelGroup(v->first))
@@ -68,11 +95,23 @@ bool StompPlannerManager::initialize(const robot_model::RobotModelConstPtr &mode
       continue;
     }
 
-    std::shared_ptr<StompPlanner> planner(new StompPlanner(v->first, v->second, robot_model_));
-    planners_.insert(std::make_pair(v->first, planner));
+    group_config_.insert(*v);
+    if(!lazy_planners || std::find(prewarm_groups.begin(),prewarm_groups.end(),v->first) != prewarm_groups.end())
+    {
+      std::shared_ptr<StompPlanner> planner;
+      {
+        std::lock_guard<std::mutex> lock(planner_pools_mutex_);
+        planner = createGroupPlanner(v->first);
+      }
+
+      if(warmup && !planner->warmUp(warmup_time))
+      {
+        ROS_WARN("STOMP warm-up plan of group %s failed, the caches may only be partially initialized",v->first.c_str());
+      }
+    }
   }
 
-  if(planners_.empty())
+  if(group_config_.empty())
   {
     ROS_ERROR("All planning groups are invalid, STOMP could not be configured");
     return false;
@@ -83,22 +122,20 @@ bool StompPlannerManager::initialize(const robot_model::RobotModelConstPtr &mode
 
 bool StompPlannerManager::canServiceRequest(const moveit_msgs::MotionPlanRequest &req) const
 {
-  if(planners_.count(req.group_name) == 0)
-  {
-    return false;
-  }
-
-  // Get planner
-  std::shared_ptr<StompPlanner> planner = std::static_pointer_cast<StompPlanner>(planners_.at(req.group_name));
-  return planner->canServiceRequest(req);
+  std::shared_ptr<StompPlanner> planner = getGroupPlanner(req.group_name);
+  return planner && planner->canServiceRequest(req);
 }
 
 void StompPlannerManager::getPlanningAlgorithms(std::vector<std::string> &algs) const
 {
   algs.clear();
-  if(!planners_.empty())
+  if(!group_config_.empty())
   {
-    algs.push_back(planners_.begin()->second->getName());
+    std::shared_ptr<StompPlanner> planner = getGroupPlanner(group_config_.begin()->first);
+    if(planner)
+    {
+      algs.push_back(planner->getName());
+    }
   }
 }
 
@@ -127,22 +164,29 @@ planning_interface::PlanningContextPtr StompPlannerManager::getPlanningContext(c
     return planning_interface::PlanningContextPtr();
   }
 
-  if(planners_.count(req.group_name) <=0)
+  // Get planner
+  std::shared_ptr<StompPlanner> planner = getGroupPlanner(req.group_name);
+  if(!planner)
   {
     ROS_ERROR("STOMP does not have a planning context for group %s",req.group_name.c_str());
     error_code.val = moveit_msgs::MoveItErrorCodes::FAILURE;
     return planning_interface::PlanningContextPtr();
   }
 
-  // Get planner
-  std::shared_ptr<StompPlanner> planner = std::static_pointer_cast<StompPlanner>(planners_.at(req.group_name));
-
   if(!planner->canServiceRequest(req))
   {
     error_code.val = moveit_msgs::MoveItErrorCodes::FAILURE;
     return planning_interface::PlanningContextPtr();
   }
 
+  // each request gets its own planner so that concurrent requests do not share any state
+  planner = acquirePlanner(req.group_name);
+  if(!planner)
+  {
+    error_code.val = moveit_msgs::MoveItErrorCodes::FAILURE;
+    return planning_interface::PlanningContextPtr();
+  }
+
   // Setup Planner
   planner->clear();
   planner->setPlanningScene(planning_scene);
@@ -152,6 +196,95 @@ planning_interface::PlanningContextPtr StompPlannerManager::getPlanningContext(c
   return planner;
 }
 
+std::shared_ptr<StompPlanner> StompPlannerManager::getGroupPlanner(const std::string& group) const
+{
+  std::lock_guard<std::mutex> lock(planner_pools_mutex_);
+  auto planner = planners_.find(group);
+  if(planner != planners_.end())
+  {
+    return std::static_pointer_cast<StompPlanner>(planner->second);
+  }
+
+  if(group_config_.count(group) == 0)
+  {
+    return nullptr;
+  }
+
+  try
+  {
+    ROS_INFO("STOMP creating the planner of group %s on its first request",group.c_str());
+    return createGroupPlanner(group);
+  }
+  catch(std::logic_error& e)
+  {
+    ROS_ERROR("STOMP failed to create the planner of group %s; %s",group.c_str(),e.what());
+    return nullptr;
+  }
+}
+
+std::shared_ptr<StompPlanner> StompPlannerManager::createGroupPlanner(const std::string& group) const
+{
+  std::shared_ptr<StompPlanner> planner(new StompPlanner(group,group_config_.at(group),robot_model_));
+  planner->setMetrics(metrics_);
+  planners_.insert(std::make_pair(group,planner));
+
+  // the first planner of each group seeds its pool
+  PooledPlanner pooled;
+  pooled.planner = planner;
+  pooled.available.reset(new std::atomic<bool>(true));
+  planner_pools_[group].push_back(pooled);
+  return planner;
+}
+
+std::shared_ptr<StompPlanner> StompPlannerManager::acquirePlanner(const std::string& group) const
+{
+  std::lock_guard<std::mutex> lock(planner_pools_mutex_);
+  std::vector<PooledPlanner>& pool = planner_pools_[group];
+
+  auto pooled = std::find_if(pool.begin(),pool.end(),[](const PooledPlanner& p){
+    bool expected = true;
+    return p.available->compare_exchange_strong(expected,false,std::memory_order_acquire);
+  });
+
+  if(pooled == pool.end())
+  {
+    PooledPlanner p;
+    try
+    {
+      p.planner.reset(new StompPlanner(group,group_config_.at(group),robot_model_));
+    }
+    catch(std::logic_error& e)
+    {
+      ROS_ERROR("STOMP failed to create a planner of group %s; %s",group.c_str(),e.what());
+      return nullptr;
+    }
+    p.planner->setMetrics(metrics_);
+    p.available.reset(new std::atomic<bool>(false));
+    pool.push_back(p);
+    pooled = std::prev(pool.end());
+    ROS_DEBUG("STOMP created planner %lu for group %s",pool.size(),group.c_str());
+  }
+
+  // the deleter keeps the planner alive and hands it back to the pool once the context is released
+  std::shared_ptr<StompPlanner> planner = pooled->planner;
+  std::shared_ptr<std::atomic<bool>> available = pooled->available;
+  return std::shared_ptr<StompPlanner>(planner.get(),[planner,available](StompPlanner*){
+    available->store(true,std::memory_order_release);
+  });
+}
+
+void StompPlannerManager::publishMetrics(const ros::WallTimerEvent&)
+{
+  diagnostic_msgs::DiagnosticArray msg;
+  metrics_->getStatuses(msg.status);
+  if(msg.status.empty())
+  {
+    return;
+  }
+
+  msg.header.stamp = ros::Time::now();
+  metrics_publisher_.publish(msg);
+}
 
 } /* namespace stomp_moveit_interface */
 CLASS_LOADER_REGISTER_CLASS(stomp_moveit::StompPlannerManager, planning_interface::PlannerManager)
@@ -79,14 +79,24 @@ bool ControlCostProjection::setMotionPlanRequest(const planning_scene::PlanningS
                  moveit_msgs::MoveItErrorCodes& error_code)
 {
 
+  // the projection only depends on the number of timesteps
+  if(num_timesteps_ == config.num_timesteps && control_cost_matrices_)
+  {
+    error_code.val = error_code.SUCCESS;
+    return true;
+  }
+
   num_timesteps_ = config.num_timesteps;
-  stomp_core::generateSmoothingMatrix(num_timesteps_,DEFAULT_TIME_STEP,projection_matrix_M_);
+  control_cost_matrices_ = stomp_core::getControlCostMatrices(num_timesteps_,DEFAULT_TIME_STEP);
+  if(!control_cost_matrices_)
+  {
+    ROS_ERROR("%s failed to factorize the control cost matrix for %i timesteps",getName().c_str(),num_timesteps_);
+    error_code.val = error_code.FAILURE;
+    return false;
+  }
 
-  // zeroing out first and last rows
-  projection_matrix_M_.topRows(1) = Eigen::VectorXd::Zero(num_timesteps_).transpose();
-  projection_matrix_M_(0,0) = 1.0;
-  projection_matrix_M_.bottomRows(1) = Eigen::VectorXd::Zero(num_timesteps_).transpose();
-  projection_matrix_M_(num_timesteps_ -1 ,num_timesteps_ -1 ) = 1;
+  // M = R^-1 * diag(s), the scaling is such that the diagonal of M is 1/num_timesteps
+  column_scales_ = (num_timesteps_*control_cost_matrices_->control_cost_matrix_R_inv_diagonal).cwiseInverse();
 
   error_code.val = error_code.SUCCESS;
   return true;
@@ -98,11 +108,23 @@ bool ControlCostProjection::filter(std::size_t start_timestep,std::size_t num_ti
                                    bool& filtered)
 {
 
-  for(auto d = 0u; d < updates.rows();d++)
+  if(updates.cols() != num_timesteps_ || !control_cost_matrices_)
   {
-    updates.row(d).transpose() = projection_matrix_M_ * (updates.row(d).transpose());
+    ROS_ERROR("%s received updates with %i timesteps, expected %i",getName().c_str(),
+              static_cast<int>(updates.cols()),num_timesteps_);
+    filtered = false;
+    return false;
   }
 
+  // all dimensions are projected at once by a single banded solve with one right hand side per dimension
+  projected_updates_.noalias() = column_scales_.asDiagonal()*updates.transpose();
+  projected_updates_ = control_cost_matrices_->control_cost_matrix_R_llt.solve(projected_updates_);
+
+  // the first and last timesteps are left unchanged
+  projected_updates_.row(0) = updates.col(0).transpose();
+  projected_updates_.row(num_timesteps_ - 1) = updates.col(num_timesteps_ - 1).transpose();
+  updates = projected_updates_.transpose();
+
   filtered = true;
 
   return true;
@@ -0,0 +1,195 @@
+/**
+ * @file obstacle_gradient_descent.cpp
+ * @brief This defines an update filter that pushes the trajectory away from the obstacles along the distance gradient
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+#include <stomp_moveit/update_filters/obstacle_gradient_descent.h>
+#include <ros/console.h>
+#include <pluginlib/class_list_macros.h>
+#include <moveit/robot_state/conversions.h>
+
+PLUGINLIB_EXPORT_CLASS(stomp_moveit::update_filters::ObstacleGradientDescent,stomp_moveit::update_filters::StompUpdateFilter);
+
+static const double DEFAULT_MAX_JOINT_STEP = 0.05;
+
+namespace stomp_moveit
+{
+namespace update_filters
+{
+
+ObstacleGradientDescent::ObstacleGradientDescent():
+    name_("ObstacleGradientDescent"),
+    max_distance_(0.0),
+    step_size_(0.0),
+    max_joint_step_(DEFAULT_MAX_JOINT_STEP)
+{
+
+}
+
+ObstacleGradientDescent::~ObstacleGradientDescent()
+{
+
+}
+
+bool ObstacleGradientDescent::initialize(moveit::core::RobotModelConstPtr robot_model_ptr,
+                        const std::string& group_name,const XmlRpc::XmlRpcValue& config)
+{
+  robot_model_ = robot_model_ptr;
+  group_name_ = group_name;
+
+  if(!robot_model_->hasJointModelGroup(group_name_))
+  {
+    ROS_ERROR("%s the group '%s' does not exist",getName().c_str(),group_name_.c_str());
+    return false;
+  }
+
+  return configure(config);
+}
+
+bool ObstacleGradientDescent::configure(const XmlRpc::XmlRpcValue& config)
+{
+  try
+  {
+    // check parameter presence
+    auto members = {"max_distance","step_size"};
+    for(auto& m : members)
+    {
+      if(!config.hasMember(m))
+      {
+        ROS_ERROR("%s failed to find the '%s' parameter",getName().c_str(),m);
+        return false;
+      }
+    }
+
+    XmlRpc::XmlRpcValue c = config;
+    max_distance_ = static_cast<double>(c["max_distance"]);
+    step_size_ = static_cast<double>(c["step_size"]);
+    max_joint_step_ = c.hasMember("max_joint_step") ? static_cast<double>(c["max_joint_step"]) : DEFAULT_MAX_JOINT_STEP;
+  }
+  catch(XmlRpc::XmlRpcException& e)
+  {
+    ROS_ERROR("%s failed to parse configuration parameters",name_.c_str());
+    return false;
+  }
+
+  if(max_distance_ <= 0.0)
+  {
+    ROS_ERROR("%s the 'max_distance' parameter must be positive",getName().c_str());
+    return false;
+  }
+
+  return true;
+}
+
+bool ObstacleGradientDescent::setMotionPlanRequest(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                 const moveit_msgs::MotionPlanRequest &req,
+                 const stomp_core::StompConfiguration &config,
+                 moveit_msgs::MoveItErrorCodes& error_code)
+{
+  using namespace moveit::core;
+
+  collision_robot_ = std::dynamic_pointer_cast<const collision_detection::CollisionRobotIndustrial>(
+      planning_scene->getCollisionRobot());
+  collision_world_ = std::dynamic_pointer_cast<const collision_detection::CollisionWorldIndustrial>(
+      planning_scene->getCollisionWorld());
+  if(!collision_robot_ || !collision_world_)
+  {
+    ROS_ERROR("%s requires the industrial collision detector",getName().c_str());
+    error_code.val = error_code.FAILURE;
+    return false;
+  }
+
+  if(!state_ || state_->getRobotModel() != robot_model_)
+  {
+    state_.reset(new RobotState(robot_model_));
+  }
+
+  if(!robotStateMsgToRobotState(req.start_state,*state_,true))
+  {
+    ROS_ERROR("%s Failed to get current robot state from request",getName().c_str());
+    error_code.val = error_code.INVALID_ROBOT_STATE;
+    return false;
+  }
+
+  const JointModelGroup* joint_group = robot_model_->getJointModelGroup(group_name_);
+  distance_request_ = collision_detection::DistanceRequest(true,false,joint_group->getUpdatedLinkModelsWithGeometrySet(),
+                                                           planning_scene->getAllowedCollisionMatrix(),max_distance_);
+  distance_request_.gradient = true;
+  acm_bits_.reset(new collision_detection::AllowedCollisionBitMatrix(planning_scene->getAllowedCollisionMatrix()));
+  distance_request_.acm_bits = acm_bits_.get();
+  distance_result_.resize(robot_model_->getLinkModelCount());
+
+  error_code.val = error_code.SUCCESS;
+  return true;
+}
+
+bool ObstacleGradientDescent::filter(std::size_t start_timestep,std::size_t num_timesteps,int iteration_number,
+                                     const Eigen::MatrixXd& parameters,
+                                     Eigen::MatrixXd& updates,
+                                     bool& filtered)
+{
+  filtered = false;
+  if(!state_)
+  {
+    ROS_ERROR("%s the motion plan request has not been set",getName().c_str());
+    return false;
+  }
+
+  const moveit::core::JointModelGroup* joint_group = robot_model_->getJointModelGroup(group_name_);
+  utils::ObstacleGradient obstacle;
+
+  // the start and goal timesteps are left unchanged
+  for(auto t = start_timestep + 1; t + 1 < start_timestep + num_timesteps; t++)
+  {
+    joint_values_ = parameters.col(t) + updates.col(t);
+    state_->setJointGroupPositions(joint_group,joint_values_);
+    state_->update();
+
+    if(!utils::computeObstacleGradient(*collision_robot_,*collision_world_,distance_request_,*state_,distance_result_,
+                                       obstacle) || obstacle.gradient.isZero())
+    {
+      continue;
+    }
+
+    // the cost (max_distance - d)/max_distance decreases along the distance gradient of the nearest link point
+    Eigen::Vector3d reference_point = state_->getGlobalLinkTransform(obstacle.link).inverse() * obstacle.link_point;
+    if(!state_->getJacobian(joint_group,obstacle.link,reference_point,jacobian_,false))
+    {
+      continue;
+    }
+
+    joint_step_.noalias() = (step_size_/max_distance_) * (jacobian_.topRows(3).transpose() * obstacle.gradient);
+    double largest_step = joint_step_.cwiseAbs().maxCoeff();
+    if(largest_step > max_joint_step_)
+    {
+      joint_step_ *= max_joint_step_/largest_step;
+    }
+
+    updates.col(t) += joint_step_;
+    filtered = true;
+  }
+
+  return true;
+}
+
+} /* namespace update_filters */
+} /* namespace stomp_moveit */
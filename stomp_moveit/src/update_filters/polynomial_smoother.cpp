@@ -88,6 +88,13 @@ bool PolynomialSmoother::setMotionPlanRequest(const planning_scene::PlanningScen
                  const stomp_core::StompConfiguration &config,
                  moveit_msgs::MoveItErrorCodes& error_code)
 {
+  if (!fit_.prepare(config.num_timesteps, poly_order_))
+  {
+    ROS_ERROR("%s failed to prepare a polynomial fit of order %i for %i timesteps",getName().c_str(),static_cast<int>(poly_order_),config.num_timesteps);
+    error_code.val = error_code.FAILURE;
+    return false;
+  }
+
   error_code.val = error_code.SUCCESS;
   return true;
 }
@@ -104,8 +111,14 @@ bool PolynomialSmoother::filter(std::size_t start_timestep,
   using namespace utils::polynomial;
 
   filtered = false;
+  if (!fit_.isPrepared(parameters.cols(), poly_order_) && !fit_.prepare(parameters.cols(), poly_order_))
+  {
+    ROS_ERROR("Unable to polynomial smooth trajectory!");
+    return false;
+  }
+
   Eigen::MatrixXd parameters_updates = parameters + updates;
-  if(applyPolynomialSmoothing(robot_model_,group_name_,parameters_updates,poly_order_,JOINT_LIMIT_MARGIN))
+  if(applyPolynomialSmoothing(robot_model_,group_name_,parameters_updates,fit_,JOINT_LIMIT_MARGIN))
   {
     updates = parameters_updates - parameters;
     filtered = true;
@@ -108,7 +108,8 @@ TrajectoryVisualization::TrajectoryVisualization():
     name_("TrajectoryVisualization"),
     nh_("~"),
     line_width_(0.0),
-    publish_intermediate_(false)
+    publish_intermediate_(false),
+    publish_rate_(0.0)
 {
   // TODO Auto-generated constructor stub
 
@@ -116,7 +117,7 @@ TrajectoryVisualization::TrajectoryVisualization():
 
 TrajectoryVisualization::~TrajectoryVisualization()
 {
-  // TODO Auto-generated destructor stub
+  publisher_.stop();
 }
 
 bool TrajectoryVisualization::initialize(moveit::core::RobotModelConstPtr robot_model_ptr,
@@ -169,6 +170,7 @@ bool TrajectoryVisualization::configure(const XmlRpc::XmlRpcValue& config)
     publish_intermediate_ = static_cast<bool>(c["publish_intermediate"]);
     marker_topic_ = static_cast<std::string>(c["marker_topic"]);
     marker_namespace_ = static_cast<std::string>(c["marker_namespace"]);
+    publish_rate_ = c.hasMember("publish_rate") ? static_cast<double>(c["publish_rate"]) : 0.0;
   }
   catch(XmlRpc::XmlRpcException& e)
   {
@@ -188,6 +190,9 @@ bool TrajectoryVisualization::setMotionPlanRequest(const planning_scene::Plannin
 
   error_code.val = error_code.SUCCESS;
 
+  // the marker and the state are used by the publisher thread
+  publisher_.wait();
+  last_publish_ = std::chrono::steady_clock::time_point();
 
   // initializing points array
   tool_traj_line_ = Eigen::MatrixXd::Zero(3,config.num_timesteps);
@@ -199,7 +204,10 @@ bool TrajectoryVisualization::setMotionPlanRequest(const planning_scene::Plannin
                        marker_namespace_,tool_traj_marker_);
 
   // updating state
-  state_.reset(new RobotState(robot_model_));
+  if(!state_)
+  {
+    state_.reset(new RobotState(robot_model_));
+  }
   if(!robotStateMsgToRobotState(req.start_state,*state_,true))
   {
     ROS_ERROR("%s Failed to get current robot state from request",getName().c_str());
@@ -229,12 +237,14 @@ bool TrajectoryVisualization::filter(std::size_t start_timestep,
     return false;
   }
 
-  if(publish_intermediate_)
+  if(publish_intermediate_ && shouldPublish())
   {
-    Eigen::MatrixXd updated_parameters = parameters + updates;
-    tool_traj_line_ = jointsToToolPath(*state_,group_name_,updated_parameters);
-    eigenToPointsMsgs(tool_traj_line_,tool_traj_marker_.points);
-    viz_pub_.publish(tool_traj_marker_);
+    last_publish_ = std::chrono::steady_clock::now();
+    auto updated_parameters = std::make_shared<Eigen::MatrixXd>(parameters + updates);
+    publisher_.post([this,updated_parameters]()
+    {
+      publishToolPath(*updated_parameters,rgb_);
+    });
   }
 
   return true;
@@ -242,15 +252,36 @@ bool TrajectoryVisualization::filter(std::size_t start_timestep,
 
 void TrajectoryVisualization::done(bool success,int total_iterations,double final_cost,const Eigen::MatrixXd& parameters)
 {
+  // replaces the intermediate trajectory that may still be pending
+  auto final_parameters = std::make_shared<Eigen::MatrixXd>(parameters);
+  std_msgs::ColorRGBA rgb = success ? rgb_ : error_rgb_;
+  publisher_.post([this,final_parameters,rgb]()
+  {
+    publishToolPath(*final_parameters,rgb);
+  });
+}
 
-  tool_traj_line_ = jointsToToolPath(*state_,group_name_,parameters);
-  eigenToPointsMsgs(tool_traj_line_,tool_traj_marker_.points);
+bool TrajectoryVisualization::shouldPublish() const
+{
+  if(viz_pub_.getNumSubscribers() == 0)
+  {
+    return false;
+  }
 
-  if(!success)
+  if(publish_rate_ <= 0.0)
   {
-    tool_traj_marker_.color = error_rgb_;
+    return true;
   }
 
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - last_publish_;
+  return elapsed.count() >= 1.0/publish_rate_;
+}
+
+void TrajectoryVisualization::publishToolPath(const Eigen::MatrixXd& parameters,const std_msgs::ColorRGBA& rgb)
+{
+  tool_traj_line_ = jointsToToolPath(*state_,group_name_,parameters);
+  eigenToPointsMsgs(tool_traj_line_,tool_traj_marker_.points);
+  tool_traj_marker_.color = rgb;
   viz_pub_.publish(tool_traj_marker_);
 }
 
@@ -30,16 +30,22 @@
 #include <pluginlib/class_list_macros.h>
 #include <ros/package.h>
 #include <Eigen/Core>
+#include <algorithm>
 
 PLUGINLIB_EXPORT_CLASS(stomp_moveit::update_filters::UpdateLogger,stomp_moveit::update_filters::StompUpdateFilter);
 
+static const int DEFAULT_BUFFER_SIZE = 64;
+
 namespace stomp_moveit
 {
 namespace update_filters
 {
 
 UpdateLogger::UpdateLogger():
-    name_("UpdateLogger")
+    name_("UpdateLogger"),
+    binary_(false),
+    buffer_size_(DEFAULT_BUFFER_SIZE),
+    staged_iteration_(-1)
 {
 
 }
@@ -76,6 +82,8 @@ bool UpdateLogger::configure(const XmlRpc::XmlRpcValue& config)
     filename_ = static_cast<std::string>(c["filename"]);
     directory_ = static_cast<std::string>(c["directory"]);
     package_ = static_cast<std::string>(c["package"]);
+    binary_ = c.hasMember("binary") ? static_cast<bool>(c["binary"]) : false;
+    buffer_size_ = c.hasMember("buffer_size") ? static_cast<int>(c["buffer_size"]) : DEFAULT_BUFFER_SIZE;
   }
   catch(XmlRpc::XmlRpcException& e)
   {
@@ -109,6 +117,21 @@ bool UpdateLogger::setMotionPlanRequest(const planning_scene::PlanningSceneConst
     }
   }
 
+  if(binary_)
+  {
+    // the records are staged in preallocated matrices and streamed by the writer thread
+    staged_iteration_ = -1;
+    staged_parameters_ = Eigen::MatrixXd::Zero(config.num_dimensions,config.num_timesteps);
+    staged_updates_ = Eigen::MatrixXd::Zero(config.num_dimensions,config.num_timesteps);
+    if(!binary_writer_.open(full_file_name_,config.num_dimensions,config.num_timesteps,std::max(buffer_size_,1)))
+    {
+      ROS_ERROR("Unable to create/open update log file %s",full_file_name_.c_str());
+      return false;
+    }
+
+    return true;
+  }
+
   // open file
   file_stream_.open(full_file_name_);
   if(!file_stream_.is_open())
@@ -129,13 +152,41 @@ bool UpdateLogger::filter(std::size_t start_timestep,std::size_t num_timesteps,i
                           bool& filtered)
 {
 
-  stream_<<updates.format(format_)<<std::endl;
   filtered = false;
+  if(binary_)
+  {
+    staged_iteration_ = iteration_number;
+    staged_parameters_ = parameters;
+    staged_updates_ = updates;
+    return true;
+  }
+
+  stream_<<updates.format(format_)<<std::endl;
   return true;
 }
 
+void UpdateLogger::postIteration(std::size_t start_timestep,
+                                 std::size_t num_timesteps,int iteration_number,double cost,
+                                 const Eigen::MatrixXd& parameters)
+{
+  if(binary_ && staged_iteration_ == iteration_number)
+  {
+    binary_writer_.append(staged_iteration_,cost,staged_parameters_,staged_updates_);
+  }
+}
+
 void UpdateLogger::done(bool success, int total_iterations,double final_cost,const Eigen::MatrixXd& parameters)
 {
+  if(binary_)
+  {
+    std::size_t dropped = binary_writer_.getDroppedRecords();
+    std::size_t num_records = binary_writer_.close();
+    ROS_WARN_COND(dropped > 0,"%s dropped %zu records, increase the 'buffer_size' parameter",getName().c_str(),dropped);
+    ROS_INFO("Saved %zu records into the update log file %s, read with 'load_update_log.py'",num_records,
+             full_file_name_.c_str());
+    return;
+  }
+
   // creating header
   std::string header = R"(# num_iterations: @iterations
 # num_timesteps: @timesteps
@@ -0,0 +1,110 @@
+/**
+ * @file background_worker.cpp
+ * @brief This runs work handed off by the plugins on a separate thread
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stomp_moveit/utils/background_worker.h>
+
+namespace stomp_moveit
+{
+namespace utils
+{
+
+BackgroundWorker::BackgroundWorker():
+    busy_(false),
+    stop_(false)
+{
+
+}
+
+BackgroundWorker::~BackgroundWorker()
+{
+  stop();
+}
+
+bool BackgroundWorker::post(Job job)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if(!thread_.joinable())
+  {
+    stop_ = false;
+    thread_ = std::thread(&BackgroundWorker::run,this);
+  }
+
+  bool replaced = static_cast<bool>(pending_job_);
+  pending_job_ = std::move(job);
+  condition_.notify_all();
+  return !replaced;
+}
+
+void BackgroundWorker::wait()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  condition_.wait(lock,[this]{ return !thread_.joinable() || (!pending_job_ && !busy_); });
+}
+
+void BackgroundWorker::stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if(!thread_.joinable())
+    {
+      return;
+    }
+    stop_ = true;
+    pending_job_ = nullptr;
+    condition_.notify_all();
+  }
+
+  thread_.join();
+  std::lock_guard<std::mutex> lock(mutex_);
+  condition_.notify_all();
+}
+
+void BackgroundWorker::run()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  while(true)
+  {
+    condition_.wait(lock,[this]{ return stop_ || pending_job_; });
+    if(stop_)
+    {
+      return;
+    }
+
+    Job job = std::move(pending_job_);
+    pending_job_ = nullptr;
+    busy_ = true;
+    lock.unlock();
+
+    job();
+
+    lock.lock();
+    busy_ = false;
+    condition_.notify_all();
+  }
+}
+
+} /* namespace utils */
+} /* namespace stomp_moveit */
@@ -0,0 +1,173 @@
+/**
+ * @file binary_log_writer.cpp
+ * @brief This streams fixed size optimization records into a binary file from a background thread
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stomp_moveit/utils/binary_log_writer.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+static const std::chrono::milliseconds WRITER_PERIOD(10);   /**< The longest time a record waits before it is written */
+
+namespace stomp_moveit
+{
+namespace utils
+{
+
+const char BinaryLogWriter::MAGIC[8] = {'S','T','O','M','P','L','O','G'};
+const std::uint32_t BinaryLogWriter::VERSION;
+
+static_assert(sizeof(BinaryLogWriter::Header) == 64,"The binary log header must be 64 bytes");
+
+BinaryLogWriter::BinaryLogWriter():
+    file_(nullptr),
+    capacity_(0),
+    head_(0),
+    tail_(0),
+    dropped_(0),
+    closing_(false)
+{
+  std::memset(&header_,0,sizeof(header_));
+}
+
+BinaryLogWriter::~BinaryLogWriter()
+{
+  close();
+}
+
+bool BinaryLogWriter::open(const std::string& file_name,int num_dimensions,int num_timesteps,std::size_t capacity)
+{
+  close();
+
+  file_ = std::fopen(file_name.c_str(),"wb");
+  if(!file_)
+  {
+    return false;
+  }
+
+  std::memset(&header_,0,sizeof(header_));
+  std::memcpy(header_.magic,MAGIC,sizeof(MAGIC));
+  header_.version = VERSION;
+  header_.header_size = sizeof(Header);
+  header_.num_dimensions = num_dimensions;
+  header_.num_timesteps = num_timesteps;
+  header_.record_size = 2*sizeof(std::int64_t) + 2*sizeof(double)*num_dimensions*num_timesteps;
+  std::fwrite(&header_,sizeof(header_),1,file_);
+
+  capacity_ = std::max<std::size_t>(capacity,1);
+  ring_.resize(capacity_*header_.record_size);
+  head_ = 0;
+  tail_ = 0;
+  dropped_ = 0;
+  closing_ = false;
+  thread_ = std::thread(&BinaryLogWriter::run,this);
+
+  return true;
+}
+
+bool BinaryLogWriter::append(int iteration,double cost,const Eigen::MatrixXd& parameters,const Eigen::MatrixXd& updates)
+{
+  typedef Eigen::Matrix<double,Eigen::Dynamic,Eigen::Dynamic,Eigen::RowMajor> RowMajorMatrix;
+
+  if(!file_ || parameters.rows() != static_cast<Eigen::Index>(header_.num_dimensions) ||
+      parameters.cols() != static_cast<Eigen::Index>(header_.num_timesteps) ||
+      updates.rows() != parameters.rows() || updates.cols() != parameters.cols())
+  {
+    return false;
+  }
+
+  std::size_t head = head_.load(std::memory_order_relaxed);
+  if(head - tail_.load(std::memory_order_acquire) >= capacity_)
+  {
+    dropped_++;
+    return false;
+  }
+
+  // filling the slot
+  char* slot = &ring_[(head % capacity_)*header_.record_size];
+  std::int64_t iteration_value = iteration;
+  std::memcpy(slot,&iteration_value,sizeof(iteration_value));
+  std::memcpy(slot + sizeof(std::int64_t),&cost,sizeof(cost));
+
+  std::size_t num_values = parameters.size();
+  double* values = reinterpret_cast<double*>(slot + 2*sizeof(std::int64_t));
+  Eigen::Map<RowMajorMatrix>(values,parameters.rows(),parameters.cols()) = parameters;
+  Eigen::Map<RowMajorMatrix>(values + num_values,updates.rows(),updates.cols()) = updates;
+
+  head_.store(head + 1,std::memory_order_release);
+  return true;
+}
+
+std::size_t BinaryLogWriter::close()
+{
+  if(!file_)
+  {
+    return 0;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closing_ = true;
+  }
+  condition_.notify_one();
+  thread_.join();
+
+  // completing the header
+  header_.num_records = tail_.load();
+  header_.dropped_records = dropped_;
+  std::fseek(file_,0,SEEK_SET);
+  std::fwrite(&header_,sizeof(header_),1,file_);
+  std::fclose(file_);
+  file_ = nullptr;
+
+  return header_.num_records;
+}
+
+void BinaryLogWriter::run()
+{
+  while(true)
+  {
+    // writing the records available, the slots are released as soon as they are written
+    std::size_t head = head_.load(std::memory_order_acquire);
+    std::size_t tail = tail_.load(std::memory_order_relaxed);
+    for(; tail != head; tail++)
+    {
+      std::fwrite(&ring_[(tail % capacity_)*header_.record_size],header_.record_size,1,file_);
+      tail_.store(tail + 1,std::memory_order_release);
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    if(closing_ && head_.load(std::memory_order_acquire) == tail)
+    {
+      break;
+    }
+    condition_.wait_for(lock,WRITER_PERIOD);
+  }
+
+  std::fflush(file_);
+}
+
+} /* namespace utils */
+} /* namespace stomp_moveit */
@@ -0,0 +1,191 @@
+/**
+ * @file configuration_cache.cpp
+ * @brief A cache of the collision and distance results of quantized joint configurations
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stomp_moveit/utils/configuration_cache.h>
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+static const std::uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+static const std::uint64_t FNV_PRIME = 1099511628211ULL;
+
+/**
+ * @brief Hashes bytes with FNV-1a
+ * @param data  The bytes
+ * @param size  The number of bytes
+ * @param hash  The running hash value, updated
+ */
+void hashBytes(const void* data, std::size_t size, std::uint64_t& hash)
+{
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  for(std::size_t i = 0; i < size; i++)
+  {
+    hash = (hash ^ bytes[i])*FNV_PRIME;
+  }
+}
+
+}
+
+/**
+ * @namespace stomp_moveit
+ */
+namespace stomp_moveit
+{
+
+/**
+ * @namespace utils
+ */
+namespace utils
+{
+
+const std::size_t ConfigurationCache::NUM_STRIPES;
+
+ConfigurationCache::ConfigurationCache():
+    num_dimensions_(0),
+    resolution_(0.0),
+    capacity_(0),
+    context_(0),
+    stripes_(new std::mutex[NUM_STRIPES])
+{
+
+}
+
+void ConfigurationCache::configure(std::size_t num_dimensions, double resolution, std::size_t capacity)
+{
+  num_dimensions_ = num_dimensions;
+  resolution_ = resolution > 0.0 ? resolution : 0.0;
+  capacity_ = resolution_ > 0.0 && num_dimensions > 0 ? capacity : 0;
+  context_ = 0;
+  hashes_.assign(capacity_,0);
+  cells_.assign(capacity_*num_dimensions_,0);
+  values_.assign(capacity_,0.0);
+}
+
+bool ConfigurationCache::isEnabled() const
+{
+  return capacity_ > 0;
+}
+
+void ConfigurationCache::setContext(std::uint64_t context)
+{
+  if(context == context_)
+  {
+    return;
+  }
+
+  context_ = context;
+  std::fill(hashes_.begin(),hashes_.end(),0);
+}
+
+bool ConfigurationCache::lookup(const Eigen::Ref<const Eigen::VectorXd>& positions, double& value) const
+{
+  if(capacity_ == 0 || static_cast<std::size_t>(positions.size()) != num_dimensions_)
+  {
+    return false;
+  }
+
+  std::uint64_t hash = hashCell(positions);
+  std::size_t slot = hash % capacity_;
+  std::lock_guard<std::mutex> lock(stripes_[slot % NUM_STRIPES]);
+  if(!matches(slot,hash,positions))
+  {
+    return false;
+  }
+
+  value = values_[slot];
+  return true;
+}
+
+void ConfigurationCache::insert(const Eigen::Ref<const Eigen::VectorXd>& positions, double value)
+{
+  if(capacity_ == 0 || static_cast<std::size_t>(positions.size()) != num_dimensions_)
+  {
+    return;
+  }
+
+  std::uint64_t hash = hashCell(positions);
+  std::size_t slot = hash % capacity_;
+  std::lock_guard<std::mutex> lock(stripes_[slot % NUM_STRIPES]);
+  hashes_[slot] = hash;
+  for(auto d = 0u; d < num_dimensions_; d++)
+  {
+    cells_[slot*num_dimensions_ + d] = quantize(positions(d));
+  }
+  values_[slot] = value;
+}
+
+std::uint64_t ConfigurationCache::hashContext(const void* identity, std::uint64_t hash,
+                                              const Eigen::Ref<const Eigen::VectorXd>& values)
+{
+  std::uint64_t context = FNV_OFFSET_BASIS;
+  hashBytes(&identity,sizeof(identity),context);
+  hashBytes(&hash,sizeof(hash),context);
+  for(auto i = 0; i < values.size(); i++)
+  {
+    double value = values(i);
+    hashBytes(&value,sizeof(value),context);
+  }
+  return context;
+}
+
+std::uint64_t ConfigurationCache::hashCell(const Eigen::Ref<const Eigen::VectorXd>& positions) const
+{
+  std::uint64_t hash = FNV_OFFSET_BASIS;
+  for(auto d = 0u; d < num_dimensions_; d++)
+  {
+    std::int64_t cell = quantize(positions(d));
+    hashBytes(&cell,sizeof(cell),hash);
+  }
+  return hash == 0 ? 1 : hash;
+}
+
+bool ConfigurationCache::matches(std::size_t slot, std::uint64_t hash,
+                                 const Eigen::Ref<const Eigen::VectorXd>& positions) const
+{
+  if(hashes_[slot] != hash)
+  {
+    return false;
+  }
+
+  for(auto d = 0u; d < num_dimensions_; d++)
+  {
+    if(cells_[slot*num_dimensions_ + d] != quantize(positions(d)))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::int64_t ConfigurationCache::quantize(double value) const
+{
+  return static_cast<std::int64_t>(std::llround(value/resolution_));
+}
+
+} /* namespace utils */
+} /* namespace stomp_moveit */
@@ -0,0 +1,518 @@
+/**
+ * @file experience_library.cpp
+ * @brief A persistent library of optimized trajectories shared by several processes to seed the planner
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stomp_moveit/utils/experience_library.h>
+#include <stomp_moveit/utils/trajectory_cache.h>
+#include <ros/console.h>
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char FILE_MAGIC[8] = {'S','T','O','M','P','E','X','P'};
+static const std::uint32_t FILE_VERSION = 1;
+static const std::size_t GROUP_NAME_SIZE = 64;
+
+namespace
+{
+
+/** @brief Holds an advisory lock of a file for the lifetime of the object */
+class FileLock
+{
+public:
+
+  /**
+   * @brief Locks the file, it blocks until the lock is acquired
+   * @param fd        The file descriptor
+   * @param exclusive Whether to acquire an exclusive lock instead of a shared one
+   */
+  FileLock(int fd, bool exclusive):
+    fd_(fd)
+  {
+    while(flock(fd_,exclusive ? LOCK_EX : LOCK_SH) != 0 && errno == EINTR) {}
+  }
+
+  ~FileLock()
+  {
+    flock(fd_,LOCK_UN);
+  }
+
+private:
+  int fd_;
+};
+
+/**
+ * @brief Hashes bytes with FNV-1a
+ * @param data  The bytes
+ * @param size  The number of bytes
+ * @param hash  The running hash value, updated
+ */
+void hashBytes(const void* data, std::size_t size, std::uint64_t& hash)
+{
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  for(std::size_t i = 0; i < size; i++)
+  {
+    hash = (hash ^ bytes[i])*1099511628211ULL;
+  }
+}
+
+}
+
+/**
+ * @namespace stomp_moveit
+ */
+namespace stomp_moveit
+{
+
+/**
+ * @namespace utils
+ */
+namespace utils
+{
+
+/** @brief The header at the start of the file, all the processes sharing the file must agree on its layout */
+struct ExperienceLibrary::FileHeader
+{
+  char magic[8];                              /**< @brief Identifies a library file */
+  std::uint32_t version;                      /**< @brief The version of the layout */
+  std::uint32_t num_dimensions;               /**< @brief The number of joints of the group */
+  std::uint32_t max_timesteps;                /**< @brief The maximum number of timesteps of a stored trajectory */
+  std::uint32_t capacity;                     /**< @brief The number of slots */
+  char group[GROUP_NAME_SIZE];                /**< @brief The planning group, null terminated */
+  std::uint32_t num_entries;                  /**< @brief The number of occupied slots, slots are occupied in order */
+  std::uint32_t next_slot;                    /**< @brief The slot replaced next once the library is full */
+  std::uint32_t dirty;                        /**< @brief Non zero while a process modifies the file */
+  std::uint32_t padding;
+};
+
+/** @brief An entry of the index of the occupied slots */
+struct ExperienceLibrary::IndexEntry
+{
+  double projection;                          /**< @brief The sum of the start and goal joint values of the trajectory */
+  std::uint32_t slot;                         /**< @brief The slot holding the trajectory */
+  std::uint32_t padding;
+};
+
+/** @brief The header of a slot */
+struct ExperienceLibrary::SlotHeader
+{
+  std::uint64_t scene_hash;                   /**< @brief The hash of the planning scene of the trajectory */
+  std::uint32_t num_timesteps;                /**< @brief The number of timesteps of the trajectory */
+  std::uint32_t occupied;                     /**< @brief Non zero once the slot holds a trajectory */
+};
+
+ExperienceLibrary::ExperienceLibrary():
+    fd_(-1),
+    data_(nullptr),
+    file_size_(0),
+    num_dimensions_(0),
+    max_timesteps_(0),
+    capacity_(0),
+    slot_size_(0),
+    tolerance_(0.0)
+{
+
+}
+
+ExperienceLibrary::~ExperienceLibrary()
+{
+  close();
+}
+
+bool ExperienceLibrary::open(const std::string& file_name, const std::string& group, std::size_t num_dimensions,
+                             std::size_t max_timesteps, std::size_t capacity, double tolerance)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if(data_)
+  {
+    ROS_ERROR("The experience library '%s' is already open",file_name_.c_str());
+    return false;
+  }
+
+  if(num_dimensions == 0 || max_timesteps < 2 || capacity == 0 || group.size() >= GROUP_NAME_SIZE)
+  {
+    ROS_ERROR("The experience library '%s' of group '%s' has an invalid size",file_name.c_str(),group.c_str());
+    return false;
+  }
+
+  int fd = ::open(file_name.c_str(),O_RDWR | O_CREAT,0666);
+  if(fd < 0)
+  {
+    ROS_ERROR("Failed to open the experience library '%s': %s",file_name.c_str(),std::strerror(errno));
+    return false;
+  }
+
+  std::size_t slot_size = sizeof(SlotHeader) + num_dimensions*max_timesteps*sizeof(double);
+  std::size_t file_size = sizeof(FileHeader) + capacity*(sizeof(IndexEntry) + slot_size);
+  bool created = false;
+  {
+    // the first process that maps an empty file initializes it
+    FileLock file_lock(fd,true);
+    struct stat file_stat;
+    if(fstat(fd,&file_stat) != 0)
+    {
+      ROS_ERROR("Failed to read the size of the experience library '%s': %s",file_name.c_str(),std::strerror(errno));
+      ::close(fd);
+      return false;
+    }
+
+    if(file_stat.st_size == 0)
+    {
+      if(ftruncate(fd,file_size) != 0)
+      {
+        ROS_ERROR("Failed to allocate the experience library '%s': %s",file_name.c_str(),std::strerror(errno));
+        ::close(fd);
+        return false;
+      }
+      created = true;
+    }
+    else if(static_cast<std::size_t>(file_stat.st_size) != file_size)
+    {
+      ROS_ERROR("The experience library '%s' was created with a different number of joints, timesteps or capacity",
+                file_name.c_str());
+      ::close(fd);
+      return false;
+    }
+
+    void* data = mmap(nullptr,file_size,PROT_READ | PROT_WRITE,MAP_SHARED,fd,0);
+    if(data == MAP_FAILED)
+    {
+      ROS_ERROR("Failed to map the experience library '%s': %s",file_name.c_str(),std::strerror(errno));
+      ::close(fd);
+      return false;
+    }
+
+    fd_ = fd;
+    data_ = static_cast<unsigned char*>(data);
+    file_size_ = file_size;
+    num_dimensions_ = num_dimensions;
+    max_timesteps_ = max_timesteps;
+    capacity_ = capacity;
+    slot_size_ = slot_size;
+    tolerance_ = tolerance;
+    file_name_ = file_name;
+
+    // the extended file reads as zeros, only the header needs to be written
+    FileHeader* h = header();
+    if(created)
+    {
+      std::memcpy(h->magic,FILE_MAGIC,sizeof(FILE_MAGIC));
+      h->version = FILE_VERSION;
+      h->num_dimensions = num_dimensions;
+      h->max_timesteps = max_timesteps;
+      h->capacity = capacity;
+      std::strncpy(h->group,group.c_str(),GROUP_NAME_SIZE - 1);
+    }
+    else if(std::memcmp(h->magic,FILE_MAGIC,sizeof(FILE_MAGIC)) != 0 || h->version != FILE_VERSION ||
+        h->num_dimensions != num_dimensions || h->max_timesteps != max_timesteps || h->capacity != capacity ||
+        group != std::string(h->group,strnlen(h->group,GROUP_NAME_SIZE)))
+    {
+      ROS_ERROR("The file '%s' is not an experience library of group '%s' with this layout",file_name.c_str(),
+                group.c_str());
+      munmap(data_,file_size_);
+      data_ = nullptr;
+      fd_ = -1;
+      ::close(fd);
+      return false;
+    }
+    else if(h->dirty)
+    {
+      ROS_WARN("The experience library '%s' was left in an inconsistent state, rebuilding its index",
+               file_name.c_str());
+      rebuildIndex();
+    }
+  }
+
+  ROS_INFO("Opened the experience library '%s' holding %u trajectories",file_name.c_str(),header()->num_entries);
+  return true;
+}
+
+void ExperienceLibrary::close()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if(data_)
+  {
+    munmap(data_,file_size_);
+    data_ = nullptr;
+  }
+
+  if(fd_ >= 0)
+  {
+    ::close(fd_);
+    fd_ = -1;
+  }
+}
+
+bool ExperienceLibrary::isOpen() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return data_ != nullptr;
+}
+
+bool ExperienceLibrary::insert(const Eigen::MatrixXd& parameters, std::uint64_t scene_hash)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if(!data_ || parameters.rows() != num_dimensions_ || parameters.cols() < 2 || parameters.cols() > max_timesteps_)
+  {
+    return false;
+  }
+
+  FileLock file_lock(fd_,true);
+  FileHeader* h = header();
+  if(h->dirty)
+  {
+    rebuildIndex();
+  }
+  h->dirty = 1;
+
+  // replacing a trajectory for nearly the same motion, else filling the next free slot or the oldest one
+  std::size_t slot;
+  double distance;
+  int nearest = findNearest(parameters.col(0),parameters.col(parameters.cols() - 1),scene_hash,distance);
+  if(nearest >= 0)
+  {
+    slot = nearest;
+    removeFromIndex(slot);
+  }
+  else if(h->num_entries < capacity_)
+  {
+    slot = h->num_entries;
+  }
+  else
+  {
+    slot = h->next_slot;
+    h->next_slot = (h->next_slot + 1) % capacity_;
+    removeFromIndex(slot);
+  }
+
+  SlotHeader* slot_header = slotHeader(slot);
+  slot_header->scene_hash = scene_hash;
+  slot_header->num_timesteps = parameters.cols();
+  std::memcpy(slotData(slot),parameters.data(),parameters.size()*sizeof(double));
+  slot_header->occupied = 1;
+  addToIndex(slot,computeProjection(parameters.col(0),parameters.col(parameters.cols() - 1)));
+
+  h->dirty = 0;
+  return true;
+}
+
+bool ExperienceLibrary::lookup(const Eigen::VectorXd& start, const Eigen::VectorXd& goal, std::uint64_t scene_hash,
+                               Eigen::MatrixXd& parameters) const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if(!data_ || start.size() != num_dimensions_ || goal.size() != num_dimensions_)
+  {
+    return false;
+  }
+
+  FileLock file_lock(fd_,false);
+  if(header()->dirty)
+  {
+    // the index is rebuilt by the next insertion
+    return false;
+  }
+
+  double distance;
+  int nearest = findNearest(start,goal,scene_hash,distance);
+  if(nearest < 0)
+  {
+    return false;
+  }
+
+  // moving the end points onto the requested start and goal
+  const SlotHeader* slot_header = slotHeader(nearest);
+  parameters = Eigen::Map<const Eigen::MatrixXd>(slotData(nearest),num_dimensions_,slot_header->num_timesteps);
+  TrajectoryCache::blendEndPoints(start,goal,parameters);
+
+  return true;
+}
+
+std::size_t ExperienceLibrary::size() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return data_ ? header()->num_entries : 0;
+}
+
+ExperienceLibrary::FileHeader* ExperienceLibrary::header() const
+{
+  return reinterpret_cast<FileHeader*>(data_);
+}
+
+ExperienceLibrary::IndexEntry* ExperienceLibrary::index() const
+{
+  return reinterpret_cast<IndexEntry*>(data_ + sizeof(FileHeader));
+}
+
+ExperienceLibrary::SlotHeader* ExperienceLibrary::slotHeader(std::size_t slot) const
+{
+  return reinterpret_cast<SlotHeader*>(data_ + sizeof(FileHeader) + capacity_*sizeof(IndexEntry) + slot*slot_size_);
+}
+
+double* ExperienceLibrary::slotData(std::size_t slot) const
+{
+  return reinterpret_cast<double*>(reinterpret_cast<unsigned char*>(slotHeader(slot)) + sizeof(SlotHeader));
+}
+
+double ExperienceLibrary::computeProjection(const Eigen::Ref<const Eigen::VectorXd>& start,
+                                            const Eigen::Ref<const Eigen::VectorXd>& goal)
+{
+  return start.sum() + goal.sum();
+}
+
+int ExperienceLibrary::findNearest(const Eigen::Ref<const Eigen::VectorXd>& start,
+                                   const Eigen::Ref<const Eigen::VectorXd>& goal,
+                                   std::uint64_t scene_hash, double& distance) const
+{
+  // |sum(a) - sum(b)| <= |a - b|_1, the entries outside of this range of the index are farther than the tolerance
+  double projection = computeProjection(start,goal);
+  const IndexEntry* begin = index();
+  const IndexEntry* end = begin + header()->num_entries;
+  const IndexEntry* it = std::lower_bound(begin,end,projection - tolerance_,[](const IndexEntry& e, double value)
+  {
+    return e.projection < value;
+  });
+
+  int nearest = -1;
+  distance = std::numeric_limits<double>::max();
+  for(; it != end && it->projection <= projection + tolerance_; ++it)
+  {
+    const SlotHeader* slot_header = slotHeader(it->slot);
+    if(slot_header->scene_hash != scene_hash || slot_header->num_timesteps < 2)
+    {
+      continue;
+    }
+
+    Eigen::Map<const Eigen::MatrixXd> entry(slotData(it->slot),num_dimensions_,slot_header->num_timesteps);
+    double d = (entry.col(0) - start).cwiseAbs().sum() + (entry.col(entry.cols() - 1) - goal).cwiseAbs().sum();
+    if(d <= tolerance_ && d < distance)
+    {
+      distance = d;
+      nearest = it->slot;
+    }
+  }
+
+  return nearest;
+}
+
+void ExperienceLibrary::removeFromIndex(std::size_t slot)
+{
+  FileHeader* h = header();
+  IndexEntry* begin = index();
+  IndexEntry* end = begin + h->num_entries;
+  IndexEntry* it = std::find_if(begin,end,[slot](const IndexEntry& e) { return e.slot == slot; });
+  if(it != end)
+  {
+    std::memmove(it,it + 1,(end - it - 1)*sizeof(IndexEntry));
+    h->num_entries--;
+  }
+}
+
+void ExperienceLibrary::addToIndex(std::size_t slot, double projection)
+{
+  FileHeader* h = header();
+  IndexEntry* begin = index();
+  IndexEntry* end = begin + h->num_entries;
+  IndexEntry* it = std::upper_bound(begin,end,projection,[](double value, const IndexEntry& e)
+  {
+    return value < e.projection;
+  });
+
+  std::memmove(it + 1,it,(end - it)*sizeof(IndexEntry));
+  it->projection = projection;
+  it->slot = slot;
+  it->padding = 0;
+  h->num_entries++;
+}
+
+void ExperienceLibrary::rebuildIndex()
+{
+  // the slots are occupied in order, the first free slot ends the occupied ones
+  FileHeader* h = header();
+  h->num_entries = 0;
+  for(std::size_t slot = 0; slot < capacity_; slot++)
+  {
+    const SlotHeader* slot_header = slotHeader(slot);
+    if(!slot_header->occupied || slot_header->num_timesteps < 2 || slot_header->num_timesteps > max_timesteps_)
+    {
+      break;
+    }
+
+    Eigen::Map<const Eigen::MatrixXd> entry(slotData(slot),num_dimensions_,slot_header->num_timesteps);
+    addToIndex(slot,computeProjection(entry.col(0),entry.col(entry.cols() - 1)));
+  }
+
+  if(h->next_slot >= capacity_)
+  {
+    h->next_slot = 0;
+  }
+  h->dirty = 0;
+}
+
+std::uint64_t hashPlanningScene(const planning_scene::PlanningScene& planning_scene)
+{
+  // the objects are hashed in the order of their names so that the insertion order does not matter
+  const collision_detection::WorldConstPtr& world = planning_scene.getWorld();
+  std::vector<std::string> ids = world->getObjectIds();
+  std::sort(ids.begin(),ids.end());
+
+  std::uint64_t hash = 14695981039346656037ULL;
+  for(const std::string& id : ids)
+  {
+    collision_detection::World::ObjectConstPtr object = world->getObject(id);
+    if(!object)
+    {
+      continue;
+    }
+
+    hashBytes(id.data(),id.size(),hash);
+    for(auto s = 0u; s < object->shapes_.size(); s++)
+    {
+      int type = object->shapes_[s]->type;
+      hashBytes(&type,sizeof(type),hash);
+
+      const auto& pose = object->shape_poses_[s];
+      for(auto r = 0; r < 3; r++)
+      {
+        for(auto c = 0; c < 4; c++)
+        {
+          long long value = std::llround(pose.matrix()(r,c)*1000.0);
+          hashBytes(&value,sizeof(value),hash);
+        }
+      }
+    }
+  }
+
+  return hash;
+}
+
+} /* namespace utils */
+} /* namespace stomp_moveit */
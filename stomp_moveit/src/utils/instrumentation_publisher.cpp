@@ -0,0 +1,74 @@
+/**
+ * @file instrumentation_publisher.cpp
+ * @brief Publishes the profile of every STOMP iteration on a ROS topic
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stomp_moveit/utils/instrumentation_publisher.h>
+#include <stomp_moveit/IterationProfile.h>
+
+namespace stomp_moveit
+{
+namespace utils
+{
+
+InstrumentationPublisher::InstrumentationPublisher(ros::NodeHandle& nh,const std::string& topic,
+                                                   const std::string& group):
+    publisher_(nh.advertise<stomp_moveit::IterationProfile>(topic,100)),
+    group_(group)
+{
+
+}
+
+void InstrumentationPublisher::recordIteration(const stomp_core::IterationProfile& profile)
+{
+  using namespace stomp_core::IterationStages;
+
+  if(publisher_.getNumSubscribers() == 0)
+  {
+    return;
+  }
+
+  stomp_moveit::IterationProfilePtr msg(new stomp_moveit::IterationProfile());
+  msg->header.stamp = ros::Time::now();
+  msg->group = group_;
+  msg->iteration = profile.iteration;
+  msg->completed = profile.completed;
+  for(int s = 0; s < profile.num_stages; s++)
+  {
+    msg->stage_names.push_back(getName(static_cast<IterationStage>(s)));
+    msg->stage_durations.push_back(profile.stage_durations[s]);
+  }
+  msg->rollouts_generated = profile.rollouts_generated;
+  msg->rollouts_reused = profile.rollouts_reused;
+  msg->rollouts_active = profile.rollouts_active;
+  msg->min_rollout_cost = profile.min_rollout_cost;
+  msg->mean_rollout_cost = profile.mean_rollout_cost;
+  msg->max_rollout_cost = profile.max_rollout_cost;
+  msg->optimized_cost = profile.optimized_cost;
+  msg->valid = profile.valid;
+  publisher_.publish(msg);
+}
+
+} /* namespace utils */
+} /* namespace stomp_moveit */
@@ -0,0 +1,124 @@
+/**
+ * @file kernel_smoothing.cpp
+ * @brief Kernel smoothing of per timestep values in linear time
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stomp_moveit/utils/kernel_smoothing.h>
+
+namespace
+{
+
+/**
+ * @brief Computes the prefix sums of the values padded by half a window of the end values on either side
+ * @param half_window The number of padded values on either side
+ * @param data        The original values
+ * @param moments     The number of moments, the prefix sums of p(k)*k^m are stored in column m for m < moments
+ * @param workspace   The prefix sums [data.size() + 2*half_window + 1][moments]
+ */
+void computePrefixSums(int half_window, const Eigen::VectorXd& data, int moments, Eigen::MatrixXd& workspace)
+{
+  const int n = data.size();
+  const int padded = n + 2*half_window;
+  workspace.resize(padded + 1,moments);
+  workspace.row(0).setZero();
+  for(int k = 0; k < padded; k++)
+  {
+    int index = k - half_window;
+    double value = data(index < 0 ? 0 : (index >= n ? n - 1 : index));
+    for(int m = 0; m < moments; m++)
+    {
+      workspace(k + 1,m) = workspace(k,m) + value;
+      value *= k;
+    }
+  }
+}
+
+}
+
+/**
+ * @namespace stomp_moveit
+ */
+namespace stomp_moveit
+{
+
+/**
+ * @namespace utils
+ */
+namespace utils
+{
+
+/**
+ * @namespace smoothing
+ */
+namespace smoothing
+{
+
+void applyBoxKernel(std::size_t window_size, const Eigen::VectorXd& data, Eigen::VectorXd& smoothed,
+                    Eigen::MatrixXd& workspace)
+{
+  const int n = data.size();
+  const int half_window = window_size/2;
+  const int window = 2*half_window + 1;
+  smoothed.resize(n);
+  if(n == 0)
+  {
+    return;
+  }
+
+  computePrefixSums(half_window,data,1,workspace);
+  smoothed = (workspace.col(0).segment(window,n) - workspace.col(0).head(n))/window;
+}
+
+void applyEpanechnikovKernel(std::size_t window_size, const Eigen::VectorXd& data, Eigen::VectorXd& smoothed,
+                             Eigen::MatrixXd& workspace)
+{
+  using namespace Eigen;
+
+  const int n = data.size();
+  const int half_window = window_size/2;
+  const double window = 2*half_window + 1;
+  smoothed.resize(n);
+  if(n == 0)
+  {
+    return;
+  }
+
+  // the window of value i spans the padded values [i, i + window) centered at c = i + half_window, the weighted sum
+  // of the squared offsets (k - c)^2 is s2 - 2*c*s1 + c^2*s0
+  computePrefixSums(half_window,data,3,workspace);
+  const int w = window;
+  auto s0 = workspace.col(0).segment(w,n).array() - workspace.col(0).head(n).array();
+  auto s1 = workspace.col(1).segment(w,n).array() - workspace.col(1).head(n).array();
+  auto s2 = workspace.col(2).segment(w,n).array() - workspace.col(2).head(n).array();
+  auto center = ArrayXd::LinSpaced(n,half_window,half_window + n - 1);
+
+  double h = half_window;
+  double normalizer = window - h*(h + 1)*(2*h + 1)/(3*window*window);
+  smoothed = ((s0 - (s2 - 2*center*s1 + center.square()*s0)/(window*window))/normalizer).matrix();
+}
+
+} /* namespace smoothing */
+} /* namespace utils */
+} /* namespace stomp_moveit */
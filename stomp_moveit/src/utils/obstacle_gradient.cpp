@@ -0,0 +1,93 @@
+/**
+ * @file obstacle_gradient.cpp
+ * @brief The distance from a planning group to the nearest obstacle and its gradient
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stomp_moveit/utils/obstacle_gradient.h>
+#include <limits>
+
+/**
+ * @namespace stomp_moveit
+ */
+namespace stomp_moveit
+{
+
+/**
+ * @namespace utils
+ */
+namespace utils
+{
+
+bool computeObstacleGradient(const collision_detection::CollisionRobotIndustrial& robot,
+                             const collision_detection::CollisionWorldIndustrial& world,
+                             const collision_detection::DistanceRequest& req,
+                             const moveit::core::RobotState& state,
+                             collision_detection::DistanceResult& res,
+                             ObstacleGradient& obstacle)
+{
+  res.clear();
+  robot.distanceSelf(req,res,state);
+  world.distanceRobot(req,res,robot,state);
+
+  // the entries are indexed by link and their first side is always the link of the entry
+  int nearest = -1;
+  double min_distance = std::numeric_limits<double>::max();
+  for(auto i = 0u; i < res.distance.size(); i++)
+  {
+    if(res.distance[i].min_distance < min_distance)
+    {
+      min_distance = res.distance[i].min_distance;
+      nearest = i;
+    }
+  }
+
+  obstacle = ObstacleGradient();
+  if(nearest < 0)
+  {
+    obstacle.distance = req.distance_threshold;
+    return false;
+  }
+
+  const collision_detection::DistanceResultsData& entry = res.distance[nearest];
+  obstacle.distance = entry.min_distance;
+  obstacle.link = state.getRobotModel()->getLinkModel(nearest);
+  if(entry.hasNearestPoints)
+  {
+    obstacle.link_point = entry.nearest_points[0];
+  }
+  else
+  {
+    obstacle.link_point = state.getGlobalLinkTransform(obstacle.link).translation();
+  }
+
+  if(entry.hasGradient)
+  {
+    obstacle.gradient = entry.gradient;
+  }
+
+  return true;
+}
+
+} /* namespace utils */
+} /* namespace stomp_moveit */
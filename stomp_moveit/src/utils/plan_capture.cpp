@@ -0,0 +1,144 @@
+/**
+ * @file plan_capture.cpp
+ * @brief Records the inputs of a STOMP plan so that it can be replayed offline
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stomp_moveit/utils/plan_capture.h>
+#include <ros/console.h>
+#include <ros/serialization.h>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+/**
+ * @namespace stomp_moveit
+ */
+namespace stomp_moveit
+{
+
+/**
+ * @namespace utils
+ */
+namespace utils
+{
+
+namespace ser = ros::serialization;
+
+const char PlanCapture::MAGIC[8] = {'S','T','O','M','P','C','A','P'};
+
+static const std::size_t PREAMBLE_SIZE = sizeof(PlanCapture::MAGIC) + sizeof(std::uint32_t); /**< The magic and the version */
+
+bool PlanCapture::write(const std::string& file_name) const
+{
+  std::string config_xml = config.toXml();
+  std::uint32_t size = ser::serializationLength(group) + ser::serializationLength(config_xml) +
+      ser::serializationLength(seed) + ser::serializationLength(collision_detector) +
+      ser::serializationLength(planning_time) + ser::serializationLength(failure) +
+      ser::serializationLength(request) + ser::serializationLength(scene);
+
+  std::vector<std::uint8_t> buffer(PREAMBLE_SIZE + size);
+  std::uint32_t version = VERSION;
+  std::memcpy(buffer.data(),MAGIC,sizeof(MAGIC));
+  std::memcpy(buffer.data() + sizeof(MAGIC),&version,sizeof(version));
+
+  ser::OStream stream(buffer.data() + PREAMBLE_SIZE,size);
+  ser::serialize(stream,group);
+  ser::serialize(stream,config_xml);
+  ser::serialize(stream,seed);
+  ser::serialize(stream,collision_detector);
+  ser::serialize(stream,planning_time);
+  ser::serialize(stream,failure);
+  ser::serialize(stream,request);
+  ser::serialize(stream,scene);
+
+  std::ofstream file(file_name.c_str(),std::ios::binary | std::ios::trunc);
+  if(!file)
+  {
+    ROS_ERROR("Failed to create the plan capture file '%s'",file_name.c_str());
+    return false;
+  }
+
+  file.write(reinterpret_cast<const char*>(buffer.data()),buffer.size());
+  return static_cast<bool>(file);
+}
+
+bool PlanCapture::read(const std::string& file_name)
+{
+  std::ifstream file(file_name.c_str(),std::ios::binary);
+  if(!file)
+  {
+    ROS_ERROR("Failed to open the plan capture file '%s'",file_name.c_str());
+    return false;
+  }
+
+  std::vector<std::uint8_t> buffer((std::istreambuf_iterator<char>(file)),std::istreambuf_iterator<char>());
+  std::uint32_t version = 0;
+  if(buffer.size() < PREAMBLE_SIZE || std::memcmp(buffer.data(),MAGIC,sizeof(MAGIC)) != 0)
+  {
+    ROS_ERROR("'%s' is not a plan capture file",file_name.c_str());
+    return false;
+  }
+
+  std::memcpy(&version,buffer.data() + sizeof(MAGIC),sizeof(version));
+  if(version != VERSION)
+  {
+    ROS_ERROR("The plan capture file '%s' has version %u, only version %u is supported",file_name.c_str(),version,
+              VERSION);
+    return false;
+  }
+
+  try
+  {
+    std::string config_xml;
+    ser::IStream stream(buffer.data() + PREAMBLE_SIZE,buffer.size() - PREAMBLE_SIZE);
+    ser::deserialize(stream,group);
+    ser::deserialize(stream,config_xml);
+    ser::deserialize(stream,seed);
+    ser::deserialize(stream,collision_detector);
+    ser::deserialize(stream,planning_time);
+    ser::deserialize(stream,failure);
+    ser::deserialize(stream,request);
+    ser::deserialize(stream,scene);
+
+    int offset = 0;
+    config = XmlRpc::XmlRpcValue(config_xml,&offset);
+  }
+  catch(ser::StreamOverrunException& e)
+  {
+    ROS_ERROR("The plan capture file '%s' is truncated; %s",file_name.c_str(),e.what());
+    return false;
+  }
+
+  if(!config.valid())
+  {
+    ROS_ERROR("The plan capture file '%s' has an invalid planner configuration",file_name.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+} /* namespace utils */
+} /* namespace stomp_moveit */
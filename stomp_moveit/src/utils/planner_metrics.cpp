@@ -0,0 +1,189 @@
+/**
+ * @file planner_metrics.cpp
+ * @brief Collects the latency and the outcome of the STOMP plans of every planning group
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stomp_moveit/utils/planner_metrics.h>
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+static const char* PHASE_NAMES[] = {"setup","optimization","conversion","validation","total"};
+static const char* FAILURE_NAMES[] = {"none","attempts","start_goal","setup","optimization","conversion",
+                                      "invalid_path"};
+
+/**
+ * @brief Returns the sample at the nearest rank of a percentile
+ * @param sorted The sorted samples, not empty
+ * @param p The percentile in [0, 1]
+ * @return The sample
+ */
+static double percentile(const std::vector<double>& sorted,double p)
+{
+  std::size_t rank = static_cast<std::size_t>(std::ceil(p*sorted.size()));
+  return sorted[std::max<std::size_t>(rank,1) - 1];
+}
+
+/**
+ * @brief Creates a key value pair
+ * @param key   The key
+ * @param value The value
+ * @return The key value pair
+ */
+template<typename T>
+static diagnostic_msgs::KeyValue keyValue(const std::string& key,const T& value)
+{
+  diagnostic_msgs::KeyValue kv;
+  kv.key = key;
+  std::ostringstream ss;
+  ss << value;
+  kv.value = ss.str();
+  return kv;
+}
+
+/**
+ * @namespace stomp_moveit
+ */
+namespace stomp_moveit
+{
+
+/**
+ * @namespace utils
+ */
+namespace utils
+{
+
+PlanRecord::PlanRecord():
+    iterations(-1),
+    termination_reason(stomp_core::TerminationReasons::MAX_ITERATIONS),
+    failure(PlanFailures::NONE)
+{
+  durations.fill(0.0);
+}
+
+PlannerMetrics::PlannerMetrics(std::size_t window_size):
+    window_size_(std::max<std::size_t>(window_size,1))
+{
+
+}
+
+void PlannerMetrics::record(const std::string& group,const PlanRecord& record)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto inserted = groups_.insert(std::make_pair(group,GroupMetrics()));
+  GroupMetrics& m = inserted.first->second;
+  if(inserted.second)
+  {
+    m.next = 0;
+    m.num_plans = 0;
+    m.failures.fill(0);
+  }
+
+  // the windows grow up to their size and then overwrite the oldest plan
+  for(int p = 0; p < PlanPhases::NUM_PHASES; p++)
+  {
+    if(m.durations[p].size() < window_size_)
+    {
+      m.durations[p].push_back(record.durations[p]);
+    }
+    else
+    {
+      m.durations[p][m.next] = record.durations[p];
+    }
+  }
+
+  if(m.iterations.size() < window_size_)
+  {
+    m.iterations.push_back(std::max(record.iterations,0));
+  }
+  else
+  {
+    m.iterations[m.next] = std::max(record.iterations,0);
+  }
+  m.next = (m.next + 1) % window_size_;
+
+  m.num_plans++;
+  m.failures[record.failure]++;
+  m.last_failure = record.failure;
+  if(record.iterations >= 0)
+  {
+    m.termination_reasons[stomp_core::TerminationReasons::getName(record.termination_reason)]++;
+  }
+}
+
+void PlannerMetrics::getStatuses(std::vector<diagnostic_msgs::DiagnosticStatus>& statuses) const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  statuses.clear();
+  std::vector<double> sorted;
+  for(const auto& entry : groups_)
+  {
+    const GroupMetrics& m = entry.second;
+    diagnostic_msgs::DiagnosticStatus status;
+    status.name = "stomp_planner: " + entry.first;
+    status.hardware_id = entry.first;
+
+    std::size_t num_failed = m.num_plans - m.failures[PlanFailures::NONE];
+    status.level = m.last_failure == PlanFailures::NONE ? diagnostic_msgs::DiagnosticStatus::OK :
+        diagnostic_msgs::DiagnosticStatus::WARN;
+    std::ostringstream message;
+    message << m.num_plans << " plans, " << num_failed << " failed";
+    status.message = message.str();
+    status.values.push_back(keyValue("plans",m.num_plans));
+    status.values.push_back(keyValue("window",m.iterations.size()));
+
+    // latency percentiles over the window, in seconds
+    for(int p = 0; p < PlanPhases::NUM_PHASES; p++)
+    {
+      sorted = m.durations[p];
+      std::sort(sorted.begin(),sorted.end());
+      std::string name = PHASE_NAMES[p];
+      status.values.push_back(keyValue(name + " p50",percentile(sorted,0.5)));
+      status.values.push_back(keyValue(name + " p90",percentile(sorted,0.9)));
+      status.values.push_back(keyValue(name + " p99",percentile(sorted,0.99)));
+      status.values.push_back(keyValue(name + " max",sorted.back()));
+    }
+
+    sorted = m.iterations;
+    std::sort(sorted.begin(),sorted.end());
+    status.values.push_back(keyValue("iterations p50",percentile(sorted,0.5)));
+    status.values.push_back(keyValue("iterations p90",percentile(sorted,0.9)));
+    status.values.push_back(keyValue("iterations max",sorted.back()));
+
+    // counts since the creation
+    for(int f = PlanFailures::NONE + 1; f < PlanFailures::NUM_FAILURES; f++)
+    {
+      status.values.push_back(keyValue(std::string("failures ") + FAILURE_NAMES[f],m.failures[f]));
+    }
+    for(const auto& reason : m.termination_reasons)
+    {
+      status.values.push_back(keyValue("termination " + reason.first,reason.second));
+    }
+
+    statuses.push_back(status);
+  }
+}
+
+} /* namespace utils */
+} /* namespace stomp_moveit */
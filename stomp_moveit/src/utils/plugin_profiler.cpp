@@ -0,0 +1,147 @@
+/**
+ * @file plugin_profiler.cpp
+ * @brief Measures the time spent in each STOMP plugin
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stomp_moveit/utils/plugin_profiler.h>
+#include <stomp_core/thread_pool.h>
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+/**
+ * @namespace stomp_moveit
+ */
+namespace stomp_moveit
+{
+
+/**
+ * @namespace utils
+ */
+namespace utils
+{
+
+PluginProfiler::PluginProfiler()
+{
+
+}
+
+void PluginProfiler::initialize(const std::vector<std::string>& names,std::size_t num_workers)
+{
+  Accumulator empty;
+  empty.calls = 0;
+  empty.total = Clock::duration::zero();
+  empty.histogram.fill(0);
+
+  names_ = names;
+  accumulators_.assign(std::max<std::size_t>(num_workers,1),std::vector<Accumulator>(names.size(),empty));
+}
+
+void PluginProfiler::record(std::size_t plugin,Clock::duration elapsed)
+{
+  std::size_t worker = stomp_core::ThreadPool::getWorkerIndex();
+  if(worker >= accumulators_.size() || plugin >= names_.size())
+  {
+    return;
+  }
+
+  Accumulator& a = accumulators_[worker][plugin];
+  a.calls++;
+  a.total += elapsed;
+
+  double ns = std::chrono::duration<double,std::nano>(elapsed).count();
+  int bucket = ns <= 1.0 ? 0 : static_cast<int>(BUCKETS_PER_OCTAVE*std::log2(ns));
+  a.histogram[std::min(bucket,NUM_BUCKETS - 1)]++;
+}
+
+std::vector<PluginProfiler::Statistics> PluginProfiler::getStatistics() const
+{
+  std::vector<Statistics> stats;
+  stats.reserve(names_.size());
+  for(auto p = 0u; p < names_.size(); p++)
+  {
+    std::size_t calls = 0;
+    Clock::duration total = Clock::duration::zero();
+    std::array<std::size_t,NUM_BUCKETS> histogram;
+    histogram.fill(0);
+    for(const auto& worker : accumulators_)
+    {
+      calls += worker[p].calls;
+      total += worker[p].total;
+      for(auto b = 0u; b < NUM_BUCKETS; b++)
+      {
+        histogram[b] += worker[p].histogram[b];
+      }
+    }
+
+    // a percentile is reported as the upper edge of the bucket that holds it
+    auto percentile = [&](double q)
+    {
+      std::size_t count = 0;
+      for(auto b = 0u; b < NUM_BUCKETS; b++)
+      {
+        count += histogram[b];
+        if(count > 0 && count >= q*calls)
+        {
+          return 1e-9*std::exp2(static_cast<double>(b + 1)/BUCKETS_PER_OCTAVE);
+        }
+      }
+      return 0.0;
+    };
+
+    Statistics s;
+    s.name = names_[p];
+    s.calls = calls;
+    s.total_time = std::chrono::duration<double>(total).count();
+    s.mean_time = calls > 0 ? s.total_time/calls : 0.0;
+    s.p50_time = percentile(0.5);
+    s.p90_time = percentile(0.9);
+    s.p99_time = percentile(0.99);
+    stats.push_back(s);
+  }
+
+  return stats;
+}
+
+std::string PluginProfiler::toString() const
+{
+  std::vector<Statistics> stats = getStatistics();
+  double total_time = 0.0;
+  for(const auto& s : stats)
+  {
+    total_time += s.total_time;
+  }
+
+  std::stringstream ss;
+  for(const auto& s : stats)
+  {
+    ss << s.name << ": " << s.calls << " calls, " << s.total_time << " s ("
+       << (total_time > 0.0 ? 100.0*s.total_time/total_time : 0.0) << "%), mean " << 1e3*s.mean_time
+       << " ms, p50 " << 1e3*s.p50_time << " ms, p90 " << 1e3*s.p90_time << " ms, p99 " << 1e3*s.p99_time << " ms\n";
+  }
+  return ss.str();
+}
+
+} /* namespace utils */
+} /* namespace stomp_moveit */
@@ -26,6 +26,7 @@
 
 #include <stomp_moveit/utils/polynomial.h>
 #include <ros/console.h>
+#include <Eigen/LU>
 
 /**
  * @namespace stomp_moveit
@@ -146,6 +147,51 @@ PolyFitResults polyFit(const PolyFitRequest &request)
   }
 }
 
+bool EndpointPolynomialFit::prepare(int num_timesteps, int poly_order)
+{
+  // Same system as polyFit with the first and last values as position constraints, the right hand side is a linear
+  // map of the values so the system is solved against that map once.
+  //  |p| - | 2*A*A', C |^-1 * | 2*A | * y
+  //  |z| - |     C', 0 |      |   S |
+  num_timesteps_ = 0;
+  coefficients_.resize(0, 0);
+  if (num_timesteps < 2 || poly_order < 1)
+    return false;
+
+  int num_r = poly_order + 1;
+  Eigen::VectorXd domain_vals;
+  domain_vals.setLinSpaced(num_timesteps, 0, 1);
+  fillVandermondeMatrix(domain_vals.array(), poly_order, vandermonde_);
+
+  Eigen::MatrixXd mat = Eigen::MatrixXd::Zero(num_r + 2, num_r + 2);
+  mat.topLeftCorner(num_r, num_r) = 2 * vandermonde_ * vandermonde_.transpose();
+  mat.block(0, num_r, num_r, 1) = vandermonde_.col(0);
+  mat.block(0, num_r + 1, num_r, 1) = vandermonde_.col(num_timesteps - 1);
+  mat.bottomLeftCorner(2, num_r) = mat.topRightCorner(num_r, 2).transpose();
+
+  Eigen::MatrixXd rhs = Eigen::MatrixXd::Zero(num_r + 2, num_timesteps);
+  rhs.topRows(num_r) = 2 * vandermonde_;
+  rhs(num_r, 0) = 1.0;
+  rhs(num_r + 1, num_timesteps - 1) = 1.0;
+
+  coefficients_ = mat.lu().solve(rhs).topRows(num_r).transpose();
+  if (!coefficients_.allFinite())
+  {
+    coefficients_.resize(0, 0);
+    return false;
+  }
+
+  num_timesteps_ = num_timesteps;
+  poly_order_ = poly_order;
+  return true;
+}
+
+void EndpointPolynomialFit::fit(Eigen::MatrixXd& values) const
+{
+  p_.noalias() = values * coefficients_;
+  values.noalias() = p_ * vandermonde_;
+}
+
 void fillVandermondeMatrix(const Eigen::ArrayXd &domain_vals, const int &order, Eigen::MatrixXd &v)
 {
   v = Eigen::MatrixXd::Ones(order+1, domain_vals.size());
@@ -239,6 +285,46 @@ bool applyPolynomialSmoothing(moveit::core::RobotModelConstPtr robot_model, cons
   return true;
 }
 
+bool applyPolynomialSmoothing(moveit::core::RobotModelConstPtr robot_model, const std::string& group_name, Eigen::MatrixXd& parameters,
+                              const EndpointPolynomialFit& fit, double joint_limit_margin)
+{
+  using namespace moveit::core;
+
+  const std::vector<const JointModel*> &joint_models = robot_model->getJointModelGroup(group_name)->getActiveJointModels();
+  if (fit.getNumTimesteps() != parameters.cols())
+  {
+    ROS_ERROR("Smoother, the polynomial fit was prepared for %i timesteps instead of %i", fit.getNumTimesteps(), static_cast<int>(parameters.cols()));
+    return false;
+  }
+
+  fit.fit(parameters);
+  for(auto r = 0; r < parameters.rows(); r++)
+  {
+    if (!parameters.row(r).allFinite())
+    {
+      ROS_ERROR("Smoother, joint %s polynomial fit failed!", joint_models[r]->getName().c_str());
+      return false;
+    }
+
+    for(auto i = 0; i < parameters.cols(); ++i)
+      joint_models[r]->enforcePositionBounds(&parameters(r, i));
+
+    //  Now check if joint trajectory is within joint limits
+    double min = parameters.row(r).minCoeff();
+    double max = parameters.row(r).maxCoeff();
+    bool finished = joint_models[r]->satisfiesPositionBounds(&min, joint_limit_margin) &&
+                    joint_models[r]->satisfiesPositionBounds(&max, joint_limit_margin);
+
+    if(!finished)
+    {
+      ROS_ERROR("Smoother, joint %s not within limits, Min: %f, Max: %f", joint_models[r]->getName().c_str(), min, max);
+      return false;
+    }
+  }
+
+  return true;
+}
+
 } // end of namespace smoothing
 } // end of namespace utils
 } // end of namespace stomp_moveit
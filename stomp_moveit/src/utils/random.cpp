@@ -0,0 +1,158 @@
+/**
+ * @file random.cpp
+ * @brief A fast pseudo random number generator used for sampling noise
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmath>
+#include <cstdlib>
+#include <stomp_moveit/utils/random.h>
+
+namespace stomp_moveit
+{
+namespace utils
+{
+
+static const int ZIGGURAT_LAYERS = 128;              /**< The number of layers of the ziggurat */
+static const double ZIGGURAT_R = 3.442619855899;     /**< The start of the tail of the distribution */
+static const double ZIGGURAT_V = 9.91256303526217e-3;/**< The area of each layer */
+
+/**
+ * @brief The tables of the Marsaglia and Tsang ziggurat method for the standard normal distribution
+ */
+struct ZigguratTables
+{
+  std::array<std::uint32_t,ZIGGURAT_LAYERS> k;   /**< Acceptance thresholds of each layer */
+  std::array<double,ZIGGURAT_LAYERS> w;          /**< Scale of each layer */
+  std::array<double,ZIGGURAT_LAYERS> f;          /**< Density at the edge of each layer */
+
+  ZigguratTables()
+  {
+    const double m = 2147483648.0;
+    double d = ZIGGURAT_R;
+    double t = d;
+    double q = ZIGGURAT_V / std::exp(-0.5 * d * d);
+
+    k[0] = static_cast<std::uint32_t>((d / q) * m);
+    k[1] = 0;
+    w[0] = q / m;
+    w[ZIGGURAT_LAYERS - 1] = d / m;
+    f[0] = 1.0;
+    f[ZIGGURAT_LAYERS - 1] = std::exp(-0.5 * d * d);
+    for(int i = ZIGGURAT_LAYERS - 2; i >= 1; i--)
+    {
+      d = std::sqrt(-2.0 * std::log(ZIGGURAT_V / d + std::exp(-0.5 * d * d)));
+      k[i + 1] = static_cast<std::uint32_t>((d / t) * m);
+      t = d;
+      f[i] = std::exp(-0.5 * d * d);
+      w[i] = d / m;
+    }
+  }
+};
+
+/**
+ * @brief Returns the ziggurat tables, computed the first time they are requested
+ */
+static const ZigguratTables& getZigguratTables()
+{
+  static const ZigguratTables tables;
+  return tables;
+}
+
+RandomNumberGenerator::RandomNumberGenerator(std::uint64_t seed)
+{
+  this->seed(seed);
+}
+
+void RandomNumberGenerator::seed(std::uint64_t seed)
+{
+  // splitmix64, it never produces an all zero state
+  for(auto& s : state_)
+  {
+    s = mix(seed += 0x9e3779b97f4a7c15ULL);
+  }
+}
+
+void RandomNumberGenerator::seed(std::uint64_t seed, std::uint64_t iteration, std::uint64_t stream)
+{
+  // each component goes through the mixing function so that nearby keys produce unrelated states
+  std::uint64_t key = mix(seed + 0x9e3779b97f4a7c15ULL);
+  key = mix(key ^ mix(iteration + 0x6a09e667f3bcc909ULL));
+  key = mix(key ^ mix(stream + 0xbb67ae8584caa73bULL));
+  this->seed(key);
+}
+
+void RandomNumberGenerator::fillStandardNormal(Eigen::Ref<Eigen::ArrayXd> output)
+{
+  const ZigguratTables& z = getZigguratTables();
+  for(Eigen::Index i = 0; i < output.size(); i++)
+  {
+    // the layer and the value come from different bits of the same draw
+    std::uint64_t bits = (*this)();
+    int layer = bits & 0x7f;
+    std::int32_t value = static_cast<std::int32_t>(bits >> 32);
+    if(static_cast<std::uint32_t>(std::abs(static_cast<std::int64_t>(value))) < z.k[layer])
+    {
+      output(i) = value * z.w[layer];
+      continue;
+    }
+
+    // slow path, taken for less than 2% of the values
+    double x;
+    while(true)
+    {
+      x = value * z.w[layer];
+      if(layer == 0)
+      {
+        // sampling from the tail
+        double y;
+        do
+        {
+          x = -std::log(uniform()) / ZIGGURAT_R;
+          y = -std::log(uniform());
+        }
+        while(y + y < x * x);
+        x = value > 0 ? ZIGGURAT_R + x : -ZIGGURAT_R - x;
+        break;
+      }
+
+      if(z.f[layer] + uniform()*(z.f[layer - 1] - z.f[layer]) < std::exp(-0.5 * x * x))
+      {
+        break;
+      }
+
+      bits = (*this)();
+      layer = bits & 0x7f;
+      value = static_cast<std::int32_t>(bits >> 32);
+      if(static_cast<std::uint32_t>(std::abs(static_cast<std::int64_t>(value))) < z.k[layer])
+      {
+        x = value * z.w[layer];
+        break;
+      }
+    }
+    output(i) = x;
+  }
+}
+
+} /* namespace utils */
+} /* namespace stomp_moveit */
@@ -0,0 +1,103 @@
+/**
+ * @file rollout_states.cpp
+ * @brief The robot states of the timesteps of a rollout shared by the cost functions
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <numeric>
+#include <stomp_moveit/utils/rollout_states.h>
+
+/**
+ * @namespace stomp_moveit
+ */
+namespace stomp_moveit
+{
+
+/**
+ * @namespace utils
+ */
+namespace utils
+{
+
+RolloutStates::RolloutStates():
+    joint_group_(nullptr)
+{
+
+}
+
+bool RolloutStates::initialize(const moveit::core::RobotState& reference_state, const std::string& group_name,
+                               std::size_t num_timesteps)
+{
+  joint_group_ = reference_state.getJointModelGroup(group_name);
+  if(!joint_group_)
+  {
+    states_.clear();
+    return false;
+  }
+
+  if(states_.size() != num_timesteps ||
+      (!states_.empty() && states_.front()->getRobotModel() != reference_state.getRobotModel()))
+  {
+    states_.clear();
+    states_.reserve(num_timesteps);
+    for(auto t = 0u; t < num_timesteps; t++)
+    {
+      states_.push_back(moveit::core::RobotStatePtr(new moveit::core::RobotState(reference_state)));
+    }
+  }
+  else
+  {
+    for(auto& s : states_)
+    {
+      *s = reference_state;
+    }
+  }
+
+  joint_values_.resize(joint_group_->getVariableCount(),num_timesteps);
+  valid_.assign(num_timesteps,0);
+  num_updates_.assign(num_timesteps,0);
+  return true;
+}
+
+const moveit::core::RobotState& RolloutStates::getState(std::size_t t, const Eigen::Ref<const Eigen::VectorXd>& joint_values)
+{
+  moveit::core::RobotState& state = *states_[t];
+  if(!valid_[t] || joint_values_.col(t) != joint_values)
+  {
+    state.setJointGroupPositions(joint_group_,joint_values.data());
+    state.update();
+    joint_values_.col(t) = joint_values;
+    valid_[t] = 1;
+    num_updates_[t]++;
+  }
+
+  return state;
+}
+
+std::size_t RolloutStates::getNumUpdates() const
+{
+  return std::accumulate(num_updates_.begin(),num_updates_.end(),std::size_t(0));
+}
+
+} /* namespace utils */
+} /* namespace stomp_moveit */
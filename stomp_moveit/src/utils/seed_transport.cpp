@@ -0,0 +1,307 @@
+/**
+ * @file seed_transport.cpp
+ * @brief Passes seed trajectories to the planner by reference instead of serializing them into the request
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stomp_moveit/utils/seed_transport.h>
+#include <ros/console.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const std::string LOCAL_SCHEME = "local:";
+static const std::string SHARED_SCHEME = "shm:";
+static const char SEED_MAGIC[8] = {'S','T','O','M','P','S','E','D'};
+static const std::uint32_t SEED_VERSION = 1;
+
+namespace
+{
+
+/** @brief The header of a shared memory seed, followed by the joint values in column major order */
+struct SharedSeedHeader
+{
+  char magic[8];                  /**< @brief Identifies a seed, written last */
+  std::uint32_t version;          /**< @brief The version of the layout */
+  std::uint32_t rows;             /**< @brief The number of joints */
+  std::uint64_t cols;             /**< @brief The number of points */
+};
+
+/** @brief The seeds registered with the process */
+struct LocalSeedTable
+{
+  std::mutex mutex;                                                          /**< @brief Protects the table */
+  std::uint64_t next_handle = 1;                                             /**< @brief The handle of the next seed */
+  std::map<std::uint64_t, std::shared_ptr<const Eigen::MatrixXd> > seeds;    /**< @brief The seeds by handle */
+};
+
+LocalSeedTable& getLocalSeedTable()
+{
+  static LocalSeedTable table;
+  return table;
+}
+
+/**
+ * @brief Splits a reference into its scheme specific part
+ * @param reference The reference
+ * @param scheme    The scheme
+ * @param value     Returns the part following the scheme
+ * @return True if the reference has the scheme, otherwise false.
+ */
+bool parseReference(const std::string& reference, const std::string& scheme, std::string& value)
+{
+  const std::string& prefix = stomp_moveit::utils::seeds::SEED_REFERENCE_PREFIX;
+  if(reference.compare(0,prefix.size(),prefix) != 0 ||
+     reference.compare(prefix.size(),scheme.size(),scheme) != 0)
+  {
+    return false;
+  }
+
+  value = reference.substr(prefix.size() + scheme.size());
+  return !value.empty();
+}
+
+/**
+ * @brief Copies a seed from a shared memory object
+ * @param name        The name of the object
+ * @param num_joints  The expected number of rows of the seed
+ * @param parameters  Returns the seed
+ * @return True if the object holds a seed with 'num_joints' rows, otherwise false.
+ */
+bool readSharedSeed(const std::string& name, std::size_t num_joints, Eigen::MatrixXd& parameters)
+{
+  int fd = shm_open(("/" + name).c_str(),O_RDONLY,0);
+  if(fd < 0)
+  {
+    ROS_ERROR("Failed to open the shared memory seed '%s': %s",name.c_str(),std::strerror(errno));
+    return false;
+  }
+
+  struct stat info;
+  if(fstat(fd,&info) != 0 || static_cast<std::size_t>(info.st_size) < sizeof(SharedSeedHeader))
+  {
+    ROS_ERROR("The shared memory seed '%s' is truncated",name.c_str());
+    close(fd);
+    return false;
+  }
+
+  std::size_t size = info.st_size;
+  void* data = mmap(nullptr,size,PROT_READ,MAP_SHARED,fd,0);
+  close(fd);
+  if(data == MAP_FAILED)
+  {
+    ROS_ERROR("Failed to map the shared memory seed '%s': %s",name.c_str(),std::strerror(errno));
+    return false;
+  }
+
+  // the dimensions are checked by division, their product may overflow
+  const SharedSeedHeader* header = static_cast<const SharedSeedHeader*>(data);
+  bool valid = std::memcmp(header->magic,SEED_MAGIC,sizeof(SEED_MAGIC)) == 0 && header->version == SEED_VERSION &&
+      header->rows != 0 && header->cols <= (size - sizeof(SharedSeedHeader))/(sizeof(double)*header->rows);
+  if(!valid)
+  {
+    ROS_ERROR("The shared memory object '%s' does not hold a valid seed",name.c_str());
+  }
+  else if(header->rows != num_joints)
+  {
+    ROS_ERROR("The shared memory seed '%s' has %u joints, expected %lu",name.c_str(),header->rows,num_joints);
+    valid = false;
+  }
+  else
+  {
+    const double* values = reinterpret_cast<const double*>(header + 1);
+    parameters = Eigen::Map<const Eigen::MatrixXd>(values,header->rows,header->cols);
+  }
+
+  munmap(data,size);
+  return valid;
+}
+
+}
+
+/**
+ * @namespace stomp_moveit
+ */
+namespace stomp_moveit
+{
+
+/**
+ * @namespace utils
+ */
+namespace utils
+{
+
+/**
+ * @namespace seeds
+ */
+namespace seeds
+{
+
+std::string registerLocalSeed(std::shared_ptr<const Eigen::MatrixXd> parameters)
+{
+  LocalSeedTable& table = getLocalSeedTable();
+  std::lock_guard<std::mutex> lock(table.mutex);
+  std::uint64_t handle = table.next_handle++;
+  table.seeds[handle] = parameters;
+  return SEED_REFERENCE_PREFIX + LOCAL_SCHEME + std::to_string(handle);
+}
+
+void releaseLocalSeed(const std::string& reference)
+{
+  std::string value;
+  if(!parseReference(reference,LOCAL_SCHEME,value))
+  {
+    return;
+  }
+
+  LocalSeedTable& table = getLocalSeedTable();
+  std::lock_guard<std::mutex> lock(table.mutex);
+  table.seeds.erase(std::strtoull(value.c_str(),nullptr,10));
+}
+
+bool writeSharedSeed(const std::string& name, const Eigen::MatrixXd& parameters, std::string& reference)
+{
+  if(name.empty() || name.find('/') != std::string::npos)
+  {
+    ROS_ERROR("The shared memory seed name '%s' is invalid",name.c_str());
+    return false;
+  }
+
+  int fd = shm_open(("/" + name).c_str(),O_CREAT | O_RDWR | O_TRUNC,0644);
+  if(fd < 0)
+  {
+    ROS_ERROR("Failed to create the shared memory seed '%s': %s",name.c_str(),std::strerror(errno));
+    return false;
+  }
+
+  std::size_t size = sizeof(SharedSeedHeader) + sizeof(double)*parameters.size();
+  if(ftruncate(fd,size) != 0)
+  {
+    ROS_ERROR("Failed to size the shared memory seed '%s': %s",name.c_str(),std::strerror(errno));
+    close(fd);
+    return false;
+  }
+
+  void* data = mmap(nullptr,size,PROT_READ | PROT_WRITE,MAP_SHARED,fd,0);
+  close(fd);
+  if(data == MAP_FAILED)
+  {
+    ROS_ERROR("Failed to map the shared memory seed '%s': %s",name.c_str(),std::strerror(errno));
+    return false;
+  }
+
+  // the magic is written last so that a reader never accepts a partially written seed
+  SharedSeedHeader* header = static_cast<SharedSeedHeader*>(data);
+  header->version = SEED_VERSION;
+  header->rows = parameters.rows();
+  header->cols = parameters.cols();
+  Eigen::Map<Eigen::MatrixXd>(reinterpret_cast<double*>(header + 1),parameters.rows(),parameters.cols()) = parameters;
+  __sync_synchronize();
+  std::memcpy(header->magic,SEED_MAGIC,sizeof(SEED_MAGIC));
+  munmap(data,size);
+
+  reference = SEED_REFERENCE_PREFIX + SHARED_SCHEME + name;
+  return true;
+}
+
+void removeSharedSeed(const std::string& name)
+{
+  shm_unlink(("/" + name).c_str());
+}
+
+moveit_msgs::TrajectoryConstraints encodeSeedReference(const std::string& reference)
+{
+  moveit_msgs::TrajectoryConstraints res;
+  res.constraints.resize(1);
+  res.constraints.front().name = reference;
+  return res;
+}
+
+bool decodeSeedReference(const moveit_msgs::TrajectoryConstraints& constraints, std::string& reference)
+{
+  if(constraints.constraints.size() != 1)
+  {
+    return false;
+  }
+
+  const moveit_msgs::Constraints& c = constraints.constraints.front();
+  if(!c.joint_constraints.empty() || c.name.compare(0,SEED_REFERENCE_PREFIX.size(),SEED_REFERENCE_PREFIX) != 0)
+  {
+    return false;
+  }
+
+  reference = c.name;
+  return true;
+}
+
+bool readSeed(const std::string& reference, std::size_t num_joints, Eigen::MatrixXd& parameters)
+{
+  std::string value;
+  if(parseReference(reference,SHARED_SCHEME,value))
+  {
+    return readSharedSeed(value,num_joints,parameters);
+  }
+
+  if(!parseReference(reference,LOCAL_SCHEME,value))
+  {
+    ROS_ERROR("Unknown seed reference '%s'",reference.c_str());
+    return false;
+  }
+
+  std::shared_ptr<const Eigen::MatrixXd> seed;
+  {
+    LocalSeedTable& table = getLocalSeedTable();
+    std::lock_guard<std::mutex> lock(table.mutex);
+    auto it = table.seeds.find(std::strtoull(value.c_str(),nullptr,10));
+    if(it != table.seeds.end())
+    {
+      seed = it->second;
+    }
+  }
+
+  if(!seed)
+  {
+    ROS_ERROR("The local seed '%s' is not registered",reference.c_str());
+    return false;
+  }
+
+  if(static_cast<std::size_t>(seed->rows()) != num_joints)
+  {
+    ROS_ERROR("The local seed '%s' has %i joints, expected %lu",reference.c_str(),static_cast<int>(seed->rows()),
+              num_joints);
+    return false;
+  }
+
+  parameters = *seed;
+  return true;
+}
+
+} /* namespace seeds */
+} /* namespace utils */
+} /* namespace stomp_moveit */
@@ -0,0 +1,143 @@
+/**
+ * @file time_parameterization.cpp
+ * @brief Fast time parameterization of the evenly spaced STOMP trajectories
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stomp_moveit/utils/time_parameterization.h>
+#include <stomp_core/utils.h>
+#include <ros/console.h>
+#include <cmath>
+#include <limits>
+
+static const double MIN_TIME_SCALE = 1e-6; /**< Time scale below which the trajectory is considered to be at rest */
+
+/**
+ * @namespace stomp_moveit
+ */
+namespace stomp_moveit
+{
+
+/**
+ * @namespace utils
+ */
+namespace utils
+{
+
+/**
+ * @namespace time_parameterization
+ */
+namespace time_parameterization
+{
+
+bool computeUniformTimeScaling(const moveit::core::JointModelGroup* group,const Eigen::MatrixXd& parameters,
+                               double delta_t,double velocity_scaling,double acceleration_scaling,
+                               Eigen::MatrixXd& velocities,Eigen::MatrixXd& accelerations,double& timestep)
+{
+  using namespace Eigen;
+  using namespace stomp_core;
+
+  const std::vector<const moveit::core::JointModel*>& joint_models = group->getActiveJointModels();
+  if(joint_models.size() != parameters.rows() || parameters.cols() < FINITE_DIFF_RULE_LENGTH || delta_t <= 0)
+  {
+    ROS_ERROR("Unable to time a trajectory of %i x %i points for the group %s",int(parameters.rows()),
+              int(parameters.cols()),group->getName().c_str());
+    return false;
+  }
+
+  velocity_scaling = (velocity_scaling > 0 && velocity_scaling <= 1) ? velocity_scaling : 1.0;
+  acceleration_scaling = (acceleration_scaling > 0 && acceleration_scaling <= 1) ? acceleration_scaling : 1.0;
+
+  // the derivatives at 'delta_t', they scale by 1/s and 1/s^2 when the timestep is stretched by s
+  differentiate(parameters,DerivativeOrders::STOMP_VELOCITY,delta_t,velocities);
+  differentiate(parameters,DerivativeOrders::STOMP_ACCELERATION,delta_t,accelerations);
+
+  // the smallest stretch that satisfies every limit, the trajectory is sped up when all joints are below their limits
+  double scale = 0.0;
+  for(auto d = 0u; d < joint_models.size(); d++)
+  {
+    const moveit::core::VariableBounds& bounds = joint_models[d]->getVariableBounds()[0];
+    if(bounds.velocity_bounded_ && bounds.max_velocity_ > 0)
+    {
+      double max_velocity = velocity_scaling*bounds.max_velocity_;
+      scale = std::max(scale,velocities.row(d).cwiseAbs().maxCoeff()/max_velocity);
+    }
+
+    if(bounds.acceleration_bounded_ && bounds.max_acceleration_ > 0)
+    {
+      double max_acceleration = acceleration_scaling*bounds.max_acceleration_;
+      scale = std::max(scale,std::sqrt(accelerations.row(d).cwiseAbs().maxCoeff()/max_acceleration));
+    }
+  }
+
+  if(scale < MIN_TIME_SCALE)
+  {
+    scale = 1.0; // nothing moves or nothing is bounded, the optimization timestep is kept
+  }
+
+  velocities /= scale;
+  accelerations /= scale*scale;
+  velocities.col(0).setZero();
+  velocities.rightCols(1).setZero();
+  accelerations.col(0).setZero();
+  accelerations.rightCols(1).setZero();
+
+  timestep = scale*delta_t;
+  return true;
+}
+
+bool computeUniformTimeScaling(const moveit::core::JointModelGroup* group,const Eigen::MatrixXd& parameters,
+                               double delta_t,double velocity_scaling,double acceleration_scaling,
+                               trajectory_msgs::JointTrajectory& trajectory)
+{
+  using namespace Eigen;
+
+  MatrixXd velocities, accelerations;
+  double timestep;
+  if(!computeUniformTimeScaling(group,parameters,delta_t,velocity_scaling,acceleration_scaling,
+                                velocities,accelerations,timestep))
+  {
+    return false;
+  }
+
+  // filling the trajectory
+  trajectory.joint_names = group->getActiveJointModelNames();
+  trajectory.points.resize(parameters.cols());
+  for(auto t = 0u; t < parameters.cols(); t++)
+  {
+    trajectory_msgs::JointTrajectoryPoint& point = trajectory.points[t];
+    point.positions.resize(parameters.rows());
+    point.velocities.resize(parameters.rows());
+    point.accelerations.resize(parameters.rows());
+    VectorXd::Map(point.positions.data(),parameters.rows()) = parameters.col(t);
+    VectorXd::Map(point.velocities.data(),parameters.rows()) = velocities.col(t);
+    VectorXd::Map(point.accelerations.data(),parameters.rows()) = accelerations.col(t);
+    point.time_from_start = ros::Duration(t*timestep);
+  }
+
+  return true;
+}
+
+} // end of namespace time_parameterization
+} // end of namespace utils
+} // end of namespace stomp_moveit
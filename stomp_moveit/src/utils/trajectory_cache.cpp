@@ -0,0 +1,147 @@
+/**
+ * @file trajectory_cache.cpp
+ * @brief A cache of optimized trajectories used to warm start the planner
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stomp_moveit/utils/trajectory_cache.h>
+#include <limits>
+
+/**
+ * @namespace stomp_moveit
+ */
+namespace stomp_moveit
+{
+
+/**
+ * @namespace utils
+ */
+namespace utils
+{
+
+TrajectoryCache::TrajectoryCache(std::size_t max_entries, double tolerance):
+    max_entries_(max_entries),
+    tolerance_(tolerance),
+    next_entry_(0)
+{
+
+}
+
+void TrajectoryCache::configure(std::size_t max_entries, double tolerance)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  max_entries_ = max_entries;
+  tolerance_ = tolerance;
+  next_entry_ = 0;
+  entries_.clear();
+}
+
+void TrajectoryCache::insert(const Eigen::MatrixXd& parameters)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  if(max_entries_ == 0 || parameters.cols() < 2)
+  {
+    return;
+  }
+
+  // replacing a trajectory for nearly the same motion
+  double distance;
+  int nearest = findNearest(parameters.leftCols(1),parameters.rightCols(1),distance);
+  if(nearest >= 0 && distance <= tolerance_)
+  {
+    entries_[nearest] = parameters;
+    return;
+  }
+
+  if(entries_.size() < max_entries_)
+  {
+    entries_.push_back(parameters);
+    return;
+  }
+
+  // replacing the oldest trajectory
+  entries_[next_entry_] = parameters;
+  next_entry_ = (next_entry_ + 1) % max_entries_;
+}
+
+bool TrajectoryCache::lookup(const Eigen::VectorXd& start, const Eigen::VectorXd& goal, Eigen::MatrixXd& parameters) const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  double distance;
+  int nearest = findNearest(start,goal,distance);
+  if(nearest < 0 || distance > tolerance_)
+  {
+    return false;
+  }
+
+  // moving the end points onto the requested start and goal
+  parameters = entries_[nearest];
+  blendEndPoints(start,goal,parameters);
+
+  return true;
+}
+
+void TrajectoryCache::clear()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  next_entry_ = 0;
+  entries_.clear();
+}
+
+void TrajectoryCache::blendEndPoints(const Eigen::VectorXd& start, const Eigen::VectorXd& goal,
+                                     Eigen::MatrixXd& parameters)
+{
+  Eigen::VectorXd start_offset = start - parameters.col(0);
+  Eigen::VectorXd goal_offset = goal - parameters.col(parameters.cols() - 1);
+  for(auto t = 0u; t < parameters.cols(); t++)
+  {
+    double s = static_cast<double>(t)/static_cast<double>(parameters.cols() - 1);
+    parameters.col(t) += (1.0 - s)*start_offset + s*goal_offset;
+  }
+}
+
+int TrajectoryCache::findNearest(const Eigen::VectorXd& start, const Eigen::VectorXd& goal, double& distance) const
+{
+  int nearest = -1;
+  distance = std::numeric_limits<double>::max();
+  for(auto i = 0u; i < entries_.size(); i++)
+  {
+    const Eigen::MatrixXd& entry = entries_[i];
+    if(entry.rows() != start.size() || entry.rows() != goal.size())
+    {
+      continue;
+    }
+
+    double d = (entry.col(0) - start).cwiseAbs().sum() + (entry.col(entry.cols() - 1) - goal).cwiseAbs().sum();
+    if(d < distance)
+    {
+      distance = d;
+      nearest = i;
+    }
+  }
+
+  return nearest;
+}
+
+} /* namespace utils */
+} /* namespace stomp_moveit */
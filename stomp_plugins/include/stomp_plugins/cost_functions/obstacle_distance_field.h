@@ -0,0 +1,177 @@
+/**
+ * @file obstacle_distance_field.h
+ * @brief This defines a cost function that evaluates the robot against a signed distance field of the world.
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef INDUSTRIAL_MOVEIT_STOMP_PLUGINS_INCLUDE_STOMP_PLUGINS_COST_FUNCTIONS_OBSTACLE_DISTANCE_FIELD_H_
+#define INDUSTRIAL_MOVEIT_STOMP_PLUGINS_INCLUDE_STOMP_PLUGINS_COST_FUNCTIONS_OBSTACLE_DISTANCE_FIELD_H_
+
+#include <moveit/robot_model/robot_model.h>
+#include <industrial_collision_detection/collision_detection/robot_sphere_model.h>
+#include <industrial_collision_detection/collision_detection/world_distance_field.h>
+#include "stomp_moveit/cost_functions/stomp_cost_function.h"
+
+namespace stomp_moveit
+{
+namespace cost_functions
+{
+
+/**
+ * @class stomp_moveit::cost_functions::ObstacleDistanceField
+ * @brief Assigns a cost value to each robot state from the distance between the obstacles and the sets of spheres that
+ *        cover the collision shapes of the robot.  The distances are looked up in a signed distance field of the world
+ *        and an exact distance query is only made for the states that come closer than a margin to the obstacles.
+ *
+ * @par Examples:
+ * All examples are located here @ref stomp_plugins_examples
+ */
+class ObstacleDistanceField: public StompCostFunction
+{
+public:
+  ObstacleDistanceField();
+  virtual ~ObstacleDistanceField();
+
+  /**
+   * @brief Initializes and configures the Cost Function.
+   * @param robot_model_ptr A pointer to the robot model.
+   * @param group_name      The designated planning group.
+   * @param config          The configuration data.  Usually loaded from the ros parameter server
+   * @return true if succeeded, false otherwise.
+   */
+  virtual bool initialize(moveit::core::RobotModelConstPtr robot_model_ptr,
+                          const std::string& group_name,XmlRpc::XmlRpcValue& config) override;
+
+  /**
+   * @brief Sets internal members of the plugin from the configuration data.
+   * @param config  The configuration data .  Usually loaded from the ros parameter server
+   * @return  true if succeeded, false otherwise.
+   */
+  virtual bool configure(const XmlRpc::XmlRpcValue& config) override;
+
+  /**
+   * @brief Stores the planning details and gets the distance field of the planning scene world.  The field kept by the
+   *        industrial collision world is used when available, otherwise one is built from the world objects.
+   * @param planning_scene  A smart pointer to the planning scene
+   * @param req                 The motion planning request
+   * @param config              The  Stomp configuration.
+   * @param error_code          Moveit error code.
+   * @return  true if succeeded, false otherwise.
+   */
+  virtual bool setMotionPlanRequest(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                   const moveit_msgs::MotionPlanRequest &req,
+                   const stomp_core::StompConfiguration &config,
+                   moveit_msgs::MoveItErrorCodes& error_code) override;
+
+  /**
+   * @brief computes the state costs from the minimum distance between the robot spheres and the obstacles.
+   * @param parameters        The parameter values to evaluate for state costs [num_dimensions x num_parameters]
+   * @param start_timestep    start index into the 'parameters' array, usually 0.
+   * @param num_timesteps     number of elements to use from 'parameters' starting from 'start_timestep'   *
+   * @param iteration_number  The current iteration count in the optimization loop
+   * @param rollout_number    index of the noisy trajectory whose cost is being evaluated.   *
+   * @param costs             vector containing the state costs per timestep.
+   * @param validity          whether or not the trajectory is valid
+   * @return false if there was an irrecoverable failure, true otherwise.
+   */
+  virtual bool computeCosts(const Eigen::MatrixXd& parameters,
+                            std::size_t start_timestep,
+                            std::size_t num_timesteps,
+                            int iteration_number,
+                            int rollout_number,
+                            Eigen::VectorXd& costs,
+                            bool& validity) override;
+
+  /**
+   * @brief Creates a copy of this cost function for concurrent rollout evaluation.
+   * @return A new instance holding the same configuration
+   */
+  virtual StompCostFunctionPtr clone() const override
+  {
+    ObstacleDistanceField* cf = new ObstacleDistanceField(*this);
+    cf->robot_state_.reset(); // each instance moves its own state
+    return StompCostFunctionPtr(cf);
+  }
+
+  virtual std::string getGroupName() const override
+  {
+    return group_name_;
+  }
+
+  virtual std::string getName() const override
+  {
+    return name_ + "/" + group_name_;
+  }
+
+  virtual void done(bool success,int total_iterations,double final_cost,const Eigen::MatrixXd& parameters) override{}
+
+protected:
+
+  /** @brief A sphere that covers part of one collision shape of a link or of an attached body */
+  struct BoundingSphere
+  {
+    const moveit::core::LinkModel* link;      /**< @brief The link that owns the shape, null for attached bodies */
+    const moveit::core::AttachedBody* body;   /**< @brief The attached body that owns the shape, null for links */
+    std::size_t shape_index;                  /**< @brief The index of the shape in its owner */
+    Eigen::Vector3d center;                   /**< @brief The center in the shape frame */
+    double radius;                            /**< @brief The radius including the padding */
+  };
+
+  /**
+   * @brief Appends the spheres of a shape
+   * @param shape_spheres The spheres that cover the shape
+   * @param link          The link that owns the shape, null for attached bodies
+   * @param body          The attached body that owns the shape, null for links
+   * @param shape_index   The index of the shape in its owner
+   */
+  void addBoundingSpheres(const collision_detection::CollisionSpheres& shape_spheres,const moveit::core::LinkModel* link,
+                          const moveit::core::AttachedBody* body,std::size_t shape_index);
+
+  std::string name_;
+
+  // robot details
+  std::string group_name_;
+  moveit::core::RobotModelConstPtr robot_model_;
+  moveit::core::RobotStatePtr robot_state_;
+  std::vector<BoundingSphere> spheres_;          /**< @brief The spheres of the group links followed by those of the attached bodies */
+  std::size_t num_link_spheres_;                 /**< @brief The number of spheres that belong to links */
+  collision_detection::RobotSphereModel::Parameters sphere_params_;
+  collision_detection::RobotSphereModelConstPtr sphere_model_;
+  std::string sphere_cache_directory_;           /**< @brief Where the sphere model is cached, nothing is cached when empty */
+
+  // planning context information
+  planning_scene::PlanningSceneConstPtr planning_scene_;
+
+  // distance field
+  collision_detection::WorldDistanceField::Parameters field_params_;
+  collision_detection::WorldDistanceFieldConstPtr distance_field_;
+
+  // parameters
+  double max_distance_;     /**< @brief maximum distance from at which the trajectory will be penalized */
+  double padding_;          /**< @brief added to the radius of every sphere */
+  double exact_distance_margin_;  /**< @brief states closer than this to the obstacles get their distance from an exact query */
+};
+
+} /* namespace cost_functions */
+} /* namespace stomp_moveit */
+
+#endif /* INDUSTRIAL_MOVEIT_STOMP_PLUGINS_INCLUDE_STOMP_PLUGINS_COST_FUNCTIONS_OBSTACLE_DISTANCE_FIELD_H_ */
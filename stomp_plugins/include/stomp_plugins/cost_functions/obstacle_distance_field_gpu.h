@@ -0,0 +1,198 @@
+/**
+ * @file obstacle_distance_field_gpu.h
+ * @brief This defines a cost function that evaluates the robot spheres against a distance field of the world on an
+ *        OpenCL device.
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef INDUSTRIAL_MOVEIT_STOMP_PLUGINS_INCLUDE_STOMP_PLUGINS_COST_FUNCTIONS_OBSTACLE_DISTANCE_FIELD_GPU_H_
+#define INDUSTRIAL_MOVEIT_STOMP_PLUGINS_INCLUDE_STOMP_PLUGINS_COST_FUNCTIONS_OBSTACLE_DISTANCE_FIELD_GPU_H_
+
+#include <map>
+#include <memory>
+#include "stomp_plugins/cost_functions/obstacle_distance_field.h"
+
+namespace stomp_moveit
+{
+namespace cost_functions
+{
+
+/**
+ * @class stomp_moveit::cost_functions::ObstacleDistanceFieldGpu
+ * @brief Computes the same costs as the ObstacleDistanceField on an OpenCL device.  The joint chain of the group, the
+ *        robot spheres and the distance field are copied to the device once per motion plan request and a single kernel
+ *        launch evaluates the forward kinematics and the sphere distances of every state of every rollout in a batch.
+ *        The device computes in single precision.  The plugin falls back to the CPU evaluation of the
+ *        ObstacleDistanceField when stomp_plugins is built without OpenCL, when no device is found or when the group
+ *        has joints other than revolute and prismatic ones.
+ *
+ * @par Examples:
+ * All examples are located here @ref stomp_plugins_examples
+ */
+class ObstacleDistanceFieldGpu: public ObstacleDistanceField
+{
+public:
+  ObstacleDistanceFieldGpu();
+  virtual ~ObstacleDistanceFieldGpu();
+
+  /**
+   * @brief Sets internal members of the plugin from the configuration data and compiles the kernel for the group.
+   * @param config  The configuration data .  Usually loaded from the ros parameter server
+   * @return  true if succeeded, false otherwise.  Failing to set up the device is not an error, the costs are then
+   *          computed on the CPU.
+   */
+  virtual bool configure(const XmlRpc::XmlRpcValue& config) override;
+
+  /**
+   * @brief Stores the planning details and builds the device model of the group at the start state.
+   * @param planning_scene  A smart pointer to the planning scene
+   * @param req                 The motion planning request
+   * @param config              The  Stomp configuration.
+   * @param error_code          Moveit error code.
+   * @return  true if succeeded, false otherwise.
+   */
+  virtual bool setMotionPlanRequest(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                   const moveit_msgs::MotionPlanRequest &req,
+                   const stomp_core::StompConfiguration &config,
+                   moveit_msgs::MoveItErrorCodes& error_code) override;
+
+  /**
+   * @brief computes the state costs of a single rollout, as a batch of one rollout when the device is available.
+   * @param parameters        The parameter values to evaluate for state costs [num_dimensions x num_parameters]
+   * @param start_timestep    start index into the 'parameters' array, usually 0.
+   * @param num_timesteps     number of elements to use from 'parameters' starting from 'start_timestep'   *
+   * @param iteration_number  The current iteration count in the optimization loop
+   * @param rollout_number    index of the noisy trajectory whose cost is being evaluated.   *
+   * @param costs             vector containing the state costs per timestep.
+   * @param validity          whether or not the trajectory is valid
+   * @return false if there was an irrecoverable failure, true otherwise.
+   */
+  virtual bool computeCosts(const Eigen::MatrixXd& parameters,
+                            std::size_t start_timestep,
+                            std::size_t num_timesteps,
+                            int iteration_number,
+                            int rollout_number,
+                            Eigen::VectorXd& costs,
+                            bool& validity) override;
+
+  /**
+   * @brief Whether the device is available
+   * @return  True when the costs are computed on the device, otherwise false.
+   */
+  virtual bool supportsBatchCosts() const override;
+
+  /**
+   * @brief computes the state costs of all the rollouts in a single kernel launch.
+   * @param parameters        The noisy parameters of every rollout stored contiguously [num_dimensions x (num_rollouts x num_parameters)]
+   * @param start_timestep    start index into the parameters of each rollout, usually 0.
+   * @param num_timesteps     number of elements to evaluate starting from 'start_timestep'
+   * @param iteration_number  The current iteration count in the optimization loop
+   * @param num_rollouts      The number of rollouts stored in 'parameters'
+   * @param costs             matrix [num_rollouts x num_timesteps] that receives the state costs of each rollout per timestep.
+   * @param validities        whether or not each trajectory is valid
+   * @return false if there was an irrecoverable failure, true otherwise.
+   */
+  virtual bool computeCostsBatch(const Eigen::MatrixXd& parameters,
+                                 std::size_t start_timestep,
+                                 std::size_t num_timesteps,
+                                 int iteration_number,
+                                 int num_rollouts,
+                                 Eigen::MatrixXd& costs,
+                                 std::vector<bool>& validities) override;
+
+  /**
+   * @brief Creates a copy of this cost function for concurrent rollout evaluation.  The copy shares the compiled kernel
+   *        and allocates its own queue and buffers the first time it uses the device.
+   * @return A new instance holding the same configuration
+   */
+  virtual StompCostFunctionPtr clone() const override
+  {
+    ObstacleDistanceFieldGpu* cf = new ObstacleDistanceFieldGpu(*this);
+    cf->robot_state_.reset();
+    cf->queue_.reset();
+    cf->model_uploaded_ = false;
+    return StompCostFunctionPtr(cf);
+  }
+
+protected:
+
+  struct DeviceProgram;
+  struct DeviceQueue;
+
+  /**
+   * @brief Selects a device and compiles the kernel for the links of the group
+   * @return False if no device could be set up
+   */
+  bool createProgram();
+
+  /**
+   * @brief Computes the minimum sphere distance of the states on the device, the results are stored in 'distances_'.
+   * @param parameters      The parameters of the rollouts stored contiguously
+   * @param start_timestep  start index into the parameters of each rollout
+   * @param num_timesteps   number of states evaluated in each rollout
+   * @param num_rollouts    The number of rollouts stored in 'parameters'
+   * @return False if the device failed
+   */
+  bool computeDeviceDistances(const Eigen::MatrixXd& parameters,std::size_t start_timestep,std::size_t num_timesteps,
+                              int num_rollouts);
+
+  /**
+   * @brief Converts the distance of a state into its cost, the distance is replaced by that of an exact query when it is
+   *        below the exact distance margin.
+   * @param parameters  The parameters of the rollouts
+   * @param column      The column of the state in 'parameters'
+   * @param distance    The sphere distance computed by the device
+   * @param validity    Set to false when the state is in collision
+   * @return The cost of the state
+   */
+  double computeStateCost(const Eigen::MatrixXd& parameters,std::size_t column,double distance,bool& validity);
+
+  /** @brief Whether the device computes the costs */
+  bool useDevice() const;
+
+  // device model of the group, the links are those updated by the group sorted so that the parents precede their children
+  std::vector<const moveit::core::LinkModel*> device_links_;  /**< @brief The links whose poses are computed on the device */
+  std::map<const moveit::core::LinkModel*,int> link_indices_; /**< @brief The index of each device link */
+  std::vector<int> link_ints_;              /**< @brief The parent index, joint type and parameter row of each device link */
+  std::vector<float> link_floats_;          /**< @brief The joint origin, axis and mimic factor and offset of each device link */
+  std::vector<float> sphere_data_;          /**< @brief The center in the frame of its device link and radius of each sphere */
+  std::vector<int> sphere_links_;           /**< @brief The device link of each sphere, -1 for the spheres fixed in the world */
+  int num_rows_;                            /**< @brief The number of parameter rows the device model reads */
+
+  // device resources
+  std::shared_ptr<DeviceProgram> program_;  /**< @brief The device and the compiled kernel, shared by the clones */
+  std::shared_ptr<DeviceQueue> queue_;      /**< @brief The queue and buffers of this instance */
+  bool model_uploaded_;                     /**< @brief Whether the buffers hold the model of the current request */
+  std::vector<float> positions_;            /**< @brief The joint values of the states evaluated */
+  std::vector<float> distances_;            /**< @brief The minimum sphere distance of each state evaluated */
+
+  // parameters
+  bool use_gpu_;                            /**< @brief Whether to compute the costs on the device */
+  int platform_index_;                      /**< @brief The index of the OpenCL platform */
+  int device_index_;                        /**< @brief The index of the device in the platform */
+  int work_group_size_;                     /**< @brief The number of states per work group, 0 lets the driver choose */
+};
+
+} /* namespace cost_functions */
+} /* namespace stomp_moveit */
+
+#endif /* INDUSTRIAL_MOVEIT_STOMP_PLUGINS_INCLUDE_STOMP_PLUGINS_COST_FUNCTIONS_OBSTACLE_DISTANCE_FIELD_GPU_H_ */
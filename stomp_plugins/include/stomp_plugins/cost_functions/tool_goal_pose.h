@@ -89,7 +89,8 @@ public:
    * @param num_timesteps     number of elements to use from 'parameters' starting from 'start_timestep'   *
    * @param iteration_number  The current iteration count in the optimization loop
    * @param rollout_number    index of the noisy trajectory whose cost is being evaluated.   *
-   * @param costs             vector containing the state costs per timestep.  Only the array's last entry is set. [num_parameters x 1]
+   * @param costs             vector containing the state costs per timestep.  Only the array's last entry is set, the
+   *                          others are left as they are. [num_parameters x 1]
    * @param validity          whether or not the trajectory is valid
    * @return true if cost were properly computed
    */
@@ -101,6 +102,24 @@ public:
                             Eigen::VectorXd& costs,
                             bool& validity) override;
 
+  /**
+   * @brief Only the goal pose at the last timestep is costed
+   * @return CostSupports::LAST_TIMESTEP
+   */
+  virtual CostSupports::CostSupport getCostSupport() const override
+  {
+    return CostSupports::LAST_TIMESTEP;
+  }
+
+  /**
+   * @brief Creates a copy of this cost function for concurrent rollout evaluation.
+   * @return A new instance holding the same configuration
+   */
+  virtual StompCostFunctionPtr clone() const override
+  {
+    return StompCostFunctionPtr(new ToolGoalPose(*this));
+  }
+
   virtual std::string getGroupName() const override
   {
     return group_name_;
@@ -27,6 +27,9 @@
 #ifndef STOMP_PLUGINS_INCLUDE_STOMP_PLUGINS_NOISE_GENERATORS_GOAL_GUIDED_MULTIVARIATE_GAUSSIAN_H_
 #define STOMP_PLUGINS_INCLUDE_STOMP_PLUGINS_NOISE_GENERATORS_GOAL_GUIDED_MULTIVARIATE_GAUSSIAN_H_
 
+#include <cstdint>
+#include <vector>
+#include <Eigen/StdVector>
 #include <stomp_moveit/noise_generators/stomp_noise_generator.h>
 #include <stomp_moveit/utils/multivariate_gaussian.h>
 #include "stomp_moveit/utils/kinematics.h"
@@ -37,9 +40,6 @@ namespace stomp_moveit
 namespace noise_generators
 {
 
-typedef boost::mt19937 RGNType;
-typedef boost::variate_generator< RGNType, boost::uniform_real<> > RandomGenerator;
-
 /**
  * @class stomp_moveit::noise_generators::GoalGuidedMultivariateGaussian
  * @brief This class generates noisy trajectories to an under-constrained cartesian goal pose.
@@ -137,7 +137,45 @@ protected:
                    const stomp_core::StompConfiguration &config,
                    moveit_msgs::MoveItErrorCodes& error_code);
 
-  virtual bool generateRandomGoal(const Eigen::VectorXd& seed,Eigen::VectorXd& goal_joint_pose);
+  /**
+   * @brief The robot state, the ik storage and the noise buffer of a worker of the thread pool, the rollouts are generated
+   * concurrently and each worker only touches its own.
+   */
+  struct WorkerData
+  {
+    moveit::core::RobotStatePtr state;                      /**< @brief The robot state used by the ik **/
+    utils::kinematics::IKWorkspace ik_workspace;            /**< @brief Preallocated ik storage reused for every goal pose **/
+    utils::kinematics::KinematicConfig kc;                  /**< @brief The kinematic configuration, its goal pose and seed change per rollout **/
+    Eigen::MatrixXd raw_noise;                              /**< @brief The trajectory noise of each joint [num_timesteps x num_dimensions] **/
+    Eigen::VectorXd normal;                                 /**< @brief The standard normal values of a sample **/
+    Eigen::VectorXd linearized_seed;                        /**< @brief The seed the jacobian pseudo inverse was computed at **/
+    Eigen::Affine3d linearized_tool_pose;                   /**< @brief The tool pose at the linearized seed **/
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  };
+
+  /**
+   * @brief Solves the ik of the seed tool pose moved by the cartesian noise.
+   * @param seed            The joint pose at the goal of the current trajectory.
+   * @param noise           The noise applied onto the tool pose [x y z rx ry rz].
+   * @param worker          The data of the calling worker.
+   * @param goal_joint_pose The randomized goal joint pose.
+   * @return  True if succeeded, false otherwise.
+   */
+  virtual bool generateRandomGoal(const Eigen::VectorXd& seed,const Eigen::VectorXd& noise,WorkerData& worker,
+                                  Eigen::VectorXd& goal_joint_pose);
+
+  /**
+   * @brief Maps the cartesian goal noise onto the joints with a single step along the pseudo inverse of the tool jacobian at the seed
+   * instead of solving the ik.  The jacobian is only computed when the seed changes, which happens once per iteration.
+   * @param seed            The joint pose at the goal of the current trajectory.
+   * @param noise           The noise applied onto the tool pose [x y z rx ry rz].
+   * @param worker          The data of the calling worker.
+   * @param goal_joint_pose The randomized goal joint pose.
+   * @return  True if succeeded, false otherwise.
+   */
+  virtual bool generateLinearizedGoal(const Eigen::VectorXd& seed,const Eigen::VectorXd& noise,WorkerData& worker,
+                                      Eigen::VectorXd& goal_joint_pose);
 
 protected:
 
@@ -153,16 +191,18 @@ protected:
 
   // noisy trajectory generation
   std::vector<utils::MultivariateGaussianPtr> traj_noise_generators_; /**< @brief Randomized numerical distribution generators, [6 x 1] **/
-  Eigen::VectorXd raw_noise_;                                         /**< @brief The noise vector **/
   std::vector<double> stddev_;                                        /**< @brief The standard deviations applied to each joint, [num_dimensions x 1 **/
   std::vector<double> goal_stddev_;                                   /**< @brief The standard deviations applied to each cartesian dimension at the goal, [6 x 1] **/
+  bool linearized_goal_;                                              /**< @brief Whether the goal noise is mapped by the jacobian instead of solving the ik **/
 
   // random goal generation
-  boost::shared_ptr<RandomGenerator> goal_rand_generator_;            /**< @brief Random generator for the tool goal pose **/
+  std::uint64_t goal_seed_;                                           /**< @brief The seed of the random streams of the tool goal pose **/
 
   // robot
   moveit::core::RobotModelConstPtr robot_model_;
-  moveit::core::RobotStatePtr state_;
+
+  // the rollouts are generated concurrently, see stomp_core::ThreadPool::getWorkerIndex()
+  std::vector<WorkerData,Eigen::aligned_allocator<WorkerData> > workers_; /**< @brief The data of each worker **/
 
 };
 
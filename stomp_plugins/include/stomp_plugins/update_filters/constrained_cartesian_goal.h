@@ -114,6 +114,7 @@ protected:
 
   // kinematics
   utils::kinematics::KinematicConfig kc_;
+  utils::kinematics::IKWorkspace ik_workspace_;   /**< @brief Preallocated ik storage reused on every update **/
 
   // robot
   moveit::core::RobotModelConstPtr robot_model_;
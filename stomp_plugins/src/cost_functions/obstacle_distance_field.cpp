@@ -0,0 +1,319 @@
+/**
+ * @file obstacle_distance_field.cpp
+ * @brief This defines a cost function that evaluates the robot against a signed distance field of the world.
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stomp_plugins/cost_functions/obstacle_distance_field.h>
+#include <industrial_collision_detection/collision_detection/collision_world_industrial.h>
+#include <moveit/robot_state/conversions.h>
+#include <XmlRpcException.h>
+#include <pluginlib/class_list_macros.h>
+#include <ros/console.h>
+
+PLUGINLIB_EXPORT_CLASS(stomp_moveit::cost_functions::ObstacleDistanceField,stomp_moveit::cost_functions::StompCostFunction);
+
+static const double DEFAULT_FIELD_RESOLUTION = 0.02;
+static const double DEFAULT_PADDING = 0.0;
+static const double DEFAULT_EXACT_DISTANCE_MARGIN = 0.0;
+
+namespace stomp_moveit
+{
+namespace cost_functions
+{
+
+ObstacleDistanceField::ObstacleDistanceField():
+    name_("ObstacleDistanceField"),
+    num_link_spheres_(0),
+    max_distance_(0.0),
+    padding_(DEFAULT_PADDING),
+    exact_distance_margin_(DEFAULT_EXACT_DISTANCE_MARGIN)
+{
+
+}
+
+ObstacleDistanceField::~ObstacleDistanceField()
+{
+
+}
+
+bool ObstacleDistanceField::initialize(moveit::core::RobotModelConstPtr robot_model_ptr,
+                        const std::string& group_name,XmlRpc::XmlRpcValue& config)
+{
+  group_name_ = group_name;
+  robot_model_ = robot_model_ptr;
+
+  return configure(config);
+}
+
+bool ObstacleDistanceField::configure(const XmlRpc::XmlRpcValue& config)
+{
+  using namespace XmlRpc;
+
+  try
+  {
+    // check parameter presence
+    auto members = {"cost_weight" ,"max_distance"};
+    for(auto& m : members)
+    {
+      if(!config.hasMember(m))
+      {
+        ROS_ERROR("%s failed to find the '%s' parameter",getName().c_str(),m);
+        return false;
+      }
+    }
+
+    XmlRpcValue params = config;
+    cost_weight_ = static_cast<double>(params["cost_weight"]);
+    max_distance_ = static_cast<double>(params["max_distance"]);
+    padding_ = params.hasMember("padding") ? static_cast<double>(params["padding"]) : DEFAULT_PADDING;
+    field_params_.resolution = params.hasMember("field_resolution") ? static_cast<double>(params["field_resolution"]) :
+        DEFAULT_FIELD_RESOLUTION;
+    exact_distance_margin_ = params.hasMember("exact_distance_margin") ?
+        static_cast<double>(params["exact_distance_margin"]) : DEFAULT_EXACT_DISTANCE_MARGIN;
+    sphere_cache_directory_ = params.hasMember("sphere_cache_directory") ?
+        static_cast<std::string>(params["sphere_cache_directory"]) :
+        collision_detection::RobotSphereModel::getDefaultCacheDirectory();
+
+    collision_detection::RobotSphereModel::Parameters sphere_defaults;
+    sphere_params_.max_radius = params.hasMember("sphere_max_radius") ?
+        static_cast<double>(params["sphere_max_radius"]) : sphere_defaults.max_radius;
+    sphere_params_.max_spheres_per_shape = params.hasMember("max_spheres_per_shape") ?
+        static_cast<int>(params["max_spheres_per_shape"]) : sphere_defaults.max_spheres_per_shape;
+
+    if(params.hasMember("field_size"))
+    {
+      XmlRpcValue size_param = params["field_size"];
+      if(size_param.getType() != XmlRpcValue::TypeArray || size_param.size() != 3)
+      {
+        ROS_ERROR("%s the 'field_size' parameter must be an array of 3 values",getName().c_str());
+        return false;
+      }
+      field_params_.size_x = static_cast<double>(size_param[0]);
+      field_params_.size_y = static_cast<double>(size_param[1]);
+      field_params_.size_z = static_cast<double>(size_param[2]);
+    }
+
+    if(params.hasMember("field_origin"))
+    {
+      XmlRpcValue origin_param = params["field_origin"];
+      if(origin_param.getType() != XmlRpcValue::TypeArray || origin_param.size() != 3)
+      {
+        ROS_ERROR("%s the 'field_origin' parameter must be an array of 3 values",getName().c_str());
+        return false;
+      }
+      field_params_.origin_x = static_cast<double>(origin_param[0]);
+      field_params_.origin_y = static_cast<double>(origin_param[1]);
+      field_params_.origin_z = static_cast<double>(origin_param[2]);
+    }
+  }
+  catch(XmlRpc::XmlRpcException& e)
+  {
+    ROS_ERROR("%s failed to load parameters, %s",getName().c_str(),e.getMessage().c_str());
+    return false;
+  }
+
+  if(max_distance_ <= 0.0 || field_params_.resolution <= 0.0 || sphere_params_.max_radius <= 0.0 ||
+      sphere_params_.max_spheres_per_shape < 1)
+  {
+    ROS_ERROR("%s the 'max_distance', 'field_resolution', 'sphere_max_radius' and 'max_spheres_per_shape' parameters "
+        "must be greater than 0",getName().c_str());
+    return false;
+  }
+
+  // bounding the links that move with the group
+  const moveit::core::JointModelGroup* joint_group = robot_model_->getJointModelGroup(group_name_);
+  if(!joint_group)
+  {
+    ROS_ERROR("%s could not find the group '%s'",getName().c_str(),group_name_.c_str());
+    return false;
+  }
+
+  // the sphere model only depends on the robot, it is loaded once and shared by the clones
+  if(!sphere_model_ || !(sphere_model_->getParameters() == sphere_params_))
+  {
+    sphere_model_ = collision_detection::RobotSphereModel::create(robot_model_,sphere_params_,sphere_cache_directory_);
+  }
+
+  spheres_.clear();
+  for(const moveit::core::LinkModel* link : joint_group->getUpdatedLinkModelsWithGeometry())
+  {
+    for(auto s = 0u; s < link->getShapes().size(); s++)
+    {
+      addBoundingSpheres(sphere_model_->getSpheres(link,s),link,nullptr,s);
+    }
+  }
+  num_link_spheres_ = spheres_.size();
+
+  // the field must extend past the largest sphere so that the costs reach 0 at the maximum distance
+  double max_radius = 0.0;
+  for(const auto& s : spheres_)
+  {
+    max_radius = std::max(max_radius,s.radius);
+  }
+  field_params_.max_distance = max_distance_ + max_radius;
+
+  return true;
+}
+
+void ObstacleDistanceField::addBoundingSpheres(const collision_detection::CollisionSpheres& shape_spheres,
+                                               const moveit::core::LinkModel* link,
+                                               const moveit::core::AttachedBody* body,std::size_t shape_index)
+{
+  BoundingSphere sphere;
+  sphere.link = link;
+  sphere.body = body;
+  sphere.shape_index = shape_index;
+  for(const auto& s : shape_spheres)
+  {
+    sphere.center = s.center;
+    sphere.radius = s.radius + padding_;
+    spheres_.push_back(sphere);
+  }
+}
+
+bool ObstacleDistanceField::setMotionPlanRequest(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                 const moveit_msgs::MotionPlanRequest &req,
+                 const stomp_core::StompConfiguration &config,
+                 moveit_msgs::MoveItErrorCodes& error_code)
+{
+  using namespace moveit::core;
+
+  error_code.val = moveit_msgs::MoveItErrorCodes::SUCCESS;
+
+  // the state is only reallocated when the robot model changes, otherwise the start state is just reassigned
+  if(!robot_state_ || robot_state_->getRobotModel() != robot_model_)
+  {
+    robot_state_.reset(new RobotState(robot_model_));
+  }
+
+  if(!robotStateMsgToRobotState(req.start_state,*robot_state_,true))
+  {
+    ROS_ERROR("%s Failed to get current robot state from request",getName().c_str());
+    return false;
+  }
+
+  planning_scene_ = planning_scene;
+
+  // the attached bodies of the start state are decomposed for every request, they are not cached
+  spheres_.resize(num_link_spheres_);
+  std::vector<const AttachedBody*> bodies;
+  robot_state_->getAttachedBodies(bodies);
+  collision_detection::CollisionSpheres shape_spheres;
+  for(const AttachedBody* body : bodies)
+  {
+    for(auto s = 0u; s < body->getShapes().size(); s++)
+    {
+      shape_spheres.clear();
+      collision_detection::RobotSphereModel::decomposeShape(*body->getShapes()[s],sphere_params_,shape_spheres);
+      addBoundingSpheres(shape_spheres,nullptr,body,s);
+    }
+  }
+
+  // the industrial collision world keeps its field up to date, any other world gets a field built from its objects
+  collision_detection::CollisionWorldIndustrialConstPtr world =
+      std::dynamic_pointer_cast<const collision_detection::CollisionWorldIndustrial>(planning_scene->getCollisionWorld());
+  if(world)
+  {
+    distance_field_ = world->getDistanceField(field_params_);
+  }
+  else
+  {
+    ROS_DEBUG("%s the collision world is not an industrial collision world, building a distance field for this request",
+              getName().c_str());
+    collision_detection::WorldDistanceFieldPtr field(new collision_detection::WorldDistanceField(field_params_));
+    const collision_detection::WorldConstPtr& objects = planning_scene->getWorld();
+    for(auto it = objects->begin(); it != objects->end(); it++)
+    {
+      field->updateObject(it->second);
+    }
+    distance_field_ = field;
+  }
+
+  return true;
+}
+
+bool ObstacleDistanceField::computeCosts(const Eigen::MatrixXd& parameters,
+                          std::size_t start_timestep,
+                          std::size_t num_timesteps,
+                          int iteration_number,
+                          int rollout_number,
+                          Eigen::VectorXd& costs,
+                          bool& validity)
+{
+  if(!robot_state_ || !distance_field_)
+  {
+    ROS_ERROR("%s the motion plan request has not been set",getName().c_str());
+    return false;
+  }
+
+  if(parameters.cols()<start_timestep + num_timesteps)
+  {
+    ROS_ERROR_STREAM("Size in the 'parameters' matrix is less than required");
+    return false;
+  }
+
+  const moveit::core::JointModelGroup* joint_group = robot_model_->getJointModelGroup(group_name_);
+  costs.setZero(num_timesteps);
+  validity = true;
+
+  double distance;
+  Eigen::Vector3d gradient;
+  for(auto t = start_timestep; t < start_timestep + num_timesteps; t++)
+  {
+    const moveit::core::RobotState& state = getTimestepState(parameters,t,joint_group,*robot_state_);
+
+    double min_distance = max_distance_;
+    for(const auto& s : spheres_)
+    {
+      // the bodies belong to the start state, their shapes are placed from the link they are attached to in 'state'
+      Eigen::Vector3d center = s.link ? state.getCollisionBodyTransform(s.link,s.shape_index)*s.center :
+          state.getGlobalLinkTransform(s.body->getAttachedLink())*(s.body->getFixedTransforms()[s.shape_index]*s.center);
+      distance_field_->getDistanceGradient(center,distance,gradient);
+      min_distance = std::min(min_distance,distance - s.radius);
+    }
+
+    // the spheres overestimate the robot volume, close to the obstacles the exact distance is used instead
+    if(min_distance < exact_distance_margin_)
+    {
+      double exact_distance = planning_scene_->getCollisionWorld()->distanceRobot(*planning_scene_->getCollisionRobot(),
+                                                                                  state,
+                                                                                  planning_scene_->getAllowedCollisionMatrix());
+      min_distance = exact_distance <= 0.0 ? -1.0 : std::min(exact_distance,max_distance_);
+    }
+
+    if(min_distance < 0)
+    {
+      costs(t - start_timestep) = 1.0; // in collision
+      validity = false;
+    }
+    else
+    {
+      costs(t - start_timestep) = (max_distance_ - min_distance)/max_distance_;
+    }
+  }
+
+  return true;
+}
+
+} /* namespace cost_functions */
+} /* namespace stomp_moveit */
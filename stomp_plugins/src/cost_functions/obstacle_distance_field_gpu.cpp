@@ -0,0 +1,895 @@
+/**
+ * @file obstacle_distance_field_gpu.cpp
+ * @brief This defines a cost function that evaluates the robot spheres against a distance field of the world on an
+ *        OpenCL device.
+ *
+ * @author agent
+ * @date Oct 14, 2026
+ * @version TODO
+ * @bug No known bugs
+ *
+ * @copyright Copyright (c) 2026, Southwest Research Institute
+ *
+ * @par License
+ * Software License Agreement (Apache License)
+ * @par
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * @par
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stomp_plugins/cost_functions/obstacle_distance_field_gpu.h>
+#include <moveit/robot_model/prismatic_joint_model.h>
+#include <moveit/robot_model/revolute_joint_model.h>
+#include <XmlRpcException.h>
+#include <pluginlib/class_list_macros.h>
+#include <ros/console.h>
+#include <algorithm>
+
+#ifdef STOMP_PLUGINS_OPENCL
+#define CL_TARGET_OPENCL_VERSION 120
+#include <CL/cl.h>
+#endif
+
+PLUGINLIB_EXPORT_CLASS(stomp_moveit::cost_functions::ObstacleDistanceFieldGpu,stomp_moveit::cost_functions::StompCostFunction);
+
+static const int DEFAULT_WORK_GROUP_SIZE = 64;
+static const int LINK_INTS = 3;         /**< The parent index, the joint type and the parameter row */
+static const int LINK_FLOATS = 17;      /**< The 3x4 joint origin, the axis, the mimic factor and the mimic offset */
+
+/** @brief The joint motions computed by the kernel, the joints the group does not move are fixed at their start value */
+enum DeviceJointType
+{
+  JOINT_FIXED = 0,
+  JOINT_REVOLUTE,
+  JOINT_PRISMATIC
+};
+
+#ifdef STOMP_PLUGINS_OPENCL
+/**
+ * @brief The kernel evaluates one state per work item.  It chains the link poses from the joint values, places the spheres
+ * and returns the minimum distance between the spheres and the obstacles, the field lookup matches
+ * collision_detection::WorldDistanceField::getDistanceGradient().  The poses are 3x4 row major matrices.
+ */
+static const char* KERNEL_SOURCE = R"(
+void composePoses(const float* a, const float* b, float* out)
+{
+  for(int r = 0; r < 3; r++)
+  {
+    for(int c = 0; c < 4; c++)
+    {
+      out[4*r + c] = a[4*r]*b[c] + a[4*r + 1]*b[4 + c] + a[4*r + 2]*b[8 + c] + (c == 3 ? a[4*r + 3] : 0.0f);
+    }
+  }
+}
+
+float3 transformPoint(const float* pose, const float3 p)
+{
+  return (float3)(pose[0]*p.x + pose[1]*p.y + pose[2]*p.z + pose[3],
+                  pose[4]*p.x + pose[5]*p.y + pose[6]*p.z + pose[7],
+                  pose[8]*p.x + pose[9]*p.y + pose[10]*p.z + pose[11]);
+}
+
+void jointMotion(const int type, const float3 axis, const float value, float* m)
+{
+  for(int i = 0; i < 12; i++)
+  {
+    m[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+  }
+
+  if(type == JOINT_REVOLUTE)
+  {
+    float c;
+    const float s = sincos(value,&c);
+    const float v = 1.0f - c;
+    m[0] = c + axis.x*axis.x*v;         m[1] = axis.x*axis.y*v - axis.z*s;  m[2] = axis.x*axis.z*v + axis.y*s;
+    m[4] = axis.y*axis.x*v + axis.z*s;  m[5] = c + axis.y*axis.y*v;         m[6] = axis.y*axis.z*v - axis.x*s;
+    m[8] = axis.z*axis.x*v - axis.y*s;  m[9] = axis.z*axis.y*v + axis.x*s;  m[10] = c + axis.z*axis.z*v;
+  }
+  else if(type == JOINT_PRISMATIC)
+  {
+    m[3] = axis.x*value;
+    m[7] = axis.y*value;
+    m[11] = axis.z*value;
+  }
+}
+
+float lookupDistance(__global const float* field, const int4 num_cells, const float4 origin, const float max_distance,
+                     const float3 point)
+{
+  const float3 g = (point - origin.xyz)/origin.w;
+  const int3 cell = convert_int3(floor(g + 0.5f));
+  if(any(cell < (int3)(0)) || any(cell >= num_cells.xyz))
+  {
+    return max_distance;
+  }
+
+  const float3 base = floor(g);
+  const float3 frac = g - base;
+  const int3 low = max(convert_int3(base),(int3)(0));
+  const int3 high = min(convert_int3(base) + 1,num_cells.xyz - 1);
+  float distance = 0.0f;
+  for(int c = 0; c < 8; c++)
+  {
+    const int x = (c & 1) ? high.x : low.x;
+    const int y = (c & 2) ? high.y : low.y;
+    const int z = (c & 4) ? high.z : low.z;
+    const float w = ((c & 1) ? frac.x : 1.0f - frac.x)*((c & 2) ? frac.y : 1.0f - frac.y)*
+        ((c & 4) ? frac.z : 1.0f - frac.z);
+    distance += w*field[(x*num_cells.y + y)*num_cells.z + z];
+  }
+  return distance;
+}
+
+__kernel void computeSphereDistances(__global const float* positions, const int num_variables, const int num_states,
+                                     __global const int* link_ints, __global const float* link_floats,
+                                     __global const float4* spheres, __global const int* sphere_links,
+                                     const int num_spheres, __global const float* field, const int4 num_cells,
+                                     const float4 field_origin, const float field_max_distance,
+                                     const float max_distance, __global float* distances)
+{
+  const int state = get_global_id(0);
+  if(state >= num_states)
+  {
+    return;
+  }
+
+  __global const float* q = positions + state*num_variables;
+  float poses[12*NUM_LINKS];
+  float origin[12];
+  float motion[12];
+  float local[12];
+  for(int l = 0; l < NUM_LINKS; l++)
+  {
+    const int parent = link_ints[LINK_INTS*l];
+    const int variable = link_ints[LINK_INTS*l + 2];
+    __global const float* f = link_floats + LINK_FLOATS*l;
+    for(int i = 0; i < 12; i++)
+    {
+      origin[i] = f[i];
+    }
+
+    const float value = variable < 0 ? 0.0f : f[15]*q[variable] + f[16];
+    jointMotion(link_ints[LINK_INTS*l + 1],(float3)(f[12],f[13],f[14]),value,motion);
+    if(parent < 0)
+    {
+      composePoses(origin,motion,poses + 12*l);
+    }
+    else
+    {
+      composePoses(origin,motion,local);
+      composePoses(poses + 12*parent,local,poses + 12*l);
+    }
+  }
+
+  float min_distance = max_distance;
+  for(int i = 0; i < num_spheres; i++)
+  {
+    const float4 sphere = spheres[i];
+    const int link = sphere_links[i];
+    const float3 center = link < 0 ? sphere.xyz : transformPoint(poses + 12*link,sphere.xyz);
+    min_distance = fmin(min_distance,lookupDistance(field,num_cells,field_origin,field_max_distance,center) - sphere.w);
+  }
+  distances[state] = min_distance;
+}
+)";
+
+/** @brief A device buffer that only grows */
+struct DeviceBuffer
+{
+  DeviceBuffer(): mem(nullptr), capacity(0) {}
+  DeviceBuffer(const DeviceBuffer&) = delete;
+  DeviceBuffer& operator=(const DeviceBuffer&) = delete;
+
+  ~DeviceBuffer()
+  {
+    if(mem)
+    {
+      clReleaseMemObject(mem);
+    }
+  }
+
+  /**
+   * @brief Copies data to the buffer, it is reallocated when it is too small
+   * @param context   The context of the queue
+   * @param queue     The queue
+   * @param data      The data
+   * @param size      The size of the data in bytes
+   * @param blocking  Whether to wait for the copy, otherwise the data must remain valid until the queue is finished
+   * @return The OpenCL error code
+   */
+  cl_int write(cl_context context,cl_command_queue queue,const void* data,std::size_t size,bool blocking)
+  {
+    cl_int err = reserve(context,size,CL_MEM_READ_ONLY);
+    if(err == CL_SUCCESS && size > 0)
+    {
+      err = clEnqueueWriteBuffer(queue,mem,blocking ? CL_TRUE : CL_FALSE,0,size,data,0,nullptr,nullptr);
+    }
+    return err;
+  }
+
+  /**
+   * @brief Reallocates the buffer when it is smaller than a size, the buffers are never empty
+   * @param context The context
+   * @param size    The size in bytes
+   * @param flags   The memory flags
+   * @return The OpenCL error code
+   */
+  cl_int reserve(cl_context context,std::size_t size,cl_mem_flags flags)
+  {
+    if(mem && capacity >= size)
+    {
+      return CL_SUCCESS;
+    }
+
+    if(mem)
+    {
+      clReleaseMemObject(mem);
+    }
+    cl_int err;
+    capacity = std::max<std::size_t>(size,sizeof(cl_float4));
+    mem = clCreateBuffer(context,flags,capacity,nullptr,&err);
+    if(err != CL_SUCCESS)
+    {
+      mem = nullptr;
+      capacity = 0;
+    }
+    return err;
+  }
+
+  cl_mem mem;
+  std::size_t capacity;
+};
+#endif
+
+namespace stomp_moveit
+{
+namespace cost_functions
+{
+
+#ifdef STOMP_PLUGINS_OPENCL
+/** @brief The device, its context and the kernel compiled for the links of the group */
+struct ObstacleDistanceFieldGpu::DeviceProgram
+{
+  DeviceProgram(): device(nullptr), context(nullptr), program(nullptr) {}
+
+  ~DeviceProgram()
+  {
+    if(program)
+    {
+      clReleaseProgram(program);
+    }
+    if(context)
+    {
+      clReleaseContext(context);
+    }
+  }
+
+  cl_device_id device;
+  cl_context context;
+  cl_program program;
+  std::string device_name;
+};
+
+/** @brief The queue, the kernel and the buffers of a cost function instance */
+struct ObstacleDistanceFieldGpu::DeviceQueue
+{
+  DeviceQueue(): queue(nullptr), kernel(nullptr), work_group_size(0) {}
+
+  ~DeviceQueue()
+  {
+    if(queue)
+    {
+      clFinish(queue);
+    }
+
+    // the buffers are released after the queue, the program is the last member released and keeps the context alive
+    if(kernel)
+    {
+      clReleaseKernel(kernel);
+    }
+    if(queue)
+    {
+      clReleaseCommandQueue(queue);
+    }
+  }
+
+  std::shared_ptr<DeviceProgram> program;
+  cl_command_queue queue;
+  cl_kernel kernel;
+  std::size_t work_group_size;
+  DeviceBuffer positions;
+  DeviceBuffer link_ints;
+  DeviceBuffer link_floats;
+  DeviceBuffer spheres;
+  DeviceBuffer sphere_links;
+  DeviceBuffer field;
+  DeviceBuffer distances;
+  cl_int4 num_cells;
+  cl_float4 field_origin;                   /**< The field origin and its resolution */
+  cl_float field_max_distance;
+};
+#else
+struct ObstacleDistanceFieldGpu::DeviceProgram {};
+struct ObstacleDistanceFieldGpu::DeviceQueue {};
+#endif
+
+ObstacleDistanceFieldGpu::ObstacleDistanceFieldGpu():
+    num_rows_(0),
+    model_uploaded_(false),
+    use_gpu_(true),
+    platform_index_(0),
+    device_index_(0),
+    work_group_size_(DEFAULT_WORK_GROUP_SIZE)
+{
+  name_ = "ObstacleDistanceFieldGpu";
+}
+
+ObstacleDistanceFieldGpu::~ObstacleDistanceFieldGpu()
+{
+
+}
+
+bool ObstacleDistanceFieldGpu::configure(const XmlRpc::XmlRpcValue& config)
+{
+  using namespace moveit::core;
+
+  if(!ObstacleDistanceField::configure(config))
+  {
+    return false;
+  }
+
+  try
+  {
+    XmlRpc::XmlRpcValue params = config;
+    use_gpu_ = params.hasMember("use_gpu") ? static_cast<bool>(params["use_gpu"]) : true;
+    platform_index_ = params.hasMember("opencl_platform") ? static_cast<int>(params["opencl_platform"]) : 0;
+    device_index_ = params.hasMember("opencl_device") ? static_cast<int>(params["opencl_device"]) : 0;
+    work_group_size_ = params.hasMember("work_group_size") ? static_cast<int>(params["work_group_size"]) :
+        DEFAULT_WORK_GROUP_SIZE;
+  }
+  catch(XmlRpc::XmlRpcException& e)
+  {
+    ROS_ERROR("%s failed to load parameters, %s",getName().c_str(),e.getMessage().c_str());
+    return false;
+  }
+
+  if(platform_index_ < 0 || device_index_ < 0 || work_group_size_ < 0)
+  {
+    ROS_ERROR("%s the 'opencl_platform', 'opencl_device' and 'work_group_size' parameters can not be negative",
+              getName().c_str());
+    return false;
+  }
+
+  program_.reset();
+  queue_.reset();
+  model_uploaded_ = false;
+  if(!use_gpu_)
+  {
+    return true;
+  }
+
+  // the links are sorted by index, which places the parents before their children
+  const JointModelGroup* joint_group = robot_model_->getJointModelGroup(group_name_);
+  device_links_ = joint_group->getUpdatedLinkModels();
+  std::sort(device_links_.begin(),device_links_.end(),[](const LinkModel* a,const LinkModel* b)
+  {
+    return a->getLinkIndex() < b->getLinkIndex();
+  });
+
+  link_indices_.clear();
+  link_ints_.clear();
+  num_rows_ = 0;
+  const std::vector<int>& variables = joint_group->getVariableIndexList();
+  for(auto l = 0u; l < device_links_.size(); l++)
+  {
+    const LinkModel* link = device_links_[l];
+    const JointModel* joint = link->getParentJointModel();
+    const JointModel* source = joint->getMimic() ? joint->getMimic() : joint;
+    auto parent = link_indices_.find(link->getParentLinkModel());
+    link_indices_[link] = l;
+
+    int type = JOINT_FIXED;
+    int row = -1;
+    if(joint_group->hasJointModel(joint->getName()) && joint_group->hasJointModel(source->getName()))
+    {
+      switch(joint->getType())
+      {
+        case JointModel::REVOLUTE:
+          type = JOINT_REVOLUTE;
+          break;
+        case JointModel::PRISMATIC:
+          type = JOINT_PRISMATIC;
+          break;
+        case JointModel::FIXED:
+          break;
+        default:
+          ROS_WARN("%s the joint '%s' is neither revolute nor prismatic, the costs are computed on the CPU",
+                   getName().c_str(),joint->getName().c_str());
+          return true;
+      }
+
+      if(type != JOINT_FIXED)
+      {
+        row = std::find(variables.begin(),variables.end(),source->getFirstVariableIndex()) - variables.begin();
+        num_rows_ = std::max(num_rows_,row + 1);
+      }
+    }
+
+    link_ints_.push_back(parent == link_indices_.end() ? -1 : parent->second);
+    link_ints_.push_back(type);
+    link_ints_.push_back(row);
+  }
+
+  createProgram();
+  return true;
+}
+
+bool ObstacleDistanceFieldGpu::createProgram()
+{
+#ifdef STOMP_PLUGINS_OPENCL
+  cl_uint num_platforms = 0;
+  if(clGetPlatformIDs(0,nullptr,&num_platforms) != CL_SUCCESS || platform_index_ >= static_cast<int>(num_platforms))
+  {
+    ROS_WARN("%s found no OpenCL platform %i, the costs are computed on the CPU",getName().c_str(),platform_index_);
+    return false;
+  }
+  std::vector<cl_platform_id> platforms(num_platforms);
+  clGetPlatformIDs(num_platforms,platforms.data(),nullptr);
+
+  // GPUs are preferred, any other device of the platform is used when it has none
+  std::vector<cl_device_id> devices;
+  const cl_device_type device_types[] = {CL_DEVICE_TYPE_GPU,CL_DEVICE_TYPE_ALL};
+  for(cl_device_type type : device_types)
+  {
+    cl_uint num_devices = 0;
+    if(clGetDeviceIDs(platforms[platform_index_],type,0,nullptr,&num_devices) == CL_SUCCESS && num_devices > 0)
+    {
+      devices.resize(num_devices);
+      clGetDeviceIDs(platforms[platform_index_],type,num_devices,devices.data(),nullptr);
+      break;
+    }
+  }
+
+  if(device_index_ >= static_cast<int>(devices.size()))
+  {
+    ROS_WARN("%s found no OpenCL device %i on platform %i, the costs are computed on the CPU",getName().c_str(),
+             device_index_,platform_index_);
+    return false;
+  }
+
+  std::shared_ptr<DeviceProgram> program(new DeviceProgram());
+  program->device = devices[device_index_];
+  char device_name[256] = {0};
+  clGetDeviceInfo(program->device,CL_DEVICE_NAME,sizeof(device_name) - 1,device_name,nullptr);
+  program->device_name = device_name;
+
+  cl_int err;
+  program->context = clCreateContext(nullptr,1,&program->device,nullptr,nullptr,&err);
+  if(err != CL_SUCCESS)
+  {
+    program->context = nullptr;
+    ROS_WARN("%s failed to create an OpenCL context on '%s' (error %i), the costs are computed on the CPU",
+             getName().c_str(),device_name,err);
+    return false;
+  }
+
+  program->program = clCreateProgramWithSource(program->context,1,&KERNEL_SOURCE,nullptr,&err);
+  if(err != CL_SUCCESS)
+  {
+    program->program = nullptr;
+    ROS_WARN("%s failed to create the OpenCL program (error %i), the costs are computed on the CPU",getName().c_str(),
+             err);
+    return false;
+  }
+
+  // the link count sizes the private pose array of the kernel
+  std::string options = "-DNUM_LINKS=" + std::to_string(std::max<std::size_t>(device_links_.size(),1)) +
+      " -DLINK_INTS=" + std::to_string(LINK_INTS) + " -DLINK_FLOATS=" + std::to_string(LINK_FLOATS) +
+      " -DJOINT_REVOLUTE=" + std::to_string(JOINT_REVOLUTE) + " -DJOINT_PRISMATIC=" + std::to_string(JOINT_PRISMATIC);
+  err = clBuildProgram(program->program,1,&program->device,options.c_str(),nullptr,nullptr);
+  if(err != CL_SUCCESS)
+  {
+    std::size_t log_size = 0;
+    clGetProgramBuildInfo(program->program,program->device,CL_PROGRAM_BUILD_LOG,0,nullptr,&log_size);
+    std::string log(log_size,'\0');
+    clGetProgramBuildInfo(program->program,program->device,CL_PROGRAM_BUILD_LOG,log_size,&log[0],nullptr);
+    ROS_WARN("%s failed to build the OpenCL program (error %i), the costs are computed on the CPU:\n%s",
+             getName().c_str(),err,log.c_str());
+    return false;
+  }
+
+  ROS_INFO("%s computes the costs on the OpenCL device '%s'",getName().c_str(),device_name);
+  program_ = program;
+  return true;
+#else
+  ROS_WARN("%s was built without OpenCL, the costs are computed on the CPU",getName().c_str());
+  return false;
+#endif
+}
+
+bool ObstacleDistanceFieldGpu::useDevice() const
+{
+  return static_cast<bool>(program_);
+}
+
+bool ObstacleDistanceFieldGpu::setMotionPlanRequest(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                 const moveit_msgs::MotionPlanRequest &req,
+                 const stomp_core::StompConfiguration &config,
+                 moveit_msgs::MoveItErrorCodes& error_code)
+{
+  using namespace moveit::core;
+
+  if(!ObstacleDistanceField::setMotionPlanRequest(planning_scene,req,config,error_code))
+  {
+    return false;
+  }
+
+  model_uploaded_ = false;
+  if(!useDevice())
+  {
+    return true;
+  }
+
+  // the links that the group does not move keep their pose relative to their parent in the start state
+  robot_state_->update();
+  auto addPose = [this](const Eigen::Affine3d& pose)
+  {
+    for(int r = 0; r < 3; r++)
+    {
+      for(int c = 0; c < 4; c++)
+      {
+        link_floats_.push_back(static_cast<float>(pose(r,c)));
+      }
+    }
+  };
+
+  link_floats_.clear();
+  for(auto l = 0u; l < device_links_.size(); l++)
+  {
+    const LinkModel* link = device_links_[l];
+    const LinkModel* parent = link->getParentLinkModel();
+    const JointModel* joint = link->getParentJointModel();
+    bool has_parent = link_ints_[LINK_INTS*l] >= 0;
+    int type = link_ints_[LINK_INTS*l + 1];
+
+    Eigen::Vector3d axis = Eigen::Vector3d::Zero();
+    if(type == JOINT_FIXED)
+    {
+      addPose(has_parent ? Eigen::Affine3d(robot_state_->getGlobalLinkTransform(parent).inverse()*
+                                           robot_state_->getGlobalLinkTransform(link)) :
+                           Eigen::Affine3d(robot_state_->getGlobalLinkTransform(link)));
+    }
+    else
+    {
+      Eigen::Affine3d origin(link->getJointOriginTransform());
+      addPose(has_parent || !parent ? origin : Eigen::Affine3d(robot_state_->getGlobalLinkTransform(parent)*origin));
+      axis = type == JOINT_REVOLUTE ? static_cast<const RevoluteJointModel*>(joint)->getAxis() :
+          static_cast<const PrismaticJointModel*>(joint)->getAxis();
+    }
+
+    link_floats_.push_back(static_cast<float>(axis.x()));
+    link_floats_.push_back(static_cast<float>(axis.y()));
+    link_floats_.push_back(static_cast<float>(axis.z()));
+    link_floats_.push_back(static_cast<float>(joint->getMimic() ? joint->getMimicFactor() : 1.0));
+    link_floats_.push_back(static_cast<float>(joint->getMimic() ? joint->getMimicOffset() : 0.0));
+  }
+
+  // the spheres are expressed in the frame of their device link, those attached to other links are placed in the world
+  sphere_data_.clear();
+  sphere_links_.clear();
+  for(const auto& s : spheres_)
+  {
+    const LinkModel* link = s.link ? s.link : s.body->getAttachedLink();
+    Eigen::Vector3d center = s.link ? link->getCollisionOriginTransforms()[s.shape_index]*s.center :
+        s.body->getFixedTransforms()[s.shape_index]*s.center;
+    auto index = link_indices_.find(link);
+    if(index == link_indices_.end())
+    {
+      center = robot_state_->getGlobalLinkTransform(link)*center;
+    }
+
+    sphere_data_.push_back(static_cast<float>(center.x()));
+    sphere_data_.push_back(static_cast<float>(center.y()));
+    sphere_data_.push_back(static_cast<float>(center.z()));
+    sphere_data_.push_back(static_cast<float>(s.radius));
+    sphere_links_.push_back(index == link_indices_.end() ? -1 : index->second);
+  }
+
+  return true;
+}
+
+bool ObstacleDistanceFieldGpu::computeDeviceDistances(const Eigen::MatrixXd& parameters,std::size_t start_timestep,
+                                                      std::size_t num_timesteps,int num_rollouts)
+{
+#ifdef STOMP_PLUGINS_OPENCL
+  if(parameters.rows() < num_rows_)
+  {
+    ROS_ERROR("%s received %i parameter rows, the group has %i",getName().c_str(),int(parameters.rows()),num_rows_);
+    return false;
+  }
+
+  cl_int err;
+  if(!queue_)
+  {
+    std::shared_ptr<DeviceQueue> queue(new DeviceQueue());
+    queue->program = program_;
+    queue->queue = clCreateCommandQueue(program_->context,program_->device,0,&err);
+    if(err != CL_SUCCESS)
+    {
+      queue->queue = nullptr;
+      ROS_ERROR("%s failed to create an OpenCL queue (error %i)",getName().c_str(),err);
+      return false;
+    }
+
+    queue->kernel = clCreateKernel(program_->program,"computeSphereDistances",&err);
+    if(err != CL_SUCCESS)
+    {
+      queue->kernel = nullptr;
+      ROS_ERROR("%s failed to create the OpenCL kernel (error %i)",getName().c_str(),err);
+      return false;
+    }
+
+    std::size_t max_work_group_size = 0;
+    clGetKernelWorkGroupInfo(queue->kernel,program_->device,CL_KERNEL_WORK_GROUP_SIZE,sizeof(max_work_group_size),
+                             &max_work_group_size,nullptr);
+    queue->work_group_size = std::min<std::size_t>(work_group_size_,max_work_group_size);
+    queue_ = queue;
+  }
+
+  cl_context context = program_->context;
+  if(!model_uploaded_)
+  {
+    // the field is copied in the layout indexed by the kernel
+    const distance_field::PropagationDistanceField& field = distance_field_->getField();
+    const int cells[3] = {field.getXNumCells(),field.getYNumCells(),field.getZNumCells()};
+    std::vector<float> field_data(std::size_t(cells[0])*cells[1]*cells[2]);
+    auto it = field_data.begin();
+    for(int x = 0; x < cells[0]; x++)
+    {
+      for(int y = 0; y < cells[1]; y++)
+      {
+        for(int z = 0; z < cells[2]; z++)
+        {
+          *it++ = static_cast<float>(field.getDistance(x,y,z));
+        }
+      }
+    }
+
+    queue_->num_cells = {{cells[0],cells[1],cells[2],0}};
+    queue_->field_origin = {{static_cast<float>(field.getOriginX()),static_cast<float>(field.getOriginY()),
+                             static_cast<float>(field.getOriginZ()),static_cast<float>(field.getResolution())}};
+    queue_->field_max_distance = static_cast<float>(distance_field_->getParameters().max_distance);
+
+    // the model vectors are members that outlive the copies, the blocking field copy finishes them all
+    err = queue_->link_ints.write(context,queue_->queue,link_ints_.data(),sizeof(int)*link_ints_.size(),false);
+    err = err != CL_SUCCESS ? err :
+        queue_->link_floats.write(context,queue_->queue,link_floats_.data(),sizeof(float)*link_floats_.size(),false);
+    err = err != CL_SUCCESS ? err :
+        queue_->spheres.write(context,queue_->queue,sphere_data_.data(),sizeof(float)*sphere_data_.size(),false);
+    err = err != CL_SUCCESS ? err :
+        queue_->sphere_links.write(context,queue_->queue,sphere_links_.data(),sizeof(int)*sphere_links_.size(),false);
+    err = err != CL_SUCCESS ? err :
+        queue_->field.write(context,queue_->queue,field_data.data(),sizeof(float)*field_data.size(),true);
+    if(err != CL_SUCCESS)
+    {
+      ROS_ERROR("%s failed to copy the model to the OpenCL device (error %i)",getName().c_str(),err);
+      return false;
+    }
+    model_uploaded_ = true;
+  }
+
+  // the states are stored rollout after rollout
+  cl_int num_variables = parameters.rows();
+  cl_int num_states = num_rollouts*num_timesteps;
+  cl_int num_spheres = sphere_links_.size();
+  std::size_t num_parameters = parameters.cols()/num_rollouts;
+  positions_.resize(num_states*num_variables);
+  distances_.resize(num_states);
+  auto position = positions_.begin();
+  for(auto r = 0; r < num_rollouts; r++)
+  {
+    for(auto t = start_timestep; t < start_timestep + num_timesteps; t++)
+    {
+      for(auto d = 0; d < num_variables; d++)
+      {
+        *position++ = static_cast<float>(parameters(d,r*num_parameters + t));
+      }
+    }
+  }
+
+  cl_float max_distance = max_distance_;
+  if(num_spheres == 0 || num_states == 0)
+  {
+    std::fill(distances_.begin(),distances_.end(),max_distance);
+    return true;
+  }
+
+  err = queue_->positions.write(context,queue_->queue,positions_.data(),sizeof(float)*positions_.size(),false);
+  err = err != CL_SUCCESS ? err : queue_->distances.reserve(context,sizeof(float)*distances_.size(),CL_MEM_WRITE_ONLY);
+  if(err != CL_SUCCESS)
+  {
+    ROS_ERROR("%s failed to copy the states to the OpenCL device (error %i)",getName().c_str(),err);
+    return false;
+  }
+
+  cl_kernel kernel = queue_->kernel;
+  err = clSetKernelArg(kernel,0,sizeof(cl_mem),&queue_->positions.mem);
+  err |= clSetKernelArg(kernel,1,sizeof(cl_int),&num_variables);
+  err |= clSetKernelArg(kernel,2,sizeof(cl_int),&num_states);
+  err |= clSetKernelArg(kernel,3,sizeof(cl_mem),&queue_->link_ints.mem);
+  err |= clSetKernelArg(kernel,4,sizeof(cl_mem),&queue_->link_floats.mem);
+  err |= clSetKernelArg(kernel,5,sizeof(cl_mem),&queue_->spheres.mem);
+  err |= clSetKernelArg(kernel,6,sizeof(cl_mem),&queue_->sphere_links.mem);
+  err |= clSetKernelArg(kernel,7,sizeof(cl_int),&num_spheres);
+  err |= clSetKernelArg(kernel,8,sizeof(cl_mem),&queue_->field.mem);
+  err |= clSetKernelArg(kernel,9,sizeof(cl_int4),&queue_->num_cells);
+  err |= clSetKernelArg(kernel,10,sizeof(cl_float4),&queue_->field_origin);
+  err |= clSetKernelArg(kernel,11,sizeof(cl_float),&queue_->field_max_distance);
+  err |= clSetKernelArg(kernel,12,sizeof(cl_float),&max_distance);
+  err |= clSetKernelArg(kernel,13,sizeof(cl_mem),&queue_->distances.mem);
+  if(err != CL_SUCCESS)
+  {
+    ROS_ERROR("%s failed to set the OpenCL kernel arguments",getName().c_str());
+    return false;
+  }
+
+  // the global size is rounded up to whole work groups, the kernel skips the extra work items
+  std::size_t local_size = queue_->work_group_size;
+  std::size_t global_size = local_size > 0 ? ((num_states + local_size - 1)/local_size)*local_size : num_states;
+  err = clEnqueueNDRangeKernel(queue_->queue,kernel,1,nullptr,&global_size,local_size > 0 ? &local_size : nullptr,0,
+                               nullptr,nullptr);
+  err = err != CL_SUCCESS ? err : clEnqueueReadBuffer(queue_->queue,queue_->distances.mem,CL_TRUE,0,
+                                                      sizeof(float)*distances_.size(),distances_.data(),0,nullptr,
+                                                      nullptr);
+  if(err != CL_SUCCESS)
+  {
+    ROS_ERROR("%s failed to run the OpenCL kernel (error %i)",getName().c_str(),err);
+    return false;
+  }
+
+  return true;
+#else
+  return false;
+#endif
+}
+
+double ObstacleDistanceFieldGpu::computeStateCost(const Eigen::MatrixXd& parameters,std::size_t column,double distance,
+                                                  bool& validity)
+{
+  // the spheres overestimate the robot volume, close to the obstacles the exact distance is used instead
+  double min_distance = std::min(distance,max_distance_);
+  if(min_distance < exact_distance_margin_)
+  {
+    robot_state_->setJointGroupPositions(group_name_,parameters.col(column));
+    robot_state_->update();
+    double exact_distance = planning_scene_->getCollisionWorld()->distanceRobot(*planning_scene_->getCollisionRobot(),
+                                                                                *robot_state_,
+                                                                                planning_scene_->getAllowedCollisionMatrix());
+    min_distance = exact_distance <= 0.0 ? -1.0 : std::min(exact_distance,max_distance_);
+  }
+
+  if(min_distance < 0)
+  {
+    validity = false;
+    return 1.0; // in collision
+  }
+  return (max_distance_ - min_distance)/max_distance_;
+}
+
+bool ObstacleDistanceFieldGpu::supportsBatchCosts() const
+{
+  return useDevice();
+}
+
+bool ObstacleDistanceFieldGpu::computeCosts(const Eigen::MatrixXd& parameters,
+                          std::size_t start_timestep,
+                          std::size_t num_timesteps,
+                          int iteration_number,
+                          int rollout_number,
+                          Eigen::VectorXd& costs,
+                          bool& validity)
+{
+  if(!useDevice())
+  {
+    return ObstacleDistanceField::computeCosts(parameters,start_timestep,num_timesteps,iteration_number,rollout_number,
+                                               costs,validity);
+  }
+
+  if(!robot_state_ || !distance_field_)
+  {
+    ROS_ERROR("%s the motion plan request has not been set",getName().c_str());
+    return false;
+  }
+
+  if(parameters.cols()<start_timestep + num_timesteps)
+  {
+    ROS_ERROR_STREAM("Size in the 'parameters' matrix is less than required");
+    return false;
+  }
+
+  if(!computeDeviceDistances(parameters,start_timestep,num_timesteps,1))
+  {
+    ROS_WARN("%s computes the costs on the CPU from now on",getName().c_str());
+    program_.reset();
+    queue_.reset();
+    return ObstacleDistanceField::computeCosts(parameters,start_timestep,num_timesteps,iteration_number,rollout_number,
+                                               costs,validity);
+  }
+
+  costs.resize(num_timesteps);
+  validity = true;
+  for(auto t = 0u; t < num_timesteps; t++)
+  {
+    costs(t) = computeStateCost(parameters,start_timestep + t,distances_[t],validity);
+  }
+
+  return true;
+}
+
+bool ObstacleDistanceFieldGpu::computeCostsBatch(const Eigen::MatrixXd& parameters,
+                               std::size_t start_timestep,
+                               std::size_t num_timesteps,
+                               int iteration_number,
+                               int num_rollouts,
+                               Eigen::MatrixXd& costs,
+                               std::vector<bool>& validities)
+{
+  if(!useDevice())
+  {
+    return ObstacleDistanceField::computeCostsBatch(parameters,start_timestep,num_timesteps,iteration_number,
+                                                    num_rollouts,costs,validities);
+  }
+
+  if(num_rollouts <= 0 || parameters.cols() % num_rollouts != 0)
+  {
+    ROS_ERROR("%s received %i columns of parameters for %i rollouts",getName().c_str(),int(parameters.cols()),num_rollouts);
+    return false;
+  }
+
+  std::size_t num_parameters = parameters.cols()/num_rollouts;
+  if(!robot_state_ || !distance_field_)
+  {
+    ROS_ERROR("%s the motion plan request has not been set",getName().c_str());
+    return false;
+  }
+
+  if(num_parameters < start_timestep + num_timesteps)
+  {
+    ROS_ERROR_STREAM("Size in the 'parameters' matrix is less than required");
+    return false;
+  }
+
+  if(!computeDeviceDistances(parameters,start_timestep,num_timesteps,num_rollouts))
+  {
+    ROS_WARN("%s computes the costs on the CPU from now on",getName().c_str());
+    program_.reset();
+    queue_.reset();
+    return ObstacleDistanceField::computeCostsBatch(parameters,start_timestep,num_timesteps,iteration_number,
+                                                    num_rollouts,costs,validities);
+  }
+
+  costs.resize(num_rollouts,num_timesteps);
+  validities.assign(num_rollouts,true);
+  for(auto r = 0; r < num_rollouts; r++)
+  {
+    bool validity = true;
+    for(auto t = 0u; t < num_timesteps; t++)
+    {
+      costs(r,t) = computeStateCost(parameters,r*num_parameters + start_timestep + t,distances_[r*num_timesteps + t],
+                                    validity);
+    }
+    validities[r] = validity;
+  }
+
+  return true;
+}
+
+} /* namespace cost_functions */
+} /* namespace stomp_moveit */
@@ -219,12 +219,16 @@ bool ToolGoalPose::computeCosts(const Eigen::MatrixXd& parameters,
     return 0.0;
   };
 
-  costs.resize(parameters.cols());
-  costs.setConstant(0.0);
+  // only the last entry is read by the Task, the vector is merely sized to the trajectory the first time
+  if(costs.size() != parameters.cols())
+  {
+    costs.setZero(parameters.cols());
+  }
 
   last_joint_pose_ = parameters.rightCols(1);
-  state_->setJointGroupPositions(group_name_,last_joint_pose_);
-  last_tool_pose_ = state_->getGlobalLinkTransform(tool_link_);
+  const moveit::core::RobotState& state = getTimestepState(parameters,parameters.cols() - 1,
+                                                           state_->getJointModelGroup(group_name_),*state_);
+  last_tool_pose_ = state.getGlobalLinkTransform(tool_link_);
 
   computeTwist(last_tool_pose_,tool_goal_pose_,dof_nullity_,tool_twist_error_);
 
@@ -26,6 +26,8 @@
 
 #include "stomp_plugins/noise_generators/goal_guided_multivariate_gaussian.h"
 #include <stomp_moveit/utils/multivariate_gaussian.h>
+#include <stomp_moveit/utils/random.h>
+#include <stomp_core/thread_pool.h>
 #include <XmlRpcException.h>
 #include <pluginlib/class_list_macros.h>
 #include <ros/package.h>
@@ -52,7 +54,8 @@ namespace noise_generators
 
 GoalGuidedMultivariateGaussian::GoalGuidedMultivariateGaussian():
   name_("GoalGuidedMultivariateGaussian"),
-  goal_rand_generator_(new RandomGenerator(RGNType(),boost::uniform_real<>(-1,1)))
+  linearized_goal_(false),
+  goal_seed_(0)
 {
 
 }
@@ -144,6 +147,9 @@ bool GoalGuidedMultivariateGaussian::configure(const XmlRpc::XmlRpcValue& config
       kc_.constrained_dofs(i) = static_cast<int>(dof_nullity_param[i]);
     }
 
+    // optional goal sampling parameters
+    linearized_goal_ = params.hasMember("linearized_goal") ? static_cast<bool>(params["linearized_goal"]) : false;
+
   }
   catch(XmlRpc::XmlRpcException& e)
   {
@@ -195,16 +201,22 @@ bool GoalGuidedMultivariateGaussian::setNoiseGeneration(const planning_scene::Pl
   double max_val = covariance.array().abs().matrix().maxCoeff();
   covariance /= max_val;
 
-  // create random generators
+  // create random generators, each dimension and the goal get their own seed derived from the configured seed
+  std::uint64_t seed = static_cast<std::uint64_t>(static_cast<std::uint32_t>(config.seed)) << 32;
   traj_noise_generators_.resize(stddev_.size());
-  for(auto& r: traj_noise_generators_)
+  for(auto d = 0u; d < traj_noise_generators_.size(); d++)
   {
-    r.reset(new utils::MultivariateGaussian(VectorXd::Zero(num_timesteps),covariance));
+    traj_noise_generators_[d].reset(new utils::MultivariateGaussian(VectorXd::Zero(num_timesteps),covariance,seed | d));
   }
+  goal_seed_ = seed | traj_noise_generators_.size();
 
-  // preallocating noise data
-  raw_noise_.resize(config.num_timesteps);
-  raw_noise_.setZero();
+  // preallocating the noise data of each worker
+  workers_.resize(std::max(1,config.num_threads));
+  for(auto& w : workers_)
+  {
+    w.raw_noise = MatrixXd::Zero(config.num_timesteps,stddev_.size());
+    w.normal = VectorXd::Zero(config.num_timesteps);
+  }
 
   error_code.val = error_code.SUCCESS;
 
@@ -224,8 +236,18 @@ bool GoalGuidedMultivariateGaussian::setGoalConstraints(const planning_scene::Pl
   const JointModelGroup* joint_group = robot_model_->getJointModelGroup(group_);
   int num_joints = joint_group->getActiveJointModels().size();
   tool_link_ = joint_group->getLinkModelNames().back();
-  state_.reset(new RobotState(robot_model_));
-  robotStateMsgToRobotState(req.start_state,*state_);
+  for(auto& w : workers_)
+  {
+    w.state.reset(new RobotState(robot_model_));
+    robotStateMsgToRobotState(req.start_state,*w.state);
+    if(!w.ik_workspace.initialize(joint_group))
+    {
+      error_code.val = error_code.FAILURE;
+      return false;
+    }
+    w.kc = kc_;
+    w.linearized_seed.resize(0);
+  }
 
   ROS_DEBUG("%s using '%s' tool link",getName().c_str(),tool_link_.c_str());
   error_code.val = error_code.SUCCESS;
@@ -251,7 +273,31 @@ bool GoalGuidedMultivariateGaussian::generateNoise(const Eigen::MatrixXd& parame
     return false;
   }
 
-  if(generateRandomGoal(parameters.rightCols(1),goal_joint_pose))
+  std::size_t worker_index = stomp_core::ThreadPool::getWorkerIndex();
+  if(worker_index >= workers_.size())
+  {
+    ROS_ERROR("%s has no noise data allocated for worker %lu",getName().c_str(),worker_index);
+    return false;
+  }
+  WorkerData& worker = workers_[worker_index];
+
+  // the noise of a rollout is drawn from the streams keyed by (seed, iteration, rollout), it does not depend on the
+  // thread that generates it or on the order of the rollouts
+  std::uint64_t stream = rollout_number < 0 ? 0 : rollout_number;
+  RandomNumberGenerator goal_rng;
+  goal_rng.seed(goal_seed_,iteration_number,stream);
+  VectorXd goal_noise(CARTESIAN_DOF_SIZE);
+  for(auto d = 0u; d < goal_noise.size(); d++)
+  {
+    goal_noise(d) = goal_stddev_[d]*(2.0*goal_rng.uniform() - 1.0);
+  }
+  for(auto d = 0u; d < parameters.rows() ; d++)
+  {
+    auto raw_noise = worker.raw_noise.col(d);
+    traj_noise_generators_[d]->sampleStream(raw_noise,iteration_number,stream,worker.normal,true);
+  }
+
+  if(generateRandomGoal(parameters.rightCols(1),goal_noise,worker,goal_joint_pose))
   {
     goal_joint_noise = goal_joint_pose - parameters.rightCols(1);
   }
@@ -265,12 +311,10 @@ bool GoalGuidedMultivariateGaussian::generateNoise(const Eigen::MatrixXd& parame
   int sign;
   for(auto d = 0u; d < parameters.rows() ; d++)
   {
-    traj_noise_generators_[d]->sample(raw_noise_,true);
-
     // shifting data towards goal
     sign = goal_joint_noise(d) > 0 ? 1 : -1;
-    noise.row(d).transpose() = stddev_[d] * raw_noise_+ sign*Eigen::VectorXd::LinSpaced(
-        raw_noise_.size(),0,std::abs(goal_joint_noise(d)));
+    noise.row(d).transpose() = stddev_[d] * worker.raw_noise.col(d) + sign*Eigen::VectorXd::LinSpaced(
+        worker.raw_noise.rows(),0,std::abs(goal_joint_noise(d)));
   }
 
   parameters_noise = parameters + noise;
@@ -278,29 +322,28 @@ bool GoalGuidedMultivariateGaussian::generateNoise(const Eigen::MatrixXd& parame
   return true;
 }
 
-bool GoalGuidedMultivariateGaussian::generateRandomGoal(const Eigen::VectorXd& seed_joint_pose,Eigen::VectorXd& goal_joint_pose)
+bool GoalGuidedMultivariateGaussian::generateRandomGoal(const Eigen::VectorXd& seed_joint_pose,const Eigen::VectorXd& noise,
+                                                        WorkerData& worker,Eigen::VectorXd& goal_joint_pose)
 {
   using namespace Eigen;
   using namespace moveit::core;
   using namespace stomp_moveit::utils;
 
-  // generate noise
-  Eigen::VectorXd noise = Eigen::VectorXd::Zero(CARTESIAN_DOF_SIZE);
-  for(auto d = 0u; d < noise.size(); d++)
+  if(linearized_goal_)
   {
-    noise(d) = goal_stddev_[d]*(*goal_rand_generator_)();
+    return generateLinearizedGoal(seed_joint_pose,noise,worker,goal_joint_pose);
   }
 
   // applying noise onto tool pose
-  state_->setJointGroupPositions(group_,seed_joint_pose);
-  state_->updateLinkTransforms();
-  Affine3d tool_pose = state_->getGlobalLinkTransform(tool_link_);
+  worker.state->setJointGroupPositions(group_,seed_joint_pose);
+  worker.state->updateLinkTransforms();
+  Affine3d tool_pose = worker.state->getGlobalLinkTransform(tool_link_);
   auto& n = noise;
-  kc_.tool_goal_pose = tool_pose * Translation3d(Vector3d(n(0),n(1),n(2)))*
+  worker.kc.tool_goal_pose = tool_pose * Translation3d(Vector3d(n(0),n(1),n(2)))*
       AngleAxisd(n(3),Vector3d::UnitX())*AngleAxisd(n(4),Vector3d::UnitY())*AngleAxisd(n(5),Vector3d::UnitZ());
-  kc_.init_joint_pose = seed_joint_pose;
+  worker.kc.init_joint_pose = seed_joint_pose;
 
-  if(!kinematics::solveIK(state_,group_,kc_,goal_joint_pose))
+  if(!kinematics::solveIK(worker.state,worker.ik_workspace,worker.kc,goal_joint_pose))
   {
     ROS_DEBUG("%s 'solveIK(...)' failed, returning noiseless goal pose",getName().c_str());
     goal_joint_pose= seed_joint_pose;
@@ -310,6 +353,56 @@ bool GoalGuidedMultivariateGaussian::generateRandomGoal(const Eigen::VectorXd& s
   return true;
 }
 
+bool GoalGuidedMultivariateGaussian::generateLinearizedGoal(const Eigen::VectorXd& seed,const Eigen::VectorXd& noise,
+                                                            WorkerData& worker,Eigen::VectorXd& goal_joint_pose)
+{
+  using namespace Eigen;
+  using namespace moveit::core;
+  using namespace stomp_moveit::utils;
+
+  utils::kinematics::IKWorkspace& w = worker.ik_workspace;
+  const moveit::core::RobotStatePtr& state = worker.state;
+
+  // the rollouts of an iteration share the seed, the jacobian is only computed for the first one of each worker
+  if(worker.linearized_seed.size() != seed.size() || worker.linearized_seed != seed)
+  {
+    state->setJointGroupPositions(group_,seed);
+    state->updateLinkTransforms();
+    worker.linearized_tool_pose = state->getGlobalLinkTransform(w.tool_link);
+    w.setConstrainedDofs(kc_.constrained_dofs);
+    if(!kinematics::computeToolJacobianPseudoInverse(state,w,worker.linearized_tool_pose))
+    {
+      worker.linearized_seed.resize(0);
+      goal_joint_pose = seed;
+      return false;
+    }
+    worker.linearized_seed = seed;
+  }
+
+  // twist from the current to the noisy tool pose
+  auto& n = noise;
+  Affine3d tool_goal_pose = worker.linearized_tool_pose * Translation3d(Vector3d(n(0),n(1),n(2)))*
+      AngleAxisd(n(3),Vector3d::UnitX())*AngleAxisd(n(4),Vector3d::UnitY())*AngleAxisd(n(5),Vector3d::UnitZ());
+  kinematics::computeTwist(worker.linearized_tool_pose,tool_goal_pose,w.constrained_dofs,w.tool_twist);
+  for(auto i = 0u; i < w.indices.size(); i++)
+  {
+    w.tool_twist_reduced(i) = w.tool_twist(w.indices[i]);
+  }
+
+  // single linearized step, the goal is brought back within the joint limits
+  goal_joint_pose = seed;
+  goal_joint_pose.noalias() += w.jacb_pseudo_inv*w.tool_twist_reduced;
+  const JointModelGroup* joint_group = w.joint_group;
+  state->setJointGroupPositions(joint_group,goal_joint_pose);
+  if(!state->satisfiesBounds(joint_group))
+  {
+    state->enforceBounds(joint_group);
+    state->copyJointGroupPositions(joint_group,goal_joint_pose);
+  }
+
+  return true;
+}
+
 
 } /* namespace noise_generators */
 } /* namespace stomp_moveit */
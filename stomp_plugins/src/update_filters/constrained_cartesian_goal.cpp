@@ -129,6 +129,11 @@ bool ConstrainedCartesianGoal::setMotionPlanRequest(const planning_scene::Planni
   tool_link_ = joint_group->getLinkModelNames().back();
   state_.reset(new RobotState(robot_model_));
   robotStateMsgToRobotState(req.start_state,*state_);
+  if(!ik_workspace_.initialize(joint_group))
+  {
+    error_code.val = error_code.FAILURE;
+    return false;
+  }
 
   const std::vector<moveit_msgs::Constraints>& goals = req.goal_constraints;
   if(goals.empty())
@@ -156,7 +161,7 @@ bool ConstrainedCartesianGoal::setMotionPlanRequest(const planning_scene::Planni
       if(createKinematicConfig(joint_group,pos_constraint,orient_constraint,req.start_state,kc))
       {
         kc_.tool_goal_pose = kc.tool_goal_pose;
-        if(!solveIK(state_,group_name_,kc,joint_pose))
+        if(!solveIK(state_,ik_workspace_,kc,joint_pose))
         {
           ROS_WARN("%s failed calculating ik for cartesian goal pose in the MotionPlanRequest",getName().c_str());
         }
@@ -234,7 +239,7 @@ bool ConstrainedCartesianGoal::filter(std::size_t start_timestep,
     ROS_WARN("%s failed to project into the nullspace of the jacobian",getName().c_str());
   }
 
-  if(kinematics::solveIK(state_,group_name_,kc_,joint_pose))
+  if(kinematics::solveIK(state_,ik_workspace_,kc_,joint_pose))
   {
     filtered = true;
     updates.rightCols(1) = joint_pose - parameters.rightCols(1);